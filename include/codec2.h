@@ -33,6 +33,10 @@
 #ifndef __CODEC2__
 #define  __CODEC2__
 
+#include "codec2_api.h"
+
+#include <stddef.h>
+
 #define CODEC2_MODE_3200 0
 #define CODEC2_MODE_2400 1
 #define CODEC2_MODE_1600 2
@@ -42,21 +46,169 @@
 #define CODEC2_MODE_700  6
 #define CODEC2_MODE_700B 7
 
+/* replicas of the shared read only states, see
+   codec2_create_in_place_node() */
+
+#define CODEC2_MAX_NODES 8
+
+/* encoder VQ search, see codec2_set_vq_search() */
+
+#define CODEC2_VQ_SEARCH_FULL 0
+#define CODEC2_VQ_SEARCH_FAST 1
+
+/* encoder pitch refinement, see codec2_set_pitch_refine() */
+
+#define CODEC2_PITCH_REFINE_FULL 0
+#define CODEC2_PITCH_REFINE_FAST 1
+#define CODEC2_PITCH_REFINE_COARSE 2
+
+/* encoder complexity levels, see codec2_set_complexity() */
+
+#define CODEC2_COMPLEXITY_FULL 0
+#define CODEC2_COMPLEXITY_MIN  3
+
+/* kernels built for several instruction sets, the variant for the
+   CPU is picked by the first codec2_create(), see
+   codec2_kernel_variant() */
+
+#define CODEC2_KERNEL_FFT   0
+#define CODEC2_KERNEL_VQ    1
+#define CODEC2_KERNEL_NLP   2
+#define CODEC2_KERNEL_SYNTH 3
+#define CODEC2_KERNEL_BPF   4
+#define CODEC2_KERNEL_LPC   5
+#define CODEC2_KERNEL_SOFT  6
+
+/* size of a decoder state, see codec2_save_state() */
+
+#define CODEC2_STATE_BYTES 412
+
+/* Opt-in per instance counters, see codec2_enable_stats().  Stage
+   times are in ticks of the machdep profiling clock, CPU cycles on
+   the Cortex-M4, divide by cycles_per_us for micro seconds. */
+
+struct CODEC2_STATS {
+    unsigned long      frames_encoded;
+    unsigned long      frames_decoded;
+    unsigned long long analysis_cycles;    /* encoder model estimation, excl NLP   */
+    unsigned long long nlp_cycles;         /* pitch estimation                     */
+    unsigned long long quantise_cycles;    /* encoder quantisation and packing     */
+    unsigned long long dequantise_cycles;  /* decoder unpacking and interpolation  */
+    unsigned long long synthesis_cycles;   /* phase synthesis and synthesise()     */
+    unsigned long long postfilter_cycles;  /* postfilter()                         */
+    unsigned long      ear_protection;     /* 10ms frames attenuated               */
+    unsigned long      clipped_samples;    /* output samples clipped to +/- 32767  */
+    unsigned long      envelope_lookups;   /* decoder spectral envelopes needed    */
+    unsigned long      envelope_hits;      /* of those, found in the cache         */
+    unsigned long      dtx_frames;         /* silent frames not encoded            */
+    unsigned long      soft_mutes;         /* 1300 frames muted for their ber_est  */
+    unsigned long      last_frame_cycles;  /* latest encode or decode call         */
+    unsigned long      max_frame_cycles;   /* longest encode or decode call        */
+    unsigned long      deadline_misses;    /* calls over codec2_set_deadline()     */
+    float              cycles_per_us;
+};
+
+/* Callbacks for the streaming API, see codec2_encode_stream() and
+   codec2_decode_stream().  bits[] and speech[] are only valid for the
+   duration of the call. */
+
+typedef void (*codec2_bits_callback)(void *cb_state, const unsigned char bits[], int nbytes);
+typedef void (*codec2_speech_callback)(void *cb_state, const short speech[], int nsamples);
+
+/* Speech in a caller's buffer, for codec2_encode_pcm() and
+   codec2_decode_pcm().  A frame's samples run through span[0] then
+   carry on at span[1], so a frame that wraps around the end of a ring
+   buffer is two spans, otherwise len[1] is 0.  Successive samples are
+   stride apart, e.g. the number of channels of an interleaved buffer. */
+
+struct CODEC2_PCM {
+    short *span[2];
+    int    len[2];                     /* samples in each span                 */
+    int    stride;                     /* 1 for a plain buffer of one channel  */
+};
+
 struct CODEC2;
 
-struct CODEC2 *  codec2_create(int mode);
-void codec2_destroy(struct CODEC2 *codec2_state);
-void codec2_encode(struct CODEC2 *codec2_state, unsigned char * bits, short speech_in[]);
-void codec2_decode(struct CODEC2 *codec2_state, short speech_out[], const unsigned char *bits);
-void codec2_decode_ber(struct CODEC2 *codec2_state, short speech_out[], const unsigned char *bits, float ber_est);
-int  codec2_samples_per_frame(struct CODEC2 *codec2_state);
-int  codec2_bits_per_frame(struct CODEC2 *codec2_state);
-
-void codec2_set_lpc_post_filter(struct CODEC2 *codec2_state, int enable, int bass_boost, float beta, float gamma);
-int  codec2_get_spare_bit_index(struct CODEC2 *codec2_state);
-int  codec2_rebuild_spare_bit(struct CODEC2 *codec2_state, int unpacked_bits[]);
-void codec2_set_natural_or_gray(struct CODEC2 *codec2_state, int gray);
-void codec2_set_softdec(struct CODEC2 *c2, float *softdec);
+/* One frame's analysis, codec2_samples_per_frame() samples reduced to
+   the model parameters ahead of quantisation.  Opaque, allocate
+   codec2_analysis_size() bytes.
+
+   codec2_encode_analyse() followed by codec2_encode_quantise() gives
+   exactly the bits of codec2_encode().  The two stages touch disjoint
+   parts of the state, so the analysis of frame k+1 may run on one
+   thread while frame k is quantised on another, frames passing
+   between them in order.  Frames encoded this way aren't counted in
+   codec2_get_stats() frames_encoded or quantise_cycles. */
+
+struct CODEC2_ANALYSIS;
+
+/* The read only tables all instances share are built by the first
+   codec2_create() and kept after the last codec2_destroy(), so
+   creating and destroying instances never rebuilds them.  While no
+   instance exists codec2_release_templates() frees them, e.g. before
+   unloading the library or for leak checkers. */
+
+CODEC2_API int codec2_mode_enabled(int mode);
+CODEC2_API struct CODEC2 *  codec2_create(int mode);
+CODEC2_API void codec2_destroy(struct CODEC2 *codec2_state);
+CODEC2_API void codec2_release_templates(void);
+CODEC2_API size_t codec2_get_state_size(int mode);
+CODEC2_API struct CODEC2 *  codec2_create_in_place(int mode, void *mem);
+CODEC2_API struct CODEC2 *  codec2_create_in_place_node(int mode, void *mem, int node);
+CODEC2_API struct CODEC2 *  codec2_create_decoder(int mode);
+CODEC2_API size_t codec2_get_decoder_state_size(int mode);
+CODEC2_API struct CODEC2 *  codec2_create_decoder_in_place(int mode, void *mem);
+CODEC2_API size_t codec2_scratch_size(int mode);
+CODEC2_API void codec2_set_scratch(struct CODEC2 *codec2_state, void *scratch);
+CODEC2_API void codec2_encode(struct CODEC2 *codec2_state, unsigned char * bits, short speech_in[]);
+CODEC2_API void codec2_decode(struct CODEC2 *codec2_state, short speech_out[], const unsigned char *bits);
+CODEC2_API void codec2_decode_ber(struct CODEC2 *codec2_state, short speech_out[], const unsigned char *bits, float ber_est);
+CODEC2_API void codec2_encode_pcm(struct CODEC2 *codec2_state, unsigned char *bits, const struct CODEC2_PCM *speech_in);
+CODEC2_API void codec2_decode_pcm(struct CODEC2 *codec2_state, const struct CODEC2_PCM *speech_out, const unsigned char *bits);
+CODEC2_API void codec2_encode_float(struct CODEC2 *codec2_state, unsigned char *bits, const float speech_in[], float gain);
+CODEC2_API void codec2_decode_float(struct CODEC2 *codec2_state, float speech_out[], const unsigned char *bits, float gain);
+CODEC2_API size_t codec2_analysis_size(void);
+CODEC2_API void codec2_encode_analyse(struct CODEC2 *codec2_state, struct CODEC2_ANALYSIS *analysis, short speech_in[]);
+CODEC2_API void codec2_encode_quantise(struct CODEC2 *codec2_state, unsigned char *bits, const struct CODEC2_ANALYSIS *analysis);
+CODEC2_API void codec2_encode_batch(struct CODEC2 *codec2_state, unsigned char *bits, short speech_in[], int nframes);
+CODEC2_API void codec2_decode_batch(struct CODEC2 *codec2_state, short speech_out[], const unsigned char *bits, int nframes);
+CODEC2_API void codec2_decode_soft_batch(struct CODEC2 *codec2_state, short speech_out[], const unsigned char *bits,
+                                         const float llr[], int nframes);
+CODEC2_API void codec2_set_dtx(struct CODEC2 *codec2_state, int enable, float level_db);
+CODEC2_API int  codec2_encode_dtx(struct CODEC2 *codec2_state, unsigned char *bits, short speech_in[]);
+CODEC2_API void codec2_decode_silence(struct CODEC2 *codec2_state, short speech_out[]);
+CODEC2_API void codec2_decode_missing(struct CODEC2 *codec2_state, short speech_out[]);
+CODEC2_API void codec2_decode_muted(struct CODEC2 *codec2_state, const unsigned char *bits, float *energy, int *voiced);
+CODEC2_API int  codec2_encode_warmup_frames(struct CODEC2 *codec2_state);
+CODEC2_API void codec2_encode_segment(struct CODEC2 *codec2_state, unsigned char *bits, short speech_in[],
+                                      int nwarmup, int nframes);
+CODEC2_API int  codec2_encode_stream(struct CODEC2 *codec2_state, const short speech_in[], int nsamples,
+                                     codec2_bits_callback cb, void *cb_state);
+CODEC2_API int  codec2_decode_stream(struct CODEC2 *codec2_state, const unsigned char bits[], int nbytes,
+                                     codec2_speech_callback cb, void *cb_state);
+CODEC2_API void codec2_stream_reset(struct CODEC2 *codec2_state);
+CODEC2_API int  codec2_samples_per_frame(struct CODEC2 *codec2_state);
+CODEC2_API int  codec2_bits_per_frame(struct CODEC2 *codec2_state);
+CODEC2_API int  codec2_set_output_rate(struct CODEC2 *codec2_state, int rate);
+CODEC2_API int  codec2_output_samples_per_frame(struct CODEC2 *codec2_state);
+
+CODEC2_API void codec2_set_lpc_post_filter(struct CODEC2 *codec2_state, int enable, int bass_boost, float beta, float gamma);
+CODEC2_API int  codec2_get_spare_bit_index(struct CODEC2 *codec2_state);
+CODEC2_API int  codec2_rebuild_spare_bit(struct CODEC2 *codec2_state, int unpacked_bits[]);
+CODEC2_API void codec2_set_natural_or_gray(struct CODEC2 *codec2_state, int gray);
+CODEC2_API void codec2_set_softdec(struct CODEC2 *c2, const float *softdec);
+CODEC2_API void codec2_set_rand_seed(struct CODEC2 *codec2_state, unsigned long seed);
+CODEC2_API void codec2_set_vq_search(struct CODEC2 *codec2_state, int search);
+CODEC2_API void codec2_set_pitch_refine(struct CODEC2 *codec2_state, int refine);
+CODEC2_API void codec2_set_lag_window(struct CODEC2 *codec2_state, float bw);
+CODEC2_API void codec2_set_complexity(struct CODEC2 *codec2_state, int level);
+CODEC2_API int  codec2_save_state(struct CODEC2 *codec2_state, unsigned char buf[], int nbytes);
+CODEC2_API int  codec2_restore_state(struct CODEC2 *codec2_state, const unsigned char buf[], int nbytes);
+CODEC2_API void codec2_enable_stats(struct CODEC2 *codec2_state, int enable);
+CODEC2_API void codec2_get_stats(struct CODEC2 *codec2_state, struct CODEC2_STATS *stats);
+CODEC2_API void codec2_set_deadline(struct CODEC2 *codec2_state, unsigned long cycles);
+CODEC2_API void codec2_set_flush_denormals(struct CODEC2 *codec2_state, int enable);
+CODEC2_API const char *codec2_kernel_variant(int kernel);
 
 #endif
 
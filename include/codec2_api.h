@@ -0,0 +1,45 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_api.h
+  DATE CREATED: Oct 2026
+
+  CODEC2_API marks the functions of the public headers.  The shared
+  library (codec2_shared) is built with hidden visibility, so these are
+  the only symbols it exports.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_API__
+#define __CODEC2_API__
+
+/* CODEC2_SHARED is defined for users of the Windows DLL, CODEC2_EXPORTS
+   while building it */
+
+#if defined(_WIN32) && defined(CODEC2_SHARED)
+#ifdef CODEC2_EXPORTS
+#define CODEC2_API __declspec(dllexport)
+#else
+#define CODEC2_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__) || defined(__clang__)
+#define CODEC2_API __attribute__((visibility("default")))
+#else
+#define CODEC2_API
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_bank.h
+  DATE CREATED: Oct 2026
+
+  Channel bank, many independent encoders of the same mode run in
+  lock step.  Stages that don't depend on a channel's own parameters
+  are done several channels at a time.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_BANK__
+#define __CODEC2_BANK__
+
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CODEC2;
+struct CODEC2_BANK;
+
+/*!
+ * Creates nchannels codec instances of mode in one block of memory.
+ * Returns NULL if the mode is invalid or memory runs out.
+ */
+CODEC2_API struct CODEC2_BANK *codec2_bank_create(int mode, int nchannels);
+CODEC2_API void codec2_bank_destroy(struct CODEC2_BANK *bank);
+CODEC2_API int  codec2_bank_channels(struct CODEC2_BANK *bank);
+
+/*!
+ * Channel k's instance, for the per channel settings and for decoding
+ * (the bank only batches encoding).  Owned by the bank.  In
+ * CODEC2_SCRATCH_ARENA builds the channels share one scratch arena, so
+ * only use one of them at a time.
+ */
+CODEC2_API struct CODEC2 *codec2_bank_channel(struct CODEC2_BANK *bank, int k);
+
+/*!
+ * Encodes one frame on every channel.  Channel k's
+ * codec2_samples_per_frame() samples are at speech[k*nsam] and its
+ * frame goes to bits[k*nbyte], nbyte = (codec2_bits_per_frame()+7)/8.
+ * The bits are exactly those codec2_encode() would give for each
+ * channel on its own.
+ */
+CODEC2_API void codec2_bank_encode(struct CODEC2_BANK *bank, unsigned char bits[], short speech[]);
+
+/*!
+ * With enable set, does every channel's analysis DFTs of a frame in
+ * one run on an OpenCL device, found and loaded now.  Returns -1 if
+ * the library was built without CODEC2_OPENCL, there is no suitable
+ * device or the mode is 700 or 700B; the bank then stays on the CPU.
+ * The bits are meant to be the CPU's, check them for a new device
+ * (codec2_batch -V).  If the device fails later the bank goes back to
+ * the CPU.  enable 0 releases the device.
+ */
+CODEC2_API int  codec2_bank_use_device(struct CODEC2_BANK *bank, int enable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
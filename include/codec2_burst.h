@@ -0,0 +1,117 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_burst.h
+  DATE CREATED: Oct 2026
+
+  Burst encoder for duty cycled, battery powered radios.  Speech is
+  gathered, by DMA or a sample at a time, into one half of a double
+  buffer while the other half waits to be encoded; the CPU wakes once
+  per half, encodes its frames back to back and sleeps again.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_BURST__
+#define __CODEC2_BURST__
+
+#include <stddef.h>
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CODEC2;
+struct CODEC2_BURST;
+
+/* Energy related counters, see codec2_burst_get_stats().  Times are in
+   cycles of the profiling clock (the DWT cycle counter on Cortex-M),
+   so bursts must be less than 2^32 cycles apart. */
+
+struct CODEC2_BURST_STATS {
+    unsigned long bursts;              /* halves encoded                            */
+    unsigned long frames;              /* frames encoded                            */
+    unsigned long overruns;            /* halves filled before the last was encoded */
+    unsigned int  last_cycles;         /* cycles of the last burst                  */
+    unsigned int  max_cycles;          /* longest burst                             */
+    float         mean_cycles;         /* cycles per burst                          */
+    float         idle_fraction;       /* of the time since the first burst, spent
+                                          outside codec2_burst_encode()             */
+    float         cycles_per_us;
+};
+
+/*!
+ * Bytes of memory codec2_burst_create_in_place() needs for bursts of
+ * nframes frames of mode.
+ */
+CODEC2_API size_t codec2_burst_size(int mode, int nframes);
+
+/*!
+ * Creates a burst encoder of mode that encodes nframes frames per
+ * wake up.  The in place version keeps everything, the codec state
+ * and the double buffer included, in the caller's mem[] of
+ * codec2_burst_size() bytes, aligned to at least 16 bytes, e.g. in
+ * DMA capable memory or TCM.  Returns NULL if the mode or nframes is
+ * invalid (or memory runs out).
+ */
+CODEC2_API struct CODEC2_BURST *codec2_burst_create(int mode, int nframes);
+CODEC2_API struct CODEC2_BURST *codec2_burst_create_in_place(int mode, int nframes, void *mem);
+CODEC2_API void codec2_burst_destroy(struct CODEC2_BURST *b);
+
+/*!
+ * The encoder, for its settings.  Owned by the burst encoder.
+ */
+CODEC2_API struct CODEC2 *codec2_burst_codec(struct CODEC2_BURST *b);
+
+/*!
+ * The double buffer, 2*nframes*codec2_samples_per_frame() samples, and
+ * its length in samples, for a circular DMA transfer.  The DMA's half
+ * and full transfer interrupts each call codec2_burst_half_done(),
+ * which returns -1 if the half now being refilled hadn't been encoded
+ * yet (an overrun, its speech is lost), else 0.
+ */
+CODEC2_API short *codec2_burst_buffer(struct CODEC2_BURST *b, int *nsamples);
+CODEC2_API int  codec2_burst_half_done(struct CODEC2_BURST *b);
+
+/*!
+ * Without DMA, copies n samples into the buffer, taking the place of
+ * the transfer and its interrupts.  Returns the number of halves
+ * waiting to be encoded.
+ */
+CODEC2_API int  codec2_burst_write(struct CODEC2_BURST *b, const short speech[], int n);
+
+/*!
+ * Non-zero if a half is waiting, for the main loop to decide whether
+ * to sleep.
+ */
+CODEC2_API int  codec2_burst_ready(struct CODEC2_BURST *b);
+
+/*!
+ * Encodes the oldest half waiting, its nframes frames back to back,
+ * to nframes*((codec2_bits_per_frame()+7)/8) bytes of bits[].  Returns
+ * the number of frames encoded, 0 if no half was waiting.  The bits
+ * are those of codec2_encode() frame by frame.
+ */
+CODEC2_API int  codec2_burst_encode(struct CODEC2_BURST *b, unsigned char bits[]);
+
+CODEC2_API void codec2_burst_get_stats(struct CODEC2_BURST *b, struct CODEC2_BURST_STATS *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
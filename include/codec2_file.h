@@ -0,0 +1,94 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_file.h
+  DATE CREATED: Oct 2026
+
+  Indexed, seekable .c2 container.  A fixed header, fixed size frame
+  records and an optional trailing index of reset points, so a reader
+  can go to any frame in constant time and decode just the range it
+  wants.  See c2file.c for the layout.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_FILE__
+#define __CODEC2_FILE__
+
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CODEC2_FILE_VERSION          1
+#define CODEC2_FILE_RESET_INTERVAL  50   /* default frames between reset points */
+
+struct CODEC2;
+struct CODEC2_FILE;
+
+/*!
+ * Creates path and writes the header for a stream in mode.  A reset
+ * point is recorded every reset_interval frames (0 for none).
+ *
+ * enc is the encoder that has just produced the nframes frames in
+ * bits[].  Its predictor state is stored at a reset point falling
+ * right after them, so readers can re-seed their decoder there.  Pass
+ * NULL if the frames come from elsewhere; those reset points carry no
+ * state and readers warm their decoder up instead.
+ */
+CODEC2_API struct CODEC2_FILE *codec2_file_open_write(const char *path, int mode, int reset_interval);
+CODEC2_API int codec2_file_write(struct CODEC2_FILE *f, const unsigned char bits[], int nframes, const struct CODEC2 *enc);
+
+/*!
+ * Opens a container, or a plain "C2C2" file from the original tools
+ * (which has no index, so seeks warm the decoder up from earlier
+ * frames).  The reader has its own decoder instance.
+ */
+CODEC2_API struct CODEC2_FILE *codec2_file_open_read(const char *path);
+
+/*!
+ * Finishes a file being written (the frame count and index are written
+ * here) and frees f.  Returns non-zero if anything failed to write.
+ */
+CODEC2_API int codec2_file_close(struct CODEC2_FILE *f);
+
+CODEC2_API int codec2_file_mode(struct CODEC2_FILE *f);
+CODEC2_API int codec2_file_samples_per_frame(struct CODEC2_FILE *f);
+CODEC2_API int codec2_file_bytes_per_frame(struct CODEC2_FILE *f);
+CODEC2_API long codec2_file_frames(struct CODEC2_FILE *f);
+
+/*!
+ * Positions the reader so the next codec2_file_decode() returns frame
+ * number frame.  Frame n starts at n*codec2_file_samples_per_frame()
+ * samples (8 kHz).  Returns 0, or -1 if frame is out of range.
+ */
+CODEC2_API int codec2_file_seek(struct CODEC2_FILE *f, long frame);
+CODEC2_API long codec2_file_tell(struct CODEC2_FILE *f);
+
+/*!
+ * Decodes up to nframes frames into speech[] (nframes *
+ * codec2_file_samples_per_frame() samples), returning the number of
+ * frames decoded.  codec2_file_read() returns the raw frames instead.
+ */
+CODEC2_API int codec2_file_decode(struct CODEC2_FILE *f, short speech[], int nframes);
+CODEC2_API int codec2_file_read(struct CODEC2_FILE *f, unsigned char bits[], int nframes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
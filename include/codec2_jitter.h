@@ -0,0 +1,97 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_jitter.h
+  DATE CREATED: Oct 2026
+
+  Jitter buffer decoder.  Frames arrive out of order, late or not at
+  all, keyed by sequence number, and are decoded ahead in order into a
+  ring of speech that the playout side reads from at its own pace.
+
+  The three sides may each run on their own thread, with no locks:
+
+    network:  codec2_jitter_put() as each frame arrives
+    worker:   codec2_jitter_decode(), e.g. after each put and each read
+    playout:  codec2_jitter_read(), which never decodes or blocks
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_JITTER__
+#define __CODEC2_JITTER__
+
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CODEC2;
+struct CODEC2_JITTER;
+
+/* Each counter is written by one side only */
+
+struct CODEC2_JITTER_STATS {
+    unsigned long received;            /* frames accepted by codec2_jitter_put()    */
+    unsigned long dropped;             /* late, too early or duplicate frames       */
+    unsigned long decoded;             /* frames decoded                            */
+    unsigned long concealed;           /* missing frames concealed                  */
+    unsigned long underruns;           /* reads that found too little speech        */
+};
+
+/*!
+ * Creates a decoder of mode that holds depth frames of speech before
+ * playout starts, so frames up to depth frames late still play.
+ * Returns NULL if the mode or depth is invalid or memory runs out.
+ */
+CODEC2_API struct CODEC2_JITTER *codec2_jitter_create(int mode, int depth);
+CODEC2_API void codec2_jitter_destroy(struct CODEC2_JITTER *jb);
+
+/*!
+ * The decoder, for its settings.  Owned by the jitter buffer, only
+ * change it from the decode side.
+ */
+CODEC2_API struct CODEC2 *codec2_jitter_codec(struct CODEC2_JITTER *jb);
+
+/*!
+ * Hands over frame seq, (codec2_bits_per_frame()+7)/8 bytes.  Sequence
+ * numbers count frames and may wrap.  Returns 0, or -1 if the frame is
+ * dropped: already played, too far ahead or a duplicate.
+ */
+CODEC2_API int codec2_jitter_put(struct CODEC2_JITTER *jb, unsigned int seq, const unsigned char bits[]);
+
+/*!
+ * Decodes frames in order while the speech ring has room.  A frame
+ * that hasn't arrived is concealed once a frame depth later has, or
+ * when playout is about to run dry.  Returns the number of frames
+ * decoded or concealed.
+ */
+CODEC2_API int codec2_jitter_decode(struct CODEC2_JITTER *jb);
+
+/*!
+ * Reads n samples of speech.  Until depth frames are buffered, and
+ * after an underrun until they are again, the gap is filled with
+ * silence.  Returns the number of samples that came from the decoder.
+ */
+CODEC2_API int codec2_jitter_read(struct CODEC2_JITTER *jb, short speech[], int n);
+
+CODEC2_API void codec2_jitter_get_stats(struct CODEC2_JITTER *jb, struct CODEC2_JITTER_STATS *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
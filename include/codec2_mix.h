@@ -0,0 +1,72 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_mix.h
+  DATE CREATED: Oct 2026
+
+  Mixes decoded streams in the model domain, e.g. for a conference
+  bridge.  Each stream is decoded to its harmonics, which are summed
+  into one spectrum per 10 ms frame, and the mix is synthesised once:
+  one inverse DFT and overlap-add however many streams are talking,
+  rather than one per stream and a sum of the speech.
+
+    codec2_mix_add(mix, c2[0], bits[0], 1.0);
+    codec2_mix_add(mix, c2[1], bits[1], 1.0);
+    codec2_mix_read(mix, speech);
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_MIX__
+#define __CODEC2_MIX__
+
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CODEC2;
+struct CODEC2_MIX;
+
+/*!
+ * Creates a mixer of streams of mode, or of any mode with the same
+ * codec2_samples_per_frame().  Returns NULL if the mode is invalid or
+ * memory runs out.
+ */
+CODEC2_API struct CODEC2_MIX *codec2_mix_create(int mode);
+CODEC2_API void codec2_mix_destroy(struct CODEC2_MIX *mix);
+
+/*!
+ * Decodes frame bits of the stream c2 into the mix, scaled by gain.
+ * c2 keeps all its decoder states, so the stream can carry on with
+ * codec2_decode() at any frame, the first frame fading in.  A stream
+ * not added for a frame is silent in it.
+ */
+CODEC2_API void codec2_mix_add(struct CODEC2_MIX *mix, struct CODEC2 *c2, const unsigned char *bits, float gain);
+
+/*!
+ * Synthesises the frame of the streams added since the last read,
+ * codec2_samples_per_frame() samples, and starts the next frame.
+ * Returns the number of streams in the frame.
+ */
+CODEC2_API int codec2_mix_read(struct CODEC2_MIX *mix, short speech[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,103 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_model.h
+  DATE CREATED: Oct 2026
+
+  The encoder's analysis on its own, for pitch and voicing analytics
+  that have no use for the bits.  Each 10 ms frame of speech comes out
+  as a record of the sinusoidal model, unquantised, just as the
+  encoder sees it before quantisation:
+
+    a = codec2_analyser_create(CODEC2_MODE_1300);
+    n = codec2_analyse(a, rec, speech);
+
+  codec2_analyse_file() runs over a whole file of speech and writes
+  the pitch, voicing and energy tracks as a columnar file that can be
+  mapped into memory and scanned directly.  All fields are little
+  endian:
+
+    offset  size
+        0      4  magic "C2MD"
+        4      2  version, CODEC2_MODEL_FILE_VERSION
+        6      2  header size, CODEC2_MODEL_FILE_HEADER bytes
+        8      4  mode analysed in
+       12      4  samples per record, 80 (10 ms)
+       16      4  number of records n
+       20      4  offset of f32 Wo[n]
+       24      4  offset of f32 energy[n]
+       28      4  offset of u8 voiced[n]
+
+  The offsets are from the start of the file, each column aligned to
+  4 bytes.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_MODEL__
+#define __CODEC2_MODEL__
+
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CODEC2_MAX_AMP             80    /* harmonics, as MAX_AMP         */
+#define CODEC2_MODEL_FILE_VERSION   1
+#define CODEC2_MODEL_FILE_HEADER   32
+
+/* One 10 ms frame of the model.  The pitch is Wo*8000/(2*pi) Hz. */
+
+struct CODEC2_MODEL_RECORD {
+    float Wo;                          /* fundamental, radians per sample      */
+    int   L;                           /* number of harmonics                  */
+    int   voiced;                      /* non-zero if voiced                   */
+    float energy;                      /* of the harmonics A[1..L], dB         */
+    float A[CODEC2_MAX_AMP+1];         /* harmonic amplitudes, A[1..L]         */
+};
+
+struct CODEC2_ANALYSER;
+
+/*!
+ * Creates an analyser that analyses speech as the encoder of mode
+ * would, in frames of codec2_analyser_samples_per_frame() samples.
+ * Returns NULL if the mode is invalid or memory runs out.
+ */
+CODEC2_API struct CODEC2_ANALYSER *codec2_analyser_create(int mode);
+CODEC2_API void codec2_analyser_destroy(struct CODEC2_ANALYSER *a);
+CODEC2_API int  codec2_analyser_samples_per_frame(struct CODEC2_ANALYSER *a);
+
+/*!
+ * Analyses one frame of speech into rec[], one record per 10 ms, and
+ * returns the number of records, 2 or 4.  Frames must be given in
+ * order, the analysis carries state from one to the next.
+ */
+CODEC2_API int  codec2_analyse(struct CODEC2_ANALYSER *a, struct CODEC2_MODEL_RECORD rec[], short speech[]);
+
+/*!
+ * Analyses speech_path, raw 8 kHz 16 bit little endian mono samples,
+ * as the encoder of mode would and writes model_path in the columnar
+ * format above.  A partial frame at the end is left out.  Returns the
+ * number of records, or -1 if a file can't be read or written.
+ */
+CODEC2_API long codec2_analyse_file(int mode, const char *speech_path, const char *model_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
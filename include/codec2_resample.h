@@ -0,0 +1,69 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_resample.h
+  DATE CREATED: Oct 2026
+
+  Polyphase FIR sample rate converter, e.g. for bringing 16, 44.1 or
+  48 kHz audio to the 8 kHz the codec runs at.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_RESAMPLE__
+#define __CODEC2_RESAMPLE__
+
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CODEC2_RESAMPLER;
+
+/*!
+ * Converts from in_rate to out_rate Hz.  Any pair of rates whose
+ * ratio reduces to out/in = L/M with L <= 4096 is supported.  Returns
+ * NULL if the ratio is out of range or memory runs out.
+ */
+CODEC2_API struct CODEC2_RESAMPLER *codec2_resampler_create(int in_rate, int out_rate);
+CODEC2_API void codec2_resampler_destroy(struct CODEC2_RESAMPLER *r);
+
+/*!
+ * Consumes all nin samples of in[] and writes the output samples they
+ * complete to out[], returning how many.  out[] must have room for
+ * codec2_resampler_max_output(r, nin) samples.
+ */
+CODEC2_API int codec2_resampler_process(struct CODEC2_RESAMPLER *r, const short in[], int nin, short out[]);
+CODEC2_API int codec2_resampler_max_output(struct CODEC2_RESAMPLER *r, int nin);
+
+/*!
+ * Delay of the filter in output samples.  To line the output up with
+ * the input discard this many samples at the start, and feed as many
+ * input samples' worth of zeros at the end to flush the tail out.
+ */
+CODEC2_API int codec2_resampler_delay(struct CODEC2_RESAMPLER *r);
+
+/*!
+ * Clears the history, as just after codec2_resampler_create().
+ */
+CODEC2_API void codec2_resampler_reset(struct CODEC2_RESAMPLER *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
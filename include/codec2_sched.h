@@ -0,0 +1,125 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_sched.h
+  DATE CREATED: Oct 2026
+
+  Session scheduler for gateways running many codec sessions.  Worker
+  threads are pinned one per core, each session lives on one worker in
+  memory of that worker's NUMA node, and its frames are coded there,
+  earliest deadline first.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_SCHED__
+#define __CODEC2_SCHED__
+
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CODEC2;
+struct CODEC2_SCHED;
+
+/* Each frame is due CODEC2_SCHED_WINDOW_MS after it is submitted, and
+   sessions are spread so each worker's frames of a window fit in it */
+
+#define CODEC2_SCHED_WINDOW_MS  40
+#define CODEC2_SCHED_QUEUE      8      /* frames a session can have queued */
+
+/* One worker's metrics, see codec2_sched_get_stats() */
+
+struct CODEC2_SCHED_STATS {
+    int           cpu;                 /* pinned to, -1 if not pinned               */
+    int           node;                /* NUMA node of cpu                          */
+    int           sessions;            /* sessions placed on the worker             */
+    int           queued;              /* frames waiting                            */
+    unsigned long frames;              /* frames coded                              */
+    unsigned long deadline_misses;     /* frames finished after their deadline      */
+    unsigned long max_latency_us;      /* longest submit to finish time             */
+    float         load;                /* busy fraction over the last second        */
+    float         window_load;         /* sessions' estimated share of each window  */
+};
+
+/*!
+ * Bits or speech of a session's frame, called on the worker thread.
+ * out[] is only valid for the duration of the call, nbytes of bits for
+ * an encoded frame, codec2_output_samples_per_frame() samples
+ * (2 bytes each) for a decoded one.
+ */
+typedef void (*codec2_sched_callback)(void *cb_state, int session, const void *out, int nbytes);
+
+/*!
+ * Starts nworkers workers, pinned to cpus[0..nworkers-1], or if cpus
+ * is NULL to online CPUs taken from each NUMA node in turn.  nworkers
+ * 0 means one per online CPU.  Up to max_sessions sessions can be
+ * open.  Returns NULL if threads or memory can't be had.
+ */
+CODEC2_API struct CODEC2_SCHED *codec2_sched_create(int nworkers, const int cpus[], int max_sessions);
+
+/*!
+ * Stops the workers, dropping queued frames, and closes every session.
+ */
+CODEC2_API void codec2_sched_destroy(struct CODEC2_SCHED *s);
+CODEC2_API int  codec2_sched_workers(struct CODEC2_SCHED *s);
+
+/*!
+ * Opens a session of mode on the least loaded worker, of those on
+ * NUMA node if there are any and node isn't -1.  Its instance is made
+ * by the worker, in node local memory and with the node's replica of
+ * the shared tables (codec2_create_in_place_node()).  cb is called
+ * with each frame coded.  Returns the session number, or -1.
+ */
+CODEC2_API int  codec2_sched_open(struct CODEC2_SCHED *s, int mode, int node, codec2_sched_callback cb,
+                                  void *cb_state);
+
+/*!
+ * Closes a session once the frames it has queued are coded.  Its
+ * number may be reused by the next open.
+ */
+CODEC2_API void codec2_sched_close(struct CODEC2_SCHED *s, int session);
+
+/*!
+ * The session's instance, for its settings.  Only change them before
+ * submitting the first frame.
+ */
+CODEC2_API struct CODEC2 *codec2_sched_codec(struct CODEC2_SCHED *s, int session);
+CODEC2_API int  codec2_sched_session_worker(struct CODEC2_SCHED *s, int session);
+
+/*!
+ * Queues one frame, codec2_samples_per_frame() samples to encode or
+ * (codec2_bits_per_frame()+7)/8 bytes to decode, copied before the
+ * call returns.  Returns 0, or -1 if the session has
+ * CODEC2_SCHED_QUEUE frames queued already.
+ */
+CODEC2_API int  codec2_sched_encode(struct CODEC2_SCHED *s, int session, const short speech[]);
+CODEC2_API int  codec2_sched_decode(struct CODEC2_SCHED *s, int session, const unsigned char bits[]);
+
+/*!
+ * Waits until every frame queued so far has been coded.
+ */
+CODEC2_API void codec2_sched_drain(struct CODEC2_SCHED *s);
+
+CODEC2_API void codec2_sched_get_stats(struct CODEC2_SCHED *s, int worker, struct CODEC2_SCHED_STATS *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
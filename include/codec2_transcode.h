@@ -0,0 +1,64 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_transcode.h
+  DATE CREATED: Oct 2026
+
+  Converts a stream from one mode to another without going through
+  speech, e.g. 3200 in from the network to 1300 or 700B out on the
+  radio.  The frames are decoded to their model parameters, pitch,
+  voicing, LSPs and energy, which go straight to the other mode's
+  quantisers.  There's no DFT, pitch estimation or LPC analysis of
+  synthetic speech, so it's cheaper than codec2_decode() and then
+  codec2_encode(), and free of their tandem coding artefacts.
+
+    t = codec2_transcode_create(CODEC2_MODE_3200, CODEC2_MODE_1300);
+    n = codec2_transcode(t, bits_out, bits_in);
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_TRANSCODE__
+#define __CODEC2_TRANSCODE__
+
+#include "codec2_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CODEC2_TRANSCODE;
+
+/*!
+ * Creates a transcoder from frames of mode_in to frames of mode_out.
+ * Returns NULL if either mode is invalid or memory runs out.
+ */
+CODEC2_API struct CODEC2_TRANSCODE *codec2_transcode_create(int mode_in, int mode_out);
+CODEC2_API void codec2_transcode_destroy(struct CODEC2_TRANSCODE *t);
+
+/*!
+ * Transcodes one frame of mode_in bits.  The modes' frames may be of
+ * different lengths, so this writes 0, 1 or 2 frames of mode_out to
+ * bits_out, one after the other, and returns how many.  bits_out has
+ * room for 2 frames of mode_out whatever the modes.
+ */
+CODEC2_API int codec2_transcode(struct CODEC2_TRANSCODE *t, unsigned char *bits_out, const unsigned char *bits_in);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,48 +1,85 @@
-#include "ButterworthFilter.h"
-
-ButterworthFilter::ButterworthFilter()
-{
-}
-
-ButterworthFilter::ButterworthFilter(float frequency, int sampleRate, PassType passType, float resonance)
-{
-	SetParameters(frequency, sampleRate, passType, resonance);
-}
-
-void ButterworthFilter::SetParameters(float frequency, int sampleRate, PassType passType, float resonance)
-{
-	switch (passType)
-	{
-	case PassType::Lowpass:
-		c = 1.0f / (float)tan(M_PI * frequency / sampleRate);
-		a1 = 1.0f / (1.0f + resonance * c + c * c);
-		a2 = 2.0f * a1;
-		a3 = a1;
-		b1 = 2.0f * (1.0f - c * c) * a1;
-		b2 = (1.0f - resonance * c + c * c) * a1;
-		break;
-	case PassType::Highpass:
-		c = (float)tan(M_PI * frequency / sampleRate);
-		a1 = 1.0f / (1.0f + resonance * c + c * c);
-		a2 = -2.0f * a1;
-		a3 = a1;
-		b1 = 2.0f * (c * c - 1.0f) * a1;
-		b2 = (1.0f - resonance * c + c * c) * a1;
-		break;
-	}
-}
-
-
-float ButterworthFilter::Update(float newInput)
-{
-	float newOutput = a1 * newInput + a2 * inputHistory[0] + a3 * inputHistory[1] - b1 * outputHistory[0] - b2 * outputHistory[1];
-
-	inputHistory[1] = inputHistory[0];
-	inputHistory[0] = newInput;
-
-	outputHistory[2] = outputHistory[1];
-	outputHistory[1] = outputHistory[0];
-	outputHistory[0] = newOutput;
-
-	return newOutput;
-}
+#include "ButterworthFilter.h"
+#include "defines.h"
+
+ButterworthFilter::ButterworthFilter()
+	: inputHistory(), outputHistory()
+{
+}
+
+ButterworthFilter::ButterworthFilter(float frequency, int sampleRate, PassType passType, float resonance)
+	: inputHistory(), outputHistory()
+{
+	SetParameters(frequency, sampleRate, passType, resonance);
+}
+
+void ButterworthFilter::SetParameters(float frequency, int sampleRate, PassType passType, float resonance)
+{
+	switch (passType)
+	{
+	case PassType::Lowpass:
+		c = 1.0f / (float)tan(M_PI * frequency / sampleRate);
+		a1 = 1.0f / (1.0f + resonance * c + c * c);
+		a2 = 2.0f * a1;
+		a3 = a1;
+		b1 = 2.0f * (1.0f - c * c) * a1;
+		b2 = (1.0f - resonance * c + c * c) * a1;
+		break;
+	case PassType::Highpass:
+		c = (float)tan(M_PI * frequency / sampleRate);
+		a1 = 1.0f / (1.0f + resonance * c + c * c);
+		a2 = -2.0f * a1;
+		a3 = a1;
+		b1 = 2.0f * (c * c - 1.0f) * a1;
+		b2 = (1.0f - resonance * c + c * c) * a1;
+		break;
+	}
+}
+
+
+float ButterworthFilter::Update(float newInput)
+{
+	float newOutput = a1 * newInput + a2 * inputHistory[0] + a3 * inputHistory[1] - b1 * outputHistory[0] - b2 * outputHistory[1];
+
+	// a decaying output would otherwise end up denormal on silence
+	FLUSH_DENORMAL(newOutput);
+
+	inputHistory[1] = inputHistory[0];
+	inputHistory[0] = newInput;
+
+	outputHistory[2] = outputHistory[1];
+	outputHistory[1] = outputHistory[0];
+	outputHistory[0] = newOutput;
+
+	return newOutput;
+}
+
+// The recursion is serial, so a block can't be split across lanes
+// without changing the arithmetic.  Instead the state is kept in
+// registers for the whole block and written back once, and each
+// output is formed exactly as in Update().
+
+void ButterworthFilter::Process(const float* in, float* out, int n)
+{
+	float x1 = inputHistory[0], x2 = inputHistory[1];
+	float y1 = outputHistory[0], y2 = outputHistory[1], y3 = outputHistory[2];
+	float x, y;
+
+	for (int i = 0; i < n; i++)
+	{
+		x = in[i];
+		y = a1 * x + a2 * x1 + a3 * x2 - b1 * y1 - b2 * y2;
+		FLUSH_DENORMAL(y);
+		x2 = x1;
+		x1 = x;
+		y3 = y2;
+		y2 = y1;
+		y1 = y;
+		out[i] = y;
+	}
+
+	inputHistory[0] = x1;
+	inputHistory[1] = x2;
+	outputHistory[0] = y1;
+	outputHistory[1] = y2;
+	outputHistory[2] = y3;
+}
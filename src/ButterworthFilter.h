@@ -1,28 +1,32 @@
-#pragma once
-
-#include <math.h>
-
-class ButterworthFilter
-{
-public:
-	enum PassType
-	{
-		Highpass,
-		Lowpass,
-	};
-
-	ButterworthFilter();
-	ButterworthFilter(float frequency, int sampleRate, PassType passType, float resonance);
-	void SetParameters(float frequency, int sampleRate, PassType passType, float resonance);
-	float Update(float newInput);
-
-private:
-	float c, a1, a2, a3, b1, b2;
-
-	// Array of input values, latest are in front
-	float inputHistory[2];
-
-	// Array of output values, latest are in front
-	float outputHistory[3];
-};
-
+#pragma once
+
+#include <math.h>
+
+class ButterworthFilter
+{
+public:
+	enum PassType
+	{
+		Highpass,
+		Lowpass,
+	};
+
+	ButterworthFilter();
+	ButterworthFilter(float frequency, int sampleRate, PassType passType, float resonance);
+	void SetParameters(float frequency, int sampleRate, PassType passType, float resonance);
+	float Update(float newInput);
+
+	// Filters n samples, out[i] is what Update(in[i]) would return.  in
+	// and out may be the same buffer.
+	void Process(const float* in, float* out, int n);
+
+private:
+	float c, a1, a2, a3, b1, b2;
+
+	// Array of input values, latest are in front
+	float inputHistory[2];
+
+	// Array of output values, latest are in front
+	float outputHistory[3];
+};
+
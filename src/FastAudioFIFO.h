@@ -1,78 +1,163 @@
-#pragma once
-
-/*
-Fast 2048 int16_t circular buffer
-Eng. Deulis Antonio Pelegrin Jaime
-2020-06-17
-*/
-
-#define FastAudioFIFO_SIZE 2048 //MUST BE POWER OF 2 !!!
-#define FastAudioFIFO_MASK (FastAudioFIFO_SIZE-1)
-
-class FastAudioFIFO 
-{
-public:
-
-	void init(void)
-	{
-		head_ = 0;
-		tail_ = 0;
-	}
-
-	bool put(int16_t item)
-	{
-		//if (full())
-		//	return false;
-
-		//std::lock_guard<std::mutex> lock(mutex_);
-		buf_[(head_++) & FastAudioFIFO_MASK] = item;
-
-		return true;
-	}
-
-	bool get(int16_t* item)
-	{
-		//std::lock_guard<std::mutex> lock(mutex_);
-
-		if (empty())
-			return false;
-
-		*item = buf_[(tail_++) & FastAudioFIFO_MASK];
-
-		return true;
-	}
-
-	void reset(void)
-	{
-		//std::lock_guard<std::mutex> lock(mutex_);
-		head_ = tail_;
-	}
-
-	bool empty(void) const
-	{
-		//if head and tail are equal, we are empty
-		return head_ == tail_;
-	}
-
-	bool full(void) const
-	{
-		//If tail is ahead the head by 1, we are full
-		return ((head_ + 1) & FastAudioFIFO_MASK) == (tail_ & FastAudioFIFO_MASK);
-	}
-
-	size_t len(void) const
-	{
-		return head_ - tail_;
-	}
-
-	size_t available(void) const
-	{
-		return  FastAudioFIFO_SIZE - (head_ - tail_);
-	}
-
-private:
-	//std::mutex mutex_;
-	int16_t buf_[FastAudioFIFO_SIZE];
-	size_t head_ = 0;
-	size_t tail_ = 0;
-};
+#pragma once
+
+/*
+Fast int16_t circular buffer
+Eng. Deulis Antonio Pelegrin Jaime
+2020-06-17
+
+Lock free for one producer thread and one consumer thread, e.g. a
+capture callback handing audio to an encoder thread.  Only the
+producer calls put()/write(), only the consumer calls get()/read()/
+reset().  head_ and tail_ count items since init() and are never
+masked, so head_ - tail_ is always the fill level and all Capacity
+slots are usable.
+
+Each side publishes its index with a release store after touching the
+buffer, and loads the other side's index with acquire, so the items
+are visible before the index that covers them.  The two indices sit
+on separate cache lines so the threads don't bounce one line between
+cores on every sample.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#define FastAudioFIFO_SIZE      2048 //default capacity, MUST BE POWER OF 2 !!!
+#define FastAudioFIFO_CACHELINE 64
+
+template <size_t Capacity>
+class FastAudioFIFOT
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+		      "FastAudioFIFO capacity must be a power of 2");
+
+public:
+
+	static constexpr size_t capacity(void) { return Capacity; }
+
+	//Only while neither thread is using the FIFO
+	void init(void)
+	{
+		head_.store(0, std::memory_order_relaxed);
+		tail_.store(0, std::memory_order_relaxed);
+	}
+
+	//Producer
+	bool put(int16_t item)
+	{
+		size_t head = head_.load(std::memory_order_relaxed);
+
+		if (head - tail_.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		buf_[head & MASK] = item;
+		head_.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	//Producer, writes as many of the n items as fit, returns the number written
+	size_t write(const int16_t* data, size_t n)
+	{
+		size_t head = head_.load(std::memory_order_relaxed);
+		size_t space = Capacity - (head - tail_.load(std::memory_order_acquire));
+
+		if (n > space)
+			n = space;
+		copy_in(head & MASK, data, n);
+		head_.store(head + n, std::memory_order_release);
+
+		return n;
+	}
+
+	//Consumer
+	bool get(int16_t* item)
+	{
+		size_t tail = tail_.load(std::memory_order_relaxed);
+
+		if (head_.load(std::memory_order_acquire) == tail)
+			return false;
+
+		*item = buf_[tail & MASK];
+		tail_.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	//Consumer, reads up to n items, returns the number read
+	size_t read(int16_t* data, size_t n)
+	{
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		size_t used = head_.load(std::memory_order_acquire) - tail;
+
+		if (n > used)
+			n = used;
+		copy_out(tail & MASK, data, n);
+		tail_.store(tail + n, std::memory_order_release);
+
+		return n;
+	}
+
+	//Consumer, discards everything written so far
+	void reset(void)
+	{
+		tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	//The queries below are exact for the calling side, the other
+	//thread can only make them more favourable meanwhile
+
+	bool empty(void) const
+	{
+		return len() == 0;
+	}
+
+	bool full(void) const
+	{
+		return len() == Capacity;
+	}
+
+	size_t len(void) const
+	{
+		return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+	}
+
+	size_t available(void) const
+	{
+		return Capacity - len();
+	}
+
+private:
+	static const size_t MASK = Capacity - 1;
+
+	//At most two memcpy()s, split where the ring wraps
+
+	void copy_in(size_t pos, const int16_t* data, size_t n)
+	{
+		size_t first = (n < Capacity - pos) ? n : Capacity - pos;
+
+		memcpy(&buf_[pos], data, first * sizeof(int16_t));
+		memcpy(&buf_[0], data + first, (n - first) * sizeof(int16_t));
+	}
+
+	void copy_out(size_t pos, int16_t* data, size_t n)
+	{
+		size_t first = (n < Capacity - pos) ? n : Capacity - pos;
+
+		memcpy(data, &buf_[pos], first * sizeof(int16_t));
+		memcpy(data + first, &buf_[0], (n - first) * sizeof(int16_t));
+	}
+
+	//Padding rather than alignas() so the indices are a line apart even
+	//when operator new under-aligns the object (before C++17)
+
+	std::atomic<size_t> head_{0};	//written by the producer
+	char pad0_[FastAudioFIFO_CACHELINE - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> tail_{0};	//written by the consumer
+	char pad1_[FastAudioFIFO_CACHELINE - sizeof(std::atomic<size_t>)];
+	int16_t buf_[Capacity];
+};
+
+typedef FastAudioFIFOT<FastAudioFIFO_SIZE> FastAudioFIFO;
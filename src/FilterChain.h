@@ -0,0 +1,185 @@
+#pragma once
+
+/*
+Header only filter chains for conditioning audio ahead of
+codec2_encode(), e.g. high pass, band limit and DC block in one pass
+over the input buffer.
+
+Each stage takes its sample type, its size and its coefficient table
+as template parameters.  The table is a constexpr array at namespace
+scope, so the coefficients are compile time constants: the compiler
+can unroll the taps and sections and inline every stage into the one
+loop of FilterChain::process().
+
+	constexpr float kHpf[1][5] = { ... };
+	constexpr float kBand[31] = { ... };
+
+	FilterChain<BiquadStage<float, 1, kHpf>,
+		    FirStage<float, 31, kBand>,
+		    BiquadStage<float, 1, FilterChain_dc_block> > chain;
+
+	chain.process(speech, speech, nsam);
+
+A biquad section is { b0, b1, b2, a1, a2 } with a0 = 1, run in
+transposed direct form II:
+
+	y = b0*x + s1;  s1 = b1*x - a1*y + s2;  s2 = b2*x - a2*y;
+
+Stages keep their own state, one chain per stream.  Not thread safe.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+// Ready made tables, for 8000 Hz
+
+// DC blocker, y = x - x[-1] + 0.995*y[-1]
+constexpr float FilterChain_dc_block[1][5] = {
+	{ 1.0f, -1.0f, 0.0f, -0.995f, 0.0f },
+};
+
+// 2nd order Butterworth high pass at 100 Hz
+constexpr float FilterChain_hpf_100[1][5] = {
+	{ 0.94597686f, -1.89195371f, 0.94597686f, -1.88903308f, 0.89487434f },
+};
+
+// 4th order Butterworth low pass at 3400 Hz, two sections
+constexpr float FilterChain_lpf_3400[2][5] = {
+	{ 0.66611356f, 1.33222713f, 0.66611356f, 1.25544047f, 0.40901378f },
+	{ 0.80555113f, 1.61110226f, 0.80555113f, 1.51824185f, 0.70396266f },
+};
+
+// Taps tap FIR, H[0] applies to the latest sample
+
+template <typename T, size_t Taps, const T (&H)[Taps]>
+class FirStage
+{
+	static_assert(Taps >= 1, "FirStage needs at least one tap");
+
+public:
+	typedef T sample_type;
+
+	FirStage() { reset(); }
+
+	void reset(void)
+	{
+		for (size_t i = 0; i < 2 * Taps; i++)
+			z_[i] = T(0);
+		pos_ = 0;
+	}
+
+	T step(T x)
+	{
+		// stored twice over, so the latest Taps samples are
+		// z_[pos_+1 .. pos_+Taps] whatever pos_ is
+		z_[pos_] = x;
+		z_[pos_ + Taps] = x;
+
+		const T* p = &z_[pos_ + Taps];
+		T acc = T(0);
+		for (size_t i = 0; i < Taps; i++)
+			acc += H[i] * p[-(ptrdiff_t)i];
+
+		if (++pos_ == Taps)
+			pos_ = 0;
+		return acc;
+	}
+
+private:
+	T      z_[2 * Taps];
+	size_t pos_;
+};
+
+// Sections biquads in cascade, C[k] = { b0, b1, b2, a1, a2 }
+
+template <typename T, size_t Sections, const T (&C)[Sections][5]>
+class BiquadStage
+{
+	static_assert(Sections >= 1, "BiquadStage needs at least one section");
+
+public:
+	typedef T sample_type;
+
+	BiquadStage() { reset(); }
+
+	void reset(void)
+	{
+		for (size_t k = 0; k < Sections; k++)
+			s_[k][0] = s_[k][1] = T(0);
+	}
+
+	T step(T x)
+	{
+		for (size_t k = 0; k < Sections; k++) {
+			T y = C[k][0] * x + s_[k][0];
+			s_[k][0] = C[k][1] * x - C[k][3] * y + s_[k][1];
+			s_[k][1] = C[k][2] * x - C[k][4] * y;
+			x = y;
+		}
+		return x;
+	}
+
+private:
+	T s_[Sections][2];
+};
+
+// The stages in order, each sample runs through all of them before
+// the next is read
+
+template <typename... Stages>
+class FilterChain;
+
+template <>
+class FilterChain<>
+{
+public:
+	void reset(void) {}
+
+	template <typename T>
+	T step(T x) { return x; }
+};
+
+template <typename First, typename... Rest>
+class FilterChain<First, Rest...>
+{
+public:
+	typedef typename First::sample_type sample_type;
+
+	void reset(void)
+	{
+		first_.reset();
+		rest_.reset();
+	}
+
+	sample_type step(sample_type x)
+	{
+		return (sample_type)rest_.step(first_.step(x));
+	}
+
+	// in and out may be the same buffer
+
+	void process(const float* in, float* out, size_t n)
+	{
+		for (size_t i = 0; i < n; i++)
+			out[i] = (float)step((sample_type)in[i]);
+	}
+
+	// rounded to the nearest integer and saturated
+
+	void process(const int16_t* in, int16_t* out, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			sample_type y = step((sample_type)in[i]);
+			if (y >= (sample_type)32767)
+				out[i] = 32767;
+			else if (y <= (sample_type)-32768)
+				out[i] = -32768;
+			else
+				out[i] = (int16_t)(y < 0 ? y - (sample_type)0.5 : y + (sample_type)0.5);
+		}
+	}
+
+private:
+	First                 first_;
+	FilterChain<Rest...>  rest_;
+};
@@ -18,6 +18,13 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
    typedef struct { kiss_fft_scalar r; kiss_fft_scalar i; }kiss_fft_cpx; */
 #include "kiss_fft.h"
 #include <limits.h>
+#ifdef CODEC2_CMSIS_DSP
+#if defined(FIXED_POINT) || defined(USE_SIMD)
+#error CODEC2_CMSIS_DSP needs the float kiss_fft_cpx layout
+#endif
+#include "arm_math.h"
+#include "arm_const_structs.h"
+#endif
 
 #define MAXFACTORS 32
 /* e.g. an fft of length 128 has 4 factors
@@ -29,9 +36,18 @@ struct kiss_fft_state{
     int nfft;
     int inverse;
     int factors[2*MAXFACTORS];
+    int plan;      /* non-zero for a fixed size plan, see kf_work_plan() */
+#ifdef CODEC2_CMSIS_DSP
+    const arm_cfft_instance_f32 *arm_cfg; /* CMSIS-DSP plan for this nfft, or NULL */
+#endif
     kiss_fft_cpx twiddles[1];
 };
 
+/* the digit reversal table of a plan follows the twiddles in the cfg
+   block */
+
+#define KF_PERM(st) ((unsigned short *)((st)->twiddles + (st)->nfft))
+
 /*
   Explanation of macros dealing with complex math:
 
@@ -0,0 +1,234 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: bitpack.h
+  DATE CREATED: Oct 2026
+
+  Word at a time bit writer and reader for packing codec frames.  The
+  bit string is the same as pack_natural_or_gray() and
+  unpack_natural_or_gray() give, MSB first, but fields collect in a
+  64 bit accumulator and the bytes are stored or loaded whole, rather
+  than a read-modify-write of the string for every field.
+
+  A FRAME_LAYOUT lists a frame's fields in order, so one generic
+  frame_pack() and frame_unpack() serve every mode.  Frames of up to
+  64 bits are packed in a single accumulator with no branches per
+  field.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __BITPACK__
+#define __BITPACK__
+
+#include <assert.h>
+#include <stdint.h>
+
+#define BITPACK_MAX_FIELD 16           /* widest field, in bits                 */
+
+typedef struct {
+    unsigned char *bits;               /* next byte to store                    */
+    uint64_t       acc;                /* bits not yet stored, in the low nacc  */
+    unsigned int   nacc;
+    unsigned int   nbit;               /* bits written so far                   */
+} BIT_WRITER;
+
+typedef struct {
+    const unsigned char *bits;         /* next byte to load                     */
+    const unsigned char *end;          /* one past the last byte of the string  */
+    uint64_t       acc;                /* bits loaded but not read, in the low nacc */
+    unsigned int   nacc;
+    unsigned int   nbit;               /* bits read so far                      */
+} BIT_READER;
+
+/* the Gray coding of a field */
+
+#define FRAME_GRAY      1              /* always Gray coded                     */
+#define FRAME_GRAY_OPT  2              /* Gray coded when the caller asks       */
+
+#define FRAME_MAX_FIELDS 24
+
+typedef struct {
+    unsigned char  width;              /* in bits, at most BITPACK_MAX_FIELD    */
+    unsigned char  gray;               /* 0, FRAME_GRAY or FRAME_GRAY_OPT       */
+} FRAME_FIELD;
+
+typedef struct {
+    int            nfields;
+    int            nbit;               /* sum of the widths                     */
+    int            spare;              /* field whose first bit is spare, or -1 */
+    FRAME_FIELD    field[FRAME_MAX_FIELDS];
+} FRAME_LAYOUT;
+
+/*---------------------------------------------------------------------------*\
+
+                               FUNCTIONS
+
+\*---------------------------------------------------------------------------*/
+
+/* Gray code of the low width bits of field, a 256 entry table would
+   be no cheaper than these few shifts */
+
+inline static unsigned int bitpack_to_gray(unsigned int field)
+{
+    return field ^ (field >> 1);
+}
+
+inline static unsigned int bitpack_from_gray(unsigned int field)
+{
+    field ^= field >> 8;
+    field ^= field >> 4;
+    field ^= field >> 2;
+    field ^= field >> 1;
+    return field;
+}
+
+/* Writes whole bytes of the string, so there's no need to clear it
+   first.  bit_writer_flush() must be called after the last field. */
+
+inline static void bit_writer_init(BIT_WRITER *w, unsigned char *bits)
+{
+    w->bits = bits;
+    w->acc = 0;
+    w->nacc = 0;
+    w->nbit = 0;
+}
+
+inline static void bit_write(BIT_WRITER *w, int field, unsigned int width, unsigned int gray)
+{
+    unsigned int f = (unsigned int)field;
+
+    assert((width >= 1) && (width <= BITPACK_MAX_FIELD));
+    if (gray)
+	f = bitpack_to_gray(f);
+    f &= (1u << width) - 1;
+
+    if (w->nacc + width > 64) {
+	while(w->nacc >= 8) {
+	    w->nacc -= 8;
+	    *w->bits++ = (unsigned char)(w->acc >> w->nacc);
+	}
+    }
+    w->acc = (w->acc << width) | f;
+    w->nacc += width;
+    w->nbit += width;
+}
+
+/* Stores what is left, zero filling the last byte.  Returns the
+   number of bits written. */
+
+inline static unsigned int bit_writer_flush(BIT_WRITER *w)
+{
+    while(w->nacc >= 8) {
+	w->nacc -= 8;
+	*w->bits++ = (unsigned char)(w->acc >> w->nacc);
+    }
+    if (w->nacc) {
+	*w->bits++ = (unsigned char)(w->acc << (8 - w->nacc));
+	w->nacc = 0;
+    }
+    return w->nbit;
+}
+
+/* Reads from the nbit bit string at bits, never loading beyond it */
+
+inline static void bit_reader_init(BIT_READER *r, const unsigned char *bits, unsigned int nbit)
+{
+    r->bits = bits;
+    r->end = bits + (nbit + 7)/8;
+    r->acc = 0;
+    r->nacc = 0;
+    r->nbit = 0;
+}
+
+inline static int bit_read(BIT_READER *r, unsigned int width, unsigned int gray)
+{
+    unsigned int f;
+
+    assert((width >= 1) && (width <= BITPACK_MAX_FIELD));
+    if (r->nacc < width) {
+	while((r->nacc <= 56) && (r->bits < r->end)) {
+	    r->acc = (r->acc << 8) | *r->bits++;
+	    r->nacc += 8;
+	}
+	assert(r->nacc >= width);
+    }
+    r->nacc -= width;
+    f = (unsigned int)(r->acc >> r->nacc) & ((1u << width) - 1);
+    r->nbit += width;
+
+    return gray ? (int)bitpack_from_gray(f) : (int)f;
+}
+
+/* Packs the layout's fields from index[] into the (nbit+7)/8 bytes at
+   bits, the last byte zero filled.  gray selects the FRAME_GRAY_OPT
+   fields' coding. */
+
+inline static void frame_pack(const FRAME_LAYOUT *l, unsigned char bits[], const int index[], int gray)
+{
+    unsigned int sel = FRAME_GRAY | (gray ? FRAME_GRAY_OPT : 0);
+    unsigned int f, g;
+    uint64_t     acc = 0;
+    BIT_WRITER   w;
+    int          i;
+
+    if (l->nbit > 64) {
+	bit_writer_init(&w, bits);
+	for(i=0; i<l->nfields; i++)
+	    bit_write(&w, index[i], l->field[i].width, l->field[i].gray & sel);
+	bit_writer_flush(&w);
+	return;
+    }
+
+    for(i=0; i<l->nfields; i++) {
+	f = (unsigned int)index[i];
+	assert(f < (1u << l->field[i].width));
+	g = -(unsigned int)((l->field[i].gray & sel) != 0);
+	acc = (acc << l->field[i].width) | (f ^ ((f >> 1) & g));
+    }
+    acc <<= 64 - l->nbit;
+    for(i=0; i<(l->nbit + 7)/8; i++)
+	bits[i] = (unsigned char)(acc >> (56 - 8*i));
+}
+
+/* The inverse, index[] gets the layout's fields from bits */
+
+inline static void frame_unpack(const FRAME_LAYOUT *l, int index[], const unsigned char bits[], int gray)
+{
+    unsigned int sel = FRAME_GRAY | (gray ? FRAME_GRAY_OPT : 0);
+    unsigned int f, g;
+    uint64_t     acc = 0;
+    BIT_READER   r;
+    int          i;
+
+    if (l->nbit > 64) {
+	bit_reader_init(&r, bits, l->nbit);
+	for(i=0; i<l->nfields; i++)
+	    index[i] = bit_read(&r, l->field[i].width, l->field[i].gray & sel);
+	return;
+    }
+
+    for(i=0; i<(l->nbit + 7)/8; i++)
+	acc |= (uint64_t)bits[i] << (56 - 8*i);
+    for(i=0; i<l->nfields; i++) {
+	f = (unsigned int)(acc >> (64 - l->field[i].width));
+	acc <<= l->field[i].width;
+	g = -(unsigned int)((l->field[i].gray & sel) != 0);
+	index[i] = (int)((bitpack_from_gray(f) & g) | (f & ~g));
+    }
+}
+
+#endif
@@ -0,0 +1,602 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: c2file.c
+  DATE CREATED: Oct 2026
+
+  Indexed, seekable .c2 container.  All fields are little endian:
+
+    offset  size
+        0      4  magic "C2CF"
+        4      2  version, CODEC2_FILE_VERSION
+        6      2  header size, C2F_HEADER bytes
+        8      4  mode
+       12      4  samples per frame
+       16      4  bits per frame
+       20      4  bytes per frame record
+       24      4  frames between reset points, 0 if none
+       28      4  number of frames, C2F_UNKNOWN until the writer closes
+
+  followed by the fixed size frame records, so frame n is at header
+  size + n*record bytes, then optionally the index:
+
+        0      4  magic "C2IX"
+        4      4  number of entries
+        8         entries of C2F_ENTRY bytes, one per reset point:
+                    u32 frame, u32 flags, f32 xq[2]
+
+  Reset point k is frame k*reset interval.  If C2F_SEEDED is set in
+  its flags the entry holds the Wo/energy predictor state the decoder
+  should have going into that frame.  That is the only decoder state
+  with a long memory (the 2400, 1400 and 1200 modes' predictive
+  quantiser), the rest settles within a frame or two, so a seek
+  re-seeds the predictor at the reset point at least C2F_PREROLL frames
+  before the target and decodes from there, discarding the output up
+  to the target.  Without a seeded entry close enough the decoder is
+  warmed up over codec2_encode_warmup_frames() frames instead.  Either
+  way the cost of a seek is bounded, whatever the position.
+
+  As the reader decodes through a reset point it keeps a
+  codec2_save_state() snapshot of its decoder there, so seeking back
+  into ground it has already covered restores the exact state instead
+  and the output matches an uninterrupted decode.  Snapshots are only
+  taken while the decoder is exact, i.e. has decoded every frame in
+  order from frame 0 or from an earlier snapshot; a re-seeded or warmed
+  up decoder is only close, and its state is never kept.
+
+  The reset points don't change the bit stream, the frames are exactly
+  what the encoder produced.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "codec2.h"
+#include "codec2_internal.h"
+#include "codec2_file.h"
+
+#define C2F_MAGIC       0x46433243   /* "C2CF"                              */
+#define C2F_INDEX_MAGIC 0x58493243   /* "C2IX"                              */
+#define C2F_OLD_MAGIC   0x43324332   /* original tools' header, host order  */
+#define C2F_HEADER      32
+#define C2F_OLD_HEADER  16
+#define C2F_ENTRY       16
+#define C2F_UNKNOWN     0xffffffff
+#define C2F_SEEDED      0x1
+#define C2F_PREROLL     2            /* frames decoded ahead of a seek target */
+
+typedef struct {
+    long           frame;
+    uint32_t       flags;
+    float          xq[2];
+    unsigned char *state;         /* reader's decoder snapshot, or NULL        */
+} C2F_RESET;
+
+struct CODEC2_FILE {
+    FILE          *fp;
+    int            writing;
+    int            mode;
+    int            nsam;          /* samples per frame                         */
+    int            nbit;          /* bits per frame                            */
+    int            nbyte;         /* bytes per frame record                    */
+    long           header;        /* offset of frame 0                         */
+    long           interval;      /* frames between reset points, 0 if none    */
+    long           nframes;
+    long           pos;           /* next frame to read or write               */
+    long           dec_pos;       /* next frame the decoder is in step for     */
+    int            exact;         /* decoder as an uninterrupted decode's      */
+    struct CODEC2 *c2;            /* reader's decoder                          */
+    C2F_RESET     *index;
+    long           nindex;
+    long           maxindex;
+    unsigned char *bits;          /* one frame                                 */
+    short         *speech;        /* one frame of discarded pre-roll output    */
+    int            err;
+};
+
+/*---------------------------------------------------------------------------*\
+
+                               HELPERS
+
+\*---------------------------------------------------------------------------*/
+
+static void put16(unsigned char *p, uint32_t x)
+{
+    p[0] = x & 0xff;
+    p[1] = (x >> 8) & 0xff;
+}
+
+static void put32(unsigned char *p, uint32_t x)
+{
+    put16(p, x & 0xffff);
+    put16(p + 2, x >> 16);
+}
+
+static uint32_t get16(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+    return get16(p) | (get16(p + 2) << 16);
+}
+
+static void putf(unsigned char *p, float x)
+{
+    uint32_t u;
+
+    memcpy(&u, &x, sizeof(u));
+    put32(p, u);
+}
+
+static float getf(const unsigned char *p)
+{
+    uint32_t u = get32(p);
+    float    x;
+
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+static struct CODEC2_FILE *file_alloc(FILE *fp, int mode, int nsam, int nbit)
+{
+    struct CODEC2_FILE *f;
+
+    if ((mode < CODEC2_MODE_3200) || (mode > CODEC2_MODE_700B) ||
+	(nsam <= 0) || (nsam > 8*N) || (nbit <= 0) || (nbit > 8*N))
+	return NULL;
+    f = (struct CODEC2_FILE*)calloc(1, sizeof(struct CODEC2_FILE));
+    if (f == NULL)
+	return NULL;
+    f->fp = fp;
+    f->mode = mode;
+    f->nsam = nsam;
+    f->nbit = nbit;
+    f->nbyte = (nbit + 7)/8;
+    f->bits = (unsigned char*)malloc(f->nbyte);
+    f->speech = (short*)malloc(sizeof(short)*nsam);
+    if ((f->bits == NULL) || (f->speech == NULL)) {
+	free(f->bits);
+	free(f->speech);
+	free(f);
+	return NULL;
+    }
+    return f;
+}
+
+static int add_reset(struct CODEC2_FILE *f, long frame, const struct CODEC2 *enc)
+{
+    C2F_RESET *r;
+
+    if (f->nindex == f->maxindex) {
+	long n = f->maxindex ? 2*f->maxindex : 64;
+	r = (C2F_RESET*)realloc(f->index, sizeof(C2F_RESET)*n);
+	if (r == NULL)
+	    return -1;
+	f->index = r;
+	f->maxindex = n;
+    }
+    r = &f->index[f->nindex++];
+    r->frame = frame;
+    r->flags = 0;
+    r->state = NULL;
+    r->xq[0] = r->xq[1] = 0.0;
+    if (enc != NULL) {
+	r->flags = C2F_SEEDED;
+	r->xq[0] = enc->xq_enc[0];
+	r->xq[1] = enc->xq_enc[1];
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                               WRITING
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_FILE *codec2_file_open_write(const char *path, int mode, int reset_interval)
+{
+    struct CODEC2_FILE *f;
+    struct CODEC2      *c2;
+    unsigned char       h[C2F_HEADER];
+    FILE               *fp;
+
+    assert(reset_interval >= 0);
+    if ((mode < CODEC2_MODE_3200) || (mode > CODEC2_MODE_700B))
+	return NULL;
+    c2 = codec2_create(mode);
+    if (c2 == NULL)
+	return NULL;
+    fp = fopen(path, "wb");
+    f = (fp != NULL) ? file_alloc(fp, mode, codec2_samples_per_frame(c2), codec2_bits_per_frame(c2)) : NULL;
+    if (f == NULL) {
+	if (fp != NULL)
+	    fclose(fp);
+	codec2_destroy(c2);
+	return NULL;
+    }
+    f->writing = 1;
+    f->header = C2F_HEADER;
+    f->interval = reset_interval;
+
+    put32(&h[0], C2F_MAGIC);
+    put16(&h[4], CODEC2_FILE_VERSION);
+    put16(&h[6], C2F_HEADER);
+    put32(&h[8], f->mode);
+    put32(&h[12], f->nsam);
+    put32(&h[16], f->nbit);
+    put32(&h[20], f->nbyte);
+    put32(&h[24], f->interval);
+    put32(&h[28], C2F_UNKNOWN);
+    if (fwrite(h, 1, C2F_HEADER, fp) != C2F_HEADER)
+	f->err = 1;
+
+    /* every instance starts in the same state */
+
+    if (f->interval && (add_reset(f, 0, c2) != 0))
+	f->err = 1;
+    codec2_destroy(c2);
+
+    return f;
+}
+
+/*
+  The encoder state is only known at the end of each call, so with enc
+  encoding one frame per call every reset point is seeded.  Reset
+  points falling inside a call of several frames are left unseeded.
+*/
+
+int codec2_file_write(struct CODEC2_FILE *f, const unsigned char bits[], int nframes, const struct CODEC2 *enc)
+{
+    long start, k;
+
+    assert(f != NULL);
+    assert(f->writing);
+    if (fwrite(bits, f->nbyte, nframes, f->fp) != (size_t)nframes) {
+	f->err = 1;
+	return -1;
+    }
+    start = f->pos;
+    f->pos += nframes;
+    f->nframes = f->pos;
+    if (f->interval)
+	for(k=(start/f->interval + 1)*f->interval; k<=f->pos; k+=f->interval)
+	    if (add_reset(f, k, k == f->pos ? enc : NULL) != 0)
+		f->err = 1;
+
+    return nframes;
+}
+
+static int write_trailer(struct CODEC2_FILE *f)
+{
+    unsigned char e[C2F_ENTRY];
+    long          i, n;
+
+    /* a reset point recorded after the last frame has nothing to seek to */
+
+    for(n=f->nindex; (n > 0) && (f->index[n-1].frame >= f->nframes); n--)
+	;
+    if (n) {
+	put32(&e[0], C2F_INDEX_MAGIC);
+	put32(&e[4], n);
+	if (fwrite(e, 1, 8, f->fp) != 8)
+	    return -1;
+	for(i=0; i<n; i++) {
+	    put32(&e[0], f->index[i].frame);
+	    put32(&e[4], f->index[i].flags);
+	    putf(&e[8], f->index[i].xq[0]);
+	    putf(&e[12], f->index[i].xq[1]);
+	    if (fwrite(e, 1, C2F_ENTRY, f->fp) != C2F_ENTRY)
+		return -1;
+	}
+    }
+
+    put32(e, f->nframes);
+    if ((fseek(f->fp, 28, SEEK_SET) != 0) || (fwrite(e, 1, 4, f->fp) != 4))
+	return -1;
+
+    return 0;
+}
+
+int codec2_file_close(struct CODEC2_FILE *f)
+{
+    long i;
+    int  err;
+
+    assert(f != NULL);
+    if (f->writing) {
+	if (write_trailer(f) != 0)
+	    f->err = 1;
+    }
+    else if (f->c2 != NULL)
+	codec2_destroy(f->c2);
+    if (fclose(f->fp) != 0)
+	f->err = 1;
+    err = f->err;
+    for(i=0; i<f->nindex; i++)
+	free(f->index[i].state);
+    free(f->index);
+    free(f->bits);
+    free(f->speech);
+    free(f);
+
+    return err;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                               READING
+
+\*---------------------------------------------------------------------------*/
+
+static void read_index(struct CODEC2_FILE *f)
+{
+    unsigned char e[C2F_ENTRY];
+    long          i, n;
+
+    if ((fseek(f->fp, f->header + f->nframes*f->nbyte, SEEK_SET) != 0) ||
+	(fread(e, 1, 8, f->fp) != 8) || (get32(&e[0]) != C2F_INDEX_MAGIC))
+	return;
+    n = get32(&e[4]);
+    if (n > f->nframes/f->interval + 1)
+	n = f->nframes/f->interval + 1;
+    f->index = (C2F_RESET*)malloc(sizeof(C2F_RESET)*(n ? n : 1));
+    if (f->index == NULL)
+	return;
+    for(i=0; i<n; i++) {
+	if (fread(e, 1, C2F_ENTRY, f->fp) != C2F_ENTRY)
+	    break;
+	f->index[i].frame = get32(&e[0]);
+	f->index[i].flags = get32(&e[4]);
+	f->index[i].xq[0] = getf(&e[8]);
+	f->index[i].xq[1] = getf(&e[12]);
+	f->index[i].state = NULL;
+
+	/* entry k must be reset point k for the constant time lookup */
+
+	if (f->index[i].frame != i*f->interval)
+	    break;
+    }
+    f->nindex = i;
+}
+
+struct CODEC2_FILE *codec2_file_open_read(const char *path)
+{
+    struct CODEC2_FILE *f = NULL;
+    unsigned char       h[C2F_HEADER];
+    uint32_t            old[4];
+    long                size, header, records;
+    FILE               *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+	return NULL;
+    if ((fseek(fp, 0, SEEK_END) != 0) || ((size = ftell(fp)) < 0) || (fseek(fp, 0, SEEK_SET) != 0) ||
+	(fread(h, 1, C2F_OLD_HEADER, fp) != C2F_OLD_HEADER))
+	goto fail;
+
+    memcpy(old, h, sizeof(old));
+    if (old[0] == C2F_OLD_MAGIC) {
+	f = file_alloc(fp, old[1], old[2], old[3]);
+	if (f == NULL)
+	    goto fail;
+	f->header = C2F_OLD_HEADER;
+	f->nframes = (size - f->header)/f->nbyte;
+    }
+    else if (get32(&h[0]) == C2F_MAGIC) {
+	if ((fread(&h[C2F_OLD_HEADER], 1, C2F_HEADER - C2F_OLD_HEADER, fp) != C2F_HEADER - C2F_OLD_HEADER) ||
+	    (get16(&h[4]) > CODEC2_FILE_VERSION) || ((header = get16(&h[6])) < C2F_HEADER))
+	    goto fail;
+	f = file_alloc(fp, get32(&h[8]), get32(&h[12]), get32(&h[16]));
+	if (f == NULL)
+	    goto fail;
+	f->header = header;
+	f->interval = get32(&h[24]);
+	if (get32(&h[20]) != (uint32_t)f->nbyte)
+	    goto fail;
+
+	/* an unfinished file has no frame count or index, take what's there */
+
+	records = (size - f->header)/f->nbyte;
+	f->nframes = get32(&h[28]);
+	if ((get32(&h[28]) == C2F_UNKNOWN) || (f->nframes > records))
+	    f->nframes = records;
+	else if (f->interval)
+	    read_index(f);
+    }
+    else
+	goto fail;
+
+    f->c2 = codec2_create_decoder(f->mode);
+    f->exact = 1;
+    if ((f->c2 == NULL) || (codec2_samples_per_frame(f->c2) != f->nsam) ||
+	(codec2_bits_per_frame(f->c2) != f->nbit) || (fseek(fp, f->header, SEEK_SET) != 0))
+	goto fail;
+
+    return f;
+
+ fail:
+    if (f != NULL)
+	codec2_file_close(f);
+    else
+	fclose(fp);
+    return NULL;
+}
+
+int codec2_file_mode(struct CODEC2_FILE *f)
+{
+    assert(f != NULL);
+    return f->mode;
+}
+
+int codec2_file_samples_per_frame(struct CODEC2_FILE *f)
+{
+    assert(f != NULL);
+    return f->nsam;
+}
+
+int codec2_file_bytes_per_frame(struct CODEC2_FILE *f)
+{
+    assert(f != NULL);
+    return f->nbyte;
+}
+
+long codec2_file_frames(struct CODEC2_FILE *f)
+{
+    assert(f != NULL);
+    return f->nframes;
+}
+
+long codec2_file_tell(struct CODEC2_FILE *f)
+{
+    assert(f != NULL);
+    return f->pos;
+}
+
+int codec2_file_seek(struct CODEC2_FILE *f, long frame)
+{
+    assert(f != NULL);
+    assert(!f->writing);
+    if ((frame < 0) || (frame > f->nframes))
+	return -1;
+    f->pos = frame;
+    return 0;
+}
+
+/*
+  Brings the decoder into step for frame pos: re-seeds it at the
+  nearest usable reset point at least C2F_PREROLL frames back (or warms
+  it up from further back, or starts at frame 0 if that is nearer),
+  then decodes up to pos.  If there is a snapshot at the reset point
+  just before pos decoding resumes from that instead, exactly, at the
+  cost of up to an interval of frames.  Only that, or decoding from
+  frame 0, leaves the decoder exact.
+*/
+
+static int sync_decoder(struct CODEC2_FILE *f)
+{
+    const C2F_RESET *seed = NULL, *snap = NULL;
+    long             start, warmup, k;
+
+    warmup = codec2_encode_warmup_frames(f->c2);
+    start = f->pos - warmup;
+    if (f->nindex && (f->pos >= C2F_PREROLL)) {
+	k = (f->pos - C2F_PREROLL)/f->interval;
+	if (k >= f->nindex)
+	    k = f->nindex - 1;
+	for(; (k > 0) && (f->index[k].frame > start); k--)
+	    if (f->index[k].flags & C2F_SEEDED) {
+		seed = &f->index[k];
+		start = seed->frame;
+		break;
+	    }
+    }
+    if (start < 0)
+	start = 0;
+    k = f->nindex ? f->pos/f->interval : 0;
+    if ((k < f->nindex) && (f->index[k].state != NULL)) {
+	snap = &f->index[k];
+	start = snap->frame;
+    }
+
+    f->exact = (snap != NULL) || (start == 0);
+    if (snap != NULL) {
+	if (codec2_restore_state(f->c2, snap->state, CODEC2_STATE_BYTES) != 0)
+	    return -1;
+    }
+    else {
+	codec2_destroy(f->c2);
+	f->c2 = codec2_create_decoder(f->mode);
+	if (f->c2 == NULL)
+	    return -1;
+	if (seed != NULL) {
+	    f->c2->xq_dec[0] = seed->xq[0];
+	    f->c2->xq_dec[1] = seed->xq[1];
+	}
+    }
+
+    if (fseek(f->fp, f->header + start*f->nbyte, SEEK_SET) != 0)
+	return -1;
+    for(k=start; k<f->pos; k++) {
+	if (fread(f->bits, 1, f->nbyte, f->fp) != (size_t)f->nbyte)
+	    return -1;
+	codec2_decode(f->c2, f->speech, f->bits);
+    }
+    f->dec_pos = f->pos;
+
+    return 0;
+}
+
+/* a snapshot is only an optimisation, running out of memory just means
+   seeks take longer; skipping an inexact decoder means the same */
+
+static void save_snapshot(struct CODEC2_FILE *f, C2F_RESET *r)
+{
+    if (f->exact && (r->state == NULL)) {
+	r->state = (unsigned char*)malloc(CODEC2_STATE_BYTES);
+	if (r->state != NULL)
+	    codec2_save_state(f->c2, r->state, CODEC2_STATE_BYTES);
+    }
+}
+
+int codec2_file_decode(struct CODEC2_FILE *f, short speech[], int nframes)
+{
+    int n;
+
+    assert(f != NULL);
+    assert(!f->writing);
+    if ((f->c2 == NULL) || ((f->dec_pos != f->pos) && (sync_decoder(f) != 0)))
+	return -1;
+    for(n=0; (n < nframes) && (f->pos < f->nframes); n++) {
+	if (fread(f->bits, 1, f->nbyte, f->fp) != (size_t)f->nbyte)
+	    break;
+	if (f->nindex && (f->pos % f->interval == 0) && (f->pos/f->interval < f->nindex))
+	    save_snapshot(f, &f->index[f->pos/f->interval]);
+	codec2_decode(f->c2, &speech[n*f->nsam], f->bits);
+	f->pos++;
+    }
+    f->dec_pos = f->pos;
+
+    return n;
+}
+
+int codec2_file_read(struct CODEC2_FILE *f, unsigned char bits[], int nframes)
+{
+    long n;
+
+    assert(f != NULL);
+    assert(!f->writing);
+    if (nframes > f->nframes - f->pos)
+	nframes = f->nframes - f->pos;
+    if ((nframes <= 0) || (fseek(f->fp, f->header + f->pos*f->nbyte, SEEK_SET) != 0))
+	return 0;
+    n = fread(bits, f->nbyte, nframes, f->fp);
+    f->pos += n;
+
+    /* the decoder hasn't seen these, the next decode has to resync */
+
+    f->dec_pos = -1;
+
+    return (int)n;
+}
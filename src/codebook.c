@@ -176,70 +176,80 @@ const struct lsp_codebook lsp_cb[] = {
     1,
     4,
     16,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp2.txt */
   {
     1,
     4,
     16,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp3.txt */
   {
     1,
     4,
     16,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp4.txt */
   {
     1,
     4,
     16,
-    codes3
+    codes3,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp5.txt */
   {
     1,
     4,
     16,
-    codes4
+    codes4,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp6.txt */
   {
     1,
     4,
     16,
-    codes5
+    codes5,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp7.txt */
   {
     1,
     4,
     16,
-    codes6
+    codes6,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp8.txt */
   {
     1,
     3,
     8,
-    codes7
+    codes7,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp9.txt */
   {
     1,
     3,
     8,
-    codes8
+    codes8,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp10.txt */
   {
     1,
     2,
     4,
-    codes9
+    codes9,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
@@ -364,70 +364,80 @@ const struct lsp_codebook lsp_cbd[] = {
     1,
     5,
     32,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp2.txt */
   {
     1,
     5,
     32,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp3.txt */
   {
     1,
     5,
     32,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp4.txt */
   {
     1,
     5,
     32,
-    codes3
+    codes3,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp5.txt */
   {
     1,
     5,
     32,
-    codes4
+    codes4,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp6.txt */
   {
     1,
     5,
     32,
-    codes5
+    codes5,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp7.txt */
   {
     1,
     5,
     32,
-    codes6
+    codes6,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp8.txt */
   {
     1,
     5,
     32,
-    codes7
+    codes7,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp9.txt */
   {
     1,
     5,
     32,
-    codes8
+    codes8,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/dlsp10.txt */
   {
     1,
     5,
     32,
-    codes9
+    codes9,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
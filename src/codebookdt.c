@@ -84,70 +84,80 @@ const struct lsp_codebook lsp_cbdt[] = {
     1,
     3,
     8,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt2.txt */
   {
     1,
     3,
     8,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt3.txt */
   {
     1,
     2,
     4,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt4.txt */
   {
     1,
     2,
     4,
-    codes3
+    codes3,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt5.txt */
   {
     1,
     2,
     4,
-    codes4
+    codes4,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt6.txt */
   {
     1,
     2,
     4,
-    codes5
+    codes5,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt7.txt */
   {
     1,
     1,
     2,
-    codes6
+    codes6,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt8.txt */
   {
     1,
     1,
     2,
-    codes7
+    codes7,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt9.txt */
   {
     1,
     1,
     2,
-    codes8
+    codes8,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspdt10.txt */
   {
     1,
     1,
     2,
-    codes9
+    codes9,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
@@ -273,7 +273,8 @@ const struct lsp_codebook ge_cb[] = {
     2,
     8,
     256,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
@@ -1559,21 +1559,24 @@ const struct lsp_codebook lsp_cbjvm[] = {
     10,
     9,
     512,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspjvm2.txt */
   {
     5,
     9,
     512,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspjvm3.txt */
   {
     5,
     9,
     512,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
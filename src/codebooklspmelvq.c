@@ -215,21 +215,24 @@ const struct lsp_codebook lspmelvq_cb[] = {
     6,
     6,
     64,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* /home/labworks/freetel-code-2792/codec2-dev/src/codebook/lspmelvq2.txt */
   {
     6,
     6,
     64,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* /home/labworks/freetel-code-2792/codec2-dev/src/codebook/lspmelvq3.txt */
   {
     6,
     6,
     64,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
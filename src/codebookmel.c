@@ -80,42 +80,48 @@ const struct lsp_codebook mel_cb[] = {
     1,
     3,
     8,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* /home/labworks/freetel-code-2792/codec2-dev/src/codebook/mel2.txt */
   {
     1,
     2,
     4,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* /home/labworks/freetel-code-2792/codec2-dev/src/codebook/mel3.txt */
   {
     1,
     4,
     16,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* /home/labworks/freetel-code-2792/codec2-dev/src/codebook/mel4.txt */
   {
     1,
     3,
     8,
-    codes3
+    codes3,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* /home/labworks/freetel-code-2792/codec2-dev/src/codebook/mel5.txt */
   {
     1,
     3,
     8,
-    codes4
+    codes4,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* /home/labworks/freetel-code-2792/codec2-dev/src/codebook/mel6.txt */
   {
     1,
     2,
     4,
-    codes5
+    codes5,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
@@ -70,28 +70,32 @@ const struct lsp_codebook lsp_cbres[] = {
     1,
     3,
     8,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* ../src/codebook/lspres_bw1.txt */
   {
     1,
     2,
     4,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* ../src/codebook/lsp3.txt */
   {
     1,
     4,
     16,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* ../src/codebook/lsp4.txt */
   {
     1,
     4,
     16,
-    codes3
+    codes3,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
@@ -4189,35 +4189,40 @@ const struct lsp_codebook lsp_cbvq[] = {
     1,
     4,
     16,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp2.txt */
   {
     1,
     4,
     16,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp3.txt */
   {
     1,
     4,
     16,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lsp4.txt */
   {
     1,
     4,
     16,
-    codes3
+    codes3,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* ../unittest/lsp45678910.txt */
   {
     6,
     12,
     4096,
-    codes4
+    codes4,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
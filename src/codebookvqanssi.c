@@ -538,28 +538,32 @@ const struct lsp_codebook lsp_cbvqanssi[] = {
     10,
     8,
     256,
-    codes0
+    codes0,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspvqanssi2.txt */
   {
     10,
     7,
     128,
-    codes1
+    codes1,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspvqanssi3.txt */
   {
     10,
     6,
     64,
-    codes2
+    codes2,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
   /* codebook/lspvqanssi4.txt */
   {
     10,
     6,
     64,
-    codes3
+    codes3,
+    CB_LAYOUT_ROWS, 0, 0, 0, 0
   },
-  { 0, 0, 0, 0 }
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
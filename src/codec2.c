@@ -31,6 +31,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "defines.h"
 #include "sine.h"
@@ -38,6 +42,7 @@
 #include "dump.h"
 #include "lpc.h"
 #include "quantise.h"
+#include "vq.h"
 #include "phase.h"
 #include "interp.h"
 #include "postfilter.h"
@@ -47,283 +52,1956 @@
 #include "machdep.h"
 #include "bpf.h"
 #include "bpfb.h"
+#include "bitpack.h"
+
+/*---------------------------------------------------------------------------*\
+
+                             FUNCTION HEADERS
+
+\*---------------------------------------------------------------------------*/
+
+void analyse_one_frame(struct CODEC2 *c2, MODEL *model, const struct CODEC2_PCM *speech, int pos);
+void synthesise_one_frame(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos, MODEL *model, COMP Aw[]);
+void codec2_encode_3200(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+void codec2_decode_3200(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits);
+void codec2_encode_2400(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+void codec2_decode_2400(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits);
+void codec2_encode_1600(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+void codec2_decode_1600(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits);
+void codec2_encode_1400(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+void codec2_decode_1400(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits);
+void codec2_encode_1300(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+void codec2_decode_1300(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits, float ber_est);
+void codec2_encode_1200(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+void codec2_decode_1200(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits);
+void codec2_encode_700(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+void codec2_decode_700(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits);
+void codec2_encode_700b(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+void codec2_decode_700b(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits);
+static int  ear_protection(float in_out[], int n);
+static void write_speech(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos, float Sn_[], int n);
+static void clear_synthesis(struct CODEC2 *c2);
+static void read_speech(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos);
+static void pcm_init(struct CODEC2_PCM *pcm, short speech[], int n);
+static void soft_select_kernels(int features);
+static short *pcm_span(const struct CODEC2_PCM *pcm, int pos, int *n);
+static const short *pcm_frame(const struct CODEC2_PCM *pcm, int n, short buf[]);
+static void encode_bpf(struct CODEC2 *c2, const float h[], const struct CODEC2_PCM *speech, short bpf_speech[]);
+static void encode_analyse(struct CODEC2 *c2, struct CODEC2_ANALYSIS *analysis, const struct CODEC2_PCM *speech);
+static void encode_quantise(struct CODEC2 *c2, unsigned char *bits, const struct CODEC2_ANALYSIS *analysis);
+static float analysis_lsps(struct CODEC2 *c2, const struct CODEC2_ANALYSIS *analysis, int h,
+                           float lsps[], float ak[], int order);
+static void decode_pcm(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char *bits, float ber_est);
+static void lsps_to_amplitudes(struct CODEC2 *c2, float lsps[], float ak[], int order,
+                              MODEL *model, float e, COMP Aw[]);
+static void decode_one_frame(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos, float lsps[],
+                             float ak[], int order, MODEL *model, float e, COMP Aw[]);
+static struct CODEC2 *create_in_place(int mode, void *mem, int encoder, int node);
+static struct CODEC2 *create(int mode, int encoder);
+static struct CODEC2_TEMPLATE *codec2_template_get(int encoder, int node);
+static void codec2_template_put(struct CODEC2_TEMPLATE *t);
+static void stats_frame_begin(struct CODEC2 *c2, unsigned int *start, unsigned long long *stages);
+static void stats_frame_end(struct CODEC2 *c2, unsigned int start, unsigned long long stages,
+                            unsigned long long *other_cycles, unsigned long *frames);
+#ifdef CODEC2_SCRATCH_ARENA
+static struct CODEC2_SCRATCH *frame_scratch(struct CODEC2 *c2);
+#endif
+
+/* Opt-in per instance counters, see codec2_enable_stats().  A single
+   predictable branch per stage when they are off. */
+
+#define STATS_SAMPLE(c2, t) \
+    do { if ((c2)->stats_enabled) (t) = machdep_profile_sample(); } while(0)
+#define STATS_ACCUM(c2, counter, t) \
+    do { \
+	if ((c2)->stats_enabled) { \
+	    unsigned int now_ = machdep_profile_sample(); \
+	    (c2)->stats.counter += now_ - (t); \
+	    (t) = now_; \
+	} \
+    } while(0)
+
+/* Flush to zero for the duration of a call, see
+   codec2_set_flush_denormals() */
+
+#define DENORMALS_OFF(c2, fp) \
+    do { if ((c2)->flush_denormals) (fp) = machdep_denormals_off(); } while(0)
+#define DENORMALS_RESTORE(c2, fp) \
+    do { if ((c2)->flush_denormals) machdep_fp_restore(fp); } while(0)
+
+/* Built with CODEC2_FIXED_DECODER the decoder converts LSPs to LPCs in
+   fixed point, see fixed_dsp.c */
+
+#ifdef CODEC2_FIXED_DECODER
+#define decoder_lsp_to_lpc lsp_to_lpc_fixed
+#else
+#define decoder_lsp_to_lpc lsp_to_lpc
+#endif
+
+/* The decoders' model[] and Aw[], the encoders' analysis, and the 700
+   and 700B encoders' band pass filtered speech, are on the stack
+   unless the build keeps them in a scratch arena, see
+   codec2_set_scratch() */
+
+#ifdef CODEC2_SCRATCH_ARENA
+#define DECODE_SCRATCH(c2, nmodel) \
+    MODEL  *model = frame_scratch(c2)->u.dec.model; \
+    COMP   *Aw = (c2)->scratch->u.dec.Aw
+#define ENCODE_SCRATCH(c2) \
+    struct CODEC2_ANALYSIS *analysis = &frame_scratch(c2)->u.enc.analysis
+#define ENCODE_BPF_SCRATCH(c2) \
+    short  *bpf_speech = frame_scratch(c2)->u.enc.bpf_speech
+#else
+#define DECODE_SCRATCH(c2, nmodel) \
+    MODEL   model[nmodel]; \
+    COMP    Aw[FFT_ENC]
+#define ENCODE_SCRATCH(c2) \
+    struct CODEC2_ANALYSIS analysis[1]
+#define ENCODE_BPF_SCRATCH(c2) \
+    short   bpf_speech[4*N]
+#endif
+
+/*---------------------------------------------------------------------------*\
+
+                                GLOBALS
+
+\*---------------------------------------------------------------------------*/
+
+/* The shared templates, created by the first codec2_create() and kept
+   until codec2_release_templates() or process exit, so creating and
+   destroying instances never rebuilds them, one per replica
+   (templates_[0] for codec2_create()).  template_lock guards templates_
+   and their reference counts, and globals_ready, codec states
+   themselves are never locked. */
+
+static struct CODEC2_TEMPLATE *templates_[CODEC2_MAX_NODES];
+static int globals_ready = 0;
+
+#if defined(__GNUC__) || defined(__clang__)
+static volatile int template_lock = 0;
+#define TEMPLATE_LOCK()   while (__sync_lock_test_and_set(&template_lock, 1)) ;
+#define TEMPLATE_UNLOCK() __sync_lock_release(&template_lock);
+#elif defined(_MSC_VER)
+static volatile long template_lock = 0;
+#define TEMPLATE_LOCK()   while (_InterlockedExchange(&template_lock, 1)) ;
+#define TEMPLATE_UNLOCK() _InterlockedExchange(&template_lock, 0);
+#else
+#error "template_lock needs an atomic exchange for this compiler"
+#endif
+
+/*---------------------------------------------------------------------------*\
+
+                                FUNCTIONS
+
+\*---------------------------------------------------------------------------*/
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_mode_enabled
+  DATE CREATED: Oct 2026
+
+  Non-zero if mode was built into the library, see CODEC2_MODES in
+  CMakeLists.txt.  codec2_create() returns NULL for the others.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_mode_enabled(int mode)
+{
+    return CODEC2_MODE_ACTIVE(CODEC2_MODE_3200, mode) ||
+	   CODEC2_MODE_ACTIVE(CODEC2_MODE_2400, mode) ||
+	   CODEC2_MODE_ACTIVE(CODEC2_MODE_1600, mode) ||
+	   CODEC2_MODE_ACTIVE(CODEC2_MODE_1400, mode) ||
+	   CODEC2_MODE_ACTIVE(CODEC2_MODE_1300, mode) ||
+	   CODEC2_MODE_ACTIVE(CODEC2_MODE_1200, mode) ||
+	   CODEC2_MODE_ACTIVE(CODEC2_MODE_700, mode) ||
+	   CODEC2_MODE_ACTIVE(CODEC2_MODE_700B, mode);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_get_state_size
+  DATE CREATED: Oct 2026
+
+  Returns the number of bytes of memory required by
+  codec2_create_in_place() for an instance of the given mode.  This
+  covers all per instance states; the read only states shared by all
+  instances are allocated once, on first use.
+
+\*---------------------------------------------------------------------------*/
+
+/* Callers' blocks are aligned to STATE_ALIGN.  The instance goes on
+   the first cache line boundary in the block, and each region after
+   it starts a line of its own. */
+
+#define STATE_ALIGN      16
+#define STATE_ROUND(x)   (((x) + CODEC2_LINE - 1) & ~(size_t)(CODEC2_LINE - 1))
+
+/* only encoders keep NLP states, and only the 700 and 700B encoders
+   band pass filter */
+
+#define STATE_BPF(mode, encoder) \
+    ((encoder) && (((mode) == CODEC2_MODE_700) || ((mode) == CODEC2_MODE_700B)))
+
+#define STATE_ENC   (STATE_ROUND(nlp_state_size()) + STATE_ROUND(sizeof(float)*2*M) + \
+		     STATE_ROUND(sizeof(COMP)*FFT_ENC) + STATE_ROUND(sizeof(SW_POWER)) + \
+		     STATE_ROUND(sizeof(float)*(M+LPC_AC_LAGS)))
+
+static size_t state_size(int mode, int encoder)
+{
+    return (CODEC2_LINE - STATE_ALIGN) + STATE_ROUND(sizeof(struct CODEC2)) +
+	   (encoder ? STATE_ENC : 0) +
+	   (STATE_BPF(mode, encoder) ? STATE_ROUND(sizeof(float)*(BPF_N+4*N)) : 0);
+}
+
+size_t codec2_get_state_size(int mode)
+{
+    return state_size(mode, 1);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_get_decoder_state_size
+  DATE CREATED: Oct 2026
+
+  As codec2_get_state_size(), for codec2_create_decoder_in_place().
+
+\*---------------------------------------------------------------------------*/
+
+size_t codec2_get_decoder_state_size(int mode)
+{
+    return state_size(mode, 0);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_create_in_place
+  DATE CREATED: Oct 2026
+
+  As per codec2_create(), but places all of the instance states in the
+  caller supplied block mem[] of at least codec2_get_state_size(mode)
+  bytes, aligned to at least 16 bytes.  The instance starts at the
+  first cache line boundary in mem[].  No memory is allocated for the
+  instance, so codec2_destroy() only releases the shared states and
+  the caller owns mem[] afterwards.  Returns NULL on failure.
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2 * codec2_create_in_place(int mode, void *mem)
+{
+    return create_in_place(mode, mem, 1, 0);
+}
+
+/*---------------------------------------------------------------------------*
+  FUNCTION....: codec2_create_in_place_node
+  DATE CREATED: Oct 2026
+
+  As codec2_create_in_place(), but the instance reads replica node,
+  0 to CODEC2_MAX_NODES-1, of the shared read only states (FFT configs,
+  windows, NLP tables) rather than the copy every other instance uses.
+  Replica 0 is that copy.  A replica is built by the first instance
+  created on it, in memory allocated by the calling thread, so on a
+  NUMA machine whose threads create their instances in memory of their
+  own node, with node numbering the replicas, every instance reads node
+  local tables.  Returns NULL on failure or if node is out of range.
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2 * codec2_create_in_place_node(int mode, void *mem, int node)
+{
+    if ((node < 0) || (node >= CODEC2_MAX_NODES))
+	return NULL;
+    return create_in_place(mode, mem, 1, node);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_create_decoder_in_place
+  DATE CREATED: Oct 2026
+
+  As codec2_create_in_place(), for an instance that only decodes, in
+  mem[] of at least codec2_get_decoder_state_size(mode) bytes.  See
+  codec2_create_decoder().
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2 * codec2_create_decoder_in_place(int mode, void *mem)
+{
+    return create_in_place(mode, mem, 0, 0);
+}
+
+static struct CODEC2 *create_in_place(int mode, void *mem, int encoder, int node)
+{
+    struct CODEC2 *c2;
+    unsigned char *p;
+    int            i,l;
+
+    assert(mem != NULL);
+    assert(((size_t)mem & (STATE_ALIGN-1)) == 0);
+    assert(
+	   (mode == CODEC2_MODE_3200) ||
+	   (mode == CODEC2_MODE_2400) ||
+	   (mode == CODEC2_MODE_1600) ||
+	   (mode == CODEC2_MODE_1400) ||
+	   (mode == CODEC2_MODE_1300) ||
+	   (mode == CODEC2_MODE_1200) ||
+	   (mode == CODEC2_MODE_700) ||
+	   (mode == CODEC2_MODE_700B)
+	   );
+    if (!codec2_mode_enabled(mode))
+	return NULL;
+
+    /* carve up mem[]: struct, then for encoders the NLP states, input
+       ring, analysis DFT and its power, LPC window and the 700/700B band
+       pass filter
+       buffer */
+
+    p = (unsigned char*)STATE_ROUND((size_t)mem);
+    c2 = (struct CODEC2*)p;
+    p += STATE_ROUND(sizeof(struct CODEC2));
+
+    c2->tmpl = codec2_template_get(encoder, node);
+    if (c2->tmpl == NULL)
+	return NULL;
+    c2->nlp = NULL;
+    c2->Sn_buf = NULL;
+    c2->Sw_enc = NULL;
+    c2->Sw_pow = NULL;
+    c2->lpc_Wr = NULL;
+    if (encoder) {
+	c2->nlp = nlp_create_in_place(c2->tmpl->enc->nlp, p);
+	p += STATE_ROUND(nlp_state_size());
+	c2->Sn_buf = (float*)p;
+	for(i=0; i<2*M; i++)
+	    c2->Sn_buf[i] = 1.0;
+	p += STATE_ROUND(sizeof(float)*2*M);
+	c2->Sw_enc = (COMP*)p;
+	p += STATE_ROUND(sizeof(COMP)*FFT_ENC);
+	c2->Sw_pow = (SW_POWER*)p;
+	p += STATE_ROUND(sizeof(SW_POWER));
+	c2->lpc_Wr = (float*)p;
+	p += STATE_ROUND(sizeof(float)*(M+LPC_AC_LAGS));
+    }
+    c2->bpf_buf = NULL;
+    if (STATE_BPF(mode, encoder)) {
+	c2->bpf_buf = (float*)p;
+	for(i=0; i<BPF_N+4*N; i++)
+	    c2->bpf_buf[i] = 0.0;
+    }
+    c2->bank_Sw = c2->bank_Fw = NULL;
+    c2->float_in = NULL;
+    c2->float_out = NULL;
+    c2->muted = 0;
+    c2->mix_Sw = NULL;
+    c2->synth_up = NULL;
+    c2->params_out = NULL;
+    c2->own_mem = NULL;
+
+    c2->mode = mode;
+    c2->Sn_pos = 0;
+    c2->Sn = c2->Sn_buf;
+    c2->hpf_states[0] = c2->hpf_states[1] = 0.0;
+    for(i=0; i<2*N; i++)
+	c2->Sn_[i] = 0;
+#ifdef CODEC2_FIXED_DECODER
+    for(i=0; i<2*N; i++)
+	c2->Sn_fx[i] = 0;
+    c2->Pn_q15 = c2->tmpl->Pn_q15;
+#endif
+
+    c2->fft_fwd_cfg = c2->tmpl->fft_fwd_cfg;
+    c2->fftr_fwd_cfg = c2->tmpl->fftr_fwd_cfg;
+    c2->fftr_inv_cfg = c2->tmpl->fftr_inv_cfg;
+    c2->w = encoder ? c2->tmpl->enc->w : NULL;
+    c2->W = encoder ? c2->tmpl->enc->W : NULL;
+    c2->voicing_tab = encoder ? &c2->tmpl->enc->voicing_tab : NULL;
+    c2->Pn = c2->tmpl->Pn;
+    c2->prev_Wo_enc = 0.0;
+    c2->bg_est = 0.0;
+    c2->ex_phase = 0.0;
+
+    for(l=1; l<=MAX_AMP; l++)
+	c2->prev_model_dec.A[l] = 0.0;
+    c2->prev_model_dec.Wo = TWO_PI/P_MAX;
+    c2->prev_model_dec.L = PI/c2->prev_model_dec.Wo;
+    c2->prev_model_dec.voiced = 0;
+
+    for(i=0; i<LPC_ORD; i++) {
+      c2->prev_lsps_dec[i] = i*PI/(LPC_ORD+1);
+    }
+    c2->prev_e_dec = 1;
+    c2->rand_state = 1;
+
+    if (mode == CODEC2_MODE_700B)
+        c2->gray = 0;             // natural binary better for trellis decoding (hopefully added later)
+    else
+        c2->gray = 1;
+
+    c2->lpc_pf = 1; c2->bass_boost = 1; c2->beta = LPCPF_BETA; c2->gamma = LPCPF_GAMMA;
+
+    c2->xq_enc[0] = c2->xq_enc[1] = 0.0;
+    c2->xq_dec[0] = c2->xq_dec[1] = 0.0;
+
+    c2->smoothing = 0;
+    c2->vq_search = CODEC2_VQ_SEARCH_FULL;
+    c2->pitch_refine = CODEC2_PITCH_REFINE_FULL;
+    c2->lag_window = 0;
+    c2->dtx = 0;
+    c2->dtx_level = 0.0;
+    c2->dtx_silent = 0;
+    c2->stats_enabled = 0;
+    c2->flush_denormals = 0;
+    c2->deadline = 0;
+    memset(&c2->stats, 0, sizeof(c2->stats));
+
+    c2->softdec = NULL;
+    codec2_stream_reset(c2);
+
+    synth_ws_init(&c2->synth_ws);
+    aks_to_M2_ws_init(&c2->aks_ws);
+    lpc_env_cache_init(&c2->env_cache);
+#ifdef CODEC2_SCRATCH_ARENA
+    c2->scratch = NULL;
+    c2->own_scratch = NULL;
+#endif
+
+    return c2;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_create
+  AUTHOR......: David Rowe
+  DATE CREATED: 21/8/2010
+
+  Create and initialise an instance of the codec.  Returns a pointer
+  to the codec states or NULL on failure.  One set of states is
+  sufficient for a full duuplex codec (i.e. an encoder and decoder).
+  You don't need separate states for encoders and decoders.  See
+  c2enc.c and c2dec.c for examples.
+
+  All of the instance states are held in one heap block, see
+  codec2_create_in_place() to supply the memory yourself.
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2 * codec2_create(int mode)
+{
+    return create(mode, 1);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_create_decoder
+  DATE CREATED: Oct 2026
+
+  As codec2_create(), for an instance that is only ever used to
+  decode.  It has no pitch estimator or band pass filter states, and
+  doesn't need the analysis window and NLP tables shared by encoders,
+  which aren't built while no encoder exists.  Calling an encode
+  function on it asserts.
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2 * codec2_create_decoder(int mode)
+{
+    return create(mode, 0);
+}
+
+static struct CODEC2 *create(int mode, int encoder)
+{
+    struct CODEC2 *c2;
+    void          *mem;
+
+    if (!codec2_mode_enabled(mode))
+	return NULL;
+
+    /* malloc() alignment is sufficient for STATE_ALIGN on the
+       platforms we support */
+
+    mem = malloc(state_size(mode, encoder));
+    if (mem == NULL)
+	return NULL;
+
+    c2 = create_in_place(mode, mem, encoder, 0);
+    if (c2 == NULL) {
+	free(mem);
+	return NULL;
+    }
+    c2->own_mem = mem;
+
+#ifdef CODEC2_SCRATCH_ARENA
+    /* a private arena, so callers that never heard of
+       codec2_set_scratch() still work */
+
+    mem = malloc(codec2_scratch_size(mode));
+    if (mem == NULL) {
+	codec2_destroy(c2);
+	return NULL;
+    }
+    codec2_set_scratch(c2, mem);
+    c2->own_scratch = mem;
+#endif
+
+    return c2;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_destroy
+  AUTHOR......: David Rowe
+  DATE CREATED: 21/8/2010
+
+  Destroy an instance of the codec.  For instances created with
+  codec2_create_in_place() the memory block is left to the caller.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_destroy(struct CODEC2 *c2)
+{
+    assert(c2 != NULL);
+    if (c2->nlp != NULL)
+	nlp_destroy(c2->nlp);
+    synth_up_destroy(c2->synth_up);
+    codec2_template_put(c2->tmpl);
+#ifdef CODEC2_SCRATCH_ARENA
+    free(c2->own_scratch);
+#endif
+    free(c2->own_mem);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_scratch_size
+  DATE CREATED: Oct 2026
+
+  Bytes of scratch arena codec2_set_scratch() needs for an instance of
+  the given mode.  Zero unless the library was built with
+  CODEC2_SCRATCH_ARENA, then the arena holds the per frame buffers
+  that would otherwise be on the encode and decode stacks.
+
+\*---------------------------------------------------------------------------*/
+
+size_t codec2_scratch_size(int mode)
+{
+    (void)mode;
+#ifdef CODEC2_SCRATCH_ARENA
+    return STATE_ROUND(sizeof(struct CODEC2_SCRATCH));
+#else
+    return 0;
+#endif
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_set_scratch
+  DATE CREATED: Oct 2026
+
+  Gives the instance a scratch arena of at least
+  codec2_scratch_size(mode) bytes, aligned to at least 16 bytes.  The
+  arena only holds temporaries during a codec2_encode() or
+  codec2_decode() call, so instances that are never used at the same
+  time, for example all those run by one task, can share it.  The
+  caller owns scratch[].  codec2_create() supplies a private arena;
+  instances from codec2_create_in_place() need this call before their
+  first encode or decode.  Does nothing in builds without
+  CODEC2_SCRATCH_ARENA.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_set_scratch(struct CODEC2 *c2, void *scratch)
+{
+    assert(c2 != NULL);
+    assert(((size_t)scratch & (STATE_ALIGN-1)) == 0);
+#ifdef CODEC2_SCRATCH_ARENA
+    if ((c2->own_scratch != NULL) && (scratch != c2->own_scratch)) {
+	free(c2->own_scratch);
+	c2->own_scratch = NULL;
+    }
+    c2->scratch = (struct CODEC2_SCRATCH*)scratch;
+    c2->aks_ws.pf = (scratch != NULL) ? &c2->scratch->u.dec.pf : NULL;
+#else
+    (void)c2; (void)scratch;
+#endif
+}
+
+#ifdef CODEC2_SCRATCH_ARENA
+static struct CODEC2_SCRATCH *frame_scratch(struct CODEC2 *c2)
+{
+    assert(c2 != NULL);
+    assert(c2->scratch != NULL);           /* see codec2_set_scratch() */
+    return c2->scratch;
+}
+#endif
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_globals_init
+  DATE CREATED: Oct 2026
+
+  Process wide tables and the kernel variants for this CPU.  Run once,
+  by the first codec2_create(), with template_lock held; unlike the
+  templates they outlive codec2_release_templates() too.
+
+\*---------------------------------------------------------------------------*/
+
+static void codec2_globals_init(void)
+{
+    int features;
+
+    if (globals_ready)
+	return;
+    quantise_init();
+    features = machdep_cpu_features();
+    kiss_fft_select_kernels(features);
+    nlp_select_kernels(features);
+    synthesise_select_kernels(features);
+    bpf_select_kernels(features);
+    lpc_select_kernels(features);
+    soft_select_kernels(features);
+#ifdef CODEC2_FIXED_DECODER
+    fixed_dsp_init();
+#endif
+    globals_ready = 1;
+}
+
+/* The encoder only part of the template, or NULL on failure */
+
+static struct CODEC2_ENC_TEMPLATE *enc_template_create(kiss_fft_cfg fft_fwd_cfg)
+{
+    struct CODEC2_ENC_TEMPLATE *e;
+
+    e = (struct CODEC2_ENC_TEMPLATE*)malloc(sizeof(struct CODEC2_ENC_TEMPLATE));
+    if (e == NULL)
+	return NULL;
+    e->nlp = nlp_template_create(M);
+    if (e->nlp == NULL) {
+	free(e);
+	return NULL;
+    }
+    make_analysis_window(fft_fwd_cfg, e->w, e->W);
+    make_voicing_table(&e->voicing_tab, e->W);
+
+    return e;
+}
+
+static void template_free(struct CODEC2_TEMPLATE *t)
+{
+    KISS_FFT_FREE(t->fft_fwd_cfg);
+    KISS_FFT_FREE(t->fftr_fwd_cfg);
+    KISS_FFT_FREE(t->fftr_inv_cfg);
+    if (t->enc != NULL) {
+	nlp_template_destroy(t->enc->nlp);
+	free(t->enc);
+    }
+    free(t);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_template_get
+  DATE CREATED: Oct 2026
+
+  Returns replica node of the shared read only states (FFT configs,
+  analysis and synthesis windows, NLP window) with its reference count
+  incremented.
+  The template is built on first use, so only the first codec2_create()
+  pays for the trig and FFT set up, and its encoder part on the first
+  use by an encoder, so decoder only processes never pay for the
+  analysis window and NLP tables.  Returns NULL on failure.
+
+\*---------------------------------------------------------------------------*/
+
+static struct CODEC2_TEMPLATE *codec2_template_get(int encoder, int node)
+{
+    struct CODEC2_TEMPLATE *t;
+
+    TEMPLATE_LOCK();
+
+    codec2_globals_init();
+
+    if (templates_[node] == NULL) {
+	t = (struct CODEC2_TEMPLATE*)malloc(sizeof(struct CODEC2_TEMPLATE));
+	if (t != NULL) {
+	    t->refs = 0;
+	    t->node = node;
+	    t->enc = NULL;
+	    t->fft_fwd_cfg = kiss_fft_alloc(FFT_ENC, 0, NULL, NULL);
+	    t->fftr_fwd_cfg = kiss_fftr_alloc(FFT_ENC, 0, NULL, NULL);
+	    t->fftr_inv_cfg = kiss_fftr_alloc(FFT_DEC, 1, NULL, NULL);
+	    if ((t->fft_fwd_cfg == NULL) || (t->fftr_fwd_cfg == NULL) ||
+		(t->fftr_inv_cfg == NULL)) {
+		template_free(t);
+		t = NULL;
+	    }
+	    else {
+		make_synthesis_window(t->Pn);
+#ifdef CODEC2_FIXED_DECODER
+		fixed_synthesis_window(t->Pn_q15, t->Pn);
+#endif
+	    }
+	}
+	templates_[node] = t;
+    }
+
+    t = templates_[node];
+    if ((t != NULL) && encoder && (t->enc == NULL)) {
+	t->enc = enc_template_create(t->fft_fwd_cfg);
+	if (t->enc == NULL) {
+	    if (t->refs == 0) {
+		template_free(t);
+		templates_[node] = NULL;
+	    }
+	    t = NULL;
+	}
+    }
+    if (t != NULL)
+	t->refs++;
+
+    TEMPLATE_UNLOCK();
+
+    return t;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_template_put
+  DATE CREATED: Oct 2026
+
+  Releases a reference to the shared template.  The template is kept
+  when the last instance is destroyed, see codec2_release_templates().
+
+\*---------------------------------------------------------------------------*/
+
+static void codec2_template_put(struct CODEC2_TEMPLATE *t)
+{
+    assert(t != NULL);
+
+    TEMPLATE_LOCK();
+
+    assert(t == templates_[t->node]);
+    assert(t->refs > 0);
+    t->refs--;
+
+    TEMPLATE_UNLOCK();
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_release_templates
+  DATE CREATED: Oct 2026
+
+  Frees the shared templates no instance is using, e.g. before a
+  library is unloaded or for leak checkers.  The next codec2_create()
+  builds them again.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_release_templates(void)
+{
+    int node;
+
+    TEMPLATE_LOCK();
+
+    for(node=0; node<CODEC2_MAX_NODES; node++) {
+	if ((templates_[node] != NULL) && (templates_[node]->refs == 0)) {
+	    template_free(templates_[node]);
+	    templates_[node] = NULL;
+	}
+    }
+
+    TEMPLATE_UNLOCK();
+}
+
+/*---------------------------------------------------------------------------*\
+
+  Frame layouts, the fields of each mode's frame in the order they are
+  sent, indexed by mode.  The encoders and decoders list their
+  parameters in this order and frame_pack() / frame_unpack() do the
+  bits.  The LSP widths are those of the codebooks each mode quantises
+  with (lsp_bits(), lspd_bits() etc.), frame_pack() asserts that every
+  index fits.
+
+\*---------------------------------------------------------------------------*/
+
+#define FG(w) { w, FRAME_GRAY }
+#define FO(w) { w, FRAME_GRAY_OPT }
+
+static const FRAME_LAYOUT frame_layouts[] = {
+    /* 3200: v v Wo E, 10 scalar LSP differences */
+    { 14, 64, -1, { FG(1), FG(1), FG(WO_BITS), FG(E_BITS),
+		    FG(5), FG(5), FG(5), FG(5), FG(5), FG(5), FG(5), FG(5), FG(5), FG(5) } },
+    /* 2400: v v WoE, 10 scalar LSPs, 2 spare */
+    { 14, 48, -1, { FG(1), FG(1), FG(WO_E_BITS),
+		    FG(4), FG(4), FG(4), FG(4), FG(4), FG(4), FG(4), FG(3), FG(3), FG(2),
+		    FG(2) } },
+    /* 1600: v v Wo E v v Wo E, 10 scalar LSPs */
+    { 18, 64, 5,  { FG(1), FG(1), FG(WO_BITS), FG(E_BITS), FG(1), FG(1), FG(WO_BITS), FG(E_BITS),
+		    FG(4), FG(4), FG(4), FG(4), FG(4), FG(4), FG(4), FG(3), FG(3), FG(2) } },
+    /* 1400: v v WoE v v WoE, 10 scalar LSPs */
+    { 16, 56, 3,  { FG(1), FG(1), FG(WO_E_BITS), FG(1), FG(1), FG(WO_E_BITS),
+		    FG(4), FG(4), FG(4), FG(4), FG(4), FG(4), FG(4), FG(3), FG(3), FG(2) } },
+    /* 1300: v v v v Wo E, 10 scalar LSPs */
+    { 16, 52, 2,  { FO(1), FO(1), FO(1), FO(1), FO(WO_BITS), FO(E_BITS),
+		    FO(4), FO(4), FO(4), FO(4), FO(4), FO(4), FO(4), FO(3), FO(3), FO(2) } },
+    /* 1200: v v WoE v v WoE, 3 predictive VQ stages, 1 spare */
+    { 10, 48, -1, { FG(1), FG(1), FG(WO_E_BITS), FG(1), FG(1), FG(WO_E_BITS),
+		    FG(9), FG(9), FG(9), FG(1) } },
+    /* 700: v Wo E, 6 scalar mels, 2 spare */
+    { 10, 28, 9,  { FG(1), FO(5), FO(3), FO(3), FO(2), FO(4), FO(3), FO(3), FO(2), FO(2) } },
+    /* 700B: v Wo E, 3 mel VQ stages, 1 spare */
+    { 7,  28, 6,  { FG(1), FO(5), FO(3), FO(6), FO(6), FO(6), FO(1) } },
+};
+
+#undef FG
+#undef FO
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_bits_per_frame
+  AUTHOR......: David Rowe
+  DATE CREATED: Nov 14 2011
+
+  Returns the number of bits per frame.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_bits_per_frame(struct CODEC2 *c2) {
+    if ((CODEC2_MODE_OF(c2) < 0) || (CODEC2_MODE_OF(c2) >= (int)(sizeof(frame_layouts)/sizeof(frame_layouts[0]))))
+	return 0; /* shouldn't get here */
+    return frame_layouts[CODEC2_MODE_OF(c2)].nbit;
+}
+
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_samples_per_frame
+  AUTHOR......: David Rowe
+  DATE CREATED: Nov 14 2011
+
+  Returns the number of speech samples per frame.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_samples_per_frame(struct CODEC2 *c2) {
+    if (CODEC2_MODE_OF(c2) == CODEC2_MODE_3200)
+	return 160;
+    if (CODEC2_MODE_OF(c2) == CODEC2_MODE_2400)
+	return 160;
+    if  (CODEC2_MODE_OF(c2) == CODEC2_MODE_1600)
+	return 320;
+    if  (CODEC2_MODE_OF(c2) == CODEC2_MODE_1400)
+	return 320;
+    if  (CODEC2_MODE_OF(c2) == CODEC2_MODE_1300)
+	return 320;
+    if  (CODEC2_MODE_OF(c2) == CODEC2_MODE_1200)
+	return 320;
+    if  (CODEC2_MODE_OF(c2) == CODEC2_MODE_700)
+	return 320;
+    if  (CODEC2_MODE_OF(c2) == CODEC2_MODE_700B)
+	return 320;
+
+    return 0; /* shouldnt get here */
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_set_output_rate
+  DATE CREATED: Oct 2026
+
+  Has the decoder synthesise straight to rate Hz, a multiple of 8000
+  up to 48000, so 16 and 48 kHz playback needs no resampler after it.
+  The synthesis DFT is made rate/8000 times longer with the harmonics
+  left at their frequencies, so there is nothing above 4 kHz, and the
+  window and overlap-add are stretched to match.  Each frame is then
+  codec2_output_samples_per_frame() samples, for every decode call.
+  Mixes (codec2_mix_read()) stay at 8000 Hz.
+
+  The synthesis is cleared, the next frame fades in.  Allocates the
+  longer DFT, including for instances created in place.  Returns 0, or
+  -1 for a rate that isn't supported, in CODEC2_FIXED_DECODER builds
+  anything but 8000, or if out of memory.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_set_output_rate(struct CODEC2 *c2, int rate)
+{
+    SYNTH_UP *up;
+    int       k;
+
+    assert(c2 != NULL);
+
+    k = rate/FS;
+    if ((rate != k*FS) || (k < 1) || (k > SYNTH_UP_MAX))
+	return -1;
+#ifdef CODEC2_FIXED_DECODER
+    if (k != 1)
+	return -1;
+#endif
+    up = NULL;
+    if (k > 1) {
+	up = synth_up_create(k);
+	if (up == NULL)
+	    return -1;
+    }
+    synth_up_destroy(c2->synth_up);
+    c2->synth_up = up;
+    clear_synthesis(c2);
+
+    return 0;
+}
+
+/* Samples per frame at the output rate, codec2_samples_per_frame() at 8000 Hz */
+
+int codec2_output_samples_per_frame(struct CODEC2 *c2) {
+    assert(c2 != NULL);
+    if (c2->synth_up != NULL)
+	return c2->synth_up->k*codec2_samples_per_frame(c2);
+    return codec2_samples_per_frame(c2);
+}
+
+void codec2_encode(struct CODEC2 *c2, unsigned char *bits, short speech[])
+{
+    struct CODEC2_PCM pcm;
+
+    assert(c2 != NULL);
+    pcm_init(&pcm, speech, codec2_samples_per_frame(c2));
+    codec2_encode_pcm(c2, bits, &pcm);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_encode_pcm
+  DATE CREATED: Oct 2026
+
+  codec2_encode() of speech in place in the caller's buffer, e.g. a
+  ring buffer, see struct CODEC2_PCM.  The samples go straight into
+  the analysis window without being gathered into a frame first.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_encode_pcm(struct CODEC2 *c2, unsigned char *bits, const struct CODEC2_PCM *speech)
+{
+    unsigned int       fp = 0;
+    unsigned int       start = 0;
+    unsigned long long stages = 0;
+    ENCODE_SCRATCH(c2);
+
+    assert(c2 != NULL);
+    assert(
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_3200) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_2400) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_1600) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_1400) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_1300) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_1200) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_700)  ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_700B)
+	   );
+
+    DENORMALS_OFF(c2, fp);
+    if (c2->stats_enabled)
+	stats_frame_begin(c2, &start, &stages);
+
+    encode_analyse(c2, analysis, speech);
+    encode_quantise(c2, bits, analysis);
+
+    if (c2->stats_enabled)
+	stats_frame_end(c2, start, stages, &c2->stats.quantise_cycles, &c2->stats.frames_encoded);
+    DENORMALS_RESTORE(c2, fp);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_encode_analyse
+  DATE CREATED: Oct 2026
+
+  The first half of codec2_encode(), see struct CODEC2_ANALYSIS.
+  Reads one frame of speech and runs the analysis of each of its 10 ms
+  frames, filling in analysis for codec2_encode_quantise().
+
+\*---------------------------------------------------------------------------*/
+
+size_t codec2_analysis_size(void)
+{
+    return sizeof(struct CODEC2_ANALYSIS);
+}
+
+void codec2_encode_analyse(struct CODEC2 *c2, struct CODEC2_ANALYSIS *analysis, short speech[])
+{
+    struct CODEC2_PCM pcm;
+    unsigned int      fp = 0;
+
+    assert(c2 != NULL);
+    assert(analysis != NULL);
+    DENORMALS_OFF(c2, fp);
+    pcm_init(&pcm, speech, codec2_samples_per_frame(c2));
+    encode_analyse(c2, analysis, &pcm);
+    DENORMALS_RESTORE(c2, fp);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_encode_quantise
+  DATE CREATED: Oct 2026
+
+  The second half of codec2_encode(), quantises and packs a frame
+  codec2_encode_analyse() analysed.  Frames must be quantised in the
+  order they were analysed, the quantisers predict from the previous
+  frame.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_encode_quantise(struct CODEC2 *c2, unsigned char *bits, const struct CODEC2_ANALYSIS *analysis)
+{
+    unsigned int fp = 0;
+
+    assert(c2 != NULL);
+    assert(analysis != NULL);
+    assert(analysis->mode == CODEC2_MODE_OF(c2));
+    DENORMALS_OFF(c2, fp);
+    encode_quantise(c2, bits, analysis);
+    DENORMALS_RESTORE(c2, fp);
+}
+
+/* Every mode analyses each 10 ms frame the same way, the 700 and 700B
+   modes band pass filtering the speech first.  c2->Sn is kept at the
+   end of each 20 ms for the LSP quantisers. */
+
+static void encode_analyse(struct CODEC2 *c2, struct CODEC2_ANALYSIS *analysis, const struct CODEC2_PCM *speech)
+{
+#ifndef CORTEX_M4
+    ENCODE_BPF_SCRATCH(c2);
+    struct CODEC2_PCM bpf_pcm;
+#endif
+    int   nsub, k;
+
+    analysis->mode = CODEC2_MODE_OF(c2);
+    analysis->lpc = 0;
+    nsub = codec2_samples_per_frame(c2)/N;
+    assert((nsub == 2) || (nsub == 4));
+
+#ifndef CORTEX_M4
+    /* in place if the input has to be gathered */
+
+    if ((CODEC2_MODE_OF(c2) == CODEC2_MODE_700) || (CODEC2_MODE_OF(c2) == CODEC2_MODE_700B)) {
+	encode_bpf(c2, (CODEC2_MODE_OF(c2) == CODEC2_MODE_700) ? bpf : bpfb, speech, bpf_speech);
+	pcm_init(&bpf_pcm, bpf_speech, 4*N);
+	speech = &bpf_pcm;
+    }
+#endif
+
+    for(k=0; k<nsub; k++) {
+	analyse_one_frame(c2, &analysis->model[k], speech, k*N);
+	if (k & 1)
+	    memcpy(analysis->Sn[k/2], c2->Sn, sizeof(analysis->Sn[0]));
+    }
+}
+
+/* The LSPs and energy of the 20 ms of analysis ending at model[2h+1],
+   from the analysis window, or as given by the transcoder */
+
+static float analysis_lsps(struct CODEC2 *c2, const struct CODEC2_ANALYSIS *analysis, int h,
+                           float lsps[], float ak[], int order)
+{
+    if (analysis->lpc) {
+	memcpy(lsps, analysis->lsps[h], order*sizeof(float));
+	return analysis->e[h];
+    }
+    return speech_to_uq_lsps(lsps, ak, analysis->Sn[h], c2->w, c2->lpc_Wr,
+			     c2->lag_window ? c2->lag_win : NULL, order);
+}
+
+static void encode_quantise(struct CODEC2 *c2, unsigned char *bits, const struct CODEC2_ANALYSIS *analysis)
+{
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_3200, CODEC2_MODE_OF(c2)))
+	codec2_encode_3200(c2, bits, analysis);
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_2400, CODEC2_MODE_OF(c2)))
+	codec2_encode_2400(c2, bits, analysis);
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1600, CODEC2_MODE_OF(c2)))
+	codec2_encode_1600(c2, bits, analysis);
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1400, CODEC2_MODE_OF(c2)))
+	codec2_encode_1400(c2, bits, analysis);
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1300, CODEC2_MODE_OF(c2)))
+	codec2_encode_1300(c2, bits, analysis);
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1200, CODEC2_MODE_OF(c2)))
+	codec2_encode_1200(c2, bits, analysis);
+#ifndef CORTEX_M4
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_700, CODEC2_MODE_OF(c2)))
+	codec2_encode_700(c2, bits, analysis);
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_700B, CODEC2_MODE_OF(c2)))
+	codec2_encode_700b(c2, bits, analysis);
+#endif
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_encode_batch
+  DATE CREATED: Oct 2026
+
+  Encodes nframes consecutive frames of speech from one contiguous
+  buffer of nframes*codec2_samples_per_frame() samples into one
+  contiguous bit stream of nframes*((codec2_bits_per_frame()+7)/8)
+  bytes.  The result is identical to calling codec2_encode() once per
+  frame, but the mode dispatch and frame size calculation are done
+  once per batch rather than once per frame.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_encode_batch(struct CODEC2 *c2, unsigned char *bits, short speech[], int nframes)
+{
+    void (*encode)(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis);
+    struct CODEC2_PCM pcm;
+    int   nsam, nbyte, f;
+    unsigned int       fp = 0;
+    unsigned int       start = 0;
+    unsigned long long stages = 0;
+    ENCODE_SCRATCH(c2);
+
+    assert(c2 != NULL);
+    assert(nframes >= 0);
+
+    encode = NULL;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_3200, CODEC2_MODE_OF(c2)))
+	encode = codec2_encode_3200;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_2400, CODEC2_MODE_OF(c2)))
+	encode = codec2_encode_2400;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1600, CODEC2_MODE_OF(c2)))
+	encode = codec2_encode_1600;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1400, CODEC2_MODE_OF(c2)))
+	encode = codec2_encode_1400;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1300, CODEC2_MODE_OF(c2)))
+	encode = codec2_encode_1300;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1200, CODEC2_MODE_OF(c2)))
+	encode = codec2_encode_1200;
+#ifndef CORTEX_M4
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_700, CODEC2_MODE_OF(c2)))
+	encode = codec2_encode_700;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_700B, CODEC2_MODE_OF(c2)))
+	encode = codec2_encode_700b;
+#endif
+    assert(encode != NULL);
+
+    nsam  = codec2_samples_per_frame(c2);
+    nbyte = (codec2_bits_per_frame(c2) + 7)/8;
+
+    DENORMALS_OFF(c2, fp);
+    for(f=0; f<nframes; f++) {
+	pcm_init(&pcm, &speech[f*nsam], nsam);
+	if (c2->stats_enabled) {
+	    stats_frame_begin(c2, &start, &stages);
+	    encode_analyse(c2, analysis, &pcm);
+	    encode(c2, &bits[f*nbyte], analysis);
+	    stats_frame_end(c2, start, stages, &c2->stats.quantise_cycles, &c2->stats.frames_encoded);
+	}
+	else {
+	    encode_analyse(c2, analysis, &pcm);
+	    encode(c2, &bits[f*nbyte], analysis);
+	}
+    }
+    DENORMALS_RESTORE(c2, fp);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_set_dtx
+  DATE CREATED: Oct 2026
+
+  Discontinuous transmission, for codec2_encode_dtx().  A frame of
+  speech whose mean level is below level_db dB relative to full scale
+  (e.g. -50) is silent.  The first DTX_HANGOVER silent frames in a row
+  are still encoded and sent, so word endings aren't clipped and the
+  decoder hears the background.  After that only one frame in
+  DTX_SID_FRAMES is, to update the background, and the rest are
+  neither analysed nor sent.  enable = 0 turns DTX off.
+
+\*---------------------------------------------------------------------------*/
+
+#define DTX_HANGOVER   4
+#define DTX_SID_FRAMES 50
+
+void codec2_set_dtx(struct CODEC2 *c2, int enable, float level_db)
+{
+    assert(c2 != NULL);
+    c2->dtx = enable;
+    c2->dtx_level = 32768.0*32768.0*powf(10.0, level_db/10.0);
+    c2->dtx_silent = 0;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_encode_dtx
+  DATE CREATED: Oct 2026
+
+  codec2_encode() with DTX, see codec2_set_dtx().  Returns 1 if bits
+  holds a frame to send, or 0 for a silent frame that needn't be sent,
+  for which the receiver calls codec2_decode_silence() in place of
+  codec2_decode().  A skipped frame still goes into the analysis
+  window, through the 700 and 700B band pass filter, so the frame after
+  it is encoded as usual.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_encode_dtx(struct CODEC2 *c2, unsigned char *bits, short speech[])
+{
+#ifndef CORTEX_M4
+    ENCODE_BPF_SCRATCH(c2);
+#endif
+    struct CODEC2_PCM pcm;
+    float e;
+    int   nsam, i;
+
+    assert(c2 != NULL);
+
+    if (!c2->dtx) {
+	codec2_encode(c2, bits, speech);
+	return 1;
+    }
+
+    nsam = codec2_samples_per_frame(c2);
+    e = 0.0;
+    for(i=0; i<nsam; i++)
+	e += (float)speech[i]*speech[i];
+    if (e < c2->dtx_level*nsam)
+	c2->dtx_silent++;
+    else
+	c2->dtx_silent = 0;
+
+    /* past the hangover only the place in the DTX_SID_FRAMES cycle
+       matters, so a long silence doesn't overflow the count */
+
+    if (c2->dtx_silent > DTX_HANGOVER + DTX_SID_FRAMES)
+	c2->dtx_silent = DTX_HANGOVER + 1;
+
+    if ((c2->dtx_silent <= DTX_HANGOVER) ||
+	((c2->dtx_silent - DTX_HANGOVER) % DTX_SID_FRAMES == 0)) {
+	codec2_encode(c2, bits, speech);
+	return 1;
+    }
+
+    assert(c2->nlp != NULL);                /* not a codec2_create_decoder() instance */
+
+#ifndef CORTEX_M4
+    if ((CODEC2_MODE_OF(c2) == CODEC2_MODE_700) || (CODEC2_MODE_OF(c2) == CODEC2_MODE_700B)) {
+	bpf_filter(c2->bpf_buf, (CODEC2_MODE_OF(c2) == CODEC2_MODE_700) ? bpf : bpfb, BPF_N,
+		   speech, bpf_speech, 4*N);
+	pcm_init(&pcm, bpf_speech, nsam);
+    }
+    else
+#endif
+    pcm_init(&pcm, speech, nsam);
+    for(i=0; i<nsam; i+=N)
+	read_speech(c2, &pcm, i);
+
+    if (c2->stats_enabled)
+	c2->stats.dtx_frames++;
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_decode_silence
+  DATE CREATED: Oct 2026
+
+  Comfort noise for a frame that wasn't sent, see codec2_encode_dtx().
+  Unvoiced speech with the spectrum and energy of the last frame
+  decoded.  The decoder's states are left as they are, so the next
+  frame received interpolates from that last one.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_decode_silence(struct CODEC2 *c2, short speech[])
+{
+    DECODE_SCRATCH(c2, 1);
+    struct CODEC2_PCM  pcm;
+    float              ak[LPC_ORD+1];
+    int                order, nsam, i;
+    unsigned int       fp = 0;
+    unsigned int       start = 0;
+    unsigned long long stages = 0;
+
+    assert(c2 != NULL);
+
+    DENORMALS_OFF(c2, fp);
+    if (c2->stats_enabled)
+	stats_frame_begin(c2, &start, &stages);
+
+    order = LPC_ORD;
+    if ((CODEC2_MODE_OF(c2) == CODEC2_MODE_700) || (CODEC2_MODE_OF(c2) == CODEC2_MODE_700B))
+	order = LPC_ORD_LOW;
+    nsam = codec2_samples_per_frame(c2);
+    pcm_init(&pcm, speech, codec2_output_samples_per_frame(c2));
+    for(i=0; i<nsam; i+=N) {
+	model[0] = c2->prev_model_dec;
+	model[0].voiced = 0;
+	lsps_to_amplitudes(c2, c2->prev_lsps_dec, ak, order, &model[0], c2->prev_e_dec, Aw);
+	apply_lpc_correction(&model[0]);
+	synthesise_one_frame(c2, &pcm, i, &model[0], Aw);
+    }
+
+    if (c2->stats_enabled)
+	stats_frame_end(c2, start, stages, &c2->stats.dequantise_cycles, &c2->stats.frames_decoded);
+    DENORMALS_RESTORE(c2, fp);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_decode_missing
+  DATE CREATED: Oct 2026
+
+  Packet loss concealment, a frame for one that was lost.  The last
+  frame decoded carries on, its pitch, voicing and spectrum held and
+  its energy falling by MISSING_DECAY every 10 ms.  Nothing is
+  unpacked or dequantised.  The decaying energy is kept as the last
+  frame's, so a run of losses fades out and the next frame received
+  interpolates up from where the fade got to.
+
+\*---------------------------------------------------------------------------*/
+
+#define MISSING_DECAY 0.5              /* energy each 10 ms, 3 dB              */
+
+void codec2_decode_missing(struct CODEC2 *c2, short speech[])
+{
+    DECODE_SCRATCH(c2, 1);
+    struct CODEC2_PCM  pcm;
+    float              ak[LPC_ORD+1];
+    int                order, nsam, i;
+    unsigned int       fp = 0;
+    unsigned int       start = 0;
+    unsigned long long stages = 0;
+
+    assert(c2 != NULL);
+
+    DENORMALS_OFF(c2, fp);
+    if (c2->stats_enabled)
+	stats_frame_begin(c2, &start, &stages);
+
+    order = LPC_ORD;
+    if ((CODEC2_MODE_OF(c2) == CODEC2_MODE_700) || (CODEC2_MODE_OF(c2) == CODEC2_MODE_700B))
+	order = LPC_ORD_LOW;
+    nsam = codec2_samples_per_frame(c2);
+    pcm_init(&pcm, speech, codec2_output_samples_per_frame(c2));
+    for(i=0; i<nsam; i+=N) {
+	c2->prev_e_dec *= MISSING_DECAY;
+	if (c2->prev_e_dec < DENORMAL_GUARD)   /* held, it is interpolated as a log */
+	    c2->prev_e_dec = DENORMAL_GUARD;
+	model[0] = c2->prev_model_dec;
+	lsps_to_amplitudes(c2, c2->prev_lsps_dec, ak, order, &model[0], c2->prev_e_dec, Aw);
+	apply_lpc_correction(&model[0]);
+	synthesise_one_frame(c2, &pcm, i, &model[0], Aw);
+    }
+
+    if (c2->stats_enabled)
+	stats_frame_end(c2, start, stages, &c2->stats.dequantise_cycles, &c2->stats.frames_decoded);
+    DENORMALS_RESTORE(c2, fp);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_encode_warmup_frames
+  DATE CREATED: Oct 2026
+
+  Returns the number of frames of preceding speech that
+  codec2_encode_segment() needs to bring a fresh encoder to the same
+  state as one that has been running all along.  Most modes only carry
+  the M sample analysis window, high pass filter and NLP histories, a
+  couple of frames.  2400, 1400 and 1200 also predict the joint pitch
+  and energy VQ from the previous frame, and that memory takes a few
+  seconds of speech to die away.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_encode_warmup_frames(struct CODEC2 *c2)
+{
+    assert(c2 != NULL);
+
+    if (CODEC2_MODE_OF(c2) == CODEC2_MODE_2400)
+	return 256;
+    if ((CODEC2_MODE_OF(c2) == CODEC2_MODE_1400) || (CODEC2_MODE_OF(c2) == CODEC2_MODE_1200))
+	return 128;
+    return 4;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_encode_segment
+  DATE CREATED: Oct 2026
+
+  Encodes one segment of a long recording so that segments can be
+  encoded in parallel, each by its own freshly created instance, and
+  their bit streams concatenated.  speech[] holds the nwarmup frames
+  just before the segment followed by the nframes frames of the
+  segment; the warm up frames are encoded only to prime the encoder
+  states and bits[] receives the nframes frames of the segment.
+
+  With nwarmup >= codec2_encode_warmup_frames() (or the segment at the
+  start of the recording, nwarmup = 0) the stitched stream matches a
+  serial encode, bar the odd frame in the predictive modes where a
+  quantiser decision is right on the edge.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_encode_segment(struct CODEC2 *c2, unsigned char *bits, short speech[], int nwarmup, int nframes)
+{
+    unsigned char discard[8];
+    int           nsam, f;
+
+    assert(c2 != NULL);
+    assert(nwarmup >= 0);
+
+    nsam = codec2_samples_per_frame(c2);
+    for(f=0; f<nwarmup; f++)
+	codec2_encode(c2, discard, &speech[f*nsam]);
+
+    codec2_encode_batch(c2, bits, &speech[nwarmup*nsam], nframes);
+}
+
+void codec2_decode(struct CODEC2 *c2, short speech[], const unsigned char *bits)
+{
+    codec2_decode_ber(c2, speech, bits, 0.0);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_decode_batch
+  DATE CREATED: Oct 2026
+
+  Decodes nframes consecutive frames from one contiguous bit stream of
+  nframes*((codec2_bits_per_frame()+7)/8) bytes into one contiguous
+  buffer of nframes*codec2_samples_per_frame() speech samples.  The
+  counterpart of codec2_encode_batch().
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_decode_batch(struct CODEC2 *c2, short speech[], const unsigned char *bits, int nframes)
+{
+    void (*decode)(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits);
+    struct CODEC2_PCM pcm;
+    int   nsam, nbyte, f;
+    unsigned int       fp = 0;
+    unsigned int       start = 0;
+    unsigned long long stages = 0;
+
+    assert(c2 != NULL);
+    assert(nframes >= 0);
+
+    nsam  = codec2_output_samples_per_frame(c2);
+    nbyte = (codec2_bits_per_frame(c2) + 7)/8;
+
+    DENORMALS_OFF(c2, fp);
+
+    /* 1300 has an extra ber_est argument so can't share the pointer */
+
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1300, CODEC2_MODE_OF(c2))) {
+	for(f=0; f<nframes; f++) {
+	    if (c2->stats_enabled)
+		stats_frame_begin(c2, &start, &stages);
+	    pcm_init(&pcm, &speech[f*nsam], nsam);
+	    codec2_decode_1300(c2, &pcm, &bits[f*nbyte], 0.0);
+	    if (c2->stats_enabled)
+		stats_frame_end(c2, start, stages, &c2->stats.dequantise_cycles, &c2->stats.frames_decoded);
+	}
+	DENORMALS_RESTORE(c2, fp);
+	return;
+    }
+
+    decode = NULL;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_3200, CODEC2_MODE_OF(c2)))
+	decode = codec2_decode_3200;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_2400, CODEC2_MODE_OF(c2)))
+	decode = codec2_decode_2400;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1600, CODEC2_MODE_OF(c2)))
+	decode = codec2_decode_1600;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1400, CODEC2_MODE_OF(c2)))
+	decode = codec2_decode_1400;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1200, CODEC2_MODE_OF(c2)))
+	decode = codec2_decode_1200;
+#ifndef CORTEX_M4
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_700, CODEC2_MODE_OF(c2)))
+	decode = codec2_decode_700;
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_700B, CODEC2_MODE_OF(c2)))
+	decode = codec2_decode_700b;
+#endif
+    assert(decode != NULL);
+
+    for(f=0; f<nframes; f++) {
+	pcm_init(&pcm, &speech[f*nsam], nsam);
+	if (c2->stats_enabled) {
+	    stats_frame_begin(c2, &start, &stages);
+	    decode(c2, &pcm, &bits[f*nbyte]);
+	    stats_frame_end(c2, start, stages, &c2->stats.dequantise_cycles, &c2->stats.frames_decoded);
+	}
+	else
+	    decode(c2, &pcm, &bits[f*nbyte]);
+    }
+    DENORMALS_RESTORE(c2, fp);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  Hard decisions and bit error probabilities of a run of LLRs for
+  codec2_decode_soft_batch(), built for the baseline instruction set
+  and again for AVX2 on x86, and chosen at run time by
+  soft_select_kernels().  exp(-|llr|) is a polynomial rather than the
+  libm call, so the loop vectorises, and each probability is within
+  2E-7 of 1/(1 + exp(|llr|)) relative to it.  Element wise with no
+  FMA, so the variants give identical results.
+
+\*---------------------------------------------------------------------------*/
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SOFT_X86
+#define SOFT_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__SSE2__)
+#define SOFT_DEFAULT_NAME "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SOFT_DEFAULT_NAME "neon"
+#else
+#define SOFT_DEFAULT_NAME "scalar"
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SOFT_INLINE inline __attribute__((always_inline))
+#else
+#define SOFT_INLINE inline
+#endif
+
+#define SOFT_BLOCK 512                 /* LLRs per pass, at least 8 frames      */
 
-/*---------------------------------------------------------------------------*\
+static SOFT_INLINE void soft_bits_impl(const float llr[], int n, unsigned char hard[], float pe[])
+{
+    float   x, r, p, s;
+    int32_t a, k, e;
+    int     i;
 
-                             FUNCTION HEADERS
+    /* the sign and clamp are done on the bits, float compares would
+       stop the loop vectorising under the default -ftrapping-math */
+
+    for(i=0; i<n; i++) {
+	memcpy(&a, &llr[i], sizeof(a));
+	hard[i] = a > 0;
+	a &= 0x7fffffff;
+	a = (a > 0x42ae0000) ? 0x42ae0000 : a;          /* |llr| <= 87.0 */
+	memcpy(&x, &a, sizeof(x));
+
+	/* exp(-|llr|) = 2^k exp(r), |r| <= ln(2)/2, ln(2) in two parts
+	   so k*ln(2) is exact (Cephes expf) */
+
+	x = -x;
+	k = (int32_t)(x*1.44269504088896341f - 0.5f);
+	r = x - k*0.693359375f + k*2.12194440E-4f;
+	p = 1.9875691500E-4f;
+	p = p*r + 1.3981999507E-3f;
+	p = p*r + 8.3334519073E-3f;
+	p = p*r + 4.1665795894E-2f;
+	p = p*r + 1.6666665459E-1f;
+	p = p*r + 5.0000001201E-1f;
+	p = p*r*r + r + 1.0f;
+	e = (k + 127) << 23;
+	memcpy(&s, &e, sizeof(s));
+	p *= s;
+
+	/* 1/(1 + exp(|llr|)) */
+
+	pe[i] = p/(1.0f + p);
+    }
+}
 
-\*---------------------------------------------------------------------------*/
+static void soft_bits_default(const float llr[], int n, unsigned char hard[], float pe[])
+{
+    soft_bits_impl(llr, n, hard, pe);
+}
+
+#ifdef SOFT_X86
+static SOFT_AVX2 void soft_bits_avx2(const float llr[], int n, unsigned char hard[], float pe[])
+{
+    soft_bits_impl(llr, n, hard, pe);
+}
+#endif
+
+static void (*soft_bits_fn)(const float llr[], int n, unsigned char hard[], float pe[]) = soft_bits_default;
+static const char *soft_bits_name = SOFT_DEFAULT_NAME;
 
-void analyse_one_frame(struct CODEC2 *c2, MODEL *model, short speech[]);
-void synthesise_one_frame(struct CODEC2 *c2, short speech[], MODEL *model, COMP Aw[]);
-void codec2_encode_3200(struct CODEC2 *c2, unsigned char * bits, short speech[]);
-void codec2_decode_3200(struct CODEC2 *c2, short speech[], const unsigned char * bits);
-void codec2_encode_2400(struct CODEC2 *c2, unsigned char * bits, short speech[]);
-void codec2_decode_2400(struct CODEC2 *c2, short speech[], const unsigned char * bits);
-void codec2_encode_1600(struct CODEC2 *c2, unsigned char * bits, short speech[]);
-void codec2_decode_1600(struct CODEC2 *c2, short speech[], const unsigned char * bits);
-void codec2_encode_1400(struct CODEC2 *c2, unsigned char * bits, short speech[]);
-void codec2_decode_1400(struct CODEC2 *c2, short speech[], const unsigned char * bits);
-void codec2_encode_1300(struct CODEC2 *c2, unsigned char * bits, short speech[]);
-void codec2_decode_1300(struct CODEC2 *c2, short speech[], const unsigned char * bits, float ber_est);
-void codec2_encode_1200(struct CODEC2 *c2, unsigned char * bits, short speech[]);
-void codec2_decode_1200(struct CODEC2 *c2, short speech[], const unsigned char * bits);
-void codec2_encode_700(struct CODEC2 *c2, unsigned char * bits, short speech[]);
-void codec2_decode_700(struct CODEC2 *c2, short speech[], const unsigned char * bits);
-void codec2_encode_700b(struct CODEC2 *c2, unsigned char * bits, short speech[]);
-void codec2_decode_700b(struct CODEC2 *c2, short speech[], const unsigned char * bits);
-static void ear_protection(float in_out[], int n);
+/* Picks the soft_bits variant for the machdep_cpu_features() given */
+
+static void soft_select_kernels(int features)
+{
+    soft_bits_fn = soft_bits_default;
+    soft_bits_name = SOFT_DEFAULT_NAME;
+#ifdef SOFT_X86
+    if (features & MACHDEP_CPU_AVX2) {
+	soft_bits_fn = soft_bits_avx2;
+	soft_bits_name = "avx2";
+    }
+#else
+    (void)features;
+#endif
+}
 
 /*---------------------------------------------------------------------------*\
 
-                                FUNCTIONS
+  FUNCTION....: codec2_decode_soft_batch
+  DATE CREATED: Oct 2026
+
+  codec2_decode_batch() for frames from a soft decision demodulator.
+  llr[] holds nframes*codec2_bits_per_frame() log likelihood ratios,
+  log(P(1)/P(0)) of each bit in transmitted order, so positive for a
+  1.  If bits is NULL the frames are the hard decisions of llr[],
+  otherwise bits[] holds them as for codec2_decode_batch().
+
+  Each frame's mean bit error probability, 1/(1 + exp(|llr|)) per
+  bit, is its ber_est for codec2_decode_ber(), so 1300 mutes frames
+  that are too poor to decode.  While a frame is decoded llr[] is its
+  codec2_set_softdec() too, so there is no need to set that per frame.
 
 \*---------------------------------------------------------------------------*/
 
+void codec2_decode_soft_batch(struct CODEC2 *c2, short speech[], const unsigned char *bits,
+                              const float llr[], int nframes)
+{
+    unsigned char  hard[8], hb[SOFT_BLOCK];
+    const float   *softdec;
+    float          pb[SOFT_BLOCK], pe;
+    int            nsam, nbit, nbyte, nblock, f, b, i;
+
+    assert(c2 != NULL);
+    assert(llr != NULL);
+    assert(nframes >= 0);
+
+    nsam  = codec2_output_samples_per_frame(c2);
+    nbit  = codec2_bits_per_frame(c2);
+    nbyte = (nbit + 7)/8;
+    assert(nbyte <= (int)sizeof(hard));
+    nblock = SOFT_BLOCK/nbit;
+
+    softdec = c2->softdec;
+    for(f=0; f<nframes; f+=nblock) {
+	if (nblock > nframes - f)
+	    nblock = nframes - f;
+
+	/* all the LLRs of nblock frames in one pass */
+
+	soft_bits_fn(&llr[f*nbit], nblock*nbit, hb, pb);
+
+	for(b=0; b<nblock; b++) {
+	    pe = 0.0;
+	    for(i=0; i<nbit; i++)
+		pe += pb[b*nbit + i];
+
+	    if (bits == NULL) {
+		for(i=0; i<nbyte; i++)
+		    hard[i] = 0;
+		for(i=0; i<nbit; i++)
+		    hard[i >> 3] |= (unsigned char)(hb[b*nbit + i] << (7 - (i & 7)));
+	    }
+
+	    c2->softdec = &llr[(f + b)*nbit];
+	    codec2_decode_ber(c2, &speech[(f + b)*nsam], (bits == NULL) ? hard : &bits[(f + b)*nbyte], pe/nbit);
+	}
+    }
+    c2->softdec = softdec;
+}
+
 /*---------------------------------------------------------------------------*\
 
-  FUNCTION....: codec2_create
-  AUTHOR......: David Rowe
-  DATE CREATED: 21/8/2010
+  FUNCTION....: codec2_encode_stream
+  DATE CREATED: Oct 2026
 
-  Create and initialise an instance of the codec.  Returns a pointer
-  to the codec states or NULL on failure.  One set of states is
-  sufficient for a full duuplex codec (i.e. an encoder and decoder).
-  You don't need separate states for encoders and decoders.  See
-  c2enc.c and c2dec.c for examples.
+  Push style encoder for callers whose audio arrives in blocks that
+  aren't a whole number of frames, e.g. 10 or 20ms RTP packets or
+  odd sized sound card callbacks.  Any number of samples can be
+  passed, each complete frame is encoded and its
+  (codec2_bits_per_frame()+7)/8 bytes handed to cb.  Returns the
+  number of frames encoded by this call.
+
+  Frames that lie wholly inside speech_in[] are encoded in place,
+  only the samples either side of a frame boundary that straddles two
+  calls are copied, into a one frame buffer in the codec state.
 
 \*---------------------------------------------------------------------------*/
 
-struct CODEC2 * codec2_create(int mode)
+int codec2_encode_stream(struct CODEC2 *c2, const short speech_in[], int nsamples,
+                         codec2_bits_callback cb, void *cb_state)
 {
-    struct CODEC2 *c2;
-    int            i,l;
-
-    c2 = (struct CODEC2*)malloc(sizeof(struct CODEC2));
-    if (c2 == NULL)
-	return NULL;
+    unsigned char bits[sizeof(c2->stream_bits)];
+    int           nsam, nbyte, n, frames;
 
-    assert(
-	   (mode == CODEC2_MODE_3200) ||
-	   (mode == CODEC2_MODE_2400) ||
-	   (mode == CODEC2_MODE_1600) ||
-	   (mode == CODEC2_MODE_1400) ||
-	   (mode == CODEC2_MODE_1300) ||
-	   (mode == CODEC2_MODE_1200) ||
-	   (mode == CODEC2_MODE_700) ||
-	   (mode == CODEC2_MODE_700B)
-	   );
-    c2->mode = mode;
-    for(i=0; i<M; i++)
-	c2->Sn[i] = 1.0;
-    c2->hpf_states[0] = c2->hpf_states[1] = 0.0;
-    for(i=0; i<2*N; i++)
-	c2->Sn_[i] = 0;
-    c2->fft_fwd_cfg = kiss_fft_alloc(FFT_ENC, 0, NULL, NULL);
-    make_analysis_window(c2->fft_fwd_cfg, c2->w,c2->W);
-    make_synthesis_window(c2->Pn);
-    c2->fft_inv_cfg = kiss_fft_alloc(FFT_DEC, 1, NULL, NULL);
-    quantise_init();
-    c2->prev_Wo_enc = 0.0;
-    c2->bg_est = 0.0;
-    c2->ex_phase = 0.0;
+    assert(c2 != NULL);
+    assert(cb != NULL);
+    assert(nsamples >= 0);
+
+    nsam   = codec2_samples_per_frame(c2);
+    nbyte  = (codec2_bits_per_frame(c2) + 7)/8;
+    frames = 0;
+
+    /* complete a frame left over from the last call */
+
+    if (c2->stream_nspeech) {
+	n = nsam - c2->stream_nspeech;
+	if (n > nsamples)
+	    n = nsamples;
+	memcpy(&c2->stream_speech[c2->stream_nspeech], speech_in, sizeof(short)*n);
+	c2->stream_nspeech += n;
+	speech_in += n;
+	nsamples -= n;
+	if (c2->stream_nspeech < nsam)
+	    return 0;
+	codec2_encode(c2, bits, c2->stream_speech);
+	cb(cb_state, bits, nbyte);
+	c2->stream_nspeech = 0;
+	frames++;
+    }
 
-    for(l=1; l<=MAX_AMP; l++)
-	c2->prev_model_dec.A[l] = 0.0;
-    c2->prev_model_dec.Wo = TWO_PI/P_MAX;
-    c2->prev_model_dec.L = PI/c2->prev_model_dec.Wo;
-    c2->prev_model_dec.voiced = 0;
+    /* whole frames straight from the caller's buffer, the encoders
+       only read speech[] */
 
-    for(i=0; i<LPC_ORD; i++) {
-      c2->prev_lsps_dec[i] = i*PI/(LPC_ORD+1);
+    while(nsamples >= nsam) {
+	codec2_encode(c2, bits, (short *)speech_in);
+	cb(cb_state, bits, nbyte);
+	speech_in += nsam;
+	nsamples -= nsam;
+	frames++;
     }
-    c2->prev_e_dec = 1;
 
-    c2->nlp = nlp_create(M);
-    if (c2->nlp == NULL) {
-	free (c2);
-	return NULL;
+    memcpy(c2->stream_speech, speech_in, sizeof(short)*nsamples);
+    c2->stream_nspeech = nsamples;
+
+    return frames;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_decode_stream
+  DATE CREATED: Oct 2026
+
+  The decoder counterpart of codec2_encode_stream().  bits[] is a
+  byte stream of consecutive (codec2_bits_per_frame()+7)/8 byte
+  frames, split at any point between calls.  Each frame is decoded
+  and its codec2_output_samples_per_frame() samples handed to cb.  Returns
+  the number of frames decoded.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_decode_stream(struct CODEC2 *c2, const unsigned char bits[], int nbytes,
+                         codec2_speech_callback cb, void *cb_state)
+{
+    short speech[4*N*SYNTH_UP_MAX];
+    int   nsam, nbyte, n, frames;
+
+    assert(c2 != NULL);
+    assert(cb != NULL);
+    assert(nbytes >= 0);
+
+    nsam   = codec2_output_samples_per_frame(c2);
+    nbyte  = (codec2_bits_per_frame(c2) + 7)/8;
+    frames = 0;
+
+    if (c2->stream_nbits) {
+	n = nbyte - c2->stream_nbits;
+	if (n > nbytes)
+	    n = nbytes;
+	memcpy(&c2->stream_bits[c2->stream_nbits], bits, n);
+	c2->stream_nbits += n;
+	bits += n;
+	nbytes -= n;
+	if (c2->stream_nbits < nbyte)
+	    return 0;
+	codec2_decode(c2, speech, c2->stream_bits);
+	cb(cb_state, speech, nsam);
+	c2->stream_nbits = 0;
+	frames++;
     }
 
-    if (mode == CODEC2_MODE_700B)
-        c2->gray = 0;             // natural binary better for trellis decoding (hopefully added later)
-    else
-        c2->gray = 1;
+    while(nbytes >= nbyte) {
+	codec2_decode(c2, speech, bits);
+	cb(cb_state, speech, nsam);
+	bits += nbyte;
+	nbytes -= nbyte;
+	frames++;
+    }
 
-    c2->lpc_pf = 1; c2->bass_boost = 1; c2->beta = LPCPF_BETA; c2->gamma = LPCPF_GAMMA;
+    memcpy(c2->stream_bits, bits, nbytes);
+    c2->stream_nbits = nbytes;
 
-    c2->xq_enc[0] = c2->xq_enc[1] = 0.0;
-    c2->xq_dec[0] = c2->xq_dec[1] = 0.0;
+    return frames;
+}
 
-    c2->smoothing = 0;
+/* Discards any partial frames held by codec2_encode_stream() and
+   codec2_decode_stream(), e.g. after a dropout or a seek */
 
-    c2->bpf_buf = (float*)malloc(sizeof(float)*(BPF_N+4*N));
-    assert(c2->bpf_buf != NULL);
-    for(i=0; i<BPF_N+4*N; i++)
-        c2->bpf_buf[i] = 0.0;
+void codec2_stream_reset(struct CODEC2 *c2)
+{
+    assert(c2 != NULL);
+    c2->stream_nspeech = 0;
+    c2->stream_nbits = 0;
+}
 
-    c2->softdec = NULL;
+void codec2_decode_ber(struct CODEC2 *c2, short speech[], const unsigned char *bits, float ber_est)
+{
+    struct CODEC2_PCM pcm;
 
-    return c2;
+    assert(c2 != NULL);
+    pcm_init(&pcm, speech, codec2_output_samples_per_frame(c2));
+    decode_pcm(c2, &pcm, bits, ber_est);
 }
 
 /*---------------------------------------------------------------------------*\
 
-  FUNCTION....: codec2_destroy
-  AUTHOR......: David Rowe
-  DATE CREATED: 21/8/2010
+  FUNCTION....: codec2_decode_pcm
+  DATE CREATED: Oct 2026
 
-  Destroy an instance of the codec.
+  codec2_decode() straight into the caller's buffer, e.g. a ring
+  buffer, see struct CODEC2_PCM.
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_destroy(struct CODEC2 *c2)
+void codec2_decode_pcm(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char *bits)
 {
-    assert(c2 != NULL);
-    free(c2->bpf_buf);
-    nlp_destroy(c2->nlp);
-    KISS_FFT_FREE(c2->fft_fwd_cfg);
-    KISS_FFT_FREE(c2->fft_inv_cfg);
-    free(c2);
+    decode_pcm(c2, speech, bits, 0.0);
 }
 
 /*---------------------------------------------------------------------------*\
 
-  FUNCTION....: codec2_bits_per_frame
-  AUTHOR......: David Rowe
-  DATE CREATED: Nov 14 2011
+  FUNCTION....: codec2_decode_muted
+  DATE CREATED: Oct 2026
 
-  Returns the number of bits per frame.
+  Decodes a frame of a stream nobody is listening to, e.g. a muted
+  conference leg.  The pitch, voicing, energy and LSP histories are
+  updated just as codec2_decode() updates them, but the amplitudes
+  aren't recovered and no speech is synthesised, which leaves the
+  unpacking and dequantisation, a small part of a decode.  Unmuting
+  from any frame carries on seamlessly, the first frame fading in.
+
+  If energy isn't NULL it gets the frame's mean energy, the decoded
+  LPC energy of each 10 ms frame averaged, for level meters.  If
+  voiced isn't NULL it gets the number of voiced 10 ms frames.
+
+  The post filter's background noise estimate isn't updated while
+  muted, and the random phases of unvoiced frames are drawn from
+  where they were left, so after a muted stretch the speech is not
+  bit exact with a stream decoded all along.
 
 \*---------------------------------------------------------------------------*/
 
-int codec2_bits_per_frame(struct CODEC2 *c2) {
-    if (c2->mode == CODEC2_MODE_3200)
-	return 64;
-    if (c2->mode == CODEC2_MODE_2400)
-	return 48;
-    if  (c2->mode == CODEC2_MODE_1600)
-	return 64;
-    if  (c2->mode == CODEC2_MODE_1400)
-	return 56;
-    if  (c2->mode == CODEC2_MODE_1300)
-	return 52;
-    if  (c2->mode == CODEC2_MODE_1200)
-	return 48;
-    if  (c2->mode == CODEC2_MODE_700)
-	return 28;
-    if  (c2->mode == CODEC2_MODE_700B)
-	return 28;
+void codec2_decode_muted(struct CODEC2 *c2, const unsigned char *bits, float *energy, int *voiced)
+{
+    struct CODEC2_PCM pcm;
 
-    return 0; /* shouldn't get here */
-}
+    assert(c2 != NULL);
 
+    pcm_init(&pcm, NULL, 0);
+    c2->muted = 1;
+    c2->muted_energy = 0.0;
+    c2->muted_voiced = 0;
+    decode_pcm(c2, &pcm, bits, 0.0);
+    c2->muted = 0;
+
+    if (energy != NULL)
+	*energy = c2->muted_energy*N/codec2_samples_per_frame(c2);
+    if (voiced != NULL)
+	*voiced = c2->muted_voiced;
+}
 
 /*---------------------------------------------------------------------------*\
 
-  FUNCTION....: codec2_samples_per_frame
-  AUTHOR......: David Rowe
-  DATE CREATED: Nov 14 2011
+  FUNCTION....: codec2_encode_float
+  DATE CREATED: Oct 2026
 
-  Returns the number of speech samples per frame.
+  codec2_encode() of float speech, each sample scaled by gain on the
+  way into the analysis window, e.g. 32768 for samples in +/- 1.0.
+  With gain 1 integer valued samples give the same bits as the short
+  samples would.
 
 \*---------------------------------------------------------------------------*/
 
-int codec2_samples_per_frame(struct CODEC2 *c2) {
-    if (c2->mode == CODEC2_MODE_3200)
-	return 160;
-    if (c2->mode == CODEC2_MODE_2400)
-	return 160;
-    if  (c2->mode == CODEC2_MODE_1600)
-	return 320;
-    if  (c2->mode == CODEC2_MODE_1400)
-	return 320;
-    if  (c2->mode == CODEC2_MODE_1300)
-	return 320;
-    if  (c2->mode == CODEC2_MODE_1200)
-	return 320;
-    if  (c2->mode == CODEC2_MODE_700)
-	return 320;
-    if  (c2->mode == CODEC2_MODE_700B)
-	return 320;
+void codec2_encode_float(struct CODEC2 *c2, unsigned char *bits, const float speech[], float gain)
+{
+    struct CODEC2_PCM pcm;
 
-    return 0; /* shouldnt get here */
+    assert(c2 != NULL);
+    assert(speech != NULL);
+
+    pcm_init(&pcm, NULL, 0);
+    c2->float_in = speech;
+    c2->float_gain = gain;
+    codec2_encode_pcm(c2, bits, &pcm);
+    c2->float_in = NULL;
 }
 
-void codec2_encode(struct CODEC2 *c2, unsigned char *bits, short speech[])
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_decode_float
+  DATE CREATED: Oct 2026
+
+  codec2_decode() to float speech, the synthesised samples scaled by
+  gain, e.g. 1.0/32768 for +/- 1.0, and not clipped.  Ear protection
+  still applies.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_decode_float(struct CODEC2 *c2, float speech[], const unsigned char *bits, float gain)
 {
+    struct CODEC2_PCM pcm;
+
     assert(c2 != NULL);
-    assert(
-	   (c2->mode == CODEC2_MODE_3200) ||
-	   (c2->mode == CODEC2_MODE_2400) ||
-	   (c2->mode == CODEC2_MODE_1600) ||
-	   (c2->mode == CODEC2_MODE_1400) ||
-	   (c2->mode == CODEC2_MODE_1300) ||
-	   (c2->mode == CODEC2_MODE_1200) ||
-	   (c2->mode == CODEC2_MODE_700)  ||
-	   (c2->mode == CODEC2_MODE_700B)
-	   );
+    assert(speech != NULL);
 
-    if (c2->mode == CODEC2_MODE_3200)
-	codec2_encode_3200(c2, bits, speech);
-    if (c2->mode == CODEC2_MODE_2400)
-	codec2_encode_2400(c2, bits, speech);
-    if (c2->mode == CODEC2_MODE_1600)
-	codec2_encode_1600(c2, bits, speech);
-    if (c2->mode == CODEC2_MODE_1400)
-	codec2_encode_1400(c2, bits, speech);
-    if (c2->mode == CODEC2_MODE_1300)
-	codec2_encode_1300(c2, bits, speech);
-    if (c2->mode == CODEC2_MODE_1200)
-	codec2_encode_1200(c2, bits, speech);
-#ifndef CORTEX_M4
-    if (c2->mode == CODEC2_MODE_700)
-	codec2_encode_700(c2, bits, speech);
-    if (c2->mode == CODEC2_MODE_700B)
-	codec2_encode_700b(c2, bits, speech);
-#endif
+    pcm_init(&pcm, NULL, 0);
+    c2->float_out = speech;
+    c2->float_gain = gain;
+    decode_pcm(c2, &pcm, bits, 0.0);
+    c2->float_out = NULL;
 }
 
-void codec2_decode(struct CODEC2 *c2, short speech[], const unsigned char *bits)
+static void decode_pcm(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char *bits, float ber_est)
 {
-    codec2_decode_ber(c2, speech, bits, 0.0);
-}
+    unsigned int       fp = 0;
+    unsigned int       start = 0;
+    unsigned long long stages = 0;
 
-void codec2_decode_ber(struct CODEC2 *c2, short speech[], const unsigned char *bits, float ber_est)
-{
     assert(c2 != NULL);
     assert(
-	   (c2->mode == CODEC2_MODE_3200) ||
-	   (c2->mode == CODEC2_MODE_2400) ||
-	   (c2->mode == CODEC2_MODE_1600) ||
-	   (c2->mode == CODEC2_MODE_1400) ||
-	   (c2->mode == CODEC2_MODE_1300) ||
-	   (c2->mode == CODEC2_MODE_1200) ||
-	   (c2->mode == CODEC2_MODE_700) ||
-	   (c2->mode == CODEC2_MODE_700B)
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_3200) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_2400) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_1600) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_1400) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_1300) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_1200) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_700) ||
+	   (CODEC2_MODE_OF(c2) == CODEC2_MODE_700B)
 	   );
 
-    if (c2->mode == CODEC2_MODE_3200)
+    DENORMALS_OFF(c2, fp);
+    if (c2->stats_enabled)
+	stats_frame_begin(c2, &start, &stages);
+
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_3200, CODEC2_MODE_OF(c2)))
 	codec2_decode_3200(c2, speech, bits);
-    if (c2->mode == CODEC2_MODE_2400)
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_2400, CODEC2_MODE_OF(c2)))
 	codec2_decode_2400(c2, speech, bits);
-    if (c2->mode == CODEC2_MODE_1600)
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1600, CODEC2_MODE_OF(c2)))
  	codec2_decode_1600(c2, speech, bits);
-    if (c2->mode == CODEC2_MODE_1400)
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1400, CODEC2_MODE_OF(c2)))
  	codec2_decode_1400(c2, speech, bits);
-    if (c2->mode == CODEC2_MODE_1300)
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1300, CODEC2_MODE_OF(c2)))
  	codec2_decode_1300(c2, speech, bits, ber_est);
-    if (c2->mode == CODEC2_MODE_1200)
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_1200, CODEC2_MODE_OF(c2)))
  	codec2_decode_1200(c2, speech, bits);
 #ifndef CORTEX_M4
-    if (c2->mode == CODEC2_MODE_700)
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_700, CODEC2_MODE_OF(c2)))
  	codec2_decode_700(c2, speech, bits);
-    if (c2->mode == CODEC2_MODE_700B)
+    if (CODEC2_MODE_ACTIVE(CODEC2_MODE_700B, CODEC2_MODE_OF(c2)))
  	codec2_decode_700b(c2, speech, bits);
 #endif
+
+    if (c2->stats_enabled)
+	stats_frame_end(c2, start, stages, &c2->stats.dequantise_cycles, &c2->stats.frames_decoded);
+    DENORMALS_RESTORE(c2, fp);
 }
 
 
+#if CODEC2_MODE_3200_EN
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_encode_3200
@@ -350,42 +2028,42 @@ void codec2_decode_ber(struct CODEC2 *c2, short speech[], const unsigned char *b
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_encode_3200(struct CODEC2 *c2, unsigned char * bits, short speech[])
+void codec2_encode_3200(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis)
 {
-    MODEL   model;
+    const MODEL *model;
     float   ak[LPC_ORD+1];
     float   lsps[LPC_ORD];
     float   e;
     int     Wo_index, e_index;
     int     lspd_indexes[LPC_ORD];
     int     i;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
 
     assert(c2 != NULL);
 
-    memset(bits, '\0', ((codec2_bits_per_frame(c2) + 7) / 8));
-
     /* first 10ms analysis frame - we just want voicing */
 
-    analyse_one_frame(c2, &model, speech);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[0];
+    fields[nf++] = model->voiced;
 
     /* second 10ms analysis frame */
 
-    analyse_one_frame(c2, &model, &speech[N]);
-    pack(bits, &nbit, model.voiced, 1);
-    Wo_index = encode_Wo(model.Wo, WO_BITS);
-    pack(bits, &nbit, Wo_index, WO_BITS);
+    model = &analysis->model[1];
+    fields[nf++] = model->voiced;
+    Wo_index = encode_Wo(model->Wo, WO_BITS);
+    fields[nf++] = Wo_index;
 
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
+    e = analysis_lsps(c2, analysis, 0, lsps, ak, LPC_ORD);
     e_index = encode_energy(e, E_BITS);
-    pack(bits, &nbit, e_index, E_BITS);
+    fields[nf++] = e_index;
 
     encode_lspds_scalar(lspd_indexes, lsps, LPC_ORD);
     for(i=0; i<LSPD_SCALAR_INDEXES; i++) {
-	pack(bits, &nbit, lspd_indexes[i], lspd_bits(i));
+	fields[nf++] = lspd_indexes[i];
     }
-    assert(nbit == (unsigned)codec2_bits_per_frame(c2));
+    assert(nf == frame_layouts[CODEC2_MODE_OF(c2)].nfields);
+    frame_pack(&frame_layouts[CODEC2_MODE_OF(c2)], bits, fields, c2->gray);
 }
 
 
@@ -399,20 +2077,20 @@ void codec2_encode_3200(struct CODEC2 *c2, unsigned char * bits, short speech[])
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_decode_3200(struct CODEC2 *c2, short speech[], const unsigned char * bits)
+void codec2_decode_3200(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits)
 {
-    MODEL   model[2];
+    DECODE_SCRATCH(c2, 2);
     int     lspd_indexes[LPC_ORD];
     float   lsps[2][LPC_ORD];
     int     Wo_index, e_index;
     float   e[2];
-    float   snr;
     float   ak[2][LPC_ORD+1];
     int     i,j;
-    unsigned int nbit = 0;
-    COMP    Aw[FFT_ENC];
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
 
     assert(c2 != NULL);
+    frame_unpack(&frame_layouts[CODEC2_MODE_OF(c2)], fields, bits, c2->gray);
 
     /* only need to zero these out due to (unused) snr calculation */
 
@@ -425,18 +2103,18 @@ void codec2_decode_3200(struct CODEC2 *c2, short speech[], const unsigned char *
     /* this will partially fill the model params for the 2 x 10ms
        frames */
 
-    model[0].voiced = unpack(bits, &nbit, 1);
-    model[1].voiced = unpack(bits, &nbit, 1);
+    model[0].voiced = fields[nf++];
+    model[1].voiced = fields[nf++];
 
-    Wo_index = unpack(bits, &nbit, WO_BITS);
+    Wo_index = fields[nf++];
     model[1].Wo = decode_Wo(Wo_index, WO_BITS);
     model[1].L  = PI/model[1].Wo;
 
-    e_index = unpack(bits, &nbit, E_BITS);
+    e_index = fields[nf++];
     e[1] = decode_energy(e_index, E_BITS);
 
     for(i=0; i<LSPD_SCALAR_INDEXES; i++) {
-	lspd_indexes[i] = unpack(bits, &nbit, lspd_bits(i));
+	lspd_indexes[i] = fields[nf++];
     }
     decode_lspds_scalar(&lsps[1][0], lspd_indexes, LPC_ORD);
 
@@ -454,11 +2132,7 @@ void codec2_decode_3200(struct CODEC2 *c2, short speech[], const unsigned char *
     interpolate_lsp_ver2(&lsps[0][0], c2->prev_lsps_dec, &lsps[1][0], 0.5, LPC_ORD);
 
     for(i=0; i<2; i++) {
-	lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD);
-	aks_to_M2(c2->fft_fwd_cfg, &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, 0,
-                  c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw);
-	apply_lpc_correction(&model[i]);
-	synthesise_one_frame(c2, &speech[N*i], &model[i], Aw);
+	decode_one_frame(c2, speech, N*i, &lsps[i][0], &ak[i][0], LPC_ORD, &model[i], e[i], Aw);
     }
 
     /* update memories for next frame ----------------------------*/
@@ -468,8 +2142,10 @@ void codec2_decode_3200(struct CODEC2 *c2, short speech[], const unsigned char *
     for(i=0; i<LPC_ORD; i++)
 	c2->prev_lsps_dec[i] = lsps[1][i];
 }
+#endif
 
 
+#if CODEC2_MODE_2400_EN
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_encode_2400
@@ -495,9 +2171,9 @@ void codec2_decode_3200(struct CODEC2 *c2, short speech[], const unsigned char *
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_encode_2400(struct CODEC2 *c2, unsigned char * bits, short speech[])
+void codec2_encode_2400(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis)
 {
-    MODEL   model;
+    const MODEL *model;
     float   ak[LPC_ORD+1];
     float   lsps[LPC_ORD];
     float   e;
@@ -505,33 +2181,33 @@ void codec2_encode_2400(struct CODEC2 *c2, unsigned char * bits, short speech[])
     int     lsp_indexes[LPC_ORD];
     int     i;
     int     spare = 0;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
 
     assert(c2 != NULL);
 
-    memset(bits, '\0', ((codec2_bits_per_frame(c2) + 7) / 8));
-
     /* first 10ms analysis frame - we just want voicing */
 
-    analyse_one_frame(c2, &model, speech);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[0];
+    fields[nf++] = model->voiced;
 
     /* second 10ms analysis frame */
 
-    analyse_one_frame(c2, &model, &speech[N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[1];
+    fields[nf++] = model->voiced;
 
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
-    WoE_index = encode_WoE(&model, e, c2->xq_enc);
-    pack(bits, &nbit, WoE_index, WO_E_BITS);
+    e = analysis_lsps(c2, analysis, 0, lsps, ak, LPC_ORD);
+    WoE_index = encode_WoE(model, e, c2->xq_enc);
+    fields[nf++] = WoE_index;
 
     encode_lsps_scalar(lsp_indexes, lsps, LPC_ORD);
     for(i=0; i<LSP_SCALAR_INDEXES; i++) {
-	pack(bits, &nbit, lsp_indexes[i], lsp_bits(i));
+	fields[nf++] = lsp_indexes[i];
     }
-    pack(bits, &nbit, spare, 2);
+    fields[nf++] = spare;
 
-    assert(nbit == (unsigned)codec2_bits_per_frame(c2));
+    assert(nf == frame_layouts[CODEC2_MODE_OF(c2)].nfields);
+    frame_pack(&frame_layouts[CODEC2_MODE_OF(c2)], bits, fields, c2->gray);
 }
 
 
@@ -545,20 +2221,20 @@ void codec2_encode_2400(struct CODEC2 *c2, unsigned char * bits, short speech[])
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_decode_2400(struct CODEC2 *c2, short speech[], const unsigned char * bits)
+void codec2_decode_2400(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits)
 {
-    MODEL   model[2];
+    DECODE_SCRATCH(c2, 2);
     int     lsp_indexes[LPC_ORD];
     float   lsps[2][LPC_ORD];
     int     WoE_index;
     float   e[2];
-    float   snr;
     float   ak[2][LPC_ORD+1];
     int     i,j;
-    unsigned int nbit = 0;
-    COMP    Aw[FFT_ENC];
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
 
     assert(c2 != NULL);
+    frame_unpack(&frame_layouts[CODEC2_MODE_OF(c2)], fields, bits, c2->gray);
 
     /* only need to zero these out due to (unused) snr calculation */
 
@@ -571,14 +2247,14 @@ void codec2_decode_2400(struct CODEC2 *c2, short speech[], const unsigned char *
     /* this will partially fill the model params for the 2 x 10ms
        frames */
 
-    model[0].voiced = unpack(bits, &nbit, 1);
+    model[0].voiced = fields[nf++];
 
-    model[1].voiced = unpack(bits, &nbit, 1);
-    WoE_index = unpack(bits, &nbit, WO_E_BITS);
+    model[1].voiced = fields[nf++];
+    WoE_index = fields[nf++];
     decode_WoE(&model[1], &e[1], c2->xq_dec, WoE_index);
 
     for(i=0; i<LSP_SCALAR_INDEXES; i++) {
-	lsp_indexes[i] = unpack(bits, &nbit, lsp_bits(i));
+	lsp_indexes[i] = fields[nf++];
     }
     decode_lsps_scalar(&lsps[1][0], lsp_indexes, LPC_ORD);
     check_lsp_order(&lsps[1][0], LPC_ORD);
@@ -597,11 +2273,7 @@ void codec2_decode_2400(struct CODEC2 *c2, short speech[], const unsigned char *
 
     interpolate_lsp_ver2(&lsps[0][0], c2->prev_lsps_dec, &lsps[1][0], 0.5, LPC_ORD);
     for(i=0; i<2; i++) {
-	lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD);
-	aks_to_M2(c2->fft_fwd_cfg, &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, 0,
-                  c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw);
-	apply_lpc_correction(&model[i]);
-	synthesise_one_frame(c2, &speech[N*i], &model[i], Aw);
+	decode_one_frame(c2, speech, N*i, &lsps[i][0], &ak[i][0], LPC_ORD, &model[i], e[i], Aw);
     }
 
     /* update memories for next frame ----------------------------*/
@@ -611,8 +2283,10 @@ void codec2_decode_2400(struct CODEC2 *c2, short speech[], const unsigned char *
     for(i=0; i<LPC_ORD; i++)
 	c2->prev_lsps_dec[i] = lsps[1][i];
 }
+#endif
 
 
+#if CODEC2_MODE_1600_EN
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_encode_1600
@@ -641,62 +2315,62 @@ void codec2_decode_2400(struct CODEC2 *c2, short speech[], const unsigned char *
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_encode_1600(struct CODEC2 *c2, unsigned char * bits, short speech[])
+void codec2_encode_1600(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis)
 {
-    MODEL   model;
+    const MODEL *model;
     float   lsps[LPC_ORD];
     float   ak[LPC_ORD+1];
     float   e;
     int     lsp_indexes[LPC_ORD];
     int     Wo_index, e_index;
     int     i;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
 
     assert(c2 != NULL);
 
-    memset(bits, '\0',  ((codec2_bits_per_frame(c2) + 7) / 8));
-
     /* frame 1: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, speech);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[0];
+    fields[nf++] = model->voiced;
 
     /* frame 2: - voicing, scalar Wo & E -------------------------------*/
 
-    analyse_one_frame(c2, &model, &speech[N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[1];
+    fields[nf++] = model->voiced;
 
-    Wo_index = encode_Wo(model.Wo, WO_BITS);
-    pack(bits, &nbit, Wo_index, WO_BITS);
+    Wo_index = encode_Wo(model->Wo, WO_BITS);
+    fields[nf++] = Wo_index;
 
     /* need to run this just to get LPC energy */
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
+    e = analysis_lsps(c2, analysis, 0, lsps, ak, LPC_ORD);
     e_index = encode_energy(e, E_BITS);
-    pack(bits, &nbit, e_index, E_BITS);
+    fields[nf++] = e_index;
 
     /* frame 3: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, &speech[2*N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[2];
+    fields[nf++] = model->voiced;
 
     /* frame 4: - voicing, scalar Wo & E, scalar LSPs ------------------*/
 
-    analyse_one_frame(c2, &model, &speech[3*N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[3];
+    fields[nf++] = model->voiced;
 
-    Wo_index = encode_Wo(model.Wo, WO_BITS);
-    pack(bits, &nbit, Wo_index, WO_BITS);
+    Wo_index = encode_Wo(model->Wo, WO_BITS);
+    fields[nf++] = Wo_index;
 
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
+    e = analysis_lsps(c2, analysis, 1, lsps, ak, LPC_ORD);
     e_index = encode_energy(e, E_BITS);
-    pack(bits, &nbit, e_index, E_BITS);
+    fields[nf++] = e_index;
 
     encode_lsps_scalar(lsp_indexes, lsps, LPC_ORD);
     for(i=0; i<LSP_SCALAR_INDEXES; i++) {
-	pack(bits, &nbit, lsp_indexes[i], lsp_bits(i));
+	fields[nf++] = lsp_indexes[i];
     }
 
-    assert(nbit == (unsigned)codec2_bits_per_frame(c2));
+    assert(nf == frame_layouts[CODEC2_MODE_OF(c2)].nfields);
+    frame_pack(&frame_layouts[CODEC2_MODE_OF(c2)], bits, fields, c2->gray);
 }
 
 
@@ -710,21 +2384,21 @@ void codec2_encode_1600(struct CODEC2 *c2, unsigned char * bits, short speech[])
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_decode_1600(struct CODEC2 *c2, short speech[], const unsigned char * bits)
+void codec2_decode_1600(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits)
 {
-    MODEL   model[4];
+    DECODE_SCRATCH(c2, 4);
     int     lsp_indexes[LPC_ORD];
     float   lsps[4][LPC_ORD];
     int     Wo_index, e_index;
     float   e[4];
-    float   snr;
     float   ak[4][LPC_ORD+1];
     int     i,j;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     float   weight;
-    COMP    Aw[FFT_ENC];
 
     assert(c2 != NULL);
+    frame_unpack(&frame_layouts[CODEC2_MODE_OF(c2)], fields, bits, c2->gray);
 
     /* only need to zero these out due to (unused) snr calculation */
 
@@ -737,28 +2411,28 @@ void codec2_decode_1600(struct CODEC2 *c2, short speech[], const unsigned char *
     /* this will partially fill the model params for the 4 x 10ms
        frames */
 
-    model[0].voiced = unpack(bits, &nbit, 1);
+    model[0].voiced = fields[nf++];
 
-    model[1].voiced = unpack(bits, &nbit, 1);
-    Wo_index = unpack(bits, &nbit, WO_BITS);
+    model[1].voiced = fields[nf++];
+    Wo_index = fields[nf++];
     model[1].Wo = decode_Wo(Wo_index, WO_BITS);
     model[1].L  = PI/model[1].Wo;
 
-    e_index = unpack(bits, &nbit, E_BITS);
+    e_index = fields[nf++];
     e[1] = decode_energy(e_index, E_BITS);
 
-    model[2].voiced = unpack(bits, &nbit, 1);
+    model[2].voiced = fields[nf++];
 
-    model[3].voiced = unpack(bits, &nbit, 1);
-    Wo_index = unpack(bits, &nbit, WO_BITS);
+    model[3].voiced = fields[nf++];
+    Wo_index = fields[nf++];
     model[3].Wo = decode_Wo(Wo_index, WO_BITS);
     model[3].L  = PI/model[3].Wo;
 
-    e_index = unpack(bits, &nbit, E_BITS);
+    e_index = fields[nf++];
     e[3] = decode_energy(e_index, E_BITS);
 
     for(i=0; i<LSP_SCALAR_INDEXES; i++) {
-	lsp_indexes[i] = unpack(bits, &nbit, lsp_bits(i));
+	lsp_indexes[i] = fields[nf++];
     }
     decode_lsps_scalar(&lsps[3][0], lsp_indexes, LPC_ORD);
     check_lsp_order(&lsps[3][0], LPC_ORD);
@@ -781,11 +2455,7 @@ void codec2_decode_1600(struct CODEC2 *c2, short speech[], const unsigned char *
 	interpolate_lsp_ver2(&lsps[i][0], c2->prev_lsps_dec, &lsps[3][0], weight, LPC_ORD);
     }
     for(i=0; i<4; i++) {
-	lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD);
-	aks_to_M2(c2->fft_fwd_cfg, &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, 0,
-                  c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw);
-	apply_lpc_correction(&model[i]);
-	synthesise_one_frame(c2, &speech[N*i], &model[i], Aw);
+	decode_one_frame(c2, speech, N*i, &lsps[i][0], &ak[i][0], LPC_ORD, &model[i], e[i], Aw);
     }
 
     /* update memories for next frame ----------------------------*/
@@ -796,7 +2466,9 @@ void codec2_decode_1600(struct CODEC2 *c2, short speech[], const unsigned char *
 	c2->prev_lsps_dec[i] = lsps[3][i];
 
 }
+#endif
 
+#if CODEC2_MODE_1400_EN
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_encode_1400
@@ -824,57 +2496,57 @@ void codec2_decode_1600(struct CODEC2 *c2, short speech[], const unsigned char *
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_encode_1400(struct CODEC2 *c2, unsigned char * bits, short speech[])
+void codec2_encode_1400(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis)
 {
-    MODEL   model;
+    const MODEL *model;
     float   lsps[LPC_ORD];
     float   ak[LPC_ORD+1];
     float   e;
     int     lsp_indexes[LPC_ORD];
     int     WoE_index;
     int     i;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
 
     assert(c2 != NULL);
 
-    memset(bits, '\0',  ((codec2_bits_per_frame(c2) + 7) / 8));
-
     /* frame 1: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, speech);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[0];
+    fields[nf++] = model->voiced;
 
     /* frame 2: - voicing, joint Wo & E -------------------------------*/
 
-    analyse_one_frame(c2, &model, &speech[N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[1];
+    fields[nf++] = model->voiced;
 
     /* need to run this just to get LPC energy */
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
+    e = analysis_lsps(c2, analysis, 0, lsps, ak, LPC_ORD);
 
-    WoE_index = encode_WoE(&model, e, c2->xq_enc);
-    pack(bits, &nbit, WoE_index, WO_E_BITS);
+    WoE_index = encode_WoE(model, e, c2->xq_enc);
+    fields[nf++] = WoE_index;
 
     /* frame 3: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, &speech[2*N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[2];
+    fields[nf++] = model->voiced;
 
     /* frame 4: - voicing, joint Wo & E, scalar LSPs ------------------*/
 
-    analyse_one_frame(c2, &model, &speech[3*N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[3];
+    fields[nf++] = model->voiced;
 
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
-    WoE_index = encode_WoE(&model, e, c2->xq_enc);
-    pack(bits, &nbit, WoE_index, WO_E_BITS);
+    e = analysis_lsps(c2, analysis, 1, lsps, ak, LPC_ORD);
+    WoE_index = encode_WoE(model, e, c2->xq_enc);
+    fields[nf++] = WoE_index;
 
     encode_lsps_scalar(lsp_indexes, lsps, LPC_ORD);
     for(i=0; i<LSP_SCALAR_INDEXES; i++) {
-	pack(bits, &nbit, lsp_indexes[i], lsp_bits(i));
+	fields[nf++] = lsp_indexes[i];
     }
 
-    assert(nbit == (unsigned)codec2_bits_per_frame(c2));
+    assert(nf == frame_layouts[CODEC2_MODE_OF(c2)].nfields);
+    frame_pack(&frame_layouts[CODEC2_MODE_OF(c2)], bits, fields, c2->gray);
 }
 
 
@@ -888,21 +2560,21 @@ void codec2_encode_1400(struct CODEC2 *c2, unsigned char * bits, short speech[])
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_decode_1400(struct CODEC2 *c2, short speech[], const unsigned char * bits)
+void codec2_decode_1400(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits)
 {
-    MODEL   model[4];
+    DECODE_SCRATCH(c2, 4);
     int     lsp_indexes[LPC_ORD];
     float   lsps[4][LPC_ORD];
     int     WoE_index;
     float   e[4];
-    float   snr;
     float   ak[4][LPC_ORD+1];
     int     i,j;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     float   weight;
-    COMP    Aw[FFT_ENC];
 
     assert(c2 != NULL);
+    frame_unpack(&frame_layouts[CODEC2_MODE_OF(c2)], fields, bits, c2->gray);
 
     /* only need to zero these out due to (unused) snr calculation */
 
@@ -915,20 +2587,20 @@ void codec2_decode_1400(struct CODEC2 *c2, short speech[], const unsigned char *
     /* this will partially fill the model params for the 4 x 10ms
        frames */
 
-    model[0].voiced = unpack(bits, &nbit, 1);
+    model[0].voiced = fields[nf++];
 
-    model[1].voiced = unpack(bits, &nbit, 1);
-    WoE_index = unpack(bits, &nbit, WO_E_BITS);
+    model[1].voiced = fields[nf++];
+    WoE_index = fields[nf++];
     decode_WoE(&model[1], &e[1], c2->xq_dec, WoE_index);
 
-    model[2].voiced = unpack(bits, &nbit, 1);
+    model[2].voiced = fields[nf++];
 
-    model[3].voiced = unpack(bits, &nbit, 1);
-    WoE_index = unpack(bits, &nbit, WO_E_BITS);
+    model[3].voiced = fields[nf++];
+    WoE_index = fields[nf++];
     decode_WoE(&model[3], &e[3], c2->xq_dec, WoE_index);
 
     for(i=0; i<LSP_SCALAR_INDEXES; i++) {
-	lsp_indexes[i] = unpack(bits, &nbit, lsp_bits(i));
+	lsp_indexes[i] = fields[nf++];
     }
     decode_lsps_scalar(&lsps[3][0], lsp_indexes, LPC_ORD);
     check_lsp_order(&lsps[3][0], LPC_ORD);
@@ -951,11 +2623,7 @@ void codec2_decode_1400(struct CODEC2 *c2, short speech[], const unsigned char *
 	interpolate_lsp_ver2(&lsps[i][0], c2->prev_lsps_dec, &lsps[3][0], weight, LPC_ORD);
     }
     for(i=0; i<4; i++) {
-	lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD);
-	aks_to_M2(c2->fft_fwd_cfg, &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, 0,
-                  c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw);
-	apply_lpc_correction(&model[i]);
-	synthesise_one_frame(c2, &speech[N*i], &model[i], Aw);
+	decode_one_frame(c2, speech, N*i, &lsps[i][0], &ak[i][0], LPC_ORD, &model[i], e[i], Aw);
     }
 
     /* update memories for next frame ----------------------------*/
@@ -966,7 +2634,9 @@ void codec2_decode_1400(struct CODEC2 *c2, short speech[], const unsigned char *
 	c2->prev_lsps_dec[i] = lsps[3][i];
 
 }
+#endif
 
+#if CODEC2_MODE_1300_EN
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_encode_1300
@@ -995,63 +2665,63 @@ void codec2_decode_1400(struct CODEC2 *c2, short speech[], const unsigned char *
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_encode_1300(struct CODEC2 *c2, unsigned char * bits, short speech[])
+void codec2_encode_1300(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis)
 {
-    MODEL   model;
+    const MODEL *model;
     float   lsps[LPC_ORD];
     float   ak[LPC_ORD+1];
     float   e;
     int     lsp_indexes[LPC_ORD];
     int     Wo_index, e_index;
     int     i;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     #ifdef PROFILE
     unsigned int quant_start;
     #endif
 
     assert(c2 != NULL);
 
-    memset(bits, '\0',  ((codec2_bits_per_frame(c2) + 7) / 8));
-
     /* frame 1: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, speech);
-    pack_natural_or_gray(bits, &nbit, model.voiced, 1, c2->gray);
+    model = &analysis->model[0];
+    fields[nf++] = model->voiced;
 
     /* frame 2: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, &speech[N]);
-    pack_natural_or_gray(bits, &nbit, model.voiced, 1, c2->gray);
+    model = &analysis->model[1];
+    fields[nf++] = model->voiced;
 
     /* frame 3: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, &speech[2*N]);
-    pack_natural_or_gray(bits, &nbit, model.voiced, 1, c2->gray);
+    model = &analysis->model[2];
+    fields[nf++] = model->voiced;
 
     /* frame 4: - voicing, scalar Wo & E, scalar LSPs ------------------*/
 
-    analyse_one_frame(c2, &model, &speech[3*N]);
-    pack_natural_or_gray(bits, &nbit, model.voiced, 1, c2->gray);
+    model = &analysis->model[3];
+    fields[nf++] = model->voiced;
 
-    Wo_index = encode_Wo(model.Wo, WO_BITS);
-    pack_natural_or_gray(bits, &nbit, Wo_index, WO_BITS, c2->gray);
+    Wo_index = encode_Wo(model->Wo, WO_BITS);
+    fields[nf++] = Wo_index;
 
     #ifdef PROFILE
     quant_start = machdep_profile_sample();
     #endif
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
+    e = analysis_lsps(c2, analysis, 1, lsps, ak, LPC_ORD);
     e_index = encode_energy(e, E_BITS);
-    pack_natural_or_gray(bits, &nbit, e_index, E_BITS, c2->gray);
+    fields[nf++] = e_index;
 
     encode_lsps_scalar(lsp_indexes, lsps, LPC_ORD);
     for(i=0; i<LSP_SCALAR_INDEXES; i++) {
-	pack_natural_or_gray(bits, &nbit, lsp_indexes[i], lsp_bits(i), c2->gray);
+	fields[nf++] = lsp_indexes[i];
     }
     #ifdef PROFILE
     machdep_profile_sample_and_log(quant_start, "    quant/packing");
     #endif
 
-    assert(nbit == (unsigned)codec2_bits_per_frame(c2));
+    assert(nf == frame_layouts[CODEC2_MODE_OF(c2)].nfields);
+    frame_pack(&frame_layouts[CODEC2_MODE_OF(c2)], bits, fields, c2->gray);
 }
 
 
@@ -1064,24 +2734,22 @@ void codec2_encode_1300(struct CODEC2 *c2, unsigned char * bits, short speech[])
   Decodes frames of 52 bits into 320 samples (40ms) of speech.
 
 \*---------------------------------------------------------------------------*/
-static int frames;
-void codec2_decode_1300(struct CODEC2 *c2, short speech[], const unsigned char * bits, float ber_est)
+void codec2_decode_1300(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits, float ber_est)
 {
-    MODEL   model[4];
+    DECODE_SCRATCH(c2, 4);
     int     lsp_indexes[LPC_ORD];
     float   lsps[4][LPC_ORD];
     int     Wo_index, e_index;
     float   e[4];
-    float   snr;
     float   ak[4][LPC_ORD+1];
     int     i,j;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     float   weight;
-    COMP    Aw[FFT_ENC];
     PROFILE_VAR(recover_start);
 
     assert(c2 != NULL);
-    frames+= 4;
+    frame_unpack(&frame_layouts[CODEC2_MODE_OF(c2)], fields, bits, c2->gray);
     /* only need to zero these out due to (unused) snr calculation */
 
     for(i=0; i<4; i++)
@@ -1093,20 +2761,20 @@ void codec2_decode_1300(struct CODEC2 *c2, short speech[], const unsigned char *
     /* this will partially fill the model params for the 4 x 10ms
        frames */
 
-    model[0].voiced = unpack_natural_or_gray(bits, &nbit, 1, c2->gray);
-    model[1].voiced = unpack_natural_or_gray(bits, &nbit, 1, c2->gray);
-    model[2].voiced = unpack_natural_or_gray(bits, &nbit, 1, c2->gray);
-    model[3].voiced = unpack_natural_or_gray(bits, &nbit, 1, c2->gray);
+    model[0].voiced = fields[nf++];
+    model[1].voiced = fields[nf++];
+    model[2].voiced = fields[nf++];
+    model[3].voiced = fields[nf++];
 
-    Wo_index = unpack_natural_or_gray(bits, &nbit, WO_BITS, c2->gray);
+    Wo_index = fields[nf++];
     model[3].Wo = decode_Wo(Wo_index, WO_BITS);
     model[3].L  = PI/model[3].Wo;
 
-    e_index = unpack_natural_or_gray(bits, &nbit, E_BITS, c2->gray);
+    e_index = fields[nf++];
     e[3] = decode_energy(e_index, E_BITS);
 
     for(i=0; i<LSP_SCALAR_INDEXES; i++) {
-	lsp_indexes[i] = unpack_natural_or_gray(bits, &nbit, lsp_bits(i), c2->gray);
+	lsp_indexes[i] = fields[nf++];
     }
     decode_lsps_scalar(&lsps[3][0], lsp_indexes, LPC_ORD);
     check_lsp_order(&lsps[3][0], LPC_ORD);
@@ -1116,7 +2784,8 @@ void codec2_decode_1300(struct CODEC2 *c2, short speech[], const unsigned char *
         model[0].voiced =  model[1].voiced = model[2].voiced = model[3].voiced = 0;
         e[3] = decode_energy(10, E_BITS);
         bw_expand_lsps(&lsps[3][0], LPC_ORD, 200.0, 200.0);
-        fprintf(stderr, "soft mute\n");
+        if (c2->stats_enabled)
+            c2->stats.soft_mutes++;
     }
 
     /* interpolate ------------------------------------------------*/
@@ -1128,17 +2797,13 @@ void codec2_decode_1300(struct CODEC2 *c2, short speech[], const unsigned char *
     for(i=0, weight=0.25; i<3; i++, weight += 0.25) {
 	interpolate_lsp_ver2(&lsps[i][0], c2->prev_lsps_dec, &lsps[3][0], weight, LPC_ORD);
         interp_Wo2(&model[i], &c2->prev_model_dec, &model[3], weight);
-        e[i] = interp_energy2(c2->prev_e_dec, e[3],weight);
     }
+    interp_energies(e, c2->prev_e_dec, e[3], 3);
 
     /* then recover spectral amplitudes */
 
     for(i=0; i<4; i++) {
-	lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD);
-	aks_to_M2(c2->fft_fwd_cfg, &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, 0,
-                  c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw);
-	apply_lpc_correction(&model[i]);
-	synthesise_one_frame(c2, &speech[N*i], &model[i], Aw);
+	decode_one_frame(c2, speech, N*i, &lsps[i][0], &ak[i][0], LPC_ORD, &model[i], e[i], Aw);
     }
     /*
     for(i=0; i<4; i++) {
@@ -1161,8 +2826,10 @@ void codec2_decode_1300(struct CODEC2 *c2, short speech[], const unsigned char *
 	c2->prev_lsps_dec[i] = lsps[3][i];
 
 }
+#endif
 
 
+#if CODEC2_MODE_1200_EN
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_encode_1200
@@ -1191,11 +2858,11 @@ void codec2_decode_1300(struct CODEC2 *c2, short speech[], const unsigned char *
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_encode_1200(struct CODEC2 *c2, unsigned char * bits, short speech[])
+void codec2_encode_1200(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis)
 {
 	
 
-    MODEL   model;
+    const MODEL *model;
     float   lsps[LPC_ORD];
     float   lsps_[LPC_ORD];
     float   ak[LPC_ORD+1];
@@ -1204,55 +2871,55 @@ void codec2_encode_1200(struct CODEC2 *c2, unsigned char * bits, short speech[])
     int     WoE_index;
     int     i;
     int     spare = 0;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
 
     assert(c2 != NULL);
 
-    memset(bits, '\0',  ((codec2_bits_per_frame(c2) + 7) / 8));
-
 	
 
     /* frame 1: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, speech); 	
-    pack(bits, &nbit, model.voiced, 1);	
+    model = &analysis->model[0]; 	
+    fields[nf++] = model->voiced;	
 	
 
     /* frame 2: - voicing, joint Wo & E -------------------------------*/
 
-    analyse_one_frame(c2, &model, &speech[N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[1];
+    fields[nf++] = model->voiced;
 	
 
     /* need to run this just to get LPC energy */
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
+    e = analysis_lsps(c2, analysis, 0, lsps, ak, LPC_ORD);
 
-    WoE_index = encode_WoE(&model, e, c2->xq_enc);
-    pack(bits, &nbit, WoE_index, WO_E_BITS);
+    WoE_index = encode_WoE(model, e, c2->xq_enc);
+    fields[nf++] = WoE_index;
 
 	
 
     /* frame 3: - voicing ---------------------------------------------*/
 
-    analyse_one_frame(c2, &model, &speech[2*N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[2];
+    fields[nf++] = model->voiced;
 
     /* frame 4: - voicing, joint Wo & E, scalar LSPs ------------------*/
 
-    analyse_one_frame(c2, &model, &speech[3*N]);
-    pack(bits, &nbit, model.voiced, 1);
+    model = &analysis->model[3];
+    fields[nf++] = model->voiced;
 
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD);
-    WoE_index = encode_WoE(&model, e, c2->xq_enc);
-    pack(bits, &nbit, WoE_index, WO_E_BITS);
+    e = analysis_lsps(c2, analysis, 1, lsps, ak, LPC_ORD);
+    WoE_index = encode_WoE(model, e, c2->xq_enc);
+    fields[nf++] = WoE_index;
 
     encode_lsps_vq(lsp_indexes, lsps, lsps_, LPC_ORD);
     for(i=0; i<LSP_PRED_VQ_INDEXES; i++) {
-	pack(bits, &nbit, lsp_indexes[i], lsp_pred_vq_bits(i));
+	fields[nf++] = lsp_indexes[i];
     }
-    pack(bits, &nbit, spare, 1);
+    fields[nf++] = spare;
 
-    assert(nbit == (unsigned)codec2_bits_per_frame(c2));
+    assert(nf == frame_layouts[CODEC2_MODE_OF(c2)].nfields);
+    frame_pack(&frame_layouts[CODEC2_MODE_OF(c2)], bits, fields, c2->gray);
 }
 
 
@@ -1266,21 +2933,21 @@ void codec2_encode_1200(struct CODEC2 *c2, unsigned char * bits, short speech[])
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_decode_1200(struct CODEC2 *c2, short speech[], const unsigned char * bits)
+void codec2_decode_1200(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits)
 {
-    MODEL   model[4];
+    DECODE_SCRATCH(c2, 4);
     int     lsp_indexes[LPC_ORD];
     float   lsps[4][LPC_ORD];
     int     WoE_index;
     float   e[4];
-    float   snr;
     float   ak[4][LPC_ORD+1];
     int     i,j;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     float   weight;
-    COMP    Aw[FFT_ENC];
 
     assert(c2 != NULL);
+    frame_unpack(&frame_layouts[CODEC2_MODE_OF(c2)], fields, bits, c2->gray);
 
     /* only need to zero these out due to (unused) snr calculation */
 
@@ -1293,20 +2960,20 @@ void codec2_decode_1200(struct CODEC2 *c2, short speech[], const unsigned char *
     /* this will partially fill the model params for the 4 x 10ms
        frames */
 
-    model[0].voiced = unpack(bits, &nbit, 1);
+    model[0].voiced = fields[nf++];
 
-    model[1].voiced = unpack(bits, &nbit, 1);
-    WoE_index = unpack(bits, &nbit, WO_E_BITS);
+    model[1].voiced = fields[nf++];
+    WoE_index = fields[nf++];
     decode_WoE(&model[1], &e[1], c2->xq_dec, WoE_index);
 
-    model[2].voiced = unpack(bits, &nbit, 1);
+    model[2].voiced = fields[nf++];
 
-    model[3].voiced = unpack(bits, &nbit, 1);
-    WoE_index = unpack(bits, &nbit, WO_E_BITS);
+    model[3].voiced = fields[nf++];
+    WoE_index = fields[nf++];
     decode_WoE(&model[3], &e[3], c2->xq_dec, WoE_index);
 
     for(i=0; i<LSP_PRED_VQ_INDEXES; i++) {
-	lsp_indexes[i] = unpack(bits, &nbit, lsp_pred_vq_bits(i));
+	lsp_indexes[i] = fields[nf++];
     }
     decode_lsps_vq(lsp_indexes, &lsps[3][0], LPC_ORD , 0);
     check_lsp_order(&lsps[3][0], LPC_ORD);
@@ -1329,11 +2996,7 @@ void codec2_decode_1200(struct CODEC2 *c2, short speech[], const unsigned char *
 	interpolate_lsp_ver2(&lsps[i][0], c2->prev_lsps_dec, &lsps[3][0], weight, LPC_ORD);
     }
     for(i=0; i<4; i++) {
-	lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD);
-	aks_to_M2(c2->fft_fwd_cfg, &ak[i][0], LPC_ORD, &model[i], e[i], &snr, 0, 0,
-                  c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw);
-	apply_lpc_correction(&model[i]);
-	synthesise_one_frame(c2, &speech[N*i], &model[i], Aw);
+	decode_one_frame(c2, speech, N*i, &lsps[i][0], &ak[i][0], LPC_ORD, &model[i], e[i], Aw);
     }
 
     /* update memories for next frame ----------------------------*/
@@ -1343,9 +3006,11 @@ void codec2_decode_1200(struct CODEC2 *c2, short speech[], const unsigned char *
     for(i=0; i<LPC_ORD; i++)
 	c2->prev_lsps_dec[i] = lsps[3][i];
 }
+#endif
 
 
 #ifndef CORTEX_M4
+#if CODEC2_MODE_700_EN
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_encode_700
@@ -1375,59 +3040,36 @@ void codec2_decode_1200(struct CODEC2 *c2, short speech[], const unsigned char *
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_encode_700(struct CODEC2 *c2, unsigned char * bits, short speech[])
+void codec2_encode_700(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis)
 {
-    MODEL   model;
+    const MODEL *model;
     float   lsps[LPC_ORD_LOW];
     float   mel[LPC_ORD_LOW];
     float   ak[LPC_ORD_LOW+1];
     float   e, f;
     int     indexes[LPC_ORD_LOW];
     int     Wo_index, e_index, i;
-    unsigned int nbit = 0;
-    float   bpf_out[4*N];
-    short   bpf_speech[4*N];
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     int     spare = 0;
 
     assert(c2 != NULL);
 
-    memset(bits, '\0',  ((codec2_bits_per_frame(c2) + 7) / 8));
-
-    /* band pass filter */
-
-    for(i=0; i<BPF_N; i++)
-        c2->bpf_buf[i] = c2->bpf_buf[4*N+i];
-    for(i=0; i<4*N; i++)
-        c2->bpf_buf[BPF_N+i] = speech[i];
-    inverse_filter(&c2->bpf_buf[BPF_N], bpf, 4*N, bpf_out, BPF_N);
-    for(i=0; i<4*N; i++)
-        bpf_speech[i] = bpf_out[i];
-
-    /* frame 1 --------------------------------------------------------*/
-
-    analyse_one_frame(c2, &model, bpf_speech);
-
-    /* frame 2 --------------------------------------------------------*/
-
-    analyse_one_frame(c2, &model, &bpf_speech[N]);
-
-    /* frame 3 --------------------------------------------------------*/
-
-    analyse_one_frame(c2, &model, &bpf_speech[2*N]);
+    /* frames 1, 2 and 3 are only analysed, see encode_analyse() ------*/
 
     /* frame 4: - voicing, scalar Wo & E, scalar LSPs -----------------*/
 
-    analyse_one_frame(c2, &model, &bpf_speech[3*N]);
-    pack(bits, &nbit, model.voiced, 1);
-    Wo_index = encode_log_Wo(model.Wo, 5);
-    pack_natural_or_gray(bits, &nbit, Wo_index, 5, c2->gray);
+    model = &analysis->model[3];
+    fields[nf++] = model->voiced;
+    Wo_index = encode_log_Wo(model->Wo, 5);
+    fields[nf++] = Wo_index;
 
 
-    e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD_LOW);
+    e = analysis_lsps(c2, analysis, 1, lsps, ak, LPC_ORD_LOW);
 
 
     e_index = encode_energy(e, 3);
-    pack_natural_or_gray(bits, &nbit, e_index, 3, c2->gray);
+    fields[nf++] = e_index;
 
     for(i=0; i<LPC_ORD_LOW; i++) {
         f = (4000.0/PI)*lsps[i];
@@ -1436,12 +3078,13 @@ void codec2_encode_700(struct CODEC2 *c2, unsigned char * bits, short speech[])
     encode_mels_scalar(indexes, mel, LPC_ORD_LOW);
 
     for(i=0; i<LPC_ORD_LOW; i++) {
-        pack_natural_or_gray(bits, &nbit, indexes[i], mel_bits(i), c2->gray);
+        fields[nf++] = indexes[i];
     }
 
-    pack_natural_or_gray(bits, &nbit, spare, 2, c2->gray);
+    fields[nf++] = spare;
 
-    assert(nbit == (unsigned)codec2_bits_per_frame(c2));
+    assert(nf == frame_layouts[CODEC2_MODE_OF(c2)].nfields);
+    frame_pack(&frame_layouts[CODEC2_MODE_OF(c2)], bits, fields, c2->gray);
 }
 
 
@@ -1455,22 +3098,23 @@ void codec2_encode_700(struct CODEC2 *c2, unsigned char * bits, short speech[])
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_decode_700(struct CODEC2 *c2, short speech[], const unsigned char * bits)
+void codec2_decode_700(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits)
 {
-    MODEL   model[4];
+    DECODE_SCRATCH(c2, 4);
     int     indexes[LPC_ORD_LOW];
     float   mel[LPC_ORD_LOW];
     float   lsps[4][LPC_ORD_LOW];
     int     Wo_index, e_index;
     float   e[4];
-    float   snr, f_;
+    float   f_;
     float   ak[4][LPC_ORD_LOW+1];
     int     i,j;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     float   weight;
-    COMP    Aw[FFT_ENC];
 
     assert(c2 != NULL);
+    frame_unpack(&frame_layouts[CODEC2_MODE_OF(c2)], fields, bits, c2->gray);
 
     /* only need to zero these out due to (unused) snr calculation */
 
@@ -1480,18 +3124,18 @@ void codec2_decode_700(struct CODEC2 *c2, short speech[], const unsigned char *
 
     /* unpack bits from channel ------------------------------------*/
 
-    model[3].voiced = unpack(bits, &nbit, 1);
+    model[3].voiced = fields[nf++];
     model[0].voiced = model[1].voiced = model[2].voiced = model[3].voiced;
 
-    Wo_index = unpack_natural_or_gray(bits, &nbit, 5, c2->gray);
+    Wo_index = fields[nf++];
     model[3].Wo = decode_log_Wo(Wo_index, 5);
     model[3].L  = PI/model[3].Wo;
 
-    e_index = unpack_natural_or_gray(bits, &nbit, 3, c2->gray);
+    e_index = fields[nf++];
     e[3] = decode_energy(e_index, 3);
 
     for(i=0; i<LPC_ORD_LOW; i++) {
-        indexes[i] = unpack_natural_or_gray(bits, &nbit, mel_bits(i), c2->gray);
+        indexes[i] = fields[nf++];
     }
 
     decode_mels_scalar(mel, indexes, LPC_ORD_LOW);
@@ -1527,14 +3171,10 @@ void codec2_decode_700(struct CODEC2 *c2, short speech[], const unsigned char *
     for(i=0, weight=0.25; i<3; i++, weight += 0.25) {
 	interpolate_lsp_ver2(&lsps[i][0], c2->prev_lsps_dec, &lsps[3][0], weight, LPC_ORD_LOW);
         interp_Wo2(&model[i], &c2->prev_model_dec, &model[3], weight);
-        e[i] = interp_energy2(c2->prev_e_dec, e[3],weight);
     }
+    interp_energies(e, c2->prev_e_dec, e[3], 3);
     for(i=0; i<4; i++) {
-	lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD_LOW);
-	aks_to_M2(c2->fft_fwd_cfg, &ak[i][0], LPC_ORD_LOW, &model[i], e[i], &snr, 0, 0,
-                  c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw);
-	apply_lpc_correction(&model[i]);
-	synthesise_one_frame(c2, &speech[N*i], &model[i], Aw);
+	decode_one_frame(c2, speech, N*i, &lsps[i][0], &ak[i][0], LPC_ORD_LOW, &model[i], e[i], Aw);
     }
 
     #ifdef DUMP
@@ -1542,7 +3182,7 @@ void codec2_decode_700(struct CODEC2 *c2, short speech[], const unsigned char *
     dump_ak_(&ak[3][0], LPC_ORD_LOW);
     dump_model(&model[3]);
     if (c2->softdec)
-        dump_softdec(c2->softdec, nbit);
+        dump_softdec(c2->softdec, codec2_bits_per_frame(c2));
     #endif
 
     /* update memories for next frame ----------------------------*/
@@ -1552,8 +3192,10 @@ void codec2_decode_700(struct CODEC2 *c2, short speech[], const unsigned char *
     for(i=0; i<LPC_ORD_LOW; i++)
 	c2->prev_lsps_dec[i] = lsps[3][i];
 }
+#endif
 
 
+#if CODEC2_MODE_700B_EN
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: codec2_encode_700b
@@ -1589,9 +3231,9 @@ void codec2_decode_700(struct CODEC2 *c2, short speech[], const unsigned char *
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_encode_700b(struct CODEC2 *c2, unsigned char * bits, short speech[])
+void codec2_encode_700b(struct CODEC2 *c2, unsigned char * bits, const struct CODEC2_ANALYSIS *analysis)
 {
-    MODEL   model;
+    const MODEL *model;
     float   lsps[LPC_ORD_LOW];
     float   mel[LPC_ORD_LOW];
     float   mel_[LPC_ORD_LOW];
@@ -1599,63 +3241,44 @@ void codec2_encode_700b(struct CODEC2 *c2, unsigned char * bits, short speech[])
     float   e, f;
     int     indexes[3];
     int     Wo_index, e_index, i;
-    unsigned int nbit = 0;
-    float   bpf_out[4*N];
-    short   bpf_speech[4*N];
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     int     spare = 0;
 
     assert(c2 != NULL);
 
-    memset(bits, '\0',  ((codec2_bits_per_frame(c2) + 7) / 8));
-
-    /* band pass filter */
-
-    for(i=0; i<BPF_N; i++)
-        c2->bpf_buf[i] = c2->bpf_buf[4*N+i];
-    for(i=0; i<4*N; i++)
-        c2->bpf_buf[BPF_N+i] = speech[i];
-    inverse_filter(&c2->bpf_buf[BPF_N], bpfb, 4*N, bpf_out, BPF_N);
-    for(i=0; i<4*N; i++)
-        bpf_speech[i] = bpf_out[i];
-
-    /* frame 1 --------------------------------------------------------*/
-
-    analyse_one_frame(c2, &model, bpf_speech);
-
-    /* frame 2 --------------------------------------------------------*/
-
-    analyse_one_frame(c2, &model, &bpf_speech[N]);
-
-    /* frame 3 --------------------------------------------------------*/
-
-    analyse_one_frame(c2, &model, &bpf_speech[2*N]);
+    /* frames 1, 2 and 3 are only analysed, see encode_analyse() ------*/
 
     /* frame 4: - voicing, scalar Wo & E, VQ mel LSPs -----------------*/
 
-    analyse_one_frame(c2, &model, &bpf_speech[3*N]);
-    pack(bits, &nbit, model.voiced, 1);
-    Wo_index = encode_log_Wo(model.Wo, 5);
-    pack_natural_or_gray(bits, &nbit, Wo_index, 5, c2->gray);
+    model = &analysis->model[3];
+    fields[nf++] = model->voiced;
+    Wo_index = encode_log_Wo(model->Wo, 5);
+    fields[nf++] = Wo_index;
 
-	e = speech_to_uq_lsps(lsps, ak, c2->Sn, c2->w, LPC_ORD_LOW);
+	e = analysis_lsps(c2, analysis, 1, lsps, ak, LPC_ORD_LOW);
 
 
     e_index = encode_energy(e, 3);
-    pack_natural_or_gray(bits, &nbit, e_index, 3, c2->gray);
+    fields[nf++] = e_index;
 
     for(i=0; i<LPC_ORD_LOW; i++) {
         f = (4000.0/PI)*lsps[i];
         mel[i] = floor(2595.0*log10(1.0 + f/700.0) + 0.5);
     }
-    lspmelvq_mbest_encode(indexes, mel, mel_, LPC_ORD_LOW, 5);
+    if (c2->vq_search == CODEC2_VQ_SEARCH_FAST)
+        lspmelvq_mbest_encode2(&c2->mbest, indexes, mel, mel_, LPC_ORD_LOW, LSPMELVQ_MBEST_FAST);
+    else
+        lspmelvq_mbest_encode2(&c2->mbest, indexes, mel, mel_, LPC_ORD_LOW, 5);
 
     for(i=0; i<3; i++) {
-        pack_natural_or_gray(bits, &nbit, indexes[i], lspmelvq_cb_bits(i), c2->gray);
+        fields[nf++] = indexes[i];
     }
 
-    pack_natural_or_gray(bits, &nbit, spare, 1, c2->gray);
+    fields[nf++] = spare;
 
-    assert(nbit == (unsigned)codec2_bits_per_frame(c2));
+    assert(nf == frame_layouts[CODEC2_MODE_OF(c2)].nfields);
+    frame_pack(&frame_layouts[CODEC2_MODE_OF(c2)], bits, fields, c2->gray);
 }
 
 
@@ -1669,22 +3292,23 @@ void codec2_encode_700b(struct CODEC2 *c2, unsigned char * bits, short speech[])
 
 \*---------------------------------------------------------------------------*/
 
-void codec2_decode_700b(struct CODEC2 *c2, short speech[], const unsigned char * bits)
+void codec2_decode_700b(struct CODEC2 *c2, const struct CODEC2_PCM *speech, const unsigned char * bits)
 {
-    MODEL   model[4];
+    DECODE_SCRATCH(c2, 4);
     int     indexes[3];
     float   mel[LPC_ORD_LOW];
     float   lsps[4][LPC_ORD_LOW];
     int     Wo_index, e_index;
     float   e[4];
-    float   snr, f_;
+    float   f_;
     float   ak[4][LPC_ORD_LOW+1];
     int     i,j;
-    unsigned int nbit = 0;
+    int     fields[FRAME_MAX_FIELDS];
+    int     nf = 0;
     float   weight;
-    COMP    Aw[FFT_ENC];
 
     assert(c2 != NULL);
+    frame_unpack(&frame_layouts[CODEC2_MODE_OF(c2)], fields, bits, c2->gray);
 
     /* only need to zero these out due to (unused) snr calculation */
 
@@ -1694,71 +3318,244 @@ void codec2_decode_700b(struct CODEC2 *c2, short speech[], const unsigned char *
 
     /* unpack bits from channel ------------------------------------*/
 
-    model[3].voiced = unpack(bits, &nbit, 1);
+    model[3].voiced = fields[nf++];
     model[0].voiced = model[1].voiced = model[2].voiced = model[3].voiced;
 
-    Wo_index = unpack_natural_or_gray(bits, &nbit, 5, c2->gray);
+    Wo_index = fields[nf++];
     model[3].Wo = decode_log_Wo(Wo_index, 5);
     model[3].L  = PI/model[3].Wo;
 
-    e_index = unpack_natural_or_gray(bits, &nbit, 3, c2->gray);
+    e_index = fields[nf++];
     e[3] = decode_energy(e_index, 3);
 
     for(i=0; i<3; i++) {
-        indexes[i] = unpack_natural_or_gray(bits, &nbit, lspmelvq_cb_bits(i), c2->gray);
+        indexes[i] = fields[nf++];
+    }
+
+    lspmelvq_decode(indexes, mel, LPC_ORD_LOW);
+
+    #define MEL_ROUND 10
+    for(i=1; i<LPC_ORD_LOW; i++) {
+        if (mel[i] <= mel[i-1]+MEL_ROUND) {
+            mel[i]+=MEL_ROUND/2;
+            mel[i-1]-=MEL_ROUND/2;
+            i = 1;
+        }
+    }
+
+    for(i=0; i<LPC_ORD_LOW; i++) {
+        f_ = 700.0*( pow(10.0, (float)mel[i]/2595.0) - 1.0);
+        lsps[3][i] = f_*(PI/4000.0);
+        //printf("lsps[3][%d]  %f\n", i, lsps[3][i]);
+    }
+
+    /* interpolate ------------------------------------------------*/
+
+    /* LSPs, Wo, and energy are sampled every 40ms so we interpolate
+       the 3 frames in between, then recover spectral amplitudes */
+
+    for(i=0, weight=0.25; i<3; i++, weight += 0.25) {
+	interpolate_lsp_ver2(&lsps[i][0], c2->prev_lsps_dec, &lsps[3][0], weight, LPC_ORD_LOW);
+        interp_Wo2(&model[i], &c2->prev_model_dec, &model[3], weight);
+    }
+    interp_energies(e, c2->prev_e_dec, e[3], 3);
+    for(i=0; i<4; i++) {
+	decode_one_frame(c2, speech, N*i, &lsps[i][0], &ak[i][0], LPC_ORD_LOW, &model[i], e[i], Aw);
+    }
+
+    #ifdef DUMP
+    dump_lsp_(&lsps[3][0]);
+    dump_ak_(&ak[3][0], LPC_ORD_LOW);
+    dump_model(&model[3]);
+    if (c2->softdec)
+        dump_softdec(c2->softdec, codec2_bits_per_frame(c2));
+    #endif
+
+    /* update memories for next frame ----------------------------*/
+
+    c2->prev_model_dec = model[3];
+    c2->prev_e_dec = e[3];
+    for(i=0; i<LPC_ORD_LOW; i++)
+	c2->prev_lsps_dec[i] = lsps[3][i];
+}
+#endif
+#endif
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: lsps_to_amplitudes
+  DATE CREATED: Oct 2026
+
+  Finds ak[], the spectral amplitudes of model and Aw[] from one
+  decoded or interpolated LSP vector, just as decoder_lsp_to_lpc() and
+  then aks_to_M2() would.  LSP vectors seen recently, e.g. repeated
+  frames of silence, are found in c2->env_cache and skip most of it.
+
+\*---------------------------------------------------------------------------*/
+
+static void lsps_to_amplitudes(struct CODEC2 *c2, float lsps[], float ak[], int order,
+                              MODEL *model, float e, COMP Aw[])
+{
+    LPC_ENV *env;
+    float    snr;
+    int      hit, i;
+
+    env = lpc_env_lookup(&c2->env_cache, lsps, order, &hit);
+    if (!hit)
+	decoder_lsp_to_lpc(lsps, env->ak, order);
+    for(i=0; i<=order; i++)
+	ak[i] = env->ak[i];
+
+    c2->aks_ws.env = env;
+    aks_to_M2(c2->fftr_fwd_cfg, ak, order, model, e, &snr, 0, 0,
+              c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw, &c2->aks_ws);
+    c2->aks_ws.env = NULL;
+
+    if (c2->stats_enabled) {
+	c2->stats.envelope_lookups++;
+	c2->stats.envelope_hits += hit;
+    }
+}
+
+/*
+   One 10 ms frame of the decoder, from its LSPs and energy, its
+   parameters also kept in c2->params_out[] for the transcoder.  While
+   codec2_decode_muted() is decoding only the excitation phase track
+   moves on, as phase_synth_zero_order() would move it, and the
+   overlap-add memory is cleared, so the first frame after unmuting
+   fades in rather than adding to a stale frame.
+*/
+
+static void decode_one_frame(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos, float lsps[],
+                             float ak[], int order, MODEL *model, float e, COMP Aw[])
+{
+    struct CODEC2_PARAMS *p;
+
+    if (c2->params_out != NULL) {
+	p = &c2->params_out[pos/N];
+	p->Wo = model->Wo;
+	p->L = model->L;
+	p->voiced = model->voiced;
+	p->e = e;
+	p->order = order;
+	memcpy(p->lsps, lsps, order*sizeof(float));
+    }
+
+    if (c2->muted) {
+	c2->muted_energy += e;
+	c2->muted_voiced += model->voiced != 0;
+	c2->ex_phase += (model->Wo)*N;
+	c2->ex_phase -= TWO_PI*floorf(c2->ex_phase/TWO_PI + 0.5);
+	clear_synthesis(c2);
+	return;
     }
 
-    lspmelvq_decode(indexes, mel, LPC_ORD_LOW);
+    lsps_to_amplitudes(c2, lsps, ak, order, model, e, Aw);
+    apply_lpc_correction(model);
+    synthesise_one_frame(c2, speech, pos, model, Aw);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: pcm_init
+  DATE CREATED: Oct 2026
+
+  Helpers for struct CODEC2_PCM.  pcm_init() describes n samples of
+  the plain buffer speech[].  pcm_span() points at sample pos and sets
+  *n to the samples left in its span.  pcm_frame() returns the first n
+  samples as a plain buffer, the caller's own if they are already one,
+  otherwise gathered into buf[].
+
+\*---------------------------------------------------------------------------*/
+
+static void pcm_init(struct CODEC2_PCM *pcm, short speech[], int n)
+{
+    pcm->span[0] = speech;
+    pcm->len[0] = n;
+    pcm->span[1] = NULL;
+    pcm->len[1] = 0;
+    pcm->stride = 1;
+}
 
-    #define MEL_ROUND 10
-    for(i=1; i<LPC_ORD_LOW; i++) {
-        if (mel[i] <= mel[i-1]+MEL_ROUND) {
-            mel[i]+=MEL_ROUND/2;
-            mel[i-1]-=MEL_ROUND/2;
-            i = 1;
-        }
+static short *pcm_span(const struct CODEC2_PCM *pcm, int pos, int *n)
+{
+    if (pos < pcm->len[0]) {
+	*n = pcm->len[0] - pos;
+	return &pcm->span[0][pos*pcm->stride];
     }
+    pos -= pcm->len[0];
+    assert(pos < pcm->len[1]);
+    *n = pcm->len[1] - pos;
+    return &pcm->span[1][pos*pcm->stride];
+}
 
-    for(i=0; i<LPC_ORD_LOW; i++) {
-        f_ = 700.0*( pow(10.0, (float)mel[i]/2595.0) - 1.0);
-        lsps[3][i] = f_*(PI/4000.0);
-        //printf("lsps[3][%d]  %f\n", i, lsps[3][i]);
+static const short *pcm_frame(const struct CODEC2_PCM *pcm, int n, short buf[])
+{
+    const short *s;
+    int          i, k, ns;
+
+    if ((pcm->stride == 1) && (pcm->len[0] >= n))
+	return pcm->span[0];
+    for(i=0; i<n; i+=ns) {
+	s = pcm_span(pcm, i, &ns);
+	if (ns > n-i)
+	    ns = n-i;
+	for(k=0; k<ns; k++)
+	    buf[i+k] = s[k*pcm->stride];
     }
+    return buf;
+}
 
-    /* interpolate ------------------------------------------------*/
+/* The 700 and 700B band pass filter of a frame of input speech */
 
-    /* LSPs, Wo, and energy are sampled every 40ms so we interpolate
-       the 3 frames in between, then recover spectral amplitudes */
+static void encode_bpf(struct CODEC2 *c2, const float h[], const struct CODEC2_PCM *speech, short bpf_speech[])
+{
+    if (c2->float_in != NULL)
+	bpf_filter_float(c2->bpf_buf, h, BPF_N, c2->float_in, c2->float_gain, bpf_speech, 4*N);
+    else
+	bpf_filter(c2->bpf_buf, h, BPF_N, pcm_frame(speech, 4*N, bpf_speech), bpf_speech, 4*N);
+}
 
-    for(i=0, weight=0.25; i<3; i++, weight += 0.25) {
-	interpolate_lsp_ver2(&lsps[i][0], c2->prev_lsps_dec, &lsps[3][0], weight, LPC_ORD_LOW);
-        interp_Wo2(&model[i], &c2->prev_model_dec, &model[3], weight);
-        e[i] = interp_energy2(c2->prev_e_dec, e[3],weight);
-    }
-    for(i=0; i<4; i++) {
-	lsp_to_lpc(&lsps[i][0], &ak[i][0], LPC_ORD_LOW);
-	aks_to_M2(c2->fft_fwd_cfg, &ak[i][0], LPC_ORD_LOW, &model[i], e[i], &snr, 0, 0,
-                  c2->lpc_pf, c2->bass_boost, c2->beta, c2->gamma, Aw);
-	apply_lpc_correction(&model[i]);
-	synthesise_one_frame(c2, &speech[N*i], &model[i], Aw);
-    }
+/*---------------------------------------------------------------------------*\
 
-    #ifdef DUMP
-    dump_lsp_(&lsps[3][0]);
-    dump_ak_(&ak[3][0], LPC_ORD_LOW);
-    dump_model(&model[3]);
-    if (c2->softdec)
-        dump_softdec(c2->softdec, nbit);
-    #endif
+  FUNCTION....: read_speech
+  DATE CREATED: Oct 2026
 
-    /* update memories for next frame ----------------------------*/
+  Adds N samples of input speech, from sample pos of speech, to the
+  analysis window.  codec2_encode_float() passes an empty speech, its
+  samples are at c2->float_in.  Each sample is written to both copies
+  of the ring, so the latest M samples are always contiguous at c2->Sn
+  and the older ones never move.
 
-    c2->prev_model_dec = model[3];
-    c2->prev_e_dec = e[3];
-    for(i=0; i<LPC_ORD_LOW; i++)
-	c2->prev_lsps_dec[i] = lsps[3][i];
+\*---------------------------------------------------------------------------*/
+
+static void read_speech(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos)
+{
+    const short *s;
+    int          i, k, n, p, stride;
+
+    p = c2->Sn_pos;
+    if (speech->len[0] == 0) {
+      assert(c2->float_in != NULL);
+      for(i=0; i<N; i++)
+        c2->Sn_buf[p+i] = c2->Sn_buf[p+M+i] = c2->float_gain*c2->float_in[pos+i];
+    }
+    else {
+      stride = speech->stride;
+      for(i=0; i<N; i+=n) {
+        s = pcm_span(speech, pos+i, &n);
+        if (n > N-i)
+          n = N-i;
+        for(k=0; k<n; k++)
+          c2->Sn_buf[p+i+k] = c2->Sn_buf[p+M+i+k] = s[k*stride];
+      }
+    }
+    p += N;
+    if (p == M)
+      p = 0;
+    c2->Sn_pos = p;
+    c2->Sn = &c2->Sn_buf[p];
 }
-#endif
 
 /*---------------------------------------------------------------------------*\
 
@@ -1766,13 +3563,20 @@ void codec2_decode_700b(struct CODEC2 *c2, short speech[], const unsigned char *
   AUTHOR......: David Rowe
   DATE CREATED: 23/8/2010
 
-  Synthesise 80 speech samples (10ms) from model parameters.
+  Synthesise 80 speech samples (10ms) from model parameters, to
+  sample pos of speech, or of c2->float_out scaled by c2->float_gain
+  and not clipped.
 
 \*---------------------------------------------------------------------------*/
 
-void synthesise_one_frame(struct CODEC2 *c2, short speech[], MODEL *model, COMP Aw[])
+void synthesise_one_frame(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos, MODEL *model, COMP Aw[])
 {
-    int     i;
+#ifdef CODEC2_FIXED_DECODER
+    short  *d;
+    float   g;
+    int     i, k, n, clipped;
+#endif
+    unsigned int t = 0;
     PROFILE_VAR(phase_start, pf_start, synth_start);
 
     #ifdef DUMP
@@ -1780,30 +3584,155 @@ void synthesise_one_frame(struct CODEC2 *c2, short speech[], MODEL *model, COMP
     #endif
 
     PROFILE_SAMPLE(phase_start);
+    STATS_SAMPLE(c2, t);
 
-    phase_synth_zero_order(c2->fft_fwd_cfg, model, &c2->ex_phase, Aw);
+    phase_synth_zero_order(c2->fft_fwd_cfg, model, &c2->ex_phase, Aw, &c2->rand_state);
 
     PROFILE_SAMPLE_AND_LOG(pf_start, phase_start, "    phase_synth");
+    STATS_ACCUM(c2, synthesis_cycles, t);
 
-    postfilter(model, &c2->bg_est);
+    postfilter(model, &c2->bg_est, &c2->rand_state);
 
     PROFILE_SAMPLE_AND_LOG(synth_start, pf_start, "    postfilter");
+    STATS_ACCUM(c2, postfilter_cycles, t);
+
+    /* into a mix, see codec2_mix_add() */
+
+    if (c2->mix_Sw != NULL) {
+	synth_accumulate(&c2->mix_Sw[(pos/N)*(FFT_DEC/2+1)], model, c2->mix_gain);
+	clear_synthesis(c2);
+	STATS_ACCUM(c2, synthesis_cycles, t);
+	return;
+    }
 
-    synthesise(c2->fft_inv_cfg, c2->Sn_, model, c2->Pn, 1);
+#ifdef CODEC2_FIXED_DECODER
+    synthesise_fixed(c2->Sn_fx, model, c2->Pn_q15, 1);
 
     PROFILE_SAMPLE_AND_LOG2(synth_start, "    synth");
 
-    ear_protection(c2->Sn_, N);
+    if (ear_protection_fixed(c2->Sn_fx, N) && c2->stats_enabled)
+	c2->stats.ear_protection++;
 
-    for(i=0; i<N; i++) {
-	if (c2->Sn_[i] > 32767.0)
-	    speech[i] = 32767;
-	else if (c2->Sn_[i] < -32767.0)
-	    speech[i] = -32767;
-	else
-	    speech[i] = c2->Sn_[i];
+    if (c2->float_out != NULL) {
+	g = c2->float_gain/(float)(1 << FIXED_SN_SHIFT);
+	for(i=0; i<N; i++)
+	    c2->float_out[pos+i] = g*c2->Sn_fx[i];
+	STATS_ACCUM(c2, synthesis_cycles, t);
+	return;
+    }
+
+    clipped = 0;
+    for(i=0; i<N; i+=n) {
+	d = pcm_span(speech, pos+i, &n);
+	if (n > N-i)
+	    n = N-i;
+	for(k=i; k<i+n; k++, d+=speech->stride) {
+	    if (c2->Sn_fx[k] > (32767 << FIXED_SN_SHIFT)) {
+		*d = 32767;
+		clipped++;
+	    }
+	    else if (c2->Sn_fx[k] < -(32767 << FIXED_SN_SHIFT)) {
+		*d = -32767;
+		clipped++;
+	    }
+	    else
+		*d = c2->Sn_fx[k] >> FIXED_SN_SHIFT;
+	}
+    }
+    if (c2->stats_enabled)
+	c2->stats.clipped_samples += clipped;
+#else
+    if (c2->synth_up != NULL) {
+	synthesise_up(c2->synth_up, model);
+	PROFILE_SAMPLE_AND_LOG2(synth_start, "    synth");
+	write_speech(c2, speech, pos*c2->synth_up->k, c2->synth_up->Sn_, c2->synth_up->k*N);
+    }
+    else {
+	synthesise(c2->fftr_inv_cfg, c2->Sn_, model, c2->Pn, 1, &c2->synth_ws);
+	PROFILE_SAMPLE_AND_LOG2(synth_start, "    synth");
+	write_speech(c2, speech, pos, c2->Sn_, N);
+    }
+#endif
+
+    STATS_ACCUM(c2, synthesis_cycles, t);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: synthesise_mixed_frame()
+  DATE CREATED: Oct 2026
+
+  synthesise_one_frame() of a 10 ms frame mixed by codec2_mix_add(),
+  the summed harmonics of every stream in Sw[], which is left zero.
+  The float synthesis is used whatever the build, always at FS.
+
+\*---------------------------------------------------------------------------*/
+
+void synthesise_mixed_frame(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos, COMP Sw[])
+{
+    unsigned int t = 0;
+
+    STATS_SAMPLE(c2, t);
+    synth_spectrum(c2->fftr_inv_cfg, c2->Sn_, Sw, c2->Pn, 1, &c2->synth_ws);
+    write_speech(c2, speech, pos, c2->Sn_, N);
+    STATS_ACCUM(c2, synthesis_cycles, t);
+}
+
+/* Ear protection then the n samples of float synthesis output Sn_[],
+   c2->Sn_ or the output rate's, to sample pos of speech, clipped, or
+   to c2->float_out */
+
+static void write_speech(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos, float Sn_[], int n)
+{
+    short  *d;
+    float   g;
+    int     i, k, m, clipped;
+
+    if (ear_protection(Sn_, n) && c2->stats_enabled)
+	c2->stats.ear_protection++;
+
+    if (c2->float_out != NULL) {
+	g = c2->float_gain;
+	for(i=0; i<n; i++)
+	    c2->float_out[pos+i] = g*Sn_[i];
+	return;
     }
 
+    clipped = 0;
+    for(i=0; i<n; i+=m) {
+	d = pcm_span(speech, pos+i, &m);
+	if (m > n-i)
+	    m = n-i;
+	for(k=i; k<i+m; k++, d+=speech->stride) {
+	    if (Sn_[k] > 32767.0) {
+		*d = 32767;
+		clipped++;
+	    }
+	    else if (Sn_[k] < -32767.0) {
+		*d = -32767;
+		clipped++;
+	    }
+	    else
+		*d = Sn_[k];
+	}
+    }
+
+    if (c2->stats_enabled)
+	c2->stats.clipped_samples += clipped;
+}
+
+/* Clears the overlap-add memory of a stream whose frames went
+   somewhere other than its own synthesis, so the next frame it does
+   synthesise fades in rather than adding to a stale one */
+
+static void clear_synthesis(struct CODEC2 *c2)
+{
+    memset(c2->Sn_, 0, sizeof(c2->Sn_));
+    if (c2->synth_up != NULL)
+	synth_up_clear(c2->synth_up);
+#ifdef CODEC2_FIXED_DECODER
+    memset(c2->Sn_fx, 0, sizeof(c2->Sn_fx));
+#endif
 }
 
 /*---------------------------------------------------------------------------*\
@@ -1813,61 +3742,80 @@ void synthesise_one_frame(struct CODEC2 *c2, short speech[], MODEL *model, COMP
   DATE CREATED: 23/8/2010
 
   Extract sinusoidal model parameters from 80 speech samples (10ms of
-  speech).
+  speech), from sample pos of speech.
 
 \*---------------------------------------------------------------------------*/
 
-void analyse_one_frame(struct CODEC2 *c2, MODEL *model, short speech[])
+void analyse_one_frame(struct CODEC2 *c2, MODEL *model, const struct CODEC2_PCM *speech, int pos)
 {
 	
 	
-    COMP    Sw[FFT_ENC];
-    COMP    Sw_[FFT_ENC];
-    COMP    Ew[FFT_ENC];
+    COMP   *Sw;
     float   pitch;
-    int     i;
+    unsigned int t = 0;
     PROFILE_VAR(dft_start, nlp_start, model_start, two_stage, estamps);
 
+    assert(c2->nlp != NULL);                /* not a codec2_create_decoder() instance */
 	
-    /* Read input speech */
-
-    for(i=0; i<M-N; i++)
-      c2->Sn[i] = c2->Sn[i+N];
-    for(i=0; i<N; i++)
-      c2->Sn[i+M-N] = speech[i];	
+    STATS_SAMPLE(c2, t);
+    read_speech(c2, speech, pos);
 
     PROFILE_SAMPLE(dft_start);	
 
-	
-    dft_speech(c2->fft_fwd_cfg, Sw, c2->Sn, c2->w);
+    /* A channel bank has already done the DFTs and the front half of
+       NLP for this frame, across several channels at once. */
+
+    if (c2->bank_Sw != NULL) {
+	Sw = c2->bank_Sw;
+	c2->bank_Sw += FFT_ENC;
+    }
+    else {
+	Sw = c2->Sw_enc;
+	dft_speech(c2->fftr_fwd_cfg, Sw, c2->Sn, c2->w);
+    }
     PROFILE_SAMPLE_AND_LOG(nlp_start, dft_start, "    dft_speech");
 
 	
 
     /* Estimate pitch */
 
-    nlp(c2->nlp,c2->Sn,N,P_MIN,P_MAX,&pitch,Sw, c2->W, &c2->prev_Wo_enc);
+    STATS_ACCUM(c2, analysis_cycles, t);
+    if (c2->bank_Fw != NULL) {
+	nlp_pitch(c2->bank_Fw, P_MIN, P_MAX, &pitch, Sw, c2->W, &c2->prev_Wo_enc);
+	c2->bank_Fw += PE_FFT_SIZE/2+1;
+    }
+    else
+	nlp(c2->nlp,c2->Sn,N,P_MIN,P_MAX,&pitch,Sw, c2->W, &c2->prev_Wo_enc);
     PROFILE_SAMPLE_AND_LOG(model_start, nlp_start, "    nlp");
+    STATS_ACCUM(c2, nlp_cycles, t);
 
     model->Wo = TWO_PI/pitch;
     model->L = PI/model->Wo;
 
 	
 
-    /* estimate model parameters */
+    /* estimate model parameters, all from one pass over the power
+       spectrum */
 
-    two_stage_pitch_refinement(model, Sw);	
+    sw_power(c2->Sw_pow, Sw);
+    if (c2->pitch_refine == CODEC2_PITCH_REFINE_FAST)
+	fast_pitch_refinement(model, c2->Sw_pow);
+    else if (c2->pitch_refine == CODEC2_PITCH_REFINE_COARSE)
+	coarse_pitch_refinement(model, c2->Sw_pow);
+    else
+	two_stage_pitch_refinement(model, c2->Sw_pow);
     PROFILE_SAMPLE_AND_LOG(two_stage, model_start, "    two_stage");
-    estimate_amplitudes(model, Sw, c2->W, 0);	
+    estimate_amplitudes(model, Sw, c2->Sw_pow, 0);	
     PROFILE_SAMPLE_AND_LOG(estamps, two_stage, "    est_amps");
 
 	
-    est_voicing_mbe(model, Sw, c2->W, Sw_, Ew);
+    est_voicing_mbe(model, Sw, c2->W, c2->voicing_tab, c2->Sw_pow, NULL, NULL, NULL);
 	
 	
 
     c2->prev_Wo_enc = model->Wo;
     PROFILE_SAMPLE_AND_LOG2(estamps, "    est_voicing");
+    STATS_ACCUM(c2, analysis_cycles, t);
     #ifdef DUMP
     dump_model(model);
     #endif
@@ -1887,7 +3835,7 @@ void analyse_one_frame(struct CODEC2 *c2, MODEL *model, short speech[])
 
 \*---------------------------------------------------------------------------*/
 
-static void ear_protection(float in_out[], int n) {
+static int ear_protection(float in_out[], int n) {
     float max_sample, over, gain;
     int   i;
 
@@ -1911,7 +3859,10 @@ static void ear_protection(float in_out[], int n) {
         //fprintf(stderr, "gain: %f\n", gain);
         for(i=0; i<n; i++)
             in_out[i] *= gain;
+        return 1;
     }
+
+    return 0;
 }
 
 void codec2_set_lpc_post_filter(struct CODEC2 *c2, int enable, int bass_boost, float beta, float gamma)
@@ -1922,6 +3873,7 @@ void codec2_set_lpc_post_filter(struct CODEC2 *c2, int enable, int bass_boost, f
     c2->bass_boost = bass_boost;
     c2->beta = beta;
     c2->gamma = gamma;
+    lpc_env_cache_init(&c2->env_cache);
 }
 
 /*
@@ -1932,27 +3884,20 @@ void codec2_set_lpc_post_filter(struct CODEC2 *c2, int enable, int bass_boost, f
 
 int codec2_get_spare_bit_index(struct CODEC2 *c2)
 {
+    const FRAME_LAYOUT *l;
+    int                 i, bit;
+
     assert(c2 != NULL);
 
-    switch(c2->mode) {
-    case CODEC2_MODE_1300:
-        return 2; // bit 2 (3th bit) is v2 (third voicing bit)
-        break;
-    case CODEC2_MODE_1400:
-        return 10; // bit 10 (11th bit) is v2 (third voicing bit)
-        break;
-    case CODEC2_MODE_1600:
-        return 15; // bit 15 (16th bit) is v2 (third voicing bit)
-        break;
-    case CODEC2_MODE_700:
-        return 26; // bits 26 and 27 are spare
-        break;
-    case CODEC2_MODE_700B:
-        return 27; // bit 27 is spare
-        break;
-    }
+    /* 1300, 1400, 1600: the third voicing bit, 700 and 700B: the spare
+       bits at the end */
 
-    return -1;
+    l = &frame_layouts[CODEC2_MODE_OF(c2)];
+    if (l->spare < 0)
+	return -1;
+    for(i=0, bit=0; i<l->spare; i++)
+	bit += l->field[i].width;
+    return bit;
 }
 
 /*
@@ -1968,7 +3913,7 @@ int codec2_rebuild_spare_bit(struct CODEC2 *c2, int unpacked_bits[])
 
     v1 = unpacked_bits[1];
 
-    switch(c2->mode) {
+    switch(CODEC2_MODE_OF(c2)) {
     case CODEC2_MODE_1300:
 
         v3 = unpacked_bits[1+1+1];
@@ -2014,9 +3959,420 @@ void codec2_set_natural_or_gray(struct CODEC2 *c2, int gray)
     c2->gray = gray;
 }
 
-void codec2_set_softdec(struct CODEC2 *c2, float *softdec)
+void codec2_set_softdec(struct CODEC2 *c2, const float *softdec)
 {
     assert(c2 != NULL);
     c2->softdec = softdec;
 }
 
+/*
+   Seeds the random number generator used for unvoiced phase synthesis
+   and the post filter.  Each instance has its own generator, seeded
+   to 1 by codec2_create(), so decoding the same bit stream from the
+   same seed gives bit exact output regardless of other instances.
+*/
+
+void codec2_set_rand_seed(struct CODEC2 *c2, unsigned long seed)
+{
+    assert(c2 != NULL);
+    c2->rand_state = seed;
+}
+
+/*
+   Selects the encoder VQ search.  CODEC2_VQ_SEARCH_FAST keeps fewer
+   survivors in the M-best mel LSP search used by 700B, trading a small
+   loss in LSP quantiser SNR for encoder throughput.  Modes without an
+   M-best search are unaffected.
+*/
+
+void codec2_set_vq_search(struct CODEC2 *c2, int search)
+{
+    assert(c2 != NULL);
+    assert((search == CODEC2_VQ_SEARCH_FULL) || (search == CODEC2_VQ_SEARCH_FAST));
+    c2->vq_search = search;
+}
+
+/*
+   Selects the encoder pitch refinement.  CODEC2_PITCH_REFINE_FAST
+   searches a coarser grid about the NLP pitch and abandons trial
+   pitches that can't win, see fast_pitch_refinement().  The pitch
+   sometimes differs from the full search by a fraction of a sample,
+   all modes are affected.  CODEC2_PITCH_REFINE_COARSE also halves the
+   resolution of the fine search, see coarse_pitch_refinement().
+*/
+
+void codec2_set_pitch_refine(struct CODEC2 *c2, int refine)
+{
+    assert(c2 != NULL);
+    assert((refine >= CODEC2_PITCH_REFINE_FULL) && (refine <= CODEC2_PITCH_REFINE_COARSE));
+    c2->pitch_refine = refine;
+}
+
+/*
+   Conditions the encoder's LPC analysis with a Gaussian lag window of
+   bw Hz and a 1.0001 white noise correction, which smooths the LPC
+   envelope of high pitched voices and keeps near singular frames in
+   hand.  bw <= 0 turns it off, the default, for the reference bits.
+   All modes are affected, only the LPC path, not the analysis the
+   pitch estimator and voicing see.
+*/
+
+void codec2_set_lag_window(struct CODEC2 *c2, float bw)
+{
+    assert(c2 != NULL);
+    c2->lag_window = bw > 0.0;
+    if (c2->lag_window)
+	make_lag_window(c2->lag_win, LPC_ORD, bw, 1.0001);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_set_complexity
+  DATE CREATED: Oct 2026
+
+  Sets the encoder's search options for a complexity level, from
+  CODEC2_COMPLEXITY_FULL, the defaults, to CODEC2_COMPLEXITY_MIN.
+  Each level keeps the savings of the level above and adds one:
+
+    1  CODEC2_PITCH_REFINE_FAST
+    2  CODEC2_VQ_SEARCH_FAST, 700B only
+    3  CODEC2_PITCH_REFINE_COARSE
+
+  It may be changed between any two frames, e.g. to shed load when
+  the CPU is busy.  The decoder is unaffected, and so is the bit
+  stream format.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_set_complexity(struct CODEC2 *c2, int level)
+{
+    assert(c2 != NULL);
+    assert((level >= CODEC2_COMPLEXITY_FULL) && (level <= CODEC2_COMPLEXITY_MIN));
+
+    if (level >= 3)
+	c2->pitch_refine = CODEC2_PITCH_REFINE_COARSE;
+    else if (level >= 1)
+	c2->pitch_refine = CODEC2_PITCH_REFINE_FAST;
+    else
+	c2->pitch_refine = CODEC2_PITCH_REFINE_FULL;
+    c2->vq_search = level >= 2 ? CODEC2_VQ_SEARCH_FAST : CODEC2_VQ_SEARCH_FULL;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                       DECODER STATE SNAPSHOTS
+
+  Layout of the codec2_save_state() blob, all fields little endian:
+
+    offset  size
+        0      4  magic "C2DS"
+        4      1  version, STATE_VERSION
+        5      1  mode
+        6      1  stream_nbits
+        7      1  prev_model_dec.voiced
+        8      8  stream_bits[]
+       16      8  rand_state
+       24      4  f32 ex_phase
+       28      4  f32 bg_est
+       32      4  f32 prev_e_dec
+       36      4  f32 prev_model_dec.Wo
+       40      4  prev_model_dec.L
+       44     40  f32 prev_lsps_dec[LPC_ORD]
+       84      8  f32 xq_dec[2]
+       92    4*N  f32 Sn_[N..2N-1]
+
+  Only the top half of Sn_[] is history, synthesise() overwrites the
+  bottom half each frame.  Interpolation only looks at Wo, L and the
+  voicing of the previous model.  Fixed point builds store Sn_fx[]
+  scaled back to samples, exactly as it has just FIXED_SN_SHIFT
+  fraction bits, so a state moves between float and fixed point
+  builds (with a small mismatch in the tail rather than a glitch).
+
+\*---------------------------------------------------------------------------*/
+
+#define STATE_MAGIC   0x53443243   /* "C2DS" */
+#define STATE_VERSION 1
+
+static void state_put32(unsigned char *p, unsigned long x)
+{
+    p[0] = x & 0xff;
+    p[1] = (x >> 8) & 0xff;
+    p[2] = (x >> 16) & 0xff;
+    p[3] = (x >> 24) & 0xff;
+}
+
+static unsigned long state_get32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+	((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static void state_putf(unsigned char *p, float x)
+{
+    unsigned int u;
+
+    assert(sizeof(u) == sizeof(x));
+    memcpy(&u, &x, sizeof(u));
+    state_put32(p, u);
+}
+
+static float state_getf(const unsigned char *p)
+{
+    unsigned int u = state_get32(p);
+    float        x;
+
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_save_state
+  DATE CREATED: Oct 2026
+
+  Serialises the decoder's history into buf[], CODEC2_STATE_BYTES
+  bytes.  codec2_restore_state() puts it into another instance of the
+  same mode, which then decodes the rest of the stream bit exactly as
+  this one would, e.g. to seek without decoding from the start or to
+  move a session to another process.  Encoder state and configuration
+  (post filter, gray coding, soft decisions) are not included.  At
+  other output rates (codec2_set_output_rate()) the synthesis history
+  is kept at 8000 Hz, and is interpolated on restoring, so the first
+  frame after is close to but not bit exact with an unbroken decode.
+
+  Returns the number of bytes written, or -1 if nbytes is too small.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_save_state(struct CODEC2 *c2, unsigned char buf[], int nbytes)
+{
+    unsigned long long r;
+    int                i;
+
+    assert(c2 != NULL);
+    assert(buf != NULL);
+    if (nbytes < CODEC2_STATE_BYTES)
+	return -1;
+
+    state_put32(&buf[0], STATE_MAGIC);
+    buf[4] = STATE_VERSION;
+    buf[5] = CODEC2_MODE_OF(c2);
+    buf[6] = c2->stream_nbits;
+    buf[7] = c2->prev_model_dec.voiced != 0;
+    memcpy(&buf[8], c2->stream_bits, 8);
+    r = c2->rand_state;
+    state_put32(&buf[16], r & 0xffffffff);
+    state_put32(&buf[20], (r >> 16) >> 16);
+    state_putf(&buf[24], c2->ex_phase);
+    state_putf(&buf[28], c2->bg_est);
+    state_putf(&buf[32], c2->prev_e_dec);
+    state_putf(&buf[36], c2->prev_model_dec.Wo);
+    state_put32(&buf[40], c2->prev_model_dec.L);
+    for(i=0; i<LPC_ORD; i++)
+	state_putf(&buf[44+4*i], c2->prev_lsps_dec[i]);
+    state_putf(&buf[84], c2->xq_dec[0]);
+    state_putf(&buf[88], c2->xq_dec[1]);
+    for(i=0; i<N; i++) {
+#ifdef CODEC2_FIXED_DECODER
+	state_putf(&buf[92+4*i], ldexpf((float)c2->Sn_fx[N+i], -FIXED_SN_SHIFT));
+#else
+	if (c2->synth_up != NULL)
+	    state_putf(&buf[92+4*i], c2->synth_up->Sn_[c2->synth_up->k*(N+i)]);
+	else
+	    state_putf(&buf[92+4*i], c2->Sn_[N+i]);
+#endif
+    }
+
+    return CODEC2_STATE_BYTES;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_restore_state
+  DATE CREATED: Oct 2026
+
+  Loads a state saved by codec2_save_state() into c2.  Returns 0, or
+  -1 (leaving c2 as it was) if buf[] isn't a state of c2's mode.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_restore_state(struct CODEC2 *c2, const unsigned char buf[], int nbytes)
+{
+    unsigned long long r;
+    int                i, L;
+
+    assert(c2 != NULL);
+    assert(buf != NULL);
+    if ((nbytes < CODEC2_STATE_BYTES) || (state_get32(&buf[0]) != STATE_MAGIC) ||
+	(buf[4] != STATE_VERSION) || (buf[5] != CODEC2_MODE_OF(c2)) || (buf[6] > 8))
+	return -1;
+    L = state_get32(&buf[40]);
+    if ((L < 0) || (L > MAX_AMP))
+	return -1;
+
+    c2->stream_nbits = buf[6];
+    memcpy(c2->stream_bits, &buf[8], 8);
+    r = state_get32(&buf[16]) | (((unsigned long long)state_get32(&buf[20]) << 16) << 16);
+    c2->rand_state = r;
+    c2->ex_phase = state_getf(&buf[24]);
+    c2->bg_est = state_getf(&buf[28]);
+    c2->prev_e_dec = state_getf(&buf[32]);
+    c2->prev_model_dec.Wo = state_getf(&buf[36]);
+    c2->prev_model_dec.L = L;
+    c2->prev_model_dec.voiced = buf[7];
+    for(i=0; i<LPC_ORD; i++)
+	c2->prev_lsps_dec[i] = state_getf(&buf[44+4*i]);
+    c2->xq_dec[0] = state_getf(&buf[84]);
+    c2->xq_dec[1] = state_getf(&buf[88]);
+    for(i=0; i<N; i++) {
+#ifdef CODEC2_FIXED_DECODER
+	c2->Sn_fx[i] = 0;
+	c2->Sn_fx[N+i] = (q31_t)floorf(ldexpf(state_getf(&buf[92+4*i]), FIXED_SN_SHIFT) + 0.5);
+#else
+	c2->Sn_[i] = 0.0;
+	c2->Sn_[N+i] = state_getf(&buf[92+4*i]);
+#endif
+    }
+#ifndef CODEC2_FIXED_DECODER
+    if (c2->synth_up != NULL) {
+	float *Sn_ = c2->synth_up->Sn_;
+	float  x1;
+	int    k = c2->synth_up->k, j;
+
+	synth_up_clear(c2->synth_up);
+	for(i=0; i<N; i++) {
+	    x1 = (i < N-1) ? c2->Sn_[N+i+1] : 0.0;
+	    for(j=0; j<k; j++)
+		Sn_[k*(N+i)+j] = c2->Sn_[N+i] + (x1 - c2->Sn_[N+i])*j/k;
+	}
+    }
+#endif
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_enable_stats
+  DATE CREATED: Oct 2026
+
+  Turns the per instance counters read by codec2_get_stats() on or
+  off.  Enabling clears them.  When off the only cost is a branch per
+  stage, so they can be left compiled in for production builds.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_enable_stats(struct CODEC2 *c2, int enable)
+{
+    assert(c2 != NULL);
+
+    if (enable) {
+	machdep_profile_clock_init();
+	memset(&c2->stats, 0, sizeof(c2->stats));
+	c2->stats.cycles_per_us = machdep_profile_ticks_per_us();
+    }
+    c2->stats_enabled = enable;
+}
+
+void codec2_get_stats(struct CODEC2 *c2, struct CODEC2_STATS *stats)
+{
+    assert(c2 != NULL);
+    assert(stats != NULL);
+    *stats = c2->stats;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_set_deadline
+  DATE CREATED: Oct 2026
+
+  Sets the time each encode or decode call must finish in, in ticks of
+  the stats clock (cycles_per_us per micro second), 0 for none.  Calls
+  that take longer are counted in deadline_misses, so a real time
+  caller can watch for overruns while the stats are on.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_set_deadline(struct CODEC2 *c2, unsigned long cycles)
+{
+    assert(c2 != NULL);
+    c2->deadline = cycles;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_set_flush_denormals
+  DATE CREATED: Oct 2026
+
+  With enable set each encode and decode call runs with the FPU
+  flushing denormals to zero (FTZ and DAZ on x86, FZ on ARM), the
+  caller's setting put back before it returns.  Filter states decaying
+  on a silent channel then never take the slow denormal path, so every
+  frame costs about the same.  The output may differ from a call
+  without, in the last bits of very quiet speech.  Off by default.
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_set_flush_denormals(struct CODEC2 *c2, int enable)
+{
+    assert(c2 != NULL);
+    c2->flush_denormals = enable;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_kernel_variant
+  DATE CREATED: Oct 2026
+
+  Names the instruction set variant ("scalar", "sse2", "avx2" or
+  "neon") in use for one of the CODEC2_KERNEL_* kernels, or returns
+  NULL for an unknown kernel.  The variants are picked by the first
+  codec2_create(), before that the baseline ones are reported.  All
+  variants give the same bits.
+
+\*---------------------------------------------------------------------------*/
+
+const char *codec2_kernel_variant(int kernel)
+{
+    switch (kernel) {
+    case CODEC2_KERNEL_FFT:   return kiss_fft_kernel_name();
+    case CODEC2_KERNEL_VQ:    return vq_kernel_name();
+    case CODEC2_KERNEL_NLP:   return nlp_kernel_name();
+    case CODEC2_KERNEL_SYNTH: return synthesise_kernel_name();
+    case CODEC2_KERNEL_BPF:   return bpf_kernel_name();
+    case CODEC2_KERNEL_LPC:   return lpc_kernel_name();
+    case CODEC2_KERNEL_SOFT:  return soft_bits_name;
+    default:                  return NULL;
+    }
+}
+
+/*
+   Bracket one codec frame.  Whatever the frame took that wasn't
+   claimed by the stage counters inside it goes to *other_cycles,
+   quantisation for the encoder and dequantisation for the decoder.
+*/
+
+static void stats_frame_begin(struct CODEC2 *c2, unsigned int *start, unsigned long long *stages)
+{
+    *stages = c2->stats.analysis_cycles + c2->stats.nlp_cycles +
+	      c2->stats.synthesis_cycles + c2->stats.postfilter_cycles;
+    *start = machdep_profile_sample();
+}
+
+static void stats_frame_end(struct CODEC2 *c2, unsigned int start, unsigned long long stages,
+                            unsigned long long *other_cycles, unsigned long *frames)
+{
+    unsigned int total = machdep_profile_sample() - start;
+
+    stages = c2->stats.analysis_cycles + c2->stats.nlp_cycles +
+	     c2->stats.synthesis_cycles + c2->stats.postfilter_cycles - stages;
+    if (total > stages)
+	*other_cycles += total - stages;
+    (*frames)++;
+
+    c2->stats.last_frame_cycles = total;
+    if (total > c2->stats.max_frame_cycles)
+	c2->stats.max_frame_cycles = total;
+    if (c2->deadline && (total > c2->deadline))
+	c2->stats.deadline_misses++;
+}
@@ -0,0 +1,480 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_bank.c
+  DATE CREATED: Oct 2026
+
+  Channel bank, see codec2_bank.h.  The channels' states sit back to
+  back in one block.  Each encode runs the channels KISS_FFT4_LANES at
+  a time: for every 10 ms analysis frame of the block the input
+  windows and NLP front ends are built per channel, then the two
+  512 point DFTs of the analysis (dft_speech() and the NLP one) are
+  done for all lanes in one transform.  Each channel's encoder then
+  runs as usual, picking its DFTs up from the bank instead of
+  computing them (see analyse_one_frame()).  The per channel stages
+  after that depend on each channel's pitch and take data dependent
+  paths, so they stay one channel at a time.
+
+  The four lane FFT has each lane's arithmetic exactly as kiss_fftr(),
+  and the windows are formed as dft_speech() forms them, so the bits
+  are identical to encoding each channel alone.  The 700 and 700B
+  modes band pass filter the input inside the encoder, and builds
+  without SSE have no four lane FFT, those just encode one channel
+  after another.
+
+  CODEC2_OPENCL builds can instead do every channel's DFTs of a frame
+  in one run on an OpenCL device, see codec2_bank_use_device() and
+  codec2_bank_cl.c, the per channel stages are the same.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "codec2.h"
+#include "codec2_internal.h"
+#include "codec2_bank.h"
+#include "nlp.h"
+#include "kiss_fft4.h"
+#ifdef CODEC2_OPENCL
+#include "kiss_fftr.h"
+#include "codec2_bank_cl.h"
+#endif
+
+#define MAX_SUB  4                     /* 10 ms analysis frames per codec frame */
+
+#if defined(KISS_FFT4) || defined(CODEC2_OPENCL)
+#define BANK_BATCH                     /* some DFTs are done for the bank       */
+#endif
+
+#if defined(CODEC2_OPENCL) && ((FFT_ENC != BANK_CL_NFFT) || (PE_FFT_SIZE != BANK_CL_NFFT))
+#error "codec2_bank_cl.c transforms are BANK_CL_NFFT points, as FFT_ENC and PE_FFT_SIZE"
+#endif
+
+struct CODEC2_BANK {
+    int            mode;
+    int            nchannels;
+    int            nsam;               /* samples per frame                     */
+    int            nbyte;              /* bytes per frame                       */
+    size_t         state_size;         /* bytes per channel in mem[]            */
+    unsigned char *mem;                /* the channels' states, back to back    */
+    struct CODEC2 **chan;              /* each instance, where its block put it */
+    void          *scratch;            /* scratch arena shared by the channels  */
+#ifdef KISS_FFT4
+    int            lanes;              /* non-zero to batch the DFTs            */
+    kiss_fftr4_cfg fft;                /* FFT_ENC point analysis DFT            */
+    kiss_fftr4_cfg nlp_fft;            /* PE_FFT_SIZE point NLP DFT             */
+    float         *work;               /* one block for the buffers below       */
+    float         *sw4;                /* lane interleaved dft_speech() input   */
+    float         *fw4;                /* lane interleaved NLP DFT input        */
+    float         *out4;               /* lane interleaved DFT output           */
+    COMP          *Sw;                 /* [lane][sub][FFT_ENC] analysis DFTs     */
+    COMP          *Fw;                 /* [lane][sub][PE_FFT_SIZE/2+1] NLP power */
+#endif
+#ifdef CODEC2_OPENCL
+    struct BANK_CL *cl;                /* non-NULL to do the DFTs on the device */
+    kiss_fftr_cfg  cl_fft;             /* the same DFTs if the device fails     */
+    COMP          *cl_Sw;              /* [channel][sub][FFT_ENC] as Sw         */
+    COMP          *cl_Fw;              /* [channel][sub][PE_FFT_SIZE/2+1] as Fw */
+#endif
+};
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_bank_create
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_BANK *codec2_bank_create(int mode, int nchannels)
+{
+    struct CODEC2_BANK *bank;
+    struct CODEC2      *c2;
+    int                 k;
+
+    if ((mode < CODEC2_MODE_3200) || (mode > CODEC2_MODE_700B) || (nchannels <= 0))
+	return NULL;
+    bank = (struct CODEC2_BANK*)calloc(1, sizeof(struct CODEC2_BANK));
+    if (bank == NULL)
+	return NULL;
+    bank->mode = mode;
+    bank->state_size = codec2_get_state_size(mode);
+
+    /* malloc() alignment is sufficient for each state, as for
+       codec2_create(), and state_size is a multiple of it */
+
+    bank->mem = (unsigned char*)malloc(bank->state_size*nchannels);
+    bank->chan = (struct CODEC2**)malloc(sizeof(struct CODEC2*)*nchannels);
+    if ((bank->mem == NULL) || (bank->chan == NULL)) {
+	codec2_bank_destroy(bank);
+	return NULL;
+    }
+    for(k=0; k<nchannels; k++) {
+	/* the instance needn't start at its block, see create_in_place() */
+	c2 = codec2_create_in_place(mode, bank->mem + k*bank->state_size);
+	if (c2 == NULL) {
+	    codec2_bank_destroy(bank);
+	    return NULL;
+	}
+	bank->chan[k] = c2;
+	bank->nchannels = k+1;
+    }
+
+    /* the channels encode one after another, so they can share one
+       scratch arena */
+
+    if (codec2_scratch_size(mode) > 0) {
+	bank->scratch = malloc(codec2_scratch_size(mode));
+	if (bank->scratch == NULL) {
+	    codec2_bank_destroy(bank);
+	    return NULL;
+	}
+	for(k=0; k<nchannels; k++)
+	    codec2_set_scratch(codec2_bank_channel(bank, k), bank->scratch);
+    }
+    c2 = codec2_bank_channel(bank, 0);
+    bank->nsam = codec2_samples_per_frame(c2);
+    bank->nbyte = (codec2_bits_per_frame(c2) + 7)/8;
+    assert(bank->nsam <= MAX_SUB*N);
+
+#ifdef KISS_FFT4
+    if ((mode != CODEC2_MODE_700) && (mode != CODEC2_MODE_700B)) {
+	size_t nsw = FFT_ENC*KISS_FFT4_LANES;
+	size_t nfw = PE_FFT_SIZE*KISS_FFT4_LANES;
+	size_t nout = (size_t)((FFT_ENC > PE_FFT_SIZE ? FFT_ENC : PE_FFT_SIZE)/2+1)*2*KISS_FFT4_LANES;
+	size_t nSw = (size_t)KISS_FFT4_LANES*MAX_SUB*FFT_ENC;
+	size_t nFw = (size_t)KISS_FFT4_LANES*MAX_SUB*(PE_FFT_SIZE/2+1);
+
+	bank->fft = kiss_fftr4_alloc(FFT_ENC);
+	bank->nlp_fft = kiss_fftr4_alloc(PE_FFT_SIZE);
+	bank->work = (float*)calloc(nsw + nfw + nout + 2*(nSw + nFw), sizeof(float));
+	if ((bank->fft == NULL) || (bank->nlp_fft == NULL) || (bank->work == NULL)) {
+	    codec2_bank_destroy(bank);
+	    return NULL;
+	}
+	bank->sw4 = bank->work;
+	bank->fw4 = bank->sw4 + nsw;
+	bank->out4 = bank->fw4 + nfw;
+	bank->Sw = (COMP*)(bank->out4 + nout);
+	bank->Fw = bank->Sw + nSw;
+	bank->lanes = 1;
+    }
+#endif
+
+    return bank;
+}
+
+void codec2_bank_destroy(struct CODEC2_BANK *bank)
+{
+    int k;
+
+    assert(bank != NULL);
+    for(k=0; k<bank->nchannels; k++)
+	codec2_destroy(codec2_bank_channel(bank, k));
+#ifdef KISS_FFT4
+    kiss_fftr4_free(bank->fft);
+    kiss_fftr4_free(bank->nlp_fft);
+    free(bank->work);
+#endif
+#ifdef CODEC2_OPENCL
+    codec2_bank_use_device(bank, 0);
+#endif
+    free(bank->scratch);
+    free(bank->chan);
+    free(bank->mem);
+    free(bank);
+}
+
+int codec2_bank_channels(struct CODEC2_BANK *bank)
+{
+    assert(bank != NULL);
+    return bank->nchannels;
+}
+
+struct CODEC2 *codec2_bank_channel(struct CODEC2_BANK *bank, int k)
+{
+    assert(bank != NULL);
+    assert((k >= 0) && (k < bank->nchannels));
+    return bank->chan[k];
+}
+
+#ifdef BANK_BATCH
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: bank_input
+  DATE CREATED: Oct 2026
+
+  Channel c2's two DFT inputs for 10 ms analysis frame s of a codec
+  frame, every stride floats from sw and fw: the latest M samples
+  windowed as dft_speech() does, and the NLP front end's output.
+  Runs the channel's NLP front end, so once per frame and sub frame.
+  The other entries of the inputs are left as they were, zero.
+
+\*---------------------------------------------------------------------------*/
+
+static void bank_input(struct CODEC2 *c2, int s, short speech[], float sw[], float fw[], int stride)
+{
+    float        win[M];
+    const float *f;
+    int          nfw, i, k;
+
+    /* the latest M samples as analyse_one_frame() will see them */
+
+    k = (s+1)*N;
+    for(i=0; i<M-k; i++)
+	win[i] = c2->Sn[i+k];
+    for(i=0; i<k; i++)
+	win[M-k+i] = speech[i];
+
+    /* window as dft_speech() */
+
+    for(i=0; i<NW/2; i++)
+	sw[stride*i] = win[i+M/2]*c2->w[i+M/2];
+    for(i=0; i<NW/2; i++)
+	sw[stride*(FFT_ENC-NW/2+i)] = win[i+M/2-NW/2]*c2->w[i+M/2-NW/2];
+
+    f = nlp_filter(c2->nlp, win, N, &nfw);
+    for(i=0; i<nfw; i++)
+	fw[stride*i] = f[i];
+}
+
+#endif
+
+#ifdef KISS_FFT4
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: bank_analyse
+  DATE CREATED: Oct 2026
+
+  The DFTs of every 10 ms analysis frame of one codec frame, for
+  channels c0 .. c0+n-1.  Runs the channels' NLP front ends, the rest
+  of each channel's state is left for its encoder.
+
+\*---------------------------------------------------------------------------*/
+
+static void bank_analyse(struct CODEC2_BANK *bank, int c0, int n, short speech[])
+{
+    const float   *X;
+    COMP          *Sw, *Fw;
+    int            nsub, s, c, i;
+
+    nsub = bank->nsam/N;
+    for(s=0; s<nsub; s++) {
+	/* spare lanes of a last, partial block transform whatever they
+	   last held, their outputs are ignored */
+
+	for(c=0; c<n; c++)
+	    bank_input(codec2_bank_channel(bank, c0+c), s, &speech[(c0+c)*bank->nsam],
+		       &bank->sw4[c], &bank->fw4[c], KISS_FFT4_LANES);
+
+	kiss_fftr4(bank->fft, bank->sw4, bank->out4);
+	for(c=0; c<n; c++) {
+	    Sw = &bank->Sw[(c*MAX_SUB + s)*FFT_ENC];
+	    for(i=0, X=bank->out4; i<=FFT_ENC/2; i++, X+=8) {
+		Sw[i].real = X[c];
+		Sw[i].imag = X[4+c];
+	    }
+	    for(i=1; i<FFT_ENC/2; i++) {
+		Sw[FFT_ENC-i].real =  Sw[i].real;
+		Sw[FFT_ENC-i].imag = -Sw[i].imag;
+	    }
+	}
+
+	kiss_fftr4(bank->nlp_fft, bank->fw4, bank->out4);
+	for(c=0; c<n; c++) {
+	    Fw = &bank->Fw[(c*MAX_SUB + s)*(PE_FFT_SIZE/2+1)];
+	    for(i=0, X=bank->out4; i<=PE_FFT_SIZE/2; i++, X+=8) {
+		Fw[i].real = X[c]*X[c] + X[4+c]*X[4+c];
+		Fw[i].imag = X[4+c];
+	    }
+	}
+    }
+}
+
+#endif
+
+#ifdef CODEC2_OPENCL
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: bank_analyse_cl
+  DATE CREATED: Oct 2026
+
+  bank_analyse() for every channel at once on the device: transform
+  2*(c*nsub + s) is channel c's dft_speech() input for analysis frame
+  s, the next its NLP input.  If the device fails the same transforms
+  are done here and the bank goes back to the CPU for later frames.
+
+\*---------------------------------------------------------------------------*/
+
+static void bank_analyse_cl(struct CODEC2_BANK *bank, short speech[])
+{
+    kiss_fft_cpx  tmp[BANK_CL_NFFT/2+1];
+    float        *in;
+    const COMP   *out, *X;
+    COMP         *Sw, *Fw;
+    int           nsub, t, s, c, i;
+
+    nsub = bank->nsam/N;
+    in = bank_cl_input(bank->cl);
+    for(c=0; c<bank->nchannels; c++)
+	for(s=0; s<nsub; s++) {
+	    t = 2*(c*nsub + s);
+	    bank_input(codec2_bank_channel(bank, c), s, &speech[c*bank->nsam],
+		       &in[t*BANK_CL_NFFT], &in[(t+1)*BANK_CL_NFFT], 1);
+	}
+
+    out = bank_cl_run(bank->cl, 2*nsub*bank->nchannels);
+    for(c=0; c<bank->nchannels; c++)
+	for(s=0; s<nsub; s++) {
+	    t = 2*(c*nsub + s);
+
+	    if (out != NULL)
+		X = &out[t*(FFT_ENC/2+1)];
+	    else {
+		kiss_fftr(bank->cl_fft, &in[t*BANK_CL_NFFT], tmp);
+		X = (const COMP*)tmp;
+	    }
+	    Sw = &bank->cl_Sw[(c*MAX_SUB + s)*FFT_ENC];
+	    for(i=0; i<=FFT_ENC/2; i++)
+		Sw[i] = X[i];
+	    for(i=1; i<FFT_ENC/2; i++) {
+		Sw[FFT_ENC-i].real =  Sw[i].real;
+		Sw[FFT_ENC-i].imag = -Sw[i].imag;
+	    }
+
+	    if (out != NULL)
+		X = &out[(t+1)*(PE_FFT_SIZE/2+1)];
+	    else {
+		kiss_fftr(bank->cl_fft, &in[(t+1)*BANK_CL_NFFT], tmp);
+		X = (const COMP*)tmp;
+	    }
+	    Fw = &bank->cl_Fw[(c*MAX_SUB + s)*(PE_FFT_SIZE/2+1)];
+	    for(i=0; i<=PE_FFT_SIZE/2; i++) {
+		Fw[i].real = X[i].real*X[i].real + X[i].imag*X[i].imag;
+		Fw[i].imag = X[i].imag;
+	    }
+	}
+
+    if (out == NULL) {
+	bank_cl_destroy(bank->cl);
+	bank->cl = NULL;
+    }
+}
+
+#endif
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_bank_use_device
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_bank_use_device(struct CODEC2_BANK *bank, int enable)
+{
+    assert(bank != NULL);
+#ifdef CODEC2_OPENCL
+    if (bank->cl != NULL) {
+	bank_cl_destroy(bank->cl);
+	bank->cl = NULL;
+    }
+    if (!enable) {
+	kiss_fftr_free(bank->cl_fft);
+	free(bank->cl_Sw);
+	bank->cl_fft = NULL;
+	bank->cl_Sw = bank->cl_Fw = NULL;
+	return 0;
+    }
+    if ((bank->mode == CODEC2_MODE_700) || (bank->mode == CODEC2_MODE_700B))
+	return -1;
+
+    if (bank->cl_Sw == NULL) {
+	bank->cl_fft = kiss_fftr_alloc(BANK_CL_NFFT, 0, NULL, NULL);
+	bank->cl_Sw = (COMP*)malloc(sizeof(COMP)*bank->nchannels*MAX_SUB*(FFT_ENC + PE_FFT_SIZE/2+1));
+	if ((bank->cl_fft == NULL) || (bank->cl_Sw == NULL)) {
+	    codec2_bank_use_device(bank, 0);
+	    return -1;
+	}
+	bank->cl_Fw = bank->cl_Sw + bank->nchannels*MAX_SUB*FFT_ENC;
+    }
+    bank->cl = bank_cl_create(2*(bank->nsam/N)*bank->nchannels);
+    return (bank->cl != NULL) ? 0 : -1;
+#else
+    (void)bank;
+    (void)enable;
+    return -1;
+#endif
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_bank_encode
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_bank_encode(struct CODEC2_BANK *bank, unsigned char bits[], short speech[])
+{
+    struct CODEC2 *c2;
+    int            c0, c, n, lanes = 0;
+
+    assert(bank != NULL);
+
+#ifdef CODEC2_OPENCL
+    if (bank->cl != NULL) {
+	bank_analyse_cl(bank, speech);
+	for(c=0; c<bank->nchannels; c++) {
+	    c2 = codec2_bank_channel(bank, c);
+	    c2->bank_Sw = &bank->cl_Sw[c*MAX_SUB*FFT_ENC];
+	    c2->bank_Fw = &bank->cl_Fw[c*MAX_SUB*(PE_FFT_SIZE/2+1)];
+	    codec2_encode(c2, &bits[c*bank->nbyte], &speech[c*bank->nsam]);
+	    c2->bank_Sw = c2->bank_Fw = NULL;
+	}
+	return;
+    }
+#endif
+
+    for(c0=0; c0<bank->nchannels; c0+=n) {
+	n = bank->nchannels - c0;
+#ifdef KISS_FFT4
+	if (n > KISS_FFT4_LANES)
+	    n = KISS_FFT4_LANES;
+
+	/* a single channel is quicker on its own */
+
+	lanes = bank->lanes && (n > 1);
+	if (lanes)
+	    bank_analyse(bank, c0, n, speech);
+#endif
+	for(c=c0; c<c0+n; c++) {
+	    c2 = codec2_bank_channel(bank, c);
+#ifdef KISS_FFT4
+	    if (lanes) {
+		c2->bank_Sw = &bank->Sw[(c-c0)*MAX_SUB*FFT_ENC];
+		c2->bank_Fw = &bank->Fw[(c-c0)*MAX_SUB*(PE_FFT_SIZE/2+1)];
+	    }
+#endif
+	    codec2_encode(c2, &bits[c*bank->nbyte], &speech[c*bank->nsam]);
+	    c2->bank_Sw = c2->bank_Fw = NULL;
+	}
+    }
+}
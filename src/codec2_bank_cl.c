@@ -0,0 +1,458 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_bank_cl.c
+  DATE CREATED: Oct 2026
+
+  The channel bank's analysis DFTs on an OpenCL device, for encoding
+  thousands of streams in lock step.  Each transform is one work
+  group, which runs kiss_fftr() operation for operation: the 256
+  point complex FFT's fixed plan (kf_work_256(), a digit reversal
+  gather then four radix 4 stages), then the real split.  The twiddle
+  and digit reversal tables are kiss_fft's own, copied to the device.
+  With contraction off, round to nearest and denormals, every add,
+  subtract and multiply is the CPU's, so the bits are the same as the
+  CPU bank's; devices without denormals are passed over.  Builds that
+  contract a*b+c into FMAs on the CPU (e.g. aarch64 GCC) can differ,
+  codec2_batch -V is the check.
+
+  The OpenCL library is loaded at run time, so the library has no
+  link or header dependency on an SDK, and a machine without a device
+  or driver just encodes on the CPU.  The few OpenCL 1.1 types and
+  entry points used are declared here.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "codec2_bank_cl.h"
+#include "kiss_fftr.h"
+
+/*---------------------------------------------------------------------------*\
+
+                               OPENCL API
+
+\*---------------------------------------------------------------------------*/
+
+#if defined(_WIN32) && !defined(_WIN64)
+#define CL_API_CALL __stdcall
+#else
+#define CL_API_CALL
+#endif
+
+typedef int32_t  cl_int;
+typedef uint32_t cl_uint;
+typedef uint64_t cl_ulong;
+typedef cl_ulong cl_bitfield;
+
+typedef struct _cl_platform_id   *cl_platform_id;
+typedef struct _cl_device_id     *cl_device_id;
+typedef struct _cl_context       *cl_context;
+typedef struct _cl_command_queue *cl_command_queue;
+typedef struct _cl_mem           *cl_mem;
+typedef struct _cl_program       *cl_program;
+typedef struct _cl_kernel        *cl_kernel;
+typedef struct _cl_event         *cl_event;
+
+#define CL_SUCCESS                     0
+#define CL_TRUE                        1
+#define CL_DEVICE_TYPE_ALL             0xFFFFFFFF
+#define CL_DEVICE_MAX_WORK_GROUP_SIZE  0x1004
+#define CL_DEVICE_SINGLE_FP_CONFIG     0x101B
+#define CL_FP_DENORM                   (1 << 0)
+#define CL_FP_ROUND_TO_NEAREST         (1 << 2)
+#define CL_MEM_READ_WRITE              (1 << 0)
+#define CL_MEM_WRITE_ONLY              (1 << 1)
+#define CL_MEM_READ_ONLY               (1 << 2)
+#define CL_MEM_COPY_HOST_PTR           (1 << 5)
+
+typedef cl_int (CL_API_CALL *clGetPlatformIDs_fn)(cl_uint, cl_platform_id *, cl_uint *);
+typedef cl_int (CL_API_CALL *clGetDeviceIDs_fn)(cl_platform_id, cl_bitfield, cl_uint, cl_device_id *, cl_uint *);
+typedef cl_int (CL_API_CALL *clGetDeviceInfo_fn)(cl_device_id, cl_uint, size_t, void *, size_t *);
+typedef cl_context (CL_API_CALL *clCreateContext_fn)(const intptr_t *, cl_uint, const cl_device_id *,
+                                                    void (CL_API_CALL *)(const char *, const void *, size_t, void *),
+                                                    void *, cl_int *);
+typedef cl_command_queue (CL_API_CALL *clCreateCommandQueue_fn)(cl_context, cl_device_id, cl_bitfield, cl_int *);
+typedef cl_program (CL_API_CALL *clCreateProgramWithSource_fn)(cl_context, cl_uint, const char **, const size_t *, cl_int *);
+typedef cl_int (CL_API_CALL *clBuildProgram_fn)(cl_program, cl_uint, const cl_device_id *, const char *,
+                                               void (CL_API_CALL *)(cl_program, void *), void *);
+typedef cl_kernel (CL_API_CALL *clCreateKernel_fn)(cl_program, const char *, cl_int *);
+typedef cl_mem (CL_API_CALL *clCreateBuffer_fn)(cl_context, cl_bitfield, size_t, void *, cl_int *);
+typedef cl_int (CL_API_CALL *clSetKernelArg_fn)(cl_kernel, cl_uint, size_t, const void *);
+typedef cl_int (CL_API_CALL *clEnqueueWriteBuffer_fn)(cl_command_queue, cl_mem, cl_uint, size_t, size_t, const void *,
+                                                     cl_uint, const cl_event *, cl_event *);
+typedef cl_int (CL_API_CALL *clEnqueueReadBuffer_fn)(cl_command_queue, cl_mem, cl_uint, size_t, size_t, void *,
+                                                    cl_uint, const cl_event *, cl_event *);
+typedef cl_int (CL_API_CALL *clEnqueueNDRangeKernel_fn)(cl_command_queue, cl_kernel, cl_uint, const size_t *,
+                                                       const size_t *, const size_t *, cl_uint, const cl_event *,
+                                                       cl_event *);
+typedef cl_int (CL_API_CALL *clRelease_fn)(void *);
+
+/* the entry points, in the order of cl_names[] */
+
+struct CL_API {
+    clGetPlatformIDs_fn          GetPlatformIDs;
+    clGetDeviceIDs_fn            GetDeviceIDs;
+    clGetDeviceInfo_fn           GetDeviceInfo;
+    clCreateContext_fn           CreateContext;
+    clCreateCommandQueue_fn      CreateCommandQueue;
+    clCreateProgramWithSource_fn CreateProgramWithSource;
+    clBuildProgram_fn            BuildProgram;
+    clCreateKernel_fn            CreateKernel;
+    clCreateBuffer_fn            CreateBuffer;
+    clSetKernelArg_fn            SetKernelArg;
+    clEnqueueWriteBuffer_fn      EnqueueWriteBuffer;
+    clEnqueueReadBuffer_fn       EnqueueReadBuffer;
+    clEnqueueNDRangeKernel_fn    EnqueueNDRangeKernel;
+    clRelease_fn                 ReleaseMemObject;
+    clRelease_fn                 ReleaseKernel;
+    clRelease_fn                 ReleaseProgram;
+    clRelease_fn                 ReleaseCommandQueue;
+    clRelease_fn                 ReleaseContext;
+};
+
+static const char *cl_names[] = {
+    "clGetPlatformIDs", "clGetDeviceIDs", "clGetDeviceInfo", "clCreateContext",
+    "clCreateCommandQueue", "clCreateProgramWithSource", "clBuildProgram",
+    "clCreateKernel", "clCreateBuffer", "clSetKernelArg", "clEnqueueWriteBuffer",
+    "clEnqueueReadBuffer", "clEnqueueNDRangeKernel", "clReleaseMemObject",
+    "clReleaseKernel", "clReleaseProgram", "clReleaseCommandQueue", "clReleaseContext"
+};
+
+#define CL_NUM_NAMES ((int)(sizeof(cl_names)/sizeof(cl_names[0])))
+
+/*---------------------------------------------------------------------------*\
+
+                                 KERNEL
+
+  One work group of BANK_CL_WG work items per transform.  bfly4() is
+  kf_bfly4() forward for one k, and the split is kiss_fftr()'s loop,
+  each with the CPU's order of operations.
+
+\*---------------------------------------------------------------------------*/
+
+#define BANK_CL_WG 64                  /* radix 4 butterflies per stage         */
+
+static const char bank_cl_source[] =
+"#pragma OPENCL FP_CONTRACT OFF\n"
+"#define NCFFT 256\n"
+"#define WG    64\n"
+"\n"
+"static float2 cmul(float2 a, float2 b)\n"
+"{\n"
+"    return (float2)(a.x*b.x - a.y*b.y, a.x*b.y + a.y*b.x);\n"
+"}\n"
+"\n"
+"static void bfly4(__local float2 *F, int m, float2 tw1, float2 tw2, float2 tw3)\n"
+"{\n"
+"    float2 s0, s1, s2, s3, s4, s5;\n"
+"\n"
+"    s0 = cmul(F[m], tw1);\n"
+"    s1 = cmul(F[2*m], tw2);\n"
+"    s2 = cmul(F[3*m], tw3);\n"
+"    s5 = F[0] - s1;\n"
+"    F[0] += s1;\n"
+"    s3 = s0 + s2;\n"
+"    s4 = s0 - s2;\n"
+"    F[2*m] = F[0] - s3;\n"
+"    F[0] += s3;\n"
+"    F[m] = (float2)(s5.x + s4.y, s5.y - s4.x);\n"
+"    F[3*m] = (float2)(s5.x - s4.y, s5.y + s4.x);\n"
+"}\n"
+"\n"
+"__kernel __attribute__((reqd_work_group_size(WG, 1, 1)))\n"
+"void bank_rfft(__global const float2 *x, __global float2 *X, __constant float2 *tw,\n"
+"               __constant float2 *stw, __constant ushort *perm)\n"
+"{\n"
+"    __local float2 F[NCFFT];\n"
+"    __global const float2 *in = x + get_group_id(0)*NCFFT;\n"
+"    __global float2 *out = X + get_group_id(0)*(NCFFT+1);\n"
+"    float2 fpk, fpnk, f1k, f2k, t;\n"
+"    int i = get_local_id(0), k, m, fstride;\n"
+"\n"
+"    for(k=i; k<NCFFT; k+=WG)\n"
+"        F[k] = in[perm[k]];\n"
+"    barrier(CLK_LOCAL_MEM_FENCE);\n"
+"\n"
+"    for(m=1; m<NCFFT; m*=4) {\n"
+"        fstride = NCFFT/(4*m);\n"
+"        k = i % m;\n"
+"        bfly4(&F[(i/m)*4*m + k], m, tw[k*fstride], tw[2*k*fstride], tw[3*k*fstride]);\n"
+"        barrier(CLK_LOCAL_MEM_FENCE);\n"
+"    }\n"
+"\n"
+"    if (i == 0) {\n"
+"        out[0] = (float2)(F[0].x + F[0].y, 0.0f);\n"
+"        out[NCFFT] = (float2)(F[0].x - F[0].y, 0.0f);\n"
+"    }\n"
+"    for(k=i+1; k<=NCFFT/2; k+=WG) {\n"
+"        fpk = F[k];\n"
+"        fpnk = (float2)(F[NCFFT-k].x, -F[NCFFT-k].y);\n"
+"        f1k = fpk + fpnk;\n"
+"        f2k = fpk - fpnk;\n"
+"        t = cmul(f2k, stw[k-1]);\n"
+"        out[k] = (float2)((f1k.x + t.x)*0.5f, (f1k.y + t.y)*0.5f);\n"
+"        out[NCFFT-k] = (float2)((f1k.x - t.x)*0.5f, (t.y - f1k.y)*0.5f);\n"
+"    }\n"
+"}\n";
+
+/*---------------------------------------------------------------------------*\
+
+                               FUNCTIONS
+
+\*---------------------------------------------------------------------------*/
+
+struct BANK_CL {
+    void            *lib;
+    struct CL_API    cl;
+    int              ndft;
+    cl_context       context;
+    cl_command_queue queue;
+    cl_program       program;
+    cl_kernel        kernel;
+    cl_mem           x, X, tw, stw, perm;
+    float           *in;               /* ndft*BANK_CL_NFFT samples             */
+    COMP            *out;              /* ndft*(BANK_CL_NFFT/2+1) bins          */
+};
+
+static void *cl_open(void)
+{
+#ifdef _WIN32
+    return (void *)LoadLibraryA("OpenCL.dll");
+#elif defined(__APPLE__)
+    return dlopen("/System/Library/Frameworks/OpenCL.framework/OpenCL", RTLD_NOW | RTLD_LOCAL);
+#else
+    void *lib = dlopen("libOpenCL.so.1", RTLD_NOW | RTLD_LOCAL);
+    return lib ? lib : dlopen("libOpenCL.so", RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void *cl_sym(void *lib, const char *name)
+{
+#ifdef _WIN32
+    return (void *)GetProcAddress((HMODULE)lib, name);
+#else
+    return dlsym(lib, name);
+#endif
+}
+
+static void cl_close(void *lib)
+{
+#ifdef _WIN32
+    FreeLibrary((HMODULE)lib);
+#else
+    dlclose(lib);
+#endif
+}
+
+/* The first device that rounds to nearest, keeps denormals and runs
+   BANK_CL_WG work items a group, or NULL */
+
+static cl_device_id cl_pick_device(struct CL_API *cl)
+{
+    cl_platform_id platforms[8];
+    cl_device_id   devices[8];
+    cl_uint        nplatforms, ndevices, p, d;
+    cl_bitfield    fp;
+    size_t         wg;
+
+    if ((cl->GetPlatformIDs(8, platforms, &nplatforms) != CL_SUCCESS) || (nplatforms == 0))
+	return NULL;
+    if (nplatforms > 8)
+	nplatforms = 8;
+    for(p=0; p<nplatforms; p++) {
+	if (cl->GetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 8, devices, &ndevices) != CL_SUCCESS)
+	    continue;
+	if (ndevices > 8)
+	    ndevices = 8;
+	for(d=0; d<ndevices; d++) {
+	    if ((cl->GetDeviceInfo(devices[d], CL_DEVICE_SINGLE_FP_CONFIG, sizeof(fp), &fp, NULL) != CL_SUCCESS) ||
+		(cl->GetDeviceInfo(devices[d], CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(wg), &wg, NULL) != CL_SUCCESS))
+		continue;
+	    if ((fp & CL_FP_DENORM) && (fp & CL_FP_ROUND_TO_NEAREST) && (wg >= BANK_CL_WG))
+		return devices[d];
+	}
+    }
+    return NULL;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: bank_cl_create
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct BANK_CL *bank_cl_create(int ndft)
+{
+    struct BANK_CL     *bcl;
+    struct CL_API      *cl;
+    kiss_fftr_cfg       fft;
+    const kiss_fft_cpx *tw, *stw;
+    const unsigned short *perm;
+    const char         *src = bank_cl_source;
+    cl_device_id        device;
+    cl_int              err;
+    void              **fn;
+    int                 ncfft, i;
+
+    assert(ndft > 0);
+    bcl = (struct BANK_CL*)calloc(1, sizeof(struct BANK_CL));
+    if (bcl == NULL)
+	return NULL;
+    bcl->ndft = ndft;
+    bcl->lib = cl_open();
+    if (bcl->lib == NULL) {
+	free(bcl);
+	return NULL;
+    }
+    cl = &bcl->cl;
+    fn = (void **)cl;
+    for(i=0; i<CL_NUM_NAMES; i++) {
+	fn[i] = cl_sym(bcl->lib, cl_names[i]);
+	if (fn[i] == NULL) {
+	    bank_cl_destroy(bcl);
+	    return NULL;
+	}
+    }
+
+    device = cl_pick_device(cl);
+    if (device == NULL) {
+	bank_cl_destroy(bcl);
+	return NULL;
+    }
+    bcl->context = cl->CreateContext(NULL, 1, &device, NULL, NULL, &err);
+    if (bcl->context == NULL) {
+	bank_cl_destroy(bcl);
+	return NULL;
+    }
+    bcl->queue = cl->CreateCommandQueue(bcl->context, device, 0, &err);
+    bcl->program = cl->CreateProgramWithSource(bcl->context, 1, &src, NULL, &err);
+    if ((bcl->queue == NULL) || (bcl->program == NULL) ||
+	(cl->BuildProgram(bcl->program, 1, &device, "", NULL, NULL) != CL_SUCCESS)) {
+	bank_cl_destroy(bcl);
+	return NULL;
+    }
+    bcl->kernel = cl->CreateKernel(bcl->program, "bank_rfft", &err);
+    if (bcl->kernel == NULL) {
+	bank_cl_destroy(bcl);
+	return NULL;
+    }
+
+    /* kiss_fft's own tables, so the twiddles are the CPU's to the bit */
+
+    fft = kiss_fftr_alloc(BANK_CL_NFFT, 0, NULL, NULL);
+    if (fft == NULL) {
+	bank_cl_destroy(bcl);
+	return NULL;
+    }
+    ncfft = kiss_fftr_tables(fft, &tw, &stw, &perm);
+    assert(ncfft == BANK_CL_NFFT/2);
+    bcl->tw = cl->CreateBuffer(bcl->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+			       ncfft*sizeof(kiss_fft_cpx), (void *)tw, &err);
+    bcl->stw = cl->CreateBuffer(bcl->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+				ncfft/2*sizeof(kiss_fft_cpx), (void *)stw, &err);
+    bcl->perm = cl->CreateBuffer(bcl->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+				 ncfft*sizeof(unsigned short), (void *)perm, &err);
+    kiss_fftr_free(fft);
+
+    bcl->x = cl->CreateBuffer(bcl->context, CL_MEM_READ_ONLY, (size_t)ndft*BANK_CL_NFFT*sizeof(float), NULL, &err);
+    bcl->X = cl->CreateBuffer(bcl->context, CL_MEM_WRITE_ONLY, (size_t)ndft*(BANK_CL_NFFT/2+1)*sizeof(COMP), NULL, &err);
+    bcl->in = (float*)calloc((size_t)ndft*BANK_CL_NFFT, sizeof(float));
+    bcl->out = (COMP*)malloc((size_t)ndft*(BANK_CL_NFFT/2+1)*sizeof(COMP));
+    if ((bcl->tw == NULL) || (bcl->stw == NULL) || (bcl->perm == NULL) || (bcl->x == NULL) ||
+	(bcl->X == NULL) || (bcl->in == NULL) || (bcl->out == NULL) ||
+	(cl->SetKernelArg(bcl->kernel, 0, sizeof(cl_mem), &bcl->x) != CL_SUCCESS) ||
+	(cl->SetKernelArg(bcl->kernel, 1, sizeof(cl_mem), &bcl->X) != CL_SUCCESS) ||
+	(cl->SetKernelArg(bcl->kernel, 2, sizeof(cl_mem), &bcl->tw) != CL_SUCCESS) ||
+	(cl->SetKernelArg(bcl->kernel, 3, sizeof(cl_mem), &bcl->stw) != CL_SUCCESS) ||
+	(cl->SetKernelArg(bcl->kernel, 4, sizeof(cl_mem), &bcl->perm) != CL_SUCCESS)) {
+	bank_cl_destroy(bcl);
+	return NULL;
+    }
+
+    return bcl;
+}
+
+void bank_cl_destroy(struct BANK_CL *bcl)
+{
+    struct CL_API *cl;
+    cl_mem        *mem[5];
+    int            i;
+
+    assert(bcl != NULL);
+    cl = &bcl->cl;
+    mem[0] = &bcl->x; mem[1] = &bcl->X; mem[2] = &bcl->tw; mem[3] = &bcl->stw; mem[4] = &bcl->perm;
+    for(i=0; i<5; i++)
+	if (*mem[i] != NULL)
+	    cl->ReleaseMemObject(*mem[i]);
+    if (bcl->kernel != NULL)
+	cl->ReleaseKernel(bcl->kernel);
+    if (bcl->program != NULL)
+	cl->ReleaseProgram(bcl->program);
+    if (bcl->queue != NULL)
+	cl->ReleaseCommandQueue(bcl->queue);
+    if (bcl->context != NULL)
+	cl->ReleaseContext(bcl->context);
+    if (bcl->lib != NULL)
+	cl_close(bcl->lib);
+    free(bcl->in);
+    free(bcl->out);
+    free(bcl);
+}
+
+float *bank_cl_input(struct BANK_CL *bcl)
+{
+    assert(bcl != NULL);
+    return bcl->in;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: bank_cl_run
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+const COMP *bank_cl_run(struct BANK_CL *bcl, int n)
+{
+    struct CL_API *cl;
+    size_t         global, local = BANK_CL_WG;
+
+    assert(bcl != NULL);
+    assert((n > 0) && (n <= bcl->ndft));
+    cl = &bcl->cl;
+    global = (size_t)n*BANK_CL_WG;
+
+    if ((cl->EnqueueWriteBuffer(bcl->queue, bcl->x, CL_TRUE, 0, (size_t)n*BANK_CL_NFFT*sizeof(float),
+				bcl->in, 0, NULL, NULL) != CL_SUCCESS) ||
+	(cl->EnqueueNDRangeKernel(bcl->queue, bcl->kernel, 1, NULL, &global, &local, 0, NULL, NULL) != CL_SUCCESS) ||
+	(cl->EnqueueReadBuffer(bcl->queue, bcl->X, CL_TRUE, 0, (size_t)n*(BANK_CL_NFFT/2+1)*sizeof(COMP),
+			       bcl->out, 0, NULL, NULL) != CL_SUCCESS))
+	return NULL;
+
+    return bcl->out;
+}
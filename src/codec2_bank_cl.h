@@ -0,0 +1,52 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_bank_cl.h
+  DATE CREATED: Oct 2026
+
+  The channel bank's analysis DFTs on an OpenCL device, see
+  codec2_bank_cl.c.  Only in CODEC2_OPENCL builds.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CODEC2_BANK_CL__
+#define __CODEC2_BANK_CL__
+
+#include "comp.h"
+
+#define BANK_CL_NFFT 512               /* real points per transform             */
+
+struct BANK_CL;
+
+/* A queue on the first OpenCL device that can give the bits of the
+   CPU, for up to ndft transforms a run, or NULL if there is none */
+
+struct BANK_CL *bank_cl_create(int ndft);
+void bank_cl_destroy(struct BANK_CL *cl);
+
+/* ndft*BANK_CL_NFFT samples for the caller to fill, transform t at
+   [t*BANK_CL_NFFT], zero until written */
+
+float *bank_cl_input(struct BANK_CL *cl);
+
+/* The first n transforms of the input, bins 0..BANK_CL_NFFT/2 of
+   transform t at [t*(BANK_CL_NFFT/2+1)], exactly as kiss_fftr() gives
+   them, or NULL if the device failed */
+
+const COMP *bank_cl_run(struct BANK_CL *cl, int n);
+
+#endif
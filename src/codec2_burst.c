@@ -0,0 +1,316 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_burst.c
+  DATE CREATED: Oct 2026
+
+  Burst encoder, see codec2_burst.h.  The double buffer's halves are
+  handed between the filling side (a DMA interrupt, or
+  codec2_burst_write()) and the encoder by one flag each, set by a
+  release store when the half is full and cleared the same way once it
+  is encoded, so the interrupt never takes a lock.
+
+  A burst encodes its frames with codec2_encode_batch(), the mode
+  dispatch done once and the frames run back to back, so the
+  codebooks, FFT twiddles and windows fetched by the first frame are
+  still in cache for the rest, instead of being refetched after every
+  sleep.  On parts with TCM, putting the codebook objects (codebook*.c
+  of the mode) and the burst's memory there with the linker script
+  keeps them out of flash wait states altogether.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec2.h"
+#include "codec2_burst.h"
+#include "machdep.h"
+
+/* Acquire loads and release stores of the full[] flags.  The MSVC
+   interlocked functions are full barriers, which covers them too. */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOAD(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define LOAD(x)     _InterlockedOr((volatile long*)&(x), 0)
+#define STORE(x, v) _InterlockedExchange((volatile long*)&(x), (long)(v))
+#else
+#error "codec2_burst.c needs atomic loads and stores for this compiler"
+#endif
+
+#define ROUND16(x)  (((x) + 15) & ~(size_t)15)
+
+struct CODEC2_BURST {
+    struct CODEC2     *c2;
+    int                nframes;
+    int                nsam;           /* samples per frame                     */
+    int                nbyte;          /* bytes per frame                       */
+    int                half;           /* samples per half of pcm[]             */
+    short             *pcm;            /* the double buffer                     */
+    void              *own_mem;        /* block codec2_burst_create() allocated */
+
+    /* filling side */
+    int                fill;           /* half being filled                     */
+    int                fill_pos;       /* codec2_burst_write()'s place in it    */
+    unsigned long      overruns;
+
+    int                full[2];        /* set when filled, cleared when encoded */
+
+    /* encoding side */
+    int                next;           /* half to encode next                   */
+    unsigned long      bursts;
+    unsigned int       last_start;
+    unsigned int       last_cycles;
+    unsigned int       max_cycles;
+    unsigned long long busy;           /* cycles in bursts before the last one  */
+    unsigned long long span;           /* cycles from the first burst to the last */
+};
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_burst_size
+  DATE CREATED: Oct 2026
+
+  The struct, then the codec state, the double buffer and in
+  CODEC2_SCRATCH_ARENA builds the scratch arena, each 16 byte aligned.
+  Returns 0 if the mode or nframes is invalid.
+
+\*---------------------------------------------------------------------------*/
+
+size_t codec2_burst_size(int mode, int nframes)
+{
+    struct CODEC2 *c2;
+    size_t         pcm;
+
+    if (!codec2_mode_enabled(mode) || (nframes < 1))
+	return 0;
+    c2 = codec2_create(mode);
+    if (c2 == NULL)
+	return 0;
+    pcm = 2*(size_t)nframes*codec2_samples_per_frame(c2)*sizeof(short);
+    codec2_destroy(c2);
+
+    return ROUND16(sizeof(struct CODEC2_BURST)) + ROUND16(codec2_get_state_size(mode)) +
+	   ROUND16(pcm) + codec2_scratch_size(mode);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_burst_create_in_place
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_BURST *codec2_burst_create_in_place(int mode, int nframes, void *mem)
+{
+    struct CODEC2_BURST *b;
+    unsigned char       *p = (unsigned char*)mem;
+    size_t               scratch;
+
+    assert(mem != NULL);
+    assert(((size_t)mem & 15) == 0);
+    if (!codec2_mode_enabled(mode) || (nframes < 1))
+	return NULL;
+
+    b = (struct CODEC2_BURST*)p;
+    memset(b, 0, sizeof(*b));
+    p += ROUND16(sizeof(struct CODEC2_BURST));
+
+    b->c2 = codec2_create_in_place(mode, p);
+    if (b->c2 == NULL)
+	return NULL;
+    p += ROUND16(codec2_get_state_size(mode));
+
+    b->nframes = nframes;
+    b->nsam = codec2_samples_per_frame(b->c2);
+    b->nbyte = (codec2_bits_per_frame(b->c2) + 7)/8;
+    b->half = nframes*b->nsam;
+    b->pcm = (short*)p;
+    memset(b->pcm, 0, 2*b->half*sizeof(short));
+    p += ROUND16(2*(size_t)b->half*sizeof(short));
+
+    scratch = codec2_scratch_size(mode);
+    if (scratch > 0)
+	codec2_set_scratch(b->c2, p);
+
+    machdep_profile_clock_init();
+
+    return b;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_burst_create
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_BURST *codec2_burst_create(int mode, int nframes)
+{
+    struct CODEC2_BURST *b;
+    size_t               size;
+    void                *mem;
+
+    size = codec2_burst_size(mode, nframes);
+    if (size == 0)
+	return NULL;
+
+    /* malloc() alignment is sufficient, as for codec2_create() */
+    mem = malloc(size);
+    if (mem == NULL)
+	return NULL;
+    b = codec2_burst_create_in_place(mode, nframes, mem);
+    if (b == NULL) {
+	free(mem);
+	return NULL;
+    }
+    b->own_mem = mem;
+
+    return b;
+}
+
+void codec2_burst_destroy(struct CODEC2_BURST *b)
+{
+    assert(b != NULL);
+    codec2_destroy(b->c2);
+    free(b->own_mem);
+}
+
+struct CODEC2 *codec2_burst_codec(struct CODEC2_BURST *b)
+{
+    return b->c2;
+}
+
+short *codec2_burst_buffer(struct CODEC2_BURST *b, int *nsamples)
+{
+    if (nsamples != NULL)
+	*nsamples = 2*b->half;
+    return b->pcm;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_burst_half_done
+  DATE CREATED: Oct 2026
+
+  The half being filled is full, and the other is filled next.  If
+  that one is still waiting for the encoder it is being overwritten.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_burst_half_done(struct CODEC2_BURST *b)
+{
+    STORE(b->full[b->fill], 1);
+    b->fill ^= 1;
+    if (LOAD(b->full[b->fill])) {
+	b->overruns++;
+	return -1;
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_burst_write
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_burst_write(struct CODEC2_BURST *b, const short speech[], int n)
+{
+    int m;
+
+    while (n > 0) {
+	m = b->half - b->fill_pos;
+	if (m > n)
+	    m = n;
+	memcpy(&b->pcm[b->fill*b->half + b->fill_pos], speech, m*sizeof(short));
+	speech += m;
+	n -= m;
+	b->fill_pos += m;
+	if (b->fill_pos == b->half) {
+	    b->fill_pos = 0;
+	    codec2_burst_half_done(b);
+	}
+    }
+    return LOAD(b->full[0]) + LOAD(b->full[1]);
+}
+
+int codec2_burst_ready(struct CODEC2_BURST *b)
+{
+    return LOAD(b->full[b->next]);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_burst_encode
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_burst_encode(struct CODEC2_BURST *b, unsigned char bits[])
+{
+    unsigned int start, cycles;
+    int          h = b->next;
+
+    if (!LOAD(b->full[h]))
+	return 0;
+
+    start = machdep_profile_sample();
+    codec2_encode_batch(b->c2, bits, &b->pcm[h*b->half], b->nframes);
+    cycles = machdep_profile_sample() - start;   /* modulo 2^32, so wrap is OK */
+    STORE(b->full[h], 0);
+    b->next = h ^ 1;
+
+    if (b->bursts > 0) {
+	b->span += start - b->last_start;
+	b->busy += b->last_cycles;
+    }
+    b->bursts++;
+    b->last_start = start;
+    b->last_cycles = cycles;
+    if (cycles > b->max_cycles)
+	b->max_cycles = cycles;
+
+    return b->nframes;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_burst_get_stats
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_burst_get_stats(struct CODEC2_BURST *b, struct CODEC2_BURST_STATS *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->bursts = b->bursts;
+    stats->frames = b->bursts*b->nframes;
+    stats->overruns = b->overruns;
+    stats->last_cycles = b->last_cycles;
+    stats->max_cycles = b->max_cycles;
+    if (b->bursts > 0)
+	stats->mean_cycles = (float)(b->busy + b->last_cycles)/b->bursts;
+    if (b->span > 0)
+	stats->idle_fraction = 1.0f - (float)b->busy/b->span;
+    stats->cycles_per_us = machdep_profile_ticks_per_us();
+}
@@ -43,6 +43,16 @@ void fifo_destroy(struct FIFO *fifo);
 int fifo_write(struct FIFO *fifo, short data[], int n);
 int fifo_read(struct FIFO *fifo, short data[], int n);
 
+/*!
+ * Zero copy access, see fifo.c.  The get functions return the number
+ * of shorts available contiguously at *span, the commit functions
+ * advance the FIFO by n <= that number.
+ */
+int fifo_get_write_span(struct FIFO *fifo, short **span);
+void fifo_commit_write(struct FIFO *fifo, int n);
+int fifo_get_read_span(struct FIFO *fifo, const short **span);
+void fifo_commit_read(struct FIFO *fifo, int n);
+
 /*!
  * Return the number of bytes stored in the FIFO.
  */
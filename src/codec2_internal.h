@@ -29,37 +29,220 @@
 #ifndef __CODEC2_INTERNAL__
 #define __CODEC2_INTERNAL__
 
-struct CODEC2 {
-    int           mode;
-    kiss_fft_cfg  fft_fwd_cfg;             /* forward FFT config                        */
+#include "codec2.h"
+#include "quantise.h"
+#include "sine.h"
+#ifdef CODEC2_FIXED_DECODER
+#include "fixed_dsp.h"
+#endif
+
+/* See codec2_encode_analyse().  The LSP quantisers look at the
+   analysis window as it stood at the end of each 20 ms, unless the
+   transcoder gives them the LSPs and energy of those 20 ms. */
+
+struct CODEC2_ANALYSIS {
+    int       mode;                        /* of the encoder that filled it in          */
+    MODEL     model[4];                    /* model of each 10 ms analysis frame        */
+    float     Sn[2][M];                    /* c2->Sn after the 2nd and 4th              */
+    int       lpc;                         /* non-zero to use lsps[] and e[], not Sn[]  */
+    float     lsps[2][LPC_ORD];            /* in the encoder's LPC order                */
+    float     e[2];
+};
+
+/* One 10 ms frame's decoded parameters, see codec2_transcode() */
+
+struct CODEC2_PARAMS {
+    float     Wo;
+    int       L;
+    int       voiced;
+    float     e;                           /* LPC energy                                */
+    int       order;                       /* of lsps[]                                 */
+    float     lsps[LPC_ORD];
+};
+
+#ifdef CODEC2_SCRATCH_ARENA
+
+/* The largest per frame temporaries of the encoders and decoders,
+   which CODEC2_SCRATCH_ARENA builds keep in a scratch arena rather than
+   on the stack, see codec2_set_scratch().  Only one encode or decode
+   uses the arena at a time, so the two sides overlap. */
+
+struct CODEC2_SCRATCH {
+    union {
+	struct {
+	    MODEL     model[4];            /* decoded model of each 10 ms frame */
+	    COMP      Aw[FFT_ENC];         /* aks_to_M2() output spectrum       */
+	    LPC_PF_WS pf;                  /* lpc_post_filter() buffers         */
+	} dec;
+	struct {
+	    short     bpf_speech[4*N];     /* 700 and 700B band pass filtered   */
+	                                   /* speech                            */
+	    struct CODEC2_ANALYSIS analysis; /* codec2_encode() analysis      */
+	} enc;
+    } u;
+};
+
+#endif
+
+/* Read only states only the encoders use, built by the first instance
+   that can encode, so a process that only decodes never makes them */
+
+struct CODEC2_ENC_TEMPLATE {
     float         w[M];	                   /* time domain hamming window                */
     COMP          W[FFT_ENC];	           /* DFT of w[]                                */
+    VOICING_TAB   voicing_tab;             /* band energies of W[] for est_voicing_mbe()*/
+    void         *nlp;                     /* NLP window and FFT config                 */
+};
+
+/* Read only states that are identical for every instance.  One copy is
+   shared by all instances, reference counted by codec2_create() and
+   codec2_destroy(), or one per replica for codec2_create_in_place_node(). */
+
+struct CODEC2_TEMPLATE {
+    int           refs;                    /* number of instances using this template   */
+    int           node;                    /* replica, see codec2_create_in_place_node() */
+    kiss_fft_cfg  fft_fwd_cfg;             /* forward FFT config                        */
+    kiss_fftr_cfg fftr_fwd_cfg;            /* forward real FFT config                   */
+    kiss_fftr_cfg fftr_inv_cfg;            /* inverse real FFT config                   */
     float         Pn[2*N];	           /* trapezoidal synthesis window              */
-    float        *bpf_buf;                 /* buffer for band pass filter               */
-    float         Sn[M];                   /* input speech                              */
-    float         hpf_states[2];           /* high pass filter states                   */
-    void         *nlp;                     /* pitch predictor states                    */
-    int           gray;                    /* non-zero for gray encoding                */
+#ifdef CODEC2_FIXED_DECODER
+    q15_t         Pn_q15[2*N];             /* Pn[] in Q15 for synthesise_fixed()        */
+#endif
+    struct CODEC2_ENC_TEMPLATE *enc;       /* encoder states, or NULL until needed      */
+};
 
-    kiss_fft_cfg  fft_inv_cfg;             /* inverse FFT config                        */
-    float         Sn_[2*N];	           /* synthesised output speech                 */
+/* An instance's states, in the order a frame touches them: the hot
+   states every frame reads or writes first, each group starting a
+   cache line, then the work spaces, then the cold states only set up,
+   the optional APIs and statistics use.  The read only tables live in
+   the shared template, instances only point at them.  Instances start
+   on a line, see create_in_place(). */
+
+#define CODEC2_LINE 64
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CODEC2_LINE_ALIGN __attribute__((aligned(CODEC2_LINE)))
+#elif defined(_MSC_VER)
+#define CODEC2_LINE_ALIGN __declspec(align(CODEC2_LINE))
+#else
+#define CODEC2_LINE_ALIGN
+#endif
+
+struct CODEC2 {
+
+    /* hot: frame to frame states, one line */
+
+    CODEC2_LINE_ALIGN
+    int           mode;
+    int           Sn_pos;                  /* oldest sample in Sn_buf[]                 */
+    float         hpf_states[2];           /* high pass filter states                   */
+    float         prev_Wo_enc;             /* previous frame's pitch estimate           */
+    float         xq_enc[2];               /* joint pitch and energy VQ states          */
+    float         xq_dec[2];
     float         ex_phase;                /* excitation model phase track              */
     float         bg_est;                  /* background noise estimate for post filter */
-    float         prev_Wo_enc;             /* previous frame's pitch estimate           */
-    MODEL         prev_model_dec;          /* previous frame's model parameters         */
-    float         prev_lsps_dec[LPC_ORD];  /* previous frame's LSPs                     */
     float         prev_e_dec;              /* previous frame's LPC energy               */
+    int           dtx_silent;              /* silent frames in a row                    */
+    unsigned long rand_state;              /* codec2_rand() state for phase synthesis   */
 
+    /* hot: pointers and settings every frame reads */
+
+    CODEC2_LINE_ALIGN
+    kiss_fft_cfg  fft_fwd_cfg;             /* forward FFT config                        */
+    kiss_fftr_cfg fftr_fwd_cfg;            /* forward real FFT config                   */
+    kiss_fftr_cfg fftr_inv_cfg;            /* inverse real FFT config                   */
+    float        *w;	                   /* time domain hamming window                */
+    COMP         *W;	                   /* DFT of w[]                                */
+    const VOICING_TAB *voicing_tab;        /* band energies of W[]                      */
+    float        *Pn;	                   /* trapezoidal synthesis window              */
+#ifdef CODEC2_FIXED_DECODER
+    const q15_t  *Pn_q15;                  /* fixed point synthesis window              */
+#endif
+    void         *nlp;                     /* pitch predictor states, NULL in decoders  */
+    float        *Sn;                      /* latest M input speech samples, in Sn_buf  */
+    float        *Sn_buf;                  /* 2*M input speech ring, NULL in decoders   */
+    float        *bpf_buf;                 /* 700/700B encoder BPF history, or NULL     */
+    COMP         *Sw_enc;                  /* DFT of the analysis window, FFT_ENC bins  */
+    SW_POWER     *Sw_pow;                  /* power spectrum of the frame's DFT         */
+    float        *lpc_Wr;                  /* speech_to_uq_lsps() windowed speech       */
+    const float  *softdec;                 /* optional soft decn bits from demod        */
+    COMP         *bank_Sw;                 /* next dft_speech() output, and NLP power   */
+    COMP         *bank_Fw;                 /* spectrum, from a channel bank, or NULL    */
+    const float  *float_in;                /* codec2_encode_float() speech, or NULL     */
+    float        *float_out;               /* codec2_decode_float() speech, or NULL     */
+    struct CODEC2_PARAMS *params_out;      /* decoded parameters, or NULL               */
+    COMP         *mix_Sw;                  /* codec2_mix_add() spectra, or NULL         */
+    SYNTH_UP     *synth_up;                /* output rate synthesis, NULL at FS         */
+#ifdef CODEC2_SCRATCH_ARENA
+    struct CODEC2_SCRATCH *scratch;        /* per frame temporaries, may be shared      */
+#endif
+    float         float_gain;              /* float_in and float_out scaling            */
+    float         mix_gain;                /* the stream's gain in the mix_Sw mix       */
     int           lpc_pf;                  /* LPC post filter on                        */
     int           bass_boost;              /* LPC post filter bass boost                */
     float         beta;                    /* LPC post filter parameters                */
     float         gamma;
+    int           gray;                    /* non-zero for gray encoding                */
+    int           smoothing;               /* enable smoothing for channels with errors */
+    int           vq_search;               /* CODEC2_VQ_SEARCH_FULL or _FAST            */
+    int           pitch_refine;            /* CODEC2_PITCH_REFINE_FULL or _FAST         */
+    int           lag_window;              /* non-zero to apply lag_win[]               */
+    int           dtx;                     /* non-zero for codec2_encode_dtx() to skip  */
+    int           muted;                   /* non-zero in codec2_decode_muted()         */
+    int           stats_enabled;           /* non-zero to update stats                  */
+    int           flush_denormals;         /* FTZ/DAZ on during each call               */
 
-    float         xq_enc[2];               /* joint pitch and energy VQ states          */
-    float         xq_dec[2];
+    /* hot: the decoder's previous frame and synthesis overlap */
 
-    int           smoothing;               /* enable smoothing for channels with errors */
-    float        *softdec;                 /* optional soft decn bits from demod        */
+    CODEC2_LINE_ALIGN
+    float         prev_lsps_dec[LPC_ORD];  /* previous frame's LSPs                     */
+    MODEL         prev_model_dec;          /* previous frame's model parameters         */
+    float         Sn_[2*N];	           /* synthesised output speech                 */
+#ifdef CODEC2_FIXED_DECODER
+    q31_t         Sn_fx[2*N];              /* Sn_[] with FIXED_SN_SHIFT fraction bits   */
+#endif
+
+    /* Per frame work space, here rather than on the stack.  The
+       partly written spectra are kept zero between frames, and only
+       the bins written last time are cleared. */
+
+    CODEC2_LINE_ALIGN
+    SYNTH_WS      synth_ws;                /* synthesise() work space                   */
+    AKS_TO_M2_WS  aks_ws;                  /* aks_to_M2() work space                    */
+    LPC_ENV_CACHE env_cache;               /* decoder envelopes of recent LSP vectors   */
+    struct LSPMELVQ_MBEST mbest;           /* mel LSP VQ M-best lists                   */
+
+    /* cold */
+
+    CODEC2_LINE_ALIGN
+    struct CODEC2_TEMPLATE *tmpl;          /* shared read only states                   */
+    void         *own_mem;                 /* block codec2_destroy() frees, or NULL     */
+#ifdef CODEC2_SCRATCH_ARENA
+    void         *own_scratch;             /* arena codec2_create() allocated, or NULL  */
+#endif
+    float         lag_win[LPC_ORD+1];      /* see codec2_set_lag_window()               */
+    float         dtx_level;               /* mean square input of a silent frame       */
+    float         muted_energy;            /* codec2_decode_muted() sum of 10 ms frame  */
+                                           /* energies                                  */
+    int           muted_voiced;            /* and count of voiced 10 ms frames          */
+
+    short         stream_speech[4*N];      /* partial frame for codec2_encode_stream()  */
+    int           stream_nspeech;          /* samples in stream_speech[]                */
+    unsigned char stream_bits[8];          /* partial frame for codec2_decode_stream()  */
+    int           stream_nbits;            /* bytes in stream_bits[]                    */
+
+    struct CODEC2_STATS stats;             /* see codec2_enable_stats()                 */
+    unsigned long deadline;                /* codec2_set_deadline() ticks, 0 for none   */
 };
 
+/* An instance's mode, a constant when the library has only one */
+
+#ifdef CODEC2_ONLY_MODE
+#define CODEC2_MODE_OF(c2) ((void)(c2), CODEC2_ONLY_MODE)
+#else
+#define CODEC2_MODE_OF(c2) ((c2)->mode)
+#endif
+
+void synthesise_mixed_frame(struct CODEC2 *c2, const struct CODEC2_PCM *speech, int pos, COMP Sw[]);
+
 #endif
@@ -0,0 +1,299 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_jitter.c
+  DATE CREATED: Oct 2026
+
+  Jitter buffer decoder, see codec2_jitter.h.  Frames wait in a ring
+  of slots indexed by sequence number, each slot marked full by a
+  release store once its bits are in place, and freed the same way by
+  the decoder.  The decoder only advances next, the frame it decodes
+  next, after the slot is freed, so the network side never writes a
+  slot the decoder is reading.  Decoded speech goes into a FIFO (see
+  fifo.c), straight into its buffer where the frame doesn't wrap.
+
+  A missing frame is concealed by codec2_decode_missing(), which fades
+  the last frame decoded out.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec2.h"
+#include "codec2_fifo.h"
+#include "codec2_jitter.h"
+
+/* Acquire loads and release stores of the int sized fields the
+   network side and the decoder share.  The MSVC interlocked functions
+   are full barriers, stronger than needed but on every target. */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOAD(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define LOAD(x)     _InterlockedOr((volatile long*)&(x), 0)
+#define STORE(x, v) _InterlockedExchange((volatile long*)&(x), (long)(v))
+#else
+#error "codec2_jitter.c needs atomic loads and stores for this compiler"
+#endif
+
+struct CODEC2_JITTER {
+    struct CODEC2 *c2;
+    int            nsam;               /* samples per frame                     */
+    int            nbyte;              /* bytes per frame                       */
+    int            depth;              /* frames buffered before playout        */
+    int            nslots;
+    unsigned char *bits;               /* nslots frames                         */
+    unsigned int  *seq;                /* sequence number of each slot's frame  */
+    int           *full;               /* non-zero if the slot holds a frame    */
+    short         *frame;              /* a frame that wraps in the FIFO        */
+    struct FIFO   *pcm;                /* decoded speech                        */
+
+    int            started;            /* non-zero once a frame has arrived     */
+    unsigned int   next;               /* next frame to decode                  */
+    unsigned int   newest;             /* latest sequence number put            */
+    int            playing;            /* zero while filling up to depth frames */
+
+    struct CODEC2_JITTER_STATS stats;
+};
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_jitter_create
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_JITTER *codec2_jitter_create(int mode, int depth)
+{
+    struct CODEC2_JITTER *jb;
+
+    if ((mode < CODEC2_MODE_3200) || (mode > CODEC2_MODE_700B) || (depth <= 0))
+	return NULL;
+    jb = (struct CODEC2_JITTER*)calloc(1, sizeof(struct CODEC2_JITTER));
+    if (jb == NULL)
+	return NULL;
+    jb->c2 = codec2_create_decoder(mode);
+    if (jb->c2 == NULL) {
+	free(jb);
+	return NULL;
+    }
+    jb->nsam = codec2_samples_per_frame(jb->c2);
+    jb->nbyte = (codec2_bits_per_frame(jb->c2) + 7)/8;
+    jb->depth = depth;
+
+    /* room for frames that arrive up to depth frames early, as well as
+       the depth that may be waiting.  A power of two, so slots follow
+       the sequence numbers across a wrap. */
+
+    for(jb->nslots=4; jb->nslots < 2*depth + 2; jb->nslots *= 2)
+	;
+    jb->bits = (unsigned char*)malloc(jb->nslots*jb->nbyte);
+    jb->seq = (unsigned int*)calloc(jb->nslots, sizeof(unsigned int));
+    jb->full = (int*)calloc(jb->nslots, sizeof(int));
+    jb->frame = (short*)malloc(jb->nsam*sizeof(short));
+    if ((jb->bits == NULL) || (jb->seq == NULL) || (jb->full == NULL) || (jb->frame == NULL)) {
+	codec2_jitter_destroy(jb);
+	return NULL;
+    }
+
+    /* one more frame than depth, for the frame being decoded while
+       depth are waiting to play, and fifo_free() keeps one spare */
+
+    jb->pcm = fifo_create((depth + 1)*jb->nsam + 1);
+    if (jb->pcm == NULL) {
+	codec2_jitter_destroy(jb);
+	return NULL;
+    }
+
+    return jb;
+}
+
+void codec2_jitter_destroy(struct CODEC2_JITTER *jb)
+{
+    assert(jb != NULL);
+    if (jb->pcm)
+	fifo_destroy(jb->pcm);
+    codec2_destroy(jb->c2);
+    free(jb->bits);
+    free(jb->seq);
+    free(jb->full);
+    free(jb->frame);
+    free(jb);
+}
+
+struct CODEC2 *codec2_jitter_codec(struct CODEC2_JITTER *jb)
+{
+    assert(jb != NULL);
+    return jb->c2;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_jitter_put
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_jitter_put(struct CODEC2_JITTER *jb, unsigned int seq, const unsigned char bits[])
+{
+    unsigned int next;
+    int          d, slot;
+
+    assert(jb != NULL);
+    assert(bits != NULL);
+
+    /* the first frame starts the sequence, after that only the
+       decoder moves next on */
+
+    if (!jb->started) {
+	jb->next = jb->newest = seq;
+	STORE(jb->started, 1);
+    }
+
+    /* a slot can be left full by a frame that arrived as the decoder
+       gave up on it, that frame is behind next and the slot is free */
+
+    next = LOAD(jb->next);
+    d = (int)(seq - next);
+    slot = seq % jb->nslots;
+    if ((d < 0) || (d >= jb->nslots) || (LOAD(jb->full[slot]) && ((int)(LOAD(jb->seq[slot]) - next) >= 0))) {
+	jb->stats.dropped++;
+	return -1;
+    }
+
+    /* free a stale slot before rewriting it, and publish seq after the
+       bits, so a decoder that sees this seq sees the whole frame */
+
+    STORE(jb->full[slot], 0);
+    memcpy(&jb->bits[slot*jb->nbyte], bits, jb->nbyte);
+    if ((int)(seq - jb->newest) > 0)
+	STORE(jb->newest, seq);
+    STORE(jb->seq[slot], seq);
+    STORE(jb->full[slot], 1);
+    jb->stats.received++;
+
+    return 0;
+}
+
+/* Decodes or conceals frame next into the FIFO */
+
+static void decode_frame(struct CODEC2_JITTER *jb, const unsigned char *bits)
+{
+    short *speech;
+    int    n;
+
+    n = fifo_get_write_span(jb->pcm, &speech);
+    if (n < jb->nsam)
+	speech = jb->frame;
+
+    if (bits != NULL) {
+	codec2_decode(jb->c2, speech, bits);
+	jb->stats.decoded++;
+    }
+    else {
+	codec2_decode_missing(jb->c2, speech);
+	jb->stats.concealed++;
+    }
+
+    if (speech == jb->frame)
+	fifo_write(jb->pcm, jb->frame, jb->nsam);
+    else
+	fifo_commit_write(jb->pcm, jb->nsam);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_jitter_decode
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_jitter_decode(struct CODEC2_JITTER *jb)
+{
+    unsigned int next;
+    int          slot, n = 0;
+
+    assert(jb != NULL);
+    if (!LOAD(jb->started))
+	return 0;
+
+    next = jb->next;
+    while(fifo_free(jb->pcm) >= jb->nsam) {
+	slot = next % jb->nslots;
+	if (LOAD(jb->full[slot]) && (LOAD(jb->seq[slot]) == next)) {
+	    decode_frame(jb, &jb->bits[slot*jb->nbyte]);
+	    STORE(jb->full[slot], 0);
+	}
+	else if (((int)(LOAD(jb->newest) - next) >= jb->depth) ||
+		 (LOAD(jb->playing) && (fifo_used(jb->pcm) < jb->nsam)))
+	    decode_frame(jb, NULL);
+	else
+	    break;
+	STORE(jb->next, ++next);
+	n++;
+    }
+
+    return n;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_jitter_read
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_jitter_read(struct CODEC2_JITTER *jb, short speech[], int n)
+{
+    int used;
+
+    assert(jb != NULL);
+    assert(n >= 0);
+
+    used = fifo_used(jb->pcm);
+    if (!jb->playing && (used >= jb->depth*jb->nsam))
+	STORE(jb->playing, 1);
+    if (!jb->playing) {
+	memset(speech, 0, n*sizeof(short));
+	return 0;
+    }
+
+    if (used >= n) {
+	fifo_read(jb->pcm, speech, n);
+	return n;
+    }
+
+    /* underrun, play what there is then fill up again */
+
+    fifo_read(jb->pcm, speech, used);
+    memset(&speech[used], 0, (n - used)*sizeof(short));
+    STORE(jb->playing, 0);
+    jb->stats.underruns++;
+
+    return used;
+}
+
+void codec2_jitter_get_stats(struct CODEC2_JITTER *jb, struct CODEC2_JITTER_STATS *stats)
+{
+    assert(jb != NULL);
+    assert(stats != NULL);
+    *stats = jb->stats;
+}
@@ -0,0 +1,137 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_mix.c
+  DATE CREATED: Oct 2026
+
+  Model domain mixer, see codec2_mix.h.  codec2_mix_add() decodes a
+  stream as usual up to the post filter, phases and all, then
+  synth_accumulate() adds its harmonics to the mix's spectrum of each
+  10 ms frame instead of synthesising them.  codec2_mix_read() turns
+  the spectra to speech with the synthesis state of a codec instance
+  of its own, see synthesise_mixed_frame().
+
+  The inverse DFT and overlap-add are linear, so the mix is the sum of
+  the streams' speech, short of rounding, and ear protection and
+  clipping apply to the mix rather than to each stream.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "defines.h"
+#include "codec2.h"
+#include "codec2_internal.h"
+#include "codec2_mix.h"
+
+#define MIX_BINS (FFT_DEC/2+1)
+
+struct CODEC2_MIX {
+    struct CODEC2 *out;                /* synthesis state of the mix            */
+    int            nsam;               /* samples per frame                     */
+    int            nstreams;           /* streams added to this frame           */
+    COMP          *Sw;                 /* spectrum of each 10 ms frame          */
+};
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_mix_create
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_MIX *codec2_mix_create(int mode)
+{
+    struct CODEC2_MIX *mix;
+
+    if ((mode < CODEC2_MODE_3200) || (mode > CODEC2_MODE_700B))
+	return NULL;
+    mix = (struct CODEC2_MIX*)calloc(1, sizeof(struct CODEC2_MIX));
+    if (mix == NULL)
+	return NULL;
+    mix->out = codec2_create_decoder(mode);
+    if (mix->out == NULL) {
+	free(mix);
+	return NULL;
+    }
+    mix->nsam = codec2_samples_per_frame(mix->out);
+
+    /* synth_spectrum() leaves each spectrum zero for the next frame */
+
+    mix->Sw = (COMP*)calloc((mix->nsam/N)*MIX_BINS, sizeof(COMP));
+    if (mix->Sw == NULL) {
+	codec2_mix_destroy(mix);
+	return NULL;
+    }
+
+    return mix;
+}
+
+void codec2_mix_destroy(struct CODEC2_MIX *mix)
+{
+    assert(mix != NULL);
+    codec2_destroy(mix->out);
+    free(mix->Sw);
+    free(mix);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_mix_add
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_mix_add(struct CODEC2_MIX *mix, struct CODEC2 *c2, const unsigned char *bits, float gain)
+{
+    struct CODEC2_PCM pcm = { { NULL, NULL }, { 0, 0 }, 1 };
+
+    assert(mix != NULL);
+    assert(c2 != NULL);
+    assert(codec2_samples_per_frame(c2) == mix->nsam);
+
+    c2->mix_Sw = mix->Sw;
+    c2->mix_gain = gain;
+    codec2_decode_pcm(c2, &pcm, bits);
+    c2->mix_Sw = NULL;
+    mix->nstreams++;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_mix_read
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_mix_read(struct CODEC2_MIX *mix, short speech[])
+{
+    struct CODEC2_PCM pcm = { { speech, NULL }, { 0, 0 }, 1 };
+    int               i, n;
+
+    assert(mix != NULL);
+    assert(speech != NULL);
+
+    pcm.len[0] = mix->nsam;
+    for(i=0; i<mix->nsam; i+=N)
+	synthesise_mixed_frame(mix->out, &pcm, i, &mix->Sw[(i/N)*MIX_BINS]);
+
+    n = mix->nstreams;
+    mix->nstreams = 0;
+    return n;
+}
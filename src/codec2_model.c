@@ -0,0 +1,246 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_model.c
+  DATE CREATED: Oct 2026
+
+  Analysis only API, see codec2_model.h.  An analyser is an encoder
+  that stops after codec2_encode_analyse(), its struct CODEC2_ANALYSIS
+  copied out as model records rather than quantised.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "codec2.h"
+#include "codec2_internal.h"
+#include "codec2_model.h"
+
+#define C2M_MAGIC  0x444d3243         /* "C2MD"                                */
+
+struct CODEC2_ANALYSER {
+    struct CODEC2          *c2;        /* encoder doing the analysis            */
+    struct CODEC2_ANALYSIS *analysis;
+    int                     nsam;      /* samples per frame                     */
+};
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_analyser_create
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_ANALYSER *codec2_analyser_create(int mode)
+{
+    struct CODEC2_ANALYSER *a;
+
+    if ((mode < CODEC2_MODE_3200) || (mode > CODEC2_MODE_700B))
+	return NULL;
+    a = (struct CODEC2_ANALYSER*)calloc(1, sizeof(struct CODEC2_ANALYSER));
+    if (a == NULL)
+	return NULL;
+    a->c2 = codec2_create(mode);
+    a->analysis = (struct CODEC2_ANALYSIS*)malloc(codec2_analysis_size());
+    if ((a->c2 == NULL) || (a->analysis == NULL)) {
+	codec2_analyser_destroy(a);
+	return NULL;
+    }
+    a->nsam = codec2_samples_per_frame(a->c2);
+
+    return a;
+}
+
+void codec2_analyser_destroy(struct CODEC2_ANALYSER *a)
+{
+    assert(a != NULL);
+    if (a->c2 != NULL)
+	codec2_destroy(a->c2);
+    free(a->analysis);
+    free(a);
+}
+
+int codec2_analyser_samples_per_frame(struct CODEC2_ANALYSER *a)
+{
+    assert(a != NULL);
+    return a->nsam;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_analyse
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_analyse(struct CODEC2_ANALYSER *a, struct CODEC2_MODEL_RECORD rec[], short speech[])
+{
+    const MODEL *model;
+    float        e;
+    int          k, m;
+
+    assert(a != NULL);
+    assert(rec != NULL);
+    assert(CODEC2_MAX_AMP == MAX_AMP);
+
+    codec2_encode_analyse(a->c2, a->analysis, speech);
+
+    for(k=0; k<a->nsam/N; k++) {
+	model = &a->analysis->model[k];
+	rec[k].Wo = model->Wo;
+	rec[k].L = model->L;
+	rec[k].voiced = model->voiced;
+	e = 1E-4;
+	for(m=1; m<=model->L; m++)
+	    e += model->A[m]*model->A[m];
+	rec[k].energy = 10.0*log10f(e);
+	memcpy(rec[k].A, model->A, sizeof(rec[k].A));
+    }
+
+    return a->nsam/N;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                               MODEL FILES
+
+\*---------------------------------------------------------------------------*/
+
+static void put32(unsigned char *p, uint32_t x)
+{
+    p[0] = x & 0xff;
+    p[1] = (x >> 8) & 0xff;
+    p[2] = (x >> 16) & 0xff;
+    p[3] = (x >> 24) & 0xff;
+}
+
+static void putf(unsigned char *p, float x)
+{
+    uint32_t u;
+
+    memcpy(&u, &x, sizeof(u));
+    put32(p, u);
+}
+
+/* Reads nsam little endian samples, returns 0 at the end of the file */
+
+static int read_frame(FILE *fp, short speech[], unsigned char buf[], int nsam)
+{
+    int i;
+
+    if (fread(buf, 2, nsam, fp) != (size_t)nsam)
+	return 0;
+    for(i=0; i<nsam; i++)
+	speech[i] = (short)((uint16_t)buf[2*i] | ((uint16_t)buf[2*i+1] << 8));
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_analyse_file
+  DATE CREATED: Oct 2026
+
+  The columns are gathered in memory, 9 bytes per 10 ms, and written
+  one after the other once the whole file has been analysed.
+
+\*---------------------------------------------------------------------------*/
+
+long codec2_analyse_file(int mode, const char *speech_path, const char *model_path)
+{
+    struct CODEC2_ANALYSER     *a;
+    struct CODEC2_MODEL_RECORD  rec[4];
+    FILE                       *in, *out;
+    unsigned char               hdr[CODEC2_MODEL_FILE_HEADER];
+    unsigned char              *buf, *Wo, *energy, *voiced;
+    short                      *speech;
+    long                        size, n, nrec;
+    int                         k, nsub, err;
+
+    assert(speech_path != NULL);
+    assert(model_path != NULL);
+
+    a = codec2_analyser_create(mode);
+    if (a == NULL)
+	return -1;
+    in = fopen(speech_path, "rb");
+    if (in == NULL) {
+	codec2_analyser_destroy(a);
+	return -1;
+    }
+    if ((fseek(in, 0, SEEK_END) != 0) || ((size = ftell(in)) < 0) || (fseek(in, 0, SEEK_SET) != 0)) {
+	fclose(in);
+	codec2_analyser_destroy(a);
+	return -1;
+    }
+
+    nsub = a->nsam/N;
+    nrec = (size/2/a->nsam)*nsub;
+    speech = (short*)malloc(sizeof(short)*a->nsam);
+    buf = (unsigned char*)malloc(2*a->nsam);
+    Wo = (unsigned char*)malloc(4*nrec + 1);
+    energy = (unsigned char*)malloc(4*nrec + 1);
+    voiced = (unsigned char*)malloc(nrec + 1);
+    err = (speech == NULL) || (buf == NULL) || (Wo == NULL) || (energy == NULL) || (voiced == NULL);
+
+    for(n=0; !err && (n<nrec) && read_frame(in, speech, buf, a->nsam); n+=nsub) {
+	codec2_analyse(a, rec, speech);
+	for(k=0; k<nsub; k++) {
+	    putf(&Wo[4*(n+k)], rec[k].Wo);
+	    putf(&energy[4*(n+k)], rec[k].energy);
+	    voiced[n+k] = rec[k].voiced != 0;
+	}
+    }
+    fclose(in);
+    err |= n != nrec;
+
+    out = err ? NULL : fopen(model_path, "wb");
+    if (out != NULL) {
+	put32(&hdr[0], C2M_MAGIC);
+	hdr[4] = CODEC2_MODEL_FILE_VERSION & 0xff;
+	hdr[5] = CODEC2_MODEL_FILE_VERSION >> 8;
+	hdr[6] = CODEC2_MODEL_FILE_HEADER & 0xff;
+	hdr[7] = CODEC2_MODEL_FILE_HEADER >> 8;
+	put32(&hdr[8], mode);
+	put32(&hdr[12], N);
+	put32(&hdr[16], nrec);
+	put32(&hdr[20], CODEC2_MODEL_FILE_HEADER);
+	put32(&hdr[24], CODEC2_MODEL_FILE_HEADER + 4*nrec);
+	put32(&hdr[28], CODEC2_MODEL_FILE_HEADER + 8*nrec);
+	err |= fwrite(hdr, 1, sizeof(hdr), out) != sizeof(hdr);
+	err |= fwrite(Wo, 4, nrec, out) != (size_t)nrec;
+	err |= fwrite(energy, 4, nrec, out) != (size_t)nrec;
+	err |= fwrite(voiced, 1, nrec, out) != (size_t)nrec;
+	err |= fclose(out) != 0;
+    }
+    else
+	err = 1;
+
+    free(speech);
+    free(buf);
+    free(Wo);
+    free(energy);
+    free(voiced);
+    codec2_analyser_destroy(a);
+
+    return err ? -1 : nrec;
+}
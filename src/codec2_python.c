@@ -0,0 +1,792 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_python.c
+  DATE CREATED: Oct 2026
+
+  CPython extension module "codec2".  Speech is taken through the buffer
+  protocol, so NumPy int16 and float32 arrays (or array.array, or a
+  memoryview of either) are read where they lie, and a whole array is
+  coded by one call with the GIL released.  The module level functions
+  spread independent streams, or the segments of one long recording,
+  over worker threads, each on its own instance.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include <limits.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "codec2.h"
+
+#define SPEECH_SHORT 0
+#define SPEECH_FLOAT 1
+
+#define ENCODE_SCALE 32768.0f          /* float speech in +/- 1.0 */
+
+/*---------------------------------------------------------------------------*\
+
+                                 BUFFERS
+
+\*---------------------------------------------------------------------------*/
+
+/* C contiguous int16 or float32 samples in native byte order */
+
+static int get_speech(PyObject *obj, Py_buffer *view, int flags, int *type)
+{
+    const char *fmt;
+
+    if (PyObject_GetBuffer(obj, view, flags | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0)
+	return -1;
+
+    fmt = view->format != NULL ? view->format : "B";
+    if ((*fmt == '@') || (*fmt == '=') || ((*fmt == '<') && PY_LITTLE_ENDIAN) ||
+	(((*fmt == '>') || (*fmt == '!')) && !PY_LITTLE_ENDIAN))
+	fmt++;
+    if ((strcmp(fmt, "h") == 0) && (view->itemsize == 2)) {
+	*type = SPEECH_SHORT;
+	return 0;
+    }
+    if ((strcmp(fmt, "f") == 0) && (view->itemsize == 4)) {
+	*type = SPEECH_FLOAT;
+	return 0;
+    }
+
+    PyBuffer_Release(view);
+    PyErr_SetString(PyExc_TypeError, "speech must be native int16 or float32 samples");
+    return -1;
+}
+
+static int frame_count(Py_ssize_t n, int per_frame, int *nframes)
+{
+    if (n/per_frame > INT_MAX) {
+	PyErr_SetString(PyExc_OverflowError, "too many frames for one call");
+	return -1;
+    }
+    *nframes = (int)(n/per_frame);
+    return 0;
+}
+
+/* Decoded speech as an int16 memoryview of a new bytearray, which
+   numpy.asarray() wraps without a copy */
+
+static PyObject *short_view(PyObject *bytearray)
+{
+    PyObject *mv, *view;
+
+    mv = PyMemoryView_FromObject(bytearray);
+    Py_DECREF(bytearray);
+    if (mv == NULL)
+	return NULL;
+    view = PyObject_CallMethod(mv, "cast", "s", "h");
+    Py_DECREF(mv);
+
+    return view;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                  JOBS
+
+  A job is one stream, or one segment of a stream, coded by a fresh
+  instance.  Jobs run with the GIL released and touch no Python objects.
+
+\*---------------------------------------------------------------------------*/
+
+typedef struct {
+    int          mode;
+    int          type;
+    float        scale;
+    const char  *in;                   /* warm up frames, then the frames coded */
+    const char  *tail;                 /* zero padded last frame, or NULL       */
+    char        *out;
+    int          nwarmup;
+    int          nframes;
+    int          ok;
+} job_t;
+
+static void encode_frame(struct CODEC2 *c2, unsigned char *bits, const char *speech, int type, float scale)
+{
+    if (type == SPEECH_SHORT)
+	codec2_encode(c2, bits, (short*)speech);
+    else
+	codec2_encode_float(c2, bits, (const float*)speech, scale);
+}
+
+/* as codec2_encode_segment(), for either sample type */
+
+static void encode_job(job_t *j)
+{
+    struct CODEC2 *c2 = codec2_create(j->mode);
+    unsigned char  discard[8];
+    unsigned char *bits = (unsigned char*)j->out;
+    size_t         frame;
+    int            nbyte, f;
+
+    if (c2 == NULL)
+	return;
+    nbyte = (codec2_bits_per_frame(c2) + 7)/8;
+    frame = codec2_samples_per_frame(c2)*(j->type == SPEECH_SHORT ? sizeof(short) : sizeof(float));
+
+    if (j->type == SPEECH_SHORT)
+	codec2_encode_segment(c2, bits, (short*)j->in, j->nwarmup, j->nframes);
+    else {
+	for(f=0; f<j->nwarmup; f++)
+	    encode_frame(c2, discard, &j->in[f*frame], j->type, j->scale);
+	for(f=0; f<j->nframes; f++)
+	    encode_frame(c2, &bits[f*nbyte], &j->in[(j->nwarmup + f)*frame], j->type, j->scale);
+    }
+    if (j->tail != NULL)
+	encode_frame(c2, &bits[j->nframes*nbyte], j->tail, j->type, j->scale);
+
+    codec2_destroy(c2);
+    j->ok = 1;
+}
+
+static void decode_job(job_t *j)
+{
+    struct CODEC2 *c2 = codec2_create(j->mode);
+
+    if (c2 == NULL)
+	return;
+    codec2_decode_batch(c2, (short*)j->out, (const unsigned char*)j->in, j->nframes);
+    codec2_destroy(c2);
+    j->ok = 1;
+}
+
+typedef struct {
+    job_t       *jobs;
+    int          njobs;
+    int          next;
+    void       (*run)(job_t *j);
+} pool_t;
+
+#ifndef _WIN32
+static void *pool_thread(void *arg)
+{
+    pool_t *p = (pool_t*)arg;
+    int     i;
+
+    while ((i = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED)) < p->njobs)
+	p->run(&p->jobs[i]);
+    return NULL;
+}
+#endif
+
+static int default_threads(int nthreads)
+{
+#ifndef _WIN32
+    if (nthreads <= 0)
+	nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return nthreads > 0 ? nthreads : 1;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: run_jobs
+  DATE CREATED: Oct 2026
+
+  Runs the jobs on up to nthreads threads, the calling one included,
+  each taking the next job until none are left.  Called with the GIL
+  released.  Returns 0, or -1 if a job couldn't create its instance.
+  Without pthreads (Windows) the jobs run one after the other.
+
+\*---------------------------------------------------------------------------*/
+
+static int run_jobs(job_t jobs[], int njobs, int nthreads, void (*run)(job_t *j))
+{
+    pool_t     p;
+    int        i;
+#ifndef _WIN32
+    pthread_t *threads = NULL;
+    int        started = 0;
+#endif
+
+    p.jobs = jobs;
+    p.njobs = njobs;
+    p.next = 0;
+    p.run = run;
+
+#ifndef _WIN32
+    if (nthreads > njobs)
+	nthreads = njobs;
+    if (nthreads > 1)
+	threads = (pthread_t*)PyMem_RawMalloc((nthreads - 1)*sizeof(pthread_t));
+    if (threads != NULL)
+	for(started=0; started<nthreads-1; started++)
+	    if (pthread_create(&threads[started], NULL, pool_thread, &p) != 0)
+		break;
+    pool_thread(&p);
+    for(i=0; i<started; i++)
+	pthread_join(threads[i], NULL);
+    PyMem_RawFree(threads);
+#else
+    (void)nthreads;
+    for(i=0; i<njobs; i++)
+	run(&jobs[i]);
+#endif
+
+    for(i=0; i<njobs; i++)
+	if (!jobs[i].ok)
+	    return -1;
+    return 0;
+}
+
+/* Zero padded copy of the samples after the last whole frame, NULL
+   and no error if there are none */
+
+static char *make_tail(const Py_buffer *view, int nsam, int *err)
+{
+    Py_ssize_t whole = view->len/(nsam*view->itemsize)*(nsam*view->itemsize);
+    char      *tail;
+
+    *err = 0;
+    if (whole == view->len)
+	return NULL;
+    tail = (char*)PyMem_Calloc(nsam, view->itemsize);
+    if (tail == NULL) {
+	*err = 1;
+	PyErr_NoMemory();
+	return NULL;
+    }
+    memcpy(tail, (const char*)view->buf + whole, view->len - whole);
+
+    return tail;
+}
+
+/* Samples and bytes per frame of mode, ValueError if it isn't built in */
+
+static int mode_sizes(int mode, int *nsam, int *nbyte, int *warmup)
+{
+    struct CODEC2 *c2 = codec2_mode_enabled(mode) ? codec2_create(mode) : NULL;
+
+    if (c2 == NULL) {
+	PyErr_Format(PyExc_ValueError, "mode %d is not available", mode);
+	return -1;
+    }
+    *nsam = codec2_samples_per_frame(c2);
+    *nbyte = (codec2_bits_per_frame(c2) + 7)/8;
+    if (warmup != NULL)
+	*warmup = codec2_encode_warmup_frames(c2);
+    codec2_destroy(c2);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                CODEC2 TYPE
+
+  One stream, coded frame after frame across calls.
+
+\*---------------------------------------------------------------------------*/
+
+typedef struct {
+    PyObject_HEAD
+    struct CODEC2 *c2;
+    int            mode;
+    int            nsam;
+    int            nout;
+    int            nbit;
+    int            nbyte;
+    int            busy;               /* coding with the GIL released */
+} Codec2Object;
+
+static int Codec2_init(Codec2Object *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"mode", NULL};
+    int          mode;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "i", kwlist, &mode))
+	return -1;
+    if (self->busy) {
+	PyErr_SetString(PyExc_RuntimeError, "Codec2 object in use by another thread");
+	return -1;
+    }
+    if (self->c2 != NULL) {
+	codec2_destroy(self->c2);
+	self->c2 = NULL;
+    }
+    if (codec2_mode_enabled(mode))
+	self->c2 = codec2_create(mode);
+    if (self->c2 == NULL) {
+	PyErr_Format(PyExc_ValueError, "mode %d is not available", mode);
+	return -1;
+    }
+
+    self->mode = mode;
+    self->nsam = codec2_samples_per_frame(self->c2);
+    self->nout = codec2_output_samples_per_frame(self->c2);
+    self->nbit = codec2_bits_per_frame(self->c2);
+    self->nbyte = (self->nbit + 7)/8;
+
+    return 0;
+}
+
+static void Codec2_dealloc(Codec2Object *self)
+{
+    if (self->c2 != NULL)
+	codec2_destroy(self->c2);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+/* Takes the instance for a call that releases the GIL */
+
+static int Codec2_acquire(Codec2Object *self)
+{
+    if (self->c2 == NULL) {
+	PyErr_SetString(PyExc_RuntimeError, "Codec2 object not initialised");
+	return -1;
+    }
+    if (self->busy) {
+	PyErr_SetString(PyExc_RuntimeError, "Codec2 object in use by another thread");
+	return -1;
+    }
+    self->busy = 1;
+    return 0;
+}
+
+PyDoc_STRVAR(Codec2_encode_doc,
+"encode(speech, scale=32768.0) -> bytes\n\n"
+"Encodes speech, whole frames of int16 or float32 samples, continuing\n"
+"the stream.  float32 samples are multiplied by scale, so by default\n"
+"they are in +/- 1.0.");
+
+static PyObject *Codec2_encode(Codec2Object *self, PyObject *args, PyObject *kwds)
+{
+    static char   *kwlist[] = {"speech", "scale", NULL};
+    PyObject      *speech, *bits;
+    Py_buffer      view;
+    float          scale = ENCODE_SCALE;
+    unsigned char *out;
+    int            type, nframes, f;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|f", kwlist, &speech, &scale))
+	return NULL;
+    if (Codec2_acquire(self) < 0)
+	return NULL;
+    if (get_speech(speech, &view, PyBUF_SIMPLE, &type) < 0)
+	goto fail;
+    if ((view.len/view.itemsize) % self->nsam != 0) {
+	PyErr_Format(PyExc_ValueError, "speech must be whole frames of %d samples", self->nsam);
+	goto fail_release;
+    }
+    if (frame_count(view.len/view.itemsize, self->nsam, &nframes) < 0)
+	goto fail_release;
+    bits = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)nframes*self->nbyte);
+    if (bits == NULL)
+	goto fail_release;
+    out = (unsigned char*)PyBytes_AS_STRING(bits);
+
+    Py_BEGIN_ALLOW_THREADS
+    if (type == SPEECH_SHORT)
+	codec2_encode_batch(self->c2, out, (short*)view.buf, nframes);
+    else
+	for(f=0; f<nframes; f++)
+	    codec2_encode_float(self->c2, &out[f*self->nbyte], (const float*)view.buf + (size_t)f*self->nsam, scale);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&view);
+    self->busy = 0;
+    return bits;
+
+fail_release:
+    PyBuffer_Release(&view);
+fail:
+    self->busy = 0;
+    return NULL;
+}
+
+PyDoc_STRVAR(Codec2_decode_doc,
+"decode(bits, out=None, scale=1/32768) -> speech\n\n"
+"Decodes bits, whole frames of bytes_per_frame bytes, continuing the\n"
+"stream.  Without out returns an int16 memoryview, which numpy.asarray()\n"
+"takes without a copy.  Else decodes into out, a writable int16 or\n"
+"float32 array at least as long, float32 samples multiplied by scale,\n"
+"and returns it.");
+
+static PyObject *Codec2_decode(Codec2Object *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"bits", "out", "scale", NULL};
+    PyObject    *bits, *out = Py_None, *result = NULL;
+    Py_buffer    in, view;
+    float        scale = 1.0f/32768.0f;
+    short       *speech;
+    int          type = SPEECH_SHORT, nframes, f;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|Of", kwlist, &bits, &out, &scale))
+	return NULL;
+    if (Codec2_acquire(self) < 0)
+	return NULL;
+    if (PyObject_GetBuffer(bits, &in, PyBUF_C_CONTIGUOUS) < 0)
+	goto fail;
+    if (in.len % self->nbyte != 0) {
+	PyErr_Format(PyExc_ValueError, "bits must be whole frames of %d bytes", self->nbyte);
+	goto fail_in;
+    }
+    if (frame_count(in.len, self->nbyte, &nframes) < 0)
+	goto fail_in;
+
+    if (out == Py_None) {
+	result = PyByteArray_FromStringAndSize(NULL, (Py_ssize_t)nframes*self->nout*sizeof(short));
+	if (result == NULL)
+	    goto fail_in;
+	speech = (short*)PyByteArray_AS_STRING(result);
+	Py_BEGIN_ALLOW_THREADS
+	codec2_decode_batch(self->c2, speech, (const unsigned char*)in.buf, nframes);
+	Py_END_ALLOW_THREADS
+	result = short_view(result);
+    }
+    else {
+	if (get_speech(out, &view, PyBUF_WRITABLE, &type) < 0)
+	    goto fail_in;
+	if (view.len/view.itemsize < (Py_ssize_t)nframes*self->nout) {
+	    PyErr_Format(PyExc_ValueError, "out holds %zd samples, %zd needed", view.len/view.itemsize,
+			 (Py_ssize_t)nframes*self->nout);
+	    PyBuffer_Release(&view);
+	    goto fail_in;
+	}
+	Py_BEGIN_ALLOW_THREADS
+	if (type == SPEECH_SHORT)
+	    codec2_decode_batch(self->c2, (short*)view.buf, (const unsigned char*)in.buf, nframes);
+	else
+	    for(f=0; f<nframes; f++)
+		codec2_decode_float(self->c2, (float*)view.buf + (size_t)f*self->nout,
+				    (const unsigned char*)in.buf + (size_t)f*self->nbyte, scale);
+	Py_END_ALLOW_THREADS
+	PyBuffer_Release(&view);
+	Py_INCREF(out);
+	result = out;
+    }
+
+fail_in:
+    PyBuffer_Release(&in);
+fail:
+    self->busy = 0;
+    return result;
+}
+
+static PyMethodDef Codec2_methods[] = {
+    {"encode", (PyCFunction)(void(*)(void))Codec2_encode, METH_VARARGS | METH_KEYWORDS, Codec2_encode_doc},
+    {"decode", (PyCFunction)(void(*)(void))Codec2_decode, METH_VARARGS | METH_KEYWORDS, Codec2_decode_doc},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyMemberDef Codec2_members[] = {
+    {"mode", T_INT, offsetof(Codec2Object, mode), READONLY, "CODEC2_MODE_* of the stream"},
+    {"samples_per_frame", T_INT, offsetof(Codec2Object, nsam), READONLY, "speech samples per frame encoded"},
+    {"output_samples_per_frame", T_INT, offsetof(Codec2Object, nout), READONLY, "speech samples per frame decoded"},
+    {"bits_per_frame", T_INT, offsetof(Codec2Object, nbit), READONLY, NULL},
+    {"bytes_per_frame", T_INT, offsetof(Codec2Object, nbyte), READONLY, NULL},
+    {NULL, 0, 0, 0, NULL}
+};
+
+PyDoc_STRVAR(Codec2_doc,
+"Codec2(mode)\n\n"
+"One stream of mode, encoded or decoded a block of frames per call.");
+
+static PyTypeObject Codec2Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "codec2.Codec2",
+    .tp_basicsize = sizeof(Codec2Object),
+    .tp_dealloc = (destructor)Codec2_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = Codec2_doc,
+    .tp_methods = Codec2_methods,
+    .tp_members = Codec2_members,
+    .tp_init = (initproc)Codec2_init,
+    .tp_new = PyType_GenericNew,
+};
+
+/*---------------------------------------------------------------------------*\
+
+                            MODULE FUNCTIONS
+
+\*---------------------------------------------------------------------------*/
+
+PyDoc_STRVAR(encode_doc,
+"encode(speech, mode, threads=0, scale=32768.0) -> bytes\n\n"
+"Encodes a whole recording, int16 or float32 samples, the last frame\n"
+"padded with silence.  It is split into up to threads segments (0 for\n"
+"one per CPU) encoded in parallel, each primed with the frames before\n"
+"it as codec2_encode_segment() describes.");
+
+static PyObject *codec2_py_encode(PyObject *module, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"speech", "mode", "threads", "scale", NULL};
+    PyObject    *speech, *bits = NULL;
+    Py_buffer    view;
+    job_t       *jobs = NULL;
+    char        *tail = NULL;
+    float        scale = ENCODE_SCALE;
+    size_t       frame;
+    int          mode, nthreads = 0, type, nsam, nbyte, warmup, nfull, nframes, i, start, len, err, rc;
+
+    (void)module;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oi|if", kwlist, &speech, &mode, &nthreads, &scale))
+	return NULL;
+    if (mode_sizes(mode, &nsam, &nbyte, &warmup) < 0)
+	return NULL;
+    if (get_speech(speech, &view, PyBUF_SIMPLE, &type) < 0)
+	return NULL;
+    if (frame_count(view.len/view.itemsize + nsam - 1, nsam, &nframes) < 0)
+	goto done;
+    nfull = (int)(view.len/view.itemsize/nsam);
+    frame = nsam*view.itemsize;
+
+    tail = make_tail(&view, nsam, &err);
+    if (err)
+	goto done;
+    bits = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)nframes*nbyte);
+    if (bits == NULL)
+	goto done;
+
+    /* segments much shorter than the warm up would mostly redo work */
+    nthreads = default_threads(nthreads);
+    if ((warmup > 0) && (nthreads > nfull/(4*warmup) + 1))
+	nthreads = nfull/(4*warmup) + 1;
+    jobs = (job_t*)PyMem_Calloc(nthreads, sizeof(job_t));
+    if (jobs == NULL) {
+	PyErr_NoMemory();
+	Py_CLEAR(bits);
+	goto done;
+    }
+    for(i=0, start=0; i<nthreads; i++) {
+	len = nfull/nthreads + (i < nfull % nthreads);
+	jobs[i].mode = mode;
+	jobs[i].type = type;
+	jobs[i].scale = scale;
+	jobs[i].nwarmup = start < warmup ? start : warmup;
+	jobs[i].in = (const char*)view.buf + (size_t)(start - jobs[i].nwarmup)*frame;
+	jobs[i].out = PyBytes_AS_STRING(bits) + (size_t)start*nbyte;
+	jobs[i].nframes = len;
+	start += len;
+    }
+    jobs[nthreads-1].tail = tail;
+
+    Py_BEGIN_ALLOW_THREADS
+    rc = run_jobs(jobs, nthreads, nthreads, encode_job);
+    Py_END_ALLOW_THREADS
+    if (rc < 0) {
+	PyErr_NoMemory();
+	Py_CLEAR(bits);
+    }
+
+done:
+    PyMem_Free(jobs);
+    PyMem_Free(tail);
+    PyBuffer_Release(&view);
+    return bits;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: code_many
+  DATE CREATED: Oct 2026
+
+  encode_many() and decode_many(): each item of the sequence is a
+  stream of its own, and the streams are shared out over the threads.
+
+\*---------------------------------------------------------------------------*/
+
+static PyObject *code_many(PyObject *args, PyObject *kwds, int encode)
+{
+    static char *encode_kwlist[] = {"streams", "mode", "threads", "scale", NULL};
+    static char *decode_kwlist[] = {"streams", "mode", "threads", NULL};
+    PyObject    *streams, *seq, *result = NULL, *item;
+    Py_buffer   *views = NULL;
+    job_t       *jobs = NULL;
+    float        scale = ENCODE_SCALE;
+    Py_ssize_t   n, i, held = 0;
+    int          mode, nthreads = 0, nsam, nbyte, nout, nframes, type = SPEECH_SHORT, err, rc;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, encode ? "Oi|if" : "Oi|i", encode ? encode_kwlist : decode_kwlist,
+				     &streams, &mode, &nthreads, &scale))
+	return NULL;
+    if (mode_sizes(mode, &nsam, &nbyte, NULL) < 0)
+	return NULL;
+    nout = nsam;
+    seq = PySequence_Fast(streams, "streams must be a sequence");
+    if (seq == NULL)
+	return NULL;
+    n = PySequence_Fast_GET_SIZE(seq);
+    if (n > INT_MAX) {
+	PyErr_SetString(PyExc_OverflowError, "too many streams");
+	goto done;
+    }
+
+    result = PyList_New(n);
+    views = (Py_buffer*)PyMem_Calloc(n > 0 ? n : 1, sizeof(Py_buffer));
+    jobs = (job_t*)PyMem_Calloc(n > 0 ? n : 1, sizeof(job_t));
+    if ((result == NULL) || (views == NULL) || (jobs == NULL)) {
+	if (result != NULL)
+	    PyErr_NoMemory();
+	goto fail;
+    }
+
+    for(i=0; i<n; i++) {
+	jobs[i].mode = mode;
+	jobs[i].scale = scale;
+	if (encode) {
+	    if (get_speech(PySequence_Fast_GET_ITEM(seq, i), &views[i], PyBUF_SIMPLE, &type) < 0)
+		goto fail;
+	    held++;
+	    if (frame_count(views[i].len/views[i].itemsize + nsam - 1, nsam, &nframes) < 0)
+		goto fail;
+	    jobs[i].type = type;
+	    jobs[i].tail = make_tail(&views[i], nsam, &err);
+	    if (err)
+		goto fail;
+	    jobs[i].nframes = (int)(views[i].len/views[i].itemsize/nsam);
+	    item = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)nframes*nbyte);
+	    if (item == NULL)
+		goto fail;
+	    jobs[i].out = PyBytes_AS_STRING(item);
+	}
+	else {
+	    if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(seq, i), &views[i], PyBUF_C_CONTIGUOUS) < 0)
+		goto fail;
+	    held++;
+	    if (views[i].len % nbyte != 0) {
+		PyErr_Format(PyExc_ValueError, "stream %zd is not whole frames of %d bytes", i, nbyte);
+		goto fail;
+	    }
+	    if (frame_count(views[i].len, nbyte, &nframes) < 0)
+		goto fail;
+	    jobs[i].nframes = nframes;
+	    item = PyByteArray_FromStringAndSize(NULL, (Py_ssize_t)nframes*nout*sizeof(short));
+	    if (item == NULL)
+		goto fail;
+	    jobs[i].out = PyByteArray_AS_STRING(item);
+	}
+	jobs[i].in = (const char*)views[i].buf;
+	PyList_SET_ITEM(result, i, item);
+    }
+
+    if (n > 0) {
+	nthreads = default_threads(nthreads);
+	Py_BEGIN_ALLOW_THREADS
+	rc = run_jobs(jobs, (int)n, nthreads, encode ? encode_job : decode_job);
+	Py_END_ALLOW_THREADS
+	if (rc < 0) {
+	    PyErr_NoMemory();
+	    goto fail;
+	}
+    }
+
+    if (!encode)
+	for(i=0; i<n; i++) {
+	    item = PyList_GET_ITEM(result, i);
+	    Py_INCREF(item);
+	    item = short_view(item);
+	    if (item == NULL)
+		goto fail;
+	    PyList_SetItem(result, i, item);
+	}
+    goto done;
+
+fail:
+    Py_CLEAR(result);
+done:
+    for(i=0; i<held; i++)
+	PyBuffer_Release(&views[i]);
+    if (jobs != NULL)
+	for(i=0; i<n; i++)
+	    PyMem_Free((void*)jobs[i].tail);
+    PyMem_Free(jobs);
+    PyMem_Free(views);
+    Py_DECREF(seq);
+    return result;
+}
+
+PyDoc_STRVAR(encode_many_doc,
+"encode_many(streams, mode, threads=0, scale=32768.0) -> list of bytes\n\n"
+"Encodes each item of streams, int16 or float32 samples, as a\n"
+"recording of its own, the last frame padded with silence.  The\n"
+"streams are shared out over threads (0 for one per CPU).");
+
+static PyObject *codec2_py_encode_many(PyObject *module, PyObject *args, PyObject *kwds)
+{
+    (void)module;
+    return code_many(args, kwds, 1);
+}
+
+PyDoc_STRVAR(decode_many_doc,
+"decode_many(streams, mode, threads=0) -> list of int16 memoryviews\n\n"
+"Decodes each item of streams, whole frames of bits, as a stream of\n"
+"its own.  The streams are shared out over threads (0 for one per\n"
+"CPU).");
+
+static PyObject *codec2_py_decode_many(PyObject *module, PyObject *args, PyObject *kwds)
+{
+    (void)module;
+    return code_many(args, kwds, 0);
+}
+
+static PyMethodDef codec2_methods[] = {
+    {"encode", (PyCFunction)(void(*)(void))codec2_py_encode, METH_VARARGS | METH_KEYWORDS, encode_doc},
+    {"encode_many", (PyCFunction)(void(*)(void))codec2_py_encode_many, METH_VARARGS | METH_KEYWORDS,
+     encode_many_doc},
+    {"decode_many", (PyCFunction)(void(*)(void))codec2_py_decode_many, METH_VARARGS | METH_KEYWORDS,
+     decode_many_doc},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef codec2_module = {
+    PyModuleDef_HEAD_INIT,
+    "codec2",
+    "Codec2 low bit rate speech codec, whole arrays per call.",
+    -1,
+    codec2_methods,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_codec2(void)
+{
+    PyObject *m;
+
+    if (PyType_Ready(&Codec2Type) < 0)
+	return NULL;
+    m = PyModule_Create(&codec2_module);
+    if (m == NULL)
+	return NULL;
+
+    Py_INCREF(&Codec2Type);
+    if ((PyModule_AddObject(m, "Codec2", (PyObject*)&Codec2Type) < 0) ||
+	(PyModule_AddIntConstant(m, "MODE_3200", CODEC2_MODE_3200) < 0) ||
+	(PyModule_AddIntConstant(m, "MODE_2400", CODEC2_MODE_2400) < 0) ||
+	(PyModule_AddIntConstant(m, "MODE_1600", CODEC2_MODE_1600) < 0) ||
+	(PyModule_AddIntConstant(m, "MODE_1400", CODEC2_MODE_1400) < 0) ||
+	(PyModule_AddIntConstant(m, "MODE_1300", CODEC2_MODE_1300) < 0) ||
+	(PyModule_AddIntConstant(m, "MODE_1200", CODEC2_MODE_1200) < 0) ||
+	(PyModule_AddIntConstant(m, "MODE_700", CODEC2_MODE_700) < 0) ||
+	(PyModule_AddIntConstant(m, "MODE_700B", CODEC2_MODE_700B) < 0)) {
+	Py_DECREF(&Codec2Type);
+	Py_DECREF(m);
+	return NULL;
+    }
+
+    return m;
+}
@@ -0,0 +1,824 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_sched.c
+  DATE CREATED: Oct 2026
+
+  Session scheduler, see codec2_sched.h.  Each worker is a thread
+  pinned to one CPU that owns a list of sessions.  A session's memory
+  (its codec instance, frame queue and output frame) is allocated and
+  first written by its worker, so with the kernel's first touch policy
+  it sits on the worker's node, and the instance reads the node's
+  replica of the shared tables.  The codebooks themselves are const
+  data shared by every node; being read only, each socket's caches hold
+  their own copies of the lines in use.
+
+  Submitting a frame copies it into the session's queue, a ring of
+  CODEC2_SCHED_QUEUE slots, under the worker's lock.  The worker codes
+  the queued frame with the earliest deadline over all its sessions,
+  with the lock released; the slot isn't handed back until it is done,
+  so the submitter never writes a slot being coded.  Opening and
+  closing sessions are also done by the worker, between frames.
+
+  New sessions go to the worker whose sessions need the least of each
+  CODEC2_SCHED_WINDOW_MS window, from the measured cost per frame of
+  each session and its frames per window.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "codec2.h"
+#include "codec2_sched.h"
+
+#define WINDOW      (CODEC2_SCHED_WINDOW_MS*1E-3)
+#define ALIGN       64                 /* of the session's instance             */
+#define COST_DECAY  0.05               /* per frame, of the cost average        */
+
+enum { FREE, OPENING, OPEN, CLOSING, FAILED };
+enum { ENCODE, DECODE };
+
+typedef struct {
+    int                   state;       /* FREE etc., guarded by the scheduler's lock
+                                          while FREE, else by the worker's   */
+    int                   worker;
+    int                   mode;
+    codec2_sched_callback cb;
+    void                 *cb_state;
+
+    /* set up by the worker */
+    void                 *mem;
+    struct CODEC2        *c2;
+    int                   nsam;        /* samples per frame in                  */
+    int                   nbyte;       /* bytes per frame of bits               */
+    int                   nout;        /* samples per frame out                 */
+    int                   per_window;  /* frames per window                     */
+    size_t                slot_size;
+    unsigned char        *slots;       /* CODEC2_SCHED_QUEUE frames             */
+    short                *out;         /* one frame coded, see worker_thread()  */
+    float                 cost;        /* average seconds per frame, 0 unknown  */
+
+    /* the queue, slots tail to head-1 */
+    unsigned int          head;
+    unsigned int          tail;
+    int                   op[CODEC2_SCHED_QUEUE];
+    double                submitted[CODEC2_SCHED_QUEUE];
+} session_t;
+
+typedef struct {
+    struct CODEC2_SCHED *s;
+    int                  cpu;
+    int                  node;
+    pthread_t            thread;
+    pthread_mutex_t      lock;
+    pthread_cond_t       wake;         /* work for the worker                   */
+    pthread_cond_t       done;         /* sessions set up, frames finished      */
+    int                  stop;
+    int                 *sessions;     /* numbers of the sessions placed here   */
+    int                  nsessions;
+    int                  queued;
+    int                  changed;      /* sessions waiting to open or close     */
+
+    unsigned long        frames;
+    unsigned long        misses;
+    double               max_latency;
+    double               busy;         /* seconds coding since period_start     */
+    double               period_start;
+    float                load;
+    float                mode_cost[CODEC2_MODE_700B+1]; /* last cost per frame seen */
+} worker_t;
+
+struct CODEC2_SCHED {
+    int              nworkers;
+    worker_t        *workers;
+    int              max_sessions;
+    session_t       *sessions;
+    pthread_mutex_t  lock;             /* FREE sessions                         */
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1E-9;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                 TOPOLOGY
+
+\*---------------------------------------------------------------------------*/
+
+/* Marks the CPUs of a sysfs list such as "0-3,8-11" in node_of[] */
+
+static void parse_cpulist(const char *list, int node, int node_of[], int ncpu)
+{
+    const char *p = list;
+    char       *end;
+    long        a, b;
+
+    while (*p) {
+	a = strtol(p, &end, 10);
+	if (end == p)
+	    break;
+	b = a;
+	p = end;
+	if (*p == '-') {
+	    b = strtol(p + 1, &end, 10);
+	    p = end;
+	}
+	for(; a <= b; a++)
+	    if ((a >= 0) && (a < ncpu))
+		node_of[a] = node;
+	if (*p == ',')
+	    p++;
+	else
+	    break;
+    }
+}
+
+/* Node of each CPU, 0 where the kernel doesn't say */
+
+static void cpu_nodes(int node_of[], int ncpu)
+{
+    char  name[64], list[1024];
+    FILE *f;
+    int   node;
+
+    memset(node_of, 0, ncpu*sizeof(int));
+    for(node=0; node<CODEC2_MAX_NODES; node++) {
+	snprintf(name, sizeof(name), "/sys/devices/system/node/node%d/cpulist", node);
+	f = fopen(name, "r");
+	if (f == NULL)
+	    continue;
+	if (fgets(list, sizeof(list), f) != NULL)
+	    parse_cpulist(list, node, node_of, ncpu);
+	fclose(f);
+    }
+}
+
+/* Non-zero if this process may run on cpu */
+
+static int cpu_allowed(int cpu)
+{
+#ifdef __linux__
+    static cpu_set_t set;
+    static int       have = -1;
+
+    if (have < 0)
+	have = sched_getaffinity(0, sizeof(set), &set) == 0;
+    return !have || ((cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &set));
+#else
+    (void)cpu;
+    return 1;
+#endif
+}
+
+/* The CPUs to pin nworkers workers to when the caller doesn't say:
+   allowed CPUs taken from each node in turn, so the workers span the
+   nodes evenly.  Returns the number found, at most nworkers. */
+
+static int pick_cpus(int cpus[], int nworkers, const int node_of[], int ncpu)
+{
+    int *taken = (int*)calloc(ncpu, sizeof(int));
+    int  n = 0, node, cpu, found = 1;
+
+    if (taken == NULL)
+	return 0;
+    while ((n < nworkers) && found) {
+	found = 0;
+	for(node=0; (node<CODEC2_MAX_NODES) && (n<nworkers); node++) {
+	    for(cpu=0; cpu<ncpu; cpu++) {
+		if (!taken[cpu] && (node_of[cpu] == node) && cpu_allowed(cpu)) {
+		    taken[cpu] = 1;
+		    cpus[n++] = cpu;
+		    found = 1;
+		    break;
+		}
+	    }
+	}
+    }
+    free(taken);
+    return n;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                  WORKERS
+
+\*---------------------------------------------------------------------------*/
+
+/* Sets a session up on the worker's thread, so its memory is first
+   touched, and so placed, on the worker's node */
+
+static void session_setup(worker_t *w, session_t *ses)
+{
+    size_t state = codec2_get_state_size(ses->mode);
+    size_t size;
+    unsigned char *p;
+    int    node = (w->node < CODEC2_MAX_NODES) ? w->node : 0;
+
+    ses->mem = NULL;
+    ses->c2 = NULL;
+    if (posix_memalign(&ses->mem, ALIGN, state) != 0) {
+	ses->mem = NULL;
+	ses->state = FAILED;
+	return;
+    }
+    memset(ses->mem, 0, state);
+    ses->c2 = codec2_create_in_place_node(ses->mode, ses->mem, node);
+    if (ses->c2 == NULL) {
+	free(ses->mem);
+	ses->mem = NULL;
+	ses->state = FAILED;
+	return;
+    }
+
+    ses->nsam = codec2_samples_per_frame(ses->c2);
+    ses->nbyte = (codec2_bits_per_frame(ses->c2) + 7)/8;
+    ses->per_window = (CODEC2_SCHED_WINDOW_MS*8 + ses->nsam - 1)/ses->nsam;
+    ses->slot_size = (ses->nsam*sizeof(short) + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+    ses->cost = w->mode_cost[ses->mode];
+
+    size = CODEC2_SCHED_QUEUE*ses->slot_size;
+    if (posix_memalign((void**)&p, ALIGN, size) != 0) {
+	codec2_destroy(ses->c2);
+	free(ses->mem);
+	ses->mem = NULL;
+	ses->c2 = NULL;
+	ses->state = FAILED;
+	return;
+    }
+    memset(p, 0, size);
+    ses->slots = p;
+    ses->out = NULL;
+    ses->nout = 0;
+    ses->head = ses->tail = 0;
+    ses->state = OPEN;
+}
+
+static void session_free(struct CODEC2_SCHED *s, session_t *ses)
+{
+    codec2_destroy(ses->c2);
+    free(ses->mem);
+    free(ses->slots);
+    free(ses->out);
+    ses->c2 = NULL;
+    ses->mem = NULL;
+    ses->slots = NULL;
+    ses->out = NULL;
+
+    pthread_mutex_lock(&s->lock);
+    ses->state = FREE;
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* Opens and closes the sessions waiting to, called with the worker's
+   lock held */
+
+static void service_sessions(worker_t *w)
+{
+    struct CODEC2_SCHED *s = w->s;
+    session_t *ses;
+    int i;
+
+    w->changed = 0;
+    for(i=0; i<w->nsessions; ) {
+	ses = &s->sessions[w->sessions[i]];
+	if (ses->state == OPENING) {
+	    session_setup(w, ses);
+	    pthread_cond_broadcast(&w->done);
+	}
+	if ((ses->state == FAILED) ||
+	    ((ses->state == CLOSING) && (ses->head == ses->tail))) {
+	    if (ses->state == CLOSING)
+		session_free(s, ses);
+	    w->sessions[i] = w->sessions[--w->nsessions];
+	    continue;
+	}
+	if ((ses->state == CLOSING) && !w->stop)
+	    w->changed = 1;            /* close once its frames are coded */
+	i++;
+    }
+}
+
+/* The session with the earliest deadline queued, or NULL */
+
+static session_t *earliest(worker_t *w)
+{
+    struct CODEC2_SCHED *s = w->s;
+    session_t *ses, *best = NULL;
+    double     due = 0.0;
+    int        i;
+
+    for(i=0; i<w->nsessions; i++) {
+	ses = &s->sessions[w->sessions[i]];
+	if (((ses->state != OPEN) && (ses->state != CLOSING)) || (ses->head == ses->tail))
+	    continue;
+	if ((best == NULL) || (ses->submitted[ses->tail % CODEC2_SCHED_QUEUE] < due)) {
+	    best = ses;
+	    due = ses->submitted[ses->tail % CODEC2_SCHED_QUEUE];
+	}
+    }
+    return best;
+}
+
+/* Takes the frame coded in seconds t0 to t1 into the metrics, called
+   with the worker's lock held */
+
+static void account(worker_t *w, session_t *ses, double submitted, double t0, double t1)
+{
+    double latency = t1 - submitted;
+
+    w->frames++;
+    if (latency > WINDOW)
+	w->misses++;
+    if (latency > w->max_latency)
+	w->max_latency = latency;
+    w->busy += t1 - t0;
+    if (t1 - w->period_start >= 1.0) {
+	w->load = w->busy/(t1 - w->period_start);
+	w->busy = 0.0;
+	w->period_start = t1;
+    }
+
+    if (ses->cost == 0.0f)
+	ses->cost = t1 - t0;
+    else
+	ses->cost += COST_DECAY*((float)(t1 - t0) - ses->cost);
+    w->mode_cost[ses->mode] = ses->cost;
+}
+
+static void *worker_thread(void *arg)
+{
+    worker_t  *w = (worker_t*)arg;
+    session_t *ses;
+    unsigned char *in;
+    size_t     size;
+    double     submitted, t0, t1;
+    int        op, k, nbytes;
+
+    pthread_mutex_lock(&w->lock);
+    w->period_start = now();
+    for(;;) {
+	if (w->changed)
+	    service_sessions(w);
+	if (w->stop)
+	    break;
+	ses = earliest(w);
+	if (ses == NULL) {
+	    pthread_cond_wait(&w->wake, &w->lock);
+	    continue;
+	}
+
+	/* the output frame is sized at the first frame, the output rate
+	   may be set until then */
+	if (ses->out == NULL) {
+	    ses->nout = codec2_output_samples_per_frame(ses->c2);
+	    size = ses->nout*sizeof(short);
+	    ses->out = (short*)malloc((size > (size_t)ses->nbyte) ? size : (size_t)ses->nbyte);
+	}
+	k = ses->tail % CODEC2_SCHED_QUEUE;
+	op = ses->op[k];
+	submitted = ses->submitted[k];
+	in = &ses->slots[k*ses->slot_size];
+	pthread_mutex_unlock(&w->lock);
+
+	t0 = now();
+	if (ses->out == NULL)
+	    nbytes = 0;
+	else if (op == ENCODE) {
+	    codec2_encode(ses->c2, (unsigned char*)ses->out, (short*)in);
+	    nbytes = ses->nbyte;
+	}
+	else {
+	    codec2_decode(ses->c2, ses->out, in);
+	    nbytes = ses->nout*sizeof(short);
+	}
+	t1 = now();
+	if ((nbytes > 0) && (ses->cb != NULL))
+	    ses->cb(ses->cb_state, (int)(ses - w->s->sessions), ses->out, nbytes);
+
+	pthread_mutex_lock(&w->lock);
+	ses->tail++;
+	w->queued--;
+	account(w, ses, submitted, t0, t1);
+	if (w->queued == 0)
+	    pthread_cond_broadcast(&w->done);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return NULL;
+}
+
+/* Starts worker w pinned to cpu, -1 for none.  The affinity is set
+   before the thread starts, so it never runs, and never touches its
+   stack, off its node. */
+
+static int worker_start(worker_t *w)
+{
+    pthread_attr_t attr;
+    int err;
+
+    pthread_attr_init(&attr);
+#if defined(__linux__) && defined(__GLIBC__)
+    if (w->cpu >= 0) {
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu, &set);
+	if (pthread_attr_setaffinity_np(&attr, sizeof(set), &set) != 0)
+	    w->cpu = -1;
+    }
+#else
+    w->cpu = -1;
+#endif
+    err = pthread_create(&w->thread, &attr, worker_thread, w);
+    pthread_attr_destroy(&attr);
+
+    return err;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_sched_create
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_SCHED *codec2_sched_create(int nworkers, const int cpus[], int max_sessions)
+{
+    struct CODEC2_SCHED *s;
+    worker_t *w;
+    int      *picked = NULL, *node_of;
+    int       ncpu, i;
+
+    ncpu = (int)sysconf(_SC_NPROCESSORS_CONF);
+    if (ncpu < 1)
+	ncpu = 1;
+    if (nworkers <= 0)
+	nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((nworkers <= 0) || (max_sessions <= 0))
+	return NULL;
+
+    s = (struct CODEC2_SCHED*)calloc(1, sizeof(struct CODEC2_SCHED));
+    node_of = (int*)malloc(ncpu*sizeof(int));
+    if ((s == NULL) || (node_of == NULL)) {
+	free(s);
+	free(node_of);
+	return NULL;
+    }
+    s->nworkers = nworkers;
+    s->max_sessions = max_sessions;
+    s->workers = (worker_t*)calloc(nworkers, sizeof(worker_t));
+    s->sessions = (session_t*)calloc(max_sessions, sizeof(session_t));
+    if (cpus == NULL)
+	picked = (int*)malloc(nworkers*sizeof(int));
+    if ((s->workers == NULL) || (s->sessions == NULL) || ((cpus == NULL) && (picked == NULL))) {
+	free(s->workers);
+	free(s->sessions);
+	free(picked);
+	free(node_of);
+	free(s);
+	return NULL;
+    }
+    pthread_mutex_init(&s->lock, NULL);
+
+    cpu_nodes(node_of, ncpu);
+    if (cpus == NULL) {
+	/* more workers than CPUs share them unpinned */
+	for(i=pick_cpus(picked, nworkers, node_of, ncpu); i<nworkers; i++)
+	    picked[i] = -1;
+	cpus = picked;
+    }
+
+    for(i=0; i<nworkers; i++) {
+	w = &s->workers[i];
+	w->s = s;
+	w->cpu = ((cpus[i] >= 0) && (cpus[i] < ncpu)) ? cpus[i] : -1;
+	w->node = (w->cpu >= 0) ? node_of[w->cpu] : 0;
+	w->sessions = (int*)malloc(max_sessions*sizeof(int));
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->wake, NULL);
+	pthread_cond_init(&w->done, NULL);
+	if ((w->sessions == NULL) || (worker_start(w) != 0)) {
+	    free(w->sessions);
+	    pthread_mutex_destroy(&w->lock);
+	    pthread_cond_destroy(&w->wake);
+	    pthread_cond_destroy(&w->done);
+	    s->nworkers = i;           /* the workers started, to stop */
+	    codec2_sched_destroy(s);
+	    free(picked);
+	    free(node_of);
+	    return NULL;
+	}
+    }
+    free(picked);
+    free(node_of);
+
+    return s;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_sched_destroy
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_sched_destroy(struct CODEC2_SCHED *s)
+{
+    worker_t  *w;
+    session_t *ses;
+    int        i;
+
+    if (s == NULL)
+	return;
+
+    for(i=0; i<s->nworkers; i++) {
+	w = &s->workers[i];
+	pthread_mutex_lock(&w->lock);
+	w->stop = 1;
+	pthread_cond_signal(&w->wake);
+	pthread_mutex_unlock(&w->lock);
+	pthread_join(w->thread, NULL);
+    }
+    for(i=0; i<s->max_sessions; i++) {
+	ses = &s->sessions[i];
+	if ((ses->state == OPEN) || (ses->state == CLOSING))
+	    session_free(s, ses);
+    }
+    for(i=0; i<s->nworkers; i++) {
+	w = &s->workers[i];
+	free(w->sessions);
+	pthread_mutex_destroy(&w->lock);
+	pthread_cond_destroy(&w->wake);
+	pthread_cond_destroy(&w->done);
+    }
+    pthread_mutex_destroy(&s->lock);
+    free(s->workers);
+    free(s->sessions);
+    free(s);
+}
+
+int codec2_sched_workers(struct CODEC2_SCHED *s)
+{
+    return s->nworkers;
+}
+
+/* Estimated share of each window the worker's sessions need, called
+   with its lock held.  Sessions with no frames coded yet count at the
+   cost the worker last saw of their mode, or 1 ms if it hasn't. */
+
+static float window_load(worker_t *w)
+{
+    struct CODEC2_SCHED *s = w->s;
+    session_t *ses;
+    float      load = 0.0f, cost;
+    int        i;
+
+    for(i=0; i<w->nsessions; i++) {
+	ses = &s->sessions[w->sessions[i]];
+	cost = (ses->cost > 0.0f) ? ses->cost : w->mode_cost[ses->mode];
+	if (cost == 0.0f)
+	    cost = 1E-3f;
+	load += ses->per_window*cost;
+    }
+    return load/WINDOW;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_sched_open
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_sched_open(struct CODEC2_SCHED *s, int mode, int node, codec2_sched_callback cb, void *cb_state)
+{
+    session_t *ses = NULL;
+    worker_t  *w;
+    float      load, best_load = 0.0f;
+    int        i, k, best = -1, local = 0;
+
+    if (!codec2_mode_enabled(mode))
+	return -1;
+
+    for(i=0; i<s->nworkers; i++)
+	if (s->workers[i].node == node)
+	    local = 1;
+    for(i=0; i<s->nworkers; i++) {
+	w = &s->workers[i];
+	if (local && (w->node != node))
+	    continue;
+	pthread_mutex_lock(&w->lock);
+	load = window_load(w);
+	pthread_mutex_unlock(&w->lock);
+	if ((best < 0) || (load < best_load)) {
+	    best = i;
+	    best_load = load;
+	}
+    }
+
+    pthread_mutex_lock(&s->lock);
+    for(k=0; k<s->max_sessions; k++) {
+	if (s->sessions[k].state == FREE) {
+	    ses = &s->sessions[k];
+	    memset(ses, 0, sizeof(*ses));
+	    ses->state = OPENING;
+	    break;
+	}
+    }
+    pthread_mutex_unlock(&s->lock);
+    if (ses == NULL)
+	return -1;
+
+    ses->worker = best;
+    ses->mode = mode;
+    ses->cb = cb;
+    ses->cb_state = cb_state;
+
+    /* the worker sets the session up in its own memory */
+    w = &s->workers[best];
+    pthread_mutex_lock(&w->lock);
+    w->sessions[w->nsessions++] = k;
+    w->changed = 1;
+    pthread_cond_signal(&w->wake);
+    while (ses->state == OPENING)
+	pthread_cond_wait(&w->done, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+
+    if (ses->state != OPEN) {
+	pthread_mutex_lock(&s->lock);
+	ses->state = FREE;
+	pthread_mutex_unlock(&s->lock);
+	return -1;
+    }
+    return k;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_sched_close
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_sched_close(struct CODEC2_SCHED *s, int session)
+{
+    session_t *ses;
+    worker_t  *w;
+
+    if ((session < 0) || (session >= s->max_sessions))
+	return;
+    ses = &s->sessions[session];
+    w = &s->workers[ses->worker];
+    pthread_mutex_lock(&w->lock);
+    if (ses->state == OPEN) {
+	ses->state = CLOSING;
+	w->changed = 1;
+	pthread_cond_signal(&w->wake);
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+struct CODEC2 *codec2_sched_codec(struct CODEC2_SCHED *s, int session)
+{
+    if ((session < 0) || (session >= s->max_sessions) || (s->sessions[session].state != OPEN))
+	return NULL;
+    return s->sessions[session].c2;
+}
+
+int codec2_sched_session_worker(struct CODEC2_SCHED *s, int session)
+{
+    if ((session < 0) || (session >= s->max_sessions) || (s->sessions[session].state != OPEN))
+	return -1;
+    return s->sessions[session].worker;
+}
+
+/* Queues op on a frame of n bytes */
+
+static int submit(struct CODEC2_SCHED *s, int session, int op, const void *frame, int n)
+{
+    session_t *ses;
+    worker_t  *w;
+    int        k, ret = -1;
+
+    if ((session < 0) || (session >= s->max_sessions))
+	return -1;
+    ses = &s->sessions[session];
+    w = &s->workers[ses->worker];
+
+    pthread_mutex_lock(&w->lock);
+    if ((ses->state == OPEN) && (ses->head - ses->tail < CODEC2_SCHED_QUEUE)) {
+	k = ses->head % CODEC2_SCHED_QUEUE;
+	memcpy(&ses->slots[k*ses->slot_size], frame, n);
+	ses->op[k] = op;
+	ses->submitted[k] = now();
+	ses->head++;
+	w->queued++;
+	pthread_cond_signal(&w->wake);
+	ret = 0;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_sched_encode
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_sched_encode(struct CODEC2_SCHED *s, int session, const short speech[])
+{
+    if ((session < 0) || (session >= s->max_sessions))
+	return -1;
+    return submit(s, session, ENCODE, speech, s->sessions[session].nsam*sizeof(short));
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_sched_decode
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_sched_decode(struct CODEC2_SCHED *s, int session, const unsigned char bits[])
+{
+    if ((session < 0) || (session >= s->max_sessions))
+	return -1;
+    return submit(s, session, DECODE, bits, s->sessions[session].nbyte);
+}
+
+void codec2_sched_drain(struct CODEC2_SCHED *s)
+{
+    worker_t *w;
+    int       i;
+
+    for(i=0; i<s->nworkers; i++) {
+	w = &s->workers[i];
+	pthread_mutex_lock(&w->lock);
+	while (w->queued > 0)
+	    pthread_cond_wait(&w->done, &w->lock);
+	pthread_mutex_unlock(&w->lock);
+    }
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_sched_get_stats
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+void codec2_sched_get_stats(struct CODEC2_SCHED *s, int worker, struct CODEC2_SCHED_STATS *stats)
+{
+    worker_t *w;
+
+    memset(stats, 0, sizeof(*stats));
+    if ((worker < 0) || (worker >= s->nworkers))
+	return;
+    w = &s->workers[worker];
+
+    pthread_mutex_lock(&w->lock);
+    stats->cpu = w->cpu;
+    stats->node = w->node;
+    stats->sessions = w->nsessions;
+    stats->queued = w->queued;
+    stats->frames = w->frames;
+    stats->deadline_misses = w->misses;
+    stats->max_latency_us = (unsigned long)(w->max_latency*1E6);
+    stats->load = w->load;
+    stats->window_load = window_load(w);
+    pthread_mutex_unlock(&w->lock);
+}
@@ -0,0 +1,163 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2_transcode.c
+  DATE CREATED: Oct 2026
+
+  Mode to mode transcoder, see codec2_transcode.h.  The input frames
+  are decoded by codec2_decode_muted(), which unpacks and dequantises
+  them without synthesising any speech, and decode_one_frame() keeps
+  each 10 ms frame's parameters in c2->params_out[].  Once there are a
+  frame of mode_out's worth they fill in a struct CODEC2_ANALYSIS for
+  codec2_encode_quantise(), LSPs and energy given rather than found
+  from the analysis window.
+
+  The LSPs quantised for each 20 ms are those decoded for its second
+  10 ms frame, just as the encoder analyses the window ending there.
+  The 700 and 700B modes' 6th order LSPs are converted to the other
+  modes' 10th, and back, by lsps_change_order().
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "codec2.h"
+#include "codec2_internal.h"
+#include "codec2_transcode.h"
+#include "quantise.h"
+
+/* up to 30 ms left over from the last output frame, and 40 ms in */
+
+#define TRANSCODE_FRAMES 8
+
+struct CODEC2_TRANSCODE {
+    struct CODEC2       *dec;          /* of mode_in                            */
+    struct CODEC2       *enc;          /* of mode_out                           */
+    int                  nin;          /* 10 ms frames per input frame          */
+    int                  nout;         /* and per output frame                  */
+    int                  nbyte;        /* bytes per output frame                */
+    int                  order;        /* LPC order of mode_out                 */
+    int                  n;            /* 10 ms frames waiting in params[]      */
+    struct CODEC2_PARAMS params[TRANSCODE_FRAMES];
+};
+
+static void transcode_frame(struct CODEC2_TRANSCODE *t, unsigned char *bits);
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_transcode_create
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_TRANSCODE *codec2_transcode_create(int mode_in, int mode_out)
+{
+    struct CODEC2_TRANSCODE *t;
+
+    if ((mode_in < CODEC2_MODE_3200) || (mode_in > CODEC2_MODE_700B))
+	return NULL;
+    if ((mode_out < CODEC2_MODE_3200) || (mode_out > CODEC2_MODE_700B))
+	return NULL;
+    t = (struct CODEC2_TRANSCODE*)calloc(1, sizeof(struct CODEC2_TRANSCODE));
+    if (t == NULL)
+	return NULL;
+    t->dec = codec2_create_decoder(mode_in);
+    t->enc = codec2_create(mode_out);
+    if ((t->dec == NULL) || (t->enc == NULL)) {
+	codec2_transcode_destroy(t);
+	return NULL;
+    }
+
+    t->nin = codec2_samples_per_frame(t->dec)/N;
+    t->nout = codec2_samples_per_frame(t->enc)/N;
+    t->nbyte = (codec2_bits_per_frame(t->enc) + 7)/8;
+    if ((mode_out == CODEC2_MODE_700) || (mode_out == CODEC2_MODE_700B))
+	t->order = LPC_ORD_LOW;
+    else
+	t->order = LPC_ORD;
+
+    return t;
+}
+
+void codec2_transcode_destroy(struct CODEC2_TRANSCODE *t)
+{
+    assert(t != NULL);
+    if (t->dec != NULL)
+	codec2_destroy(t->dec);
+    if (t->enc != NULL)
+	codec2_destroy(t->enc);
+    free(t);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_transcode
+  DATE CREATED: Oct 2026
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_transcode(struct CODEC2_TRANSCODE *t, unsigned char *bits_out, const unsigned char *bits_in)
+{
+    int nframes = 0;
+
+    assert(t != NULL);
+    assert(t->n + t->nin <= TRANSCODE_FRAMES);
+
+    t->dec->params_out = &t->params[t->n];
+    codec2_decode_muted(t->dec, bits_in, NULL, NULL);
+    t->dec->params_out = NULL;
+    t->n += t->nin;
+
+    while(t->n >= t->nout) {
+	transcode_frame(t, &bits_out[nframes*t->nbyte]);
+	nframes++;
+	t->n -= t->nout;
+	memmove(&t->params[0], &t->params[t->nout], t->n*sizeof(struct CODEC2_PARAMS));
+    }
+
+    return nframes;
+}
+
+/* Quantises the first nout 10 ms frames of params[] to one frame of bits */
+
+static void transcode_frame(struct CODEC2_TRANSCODE *t, unsigned char *bits)
+{
+    struct CODEC2_ANALYSIS      analysis;
+    const struct CODEC2_PARAMS *p;
+    int                         k, h;
+
+    memset(&analysis, 0, sizeof(analysis));
+    analysis.mode = t->enc->mode;
+    analysis.lpc = 1;
+
+    for(k=0; k<t->nout; k++) {
+	p = &t->params[k];
+	analysis.model[k].Wo = p->Wo;
+	analysis.model[k].L = p->L;
+	analysis.model[k].voiced = p->voiced;
+    }
+
+    for(h=0; h<t->nout/2; h++) {
+	p = &t->params[2*h+1];
+	analysis.e[h] = p->e*lsps_change_order(analysis.lsps[h], t->order, p->lsps, p->order);
+    }
+
+    codec2_encode_quantise(t->enc, bits, &analysis);
+}
@@ -0,0 +1,187 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: codec2netdll.cpp
+  DATE CREATED: Oct 2026
+
+  Exports for the .NET wrapper, see codec2netdll.h.  A handle is the
+  session's struct CODEC2.  codec2_create() and codec2_destroy() take
+  the shared template under template_lock in codec2.c, an interlocked
+  spin lock with MSVC, so sessions may be created and used from any
+  thread; no lock is taken per frame.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "codec2.h"
+#include "codec2netdll.h"
+
+static struct CODEC2 *session(void *handle)
+{
+    return static_cast<struct CODEC2*>(handle);
+}
+
+void *c2net_create(int mode)
+{
+    return codec2_create(mode);
+}
+
+void c2net_destroy(void *handle)
+{
+    if (handle != NULL)
+	codec2_destroy(session(handle));
+}
+
+void c2net_release_shared(void)
+{
+    codec2_release_templates();
+}
+
+int c2net_samples_per_frame(void *handle)
+{
+    return handle != NULL ? codec2_samples_per_frame(session(handle)) : -1;
+}
+
+int c2net_bits_per_frame(void *handle)
+{
+    return handle != NULL ? codec2_bits_per_frame(session(handle)) : -1;
+}
+
+int c2net_bytes_per_frame(void *handle)
+{
+    return handle != NULL ? (codec2_bits_per_frame(session(handle)) + 7)/8 : -1;
+}
+
+void c2net_encode(void *handle, short pcm_in[], unsigned char *codec_frame)
+{
+    if (handle != NULL)
+	codec2_encode(session(handle), codec_frame, pcm_in);
+}
+
+void c2net_decode(void *handle, const unsigned char *codec_frame, short pcm_out[])
+{
+    if (handle != NULL)
+	codec2_decode(session(handle), pcm_out, codec_frame);
+}
+
+void c2net_decode_ber(void *handle, const unsigned char *codec_frame, short pcm_out[], float ber_est)
+{
+    if (handle != NULL)
+	codec2_decode_ber(session(handle), pcm_out, codec_frame, ber_est);
+}
+
+/* whole frames that fit both a speech and a bit buffer, -1 for no session */
+
+static int frames_fitting(void *handle, int pcm_len, int frames_len)
+{
+    int nsam, nbyte, n;
+
+    if (handle == NULL)
+	return -1;
+    nsam = codec2_samples_per_frame(session(handle));
+    nbyte = (codec2_bits_per_frame(session(handle)) + 7)/8;
+    if ((pcm_len <= 0) || (frames_len <= 0))
+	return 0;
+    n = pcm_len/nsam;
+    if (frames_len/nbyte < n)
+	n = frames_len/nbyte;
+
+    return n;
+}
+
+int c2net_encode_frames(void *handle, short pcm_in[], int pcm_len,
+			unsigned char *codec_frames, int frames_len)
+{
+    int n = frames_fitting(handle, pcm_len, frames_len);
+
+    if (n > 0)
+	codec2_encode_batch(session(handle), codec_frames, pcm_in, n);
+    return n;
+}
+
+int c2net_decode_frames(void *handle, const unsigned char *codec_frames, int frames_len,
+			short pcm_out[], int pcm_len)
+{
+    int n = frames_fitting(handle, pcm_len, frames_len);
+
+    if (n > 0)
+	codec2_decode_batch(session(handle), pcm_out, codec_frames, n);
+    return n;
+}
+
+void c2net_set_lpc_post_filter(void *handle, int enable, int bass_boost, float beta, float gamma)
+{
+    if (handle != NULL)
+	codec2_set_lpc_post_filter(session(handle), enable, bass_boost, beta, gamma);
+}
+
+int c2net_get_spare_bit_index(void *handle)
+{
+    return handle != NULL ? codec2_get_spare_bit_index(session(handle)) : -1;
+}
+
+int c2net_rebuild_spare_bit(void *handle, int unpacked_bits[])
+{
+    return handle != NULL ? codec2_rebuild_spare_bit(session(handle), unpacked_bits) : -1;
+}
+
+void c2net_set_natural_or_gray(void *handle, int gray)
+{
+    if (handle != NULL)
+	codec2_set_natural_or_gray(session(handle), gray);
+}
+
+void c2net_set_softdec(void *handle, const float *softdec)
+{
+    if (handle != NULL)
+	codec2_set_softdec(session(handle), softdec);
+}
+
+#if defined(_WIN32)
+
+/* the original single session exports, on a hidden handle */
+
+static void *legacy = NULL;
+
+namespace Codec2NetFunctions
+{
+	void open(int mode)
+	{
+	    c2net_destroy(legacy);
+	    legacy = c2net_create(mode);
+	}
+
+	void encode(short pcm_in[], unsigned char* codec_frame) { c2net_encode(legacy, pcm_in, codec_frame); }
+	void decode(const unsigned char* codec_frame, short pcm_out[]) { c2net_decode(legacy, codec_frame, pcm_out); }
+
+	void decode_ber(const unsigned char* codec_frame, short pcm_out[], float ber_est) { c2net_decode_ber(legacy, codec_frame, pcm_out, ber_est); }
+	int  samples_per_frame() { return c2net_samples_per_frame(legacy); }
+	int  bits_per_frame() { return c2net_bits_per_frame(legacy); }
+
+	void set_lpc_post_filter(int enable, int bass_boost, float beta, float gamma) { c2net_set_lpc_post_filter(legacy, enable, bass_boost, beta, gamma); }
+	int  get_spare_bit_index() { return c2net_get_spare_bit_index(legacy); }
+	int  rebuild_spare_bit(int unpacked_bits[]) { return c2net_rebuild_spare_bit(legacy, unpacked_bits); }
+	void set_natural_or_gray(int gray) { c2net_set_natural_or_gray(legacy, gray); }
+	void set_softdec(const float *softdec) { c2net_set_softdec(legacy, softdec); }
+
+	void close()
+	{
+	    c2net_destroy(legacy);
+	    legacy = NULL;
+	}
+}
+
+#endif
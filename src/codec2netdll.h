@@ -1,19 +1,79 @@
+/*
+  Exports for the .NET wrapper, built as the codec2net shared library
+  (CODEC2_BUILD_NETDLL, src/codec2netdll.cpp).
+
+  The c2net_ functions take a handle from c2net_create(), one per
+  session.  Sessions are independent, so different handles may be used
+  from different threads at the same time without locking; one handle
+  must not be used by two threads at once.  The _frames variants code
+  as many whole frames as both buffers hold in one call, for pinned
+  managed spans, and return the number of frames coded.
+
+  The tables sessions share outlive the last c2net_destroy(),
+  c2net_release_shared() frees them, e.g. before the library is
+  unloaded.
+
+  The original open/encode/.../close exports drive one hidden session
+  per process and remain for existing callers (Windows only, their
+  names clash with the C library elsewhere).
+*/
+
+#ifndef __CODEC2NETDLL__
+#define __CODEC2NETDLL__
+
+#if defined(_WIN32)
+#define C2NET_EXPORT __declspec(dllexport)
+#else
+#define C2NET_EXPORT __attribute__((visibility("default")))
+#endif
+
+extern "C" {
+	C2NET_EXPORT void *c2net_create(int mode);
+	C2NET_EXPORT void  c2net_destroy(void *handle);
+	C2NET_EXPORT void  c2net_release_shared(void);
+
+	C2NET_EXPORT int   c2net_samples_per_frame(void *handle);
+	C2NET_EXPORT int   c2net_bits_per_frame(void *handle);
+	C2NET_EXPORT int   c2net_bytes_per_frame(void *handle);
+
+	C2NET_EXPORT void  c2net_encode(void *handle, short pcm_in[], unsigned char *codec_frame);
+	C2NET_EXPORT void  c2net_decode(void *handle, const unsigned char *codec_frame, short pcm_out[]);
+	C2NET_EXPORT void  c2net_decode_ber(void *handle, const unsigned char *codec_frame, short pcm_out[], float ber_est);
+
+	C2NET_EXPORT int   c2net_encode_frames(void *handle, short pcm_in[], int pcm_len,
+					   unsigned char *codec_frames, int frames_len);
+	C2NET_EXPORT int   c2net_decode_frames(void *handle, const unsigned char *codec_frames, int frames_len,
+					   short pcm_out[], int pcm_len);
+
+	C2NET_EXPORT void  c2net_set_lpc_post_filter(void *handle, int enable, int bass_boost, float beta, float gamma);
+	C2NET_EXPORT int   c2net_get_spare_bit_index(void *handle);
+	C2NET_EXPORT int   c2net_rebuild_spare_bit(void *handle, int unpacked_bits[]);
+	C2NET_EXPORT void  c2net_set_natural_or_gray(void *handle, int gray);
+	C2NET_EXPORT void  c2net_set_softdec(void *handle, const float *softdec);
+}
+
+#if defined(_WIN32)
+
 namespace Codec2NetFunctions
 {
-	extern "C" { __declspec(dllexport)  void open(int mode); }
+	extern "C" { C2NET_EXPORT  void open(int mode); }
+
+	extern "C" { C2NET_EXPORT  void encode(short pcm_in[], unsigned char* codec_frame); }
+	extern "C" { C2NET_EXPORT  void decode(const unsigned char* codec_frame, short pcm_out[]); }
+
+	extern "C" { C2NET_EXPORT  void decode_ber(const unsigned char* codec_frame, short pcm_out[], float ber_est); }
+	extern "C" { C2NET_EXPORT  int  samples_per_frame(); }
+	extern "C" { C2NET_EXPORT  int  bits_per_frame(); }
 
-	extern "C" { __declspec(dllexport)  void encode(short pcm_in[], unsigned char* codec_frame); }
-	extern "C" { __declspec(dllexport)  void decode(const unsigned char* codec_frame, short pcm_out[]); }
+	extern "C" { C2NET_EXPORT  void set_lpc_post_filter(int enable, int bass_boost, float beta, float gamma); }
+	extern "C" { C2NET_EXPORT  int  get_spare_bit_index(); }
+	extern "C" { C2NET_EXPORT  int  rebuild_spare_bit(int unpacked_bits[]); }
+	extern "C" { C2NET_EXPORT  void set_natural_or_gray(int gray); }
+	extern "C" { C2NET_EXPORT  void set_softdec(const float *softdec); }
 
-	extern "C" { __declspec(dllexport)  void decode_ber(const unsigned char* codec_frame, short pcm_out[], float ber_est); }
-	extern "C" { __declspec(dllexport)  int  samples_per_frame(); }
-	extern "C" { __declspec(dllexport)  int  bits_per_frame(); }
+	extern "C" { C2NET_EXPORT  void close(); }
+}
 
-	extern "C" { __declspec(dllexport)  void set_lpc_post_filter(int enable, int bass_boost, float beta, float gamma); }
-	extern "C" { __declspec(dllexport)  int  get_spare_bit_index(); }
-	extern "C" { __declspec(dllexport)  int  rebuild_spare_bit(int unpacked_bits[]); }
-	extern "C" { __declspec(dllexport)  void set_natural_or_gray(int gray); }
-	extern "C" { __declspec(dllexport)  void set_softdec(float *softdec); }
+#endif
 
-	extern "C" { __declspec(dllexport)  void close(); }
-}
\ No newline at end of file
+#endif
@@ -57,6 +57,85 @@
 #define P_MIN    20		/* minimum pitch                        */
 #define P_MAX    160		/* maximum pitch                        */
 
+/* Recursive filter states smaller than DENORMAL_GUARD, 2^-62, are
+   flushed to zero once a frame.  That is far below a one bit signal,
+   and a state that decays no faster than 2^-64 a frame can't reach the
+   denormal range (below 2^-126) before it is next checked, so a silent
+   input costs the same as speech. */
+
+#define DENORMAL_GUARD 2.1684043e-19f
+#define FLUSH_DENORMAL(x) do { if (fabsf(x) < DENORMAL_GUARD) (x) = 0.0; } while(0)
+
+/* Modes built into the library, set by CODEC2_MODES in CMakeLists.txt.
+   A mode left out can't be created, and its quantisers and codebooks
+   aren't compiled. */
+
+#ifndef CODEC2_MODE_EN_DEFAULT
+#define CODEC2_MODE_EN_DEFAULT 1
+#endif
+#ifndef CODEC2_MODE_3200_EN
+#define CODEC2_MODE_3200_EN CODEC2_MODE_EN_DEFAULT
+#endif
+#ifndef CODEC2_MODE_2400_EN
+#define CODEC2_MODE_2400_EN CODEC2_MODE_EN_DEFAULT
+#endif
+#ifndef CODEC2_MODE_1600_EN
+#define CODEC2_MODE_1600_EN CODEC2_MODE_EN_DEFAULT
+#endif
+#ifndef CODEC2_MODE_1400_EN
+#define CODEC2_MODE_1400_EN CODEC2_MODE_EN_DEFAULT
+#endif
+#ifndef CODEC2_MODE_1300_EN
+#define CODEC2_MODE_1300_EN CODEC2_MODE_EN_DEFAULT
+#endif
+#ifndef CODEC2_MODE_1200_EN
+#define CODEC2_MODE_1200_EN CODEC2_MODE_EN_DEFAULT
+#endif
+#ifndef CODEC2_MODE_700_EN
+#define CODEC2_MODE_700_EN CODEC2_MODE_EN_DEFAULT
+#endif
+#ifndef CODEC2_MODE_700B_EN
+#define CODEC2_MODE_700B_EN CODEC2_MODE_EN_DEFAULT
+#endif
+
+/* non-zero if var is mode and mode is built, a constant 0 otherwise so
+   calls into a mode left out are compiled away */
+
+#define CODEC2_MODE_ACTIVE(mode, var) ((mode##_EN) && ((var) == (mode)))
+
+/* the mode's number when only one is built, every instance is then
+   of that mode and the mode dispatch is resolved at compile time */
+
+#if (CODEC2_MODE_3200_EN + CODEC2_MODE_2400_EN + CODEC2_MODE_1600_EN + CODEC2_MODE_1400_EN + \
+     CODEC2_MODE_1300_EN + CODEC2_MODE_1200_EN + CODEC2_MODE_700_EN + CODEC2_MODE_700B_EN) == 1
+#if CODEC2_MODE_3200_EN
+#define CODEC2_ONLY_MODE CODEC2_MODE_3200
+#elif CODEC2_MODE_2400_EN
+#define CODEC2_ONLY_MODE CODEC2_MODE_2400
+#elif CODEC2_MODE_1600_EN
+#define CODEC2_ONLY_MODE CODEC2_MODE_1600
+#elif CODEC2_MODE_1400_EN
+#define CODEC2_ONLY_MODE CODEC2_MODE_1400
+#elif CODEC2_MODE_1300_EN
+#define CODEC2_ONLY_MODE CODEC2_MODE_1300
+#elif CODEC2_MODE_1200_EN
+#define CODEC2_ONLY_MODE CODEC2_MODE_1200
+#elif CODEC2_MODE_700_EN
+#define CODEC2_ONLY_MODE CODEC2_MODE_700
+#else
+#define CODEC2_ONLY_MODE CODEC2_MODE_700B
+#endif
+#endif
+
+/* codebooks needed by the modes built */
+
+#define CODEC2_CB_LSP      (CODEC2_MODE_2400_EN || CODEC2_MODE_1600_EN || CODEC2_MODE_1400_EN || CODEC2_MODE_1300_EN)
+#define CODEC2_CB_LSPD     (CODEC2_MODE_3200_EN)
+#define CODEC2_CB_GE       (CODEC2_MODE_2400_EN || CODEC2_MODE_1400_EN || CODEC2_MODE_1200_EN)
+#define CODEC2_CB_JVM      (CODEC2_MODE_1200_EN)
+#define CODEC2_CB_MEL      (CODEC2_MODE_700_EN)
+#define CODEC2_CB_LSPMELVQ (CODEC2_MODE_700B_EN)
+
 /*---------------------------------------------------------------------------*\
 
 				TYPEDEFS
@@ -75,11 +154,21 @@ typedef struct {
 
 /* describes each codebook  */
 
+#define CB_LAYOUT_ROWS  0         /* cb[j*k+i], one row per entry          */
+#define CB_LAYOUT_SOA   1         /* cb[i*mpad+j], one row per dimension   */
+#define CB_LAYOUT_Q16   2         /* cbq[j*k+i]*scale, int16 rows          */
+#define CB_SOA_PAD      8         /* SOA rows padded to a multiple of this */
+
 struct lsp_codebook {
     int			k;        /* dimension of vector	*/
     int			log2m;    /* number of bits in m	*/
     int			m;        /* elements in codebook	*/
     const float	*	cb;	  /* The elements		*/
+    int			layout;   /* CB_LAYOUT_xxx, 0 (rows) if omitted      */
+    int			mpad;     /* SOA row length, m rounded up to CB_SOA_PAD */
+    const float	*	norm;     /* ||c||^2 of each entry, or NULL        */
+    const short *	cbq;      /* CB_LAYOUT_Q16 elements, cb is NULL    */
+    float		scale;    /* value of one step of cbq[]            */
 };
 
 extern const struct lsp_codebook lsp_cb[];
@@ -93,4 +182,13 @@ extern const struct lsp_codebook mel_cb[];
 extern const struct lsp_codebook ge_cb[];
 extern const struct lsp_codebook lspmelvq_cb[];
 
+/* transposed copies of the searched codebooks, generated at build
+   time by generate_codebook_soa.c */
+
+#ifdef CODEC2_CODEBOOK_SOA
+extern const struct lsp_codebook lsp_cbjvm_soa[];
+extern const struct lsp_codebook ge_cb_soa[];
+extern const struct lsp_codebook lspmelvq_cb_soa[];
+#endif
+
 #endif
@@ -4,7 +4,34 @@
   AUTHOR......: David Rowe
   DATE CREATED: 25/8/09
 
-  Routines to dump data to text files for Octave analysis.
+  Routines to trace internal states for Octave analysis.
+
+  dump_on(prefix) starts a trace in <prefix>.c2trace, a DUMP_HEADER
+  byte header, in host byte order:
+
+    offset  size
+        0      4  magic DUMP_MAGIC, "C2TR" if little endian
+        4      2  version, DUMP_VERSION
+        6      2  header size, DUMP_HEADER bytes
+        8      4  number of record types, DUMP_NTYPES
+       12      4  reserved, 0
+
+  followed by the records, each a DUMP_RECORD byte header and n f32
+  values:
+
+        0      2  type, DUMP_SN ...
+        2      2  n
+        4      4  sequence number of the record in its type
+
+  The values of a record are those of one row of the text files the
+  original routines wrote, so a type's sequence number is its row.
+  The records go into a ring buffer which a background thread writes
+  out a quarter at a time.  If the writer falls behind the ring
+  buffer doesn't grow or block the codec, the records that don't fit
+  are dropped, leaving gaps in the sequence numbers, and a
+  DUMP_DROPPED record at the end counts them.  Embedded builds have
+  no thread and write from the codec when the buffer is a quarter
+  full.
 
 \*---------------------------------------------------------------------------*/
 
@@ -27,6 +54,7 @@
 #include "comp.h"
 #include "dump.h"
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -34,637 +62,445 @@
 
 #ifdef __EMBEDDED__
 #include "codec2/gdb_stdio.h"
-#define fprintf gdb_stdio_fprintf
+#define fwrite gdb_stdio_fwrite
 #define fopen gdb_stdio_fopen
 #define fclose gdb_stdio_fclose
+#define DUMP_NO_THREAD
 #endif
 
+#if defined(DUMP) && !defined(DUMP_NO_THREAD)
+#include <pthread.h>
+#endif
+
+const struct DUMP_TYPE dump_type[DUMP_NTYPES] = {
+    { "sn",          0, 1 },
+    { "sw",          0, 0 },
+    { "sw_",         0, 0 },
+    { "ew",          0, 0 },
+    { "softdec",     0, 0 },
+    { "model",       0, 0 },
+    { "qmodel",      0, 0 },
+    { "pwb",         0, 0 },
+    { "pw",          0, 0 },
+    { "rw",          0, 0 },
+    { "lsp",         0, 0 },
+    { "weights",     0, 0 },
+    { "lsp_",        0, 0 },
+    { "mel",         0, 0 },
+    { "mel_indexes", 1, 0 },
+    { "ak",          0, 0 },
+    { "ak_",         0, 0 },
+    { "E",           0, 0 },
+    { "lpc_snr",     0, 0 },
+    { "snr",         0, 0 },
+    { "phase",       0, 0 },
+    { "phase_",      0, 0 },
+    { "hephase",     1, 0 },
+    { "sq",          0, 1 },
+    { "dec",         0, 0 },
+    { "fw",          0, 0 },
+    { "e",           0, 1 },
+    { "rk",          0, 0 },
+    { "bg",          0, 0 },
+    { "dropped",     1, 0 }
+};
+
 #ifdef DUMP
-static int dumpon = 0;
-
-static FILE *fsn = NULL;
-static FILE *fsw = NULL;
-static FILE *few = NULL;
-static FILE *fsw_ = NULL;
-static FILE *fsoftdec = NULL;
-static FILE *fmodel = NULL;
-static FILE *fqmodel = NULL;
-static FILE *fpwb = NULL;
-static FILE *fpw = NULL;
-static FILE *frw = NULL;
-static FILE *flsp = NULL;
-static FILE *fweights = NULL;
-static FILE *flsp_ = NULL;
-static FILE *fmel = NULL;
-static FILE *fmel_indexes = NULL;
-static FILE *fphase = NULL;
-static FILE *fphase_ = NULL;
-static FILE *ffw = NULL;
-static FILE *fe = NULL;
-static FILE *fsq = NULL;
-static FILE *fdec = NULL;
-static FILE *fsnr = NULL;
-static FILE *flpcsnr = NULL;
-static FILE *fak = NULL;
-static FILE *fak_ = NULL;
-static FILE *fbg = NULL;
-static FILE *fE = NULL;
-static FILE *frk = NULL;
-static FILE *fhephase = NULL;
-
-static char  prefix[MAX_STR];
 
-void dump_on(char p[]) {
-    dumpon = 1;
-    strcpy(prefix, p);
+#define DUMP_RING (1 << 20)           /* bytes, a power of 2            */
+
+static int            dumpon = 0;
+static FILE          *ftrace = NULL;
+static unsigned char *ring = NULL;
+static size_t         head, tail;     /* bytes ever put in and taken out */
+static uint32_t       seq[DUMP_NTYPES];
+static uint32_t       dropped;
+static int            err;
+
+#ifndef DUMP_NO_THREAD
+static pthread_t       writer;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  ready = PTHREAD_COND_INITIALIZER;
+static int             stop;
+#endif
+
+/* Writes the n bytes at the tail of the ring, which only the writer moves */
+
+static void write_ring(size_t from, size_t n)
+{
+    size_t pos = from & (DUMP_RING - 1);
+    size_t n1 = n < DUMP_RING - pos ? n : DUMP_RING - pos;
+
+    err |= fwrite(&ring[pos], 1, n1, ftrace) != n1;
+    if (n1 < n)
+	err |= fwrite(ring, 1, n - n1, ftrace) != n - n1;
 }
 
-void dump_off(){
-    if (fsn != NULL)
-	fclose(fsn);
-    if (fsw != NULL)
-	fclose(fsw);
-    if (fsw_ != NULL)
-	fclose(fsw_);
-    if (few != NULL)
-	fclose(few);
-    if (fmodel != NULL)
-	fclose(fmodel);
-    if (fsoftdec != NULL)
-	fclose(fsoftdec);
-    if (fqmodel != NULL)
-	fclose(fqmodel);
-    if (fpwb != NULL)
-	fclose(fpwb);
-    if (fpw != NULL)
-	fclose(fpw);
-    if (frw != NULL)
-	fclose(frw);
-    if (flsp != NULL)
-	fclose(flsp);
-    if (fweights != NULL)
-	fclose(fweights);
-    if (flsp_ != NULL)
-	fclose(flsp_);
-    if (fmel != NULL)
-	fclose(fmel);
-    if (fmel_indexes != NULL)
-	fclose(fmel_indexes);
-    if (fphase != NULL)
-	fclose(fphase);
-    if (fphase_ != NULL)
-	fclose(fphase_);
-    if (ffw != NULL)
-	fclose(ffw);
-    if (fe != NULL)
-	fclose(fe);
-    if (fsq != NULL)
-	fclose(fsq);
-    if (fdec != NULL)
-	fclose(fdec);
-    if (fsnr != NULL)
-	fclose(fsnr);
-    if (flpcsnr != NULL)
-	fclose(flpcsnr);
-    if (fak != NULL)
-	fclose(fak);
-    if (fak_ != NULL)
-	fclose(fak_);
-    if (fbg != NULL)
-	fclose(fbg);
-    if (fE != NULL)
-	fclose(fE);
-    if (frk != NULL)
-	fclose(frk);
-    if (fhephase != NULL)
-	fclose(fhephase);
+static void put_ring(const void *p, size_t n)
+{
+    size_t pos = head & (DUMP_RING - 1);
+    size_t n1 = n < DUMP_RING - pos ? n : DUMP_RING - pos;
+
+    memcpy(&ring[pos], p, n1);
+    if (n1 < n)
+	memcpy(ring, (const unsigned char*)p + n1, n - n1);
+    head += n;
 }
 
-void dump_Sn(float Sn[]) {
-    int i;
-    char s[MAX_STR];
+#ifndef DUMP_NO_THREAD
+static void *writer_thread(void *arg)
+{
+    size_t from, n;
+
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    for(;;) {
+	while((head == tail) && !stop)
+	    pthread_cond_wait(&ready, &lock);
+	if (head == tail)
+	    break;
+	from = tail;
+	n = head - tail;
+	pthread_mutex_unlock(&lock);
+	write_ring(from, n);
+	pthread_mutex_lock(&lock);
+	tail += n;
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+#endif
 
-    if (!dumpon) return;
+/* Adds one record of n values of type to the ring */
 
-    if (fsn == NULL) {
-	sprintf(s,"%s_sn.txt", prefix);
-	fsn = fopen(s, "wt");
-	assert(fsn != NULL);
+static void trace(int type, const float x[], int n)
+{
+    unsigned char hdr[DUMP_RECORD];
+    uint16_t      t = type, nv = n;
+    size_t        size = DUMP_RECORD + sizeof(float)*n;
+
+    assert((n >= 0) && (n <= DUMP_MAX));
+    memcpy(&hdr[0], &t, 2);
+    memcpy(&hdr[2], &nv, 2);
+    memcpy(&hdr[4], &seq[type], 4);
+    seq[type]++;
+
+#ifndef DUMP_NO_THREAD
+    pthread_mutex_lock(&lock);
+#endif
+    if (head - tail + size > DUMP_RING)
+	dropped++;
+    else {
+	put_ring(hdr, DUMP_RECORD);
+	put_ring(x, sizeof(float)*n);
+    }
+    if (head - tail >= DUMP_RING/4) {
+#ifndef DUMP_NO_THREAD
+	pthread_cond_signal(&ready);
+#else
+	write_ring(tail, head - tail);
+	tail = head;
+#endif
     }
+#ifndef DUMP_NO_THREAD
+    pthread_mutex_unlock(&lock);
+#endif
+}
 
-    /* split across two lines to avoid max line length problems */
-    /* reconstruct in Octave */
+static float db(COMP x)
+{
+    return 10.0*log10(x.real*x.real + x.imag*x.imag);
+}
 
-    for(i=0; i<M/2; i++)
-	fprintf(fsn,"%f\t",Sn[i]);
-    fprintf(fsn,"\n");
-    for(i=M/2; i<M; i++)
-	fprintf(fsn,"%f\t",Sn[i]);
-    fprintf(fsn,"\n");
+static void trace_model(int type, MODEL *model)
+{
+    float x[MAX_AMP+3];
+    int   l;
+
+    x[0] = model->Wo;
+    x[1] = model->L;
+    for(l=1; l<=MAX_AMP; l++)
+	x[l+1] = l <= model->L ? model->A[l] : 0.0;
+    x[MAX_AMP+2] = model->voiced;
+    trace(type, x, MAX_AMP+3);
 }
 
-void dump_Sw(COMP Sw[]) {
-    int i;
-    char s[MAX_STR];
+static void trace_ints(int type, int ind[], int n)
+{
+    float x[DUMP_MAX];
+    int   i;
+
+    for(i=0; i<n; i++)
+	x[i] = ind[i];
+    trace(type, x, n);
+}
+
+void dump_on(char p[]) {
+    char          s[MAX_STR+16];
+    unsigned char hdr[DUMP_HEADER];
+    uint32_t      u;
+    uint16_t      h;
+
+    assert(!dumpon);
+    snprintf(s, sizeof(s), "%s.c2trace", p);
+    ftrace = fopen(s, "wb");
+    assert(ftrace != NULL);
+    ring = (unsigned char*)malloc(DUMP_RING);
+    assert(ring != NULL);
+
+    memset(hdr, 0, sizeof(hdr));
+    u = DUMP_MAGIC;
+    memcpy(&hdr[0], &u, 4);
+    h = DUMP_VERSION;
+    memcpy(&hdr[4], &h, 2);
+    h = DUMP_HEADER;
+    memcpy(&hdr[6], &h, 2);
+    u = DUMP_NTYPES;
+    memcpy(&hdr[8], &u, 4);
+    err = fwrite(hdr, 1, sizeof(hdr), ftrace) != sizeof(hdr);
+
+    head = tail = 0;
+    memset(seq, 0, sizeof(seq));
+    dropped = 0;
+#ifndef DUMP_NO_THREAD
+    stop = 0;
+    if (pthread_create(&writer, NULL, writer_thread, NULL) != 0)
+	assert(0);
+#endif
+    dumpon = 1;
+}
+
+void dump_off(){
+    float x;
+
+    if (!dumpon)
+	return;
+    dumpon = 0;
+
+#ifndef DUMP_NO_THREAD
+    pthread_mutex_lock(&lock);
+    stop = 1;
+    pthread_cond_signal(&ready);
+    pthread_mutex_unlock(&lock);
+    pthread_join(writer, NULL);
+#endif
 
+    write_ring(tail, head - tail);
+    tail = head;
+    if (dropped) {
+	x = dropped;
+	trace(DUMP_DROPPED, &x, 1);
+	write_ring(tail, head - tail);
+	tail = head;
+    }
+
+    err |= fclose(ftrace) != 0;
+    if (err)
+	fprintf(stderr, "dump_off: trace incomplete\n");
+    ftrace = NULL;
+    free(ring);
+    ring = NULL;
+}
+
+void dump_Sn(float Sn[]) {
     if (!dumpon) return;
+    trace(DUMP_SN, Sn, M);
+}
 
-    if (fsw == NULL) {
-	sprintf(s,"%s_sw.txt", prefix);
-	fsw = fopen(s, "wt");
-	assert(fsw != NULL);
-    }
+void dump_Sw(COMP Sw[]) {
+    float x[FFT_ENC/2];
+    int   i;
 
+    if (!dumpon) return;
     for(i=0; i<FFT_ENC/2; i++)
-	fprintf(fsw,"%f\t",
-		10.0*log10(Sw[i].real*Sw[i].real + Sw[i].imag*Sw[i].imag));
-    fprintf(fsw,"\n");
+	x[i] = db(Sw[i]);
+    trace(DUMP_SW, x, FFT_ENC/2);
 }
 
 void dump_Sw_(COMP Sw_[]) {
-    int i;
-    char s[MAX_STR];
+    float x[FFT_ENC/2];
+    int   i;
 
     if (!dumpon) return;
-
-    if (fsw_ == NULL) {
-	sprintf(s,"%s_sw_.txt", prefix);
-	fsw_ = fopen(s, "wt");
-	assert(fsw_ != NULL);
-    }
-
     for(i=0; i<FFT_ENC/2; i++)
-	fprintf(fsw_,"%f\t",
-		10.0*log10(Sw_[i].real*Sw_[i].real + Sw_[i].imag*Sw_[i].imag));
-    fprintf(fsw_,"\n");
+	x[i] = db(Sw_[i]);
+    trace(DUMP_SW_, x, FFT_ENC/2);
 }
 
 void dump_Ew(COMP Ew[]) {
-    int i;
-    char s[MAX_STR];
+    float x[FFT_ENC/2];
+    int   i;
 
     if (!dumpon) return;
-
-    if (few == NULL) {
-	sprintf(s,"%s_ew.txt", prefix);
-	few = fopen(s, "wt");
-	assert(few != NULL);
-    }
-
     for(i=0; i<FFT_ENC/2; i++)
-	fprintf(few,"%f\t",
-		10.0*log10(Ew[i].real*Ew[i].real + Ew[i].imag*Ew[i].imag));
-    fprintf(few,"\n");
+	x[i] = db(Ew[i]);
+    trace(DUMP_EW, x, FFT_ENC/2);
 }
 
-void dump_softdec(float *softdec, int n)
+void dump_softdec(const float *softdec, int n)
 {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fsoftdec == NULL) {
-	sprintf(s,"%s_softdec.txt", prefix);
-	fsoftdec = fopen(s, "wt");
-	assert(fsoftdec != NULL);
-    }
-
-    for(i=0; i<n; i++)
-	fprintf(fsoftdec,"%f\t", softdec[i]);
-    fprintf(fsoftdec,"\n");
+    trace(DUMP_SOFTDEC, softdec, n);
 }
 
 void dump_model(MODEL *model) {
-    int l;
-    char s[MAX_STR];
-    char line[2048];
-
     if (!dumpon) return;
-
-    if (fmodel == NULL) {
-	sprintf(s,"%s_model.txt", prefix);
-	fmodel = fopen(s, "wt");
-	assert(fmodel != NULL);
-    }
-
-    sprintf(line,"%12f %12d ", model->Wo, model->L);
-    for(l=1; l<=model->L; l++) {
-	sprintf(s,"%12f ",model->A[l]);
-        strcat(line, s);
-    }
-    for(l=model->L+1; l<=MAX_AMP; l++) {
-	sprintf(s,"%12f ", 0.0);
-        strcat(line,s);
-    }
-
-    sprintf(s,"%d\n",model->voiced);
-    strcat(line,s);
-    fprintf(fmodel,"%s",line);
+    trace_model(DUMP_MODEL, model);
 }
 
 void dump_quantised_model(MODEL *model) {
-    int l;
-    char s[MAX_STR];
-    char line[2048];
-
     if (!dumpon) return;
-
-    if (fqmodel == NULL) {
-	sprintf(s,"%s_qmodel.txt", prefix);
-	fqmodel = fopen(s, "wt");
-	assert(fqmodel != NULL);
-    }
-
-    sprintf(line,"%12f %12d ", model->Wo, model->L);
-    for(l=1; l<=model->L; l++) {
-	sprintf(s,"%12f ",model->A[l]);
-        strcat(line, s);
-    }
-    for(l=model->L+1; l<=MAX_AMP; l++) {
-	sprintf(s,"%12f ", 0.0);
-        strcat(line, s);
-    }
-
-    sprintf(s,"%d\n",model->voiced);
-    strcat(line, s);
-    fprintf(fqmodel, "%s", line);
+    trace_model(DUMP_QMODEL, model);
 }
 
 void dump_phase(float phase[], int L) {
-    int l;
-    char s[MAX_STR];
+    float x[MAX_AMP];
+    int   l;
 
     if (!dumpon) return;
-
-    if (fphase == NULL) {
-	sprintf(s,"%s_phase.txt", prefix);
-	fphase = fopen(s, "wt");
-	assert(fphase != NULL);
-    }
-
-    for(l=1; l<=L; l++)
-	fprintf(fphase,"%f\t",phase[l]);
-    for(l=L+1; l<=MAX_AMP; l++)
-	fprintf(fphase,"%f\t",0.0);
-    fprintf(fphase,"\n");
+    for(l=1; l<=MAX_AMP; l++)
+	x[l-1] = l <= L ? phase[l] : 0.0;
+    trace(DUMP_PHASE, x, MAX_AMP);
 }
 
 void dump_phase_(float phase_[], int L) {
-    int l;
-    char s[MAX_STR];
+    float x[MAX_AMP];
+    int   l;
 
     if (!dumpon) return;
-
-    if (fphase_ == NULL) {
-	sprintf(s,"%s_phase_.txt", prefix);
-	fphase_ = fopen(s, "wt");
-	assert(fphase_ != NULL);
-    }
-
-    for(l=1; l<=L; l++)
-	fprintf(fphase_,"%f\t",phase_[l]);
-    for(l=L+1; l<MAX_AMP; l++)
-	fprintf(fphase_,"%f\t",0.0);
-    fprintf(fphase_,"\n");
+    for(l=1; l<=MAX_AMP; l++)
+	x[l-1] = l <= L ? phase_[l] : 0.0;
+    trace(DUMP_PHASE_, x, MAX_AMP);
 }
 
-
 void dump_hephase(int ind[], int dim) {
-    int m;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fhephase == NULL) {
-	sprintf(s,"%s_hephase.txt", prefix);
-	fhephase = fopen(s, "wt");
-	assert(fhephase != NULL);
-    }
-
-    for(m=0; m<dim; m++)
-	fprintf(fhephase,"%d\t",ind[m]);
-    fprintf(fhephase,"\n");
+    trace_ints(DUMP_HEPHASE, ind, dim);
 }
 
-
 void dump_snr(float snr) {
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fsnr == NULL) {
-	sprintf(s,"%s_snr.txt", prefix);
-	fsnr = fopen(s, "wt");
-	assert(fsnr != NULL);
-    }
-
-    fprintf(fsnr,"%f\n",snr);
+    trace(DUMP_SNR, &snr, 1);
 }
 
 void dump_lpc_snr(float snr) {
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (flpcsnr == NULL) {
-	sprintf(s,"%s_lpc_snr.txt", prefix);
-	flpcsnr = fopen(s, "wt");
-	assert(flpcsnr != NULL);
-    }
-
-    fprintf(flpcsnr,"%f\n",snr);
+    trace(DUMP_LPC_SNR, &snr, 1);
 }
 
 /* Pw "before" post filter so we can plot before and after */
 
 void dump_Pwb(COMP Pwb[]) {
-    int i;
-    char s[MAX_STR];
+    float x[FFT_ENC/2];
+    int   i;
 
     if (!dumpon) return;
-
-    if (fpwb == NULL) {
-	sprintf(s,"%s_pwb.txt", prefix);
-	fpwb = fopen(s, "wt");
-	assert(fpwb != NULL);
-    }
-
     for(i=0; i<FFT_ENC/2; i++)
-	fprintf(fpwb,"%f\t",Pwb[i].real);
-    fprintf(fpwb,"\n");
+	x[i] = Pwb[i].real;
+    trace(DUMP_PWB, x, FFT_ENC/2);
 }
 
 void dump_Pw(COMP Pw[]) {
-    int i;
-    char s[MAX_STR];
+    float x[FFT_ENC/2];
+    int   i;
 
     if (!dumpon) return;
-
-    if (fpw == NULL) {
-	sprintf(s,"%s_pw.txt", prefix);
-	fpw = fopen(s, "wt");
-	assert(fpw != NULL);
-    }
-
     for(i=0; i<FFT_ENC/2; i++)
-	fprintf(fpw,"%f\t",Pw[i].real);
-    fprintf(fpw,"\n");
+	x[i] = Pw[i].real;
+    trace(DUMP_PW, x, FFT_ENC/2);
 }
 
 void dump_Rw(float Rw[]) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (frw == NULL) {
-	sprintf(s,"%s_rw.txt", prefix);
-	frw = fopen(s, "wt");
-	assert(frw != NULL);
-    }
-
-    for(i=0; i<FFT_ENC/2; i++)
-	fprintf(frw,"%f\t",Rw[i]);
-    fprintf(frw,"\n");
+    trace(DUMP_RW, Rw, FFT_ENC/2);
 }
 
 void dump_weights(float w[], int order) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fweights == NULL) {
-	sprintf(s,"%s_weights.txt", prefix);
-	fweights = fopen(s, "wt");
-	assert(fweights != NULL);
-    }
-
-    for(i=0; i<order; i++)
-	fprintf(fweights,"%f\t", w[i]);
-    fprintf(fweights,"\n");
+    trace(DUMP_WEIGHTS, w, order);
 }
 
 void dump_lsp(float lsp[]) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (flsp == NULL) {
-	sprintf(s,"%s_lsp.txt", prefix);
-	flsp = fopen(s, "wt");
-	assert(flsp != NULL);
-    }
-
-    for(i=0; i<10; i++)
-	fprintf(flsp,"%f\t",lsp[i]);
-    fprintf(flsp,"\n");
+    trace(DUMP_LSP, lsp, 10);
 }
 
 void dump_lsp_(float lsp_[]) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (flsp_ == NULL) {
-	sprintf(s,"%s_lsp_.txt", prefix);
-	flsp_ = fopen(s, "wt");
-	assert(flsp_ != NULL);
-    }
-
-    for(i=0; i<10; i++)
-	fprintf(flsp_,"%f\t",lsp_[i]);
-    fprintf(flsp_,"\n");
+    trace(DUMP_LSP_, lsp_, 10);
 }
 
 void dump_mel(float mel[], int order) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fmel == NULL) {
-	sprintf(s,"%s_mel.txt", prefix);
-	fmel = fopen(s, "wt");
-	assert(fmel != NULL);
-    }
-
-    for(i=0; i<order; i++)
-	fprintf(fmel,"%f\t",mel[i]);
-    fprintf(fmel,"\n");
+    trace(DUMP_MEL, mel, order);
 }
 
 void dump_mel_indexes(int mel_indexes[], int order) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fmel_indexes == NULL) {
-	sprintf(s,"%s_mel_indexes.txt", prefix);
-	fmel_indexes = fopen(s, "wt");
-	assert(fmel_indexes != NULL);
-    }
-
-    for(i=0; i<order; i++)
-	fprintf(fmel_indexes,"%d\t",mel_indexes[i]);
-    fprintf(fmel_indexes,"\n");
+    trace_ints(DUMP_MEL_INDEXES, mel_indexes, order);
 }
 
 void dump_ak(float ak[], int order) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fak == NULL) {
-	sprintf(s,"%s_ak.txt", prefix);
-	fak = fopen(s, "wt");
-	assert(fak != NULL);
-    }
-
-    for(i=0; i<=order; i++)
-	fprintf(fak,"%f\t",ak[i]);
-    fprintf(fak,"\n");
+    trace(DUMP_AK, ak, order+1);
 }
 
 void dump_ak_(float ak_[], int order) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fak_ == NULL) {
-	sprintf(s,"%s_ak_.txt", prefix);
-	fak_ = fopen(s, "wt");
-	assert(fak_ != NULL);
-    }
-
-    for(i=0; i<=order; i++)
-	fprintf(fak_,"%f\t",ak_[i]);
-    fprintf(fak_,"\n");
+    trace(DUMP_AK_, ak_, order+1);
 }
 
 void dump_Fw(COMP Fw[]) {
-    int i;
-    char s[MAX_STR];
+    float x[256];
+    int   i;
 
     if (!dumpon) return;
-
-    if (ffw == NULL) {
-	sprintf(s,"%s_fw.txt", prefix);
-	ffw = fopen(s, "wt");
-	assert(ffw != NULL);
-    }
-
     for(i=0; i<256; i++)
-	fprintf(ffw,"%f\t",Fw[i].real);
-    fprintf(ffw,"\n");
+	x[i] = Fw[i].real;
+    trace(DUMP_FW, x, 256);
 }
 
 void dump_e(float e_hz[]) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fe == NULL) {
-	sprintf(s,"%s_e.txt", prefix);
-	fe = fopen(s, "wt");
-	assert(fe != NULL);
-    }
-
-    for(i=0; i<500/2; i++)
-	fprintf(fe,"%f\t",e_hz[i]);
-    fprintf(fe,"\n");
-    for(i=500/2; i<500; i++)
-	fprintf(fe,"%f\t",e_hz[i]);
-    fprintf(fe,"\n");
+    trace(DUMP_E, e_hz, 500);
 }
 
 void dump_sq(float sq[]) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (fsq == NULL) {
-	sprintf(s,"%s_sq.txt", prefix);
-	fsq = fopen(s, "wt");
-	assert(fsq != NULL);
-    }
-
-    for(i=0; i<M/2; i++)
-	fprintf(fsq,"%f\t",sq[i]);
-    fprintf(fsq,"\n");
-    for(i=M/2; i<M; i++)
-	fprintf(fsq,"%f\t",sq[i]);
-    fprintf(fsq,"\n");
+    trace(DUMP_SQ, sq, M);
 }
 
 void dump_dec(COMP Fw[]) {
-    int i;
-    char s[MAX_STR];
+    float x[320/5];
+    int   i;
 
     if (!dumpon) return;
-
-    if (fdec == NULL) {
-	sprintf(s,"%s_dec.txt", prefix);
-	fdec = fopen(s, "wt");
-	assert(fdec != NULL);
-    }
-
     for(i=0; i<320/5; i++)
-	fprintf(fdec,"%f\t",Fw[i].real);
-    fprintf(fdec,"\n");
+	x[i] = Fw[i].real;
+    trace(DUMP_DEC, x, 320/5);
 }
 
 void dump_bg(float e, float bg_est, float percent_uv) {
-    char s[MAX_STR];
+    float x[3];
 
     if (!dumpon) return;
-
-    if (fbg == NULL) {
-	sprintf(s,"%s_bg.txt", prefix);
-	fbg = fopen(s, "wt");
-	assert(fbg != NULL);
-    }
-
-    fprintf(fbg,"%f\t%f\t%f\n", e, bg_est, percent_uv);
+    x[0] = e;
+    x[1] = bg_est;
+    x[2] = percent_uv;
+    trace(DUMP_BG, x, 3);
 }
 
 void dump_E(float E) {
-    char s[MAX_STR];
+    float x;
 
     if (!dumpon) return;
-
-    if (fE == NULL) {
-	sprintf(s,"%s_E.txt", prefix);
-	fE = fopen(s, "wt");
-	assert(fE != NULL);
-    }
-
-    fprintf(fE,"%f\n", 10.0*log10(E));
+    x = 10.0*log10(E);
+    trace(DUMP_E_DB, &x, 1);
 }
 
 void dump_Rk(float Rk[]) {
-    int i;
-    char s[MAX_STR];
-
     if (!dumpon) return;
-
-    if (frk == NULL) {
-	sprintf(s,"%s_rk.txt", prefix);
-	frk = fopen(s, "wt");
-	assert(frk != NULL);
-    }
-
-    for(i=0; i<P_MAX; i++)
-	fprintf(frk,"%f\t",Rk[i]);
-    fprintf(frk,"\n");
+    trace(DUMP_RK, Rk, P_MAX);
 }
 
 #endif
@@ -4,7 +4,11 @@
   AUTHOR......: David Rowe
   DATE CREATED: 25/8/09
 
-  Routines to dump data to text files for Octave analysis.
+  Routines to trace internal states for Octave analysis.  Built with
+  DUMP, each call adds a binary record to a ring buffer which a
+  background thread writes to one trace file, see dump.c for the
+  format.  tools/codec2_trace converts a trace to the text files the
+  Octave scripts load, or to NumPy arrays.
 
 \*---------------------------------------------------------------------------*/
 
@@ -31,6 +35,32 @@
 #include "kiss_fft.h"
 #include "codec2_internal.h"
 
+/* record types, in the order of dump_type_name[] */
+
+enum {
+    DUMP_SN, DUMP_SW, DUMP_SW_, DUMP_EW, DUMP_SOFTDEC,
+    DUMP_MODEL, DUMP_QMODEL, DUMP_PWB, DUMP_PW, DUMP_RW,
+    DUMP_LSP, DUMP_WEIGHTS, DUMP_LSP_, DUMP_MEL, DUMP_MEL_INDEXES,
+    DUMP_AK, DUMP_AK_, DUMP_E_DB, DUMP_LPC_SNR, DUMP_SNR,
+    DUMP_PHASE, DUMP_PHASE_, DUMP_HEPHASE, DUMP_SQ, DUMP_DEC,
+    DUMP_FW, DUMP_E, DUMP_RK, DUMP_BG, DUMP_DROPPED,
+    DUMP_NTYPES
+};
+
+#define DUMP_MAGIC   0x52544332   /* "C2TR", host byte order             */
+#define DUMP_VERSION 1
+#define DUMP_HEADER  16           /* bytes of file header                */
+#define DUMP_RECORD  8            /* bytes of record header              */
+#define DUMP_MAX     512          /* most values in a record             */
+
+struct DUMP_TYPE {
+    const char *name;             /* text file is <prefix>_<name>.txt    */
+    int         ints;             /* non-zero if the values are indexes  */
+    int         split;            /* text rows split in two lines        */
+};
+
+extern const struct DUMP_TYPE dump_type[DUMP_NTYPES];
+
 void dump_on(char filename_prefix[]);
 void dump_off();
 
@@ -38,7 +68,7 @@ void dump_Sn(float Sn[]);
 void dump_Sw(COMP Sw[]);
 void dump_Sw_(COMP Sw_[]);
 void dump_Ew(COMP Ew[]);
-void dump_softdec(float *softdec, int n);
+void dump_softdec(const float *softdec, int n);
 
 /* amplitude modelling */
 
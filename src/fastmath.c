@@ -0,0 +1,211 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: fastmath.c
+  DATE CREATED: Oct 2026
+
+  Batched polynomial sin/cos and atan2 for the phase model, and
+  log10/exp10 for the log domain interpolators.  The decoder evaluates
+  these for every harmonic of every frame, so they are written as
+  straight line loops over arrays that the compiler can vectorise,
+  instead of one sinf()/cosf()/atan2f()/log10f()/powf() call at a
+  time.
+
+  The polynomials are the single precision minimax approximations
+  from Cephes, accurate to a few units in the last place on their
+  reduced ranges.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fastmath.h"
+
+/*---------------------------------------------------------------------------*\
+
+                                 DEFINES
+
+\*---------------------------------------------------------------------------*/
+
+#define TWO_OVER_PI 0.636619772367581f
+
+/* pi/2 split in three so k*DP1 and k*DP2 are exact for |k| < 2^13 */
+
+#define DP1         1.5703125f
+#define DP2         4.837512969970703125e-4f
+#define DP3         7.549789948768648e-8f
+
+/* adding then subtracting 1.5*2^23 rounds to the nearest integer */
+
+#define ROUND_MAGIC 12582912.0f
+
+#define PI_F        3.14159265358979f
+#define PI_2_F      1.57079632679490f
+#define PI_4_F      0.78539816339745f
+#define TAN_PI_8    0.414213562373095f
+
+#define SQRT_HALF   0.707106781186548f
+#define LOG10_E     0.434294481903252f
+#define LOG2_10     3.32192809488736f
+#define FLT_MIN_F   1.17549435E-38f    /* smallest normal float             */
+
+/* log10(2) split in two so k*LG102A is exact for |k| < 2^15 */
+
+#define LG102A      3.00781250E-1f
+#define LG102B      2.48745663981195E-4f
+
+/* 10^x overflows or leaves the normal floats outside this range */
+
+#define EXP10_MAX   38.2f
+#define EXP10_MIN   -37.9f
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: fast_sincos
+  DATE CREATED: Oct 2026
+
+  Reduces x to r = x - k*pi/2, |r| <= pi/4, evaluates the sin and cos
+  polynomials of r, and picks and negates them by the quadrant k.
+
+\*---------------------------------------------------------------------------*/
+
+void fast_sincos(const float x[], float s[], float c[], int n)
+{
+    int i;
+
+    for(i=0; i<n; i++) {
+        float kf = (x[i]*TWO_OVER_PI + ROUND_MAGIC) - ROUND_MAGIC;
+        int   q  = (int)kf;
+        float r  = ((x[i] - kf*DP1) - kf*DP2) - kf*DP3;
+        float z  = r*r;
+
+        float ps = ((-1.9515295891E-4f*z + 8.3321608736E-3f)*z - 1.6666654611E-1f)*z*r + r;
+        float pc = ((2.443315711809948E-5f*z - 1.388731625493765E-3f)*z + 4.166664568298827E-2f)*z*z
+                   - 0.5f*z + 1.0f;
+
+        float sv = (q & 1) ? pc : ps;
+        float cv = (q & 1) ? ps : pc;
+
+        s[i] = (q & 2) ? -sv : sv;
+        c[i] = ((q + 1) & 2) ? -cv : cv;
+    }
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: fast_atan2
+  DATE CREATED: Oct 2026
+
+  atan(t) of t = min(|x|,|y|)/max(|x|,|y|) in [0,1], reduced further
+  to |t| <= tan(pi/8) using atan(t) = pi/4 + atan((t-1)/(t+1)), then
+  unfolded to the right octant.
+
+\*---------------------------------------------------------------------------*/
+
+void fast_atan2(const float y[], const float x[], float a[], int n)
+{
+    int i;
+
+    for(i=0; i<n; i++) {
+        float ax   = x[i] < 0.0f ? -x[i] : x[i];
+        float ay   = y[i] < 0.0f ? -y[i] : y[i];
+        int   swap = ay > ax;
+        float num  = swap ? ax : ay;
+        float den  = swap ? ay : ax;
+        float t    = num/(den + 1E-30f);
+        int   big  = t > TAN_PI_8;
+        float tb   = (t - 1.0f)/(t + 1.0f);
+        float u    = big ? tb : t;
+        float z    = u*u;
+        float v;
+
+        v  = (((8.05374449538E-2f*z - 1.38776856032E-1f)*z + 1.99777106478E-1f)*z - 3.33329491539E-1f)*z*u + u;
+        v += big ? PI_4_F : 0.0f;
+        v  = swap ? PI_2_F - v : v;
+        v  = x[i] < 0.0f ? PI_F - v : v;
+        a[i] = y[i] < 0.0f ? -v : v;
+    }
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: fast_log10
+  DATE CREATED: Oct 2026
+
+  Splits x into m*2^e with m in [sqrt(1/2), sqrt(2)), evaluates the log
+  polynomial of m-1 and adds e*ln(2) in two parts, then scales to base
+  10.  Inputs below the smallest normal float, including zero and
+  negative numbers, are taken as that.
+
+\*---------------------------------------------------------------------------*/
+
+void fast_log10(const float x[], float y[], int n)
+{
+    int i;
+
+    for(i=0; i<n; i++) {
+        union { float f; int i; } u;
+        float xi = x[i] > FLT_MIN_F ? x[i] : FLT_MIN_F;
+        int   e, lo;
+        float m, z, zz, p, fe;
+
+        u.f = xi;
+        e   = ((u.i >> 23) & 0xff) - 126;
+        u.i = (u.i & 0x007fffff) | 0x3f000000;
+        m   = u.f;                                    /* in [0.5, 1)    */
+        lo  = m < SQRT_HALF;
+        e  -= lo;
+        z   = lo ? m + m - 1.0f : m - 1.0f;
+        zz  = z*z;
+        fe  = (float)e;
+
+        p = ((((((((7.0376836292E-2f*z - 1.1514610310E-1f)*z + 1.1676998740E-1f)*z
+                  - 1.2420140846E-1f)*z + 1.4249322787E-1f)*z - 1.6668057665E-1f)*z
+               + 2.0000714765E-1f)*z - 2.4999993993E-1f)*z + 3.3333331174E-1f)*z*zz;
+        p += -2.12194440E-4f*fe - 0.5f*zz;
+
+        y[i] = ((z + p) + 0.693359375f*fe)*LOG10_E;
+    }
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: fast_exp10
+  DATE CREATED: Oct 2026
+
+  Reduces x to r = x - k*log10(2), |r| <= log10(2)/2, evaluates the
+  10^r polynomial and scales it by 2^k through the exponent bits.
+  Inputs are clamped to the range of the normal floats.
+
+\*---------------------------------------------------------------------------*/
+
+void fast_exp10(const float x[], float y[], int n)
+{
+    int i;
+
+    for(i=0; i<n; i++) {
+        union { float f; int i; } u;
+        float xi = x[i] > EXP10_MAX ? EXP10_MAX : (x[i] < EXP10_MIN ? EXP10_MIN : x[i]);
+        float kf = (xi*LOG2_10 + ROUND_MAGIC) - ROUND_MAGIC;
+        float r  = (xi - kf*LG102A) - kf*LG102B;
+        float p;
+
+        p = r*(((((2.063216740311022E-1f*r + 5.420251702225484E-1f)*r + 1.171292686296281E0f)*r
+                 + 2.034649854009453E0f)*r + 2.650948748208892E0f)*r + 2.302585167056758E0f) + 1.0f;
+        u.i = ((int)kf + 127) << 23;
+
+        y[i] = p*u.f;
+    }
+}
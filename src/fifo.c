@@ -32,6 +32,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "codec2_fifo.h"
 
 struct FIFO {
@@ -63,9 +64,8 @@ void fifo_destroy(struct FIFO *fifo) {
 }
 
 int fifo_write(struct FIFO *fifo, short data[], int n) {
-    int            i;
-    short         *pdata;
     short         *pin = fifo->pin;
+    int            n1;
 
     assert(fifo != NULL);
     assert(data != NULL);
@@ -75,15 +75,16 @@ int fifo_write(struct FIFO *fifo, short data[], int n) {
     }
     else {
 
-	/* This could be made more efficient with block copies
-	   using memcpy */
+	/* at most two block copies, split where the buffer wraps */
 
-	pdata = data;
-	for(i=0; i<n; i++) {
-	    *pin++ = *pdata++;
-	    if (pin == (fifo->buf + fifo->nshort))
-		pin = fifo->buf;
-	}
+	n1 = fifo->buf + fifo->nshort - pin;
+	if (n1 > n)
+	    n1 = n;
+	memcpy(pin, data, sizeof(short)*n1);
+	memcpy(fifo->buf, &data[n1], sizeof(short)*(n - n1));
+	pin = (n1 < n) ? fifo->buf + (n - n1) : pin + n1;
+	if (pin == (fifo->buf + fifo->nshort))
+	    pin = fifo->buf;
 	fifo->pin = pin;
     }
 
@@ -92,9 +93,8 @@ int fifo_write(struct FIFO *fifo, short data[], int n) {
 
 int fifo_read(struct FIFO *fifo, short data[], int n)
 {
-    int            i;
-    short         *pdata;
     short         *pout = fifo->pout;
+    int            n1;
 
     assert(fifo != NULL);
     assert(data != NULL);
@@ -103,22 +103,89 @@ int fifo_read(struct FIFO *fifo, short data[], int n)
 	return -1;
     }
     else {
-
-	/* This could be made more efficient with block copies
-	   using memcpy */
-
-	pdata = data;
-	for(i=0; i<n; i++) {
-	    *pdata++ = *pout++;
-	    if (pout == (fifo->buf + fifo->nshort))
-		pout = fifo->buf;
-	}
+	n1 = fifo->buf + fifo->nshort - pout;
+	if (n1 > n)
+	    n1 = n;
+	memcpy(data, pout, sizeof(short)*n1);
+	memcpy(&data[n1], fifo->buf, sizeof(short)*(n - n1));
+	pout = (n1 < n) ? fifo->buf + (n - n1) : pout + n1;
+	if (pout == (fifo->buf + fifo->nshort))
+	    pout = fifo->buf;
 	fifo->pout = pout;
     }
 
     return 0;
 }
 
+/*
+   Zero copy access.  fifo_get_write_span() points *span at the free
+   space following the write pointer and returns how many shorts can
+   be written there without wrapping, the producer fills some or all
+   of them in place then calls fifo_commit_write() with the number it
+   wrote.  When the free space wraps, a second get/commit returns the
+   rest.  The read side works the same way.  As with fifo_write() and
+   fifo_read(), the pointer is only advanced after the data is in
+   place, so one reader and one writer thread need no lock.
+*/
+
+int fifo_get_write_span(struct FIFO *fifo, short **span)
+{
+    int n;
+
+    assert(fifo != NULL);
+    assert(span != NULL);
+
+    n = fifo->buf + fifo->nshort - fifo->pin;
+    if (n > fifo_free(fifo))
+	n = fifo_free(fifo);
+    *span = fifo->pin;
+
+    return n;
+}
+
+void fifo_commit_write(struct FIFO *fifo, int n)
+{
+    short *pin;
+
+    assert(fifo != NULL);
+    assert((n >= 0) && (n <= fifo_free(fifo)));
+
+    pin = fifo->pin + n;
+    assert(pin <= fifo->buf + fifo->nshort);
+    if (pin == (fifo->buf + fifo->nshort))
+	pin = fifo->buf;
+    fifo->pin = pin;
+}
+
+int fifo_get_read_span(struct FIFO *fifo, const short **span)
+{
+    int n;
+
+    assert(fifo != NULL);
+    assert(span != NULL);
+
+    n = fifo->buf + fifo->nshort - fifo->pout;
+    if (n > fifo_used(fifo))
+	n = fifo_used(fifo);
+    *span = fifo->pout;
+
+    return n;
+}
+
+void fifo_commit_read(struct FIFO *fifo, int n)
+{
+    short *pout;
+
+    assert(fifo != NULL);
+    assert((n >= 0) && (n <= fifo_used(fifo)));
+
+    pout = fifo->pout + n;
+    assert(pout <= fifo->buf + fifo->nshort);
+    if (pout == (fifo->buf + fifo->nshort))
+	pout = fifo->buf;
+    fifo->pout = pout;
+}
+
 int fifo_used(const struct FIFO * const fifo)
 {
     short         *pin = fifo->pin;
@@ -0,0 +1,472 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: fixed_dsp.c
+  DATE CREATED: Oct 2026
+
+  Fixed point versions of the decoder's LSP to LPC conversion, 512
+  point inverse real FFT and sinusoidal synthesis, for processors
+  without an FPU (Cortex-M0/M3) or where integer maths costs less
+  energy than float (Cortex-M4).
+
+  The conventions follow CMSIS-DSP: q15_t holds values in [-1,1) with
+  15 fractional bits and q31_t is used for data with headroom.  The
+  per sample kernels only use 32x16 bit multiplies done as two
+  16x16->32 bit multiplies, so they suit the Cortex-M0 as well.  Model parameters (A[], phi[], Wo) stay
+  float, they are converted once per harmonic at the input of each
+  kernel.
+
+  The synthesis kernel uses block floating point: the harmonic
+  amplitudes are scaled by a power of two so the largest is in
+  [2^19,2^20), which leaves headroom for the sum of up to MAX_AMP
+  harmonics in the inverse FFT while keeping about 20 significant
+  bits.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <math.h>
+
+#include "defines.h"
+#include "fixed_dsp.h"
+
+/*---------------------------------------------------------------------------*\
+
+                                 DEFINES
+
+\*---------------------------------------------------------------------------*/
+
+#if FFT_DEC != 512
+#error fixed_rifft_512() requires FFT_DEC == 512
+#endif
+
+#define SIN_TAB_BITS  10
+#define SIN_TAB_SIZE  (1 << SIN_TAB_BITS)    /* one full cycle            */
+#define SIN_FRAC_BITS 12                     /* interpolation resolution  */
+
+#define CFFT_SIZE     (FFT_DEC/2)            /* complex FFT inside rifft  */
+#define CFFT_BITS     8
+
+#define LPC_Q         21                     /* LSP to LPC polynomials    */
+#define COS_TAB_SIZE  512                    /* Q30 cos() steps over [0,pi] */
+
+#define EAR_THRESH    (30000 << FIXED_SN_SHIFT)
+
+/* Synthesis scaling limits.  Scaled amplitudes are clipped at 2^22,
+   an A[] of 2^18 or about 18 dB over full scale, so the inverse FFT
+   of MAX_AMP harmonics can't overflow 32 bits. */
+
+#define SYN_MAX_SHIFT 30
+#define SYN_MAX_AMP   (1 << 22)
+
+/*---------------------------------------------------------------------------*\
+
+                                 GLOBALS
+
+\*---------------------------------------------------------------------------*/
+
+/* Read only after fixed_dsp_init(), shared by all instances */
+
+static q15_t         sin_tab[SIN_TAB_SIZE];
+static q31_t         cos_tab[COS_TAB_SIZE+1];
+static unsigned char bitrev[CFFT_SIZE];
+static int           init_done = 0;
+
+/*---------------------------------------------------------------------------*\
+
+                                 FUNCTIONS
+
+\*---------------------------------------------------------------------------*/
+
+/* (a*b) >> 15 for 32 bit a, 16 bit b, as two 16x16->32 multiplies */
+
+static inline q31_t mul_q31_q15(q31_t a, q15_t b)
+{
+    return ((a >> 16)*(q31_t)b)*2 + (q31_t)(((a & 0xffff)*(q31_t)b) >> 15);
+}
+
+static inline q15_t sat_q15(float x)
+{
+    if (x >= 1.0) return 32767;
+    if (x < -1.0) return -32768;
+    return (q15_t)floorf(x*32768.0 + 0.5);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: fixed_dsp_init
+  DATE CREATED: Oct 2026
+
+  Builds the sine, cosine and bit reversal tables.  Called when the first
+  codec2 instance is created, later calls do nothing.
+
+\*---------------------------------------------------------------------------*/
+
+void fixed_dsp_init(void)
+{
+    int i, j, b;
+
+    if (init_done)
+	return;
+
+    for(i=0; i<SIN_TAB_SIZE; i++)
+	sin_tab[i] = sat_q15(sinf(TWO_PI*i/SIN_TAB_SIZE));
+    for(i=0; i<=COS_TAB_SIZE; i++)
+	cos_tab[i] = (q31_t)floor(cos(PI*i/COS_TAB_SIZE)*(1 << 30) + 0.5);
+
+    for(i=0; i<CFFT_SIZE; i++) {
+	for(j=0, b=0; j<CFFT_BITS; j++)
+	    b |= ((i >> j) & 1) << (CFFT_BITS-1-j);
+	bitrev[i] = b;
+    }
+
+    init_done = 1;
+}
+
+void fixed_synthesis_window(q15_t Pn_q15[], const float Pn[])
+{
+    int i;
+
+    for(i=0; i<2*N; i++)
+	Pn_q15[i] = sat_q15(Pn[i]);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: fixed_sincos_q15
+  DATE CREATED: Oct 2026
+
+  sin and cos of phi radians in Q15, linearly interpolated from the
+  1024 entry table.  Max abs error is about 3E-5, the size of one Q15
+  step.
+
+\*---------------------------------------------------------------------------*/
+
+void fixed_sincos_q15(float phi, q15_t *s, q15_t *c)
+{
+    q31_t a, i, f, s0, s1, c0, c1;
+    float cycles;
+
+    /* fraction of a cycle, scaled so one cycle is 2^(SIN_TAB_BITS+SIN_FRAC_BITS) */
+
+    cycles = phi*(1.0/TWO_PI);
+    cycles -= floorf(cycles);
+    a = (q31_t)(cycles*(1 << (SIN_TAB_BITS+SIN_FRAC_BITS)) + 0.5);
+    i = (a >> SIN_FRAC_BITS) & (SIN_TAB_SIZE-1);
+    f = a & ((1 << SIN_FRAC_BITS) - 1);
+
+    s0 = sin_tab[i];
+    s1 = sin_tab[(i+1) & (SIN_TAB_SIZE-1)];
+    c0 = sin_tab[(i+SIN_TAB_SIZE/4) & (SIN_TAB_SIZE-1)];
+    c1 = sin_tab[(i+SIN_TAB_SIZE/4+1) & (SIN_TAB_SIZE-1)];
+
+    *s = s0 + (((s1 - s0)*f) >> SIN_FRAC_BITS);
+    *c = c0 + (((c1 - c0)*f) >> SIN_FRAC_BITS);
+}
+
+/* in place radix 2 inverse complex FFT of CFFT_SIZE points, unscaled */
+
+static void cifft(q31_t z[])
+{
+    int   i, j, k, size, half, step;
+    q31_t tr, ti, wr, wi;
+
+    for(i=0; i<CFFT_SIZE; i++) {
+	j = bitrev[i];
+	if (j > i) {
+	    tr = z[2*i];   z[2*i]   = z[2*j];   z[2*j]   = tr;
+	    ti = z[2*i+1]; z[2*i+1] = z[2*j+1]; z[2*j+1] = ti;
+	}
+    }
+
+    for(size=2; size<=CFFT_SIZE; size*=2) {
+	half = size/2;
+	step = SIN_TAB_SIZE/size;
+	for(k=0; k<half; k++) {
+
+	    /* e^(+j*2*pi*k/size) */
+
+	    wi = sin_tab[k*step];
+	    wr = sin_tab[(k*step + SIN_TAB_SIZE/4) & (SIN_TAB_SIZE-1)];
+
+	    for(i=k; i<CFFT_SIZE; i+=size) {
+		j = i + half;
+		tr = mul_q31_q15(z[2*j], wr) - mul_q31_q15(z[2*j+1], wi);
+		ti = mul_q31_q15(z[2*j], wi) + mul_q31_q15(z[2*j+1], wr);
+		z[2*j]   = z[2*i]   - tr;
+		z[2*j+1] = z[2*i+1] - ti;
+		z[2*i]   += tr;
+		z[2*i+1] += ti;
+	    }
+	}
+    }
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: fixed_rifft_512
+  DATE CREATED: Oct 2026
+
+  Unscaled inverse real FFT, the fixed point equivalent of kiss_fftri()
+  with FFT_DEC points.  X[] holds the real and imaginary parts of bins
+  0..FFT_DEC/2, x[] receives FFT_DEC real samples.  |x[n]| is bounded
+  by twice the sum of |X[k]|, which the caller must keep below 2^31.
+
+  The even and odd output samples are formed as the real and
+  imaginary parts of one FFT_DEC/2 point complex inverse FFT of
+
+    Z[k] = (X[k] + X*[N/2-k]) + j*e^(j*2*pi*k/N)*(X[k] - X*[N/2-k])
+
+\*---------------------------------------------------------------------------*/
+
+void fixed_rifft_512(const q31_t X[], q31_t x[])
+{
+    q31_t z[2*CFFT_SIZE];
+    q31_t er, ei, dr, di, or_, oi, wr, wi;
+    int   k;
+
+    for(k=0; k<CFFT_SIZE; k++) {
+	er = X[2*k]   + X[2*(CFFT_SIZE-k)];
+	ei = X[2*k+1] - X[2*(CFFT_SIZE-k)+1];
+	dr = X[2*k]   - X[2*(CFFT_SIZE-k)];
+	di = X[2*k+1] + X[2*(CFFT_SIZE-k)+1];
+
+	/* e^(+j*2*pi*k/FFT_DEC) */
+
+	wi = sin_tab[k*(SIN_TAB_SIZE/FFT_DEC)];
+	wr = sin_tab[(k*(SIN_TAB_SIZE/FFT_DEC) + SIN_TAB_SIZE/4) & (SIN_TAB_SIZE-1)];
+	or_ = mul_q31_q15(dr, wr) - mul_q31_q15(di, wi);
+	oi  = mul_q31_q15(dr, wi) + mul_q31_q15(di, wr);
+
+	z[2*k]   = er - oi;
+	z[2*k+1] = ei + or_;
+    }
+
+    cifft(z);
+
+    for(k=0; k<CFFT_SIZE; k++) {
+	x[2*k]   = z[2*k];
+	x[2*k+1] = z[2*k+1];
+    }
+}
+
+/* (a*b) >> 30 for Q30 b, the 32x32->64 bit multiply of CMSIS-DSP's q31 kernels */
+
+static inline q31_t mul_q31_q30(q31_t a, q31_t b)
+{
+    return (q31_t)(((int64_t)a*b) >> 30);
+}
+
+/* cos(w) in Q30 for |w| <= 2pi, from the nearest cos_tab[] entry k and
+   cos(a+d) = cos(a)(1 - d^2/2) - sin(a)d, |d| <= pi/(2*COS_TAB_SIZE) */
+
+static q31_t cos_q30(float w)
+{
+    q31_t d, d2, c, s;
+    int   k;
+
+    /* unquantised or extrapolated LSPs can stray outside [0,pi] */
+
+    w = fabsf(w);
+    if (w > PI) w = TWO_PI - w;
+    if (w < 0.0) w = 0.0;
+    k = (int)(w*(COS_TAB_SIZE/PI) + 0.5);
+    d = (q31_t)((w - k*(PI/COS_TAB_SIZE))*(1 << 30));
+    d2 = mul_q31_q30(d, d) >> 1;
+
+    c = cos_tab[k];
+    s = (k <= COS_TAB_SIZE/2) ? cos_tab[COS_TAB_SIZE/2 - k] : cos_tab[k - COS_TAB_SIZE/2];
+
+    return c - mul_q31_q30(c, d2) - mul_q31_q30(s, d);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: lsp_to_lpc_fixed
+  DATE CREATED: Oct 2026
+
+  Fixed point lsp_to_lpc() for even orders.  The sum and difference
+  polynomials are expanded from their second order sections
+  1 - 2cos(w)z^-1 + z^-2 in Q21, ak[] is returned as float for
+  aks_to_M2().
+
+  Closely spaced LSPs are common in the finely quantised modes and
+  place poles right next to the unit circle, so cos(w) needs far more
+  than Q15 precision here.  It is held in Q30 and the products use 64
+  bit intermediates, which costs little as this runs once per 10ms.
+
+\*---------------------------------------------------------------------------*/
+
+void lsp_to_lpc_fixed(float *lsp, float *ak, int order)
+{
+    q31_t f1[LPC_ORD/2+1], f2[LPC_ORD/2+1];
+    q31_t x[LPC_ORD];
+    q31_t *f;
+    int   i, j, p, nc;
+
+    assert((order % 2) == 0);
+    assert(order <= LPC_ORD);
+    nc = order/2;
+
+    /* x[] = -2cos(w) in Q29 */
+
+    for(i=0; i<order; i++)
+	x[i] = -cos_q30(lsp[i]);
+
+    /* f[] = prod(1 + x[2i+p]z^-1 + z^-2) */
+
+    for(p=0; p<2; p++) {
+	f = p ? f2 : f1;
+	f[0] = 1 << LPC_Q;
+	f[1] = x[p] >> (29 - LPC_Q);
+	for(i=2; i<=nc; i++) {
+	    f[i] = mul_q31_q30(f[i-1], x[2*i-2+p])*2 + 2*f[i-2];
+	    for(j=i-1; j>1; j--)
+		f[j] += mul_q31_q30(f[j-1], x[2*i-2+p])*2 + f[j-2];
+	    f[1] += x[2*i-2+p] >> (29 - LPC_Q);
+	}
+    }
+
+    /* multiply by (1 + z^-1) and (1 - z^-1), then combine */
+
+    for(i=nc; i>0; i--) {
+	f1[i] += f1[i-1];
+	f2[i] -= f2[i-1];
+    }
+
+    ak[0] = 1.0;
+    for(i=1; i<=nc; i++) {
+	ak[i]         = ((float)f1[i] + (float)f2[i])*(0.5/(1 << LPC_Q));
+	ak[order+1-i] = ((float)f1[i] - (float)f2[i])*(0.5/(1 << LPC_Q));
+    }
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: synthesise_fixed
+  DATE CREATED: Oct 2026
+
+  Fixed point synthesise().  Sn_[] is the 2N sample overlap add buffer
+  with FIXED_SN_SHIFT fractional bits, Pn[] the Q15 synthesis window
+  from fixed_synthesis_window().
+
+\*---------------------------------------------------------------------------*/
+
+void synthesise_fixed(q31_t Sn_[], MODEL *model, const q15_t Pn[], int shift)
+{
+    q31_t X[FFT_DEC+2];         /* bins 0..FFT_DEC/2 of synthesised signal */
+    q31_t x[FFT_DEC];           /* synthesised signal, scaled by 2^sc      */
+    q31_t a, v, rnd;
+    q15_t s, c;
+    float amax, scale;
+    int   i, j, l, b, e, sc, sh;
+
+    /* block floating point scaling, largest amplitude in [2^19,2^20) */
+
+    amax = 0.0;
+    for(l=1; l<=model->L; l++)
+	if (model->A[l] > amax)
+	    amax = model->A[l];
+    sc = SYN_MAX_SHIFT;
+    if (amax > 0.0) {
+	frexpf(amax, &e);
+	sc = 20 - e;
+	if (sc > SYN_MAX_SHIFT) sc = SYN_MAX_SHIFT;
+	if (sc < FIXED_SN_SHIFT) sc = FIXED_SN_SHIFT;
+    }
+    scale = ldexpf(1.0, sc);
+
+    for(i=0; i<FFT_DEC+2; i++)
+	X[i] = 0;
+
+    for(l=1; l<=model->L; l++) {
+	b = (int)(l*model->Wo*FFT_DEC/TWO_PI + 0.5);
+	if (b > ((FFT_DEC/2)-1)) {
+		b = (FFT_DEC/2)-1;
+	}
+	a = (model->A[l]*scale < SYN_MAX_AMP) ? (q31_t)(model->A[l]*scale) : SYN_MAX_AMP;
+	fixed_sincos_q15(model->phi[l], &s, &c);
+	X[2*b]   = mul_q31_q15(a, c);
+	X[2*b+1] = mul_q31_q15(a, s);
+    }
+
+    fixed_rifft_512(X, x);
+
+    /* Overlap add to previous samples, rescaling to FIXED_SN_SHIFT */
+
+    sh  = sc - FIXED_SN_SHIFT;
+    rnd = sh ? 1 << (sh-1) : 0;
+
+#define RESCALE(v) (((v) + rnd) >> sh)
+
+    if (shift) {
+	for(i=0; i<N-1; i++) {
+	    v = mul_q31_q15(x[FFT_DEC-N+1+i], Pn[i]);
+	    Sn_[i] = Sn_[i+N] + RESCALE(v);
+	}
+	for(i=N-1,j=0; i<2*N; i++,j++) {
+	    v = mul_q31_q15(x[j], Pn[i]);
+	    Sn_[i] = RESCALE(v);
+	}
+    }
+    else {
+	for(i=0; i<N-1; i++) {
+	    v = mul_q31_q15(x[FFT_DEC-N+1+i], Pn[i]);
+	    Sn_[i] += RESCALE(v);
+	}
+	for(i=N-1,j=0; i<2*N; i++,j++) {
+	    v = mul_q31_q15(x[j], Pn[i]);
+	    Sn_[i] += RESCALE(v);
+	}
+    }
+
+#undef RESCALE
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: ear_protection_fixed
+  DATE CREATED: Oct 2026
+
+  ear_protection() on the fixed point overlap add buffer, if the peak
+  is x dB over 30000 the frame is attenuated by 2x dB.  Returns
+  non-zero if it was.
+
+\*---------------------------------------------------------------------------*/
+
+int ear_protection_fixed(q31_t Sn_[], int n)
+{
+    q31_t max_sample, r, gain;
+    int   i;
+
+    max_sample = 0;
+    for(i=0; i<n; i++)
+	if (Sn_[i] > max_sample)
+	    max_sample = Sn_[i];
+
+    if (max_sample <= EAR_THRESH)
+	return 0;
+
+    /* gain = (EAR_THRESH/max_sample)^2, via the ratio in Q12 */
+
+    r = ((q31_t)EAR_THRESH << 12)/max_sample;
+    gain = (r*r) >> 9;
+    for(i=0; i<n; i++)
+	Sn_[i] = mul_q31_q15(Sn_[i], (q15_t)gain);
+
+    return 1;
+}
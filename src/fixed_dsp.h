@@ -0,0 +1,50 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: fixed_dsp.h
+  DATE CREATED: Oct 2026
+
+  Fixed point decoder kernels, used in place of the float LSP to LPC
+  conversion, inverse FFT and synthesis when built with
+  CODEC2_FIXED_DECODER.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __FIXED_DSP__
+#define __FIXED_DSP__
+
+#include <stdint.h>
+#include "defines.h"
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+/* fractional bits of the synthesis overlap add buffer Sn_[] */
+
+#define FIXED_SN_SHIFT 4
+
+void fixed_dsp_init(void);
+void fixed_synthesis_window(q15_t Pn_q15[], const float Pn[]);
+
+void fixed_sincos_q15(float phi, q15_t *s, q15_t *c);
+void fixed_rifft_512(const q31_t X[], q31_t x[]);
+
+void lsp_to_lpc_fixed(float lsp[], float ak[], int order);
+void synthesise_fixed(q31_t Sn_[], MODEL *model, const q15_t Pn[], int shift);
+int  ear_protection_fixed(q31_t Sn_[], int n);
+
+#endif
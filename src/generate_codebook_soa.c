@@ -0,0 +1,215 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: generate_codebook_soa.c
+  DATE CREATED: Oct 2026
+
+  Build time generator for the transposed ("structure of arrays")
+  copies of the codebooks searched by the VQ kernels.  Linked against
+  the row major codebook*.c tables, it writes a C file where each
+  stage is stored one dimension per row, cb[i*mpad+j], with rows
+  padded to a multiple of CB_SOA_PAD entries, plus the ||c||^2 norm
+  of each entry for dot product searches.
+
+  With -q it writes the codebooks themselves instead, in place of
+  their codebook*.c files, as CB_LAYOUT_Q16 int16 rows with one scale
+  per stage, for CODEC2_CODEBOOK_Q16 builds.
+
+  Only the sets named are written, all of them if none are.
+
+    usage: generate_codebook_soa [-q] codebook_soa.c [set ...]
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+
+struct cb_set {
+    const char                *name;
+    const struct lsp_codebook *cb;
+};
+
+static const struct cb_set sets[] = {
+    { "lsp_cbjvm",   lsp_cbjvm },
+    { "ge_cb",       ge_cb },
+    { "lspmelvq_cb", lspmelvq_cb },
+    { NULL, NULL }
+};
+
+/* enough significant digits to round trip a float exactly */
+
+static void print_float(FILE *f, float x)
+{
+    fprintf(f, "%.9g", x);
+}
+
+static void write_set(FILE *f, const struct cb_set *set)
+{
+    const struct lsp_codebook *cb;
+    int   s, i, j, k, m, mpad;
+    float norm;
+
+    for(s=0; set->cb[s].k; s++) {
+	cb = &set->cb[s];
+	k = cb->k; m = cb->m;
+	mpad = (m + CB_SOA_PAD - 1)/CB_SOA_PAD*CB_SOA_PAD;
+
+	fprintf(f, "static const float %s_soa%d[] CB_ALIGN = {\n", set->name, s);
+	for(i=0; i<k; i++) {
+	    fprintf(f, "  /* dimension %d */\n", i);
+	    for(j=0; j<mpad; j++) {
+		fprintf(f, (j % 8) ? " " : "  ");
+		print_float(f, j < m ? cb->cb[j*k+i] : 0.0f);
+		fprintf(f, ((i == k-1) && (j == mpad-1)) ? "\n" : ((j % 8) == 7 ? ",\n" : ","));
+	    }
+	}
+	fprintf(f, "};\n\n");
+
+	fprintf(f, "static const float %s_norm%d[] CB_ALIGN = {\n", set->name, s);
+	for(j=0; j<mpad; j++) {
+	    norm = 0.0;
+	    if (j < m)
+		for(i=0; i<k; i++)
+		    norm += cb->cb[j*k+i]*cb->cb[j*k+i];
+	    fprintf(f, (j % 8) ? " " : "  ");
+	    print_float(f, norm);
+	    fprintf(f, (j == mpad-1) ? "\n" : ((j % 8) == 7 ? ",\n" : ","));
+	}
+	fprintf(f, "};\n\n");
+    }
+
+    fprintf(f, "const struct lsp_codebook %s_soa[] = {\n", set->name);
+    for(s=0; set->cb[s].k; s++) {
+	cb = &set->cb[s];
+	mpad = (cb->m + CB_SOA_PAD - 1)/CB_SOA_PAD*CB_SOA_PAD;
+	fprintf(f, "  {\n    %d,\n    %d,\n    %d,\n    %s_soa%d,\n    CB_LAYOUT_SOA, %d, %s_norm%d, 0, 0\n  },\n",
+		cb->k, cb->log2m, cb->m, set->name, s, mpad, set->name, s);
+    }
+    fprintf(f, "  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }\n};\n\n");
+}
+
+/* int16 rows, each stage scaled so its largest magnitude is 32767 */
+
+static float stage_scale(const struct lsp_codebook *cb)
+{
+    float maxabs;
+    int   j;
+
+    maxabs = 0.0;
+    for(j=0; j<cb->k*cb->m; j++)
+	if (fabsf(cb->cb[j]) > maxabs)
+	    maxabs = fabsf(cb->cb[j]);
+
+    return maxabs > 0.0 ? maxabs/32767.0f : 1.0f;
+}
+
+static void write_set_q16(FILE *f, const struct cb_set *set)
+{
+    const struct lsp_codebook *cb;
+    float scale;
+    int   s, j, n;
+
+    for(s=0; set->cb[s].k; s++) {
+	cb = &set->cb[s];
+	n = cb->k*cb->m;
+	scale = stage_scale(cb);
+
+	fprintf(f, "static const short %s_q%d[] = {\n", set->name, s);
+	for(j=0; j<n; j++) {
+	    fprintf(f, (j % 10) ? " " : "  ");
+	    fprintf(f, "%ld", lrintf(cb->cb[j]/scale));
+	    fprintf(f, (j == n-1) ? "\n" : ((j % 10) == 9 ? ",\n" : ","));
+	}
+	fprintf(f, "};\n\n");
+    }
+
+    fprintf(f, "const struct lsp_codebook %s[] = {\n", set->name);
+    for(s=0; set->cb[s].k; s++) {
+	cb = &set->cb[s];
+	fprintf(f, "  {\n    %d,\n    %d,\n    %d,\n    0,\n    CB_LAYOUT_Q16, 0, 0, %s_q%d, ",
+		cb->k, cb->log2m, cb->m, set->name, s);
+	print_float(f, stage_scale(cb));
+	fprintf(f, "\n  },\n");
+    }
+    fprintf(f, "  { 0, 0, 0, 0, 0, 0, 0, 0, 0 }\n};\n\n");
+}
+
+static int wanted(const char *name, int nnames, char *names[])
+{
+    int i;
+
+    if (nnames == 0)
+	return 1;
+    for(i=0; i<nnames; i++)
+	if (strcmp(name, names[i]) == 0)
+	    return 1;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *f;
+    int   i, j, a, q16;
+
+    a = 1;
+    q16 = (argc > 1) && (strcmp(argv[1], "-q") == 0);
+    if (q16)
+	a++;
+    if (argc <= a) {
+	fprintf(stderr, "usage: %s [-q] codebook_soa.c [set ...]\n", argv[0]);
+	exit(1);
+    }
+    for(i=a+1; i<argc; i++) {
+	for(j=0; sets[j].name && strcmp(sets[j].name, argv[i]); j++)
+	    ;
+	if (sets[j].name == NULL) {
+	    fprintf(stderr, "Unknown codebook %s\n", argv[i]);
+	    exit(1);
+	}
+    }
+
+    f = fopen(argv[a], "wt");
+    if (f == NULL) {
+	fprintf(stderr, "Error opening %s\n", argv[a]);
+	exit(1);
+    }
+
+    fprintf(f, "/* THIS IS A GENERATED FILE. Edit generate_codebook_soa.c */\n\n");
+    fprintf(f, "#include \"defines.h\"\n\n");
+    if (!q16) {
+	fprintf(f, "#if defined(__GNUC__) || defined(__clang__)\n");
+	fprintf(f, "#define CB_ALIGN __attribute__((aligned(32)))\n");
+	fprintf(f, "#else\n#define CB_ALIGN\n#endif\n\n");
+    }
+
+    for(i=0; sets[i].name; i++) {
+	if (!wanted(sets[i].name, argc-a-1, &argv[a+1]))
+	    continue;
+	if (q16)
+	    write_set_q16(f, &sets[i]);
+	else
+	    write_set(f, &sets[i]);
+    }
+
+    fclose(f);
+
+    return 0;
+}
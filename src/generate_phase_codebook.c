@@ -0,0 +1,138 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: generate_phase_codebook.c
+  DATE CREATED: Oct 2026
+
+  Converter for the phaseexp.c phase VQ codebooks.  Given a text
+  codebook and an output file it writes the binary format of
+  phaseexp_codebook.h, read with one fread() instead of parsed.  Saved
+  beside the text codebook with ".pcb" in place of ".txt" it is read
+  instead of the text one.
+
+  With -c it writes a C file holding the codebooks named, in order, as
+  the phase_cb[] stages compiled in by CODEC2_PHASEEXP_CODEBOOKS.  Text
+  and binary codebooks are both accepted as input.
+
+    usage: generate_phase_codebook codebook.txt codebook.pcb
+           generate_phase_codebook -c phaseexp_codebook.c codebook ...
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phaseexp_codebook.h"
+
+/* enough significant digits to round trip a float exactly */
+
+static void print_float(FILE *f, float x)
+{
+    fprintf(f, "%.9g", x);
+}
+
+static int write_c(const char *name, int n, char *cb_names[])
+{
+    struct codebook b;
+    COMP           *cb;
+    FILE           *f;
+    unsigned int   *dim;
+    unsigned int    i;
+    int             s;
+
+    dim = (unsigned int *)malloc(2*n*sizeof(unsigned int));
+    f = fopen(name, "wt");
+    if ((dim == NULL) || (f == NULL)) {
+	fprintf(stderr, "Error opening %s\n", name);
+	free(dim);
+	if (f != NULL)
+	    fclose(f);
+	return 1;
+    }
+
+    fprintf(f, "/* Generated by generate_phase_codebook.c, do not edit */\n\n");
+    fprintf(f, "#include \"phaseexp_codebook.h\"\n\n");
+
+    for(s=0; s<n; s++) {
+	cb = phase_codebook_load(&b, cb_names[s]);
+	if (cb == NULL) {
+	    fprintf(stderr, "Error reading %s\n", cb_names[s]);
+	    fclose(f);
+	    free(dim);
+	    return 1;
+	}
+	fprintf(f, "/* %s */\n\n", cb_names[s]);
+	fprintf(f, "static const COMP phase_cb%d[] = {\n", s);
+	for(i=0; i<b.k*b.m; i++) {
+	    fprintf(f, (i % 4) ? " {" : "  {");
+	    print_float(f, cb[i].real);
+	    fprintf(f, ", ");
+	    print_float(f, cb[i].imag);
+	    fprintf(f, (i + 1 < b.k*b.m) ? "}," : "}");
+	    if ((i % 4) == 3)
+		fprintf(f, "\n");
+	}
+	fprintf(f, "%s};\n\n", (i % 4) ? "\n" : "");
+	free(cb);
+	dim[2*s] = b.k;
+	dim[2*s+1] = b.m;
+    }
+
+    fprintf(f, "const struct codebook phase_cb[] = {\n");
+    for(s=0; s<n; s++)
+	fprintf(f, "  { %u, 0, %u, phase_cb%d, 0 },\n", dim[2*s], dim[2*s+1], s);
+    fprintf(f, "  { 0, 0, 0, 0, 0 }\n};\n");
+    free(dim);
+
+    if (fclose(f) != 0) {
+	fprintf(stderr, "Error writing %s\n", name);
+	return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct codebook b;
+    COMP           *cb;
+    int             err;
+
+    if ((argc > 3) && (strcmp(argv[1], "-c") == 0))
+	return write_c(argv[2], argc - 3, &argv[3]);
+
+    if ((argc != 3) || (argv[1][0] == '-')) {
+	fprintf(stderr, "usage: %s codebook.txt codebook.pcb\n", argv[0]);
+	fprintf(stderr, "       %s -c phaseexp_codebook.c codebook ...\n", argv[0]);
+	return 1;
+    }
+
+    cb = phase_codebook_load_text(&b, argv[1]);
+    if (cb == NULL) {
+	fprintf(stderr, "Error reading %s\n", argv[1]);
+	return 1;
+    }
+    err = phase_codebook_write_bin(&b, argv[2]);
+    if (err)
+	fprintf(stderr, "Error writing %s\n", argv[2]);
+    else
+	fprintf(stderr, "%s: k %u m %u\n", argv[2], b.k, b.m);
+    free(cb);
+
+    return err ? 1 : 0;
+}
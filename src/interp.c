@@ -31,6 +31,7 @@
 #include <stdio.h>
 
 #include "defines.h"
+#include "fastmath.h"
 #include "interp.h"
 #include "lsp.h"
 #include "quantise.h"
@@ -57,6 +58,9 @@ float sample_log_amp(MODEL *model, float w);
   amplitude modulated, and gets louder.  The interp_lsp() function
   below seems to do a better job.
 
+  See interpolate_log_amps() to interpolate several frames between the
+  same two.
+
 \*---------------------------------------------------------------------------*/
 
 void interpolate(
@@ -65,14 +69,82 @@ void interpolate(
   MODEL *next       /* next frames model params                      */
 )
 {
+    float prev_logA[MAX_AMP+1], next_logA[MAX_AMP+1];
+
+    interp_log_amps(prev, prev_logA);
+    interp_log_amps(next, next_logA);
+    interpolate_log_amps(interp, prev, prev_logA, next, next_logA, 0.5);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: interp_log_amps()
+  DATE CREATED: Oct 2026
+
+  logA[l] = log10(A[l] + 1E-6) of a decoded frame's harmonics, with
+  logA[0] = 0, for interpolate_log_amps().  Worked out once per frame
+  and used for all of the frames interpolated from it.
+
+\*---------------------------------------------------------------------------*/
+
+void interp_log_amps(const MODEL *model, float logA[])
+{
+    int l;
+
+    assert((model->L >= 1) && (model->L <= MAX_AMP));
+    logA[0] = 0.0;
+    for(l=1; l<=model->L; l++)
+	logA[l] = model->A[l] + 1E-6;
+    fast_log10(&logA[1], &logA[1], model->L);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: interpolate_log_amps()
+  DATE CREATED: Oct 2026
+
+  interpolate() at weight between prev (0.0) and next (1.0), from the
+  frames' logA[] by interp_log_amps().  The envelope of each frame is
+  sampled at the harmonics of interp as sample_log_amp() does: logA[0]
+  stands in for the missing neighbour below harmonic 1 and above L,
+  so the loop has no branches, then the log amplitudes are converted
+  back in one fast_exp10() call.
+
+\*---------------------------------------------------------------------------*/
+
+static void sample_log_amps(float out[], const MODEL *model, const float logA[],
+			    float Wo, int L, float weight)
+{
+    float w, f, Wo_m = model->Wo;
+    int   l, m, lo, hi, Lm = model->L;
+
+    for(l=1; l<=L; l++) {
+	w  = l*Wo;
+	m  = floorf(w/Wo_m + 0.5);
+	f  = (w - m*Wo_m)/w;
+	lo = m > Lm ? Lm : m;
+	hi = m+1 > Lm ? 0 : m+1;
+	out[l] += weight*((1.0 - f)*logA[lo] + f*logA[hi]);
+    }
+}
+
+void interpolate_log_amps(
+  MODEL       *interp,    /* interpolated model params                */
+  const MODEL *prev,      /* previous frames model params             */
+  const float  prev_logA[],
+  const MODEL *next,      /* next frames model params                 */
+  const float  next_logA[],
+  float        weight
+)
+{
+    float log_amp[MAX_AMP+1];
     int   l;
-    float w,log_amp;
 
     /* Wo depends on voicing of this and adjacent frames */
 
     if (interp->voiced) {
 	if (prev->voiced && next->voiced)
-	    interp->Wo = (prev->Wo + next->Wo)/2.0;
+	    interp->Wo = (1.0 - weight)*prev->Wo + weight*next->Wo;
 	if (!prev->voiced && next->voiced)
 	    interp->Wo = next->Wo;
 	if (prev->voiced && !next->voiced)
@@ -82,14 +154,15 @@ void interpolate(
 	interp->Wo = TWO_PI/P_MAX;
     }
     interp->L = PI/interp->Wo;
+    assert((interp->L >= 1) && (interp->L <= MAX_AMP));
 
     /* Interpolate amplitudes using linear interpolation in log domain */
 
-    for(l=1; l<=interp->L; l++) {
-	w = l*interp->Wo;
-	log_amp = (sample_log_amp(prev, w) + sample_log_amp(next, w))/2.0;
-	interp->A[l] = powf(10.0, log_amp);
-    }
+    for(l=1; l<=interp->L; l++)
+	log_amp[l] = 0.0;
+    sample_log_amps(log_amp, prev, prev_logA, interp->Wo, interp->L, 1.0 - weight);
+    sample_log_amps(log_amp, next, next_logA, interp->Wo, interp->L, weight);
+    fast_exp10(&log_amp[1], &interp->A[1], interp->L);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -282,8 +355,10 @@ void interp_Wo2(
 
 float interp_energy(float prev_e, float next_e)
 {
-    return powf(10.0, (log10f(prev_e) + log10f(next_e))/2.0);
+    float e;
 
+    interp_energies(&e, prev_e, next_e, 1);
+    return e;
 }
 
 
@@ -298,10 +373,50 @@ float interp_energy(float prev_e, float next_e)
 
 \*---------------------------------------------------------------------------*/
 
+/* e[i] at weight[i] between prev_e and next_e, in the log domain */
+
+static void energies_at(float e[], float prev_e, float next_e, const float weight[], int n)
+{
+    float x[2], log_e[2], log_i[INTERP_MAX_FRAMES];
+    int   i;
+
+    assert(n <= INTERP_MAX_FRAMES);
+    x[0] = prev_e;
+    x[1] = next_e;
+    fast_log10(x, log_e, 2);
+    for(i=0; i<n; i++)
+	log_i[i] = (1.0 - weight[i])*log_e[0] + weight[i]*log_e[1];
+    fast_exp10(log_i, e, n);
+}
+
 float interp_energy2(float prev_e, float next_e, float weight)
 {
-    return powf(10.0, (1.0 - weight)*log10f(prev_e) + weight*log10f(next_e));
+    float e;
+
+    energies_at(&e, prev_e, next_e, &weight, 1);
+    return e;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: interp_energies()
+  DATE CREATED: Oct 2026
+
+  The energies of the n frames evenly spaced between two samples,
+  e[i] = interp_energy2(prev_e, next_e, (i+1)/(n+1)), with the log of
+  each sample found once.
+
+\*---------------------------------------------------------------------------*/
+
+void interp_energies(float e[], float prev_e, float next_e, int n)
+{
+    float weight[INTERP_MAX_FRAMES];
+    int   i;
 
+    assert(n <= INTERP_MAX_FRAMES);
+    for(i=0; i<n; i++)
+	weight[i] = (float)(i+1)/(n+1);
+    energies_at(e, prev_e, next_e, weight, n);
 }
 
 
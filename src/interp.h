@@ -30,7 +30,14 @@
 
 #include "kiss_fft.h"
 
+/* most frames interp_energies() interpolates at once */
+
+#define INTERP_MAX_FRAMES 4
+
 void interpolate(MODEL *interp, MODEL *prev, MODEL *next);
+void interp_log_amps(const MODEL *model, float logA[]);
+void interpolate_log_amps(MODEL *interp, const MODEL *prev, const float prev_logA[],
+			  const MODEL *next, const float next_logA[], float weight);
 void interpolate_lsp(kiss_fft_cfg  fft_dec_cfg,
 		     MODEL *interp, MODEL *prev, MODEL *next,
 		     float *prev_lsps, float  prev_e,
@@ -40,6 +47,7 @@ void interp_Wo(MODEL *interp, MODEL *prev, MODEL *next);
 void interp_Wo2(MODEL *interp, MODEL *prev, MODEL *next, float weight);
 float interp_energy(float prev, float next);
 float interp_energy2(float prev, float next, float weight);
+void interp_energies(float e[], float prev, float next, int n);
 void interpolate_lsp_ver2(float interp[], float prev[],  float next[], float weight, int order);
 
 #endif
@@ -14,6 +14,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 
 #include "_kiss_fft_guts.h"
+#include "machdep.h"
 /* The guts header contains all the multiplication and addition macros that are defined for
  fixed or floating point complex numbers.  It also delares the kf_ internal functions.
  */
@@ -89,6 +90,297 @@ static void kf_bfly4(
     }while(--k);
 }
 
+/*
+   SIMD versions of kf_bfly4() and kf_bfly2(), for the float build.
+   They run the butterflies of several consecutive k at once, two
+   complex values per 128 bit vector, four per AVX2 vector, using the
+   arithmetic of the scalar macros (no FP contraction, the complex
+   multiply as C_MUL()), so results are bit exact with the scalar
+   versions.  Selected at run time by kiss_fft_select_kernels().
+*/
+
+#if !defined(USE_SIMD) && !defined(FIXED_POINT) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define KF_X86
+#include <immintrin.h>
+#define KF_SSE2 __attribute__((target("sse2")))
+#define KF_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if !defined(USE_SIMD) && !defined(FIXED_POINT) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define KF_NEON
+#include <arm_neon.h>
+#endif
+
+#define KF_KERNEL_SCALAR 0
+#define KF_KERNEL_SSE2   1
+#define KF_KERNEL_AVX2   2
+#define KF_KERNEL_NEON   3
+
+#if defined(KF_X86) || defined(KF_NEON)
+static int kf_kernel = KF_KERNEL_SCALAR;
+#endif
+
+#ifdef KF_X86
+
+/* complex values k and k+1 of a table with the given stride */
+
+static inline KF_SSE2 __m128 kf_load2_sse2(const kiss_fft_cpx *p, size_t stride)
+{
+    if (stride == 1)
+        return _mm_loadu_ps(&p->r);
+    return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)p),
+                        (const __m64 *)(p + stride));
+}
+
+/* C_MUL(): r = a.r*b.r - a.i*b.i, i = a.i*b.r + a.r*b.i */
+
+static inline KF_SSE2 __m128 kf_cmul_sse2(__m128 a, __m128 b)
+{
+    const __m128 neg_r = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    __m128 br = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2,2,0,0));
+    __m128 bi = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3,3,1,1));
+    __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1));
+
+    return _mm_add_ps(_mm_mul_ps(a, br), _mm_xor_ps(_mm_mul_ps(as, bi), neg_r));
+}
+
+/* butterflies k0, k0+2, .. m-1 of kf_bfly4() */
+
+static inline KF_SSE2 void kf_bfly4_sse2_from(kiss_fft_cpx *Fout, const size_t fstride,
+                                              const kiss_fft_cfg st, const size_t m, size_t k)
+{
+    const __m128 neg_i = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    const kiss_fft_cpx *tw = st->twiddles;
+    __m128 f0, f1, f2, f3, s0, s1, s2, s3, s4, s5, u;
+
+    for (; k<m; k+=2) {
+        f0 = _mm_loadu_ps(&Fout[k].r);
+        f1 = _mm_loadu_ps(&Fout[k+m].r);
+        f2 = _mm_loadu_ps(&Fout[k+2*m].r);
+        f3 = _mm_loadu_ps(&Fout[k+3*m].r);
+
+        s0 = kf_cmul_sse2(f1, kf_load2_sse2(&tw[k*fstride], fstride));
+        s1 = kf_cmul_sse2(f2, kf_load2_sse2(&tw[2*k*fstride], 2*fstride));
+        s2 = kf_cmul_sse2(f3, kf_load2_sse2(&tw[3*k*fstride], 3*fstride));
+
+        s5 = _mm_sub_ps(f0, s1);
+        f0 = _mm_add_ps(f0, s1);
+        s3 = _mm_add_ps(s0, s2);
+        s4 = _mm_sub_ps(s0, s2);
+        _mm_storeu_ps(&Fout[k+2*m].r, _mm_sub_ps(f0, s3));
+        _mm_storeu_ps(&Fout[k].r, _mm_add_ps(f0, s3));
+
+        /* (s4.i, -s4.r) */
+        u = _mm_xor_ps(_mm_shuffle_ps(s4, s4, _MM_SHUFFLE(2,3,0,1)), neg_i);
+        if (st->inverse) {
+            _mm_storeu_ps(&Fout[k+m].r, _mm_sub_ps(s5, u));
+            _mm_storeu_ps(&Fout[k+3*m].r, _mm_add_ps(s5, u));
+        } else {
+            _mm_storeu_ps(&Fout[k+m].r, _mm_add_ps(s5, u));
+            _mm_storeu_ps(&Fout[k+3*m].r, _mm_sub_ps(s5, u));
+        }
+    }
+}
+
+static KF_SSE2 void kf_bfly4_sse2(kiss_fft_cpx *Fout, const size_t fstride,
+                                  const kiss_fft_cfg st, const size_t m)
+{
+    kf_bfly4_sse2_from(Fout, fstride, st, m, 0);
+}
+
+static KF_SSE2 void kf_bfly2_sse2(kiss_fft_cpx *Fout, const size_t fstride,
+                                  const kiss_fft_cfg st, int m)
+{
+    const kiss_fft_cpx *tw = st->twiddles;
+    __m128 f0, t;
+    int k;
+
+    for (k=0; k<m; k+=2) {
+        t = kf_cmul_sse2(_mm_loadu_ps(&Fout[k+m].r), kf_load2_sse2(&tw[k*fstride], fstride));
+        f0 = _mm_loadu_ps(&Fout[k].r);
+        _mm_storeu_ps(&Fout[k+m].r, _mm_sub_ps(f0, t));
+        _mm_storeu_ps(&Fout[k].r, _mm_add_ps(f0, t));
+    }
+}
+
+static inline KF_AVX2 __m256 kf_load4_avx2(const kiss_fft_cpx *p, size_t stride)
+{
+    __m128 lo, hi;
+
+    if (stride == 1)
+        return _mm256_loadu_ps(&p->r);
+    lo = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)p),
+                      (const __m64 *)(p + stride));
+    hi = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(p + 2*stride)),
+                      (const __m64 *)(p + 3*stride));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+static inline KF_AVX2 __m256 kf_cmul_avx2(__m256 a, __m256 b)
+{
+    const __m256 neg_r = _mm256_set_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f);
+    __m256 br = _mm256_shuffle_ps(b, b, _MM_SHUFFLE(2,2,0,0));
+    __m256 bi = _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3,3,1,1));
+    __m256 as = _mm256_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1));
+
+    return _mm256_add_ps(_mm256_mul_ps(a, br), _mm256_xor_ps(_mm256_mul_ps(as, bi), neg_r));
+}
+
+static KF_AVX2 void kf_bfly4_avx2(kiss_fft_cpx *Fout, const size_t fstride,
+                                  const kiss_fft_cfg st, const size_t m)
+{
+    const __m256 neg_i = _mm256_set_ps(-0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f);
+    const kiss_fft_cpx *tw = st->twiddles;
+    __m256 f0, f1, f2, f3, s0, s1, s2, s3, s4, s5, u;
+    size_t k;
+
+    for (k=0; k+4<=m; k+=4) {
+        f0 = _mm256_loadu_ps(&Fout[k].r);
+        f1 = _mm256_loadu_ps(&Fout[k+m].r);
+        f2 = _mm256_loadu_ps(&Fout[k+2*m].r);
+        f3 = _mm256_loadu_ps(&Fout[k+3*m].r);
+
+        s0 = kf_cmul_avx2(f1, kf_load4_avx2(&tw[k*fstride], fstride));
+        s1 = kf_cmul_avx2(f2, kf_load4_avx2(&tw[2*k*fstride], 2*fstride));
+        s2 = kf_cmul_avx2(f3, kf_load4_avx2(&tw[3*k*fstride], 3*fstride));
+
+        s5 = _mm256_sub_ps(f0, s1);
+        f0 = _mm256_add_ps(f0, s1);
+        s3 = _mm256_add_ps(s0, s2);
+        s4 = _mm256_sub_ps(s0, s2);
+        _mm256_storeu_ps(&Fout[k+2*m].r, _mm256_sub_ps(f0, s3));
+        _mm256_storeu_ps(&Fout[k].r, _mm256_add_ps(f0, s3));
+
+        u = _mm256_xor_ps(_mm256_shuffle_ps(s4, s4, _MM_SHUFFLE(2,3,0,1)), neg_i);
+        if (st->inverse) {
+            _mm256_storeu_ps(&Fout[k+m].r, _mm256_sub_ps(s5, u));
+            _mm256_storeu_ps(&Fout[k+3*m].r, _mm256_add_ps(s5, u));
+        } else {
+            _mm256_storeu_ps(&Fout[k+m].r, _mm256_add_ps(s5, u));
+            _mm256_storeu_ps(&Fout[k+3*m].r, _mm256_sub_ps(s5, u));
+        }
+    }
+
+    /* m = 2 stages, or the last pair */
+
+    kf_bfly4_sse2_from(Fout, fstride, st, m, k);
+}
+
+#endif /* KF_X86 */
+
+#ifdef KF_NEON
+
+static inline float32x4_t kf_load2_neon(const kiss_fft_cpx *p, size_t stride)
+{
+    return vcombine_f32(vld1_f32(&p->r), vld1_f32(&p[stride].r));
+}
+
+static inline float32x4_t kf_cmul_neon(float32x4_t a, float32x4_t b)
+{
+    const uint32_t neg[4] = {0x80000000, 0, 0x80000000, 0};
+    float32x4x2_t bt = vtrnq_f32(b, b);      /* (br,br), (bi,bi) */
+    float32x4_t   as = vrev64q_f32(a);       /* (ai,ar)          */
+    float32x4_t   t  = vmulq_f32(as, bt.val[1]);
+
+    t = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(t), vld1q_u32(neg)));
+    return vaddq_f32(vmulq_f32(a, bt.val[0]), t);
+}
+
+static void kf_bfly4_neon(kiss_fft_cpx *Fout, const size_t fstride,
+                          const kiss_fft_cfg st, const size_t m)
+{
+    const uint32_t neg[4] = {0, 0x80000000, 0, 0x80000000};
+    const kiss_fft_cpx *tw = st->twiddles;
+    float32x4_t f0, f1, f2, f3, s0, s1, s2, s3, s4, s5, u;
+    size_t k;
+
+    for (k=0; k<m; k+=2) {
+        f0 = vld1q_f32(&Fout[k].r);
+        f1 = vld1q_f32(&Fout[k+m].r);
+        f2 = vld1q_f32(&Fout[k+2*m].r);
+        f3 = vld1q_f32(&Fout[k+3*m].r);
+
+        s0 = kf_cmul_neon(f1, kf_load2_neon(&tw[k*fstride], fstride));
+        s1 = kf_cmul_neon(f2, kf_load2_neon(&tw[2*k*fstride], 2*fstride));
+        s2 = kf_cmul_neon(f3, kf_load2_neon(&tw[3*k*fstride], 3*fstride));
+
+        s5 = vsubq_f32(f0, s1);
+        f0 = vaddq_f32(f0, s1);
+        s3 = vaddq_f32(s0, s2);
+        s4 = vsubq_f32(s0, s2);
+        vst1q_f32(&Fout[k+2*m].r, vsubq_f32(f0, s3));
+        vst1q_f32(&Fout[k].r, vaddq_f32(f0, s3));
+
+        u = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vrev64q_f32(s4)), vld1q_u32(neg)));
+        if (st->inverse) {
+            vst1q_f32(&Fout[k+m].r, vsubq_f32(s5, u));
+            vst1q_f32(&Fout[k+3*m].r, vaddq_f32(s5, u));
+        } else {
+            vst1q_f32(&Fout[k+m].r, vaddq_f32(s5, u));
+            vst1q_f32(&Fout[k+3*m].r, vsubq_f32(s5, u));
+        }
+    }
+}
+
+static void kf_bfly2_neon(kiss_fft_cpx *Fout, const size_t fstride,
+                          const kiss_fft_cfg st, int m)
+{
+    const kiss_fft_cpx *tw = st->twiddles;
+    float32x4_t f0, t;
+    int k;
+
+    for (k=0; k<m; k+=2) {
+        t = kf_cmul_neon(vld1q_f32(&Fout[k+m].r), kf_load2_neon(&tw[k*fstride], fstride));
+        f0 = vld1q_f32(&Fout[k].r);
+        vst1q_f32(&Fout[k+m].r, vsubq_f32(f0, t));
+        vst1q_f32(&Fout[k].r, vaddq_f32(f0, t));
+    }
+}
+
+#endif /* KF_NEON */
+
+/* the selected kf_bfly2()/kf_bfly4(), the SIMD ones need an even m */
+
+static void kf_bfly2_sel(kiss_fft_cpx *Fout, const size_t fstride, const kiss_fft_cfg st, int m)
+{
+#ifdef KF_X86
+    if ((kf_kernel != KF_KERNEL_SCALAR) && ((m & 1) == 0)) {
+        kf_bfly2_sse2(Fout, fstride, st, m);
+        return;
+    }
+#endif
+#ifdef KF_NEON
+    if ((kf_kernel == KF_KERNEL_NEON) && ((m & 1) == 0)) {
+        kf_bfly2_neon(Fout, fstride, st, m);
+        return;
+    }
+#endif
+    kf_bfly2(Fout, fstride, st, m);
+}
+
+static void kf_bfly4_sel(kiss_fft_cpx *Fout, const size_t fstride, const kiss_fft_cfg st, size_t m)
+{
+    if ((m & 1) == 0) {
+#ifdef KF_X86
+        if (kf_kernel == KF_KERNEL_AVX2) {
+            kf_bfly4_avx2(Fout, fstride, st, m);
+            return;
+        }
+        if (kf_kernel == KF_KERNEL_SSE2) {
+            kf_bfly4_sse2(Fout, fstride, st, m);
+            return;
+        }
+#endif
+#ifdef KF_NEON
+        if (kf_kernel == KF_KERNEL_NEON) {
+            kf_bfly4_neon(Fout, fstride, st, m);
+            return;
+        }
+#endif
+    }
+    kf_bfly4(Fout, fstride, st, m);
+}
+
 static void kf_bfly3(
          kiss_fft_cpx * Fout,
          const size_t fstride,
@@ -263,9 +555,9 @@ void kf_work(
         // all threads have joined by this point
 
         switch (p) {
-            case 2: kf_bfly2(Fout,fstride,st,m); break;
+            case 2: kf_bfly2_sel(Fout,fstride,st,m); break;
             case 3: kf_bfly3(Fout,fstride,st,m); break;
-            case 4: kf_bfly4(Fout,fstride,st,m); break;
+            case 4: kf_bfly4_sel(Fout,fstride,st,m); break;
             case 5: kf_bfly5(Fout,fstride,st,m); break;
             default: kf_bfly_generic(Fout,fstride,st,m,p); break;
         }
@@ -293,14 +585,103 @@ void kf_work(
 
     // recombine the p smaller DFTs
     switch (p) {
-        case 2: kf_bfly2(Fout,fstride,st,m); break;
+        case 2: kf_bfly2_sel(Fout,fstride,st,m); break;
         case 3: kf_bfly3(Fout,fstride,st,m); break;
-        case 4: kf_bfly4(Fout,fstride,st,m); break;
+        case 4: kf_bfly4_sel(Fout,fstride,st,m); break;
         case 5: kf_bfly5(Fout,fstride,st,m); break;
         default: kf_bfly_generic(Fout,fstride,st,m,p); break;
     }
 }
 
+/*
+   Fixed size plans for the 256 and 512 point transforms (the complex
+   FFTs inside the 512 point real FFTs, and FFT_ENC itself).  Rather
+   than recursing through kf_work(), the input is gathered once through
+   a precomputed digit reversal table, then the radix 4 (and last
+   radix 2) stages run in place over the whole output with their
+   sizes and strides fixed at compile time.  Each butterfly sees the
+   same data and twiddles as in kf_work(), so the result is identical.
+*/
+
+#define KF_PLAN_MAX 512
+
+static int kf_plan_size(int nfft)
+{
+    return (nfft == 256) || (nfft == 512);
+}
+
+/* where kf_work()'s m == 1 leaves read each output from */
+
+static void kf_plan_perm(unsigned short *perm, int in, int fstride, const int *factors)
+{
+    const int p = factors[0];
+    const int m = factors[1];
+    int k;
+
+    for (k=0; k<p; ++k) {
+        if (m == 1)
+            perm[k] = in + k*fstride;
+        else
+            kf_plan_perm(perm + k*m, in + k*fstride, fstride*p, factors+2);
+    }
+}
+
+#define KF_PLAN_STAGE(p, m, nfft) \
+    for (b=0; b<(nfft); b+=(p)*(m)) \
+        kf_bfly##p##_sel(Fout+b, (nfft)/((p)*(m)), st, (m))
+
+static void kf_work_256(kiss_fft_cpx *Fout, const kiss_fft_cpx *f, int in_stride, const kiss_fft_cfg st)
+{
+    const unsigned short *perm = KF_PERM(st);
+    int i, b;
+
+    for (i=0; i<256; ++i)
+        Fout[i] = f[perm[i]*in_stride];
+    KF_PLAN_STAGE(4, 1, 256);
+    KF_PLAN_STAGE(4, 4, 256);
+    KF_PLAN_STAGE(4, 16, 256);
+    KF_PLAN_STAGE(4, 64, 256);
+}
+
+static void kf_work_512(kiss_fft_cpx *Fout, const kiss_fft_cpx *f, int in_stride, const kiss_fft_cfg st)
+{
+    const unsigned short *perm = KF_PERM(st);
+    int i, b;
+
+    for (i=0; i<512; ++i)
+        Fout[i] = f[perm[i]*in_stride];
+    KF_PLAN_STAGE(2, 1, 512);
+    KF_PLAN_STAGE(4, 2, 512);
+    KF_PLAN_STAGE(4, 8, 512);
+    KF_PLAN_STAGE(4, 32, 512);
+    KF_PLAN_STAGE(4, 128, 512);
+}
+
+static void kf_work_plan(kiss_fft_cpx *Fout, const kiss_fft_cpx *f, int in_stride, const kiss_fft_cfg st)
+{
+    if (st->nfft == 256)
+        kf_work_256(Fout, f, in_stride, st);
+    else
+        kf_work_512(Fout, f, in_stride, st);
+}
+
+/* In place, the gather needs a copy of the input, the stages then run
+   in place.  Kept out of line so the copy is only on the stack when
+   it is used. */
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((noinline))
+#endif
+static void kf_work_plan_inplace(kiss_fft_cpx *Fout, int in_stride, const kiss_fft_cfg st)
+{
+    kiss_fft_cpx fcopy[KF_PLAN_MAX];
+    int i;
+
+    for (i=0; i<st->nfft; ++i)
+        fcopy[i] = Fout[i*in_stride];
+    kf_work_plan(Fout, fcopy, 1, st);
+}
+
 /*  facbuf is populated by p1,m1,p2,m2, ...
     where
     p[i] * m[i] = m[i-1]
@@ -329,6 +710,26 @@ void kf_factor(int n,int * facbuf)
     } while (n > 1);
 }
 
+#ifdef CODEC2_CMSIS_DSP
+/* CMSIS-DSP has precomputed radix 4/8 plans for the power of two sizes,
+   which use the M4's dual MACs.  Other sizes stay with kiss_fft. */
+static const arm_cfft_instance_f32 *arm_cfft_plan(int nfft)
+{
+    switch (nfft) {
+    case 16:   return &arm_cfft_sR_f32_len16;
+    case 32:   return &arm_cfft_sR_f32_len32;
+    case 64:   return &arm_cfft_sR_f32_len64;
+    case 128:  return &arm_cfft_sR_f32_len128;
+    case 256:  return &arm_cfft_sR_f32_len256;
+    case 512:  return &arm_cfft_sR_f32_len512;
+    case 1024: return &arm_cfft_sR_f32_len1024;
+    case 2048: return &arm_cfft_sR_f32_len2048;
+    case 4096: return &arm_cfft_sR_f32_len4096;
+    default:   return NULL;
+    }
+}
+#endif
+
 /*
  *
  * User-callable function to allocate all necessary storage space for the fft.
@@ -342,6 +743,9 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
     size_t memneeded = sizeof(struct kiss_fft_state)
         + sizeof(kiss_fft_cpx)*(nfft-1); /* twiddle factors*/
 
+    if (kf_plan_size(nfft))
+        memneeded += sizeof(unsigned short)*nfft; /* digit reversal */
+
     if ( lenmem==NULL ) {
         st = ( kiss_fft_cfg)KISS_FFT_MALLOC( memneeded );
     }else{
@@ -363,6 +767,12 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
         }
 
         kf_factor(nfft,st->factors);
+        st->plan = kf_plan_size(nfft);
+        if (st->plan)
+            kf_plan_perm(KF_PERM(st), 0, 1, st->factors);
+#ifdef CODEC2_CMSIS_DSP
+        st->arm_cfg = arm_cfft_plan(nfft);
+#endif
     }
     return st;
 }
@@ -371,13 +781,34 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
 void kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int in_stride)
 {
 	
+#ifdef CODEC2_CMSIS_DSP
+    if (st->arm_cfg != NULL && in_stride == 1) {
+        /* arm_cfft_f32() works in place and scales the inverse by
+           1/nfft, kiss_fft() doesn't scale */
+        if (fin != fout)
+            memcpy(fout,fin,sizeof(kiss_fft_cpx)*st->nfft);
+        arm_cfft_f32(st->arm_cfg,(float32_t *)fout,st->inverse,1);
+        if (st->inverse)
+            arm_scale_f32((float32_t *)fout,(float32_t)st->nfft,(float32_t *)fout,2*st->nfft);
+        return;
+    }
+#endif
+
     if (fin == fout) {
         //NOTE: this is not really an in-place FFT algorithm.
         //It just performs an out-of-place FFT into a temp buffer
-        kiss_fft_cpx * tmpbuf = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC( sizeof(kiss_fft_cpx)*st->nfft);
+        kiss_fft_cpx * tmpbuf;
+
+        if (st->plan) {
+            kf_work_plan_inplace(fout, in_stride, st);
+            return;
+        }
+        tmpbuf = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC( sizeof(kiss_fft_cpx)*st->nfft);
         kf_work(tmpbuf,fin,1,in_stride, st->factors,st);
         memcpy(fout,tmpbuf,sizeof(kiss_fft_cpx)*st->nfft);
         KISS_FFT_TMP_FREE(tmpbuf);
+    }else if (st->plan){
+        kf_work_plan( fout, fin, in_stride, st );
     }else{
         kf_work( fout, fin, 1,in_stride, st->factors,st );
     }
@@ -391,6 +822,39 @@ void kiss_fft(kiss_fft_cfg cfg, const kiss_fft_cpx* fin, kiss_fft_cpx* fout)
 
 }
 
+#ifndef USE_SIMD
+
+/*
+ * Picks the butterfly variant for the MACHDEP_CPU_* features given.
+ * Until called, the scalar butterflies run.
+ */
+void kiss_fft_select_kernels(int features)
+{
+#ifdef KF_X86
+    if (features & MACHDEP_CPU_AVX2)
+        kf_kernel = KF_KERNEL_AVX2;
+    else if (features & MACHDEP_CPU_SSE2)
+        kf_kernel = KF_KERNEL_SSE2;
+    else
+        kf_kernel = KF_KERNEL_SCALAR;
+#elif defined(KF_NEON)
+    kf_kernel = (features & MACHDEP_CPU_NEON) ? KF_KERNEL_NEON : KF_KERNEL_SCALAR;
+#else
+    (void)features;
+#endif
+}
+
+const char *kiss_fft_kernel_name(void)
+{
+#if defined(KF_X86) || defined(KF_NEON)
+    static const char *names[] = {"scalar", "sse2", "avx2", "neon"};
+    return names[kf_kernel];
+#else
+    return "scalar";
+#endif
+}
+
+#endif
 
 void kiss_fft_cleanup(void)
 {
@@ -108,6 +108,14 @@ void kiss_fft_stride(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout
 */
 void kiss_fft_cleanup(void);
 
+/*
+ * Selects the SIMD butterflies for the machdep_cpu_features() given,
+ * and names the variant in use ("scalar", "sse2", "avx2" or "neon").
+ * The variants give bit identical results.
+ */
+void kiss_fft_select_kernels(int features);
+const char *kiss_fft_kernel_name(void);
+
 
 /*
  * Returns the smallest integer k, such that k>=n and k has only "fast" factors (2,3,5)
@@ -0,0 +1,122 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: kiss_fft4.c
+  DATE CREATED: Oct 2026
+
+  Four lane real FFT, see kiss_fft4.h.  The complex FFT is kiss_fft.c
+  itself, compiled again here with kiss_fft_scalar an __m128 and its
+  entry points renamed.  The real FFT split is kiss_fftr() operation
+  for operation.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "kiss_fft4.h"
+
+#ifdef KISS_FFT4
+
+#define USE_SIMD
+#define kiss_fft_alloc          kiss_fft4_alloc
+#define kiss_fft_stride         kiss_fft4_stride
+#define kiss_fft                kiss_fft4
+#define kiss_fft_cleanup        kiss_fft4_cleanup
+#define kiss_fft_next_fast_size kiss_fft4_next_fast_size
+
+#include "kiss_fft.c"
+
+#define KISS_FFTR4_STACK_CPX 512
+
+struct kiss_fftr4_state {
+    kiss_fft_cfg   substate;
+    kiss_fft_cpx  *super_twiddles;
+};
+
+kiss_fftr4_cfg kiss_fftr4_alloc(int nfft)
+{
+    kiss_fftr4_cfg st;
+    int            i;
+
+    if ((nfft & 1) || (nfft/2 > KISS_FFTR4_STACK_CPX))
+	return NULL;
+    nfft >>= 1;
+
+    st = (kiss_fftr4_cfg)malloc(sizeof(struct kiss_fftr4_state));
+    if (st == NULL)
+	return NULL;
+    st->substate = kiss_fft4_alloc(nfft, 0, NULL, NULL);
+    st->super_twiddles = (kiss_fft_cpx*)KISS_FFT_MALLOC(sizeof(kiss_fft_cpx)*(nfft/2));
+    if ((st->substate == NULL) || (st->super_twiddles == NULL)) {
+	kiss_fftr4_free(st);
+	return NULL;
+    }
+
+    for (i = 0; i < nfft/2; ++i) {
+        float phase =
+            -3.14159265358979323846264338327 * ((float) (i+1) / nfft + .5);
+        kf_cexp (st->super_twiddles+i,phase);
+    }
+
+    return st;
+}
+
+void kiss_fftr4_free(kiss_fftr4_cfg st)
+{
+    if (st == NULL)
+	return;
+    if (st->substate != NULL)
+	KISS_FFT_FREE(st->substate);
+    if (st->super_twiddles != NULL)
+	KISS_FFT_FREE(st->super_twiddles);
+    free(st);
+}
+
+void kiss_fftr4(kiss_fftr4_cfg st, const float timedata[], float freqdata[])
+{
+    int k,ncfft;
+    kiss_fft_cpx fpnk,fpk,f1k,f2k,tw,tdc;
+    kiss_fft_cpx tmpbuf[KISS_FFTR4_STACK_CPX];
+    kiss_fft_cpx *out = (kiss_fft_cpx *)freqdata;
+
+    ncfft = st->substate->nfft;
+
+    /* pairs of real samples packed as real,imag, as in kiss_fftr() */
+
+    kiss_fft4(st->substate, (const kiss_fft_cpx *)timedata, tmpbuf);
+
+    tdc.r = tmpbuf[0].r;
+    tdc.i = tmpbuf[0].i;
+    out[0].r = tdc.r + tdc.i;
+    out[ncfft].r = tdc.r - tdc.i;
+    out[ncfft].i = out[0].i = _mm_set1_ps(0);
+
+    for ( k=1;k <= ncfft/2 ; ++k ) {
+        fpk    = tmpbuf[k];
+        fpnk.r =   tmpbuf[ncfft-k].r;
+        fpnk.i = - tmpbuf[ncfft-k].i;
+
+        C_ADD( f1k, fpk , fpnk );
+        C_SUB( f2k, fpk , fpnk );
+        C_MUL( tw , f2k , st->super_twiddles[k-1]);
+
+        out[k].r = HALF_OF(f1k.r + tw.r);
+        out[k].i = HALF_OF(f1k.i + tw.i);
+        out[ncfft-k].r = HALF_OF(f1k.r - tw.r);
+        out[ncfft-k].i = HALF_OF(tw.i - f1k.i);
+    }
+}
+
+#endif
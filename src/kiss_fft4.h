@@ -0,0 +1,56 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: kiss_fft4.h
+  DATE CREATED: Oct 2026
+
+  Four independent real FFTs at once, one per SSE lane.  kiss_fft.c
+  built with its USE_SIMD option, so each lane gets exactly the
+  arithmetic of kiss_fftr() and the same result.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __KISS_FFT4__
+#define __KISS_FFT4__
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE__) && !defined(CODEC2_CMSIS_DSP)
+#define KISS_FFT4
+#endif
+
+#ifdef KISS_FFT4
+
+#define KISS_FFT4_LANES 4
+
+typedef struct kiss_fftr4_state *kiss_fftr4_cfg;
+
+/* nfft real points, forward only */
+
+kiss_fftr4_cfg kiss_fftr4_alloc(int nfft);
+void kiss_fftr4_free(kiss_fftr4_cfg cfg);
+
+/*
+  timedata[] is nfft samples of 4 lanes, sample i of lane l at
+  [4*i+l].  freqdata[] gets bins 0..nfft/2, the real parts of bin k's
+  lanes at [8*k..8*k+3] and the imaginary parts at [8*k+4..8*k+7].
+  Both 16 byte aligned.
+*/
+
+void kiss_fftr4(kiss_fftr4_cfg cfg, const float timedata[], float freqdata[]);
+
+#endif
+
+#endif
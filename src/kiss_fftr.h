@@ -0,0 +1,55 @@
+#ifndef KISS_FTR_H
+#define KISS_FTR_H
+
+#include "kiss_fft.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+
+ Real optimized version can save about 45% cpu time vs. complex fft of a real seq.
+
+
+
+ */
+
+typedef struct kiss_fftr_state *kiss_fftr_cfg;
+
+
+kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem, size_t * lenmem);
+/*
+ nfft must be even
+
+ If you don't care to allocate space, use mem = lenmem = NULL
+*/
+
+
+void kiss_fftr(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata);
+/*
+ input timedata has nfft scalar points
+ output freqdata has nfft/2+1 complex points
+*/
+
+void kiss_fftri(kiss_fftr_cfg cfg,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata);
+/*
+ input freqdata has  nfft/2+1 complex points
+ output timedata has nfft scalar points
+*/
+
+/*
+ For running a forward transform's arithmetic elsewhere, e.g. on an
+ OpenCL device: the complex FFT's twiddles, the real split's
+ super_twiddles and the digit reversal table of its fixed plan.
+ Returns the complex FFT size, nfft/2, or 0 if it has no plan.
+*/
+int kiss_fftr_tables(kiss_fftr_cfg cfg, const kiss_fft_cpx **twiddles,
+                     const kiss_fft_cpx **super_twiddles, const unsigned short **perm);
+
+#define kiss_fftr_free free
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -35,6 +35,10 @@
 #include <math.h>
 #include "defines.h"
 #include "lpc.h"
+#include "machdep.h"
+#ifdef CODEC2_CMSIS_DSP
+#include "arm_math.h"
+#endif
 
 /*---------------------------------------------------------------------------*\
 
@@ -196,8 +200,15 @@ void levinson_durbin(
 
   The filter memory is stored in the first order samples of the input array.
 
+  With CODEC2_CMSIS_DSP each output is one arm_dot_prod_f32() of the
+  input against the reversed coefficients.  arm_fir_f32() would need
+  the history copied into its own state buffer on every call, here it
+  is already in place in Sn[].
+
 \*---------------------------------------------------------------------------*/
 
+#define INVERSE_FILTER_MAX_ORDER 127
+
 void inverse_filter(
   float Sn[],	/* Nsam input samples */
   float a[],	/* LPCs for this frame of samples */
@@ -208,11 +219,385 @@ void inverse_filter(
 {
   int i,j;	/* loop variables */
 
+#ifdef CODEC2_CMSIS_DSP
+  float32_t ar[INVERSE_FILTER_MAX_ORDER+1];
+
+  assert(order <= INVERSE_FILTER_MAX_ORDER);
+  for(j=0; j<=order; j++)
+    ar[j] = a[order-j];
+  for(i=0; i<Nsam; i++)
+    arm_dot_prod_f32(&Sn[i-order], ar, order+1, &res[i]);
+#else
   for(i=0; i<Nsam; i++) {
     res[i] = 0.0;
     for(j=0; j<=order; j++)
       res[i] += Sn[i-j]*a[j];
   }
+#endif
+}
+
+/* bpf_filter() runs on blocks of up to BPF_BLOCK outputs.  For each
+   tap the loop over the block's outputs vectorises, and each output
+   still sums its taps in order.  The loop is built again for AVX2 on
+   x86, chosen at run time by bpf_select_kernels(). */
+
+#define BPF_BLOCK    80
+#define BPF_MAX_TAPS (INVERSE_FILTER_MAX_ORDER+1)
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(CODEC2_CMSIS_DSP)
+#define LPC_X86
+#define LPC_AVX2 __attribute__((target("avx2")))
+#endif
+
+/* the default build vectorises for the baseline instruction set */
+
+#if defined(CODEC2_CMSIS_DSP)
+#define BPF_DEFAULT_NAME "cmsis"
+#elif defined(__SSE2__)
+#define BPF_DEFAULT_NAME "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BPF_DEFAULT_NAME "neon"
+#else
+#define BPF_DEFAULT_NAME "scalar"
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LPC_INLINE inline __attribute__((always_inline))
+#else
+#define LPC_INLINE inline
+#endif
+
+/* out[r] = sum over j of x[r-j]*h[j], r = 0 .. nout-1 */
+
+static LPC_INLINE void bpf_block_impl(const float x[], const float h[], int ntap, short out[], int nout)
+{
+    float acc[BPF_BLOCK];
+    int   j, r;
+
+#ifdef CODEC2_CMSIS_DSP
+    float32_t hr[BPF_MAX_TAPS];
+
+    for(j=0; j<ntap; j++)
+	hr[j] = h[ntap-1-j];
+    for(r=0; r<nout; r++)
+	arm_dot_prod_f32((float32_t *)&x[r-(ntap-1)], hr, ntap, &acc[r]);
+#else
+    const float *p;
+    float c;
+
+    for(r=0; r<nout; r++)
+	acc[r] = 0.0;
+    for(j=0; j<ntap; j++) {
+	p = &x[-j];
+	c = h[j];
+	for(r=0; r<nout; r++)
+	    acc[r] += p[r]*c;
+    }
+#endif
+    for(r=0; r<nout; r++)
+	out[r] = (short)(int)acc[r];
+}
+
+static void bpf_block_default(const float x[], const float h[], int ntap, short out[], int nout)
+{
+    bpf_block_impl(x, h, ntap, out, nout);
+}
+
+#ifdef LPC_X86
+static LPC_AVX2 void bpf_block_avx2(const float x[], const float h[], int ntap, short out[], int nout)
+{
+    bpf_block_impl(x, h, ntap, out, nout);
+}
+#endif
+
+static void (*bpf_block_fn)(const float x[], const float h[], int ntap, short out[], int nout) = bpf_block_default;
+static const char *bpf_block_name = BPF_DEFAULT_NAME;
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: bpf_select_kernels
+  DATE CREATED: Oct 2026
+
+  Picks the bpf_filter() variant for the machdep_cpu_features() given.
+  The variants give bit identical results.
+
+\*---------------------------------------------------------------------------*/
+
+void bpf_select_kernels(int features)
+{
+    bpf_block_fn = bpf_block_default;
+    bpf_block_name = BPF_DEFAULT_NAME;
+#ifdef LPC_X86
+    if (features & MACHDEP_CPU_AVX2) {
+	bpf_block_fn = bpf_block_avx2;
+	bpf_block_name = "avx2";
+    }
+#else
+    (void)features;
+#endif
+}
+
+const char *bpf_kernel_name(void)
+{
+    return bpf_block_name;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: bpf_filter
+  DATE CREATED: Oct 2026
+
+  ntap FIR filter h[] of the n speech samples in[], to n samples
+  out[], for the 700 and 700B band pass filters.  buf[] holds the
+  filter memory, the last ntap-1 input samples, followed by room for n
+  more: the input is converted straight into it and the memory moved
+  down afterwards.  The outputs are those of inverse_filter() over the
+  same samples, converted to short.  bpf_filter_float() is the same
+  for float input, scaled by gain.
+
+\*---------------------------------------------------------------------------*/
+
+static void bpf_run(float buf[], const float h[], int ntap, short out[], int n)
+{
+    float *x = &buf[ntap-1];
+    int    i, nb;
+
+    for(i=0; i<n; i+=nb) {
+	nb = (n-i < BPF_BLOCK) ? n-i : BPF_BLOCK;
+	bpf_block_fn(&x[i], h, ntap, &out[i], nb);
+    }
+    for(i=0; i<ntap-1; i++)
+	buf[i] = buf[n+i];
+}
+
+void bpf_filter(float buf[], const float h[], int ntap, const short in[], short out[], int n)
+{
+    float *x = &buf[ntap-1];
+    int    i;
+
+    assert((ntap >= 1) && (ntap <= BPF_MAX_TAPS));
+
+    for(i=0; i<n; i++)
+	x[i] = in[i];
+    bpf_run(buf, h, ntap, out, n);
+}
+
+void bpf_filter_float(float buf[], const float h[], int ntap, const float in[], float gain, short out[], int n)
+{
+    float *x = &buf[ntap-1];
+    int    i;
+
+    assert((ntap >= 1) && (ntap <= BPF_MAX_TAPS));
+
+    for(i=0; i<n; i++)
+	x[i] = gain*in[i];
+    bpf_run(buf, h, ntap, out, n);
+}
+
+/* window_autocorrelate() windows the speech into Wr[] in reverse
+   order, so for each sample x[i] the LPC_AC_LAGS products x[i-j]*x[i],
+   j = 0, 1, ..., are contiguous and one pass over the speech
+   accumulates all of the lags in vector registers.  Each lag still sums
+   its products in order of i with separate multiplies and adds, as
+   autocorrelate() does, so the results are bit identical to windowing
+   then autocorrelate().  Built again for AVX2 on x86, chosen at run
+   time by lpc_select_kernels(). */
+
+#if defined(__SSE2__)
+#define LPC_SSE2
+#include <emmintrin.h>
+#define LPC_AC_DEFAULT_NAME "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LPC_NEON
+#include <arm_neon.h>
+#define LPC_AC_DEFAULT_NAME "neon"
+#else
+#define LPC_AC_DEFAULT_NAME "scalar"
+#endif
+#ifdef LPC_X86
+#include <immintrin.h>
+#endif
+
+/* Wr[Nsam-1-i] = Sn[i]*w[i], followed by LPC_AC_LAGS zeros */
+
+static LPC_INLINE void window_reverse(const float Sn[], const float w[], float Wr[], int Nsam)
+{
+    int i;
+
+    for(i=0; i<Nsam; i++)
+	Wr[Nsam-1-i] = Sn[i]*w[i];
+    for(i=0; i<LPC_AC_LAGS; i++)
+	Wr[Nsam+i] = 0.0;
+}
+
+static void window_ac_default(const float Sn[], const float w[], float Wr[], float Rn[], int Nsam)
+{
+    const float *p;
+    int          i;
+
+    window_reverse(Sn, w, Wr, Nsam);
+#if defined(LPC_SSE2)
+    {
+	__m128 a0 = _mm_setzero_ps(), a1 = a0, a2 = a0, a3 = a0, x;
+
+	for(i=0; i<Nsam; i++) {
+	    p = &Wr[Nsam-1-i];
+	    x = _mm_set1_ps(p[0]);
+	    a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(p), x));
+	    a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(p+4), x));
+	    a2 = _mm_add_ps(a2, _mm_mul_ps(_mm_loadu_ps(p+8), x));
+	    a3 = _mm_add_ps(a3, _mm_mul_ps(_mm_loadu_ps(p+12), x));
+	}
+	_mm_storeu_ps(Rn, a0);
+	_mm_storeu_ps(Rn+4, a1);
+	_mm_storeu_ps(Rn+8, a2);
+	_mm_storeu_ps(Rn+12, a3);
+    }
+#elif defined(LPC_NEON)
+    {
+	float32x4_t a0 = vdupq_n_f32(0.0), a1 = a0, a2 = a0, a3 = a0, x;
+
+	for(i=0; i<Nsam; i++) {
+	    p = &Wr[Nsam-1-i];
+	    x = vdupq_n_f32(p[0]);
+	    a0 = vaddq_f32(a0, vmulq_f32(vld1q_f32(p), x));
+	    a1 = vaddq_f32(a1, vmulq_f32(vld1q_f32(p+4), x));
+	    a2 = vaddq_f32(a2, vmulq_f32(vld1q_f32(p+8), x));
+	    a3 = vaddq_f32(a3, vmulq_f32(vld1q_f32(p+12), x));
+	}
+	vst1q_f32(Rn, a0);
+	vst1q_f32(Rn+4, a1);
+	vst1q_f32(Rn+8, a2);
+	vst1q_f32(Rn+12, a3);
+    }
+#else
+    {
+	int j;
+
+	for(j=0; j<LPC_AC_LAGS; j++) {
+	    Rn[j] = 0.0;
+	    for(i=0; i<Nsam; i++) {
+		p = &Wr[Nsam-1-i];
+		Rn[j] += p[j]*p[0];
+	    }
+	}
+    }
+#endif
+}
+
+#ifdef LPC_X86
+static LPC_AVX2 void window_ac_avx2(const float Sn[], const float w[], float Wr[], float Rn[], int Nsam)
+{
+    __m256       a0 = _mm256_setzero_ps(), a1 = a0, x;
+    const float *p;
+    int          i;
+
+    window_reverse(Sn, w, Wr, Nsam);
+    for(i=0; i<Nsam; i++) {
+	p = &Wr[Nsam-1-i];
+	x = _mm256_set1_ps(p[0]);
+	a0 = _mm256_add_ps(a0, _mm256_mul_ps(_mm256_loadu_ps(p), x));
+	a1 = _mm256_add_ps(a1, _mm256_mul_ps(_mm256_loadu_ps(p+8), x));
+    }
+    _mm256_storeu_ps(Rn, a0);
+    _mm256_storeu_ps(Rn+8, a1);
+}
+#endif
+
+static void (*window_ac_fn)(const float Sn[], const float w[], float Wr[], float Rn[], int Nsam) = window_ac_default;
+static const char *window_ac_name = LPC_AC_DEFAULT_NAME;
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: lpc_select_kernels
+  DATE CREATED: Oct 2026
+
+  Picks the window_autocorrelate() variant for the
+  machdep_cpu_features() given.  The variants give bit identical
+  results.
+
+\*---------------------------------------------------------------------------*/
+
+void lpc_select_kernels(int features)
+{
+    window_ac_fn = window_ac_default;
+    window_ac_name = LPC_AC_DEFAULT_NAME;
+#ifdef LPC_X86
+    if (features & MACHDEP_CPU_AVX2) {
+	window_ac_fn = window_ac_avx2;
+	window_ac_name = "avx2";
+    }
+#else
+    (void)features;
+#endif
+}
+
+const char *lpc_kernel_name(void)
+{
+    return window_ac_name;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: window_autocorrelate
+  DATE CREATED: Oct 2026
+
+  Windows the Nsam samples Sn[] with w[] and finds the first order+1
+  autocorrelation values Rn[] of the result, as autocorrelate() would
+  of the windowed samples.  Wr[] is scratch of at least
+  Nsam+LPC_AC_LAGS floats, it is left holding the windowed samples in
+  reverse order.
+
+\*---------------------------------------------------------------------------*/
+
+void window_autocorrelate(const float Sn[], const float w[], float Wr[], float Rn[], int Nsam, int order)
+{
+    float R[LPC_AC_LAGS];
+    int   i, j;
+
+    if (order < LPC_AC_LAGS) {
+	window_ac_fn(Sn, w, Wr, R, Nsam);
+	for(j=0; j<=order; j++)
+	    Rn[j] = R[j];
+    }
+    else {
+	for(i=0; i<Nsam; i++)
+	    Wr[i] = Sn[i]*w[i];
+	autocorrelate(Wr, Rn, Nsam, order);
+    }
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: make_lag_window
+  DATE CREATED: Oct 2026
+
+  Gaussian lag window of bw Hz for order+1 autocorrelation values,
+  with the white noise correction wnc (e.g. 1.0001) folded into lag 0.
+  Multiplying the autocorrelation by it, see lag_window(), smooths the
+  LPC envelope so sharp peaks on high pitched voices, and the
+  Levinson-Durbin recursion on near singular frames, are better
+  behaved.
+
+\*---------------------------------------------------------------------------*/
+
+void make_lag_window(float lw[], int order, float bw, float wnc)
+{
+    float a;
+    int   j;
+
+    a = 2.0*PI*bw/FS;
+    lw[0] = wnc;
+    for(j=1; j<=order; j++)
+	lw[j] = expf(-0.5*(a*j)*(a*j));
+}
+
+void lag_window(float Rn[], const float lw[], int order)
+{
+    int j;
+
+    for(j=0; j<=order; j++)
+	Rn[j] *= lw[j];
 }
 
 /*---------------------------------------------------------------------------*\
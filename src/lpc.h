@@ -29,14 +29,24 @@
 #define __LPC__
 
 #define LPC_MAX_ORDER 20
+#define LPC_AC_LAGS   16	/* lags window_autocorrelate() finds in one pass */
 
 void pre_emp(float Sn_pre[], float Sn[], float *mem, int Nsam);
 void de_emp(float Sn_se[], float Sn[], float *mem, int Nsam);
 void hanning_window(float Sn[],	float Wn[], int Nsam);
 void autocorrelate(float Sn[], float Rn[], int Nsam, int order);
+void window_autocorrelate(const float Sn[], const float w[], float Wr[], float Rn[], int Nsam, int order);
+void make_lag_window(float lw[], int order, float bw, float wnc);
+void lag_window(float Rn[], const float lw[], int order);
+void lpc_select_kernels(int features);
+const char *lpc_kernel_name(void);
 void levinson_durbin(float R[],	float lpcs[], int order);
 void inverse_filter(float Sn[], float a[], int Nsam, float res[], int order);
 void synthesis_filter(float res[], float a[], int Nsam,	int order, float Sn_[]);
+void bpf_filter(float buf[], const float h[], int ntap, const short in[], short out[], int n);
+void bpf_filter_float(float buf[], const float h[], int ntap, const float in[], float gain, short out[], int n);
+void bpf_select_kernels(int features);
+const char *bpf_kernel_name(void);
 //void find_aks(float Sn[], float a[], int Nsam, int order, float *E); Comment by Deulis
 void weight(float ak[],	float gamma, int order,	float akw[]);
 
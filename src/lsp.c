@@ -121,6 +121,45 @@ cheb_poly_eva(float *coef,float x,int order)
 
 
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: cheb_poly_eva_grid()
+  DATE CREATED: Oct 2026
+
+  cheb_poly_eva() at the next LSP_GRID points of lpc_to_lsp()'s grid
+  scan, x[i] = x[i-1] - delta from x[-1] = xl, each summed as
+  cheb_poly_eva() sums it.  The loops over the points vectorise.
+
+\*---------------------------------------------------------------------------*/
+
+#define LSP_GRID 8
+
+static void
+cheb_poly_eva_grid(float *coef, float xl, float delta, int order,
+		   float x[LSP_GRID], float sum[LSP_GRID])
+{
+    float T[(LPC_ORD / 2) + 1][LSP_GRID];
+    int   i, k;
+
+    for(k=0; k<LSP_GRID; k++) {
+	xl -= delta;
+	x[k] = xl;
+    }
+    for(k=0; k<LSP_GRID; k++) {
+	T[0][k] = 1.0;
+	T[1][k] = x[k];
+    }
+    for(i=2;i<=order/2;i++)
+	for(k=0; k<LSP_GRID; k++)
+	    T[i][k] = (2*x[k])*T[i-1][k] - T[i-2][k];
+
+    for(k=0; k<LSP_GRID; k++)
+	sum[k] = 0.0;
+    for(i=0;i<=order/2;i++)
+	for(k=0; k<LSP_GRID; k++)
+	    sum[k] += coef[(order/2)-i]*T[i][k];
+}
+
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: lpc_to_lsp()
@@ -129,6 +168,10 @@ cheb_poly_eva(float *coef,float x,int order)
 
   This function converts LPC coefficients to LSP coefficients.
 
+  The grid scan evaluates the polynomial at LSP_GRID points at a time
+  with cheb_poly_eva_grid(), and takes them in turn just as it would
+  one by one, so the roots found are the same.
+
 \*---------------------------------------------------------------------------*/
 
 int lpc_to_lsp (float *a, int order, float *freq, int nb, float delta)
@@ -148,6 +191,9 @@ int lpc_to_lsp (float *a, int order, float *freq, int nb, float delta)
     float *pt;                	/* ptr used for cheb_poly_eval()
 				   whether P' or Q' 			*/
     int roots=0;              	/* number of roots found 	        */
+    float gx[LSP_GRID];         /* next grid points, and the poly.      */
+    float gsum[LSP_GRID];       /* at each                              */
+    int g, ng;                  /* next of the ng grid points to scan   */
     float Q[LPC_ORD + 1];
 	float P[LPC_ORD + 1];
 
@@ -195,9 +241,15 @@ int lpc_to_lsp (float *a, int order, float *freq, int nb, float delta)
 
 	psuml = cheb_poly_eva(pt,xl,order);	/* evals poly. at xl 	*/
 	flag = 1;
+	g = ng = 0;
 	while(flag && (xr >= -1.0)){
-	    xr = xl - delta ;                  	/* interval spacing 	*/
-	    psumr = cheb_poly_eva(pt,xr,order);/* poly(xl-delta_x) 	*/
+	    if (g == ng) {
+		cheb_poly_eva_grid(pt,xl,delta,order,gx,gsum);
+		g = 0;
+		ng = LSP_GRID;
+	    }
+	    xr = gx[g];                        	/* xl - delta       	*/
+	    psumr = gsum[g++];                  /* poly(xl-delta_x) 	*/
 	    temp_psumr = psumr;
 	    temp_xr = xr;
 
@@ -239,9 +291,10 @@ int lpc_to_lsp (float *a, int order, float *freq, int nb, float delta)
 	}
     }
 
-    /* convert from x domain to radians */
+    /* convert from x domain to radians, only the roots found have been
+       written, the callers replace the lot if there are fewer than order */
 
-    for(i=0; i<order; i++) {
+    for(i=0; i<roots; i++) {
 	freq[i] = acosf(freq[i]);
     }
 
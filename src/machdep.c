@@ -0,0 +1,504 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: machdep.c
+  DATE CREATED: Oct 2026
+
+  Profiling support for the PROFILE_* macros in machdep.h.  Each
+  sample_and_log() call adds the elapsed time to a histogram kept per
+  label, so profiling a long run costs a few instructions per call
+  rather than a printf().  The histograms can be printed or queried
+  for per stage latency percentiles.
+
+  The clock is DWT_CYCCNT on the Cortex-M4, the time stamp counter on
+  x86 hosts built with -DMACHDEP_PROFILE_TSC, clock_gettime() on other
+  POSIX hosts and clock() elsewhere.
+
+  The profiler state is global and not thread safe, profile one codec
+  instance at a time.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined(_POSIX_C_SOURCE) && !defined(CORTEX_M4)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "machdep.h"
+
+#if defined(CORTEX_M4)
+#define MACHDEP_CLOCK_DWT
+#elif defined(MACHDEP_PROFILE_TSC) && (defined(__x86_64__) || defined(__i386__))
+#define MACHDEP_CLOCK_TSC
+#include <x86intrin.h>
+#elif defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0)
+#define MACHDEP_CLOCK_POSIX
+#else
+#define MACHDEP_CLOCK_STDC
+#endif
+
+/*---------------------------------------------------------------------------*\
+
+                                 DEFINES
+
+\*---------------------------------------------------------------------------*/
+
+/* Log-linear histogram: values below HIST_SUB ticks get a bin each,
+   above that every octave is split into HIST_SUB bins, so each bin
+   spans at most 1/HIST_SUB of its value. */
+
+#ifdef CORTEX_M4
+#define HIST_SUB_BITS 2
+#else
+#define HIST_SUB_BITS 3
+#endif
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BINS     ((32 - HIST_SUB_BITS + 1)*HIST_SUB)
+
+/* Cortex-M4 core clock, needed to convert DWT cycles to time */
+
+#ifndef MACHDEP_CPU_HZ
+#define MACHDEP_CPU_HZ 168000000
+#endif
+
+#ifdef MACHDEP_CLOCK_DWT
+#define DEMCR      (*(volatile unsigned int *)0xE000EDFC)
+#define DWT_CTRL   (*(volatile unsigned int *)0xE0001000)
+#define DWT_CYCCNT (*(volatile unsigned int *)0xE0001004)
+#define DEMCR_TRCENA       (1u << 24)
+#define DWT_CTRL_CYCCNTENA (1u << 0)
+#endif
+
+struct PROFILE_LABEL {
+    const char   *label;
+    unsigned long count;
+    double        total;
+    unsigned int  min;
+    unsigned int  max;
+    unsigned int  hist[HIST_BINS];
+};
+
+static struct PROFILE_LABEL labels[MACHDEP_PROFILE_MAX_LABELS];
+static int   nlabels;
+static int   dropped;
+static float ticks_per_us;
+
+/*---------------------------------------------------------------------------*\
+
+                                 FUNCTIONS
+
+\*---------------------------------------------------------------------------*/
+
+static unsigned int read_clock(void)
+{
+#if defined(MACHDEP_CLOCK_DWT)
+    return DWT_CYCCNT;
+#elif defined(MACHDEP_CLOCK_TSC)
+    return (unsigned int)__rdtsc();
+#elif defined(MACHDEP_CLOCK_POSIX)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned int)((unsigned long long)ts.tv_sec*1000000000ull + ts.tv_nsec);
+#else
+    return (unsigned int)clock();
+#endif
+}
+
+/* Clock ticks per micro second.  The TSC rate is measured against
+   clock_gettime() over 10ms the first time it's needed. */
+
+static float clock_ticks_per_us(void)
+{
+    if (ticks_per_us == 0.0) {
+#if defined(MACHDEP_CLOCK_DWT)
+	ticks_per_us = MACHDEP_CPU_HZ/1E6;
+#elif defined(MACHDEP_CLOCK_TSC)
+	struct timespec t0, t1;
+	unsigned long long c0, c1;
+	double ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	c0 = __rdtsc();
+	do {
+	    clock_gettime(CLOCK_MONOTONIC, &t1);
+	    ns = (t1.tv_sec - t0.tv_sec)*1E9 + (t1.tv_nsec - t0.tv_nsec);
+	} while (ns < 1E7);
+	c1 = __rdtsc();
+	ticks_per_us = (c1 - c0)*1E3/ns;
+#elif defined(MACHDEP_CLOCK_POSIX)
+	ticks_per_us = 1E3;
+#else
+	ticks_per_us = CLOCKS_PER_SEC/1E6;
+#endif
+    }
+
+    return ticks_per_us;
+}
+
+static int hist_bin(unsigned int ticks)
+{
+    int e;
+
+    if (ticks < HIST_SUB)
+	return ticks;
+
+#if defined(__GNUC__) || defined(__clang__)
+    e = 31 - __builtin_clz(ticks);
+#else
+    for(e=31; !(ticks & (1u << e)); e--)
+	;
+#endif
+
+    return (e - HIST_SUB_BITS + 1)*HIST_SUB + ((ticks >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/* smallest value that falls in bin */
+
+static double hist_bin_start(int bin)
+{
+    int e;
+
+    if (bin < HIST_SUB)
+	return bin;
+
+    e = bin/HIST_SUB + HIST_SUB_BITS - 1;
+    return (double)(HIST_SUB + bin % HIST_SUB)*(1u << (e - HIST_SUB_BITS));
+}
+
+static struct PROFILE_LABEL *find_label(const char s[])
+{
+    int i;
+
+    /* labels are usually string literals, so compare pointers first */
+
+    for(i=0; i<nlabels; i++)
+	if (labels[i].label == s)
+	    return &labels[i];
+    for(i=0; i<nlabels; i++)
+	if (strcmp(labels[i].label, s) == 0)
+	    return &labels[i];
+
+    if (nlabels == MACHDEP_PROFILE_MAX_LABELS) {
+	dropped++;
+	return NULL;
+    }
+
+    memset(&labels[nlabels], 0, sizeof(struct PROFILE_LABEL));
+    labels[nlabels].label = s;
+    labels[nlabels].min = 0xffffffff;
+    return &labels[nlabels++];
+}
+
+/* ticks value below which pct percent of the samples fall */
+
+static double percentile_ticks(const struct PROFILE_LABEL *l, float pct)
+{
+    unsigned long target, cumulative;
+    double        lo, hi, v;
+    int           bin;
+
+    if (l->count == 0)
+	return 0.0;
+
+    target = (unsigned long)(pct/100.0*l->count + 0.5);
+    if (target < 1)
+	target = 1;
+    if (target > l->count)
+	target = l->count;
+
+    cumulative = 0;
+    for(bin=0; bin<HIST_BINS; bin++) {
+	cumulative += l->hist[bin];
+	if (cumulative >= target)
+	    break;
+    }
+
+    /* interpolate linearly within the bin, clamped to the observed range */
+
+    lo = hist_bin_start(bin);
+    hi = (bin+1 < HIST_BINS) ? hist_bin_start(bin+1) : 4294967296.0;
+    v = lo + (hi - lo)*(target - (cumulative - l->hist[bin]))/l->hist[bin];
+    if (v < l->min) v = l->min;
+    if (v > l->max) v = l->max;
+
+    return v;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: machdep_profile_clock_init
+  DATE CREATED: Oct 2026
+
+  Starts the clock counter where that needs enabling, without touching
+  the histograms.  For users of machdep_profile_sample() that keep
+  their own counts.
+
+\*---------------------------------------------------------------------------*/
+
+void machdep_profile_clock_init(void)
+{
+#ifdef MACHDEP_CLOCK_DWT
+    if (!(DWT_CTRL & DWT_CTRL_CYCCNTENA)) {
+	DEMCR |= DEMCR_TRCENA;
+	DWT_CYCCNT = 0;
+	DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+    }
+#endif
+    clock_ticks_per_us();
+}
+
+float machdep_profile_ticks_per_us(void)
+{
+    return clock_ticks_per_us();
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: machdep_profile_init
+  DATE CREATED: Oct 2026
+
+  Starts the clock counter and clears the histograms.
+
+\*---------------------------------------------------------------------------*/
+
+void machdep_profile_init(void)
+{
+    machdep_profile_clock_init();
+    machdep_profile_reset();
+}
+
+void machdep_profile_reset(void)
+{
+    nlabels = 0;
+    dropped = 0;
+}
+
+unsigned int machdep_profile_sample(void)
+{
+    return read_clock();
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: machdep_profile_sample_and_log
+  DATE CREATED: Oct 2026
+
+  Adds the time since start to the histogram of label s, and returns
+  the current time so calls can be chained from one stage to the
+  next.  The label string must stay valid until the next reset.
+
+\*---------------------------------------------------------------------------*/
+
+unsigned int machdep_profile_sample_and_log(unsigned int start, const char s[])
+{
+    struct PROFILE_LABEL *l;
+    unsigned int now, ticks;
+
+    now = read_clock();
+    ticks = now - start;                   /* modulo 2^32, so wrap is OK */
+
+    l = find_label(s);
+    if (l != NULL) {
+	l->count++;
+	l->total += ticks;
+	if (ticks < l->min) l->min = ticks;
+	if (ticks > l->max) l->max = ticks;
+	l->hist[hist_bin(ticks)]++;
+    }
+
+    /* exclude the logging itself from the next stage */
+
+    return read_clock();
+}
+
+int machdep_profile_num_labels(void)
+{
+    return nlabels;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: machdep_profile_percentile
+  DATE CREATED: Oct 2026
+
+  Latency in us below which pct percent (0..100) of the samples of
+  label index i fall, estimated from the histogram to within one bin.
+
+\*---------------------------------------------------------------------------*/
+
+float machdep_profile_percentile(int i, float pct)
+{
+    if ((i < 0) || (i >= nlabels))
+	return 0.0;
+
+    return percentile_ticks(&labels[i], pct)/clock_ticks_per_us();
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: machdep_profile_get_stats
+  DATE CREATED: Oct 2026
+
+  Fills stats for label index i, 0 <= i < machdep_profile_num_labels().
+  Returns 0 on success, -1 if i is out of range.  Leading spaces, used
+  to indent nested stages in the printed report, are stripped from the
+  label.
+
+\*---------------------------------------------------------------------------*/
+
+int machdep_profile_get_stats(int i, struct MACHDEP_PROFILE_STATS *stats)
+{
+    const struct PROFILE_LABEL *l;
+    float scale;
+
+    if ((i < 0) || (i >= nlabels) || (stats == NULL))
+	return -1;
+
+    l = &labels[i];
+    scale = 1.0/clock_ticks_per_us();
+
+    stats->label = l->label;
+    while (*stats->label == ' ')
+	stats->label++;
+    stats->count = l->count;
+    stats->total_us = l->total*scale;
+    stats->mean_us = l->count ? l->total*scale/l->count : 0.0;
+    stats->min_us = l->count ? l->min*scale : 0.0;
+    stats->max_us = l->max*scale;
+    stats->p50_us = percentile_ticks(l, 50.0)*scale;
+    stats->p90_us = percentile_ticks(l, 90.0)*scale;
+    stats->p99_us = percentile_ticks(l, 99.0)*scale;
+    stats->p999_us = percentile_ticks(l, 99.9)*scale;
+
+    return 0;
+}
+
+void machdep_profile_print_logged_samples(void)
+{
+    struct MACHDEP_PROFILE_STATS st;
+    int i;
+
+    printf("%-32s %10s %10s %10s %10s %10s %10s\n", "label", "count",
+	   "mean us", "p50 us", "p99 us", "max us", "total ms");
+    for(i=0; i<nlabels; i++) {
+	machdep_profile_get_stats(i, &st);
+	printf("%-32s %10lu %10.2f %10.2f %10.2f %10.2f %10.2f\n", labels[i].label,
+	       st.count, st.mean_us, st.p50_us, st.p99_us, st.max_us, st.total_us/1E3);
+    }
+    if (dropped)
+	printf("%d samples dropped, more than %d labels\n", dropped, MACHDEP_PROFILE_MAX_LABELS);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: machdep_cpu_features
+  DATE CREATED: Oct 2026
+
+  Returns the MACHDEP_CPU_* flags of this CPU.  Cheap enough to call
+  more than once, but meant for one-off kernel selection.
+
+\*---------------------------------------------------------------------------*/
+
+int machdep_cpu_features(void)
+{
+    int features = 0;
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+	features |= MACHDEP_CPU_SSE2;
+    if (__builtin_cpu_supports("avx2"))
+	features |= MACHDEP_CPU_AVX2;
+    if (__builtin_cpu_supports("fma"))
+	features |= MACHDEP_CPU_FMA;
+    if (__builtin_cpu_supports("avx512f"))
+	features |= MACHDEP_CPU_AVX512F;
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    features |= MACHDEP_CPU_NEON;
+#endif
+
+    return features;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: machdep_denormals_off
+  DATE CREATED: Oct 2026
+
+  Has the FPU treat denormal operands and results as zero, which
+  otherwise can take a hundred times longer on some CPUs.  Only the
+  calling thread's control register is changed, machdep_fp_restore()
+  puts back the value returned.  ARMv7 and Cortex-M have no separate
+  denormals are zero, FZ covers both.
+
+\*---------------------------------------------------------------------------*/
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define MACHDEP_FP_MXCSR
+#include <xmmintrin.h>
+#define MXCSR_DAZ (1u << 6)
+#define MXCSR_FTZ (1u << 15)
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+#define MACHDEP_FP_FPCR
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__arm__) && defined(__ARM_FP)
+#define MACHDEP_FP_FPSCR
+#endif
+#define FPCR_FZ (1u << 24)
+
+unsigned int machdep_denormals_off(void)
+{
+#if defined(MACHDEP_FP_MXCSR)
+    unsigned int csr = _mm_getcsr();
+
+    _mm_setcsr(csr | MXCSR_DAZ | MXCSR_FTZ);
+    return csr;
+#elif defined(MACHDEP_FP_FPCR)
+    unsigned long fpcr;
+
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | FPCR_FZ));
+    return (unsigned int)fpcr;
+#elif defined(MACHDEP_FP_FPSCR)
+    unsigned int fpscr;
+
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fpscr | FPCR_FZ));
+    return fpscr;
+#else
+    return 0;
+#endif
+}
+
+void machdep_fp_restore(unsigned int fp)
+{
+#if defined(MACHDEP_FP_MXCSR)
+    _mm_setcsr(fp);
+#elif defined(MACHDEP_FP_FPCR)
+    __asm__ __volatile__("msr fpcr, %0" : : "r"((unsigned long)fp));
+#elif defined(MACHDEP_FP_FPSCR)
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fp));
+#else
+    (void)fp;
+#endif
+}
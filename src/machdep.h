@@ -43,10 +43,53 @@
 #define PROFILE_SAMPLE_AND_LOG2(prev_timestamp, label)
 #endif
 
+/* Samples are accumulated in a histogram per label.  Labels beyond
+   the first MACHDEP_PROFILE_MAX_LABELS are counted as dropped. */
+
+#define MACHDEP_PROFILE_MAX_LABELS 32
+
+struct MACHDEP_PROFILE_STATS {
+    const char   *label;
+    unsigned long count;
+    float         total_us;
+    float         mean_us;
+    float         min_us;
+    float         max_us;
+    float         p50_us;
+    float         p90_us;
+    float         p99_us;
+    float         p999_us;
+};
+
+void         machdep_profile_clock_init(void);
+float        machdep_profile_ticks_per_us(void);
 void         machdep_profile_init(void);
 void         machdep_profile_reset(void);
 unsigned int machdep_profile_sample(void);
-unsigned int machdep_profile_sample_and_log(unsigned int start, char s[]);
+unsigned int machdep_profile_sample_and_log(unsigned int start, const char s[]);
 void         machdep_profile_print_logged_samples(void);
 
+int          machdep_profile_num_labels(void);
+int          machdep_profile_get_stats(int i, struct MACHDEP_PROFILE_STATS *stats);
+float        machdep_profile_percentile(int i, float pct);
+
+/* Instruction set extensions of the CPU we are running on, as far as
+   the kernels that select a variant at run time care.  NEON is a
+   build time choice, set when the build targets it. */
+
+#define MACHDEP_CPU_SSE2    0x01
+#define MACHDEP_CPU_AVX2    0x02
+#define MACHDEP_CPU_FMA     0x04
+#define MACHDEP_CPU_AVX512F 0x08
+#define MACHDEP_CPU_NEON    0x10
+
+int          machdep_cpu_features(void);
+
+/* Flush to zero and denormals are zero for the calling thread, on
+   x86 SSE (MXCSR) and ARM (FPCR/FPSCR), a no-op elsewhere.  Returns
+   the previous control word for machdep_fp_restore(). */
+
+unsigned int machdep_denormals_off(void);
+void         machdep_fp_restore(unsigned int fp);
+
 #endif
@@ -29,7 +29,7 @@
 #include "nlp.h"
 #include "dump.h"
 #include "kiss_fft.h"
-#undef PROFILE
+#include "kiss_fftr.h"
 #include "machdep.h"
 
 #include <assert.h>
@@ -44,7 +44,6 @@
 
 #define PMAX_M      600		/* maximum NLP analysis window size     */
 #define COEFF       0.95	/* notch filter parameter               */
-#define PE_FFT_SIZE 512		/* DFT size for pitch estimation        */
 #define DEC         5		/* decimation factor                    */
 #define SAMPLE_RATE 8000
 #define PI          3.141592654	/* mathematical constant                */
@@ -114,15 +113,145 @@ const float nlp_fir[] = {
   -1.0818124e-03
 };
 
+/* read only state, may be shared by any number of NLP instances */
+
 typedef struct {
     int           m;
     float         w[PMAX_M/DEC];     /* DFT window                   */
-    float         sq[PMAX_M];	     /* squared speech samples       */
+    kiss_fftr_cfg fft_cfg;           /* kiss real FFT config         */
+} NLP_TEMPLATE;
+
+/* The decimation filter only computes the outputs that survive the
+   decimation.  Its memory and the decimated output are circular
+   buffers stored twice over, so the latest NLP_NTAP inputs are always
+   contiguous at mem_fir[fir_pos] and the latest m/DEC outputs at
+   dec[dec_pos], without moving older samples. */
+
+typedef struct {
+    int           m;
+    const NLP_TEMPLATE *t;           /* shared window and FFT config */
+    int           own_t;             /* non-zero if we free t        */
+    int           own_mem;           /* non-zero if we free ourself  */
+    float         dec[2*PMAX_M/DEC]; /* decimated, LP filtered sq(n) */
+    int           dec_pos;           /* oldest sample in dec[]       */
     float         mem_x,mem_y;       /* memory for notch filter      */
-    float         mem_fir[NLP_NTAP]; /* decimation FIR filter memory */
-    kiss_fft_cfg  fft_cfg;           /* kiss FFT config              */
+    float         mem_fir[2*NLP_NTAP]; /* decimation FIR filter memory */
+    int           fir_pos;           /* oldest sample in mem_fir[]   */
+    float         fw[PE_FFT_SIZE];   /* DFT input, zero past m/DEC   */
+    COMP          Fw[PE_FFT_SIZE/2+1]; /* DFT output, off the stack  */
+#ifdef DUMP
+    float         sq[PMAX_M];	     /* every LP filter output       */
+#endif
 } NLP;
 
+/*---------------------------------------------------------------------------*\
+
+ 				FIR KERNELS
+
+\*---------------------------------------------------------------------------*/
+
+/* The decimation FIR runs on blocks of up to NLP_FIR_BLOCK new
+   samples.  The block and the NLP_NTAP samples before it are split
+   into DEC phases, so the kept outputs, DEC samples apart at the
+   input, read consecutive samples of each phase and the loop over
+   outputs vectorises.  Each output still sums its taps in order, so
+   the result is the same as the sample by sample filter.  The loop is
+   built again for AVX2 on x86, chosen at run time by
+   nlp_select_kernels(). */
+
+#define NLP_FIR_BLOCK 80               /* a multiple of DEC            */
+#define NLP_FIR_PHASE ((NLP_NTAP+NLP_FIR_BLOCK)/DEC + 1)
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NLP_X86
+#define NLP_AVX2 __attribute__((target("avx2")))
+#endif
+
+/* the default build vectorises for the baseline instruction set */
+
+#if defined(__SSE2__)
+#define NLP_DEFAULT_NAME "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define NLP_DEFAULT_NAME "neon"
+#else
+#define NLP_DEFAULT_NAME "scalar"
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NLP_INLINE inline __attribute__((always_inline))
+#else
+#define NLP_INLINE inline
+#endif
+
+/* y[r] = sum over j of x[DEC*r+1+j]*nlp_fir[j], r = 0 .. nout-1 */
+
+static NLP_INLINE void fir_dec_impl(const float x[], int nout, float y[])
+{
+    float poly[DEC][NLP_FIR_PHASE];
+    float acc[NLP_FIR_BLOCK/DEC];
+    const float *p;
+    float c;
+    int   i, j, r;
+
+    for(i=0; i<NLP_NTAP+nout*DEC; i++)
+	poly[i%DEC][i/DEC] = x[i];
+
+    for(r=0; r<nout; r++)
+	acc[r] = 0.0;
+    for(j=0; j<NLP_NTAP; j++) {
+	p = &poly[(1+j)%DEC][(1+j)/DEC];
+	c = nlp_fir[j];
+	for(r=0; r<nout; r++)
+	    acc[r] += p[r]*c;
+    }
+    for(r=0; r<nout; r++)
+	y[r] = acc[r];
+}
+
+static void fir_dec_default(const float x[], int nout, float y[])
+{
+    fir_dec_impl(x, nout, y);
+}
+
+#ifdef NLP_X86
+static NLP_AVX2 void fir_dec_avx2(const float x[], int nout, float y[])
+{
+    fir_dec_impl(x, nout, y);
+}
+#endif
+
+static void (*fir_dec_fn)(const float x[], int nout, float y[]) = fir_dec_default;
+static const char *fir_dec_name = NLP_DEFAULT_NAME;
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: nlp_select_kernels
+  DATE CREATED: Oct 2026
+
+  Picks the decimation FIR variant for the machdep_cpu_features()
+  given.  The variants give bit identical results.
+
+\*---------------------------------------------------------------------------*/
+
+void nlp_select_kernels(int features)
+{
+    fir_dec_fn = fir_dec_default;
+    fir_dec_name = NLP_DEFAULT_NAME;
+#ifdef NLP_X86
+    if (features & MACHDEP_CPU_AVX2) {
+	fir_dec_fn = fir_dec_avx2;
+	fir_dec_name = "avx2";
+    }
+#else
+    (void)features;
+#endif
+}
+
+const char *nlp_kernel_name(void)
+{
+    return fir_dec_name;
+}
+
 float test_candidate_mbe(COMP Sw[], COMP W[], float f0);
 float post_process_mbe(COMP Fw[], int pmin, int pmax, float gmax, COMP Sw[], COMP W[], float *prev_Wo);
 float post_process_sub_multiples(COMP Fw[],
@@ -131,39 +260,164 @@ float post_process_sub_multiples(COMP Fw[],
 
 /*---------------------------------------------------------------------------*\
 
-  nlp_create()
+  nlp_template_create()
 
-  Initialisation function for NLP pitch estimator.
+  Builds the read only part of the NLP pitch estimator (DFT window
+  and FFT config).  One template can be shared by any number of NLP
+  instances created with nlp_create_from_template(), and must outlive
+  them.
 
 \*---------------------------------------------------------------------------*/
 
-void *nlp_create(
+void *nlp_template_create(
 int    m			/* analysis window size */
 )
 {
-    NLP *nlp;
-    int  i;
+    NLP_TEMPLATE *t;
+    int           i;
 
     assert(m <= PMAX_M);
+    assert((m % DEC) == 0);
 
-    nlp = (NLP*)malloc(sizeof(NLP));
-    if (nlp == NULL)
+    t = (NLP_TEMPLATE*)malloc(sizeof(NLP_TEMPLATE));
+    if (t == NULL)
 	return NULL;
 
-    nlp->m = m;
+    t->m = m;
     for(i=0; i<m/DEC; i++) {
-	nlp->w[i] = 0.5 - 0.5*cosf(2*PI*i/(m/DEC-1));
+	t->w[i] = 0.5 - 0.5*cosf(2*PI*i/(m/DEC-1));
     }
 
-    for(i=0; i<PMAX_M; i++)
-	nlp->sq[i] = 0.0;
+    t->fft_cfg = kiss_fftr_alloc (PE_FFT_SIZE, 0, NULL, NULL);
+    if (t->fft_cfg == NULL) {
+	free(t);
+	return NULL;
+    }
+
+    return (void*)t;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  nlp_template_destroy()
+
+\*---------------------------------------------------------------------------*/
+
+void nlp_template_destroy(void *nlp_template)
+{
+    NLP_TEMPLATE *t;
+    assert(nlp_template != NULL);
+    t = (NLP_TEMPLATE*)nlp_template;
+
+    KISS_FFT_FREE(t->fft_cfg);
+    free(t);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  nlp_state_size()
+
+  Size in bytes of the per instance NLP states, for use with
+  nlp_create_in_place().
+
+\*---------------------------------------------------------------------------*/
+
+size_t nlp_state_size(void)
+{
+    return sizeof(NLP);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  nlp_create_from_template()
+
+  Creates the per instance (mutable) NLP states, using the window and
+  FFT config of a template from nlp_template_create().
+
+\*---------------------------------------------------------------------------*/
+
+void *nlp_create_from_template(void *nlp_template)
+{
+    NLP *nlp;
+    void *mem;
+
+    mem = malloc(sizeof(NLP));
+    if (mem == NULL)
+	return NULL;
+
+    nlp = (NLP*)nlp_create_in_place(nlp_template, mem);
+    nlp->own_mem = 1;
+
+    return (void*)nlp;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  nlp_create_in_place()
+
+  As per nlp_create_from_template(), but the states are placed in the
+  caller supplied mem[] of nlp_state_size() bytes.
+
+\*---------------------------------------------------------------------------*/
+
+void *nlp_create_in_place(void *nlp_template, void *mem)
+{
+    NLP *nlp;
+    int  i;
+
+    assert(nlp_template != NULL);
+    assert(mem != NULL);
+
+    nlp = (NLP*)mem;
+    nlp->t = (const NLP_TEMPLATE*)nlp_template;
+    nlp->own_t = 0;
+    nlp->own_mem = 0;
+    nlp->m = nlp->t->m;
+
+    for(i=0; i<2*PMAX_M/DEC; i++)
+	nlp->dec[i] = 0.0;
+    nlp->dec_pos = 0;
     nlp->mem_x = 0.0;
     nlp->mem_y = 0.0;
-    for(i=0; i<NLP_NTAP; i++)
+    for(i=0; i<2*NLP_NTAP; i++)
 	nlp->mem_fir[i] = 0.0;
+    nlp->fir_pos = 0;
+    for(i=0; i<PE_FFT_SIZE; i++)
+	nlp->fw[i] = 0.0;
+#ifdef DUMP
+    for(i=0; i<PMAX_M; i++)
+	nlp->sq[i] = 0.0;
+#endif
+
+    return (void*)nlp;
+}
+
+/*---------------------------------------------------------------------------*\
 
-    nlp->fft_cfg = kiss_fft_alloc (PE_FFT_SIZE, 0, NULL, NULL);
-    assert(nlp->fft_cfg != NULL);
+  nlp_create()
+
+  Initialisation function for NLP pitch estimator.  Creates a private
+  template, use nlp_create_from_template() to share one instead.
+
+\*---------------------------------------------------------------------------*/
+
+void *nlp_create(
+int    m			/* analysis window size */
+)
+{
+    void *t;
+    NLP  *nlp;
+
+    t = nlp_template_create(m);
+    if (t == NULL)
+	return NULL;
+
+    nlp = (NLP*)nlp_create_from_template(t);
+    if (nlp == NULL) {
+	nlp_template_destroy(t);
+	return NULL;
+    }
+    nlp->own_t = 1;
 
     return (void*)nlp;
 }
@@ -182,8 +436,10 @@ void nlp_destroy(void *nlp_state)
     assert(nlp_state != NULL);
     nlp = (NLP*)nlp_state;
 
-    KISS_FFT_FREE(nlp->fft_cfg);
-    free(nlp_state);
+    if (nlp->own_t)
+	nlp_template_destroy((void*)nlp->t);
+    if (nlp->own_mem)
+	free(nlp_state);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -229,81 +485,210 @@ float nlp(
 )
 {
     NLP   *nlp;
-    float  notch;		    /* current notch filter output    */
-    COMP   fw[PE_FFT_SIZE];	    /* DFT of squared signal (input)  */
-    COMP   Fw[PE_FFT_SIZE];	    /* DFT of squared signal (output) */
-    float  gmax;
-    int    gmax_bin;
-    int    m, i,j;
+    COMP  *Fw;			    /* DFT of squared signal (output) */
     float  best_f0;
-    PROFILE_VAR(start, tnotch, filter, peakpick, window, fft, magsq, shiftmem);
+    int    i;
+    PROFILE_VAR(start, fft, magsq);
+
+    assert(nlp_state != NULL);
+    nlp = (NLP*)nlp_state;
+    Fw = nlp->Fw;
+
+    PROFILE_SAMPLE(start);
+
+    nlp_filter(nlp_state, Sn, n, NULL);
+    #ifdef DUMP
+    dump_dec(Fw);
+    #endif
+
+    PROFILE_SAMPLE(fft);
+    kiss_fftr(nlp->t->fft_cfg, nlp->fw, (kiss_fft_cpx *)Fw);
+    PROFILE_SAMPLE_AND_LOG(magsq, fft, "      fft");
+
+    for(i=0; i<PE_FFT_SIZE/2+1; i++)
+	Fw[i].real = Fw[i].real*Fw[i].real + Fw[i].imag*Fw[i].imag;
+
+    PROFILE_SAMPLE_AND_LOG2(magsq, "      mag sq");
+    #ifdef DUMP
+    dump_sq(nlp->sq);
+    dump_Fw(Fw);
+    #endif
+
+    best_f0 = nlp_pitch(Fw, pmin, pmax, pitch, Sw, W, prev_Wo);
+
+    /* Shift the full rate dump buffer, the rings above never move */
+
+    #ifdef DUMP
+    for(i=0; i<nlp->m-n; i++)
+	nlp->sq[i] = nlp->sq[i+n];
+    #endif
+
+    PROFILE_SAMPLE_AND_LOG2(start,  "      nlp int");
+
+    return(best_f0);
+}
+
+/*---------------------------------------------------------------------------*
+  nlp_filter()
+
+  First half of nlp(): squares, notch filters and LP filters the
+  latest n samples of Sn[] into the decimated history, and returns
+  the windowed history ready for the PE_FFT_SIZE point real DFT.  The
+  pointer is into the NLP state, valid until the next call.  Only the
+  first *nonzero entries (m/DEC) change, the rest are always zero.
+
+\*---------------------------------------------------------------------------*/
+
+const float *nlp_filter(
+  void *nlp_state,
+  float  Sn[],			/* input speech vector */
+  int    n,			/* frames shift (no. new samples in Sn[]) */
+  int   *nonzero                /* if not NULL, set to m/DEC               */
+)
+{
+    NLP   *nlp;
+    float  sq;			    /* current squared speech sample  */
+    float  notch;		    /* current notch filter output    */
+#ifdef DUMP
+    float  acc;
+    const float *fir;
+#else
+    float  x[NLP_NTAP+NLP_FIR_BLOCK];
+    float  y[NLP_FIR_BLOCK/DEC];
+    int    i0, nb;
+#endif
+    int    m, i,j, pos, nd, k;
+    PROFILE_VAR(start, filter);
 
     assert(nlp_state != NULL);
     nlp = (NLP*)nlp_state;
     m = nlp->m;
+    assert((n % DEC) == 0);     /* keeps the decimation phase fixed */
 
     PROFILE_SAMPLE(start);
 
-    /* Square, notch filter at DC, and LP filter vector */
+    /* Square, notch filter at DC, and LP filter latest speech samples */
 
-    for(i=m-n; i<m; i++) 	    /* square latest speech samples */
-	nlp->sq[i] = Sn[i]*Sn[i];
+    nd = m/DEC;
+    pos = nlp->fir_pos;
+#ifdef DUMP
+    for(i=m-n; i<m; i++) {
+	sq = Sn[i]*Sn[i];
 
-    for(i=m-n; i<m; i++) {	/* notch filter at DC */
-	notch = nlp->sq[i] - nlp->mem_x;
+	notch = sq - nlp->mem_x;    /* notch filter at DC */
 	notch += COEFF*nlp->mem_y;
-	nlp->mem_x = nlp->sq[i];
+	nlp->mem_x = sq;
 	nlp->mem_y = notch;
-	nlp->sq[i] = notch + 1.0;  /* With 0 input vectors to codec,
-				      kiss_fft() would take a long
-				      time to execute when running in
-				      real time.  Problem was traced
-				      to kiss_fft function call in
-				      this function. Adding this small
-				      constant fixed problem.  Not
-				      exactly sure why. */
+	sq = notch + 1.0;           /* see the block loop below */
+
+	nlp->mem_fir[pos] = nlp->mem_fir[pos+NLP_NTAP] = sq;
+	if (++pos == NLP_NTAP)
+	    pos = 0;
+
+	/* FIR filter, every output for the dump */
+
+	fir = &nlp->mem_fir[pos];
+	acc = 0.0;
+	for(j=0; j<NLP_NTAP; j++)
+	    acc += fir[j]*nlp_fir[j];
+	nlp->sq[i] = acc;
+	if (i % DEC)
+	    continue;
+
+	/* replaces the oldest decimated sample, in both copies */
+
+	k = (nlp->dec_pos + (i - (m-n))/DEC) % nd;
+	nlp->dec[k] = nlp->dec[k+nd] = acc;
     }
+#else
+    for(i0=m-n; i0<m; i0+=nb) {
+	nb = m - i0;
+	if (nb > NLP_FIR_BLOCK)
+	    nb = NLP_FIR_BLOCK;
 
-    PROFILE_SAMPLE_AND_LOG(tnotch, start, "      square and notch");
+	/* the filter memory, oldest first, then the new samples */
 
-    for(i=m-n; i<m; i++) {	/* FIR filter vector */
+	for(j=0; j<NLP_NTAP; j++)
+	    x[j] = nlp->mem_fir[pos+j];
+	for(i=0; i<nb; i++) {
+	    sq = Sn[i0+i]*Sn[i0+i];
+
+	    notch = sq - nlp->mem_x;    /* notch filter at DC */
+	    notch += COEFF*nlp->mem_y;
+	    nlp->mem_x = sq;
+	    nlp->mem_y = notch;
+	    x[NLP_NTAP+i] = notch + 1.0; /* With 0 input vectors to codec,
+					   kiss_fft() would take a long
+					   time to execute when running in
+					   real time.  The decaying notch
+					   output was denormal, the offset
+					   keeps the FIR and DFT inputs
+					   normal.  mem_y itself is kept
+					   clear by FLUSH_DENORMAL(), the
+					   offset stays as the pitch
+					   estimates depend on it. */
+	}
 
-	for(j=0; j<NLP_NTAP-1; j++)
-	    nlp->mem_fir[j] = nlp->mem_fir[j+1];
-	nlp->mem_fir[NLP_NTAP-1] = nlp->sq[i];
+	/* FIR filter, only the outputs we keep after decimation, each
+	   replaces the oldest decimated sample in both copies */
+
+	fir_dec_fn(x, nb/DEC, y);
+	for(i=0; i<nb/DEC; i++) {
+	    k = (nlp->dec_pos + (i0 - (m-n))/DEC + i) % nd;
+	    nlp->dec[k] = nlp->dec[k+nd] = y[i];
+	}
+
+	/* the latest NLP_NTAP samples back to the filter memory */
 
-	nlp->sq[i] = 0.0;
 	for(j=0; j<NLP_NTAP; j++)
-	    nlp->sq[i] += nlp->mem_fir[j]*nlp_fir[j];
+	    nlp->mem_fir[j] = nlp->mem_fir[j+NLP_NTAP] = x[nb+j];
+	pos = 0;
     }
+#endif
+    FLUSH_DENORMAL(nlp->mem_y);
+    nlp->fir_pos = pos;
+    nlp->dec_pos = (nlp->dec_pos + n/DEC) % nd;
 
-    PROFILE_SAMPLE_AND_LOG(filter, tnotch, "      filter");
+    PROFILE_SAMPLE_AND_LOG(filter, start, "      notch and filter");
 
-    /* Decimate and DFT */
+    /* Window for the DFT, fw[] past m/DEC stays zero */
 
-    for(i=0; i<PE_FFT_SIZE; i++) {
-	fw[i].real = 0.0;
-	fw[i].imag = 0.0;
+    for(i=0; i<nd; i++) {
+	nlp->fw[i] = nlp->dec[nlp->dec_pos+i]*nlp->t->w[i];
     }
-    for(i=0; i<m/DEC; i++) {
-	fw[i].real = nlp->sq[i*DEC]*nlp->w[i];
-    }
-    PROFILE_SAMPLE_AND_LOG(window, filter, "      window");
-    #ifdef DUMP
-    dump_dec(Fw);
-    #endif
+    PROFILE_SAMPLE_AND_LOG2(filter, "      window");
 
-    kiss_fft(nlp->fft_cfg, (kiss_fft_cpx *)fw, (kiss_fft_cpx *)Fw);
-    PROFILE_SAMPLE_AND_LOG(fft, window, "      fft");
+    if (nonzero != NULL)
+	*nonzero = nd;
+    return nlp->fw;
+}
 
-    for(i=0; i<PE_FFT_SIZE; i++)
-	Fw[i].real = Fw[i].real*Fw[i].real + Fw[i].imag*Fw[i].imag;
+/*---------------------------------------------------------------------------*
+  nlp_pitch()
 
-    PROFILE_SAMPLE_AND_LOG(magsq, fft, "      mag sq");
-    #ifdef DUMP
-    dump_sq(nlp->sq);
-    dump_Fw(Fw);
-    #endif
+  Second half of nlp(): picks the pitch from Fw[], the power spectrum
+  of nlp_filter()'s output in the .real fields.  It doesn't touch the
+  NLP state, so the two halves can be run apart.
+
+\*---------------------------------------------------------------------------*/
+
+float nlp_pitch(
+  COMP   Fw[],                  /* power spectrum of squared signal */
+  int    pmin,                  /* minimum pitch value */
+  int    pmax,			/* maximum pitch value */
+  float *pitch,			/* estimated pitch period in samples */
+  COMP   Sw[],                  /* Freq domain version of Sn[] */
+  COMP   W[],                   /* Freq domain window */
+  float *prev_Wo
+)
+{
+    float  gmax;
+    int    gmax_bin;
+    int    i;
+    float  best_f0;
+    PROFILE_VAR(start, peakpick);
+
+    PROFILE_SAMPLE(start);
 
     /* find global peak */
 
@@ -316,7 +701,7 @@ float nlp(
 	}
     }
 
-    PROFILE_SAMPLE_AND_LOG(peakpick, magsq, "      peak pick");
+    PROFILE_SAMPLE_AND_LOG(peakpick, start, "      peak pick");
 
     //#define POST_PROCESS_MBE
     #ifdef POST_PROCESS_MBE
@@ -325,21 +710,12 @@ float nlp(
     best_f0 = post_process_sub_multiples(Fw, pmin, pmax, gmax, gmax_bin, prev_Wo);
     #endif
 
-    PROFILE_SAMPLE_AND_LOG(shiftmem, peakpick,  "      post process");
-
-    /* Shift samples in buffer to make room for new samples */
-
-    for(i=0; i<m-n; i++)
-	nlp->sq[i] = nlp->sq[i+n];
+    PROFILE_SAMPLE_AND_LOG2(peakpick,  "      post process");
 
     /* return pitch and F0 estimate */
 
     *pitch = (float)SAMPLE_RATE/best_f0;
 
-    PROFILE_SAMPLE_AND_LOG2(shiftmem,  "      shift mem");
-
-    PROFILE_SAMPLE_AND_LOG2(start,  "      nlp int");
-
     return(best_f0);
 }
 
@@ -28,11 +28,24 @@
 #ifndef __NLP__
 #define __NLP__
 
+#include <stddef.h>
 #include "comp.h"
 
+#define PE_FFT_SIZE 512		/* DFT size for pitch estimation        */
+
 void *nlp_create(int m);
 void nlp_destroy(void *nlp_state);
+void *nlp_template_create(int m);
+void nlp_template_destroy(void *nlp_template);
+void *nlp_create_from_template(void *nlp_template);
+size_t nlp_state_size(void);
+void *nlp_create_in_place(void *nlp_template, void *mem);
 float nlp(void *nlp_state, float Sn[], int n, int pmin, int pmax,
 	  float *pitch, COMP Sw[], COMP W[], float *prev_Wo);
+const float *nlp_filter(void *nlp_state, float Sn[], int n, int *nonzero);
+float nlp_pitch(COMP Fw[], int pmin, int pmax, float *pitch,
+		 COMP Sw[], COMP W[], float *prev_Wo);
+void nlp_select_kernels(int features);
+const char *nlp_kernel_name(void);
 
 #endif
@@ -30,6 +30,7 @@
 #include "kiss_fft.h"
 #include "comp.h"
 #include "sine.h"
+#include "fastmath.h"
 
 #include <assert.h>
 #include <ctype.h>
@@ -132,24 +133,34 @@ void phase_synth_zero_order(
     kiss_fft_cfg fft_fwd_cfg,
     MODEL *model,
     float *ex_phase,            /* excitation phase of fundamental */
-    COMP   A[]
+    COMP   A[],
+    unsigned long *rand_state   /* codec2_rand() state               */
 )
 {
     int   m, b;
-    float phi_, new_phi, r;
+    float r, mag;
     COMP  Ex[MAX_AMP+1];	  /* excitation samples */
-    COMP  A_[MAX_AMP+1];	  /* synthesised harmonic samples */
+    float A_real[MAX_AMP+1];	  /* synthesised harmonic samples */
+    float A_imag[MAX_AMP+1];
     COMP  H[MAX_AMP+1];           /* LPC freq domain samples */
+    float phi[MAX_AMP+1];
 
     r = TWO_PI/(FFT_ENC);
 
-    /* Sample phase at harmonics */
+    /* Sample phase at harmonics.  exp(-j*arg(A)) is just conj(A)/|A|,
+       so no trig is needed. */
 
     for(m=1; m<=model->L; m++) {
         b = (int)(m*model->Wo/r + 0.5);
-        phi_ = -atan2f(A[b].imag, A[b].real);
-        H[m].real = cosf(phi_);
-        H[m].imag = sinf(phi_);
+        mag = sqrtf(A[b].real*A[b].real + A[b].imag*A[b].imag);
+        if (mag > 0.0) {
+            H[m].real =  A[b].real/mag;
+            H[m].imag = -A[b].imag/mag;
+        }
+        else {
+            H[m].real = 1.0;
+            H[m].imag = 0.0;
+        }
     }
 
     /*
@@ -164,36 +175,47 @@ void phase_synth_zero_order(
     ex_phase[0] += (model->Wo)*N;
     ex_phase[0] -= TWO_PI*floorf(ex_phase[0]/TWO_PI + 0.5);
 
-    for(m=1; m<=model->L; m++) {
+    /* generate excitation */
 
-        /* generate excitation */
+    if (model->voiced) {
 
-        if (model->voiced) {
+        /* exp(j*ex_phase*m) is a geometric sequence in m, so a phasor
+           recurrence replaces cos/sin of every harmonic.  Rounding
+           error grows about linearly, under 1E-5 rad by m = MAX_AMP. */
 
-            Ex[m].real = cosf(ex_phase[0]*m);
-            Ex[m].imag = sinf(ex_phase[0]*m);
+        fast_sincos(ex_phase, &Ex[1].imag, &Ex[1].real, 1);
+        for(m=2; m<=model->L; m++) {
+            Ex[m].real = Ex[m-1].real*Ex[1].real - Ex[m-1].imag*Ex[1].imag;
+            Ex[m].imag = Ex[m-1].imag*Ex[1].real + Ex[m-1].real*Ex[1].imag;
         }
-        else {
-
-            /* When a few samples were tested I found that LPC filter
-               phase is not needed in the unvoiced case, but no harm in
-               keeping it.
-            */
-            float phi = TWO_PI*(float)codec2_rand()/CODEC2_RAND_MAX;
-            Ex[m].real = cosf(phi);
-            Ex[m].imag = sinf(phi);
+    }
+    else {
+
+        /* When a few samples were tested I found that LPC filter
+           phase is not needed in the unvoiced case, but no harm in
+           keeping it.
+        */
+        float s[MAX_AMP+1], c[MAX_AMP+1];
+
+        for(m=1; m<=model->L; m++)
+            phi[m] = TWO_PI*(float)codec2_rand(rand_state)/CODEC2_RAND_MAX;
+        fast_sincos(&phi[1], &s[1], &c[1], model->L);
+        for(m=1; m<=model->L; m++) {
+            Ex[m].real = c[m];
+            Ex[m].imag = s[m];
         }
+    }
 
-        /* filter using LPC filter */
+    /* filter using LPC filter */
 
-        A_[m].real = H[m].real*Ex[m].real - H[m].imag*Ex[m].imag;
-        A_[m].imag = H[m].imag*Ex[m].real + H[m].real*Ex[m].imag;
+    for(m=1; m<=model->L; m++) {
+        A_real[m] = H[m].real*Ex[m].real - H[m].imag*Ex[m].imag + 1E-12;
+        A_imag[m] = H[m].imag*Ex[m].real + H[m].real*Ex[m].imag;
+    }
 
-        /* modify sinusoidal phase */
+    /* modify sinusoidal phase */
 
-        new_phi = atan2f(A_[m].imag, A_[m].real+1E-12);
-        model->phi[m] = new_phi;
-    }
+    fast_atan2(&A_imag[1], &A_real[1], &model->phi[1], model->L);
 
 }
 
@@ -34,6 +34,7 @@
 void phase_synth_zero_order(kiss_fft_cfg fft_dec_cfg,
 			    MODEL *model,
                             float *ex_phase,
-                            COMP   A[]);
+                            COMP   A[],
+                            unsigned long *rand_state);
 
 #endif
@@ -29,90 +29,15 @@
 #include "phase.h"
 #include "kiss_fft.h"
 #include "comp.h"
+#include "phaseexp_codebook.h"
+#include "quantise.h"
+#include "vq.h"
 
 #include <assert.h>
-#include <ctype.h>
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
 
-/* Bruce Perens' funcs to load codebook files */
-
-struct codebook {
-    unsigned int	 k;
-    unsigned int	 log2m;
-    unsigned int	 m;
-    COMP                *cb;
-    unsigned int         offset;
-};
-
-static const char format[] =
-"The table format must be:\n"
-"\tTwo integers describing the dimensions of the codebook.\n"
-"\tThen, enough numbers to fill the specified dimensions.\n";
-
-float get_float(FILE * in, const char * name, char * * cursor, char * buffer, int size)
-{
-  for ( ; ; ) {
-    char *	s = *cursor;
-    char	c;
-
-    while ( (c = *s) != '\0' && !isdigit(c) && c != '-' && c != '.' )
-      s++;
-
-    /* Comments start with "#" and continue to the end of the line. */
-    if ( c != '\0' && c != '#' ) {
-      char *	end = 0;
-      float	f = 0;
-
-      f = strtod(s, &end);
-
-      if ( end != s )
-        *cursor = end;
-        return f;
-    }
-
-    if ( fgets(buffer, size, in) == NULL ) {
-      fprintf(stderr, "%s: Format error. %s\n", name, format);
-      exit(1);
-    }
-    *cursor = buffer;
-  }
-}
-
-static struct codebook *load(const char * name)
-{
-    FILE               *file;
-    char		line[2048];
-    char               *cursor = line;
-    struct codebook    *b = malloc(sizeof(struct codebook));
-    int			i;
-    int			size;
-    float               angle;
-
-    file = fopen(name, "rt");
-    assert(file != NULL);
-
-    *cursor = '\0';
-
-    b->k = (int)get_float(file, name, &cursor, line, sizeof(line));
-    b->m = (int)get_float(file, name ,&cursor, line, sizeof(line));
-    size = b->k * b->m;
-
-    b->cb = (COMP *)malloc(size * sizeof(COMP));
-
-    for ( i = 0; i < size; i++ ) {
-	angle = get_float(file, name, &cursor, line, sizeof(line));
-	b->cb[i].real = cos(angle);
-	b->cb[i].imag = sin(angle);
-    }
-
-    fclose(file);
-
-    return b;
-}
-
-
 /* states for phase experiments */
 
 struct PEXP {
@@ -123,6 +48,8 @@ struct PEXP {
     float            snr;
     float            var;
     int              var_n;
+    struct codebook  vq[5];           /* split VQ stages                        */
+    COMP            *vq_cb[5];        /* entries loaded from files, or NULL     */
     struct codebook *vq1,*vq2,*vq3,*vq4,*vq5;
     float            vq_var;
     int              vq_var_n;
@@ -156,18 +83,33 @@ struct PEXP * phase_experiment_create() {
     pexp->var_n = 0;
 
     /* smoothed 10th order for 1st 1 khz */
-    //pexp->vq1 = load("../unittest/ph1_10_1024.txt");
+    //pexp->vq_cb[0] = phase_codebook_load(&pexp->vq[0], "../unittest/ph1_10_1024.txt");
     //pexp->vq1->offset = 0;
 
-    /* load experimental phase VQ */
+    /* load experimental phase VQ, or take the copies compiled in by
+       CODEC2_PHASEEXP_CODEBOOKS */
 
-    //pexp->vq1 = load("../unittest/testn1_20_1024.txt");
-    pexp->vq1 = load("../unittest/test.txt");
-    //pexp->vq2 = load("../unittest/testn21_40_1024.txt");
-    pexp->vq2 = load("../unittest/test11_20_1024.txt");
-    pexp->vq3 = load("../unittest/test21_30_1024.txt");
-    pexp->vq4 = load("../unittest/test31_40_1024.txt");
-    pexp->vq5 = load("../unittest/test41_60_1024.txt");
+#ifdef CODEC2_PHASEEXP_BUILTIN
+    for(i=0; i<5; i++) {
+	pexp->vq[i] = phase_cb[i];
+	pexp->vq_cb[i] = NULL;
+    }
+#else
+    //pexp->vq_cb[0] = phase_codebook_load(&pexp->vq[0], "../unittest/testn1_20_1024.txt");
+    pexp->vq_cb[0] = phase_codebook_load(&pexp->vq[0], "../unittest/test.txt");
+    //pexp->vq_cb[1] = phase_codebook_load(&pexp->vq[1], "../unittest/testn21_40_1024.txt");
+    pexp->vq_cb[1] = phase_codebook_load(&pexp->vq[1], "../unittest/test11_20_1024.txt");
+    pexp->vq_cb[2] = phase_codebook_load(&pexp->vq[2], "../unittest/test21_30_1024.txt");
+    pexp->vq_cb[3] = phase_codebook_load(&pexp->vq[3], "../unittest/test31_40_1024.txt");
+    pexp->vq_cb[4] = phase_codebook_load(&pexp->vq[4], "../unittest/test41_60_1024.txt");
+    for(i=0; i<5; i++)
+	assert(pexp->vq_cb[i] != NULL);
+#endif
+    pexp->vq1 = &pexp->vq[0];
+    pexp->vq2 = &pexp->vq[1];
+    pexp->vq3 = &pexp->vq[2];
+    pexp->vq4 = &pexp->vq[3];
+    pexp->vq5 = &pexp->vq[4];
     pexp->vq1->offset = 0;
     pexp->vq2->offset = 10;
     pexp->vq3->offset = 20;
@@ -190,6 +132,8 @@ struct PEXP * phase_experiment_create() {
 \*---------------------------------------------------------------------------*/
 
 void phase_experiment_destroy(struct PEXP *pexp) {
+    int i;
+
     assert(pexp != NULL);
     if (pexp->snr != 0.0)
 	printf("snr: %4.2f dB\n", pexp->snr/pexp->frames);
@@ -199,6 +143,8 @@ void phase_experiment_destroy(struct PEXP *pexp) {
     if (pexp->vq_var != 0.0)
 	printf("vq var: %4.3f  vq std dev: %4.3f (%d non zero phases)\n",
 	       pexp->vq_var/pexp->vq_var_n, sqrt(pexp->vq_var/pexp->vq_var_n), pexp->vq_var_n);
+    for(i=0; i<5; i++)
+	free(pexp->vq_cb[i]);
     free(pexp);
 }
 
@@ -695,36 +641,96 @@ static COMP cmult(COMP a, COMP b)
     return res;
 }
 
-static int vq_phase(COMP cb[], COMP vec[], float weights[], int d, int e, float *se)
+/* Weighted and plain squared phase error of codebook entry c[], the
+   exhaustive search's own arithmetic */
+
+static float phase_metric(const COMP c[], COMP vec[], float weights[], int d, float *error)
+{
+   int     i;
+   int     ignore;
+   COMP    diffr;
+   float   diffp, metric;
+
+   *error = 0.0;
+   metric = 0.0;
+   for(i=0; i<d; i++) {
+	ignore = (vec[i].real == 0.0) && (vec[i].imag == 0.0);
+	if (!ignore) {
+	    diffr = cmult(c[i], cconj(vec[i]));
+	    diffp = atan2(diffr.imag, diffr.real);
+	    *error += diffp*diffp;
+	    metric += weights[i]*weights[i]*diffp*diffp;
+	    //metric += weights[i]*diffp*diffp;
+	    //metric = log10(weights[i]*fabs(diffp));
+	    //printf("diffp %f metric %f\n", diffp, metric);
+	    //if (metric < log10(PI/(8.0*sqrt(3.0))))
+	    //   metric = log10(PI/(8.0*sqrt(3.0)));
+	}
+   }
+
+   return metric;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  phase_vq_mbest()
+
+  Adds the entries of the e entry, d dimensional phase codebook cb[]
+  nearest vec[] to M-best list mbest, index[0] of each the entry.
+  Distances come from the vq_phase_distances() SIMD kernels a block at
+  a time, with their polynomial atan2().
+
+\*---------------------------------------------------------------------------*/
+
+#define PHASE_VQ_BLOCK 64
+
+void phase_vq_mbest(const COMP cb[], COMP vec[], float weights[], int d, int e,
+		    struct MBEST *mbest)
+{
+   float   metric[PHASE_VQ_BLOCK];
+   int     index[MBEST_STAGES];
+   int     i,j,n;
+
+   for(i=0; i<MBEST_STAGES; i++)
+	index[i] = 0;
+   for(j=0; j<e; j+=PHASE_VQ_BLOCK) {
+	n = (e - j) < PHASE_VQ_BLOCK ? (e - j) : PHASE_VQ_BLOCK;
+	vq_phase_distances(cb, vec, weights, d, j, n, metric, NULL);
+	for(i=0; i<n; i++) {
+	    if (metric[i] < mbest->list[mbest->entries-1].error) {
+		index[0] = j + i;
+		mbest_insert(mbest, index, metric[i]);
+	    }
+	}
+   }
+}
+
+/* The PHASE_VQ_MBEST best entries by the kernels are rescored with
+   libm atan2(), so the entry chosen is that of an exhaustive atan2()
+   search unless it ranks below PHASE_VQ_MBEST by the polynomial,
+   within 5E-7 radians of it */
+
+#define PHASE_VQ_MBEST 4
+
+static int vq_phase(const COMP cb[], COMP vec[], float weights[], int d, int e, float *se)
 {
+   struct MBEST_LIST list[PHASE_VQ_MBEST];
+   struct MBEST      mbest;
    float   error;	/* current error		*/
    int     besti;	/* best index so far		*/
    float   best_error;	/* best error so far		*/
-   int	   i,j;
-   int     ignore;
-   COMP    diffr;
-   float   diffp, metric, best_metric;
+   float   metric, best_metric;
+   int	   c,j;
+
+   mbest_init(&mbest, list, PHASE_VQ_MBEST);
+   phase_vq_mbest(cb, vec, weights, d, e, &mbest);
 
    besti = 0;
    best_metric = best_error = 1E32;
-   for(j=0; j<e; j++) {
-	error = 0.0;
-	metric = 0.0;
-	for(i=0; i<d; i++) {
-	    ignore = (vec[i].real == 0.0) && (vec[i].imag == 0.0);
-	    if (!ignore) {
-		diffr = cmult(cb[j*d+i], cconj(vec[i]));
-		diffp = atan2(diffr.imag, diffr.real);
-		error  += diffp*diffp;
-		metric += weights[i]*weights[i]*diffp*diffp;
-		//metric += weights[i]*diffp*diffp;
-		//metric = log10(weights[i]*fabs(diffp));
-		//printf("diffp %f metric %f\n", diffp, metric);
-		//if (metric < log10(PI/(8.0*sqrt(3.0))))
-		//   metric = log10(PI/(8.0*sqrt(3.0)));
-	    }
-	}
-	if (metric < best_metric) {
+   for(c=0; (c<mbest.entries) && (c<e); c++) {
+	j = list[c].index[0];
+	metric = phase_metric(&cb[j*d], vec, weights, d, &error);
+	if ((metric < best_metric) || ((metric == best_metric) && (j < besti))) {
 	    best_metric = metric;
 	    best_error = error;
 	    besti = j;
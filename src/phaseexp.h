@@ -31,9 +31,12 @@
 #include "kiss_fft.h"
 
 struct PEXP;
+struct MBEST;
 
 struct PEXP * phase_experiment_create();
 void phase_experiment_destroy(struct PEXP *pexp);
 void phase_experiment(struct PEXP *pexp, MODEL *model, char *arg);
+void phase_vq_mbest(const COMP cb[], COMP vec[], float weights[], int d, int e,
+		    struct MBEST *mbest);
 
 #endif
@@ -0,0 +1,264 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: phaseexp_codebook.c
+  DATE CREATED: Oct 2026
+
+  Readers and writer for the phase VQ codebooks, see
+  phaseexp_codebook.h.  Text codebooks are angles, parsed one token at
+  a time and converted to (cos, sin) pairs; binary codebooks hold the
+  pairs themselves and are read with one fread().
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phaseexp_codebook.h"
+
+/* Bruce Perens' funcs to load codebook files */
+
+static const char format[] =
+"The table format must be:\n"
+"\tTwo integers describing the dimensions of the codebook.\n"
+"\tThen, enough numbers to fill the specified dimensions.\n";
+
+float get_float(FILE * in, const char * name, char * * cursor, char * buffer, int size)
+{
+  for ( ; ; ) {
+    char *	s = *cursor;
+    char	c;
+
+    while ( (c = *s) != '\0' && !isdigit(c) && c != '-' && c != '.' )
+      s++;
+
+    /* Comments start with "#" and continue to the end of the line. */
+    if ( c != '\0' && c != '#' ) {
+      char *	end = 0;
+      float	f = 0;
+
+      f = strtod(s, &end);
+
+      if ( end != s )
+        *cursor = end;
+        return f;
+    }
+
+    if ( fgets(buffer, size, in) == NULL ) {
+      fprintf(stderr, "%s: Format error. %s\n", name, format);
+      exit(1);
+    }
+    *cursor = buffer;
+  }
+}
+
+COMP *phase_codebook_load_text(struct codebook *b, const char *name)
+{
+    FILE               *file;
+    char		line[2048];
+    char               *cursor = line;
+    COMP               *cb;
+    int			i;
+    int			size;
+    float               angle;
+
+    file = fopen(name, "rt");
+    if (file == NULL)
+	return NULL;
+
+    *cursor = '\0';
+
+    b->k = (int)get_float(file, name, &cursor, line, sizeof(line));
+    b->m = (int)get_float(file, name ,&cursor, line, sizeof(line));
+    b->log2m = 0;
+    b->offset = 0;
+    size = b->k * b->m;
+
+    cb = (COMP *)malloc(size * sizeof(COMP));
+    if (cb == NULL) {
+	fclose(file);
+	return NULL;
+    }
+
+    for ( i = 0; i < size; i++ ) {
+	angle = get_float(file, name, &cursor, line, sizeof(line));
+	cb[i].real = cos(angle);
+	cb[i].imag = sin(angle);
+    }
+
+    fclose(file);
+    b->cb = cb;
+
+    return cb;
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put32(unsigned char *p, uint32_t x)
+{
+    p[0] = x & 0xff;
+    p[1] = (x >> 8) & 0xff;
+    p[2] = (x >> 16) & 0xff;
+    p[3] = (x >> 24) & 0xff;
+}
+
+/* non-zero if floats are stored little endian, the file's byte order */
+
+static int little_endian(void)
+{
+    const uint32_t one = 1;
+
+    return *(const unsigned char *)&one == 1;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: phase_codebook_load_bin
+  DATE CREATED: Oct 2026
+
+  Reads a binary codebook, returns its entries for the caller to free,
+  or NULL if the file can't be read or isn't a binary codebook.
+
+\*---------------------------------------------------------------------------*/
+
+COMP *phase_codebook_load_bin(struct codebook *b, const char *name)
+{
+    FILE          *file;
+    unsigned char  hdr[PHASE_CB_HEADER];
+    unsigned char *p;
+    COMP          *cb;
+    uint32_t       u;
+    size_t         size, i;
+    unsigned int   hsize;
+
+    file = fopen(name, "rb");
+    if (file == NULL)
+	return NULL;
+    if ((fread(hdr, 1, sizeof(hdr), file) != sizeof(hdr)) || (get32(hdr) != PHASE_CB_MAGIC) ||
+	(hdr[4] != PHASE_CB_VERSION) || (hdr[5] != 0)) {
+	fclose(file);
+	return NULL;
+    }
+    hsize = hdr[6] | (hdr[7] << 8);
+    b->k = get32(&hdr[8]);
+    b->m = get32(&hdr[12]);
+    b->log2m = 0;
+    b->offset = 0;
+    size = (size_t)b->k * b->m;
+
+    cb = (COMP *)malloc(size * sizeof(COMP));
+    if ((cb == NULL) || (fseek(file, hsize, SEEK_SET) != 0) ||
+	(fread(cb, sizeof(COMP), size, file) != size)) {
+	free(cb);
+	fclose(file);
+	return NULL;
+    }
+    fclose(file);
+
+    if (!little_endian()) {
+	for(i=0, p=(unsigned char *)cb; i<2*size; i++, p+=4) {
+	    u = get32(p);
+	    memcpy(p, &u, sizeof(u));
+	}
+    }
+    b->cb = cb;
+
+    return cb;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: phase_codebook_load
+  DATE CREATED: Oct 2026
+
+  Reads a text or binary codebook.  A binary codebook converted from a
+  text one and saved beside it as name.pcb, the ".txt" swapped for
+  ".pcb", is read in its place.
+
+\*---------------------------------------------------------------------------*/
+
+COMP *phase_codebook_load(struct codebook *b, const char *name)
+{
+    char   bin[1024];
+    COMP  *cb;
+    size_t len;
+
+    len = strlen(name);
+    if ((len > 4) && (len < sizeof(bin)) && (strcmp(&name[len-4], ".txt") == 0)) {
+	memcpy(bin, name, len-4);
+	strcpy(&bin[len-4], ".pcb");
+	cb = phase_codebook_load_bin(b, bin);
+	if (cb != NULL)
+	    return cb;
+    }
+
+    cb = phase_codebook_load_bin(b, name);
+    if (cb != NULL)
+	return cb;
+
+    return phase_codebook_load_text(b, name);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: phase_codebook_write_bin
+  DATE CREATED: Oct 2026
+
+  Returns 0 on success, -1 if the file can't be written.
+
+\*---------------------------------------------------------------------------*/
+
+int phase_codebook_write_bin(const struct codebook *b, const char *name)
+{
+    FILE          *file;
+    unsigned char  hdr[PHASE_CB_HEADER];
+    unsigned char  buf[8];
+    uint32_t       u;
+    size_t         size, i;
+    int            err;
+
+    file = fopen(name, "wb");
+    if (file == NULL)
+	return -1;
+
+    memset(hdr, 0, sizeof(hdr));
+    put32(&hdr[0], PHASE_CB_MAGIC);
+    hdr[4] = PHASE_CB_VERSION;
+    hdr[6] = PHASE_CB_HEADER;
+    put32(&hdr[8], b->k);
+    put32(&hdr[12], b->m);
+    err = fwrite(hdr, 1, sizeof(hdr), file) != sizeof(hdr);
+
+    size = (size_t)b->k * b->m;
+    for(i=0; !err && (i<size); i++) {
+	memcpy(&u, &b->cb[i].real, sizeof(u));
+	put32(&buf[0], u);
+	memcpy(&u, &b->cb[i].imag, sizeof(u));
+	put32(&buf[4], u);
+	err = fwrite(buf, 1, sizeof(buf), file) != sizeof(buf);
+    }
+    err |= fclose(file) != 0;
+
+    return err ? -1 : 0;
+}
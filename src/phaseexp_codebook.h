@@ -0,0 +1,69 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: phaseexp_codebook.h
+  DATE CREATED: Oct 2026
+
+  Phase VQ codebooks for the phase quantisation experiments in
+  phaseexp.c, read from text or binary files or compiled into the
+  library.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PHASEEXP_CODEBOOK__
+#define __PHASEEXP_CODEBOOK__
+
+#include <stdio.h>
+#include "comp.h"
+
+/* Binary codebook files are a 16 byte header, then the k*m entries as
+   little endian float (cos, sin) pairs, already the layout of COMP[]
+   on a little endian host:
+
+     0   magic "C2PB"
+     4   version        uint16
+     6   header size    uint16, offset of the entries
+     8   k              uint32
+     12  m              uint32
+*/
+
+#define PHASE_CB_MAGIC    0x42503243  /* "C2PB"                           */
+#define PHASE_CB_VERSION  1
+#define PHASE_CB_HEADER   16
+
+struct codebook {
+    unsigned int	 k;
+    unsigned int	 log2m;
+    unsigned int	 m;
+    const COMP          *cb;
+    unsigned int         offset;
+};
+
+/* codebooks compiled in by CODEC2_PHASEEXP_CODEBOOKS, generated by
+   generate_phase_codebook.c */
+
+#ifdef CODEC2_PHASEEXP_BUILTIN
+extern const struct codebook phase_cb[];
+#endif
+
+float get_float(FILE * in, const char * name, char * * cursor, char * buffer, int size);
+COMP *phase_codebook_load_text(struct codebook *b, const char *name);
+COMP *phase_codebook_load_bin(struct codebook *b, const char *name);
+COMP *phase_codebook_load(struct codebook *b, const char *name);
+int phase_codebook_write_bin(const struct codebook *b, const char *name);
+
+#endif
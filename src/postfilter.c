@@ -100,7 +100,8 @@
 
 void postfilter(
   MODEL *model,
-  float *bg_est
+  float *bg_est,
+  unsigned long *rand_state
 )
 {
   int   m, uv;
@@ -121,6 +122,7 @@ void postfilter(
 
   if ((e < BG_THRESH) && !model->voiced)
       *bg_est =  *bg_est*(1.0 - BG_BETA) + e*BG_BETA;
+  FLUSH_DENORMAL(*bg_est);
 
   /* now mess with phases during voiced frames to make any harmonics
      less then our background estimate unvoiced.
@@ -131,7 +133,7 @@ void postfilter(
   if (model->voiced)
       for(m=1; m<=model->L; m++)
 	  if (model->A[m] < thresh) {
-	      model->phi[m] = TWO_PI*(float)codec2_rand()/CODEC2_RAND_MAX;
+	      model->phi[m] = TWO_PI*(float)codec2_rand(rand_state)/CODEC2_RAND_MAX;
 	      uv++;
 	  }
 
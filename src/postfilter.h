@@ -28,6 +28,6 @@
 #ifndef __POSTFILTER__
 #define __POSTFILTER__
 
-void postfilter(MODEL *model, float *bg_est);
+void postfilter(MODEL *model, float *bg_est, unsigned long *rand_state);
 
 #endif
@@ -37,18 +37,50 @@
 #include "lpc.h"
 #include "lsp.h"
 #include "kiss_fft.h"
-#undef PROFILE
+#include "kiss_fftr.h"
+#include "vq.h"
 #include "machdep.h"
 
 #define LSP_DELTA1 0.01         /* grid spacing for LSP root searches */
 
+/* Codebook stages handed to the VQ search kernels.  When built, the
+   transposed copies from codebook_soa.c are searched, the row major
+   tables are still used to reconstruct the quantised vectors. */
+
+#ifdef CODEC2_CODEBOOK_SOA
+#define SEARCH_CB(cb) cb##_soa
+#else
+#define SEARCH_CB(cb) cb
+#endif
+
+/* element i of entry j of a row major stage, or of a CB_LAYOUT_Q16
+   stage when the codebooks are stored as int16 */
+
+#ifdef CODEC2_CODEBOOK_Q16
+#define CB_ELEM(s, j, i) ((s)->layout == CB_LAYOUT_Q16 ? (s)->cbq[(j)*(s)->k + (i)]*(s)->scale \
+                                                       : (s)->cb[(j)*(s)->k + (i)])
+#else
+#define CB_ELEM(s, j, i) ((s)->cb[(j)*(s)->k + (i)])
+#endif
+
+/* targets per batched VQ search, see the *_batch() functions */
+
+#define QUANTISE_BATCH 64
+
+/* LPC orders up to this evaluate A(exp(jw)) directly rather than by FFT,
+   see lpc_power_spectrum() */
+
+#define LPC_SPECTRUM_MAX_ORDER 10
+
+static float lpc_cos_tab[FFT_ENC];   /* cos(2*PI*i/FFT_ENC), quantise_init() */
+
 /*---------------------------------------------------------------------------*\
 
                           FUNCTION HEADERS
 
 \*---------------------------------------------------------------------------*/
 
-float speech_to_uq_lsps(float lsp[], float ak[], float Sn[], float w[],	int order);
+float speech_to_uq_lsps(float lsp[], float ak[], const float Sn[], const float w[], float Wr[], const float lw[], int order);
 
 /*---------------------------------------------------------------------------*\
 
@@ -56,19 +88,25 @@ float speech_to_uq_lsps(float lsp[], float ak[], float Sn[], float w[],	int orde
 
 \*---------------------------------------------------------------------------*/
 
+#if CODEC2_CB_LSP
 int lsp_bits(int i) {
     return lsp_cb[i].log2m;
 }
+#endif
 
+#if CODEC2_CB_LSPD
 int lspd_bits(int i) {
     return lsp_cbd[i].log2m;
 }
+#endif
 
-#ifndef CORTEX_M4
+#if !defined(CORTEX_M4) && CODEC2_CB_MEL
 int mel_bits(int i) {
     return mel_cb[i].log2m;
 }
+#endif
 
+#if !defined(CORTEX_M4) && CODEC2_CB_LSPMELVQ
 int lspmelvq_cb_bits(int i) {
     return lspmelvq_cb[i].log2m;
 }
@@ -80,9 +118,11 @@ int lspdt_bits(int i) {
 }
 #endif
 
+#if CODEC2_CB_JVM
 int lsp_pred_vq_bits(int i) {
     return lsp_cbjvm[i].log2m;
 }
+#endif
 
 /*---------------------------------------------------------------------------*\
 
@@ -95,6 +135,11 @@ int lsp_pred_vq_bits(int i) {
 
 void quantise_init()
 {
+    int i;
+
+    vq_init();
+    for(i=0; i<FFT_ENC; i++)
+	lpc_cos_tab[i] = cosf(TWO_PI*i/FFT_ENC);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -115,26 +160,11 @@ long quantise(const float * cb, float vec[], float w[], int k, int m, float *se)
 /* int     m;		size of codebook		*/
 /* float   *se;		accumulated squared error 	*/
 {
-   float   e;		/* current error		*/
    long	   besti;	/* best index so far		*/
    float   beste;	/* best error so far		*/
-   long	   j;
-   int     i;
-   float   diff;
 
-   besti = 0;
    beste = 1E32;
-   for(j=0; j<m; j++) {
-	e = 0.0;
-	for(i=0; i<k; i++) {
-	    diff = cb[j*k+i]-vec[i];
-	    e += powf(diff*w[i],2.0);
-	}
-	if (e < beste) {
-	    beste = e;
-	    besti = j;
-	}
-   }
+   besti = vq_nearest(VQ_DIST_WSQUARED, cb, vec, w, k, m, &beste);
 
    *se += beste;
 
@@ -143,6 +173,7 @@ long quantise(const float * cb, float vec[], float w[], int k, int m, float *se)
 
 
 
+#if CODEC2_CB_LSPD
 /*---------------------------------------------------------------------------*\
 
   encode_lspds_scalar()
@@ -254,6 +285,7 @@ void decode_lspds_scalar(
     }
 
 }
+#endif
 
 #ifdef __EXPERIMENTAL__
 /*---------------------------------------------------------------------------*\
@@ -481,42 +513,16 @@ void compute_weights_anssi_mode2(const float *x, float *w, int ndim)
 
 int find_nearest(const float *codebook, int nb_entries, float *x, int ndim)
 {
-  int i, j;
   float min_dist = 1e15;
-  int nearest = 0;
 
-  for (i=0;i<nb_entries;i++)
-  {
-    float dist=0;
-    for (j=0;j<ndim;j++)
-      dist += (x[j]-codebook[i*ndim+j])*(x[j]-codebook[i*ndim+j]);
-    if (dist<min_dist)
-    {
-      min_dist = dist;
-      nearest = i;
-    }
-  }
-  return nearest;
+  return vq_nearest(VQ_DIST_SQUARED, codebook, x, NULL, ndim, nb_entries, &min_dist);
 }
 
 int find_nearest_weighted(const float *codebook, int nb_entries, float *x, const float *w, int ndim)
 {
-  int i, j;
   float min_dist = 1e15;
-  int nearest = 0;
 
-  for (i=0;i<nb_entries;i++)
-  {
-    float dist=0;
-    for (j=0;j<ndim;j++)
-      dist += w[j]*(x[j]-codebook[i*ndim+j])*(x[j]-codebook[i*ndim+j]);
-    if (dist<min_dist)
-    {
-      min_dist = dist;
-      nearest = i;
-    }
-  }
-  return nearest;
+  return vq_nearest(VQ_DIST_WEIGHTED, codebook, x, w, ndim, nb_entries, &min_dist);
 }
 
 /*Deulis comments
@@ -561,7 +567,7 @@ void lspjvm_quantise(float *x, float *xq, int order)
 }
 */
 
-#ifndef CORTEX_M4
+#if !defined(CORTEX_M4) && CODEC2_CB_LSPMELVQ
 /* simple (non mbest) 6th order LSP MEL VQ quantiser.  Returns MSE of result */
 
 /*Deulis comment
@@ -608,45 +614,28 @@ float lspmelvq_quantise(float *x, float *xq, int order)
 }
 */
 
-#define MBEST_STAGES 4
-
-struct MBEST_LIST {
-    int   index[MBEST_STAGES];    /* index of each stage that lead us to this error */
-    float error;
-};
+/*---------------------------------------------------------------------------*\
 
-struct MBEST {
-    int                entries;   /* number of entries in mbest list   */
-    struct MBEST_LIST *list;
-};
+  mbest_init
 
+  Sets up an M-best list on caller supplied storage of at least
+  LSPMELVQ_MBEST_MAX entries, so no allocation is needed per frame.
+  Also used by the phase VQ of phaseexp.c.
 
-static struct MBEST *mbest_create(int entries) {
-    int           i,j;
-    struct MBEST *mbest;
+\*---------------------------------------------------------------------------*/
 
-    assert(entries > 0);
-    mbest = (struct MBEST *)malloc(sizeof(struct MBEST));
-    assert(mbest != NULL);
+void mbest_init(struct MBEST *mbest, struct MBEST_LIST *list, int entries) {
+    int i,j;
 
+    assert((entries > 0) && (entries <= LSPMELVQ_MBEST_MAX));
     mbest->entries = entries;
-    mbest->list = (struct MBEST_LIST *)malloc(entries*sizeof(struct MBEST_LIST));
-    assert(mbest->list != NULL);
+    mbest->list = list;
 
     for(i=0; i<mbest->entries; i++) {
 	for(j=0; j<MBEST_STAGES; j++)
 	    mbest->list[i].index[j] = 0;
 	mbest->list[i].error = 1E32;
     }
-
-    return mbest;
-}
-
-
-static void mbest_destroy(struct MBEST *mbest) {
-    assert(mbest != NULL);
-    free(mbest->list);
-    free(mbest);
 }
 
 
@@ -660,7 +649,7 @@ static void mbest_destroy(struct MBEST *mbest) {
 
 \*---------------------------------------------------------------------------*/
 
-static void mbest_insert(struct MBEST *mbest, int index[], float error) {
+void mbest_insert(struct MBEST *mbest, int index[], float error) {
     int                i, j, found;
     struct MBEST_LIST *list    = mbest->list;
     int                entries = mbest->entries;
@@ -695,32 +684,34 @@ static void mbest_print(char title[], struct MBEST *mbest) {
   mbest_search
 
   Searches vec[] to a codebbook of vectors, and maintains a list of the mbest
-  closest matches.
+  closest matches.  Distances are computed a block at a time by the VQ
+  kernels, entries that can't make the list are not inserted.
 
 \*---------------------------------------------------------------------------*/
 
+#define MBEST_BLOCK 64
+
 static void mbest_search(
-		  const float  *cb,     /* VQ codebook to search         */
+		  const struct lsp_codebook *cb, /* VQ codebook stage to search */
 		  float         vec[],  /* target vector                 */
 		  float         w[],    /* weighting vector              */
-		  int           k,      /* dimension of vector           */
-		  int           m,      /* number on entries in codebook */
 		  struct MBEST *mbest,  /* list of closest matches       */
 		  int           index[] /* indexes that lead us here     */
 )
 {
-   float   e;
-   int     i,j;
-   float   diff;
-
-   for(j=0; j<m; j++) {
-	e = 0.0;
-	for(i=0; i<k; i++) {
-	    diff = cb[j*k+i]-vec[i];
-	    e += powf(diff*w[i],2.0);
+   float   e[MBEST_BLOCK];
+   int     i,j,n,m;
+
+   m = cb->m;
+   for(j=0; j<m; j+=MBEST_BLOCK) {
+	n = (m - j) < MBEST_BLOCK ? (m - j) : MBEST_BLOCK;
+	vq_distances_cb(VQ_DIST_WSQUARED, cb, j, n, vec, w, e);
+	for(i=0; i<n; i++) {
+	    if (e[i] < mbest->list[mbest->entries-1].error) {
+		index[0] = j + i;
+		mbest_insert(mbest, index, e[i]);
+	    }
 	}
-	index[0] = j;
-	mbest_insert(mbest, index, e);
    }
 }
 
@@ -728,12 +719,28 @@ static void mbest_search(
 /* 3 stage VQ LSP quantiser useing mbest search.  Design and guidance kindly submitted by Anssi, OH3GDD */
 
 float lspmelvq_mbest_encode(int *indexes, float *x, float *xq, int ndim, int mbest_entries)
+{
+  struct LSPMELVQ_MBEST st;
+
+  return lspmelvq_mbest_encode2(&st, indexes, x, xq, ndim, mbest_entries);
+}
+
+/*
+  As per lspmelvq_mbest_encode(), using the caller's preallocated M-best
+  lists st.  Search time is roughly proportional to mbest_entries.
+*/
+
+float lspmelvq_mbest_encode2(struct LSPMELVQ_MBEST *st, int *indexes,
+                             float *x, float *xq, int ndim, int mbest_entries)
 {
   int i, j, n1, n2, n3;
-  const float *codebook1 = lspmelvq_cb[0].cb;
-  const float *codebook2 = lspmelvq_cb[1].cb;
-  const float *codebook3 = lspmelvq_cb[2].cb;
-  struct MBEST *mbest_stage1, *mbest_stage2, *mbest_stage3;
+  const struct lsp_codebook *codebook1 = &lspmelvq_cb[0];
+  const struct lsp_codebook *codebook2 = &lspmelvq_cb[1];
+  const struct lsp_codebook *codebook3 = &lspmelvq_cb[2];
+  struct MBEST  mbest[3];
+  struct MBEST *mbest_stage1 = &mbest[0];
+  struct MBEST *mbest_stage2 = &mbest[1];
+  struct MBEST *mbest_stage3 = &mbest[2];
 
 
   //Begin Deulis
@@ -749,15 +756,15 @@ float lspmelvq_mbest_encode(int *indexes, float *x, float *xq, int ndim, int mbe
   for(i=0; i<ndim; i++)
       w[i] = 1.0;
 
-  mbest_stage1 = mbest_create(mbest_entries);
-  mbest_stage2 = mbest_create(mbest_entries);
-  mbest_stage3 = mbest_create(mbest_entries);
+  assert(st != NULL);
+  for(i=0; i<3; i++)
+      mbest_init(&mbest[i], st->list[i], mbest_entries);
   for(i=0; i<MBEST_STAGES; i++)
       index[i] = 0;
 
   /* Stage 1 */
 
-  mbest_search(codebook1, x, w, ndim, lspmelvq_cb[0].m, mbest_stage1, index);
+  mbest_search(&SEARCH_CB(lspmelvq_cb)[0], x, w, mbest_stage1, index);
   //mbest_print("Stage 1:", mbest_stage1);
 
   /* Stage 2 */
@@ -765,8 +772,8 @@ float lspmelvq_mbest_encode(int *indexes, float *x, float *xq, int ndim, int mbe
   for (j=0; j<mbest_entries; j++) {
       index[1] = n1 = mbest_stage1->list[j].index[0];
       for(i=0; i<ndim; i++)
-	  target[i] = x[i] - codebook1[ndim*n1+i];
-      mbest_search(codebook2, target, w, ndim, lspmelvq_cb[1].m, mbest_stage2, index);
+	  target[i] = x[i] - CB_ELEM(codebook1, n1, i);
+      mbest_search(&SEARCH_CB(lspmelvq_cb)[1], target, w, mbest_stage2, index);
   }
   //mbest_print("Stage 2:", mbest_stage2);
 
@@ -776,8 +783,8 @@ float lspmelvq_mbest_encode(int *indexes, float *x, float *xq, int ndim, int mbe
       index[2] = n1 = mbest_stage2->list[j].index[1];
       index[1] = n2 = mbest_stage2->list[j].index[0];
       for(i=0; i<ndim; i++)
-	  target[i] = x[i] - codebook1[ndim*n1+i] - codebook2[ndim*n2+i];
-      mbest_search(codebook3, target, w, ndim, lspmelvq_cb[2].m, mbest_stage3, index);
+	  target[i] = x[i] - CB_ELEM(codebook1, n1, i) - CB_ELEM(codebook2, n2, i);
+      mbest_search(&SEARCH_CB(lspmelvq_cb)[2], target, w, mbest_stage3, index);
   }
   //mbest_print("Stage 3:", mbest_stage3);
 
@@ -786,31 +793,162 @@ float lspmelvq_mbest_encode(int *indexes, float *x, float *xq, int ndim, int mbe
   n3 = mbest_stage3->list[0].index[0];
   mse = 0.0;
   for (i=0;i<ndim;i++) {
-      tmp = codebook1[ndim*n1+i] + codebook2[ndim*n2+i] + codebook3[ndim*n3+i];
+      tmp = CB_ELEM(codebook1, n1, i) + CB_ELEM(codebook2, n2, i) + CB_ELEM(codebook3, n3, i);
       mse += (x[i]-tmp)*(x[i]-tmp);
       xq[i] = tmp;
   }
 
-  mbest_destroy(mbest_stage1);
-  mbest_destroy(mbest_stage2);
-  mbest_destroy(mbest_stage3);
-
   indexes[0] = n1; indexes[1] = n2; indexes[2] = n3;
 
   return mse;
 }
 
+/*---------------------------------------------------------------------------*\
+
+  mbest_search_batch
+
+  mbest_search() for nt targets, target t at targets[t*cb->k..] going
+  to list mbest[t] with the indexes that lead to it in index[t].  The
+  distances of all the targets are computed before any is inserted,
+  then the targets are inserted in order, so a list fed by several
+  targets ends up exactly as with mbest_search() calls.
+
+\*---------------------------------------------------------------------------*/
+
+#define MBEST_BATCH_E (QUANTISE_BATCH*MBEST_BLOCK)
+
+static void mbest_search_batch(
+		  const struct lsp_codebook *cb, /* VQ codebook stage to search  */
+		  int           nt,       /* number of targets               */
+		  float         targets[],/* target vectors                  */
+		  float         w[],      /* weighting vectors               */
+		  struct MBEST *mbest[],  /* list each target goes to        */
+		  int           index[][MBEST_STAGES] /* indexes that lead there */
+)
+{
+   float   e[MBEST_BATCH_E];
+   int     t,j,m;
+
+   m = cb->m;
+   assert(nt*m <= MBEST_BATCH_E);
+   vq_distances_batch_cb(VQ_DIST_WSQUARED, cb, 0, m, nt, targets, w, e);
+   for(t=0; t<nt; t++) {
+	for(j=0; j<m; j++) {
+	    if (e[t*m + j] < mbest[t]->list[mbest[t]->entries-1].error) {
+		index[t][0] = j;
+		mbest_insert(mbest[t], index[t], e[t*m + j]);
+	    }
+	}
+   }
+}
+
+/*
+  lspmelvq_mbest_encode2() for nvec vectors, x[v*ndim..] and
+  xq[v*ndim..], with st[v] the M-best lists of vector v.  Its indexes
+  go to indexes[v*3..] and, if mse is not NULL, its error to mse[v].
+  Each stage is searched for all the vectors, and for all their
+  M-best candidates, at once.
+*/
+
+void lspmelvq_mbest_encode_batch(struct LSPMELVQ_MBEST st[], int *indexes,
+                                 float *x, float *xq, float *mse,
+                                 int ndim, int mbest_entries, int nvec)
+{
+  int i, j, v, v0, n, s, nt, cap;
+  int n1, n2, n3;
+  const struct lsp_codebook *codebook1 = &lspmelvq_cb[0];
+  const struct lsp_codebook *codebook2 = &lspmelvq_cb[1];
+  const struct lsp_codebook *codebook3 = &lspmelvq_cb[2];
+  struct MBEST  mbest[QUANTISE_BATCH][3];
+  struct MBEST *list[QUANTISE_BATCH];
+  int           index[QUANTISE_BATCH][MBEST_STAGES];
+  float         target[QUANTISE_BATCH*LPC_ORD];
+  float         w[QUANTISE_BATCH*LPC_ORD];
+  float         e, tmp;
+
+  assert(st != NULL);
+  assert(ndim == lspmelvq_cb[0].k);
+  for(i=0; i<QUANTISE_BATCH*ndim; i++)
+      w[i] = 1.0;
+
+  for(v0=0; v0<nvec; v0+=n) {
+      n = (nvec - v0) < QUANTISE_BATCH ? (nvec - v0) : QUANTISE_BATCH;
+      for(v=0; v<n; v++)
+	  for(i=0; i<3; i++)
+	      mbest_init(&mbest[v][i], st[v0+v].list[i], mbest_entries);
+
+      /* Stage 1 */
+
+      for(v=0; v<n; v++) {
+	  list[v] = &mbest[v][0];
+	  for(i=0; i<MBEST_STAGES; i++)
+	      index[v][i] = 0;
+      }
+      mbest_search_batch(&SEARCH_CB(lspmelvq_cb)[0], n, &x[v0*ndim], w, list, index);
+
+      /* Stages 2 and 3, one target per candidate of the previous stage,
+	 searched a buffer full at a time */
+
+      for(s=1; s<3; s++) {
+	  cap = MBEST_BATCH_E/lspmelvq_cb[s].m;
+	  if (cap > QUANTISE_BATCH)
+	      cap = QUANTISE_BATCH;
+	  assert(cap > 0);
+	  nt = 0;
+	  for(v=0; v<n; v++) {
+	      for (j=0; j<mbest_entries; j++) {
+		  index[nt][3] = 0;
+		  if (s == 1) {
+		      index[nt][2] = 0;
+		      index[nt][1] = n1 = mbest[v][0].list[j].index[0];
+		      for(i=0; i<ndim; i++)
+			  target[nt*ndim+i] = x[(v0+v)*ndim+i] - CB_ELEM(codebook1, n1, i);
+		  }
+		  else {
+		      index[nt][2] = n1 = mbest[v][1].list[j].index[1];
+		      index[nt][1] = n2 = mbest[v][1].list[j].index[0];
+		      for(i=0; i<ndim; i++)
+			  target[nt*ndim+i] = x[(v0+v)*ndim+i] - CB_ELEM(codebook1, n1, i) - CB_ELEM(codebook2, n2, i);
+		  }
+		  list[nt] = &mbest[v][s];
+		  if (++nt == cap) {
+		      mbest_search_batch(&SEARCH_CB(lspmelvq_cb)[s], nt, target, w, list, index);
+		      nt = 0;
+		  }
+	      }
+	  }
+	  if (nt)
+	      mbest_search_batch(&SEARCH_CB(lspmelvq_cb)[s], nt, target, w, list, index);
+      }
+
+      for(v=0; v<n; v++) {
+	  n1 = mbest[v][2].list[0].index[2];
+	  n2 = mbest[v][2].list[0].index[1];
+	  n3 = mbest[v][2].list[0].index[0];
+	  e = 0.0;
+	  for (i=0;i<ndim;i++) {
+	      tmp = CB_ELEM(codebook1, n1, i) + CB_ELEM(codebook2, n2, i) + CB_ELEM(codebook3, n3, i);
+	      e += (x[(v0+v)*ndim+i]-tmp)*(x[(v0+v)*ndim+i]-tmp);
+	      xq[(v0+v)*ndim+i] = tmp;
+	  }
+	  indexes[(v0+v)*3+0] = n1; indexes[(v0+v)*3+1] = n2; indexes[(v0+v)*3+2] = n3;
+	  if (mse != NULL)
+	      mse[v0+v] = e;
+      }
+  }
+}
+
 
 void lspmelvq_decode(int *indexes, float *xq, int ndim)
 {
   int i, n1, n2, n3;
-  const float *codebook1 = lspmelvq_cb[0].cb;
-  const float *codebook2 = lspmelvq_cb[1].cb;
-  const float *codebook3 = lspmelvq_cb[2].cb;
+  const struct lsp_codebook *codebook1 = &lspmelvq_cb[0];
+  const struct lsp_codebook *codebook2 = &lspmelvq_cb[1];
+  const struct lsp_codebook *codebook3 = &lspmelvq_cb[2];
 
   n1 = indexes[0]; n2 = indexes[1]; n3 = indexes[2];
   for (i=0;i<ndim;i++) {
-      xq[i] = codebook1[ndim*n1+i] + codebook2[ndim*n2+i] + codebook3[ndim*n3+i];
+      xq[i] = CB_ELEM(codebook1, n1, i) + CB_ELEM(codebook2, n2, i) + CB_ELEM(codebook3, n3, i);
   }
 }
 #endif
@@ -846,6 +984,97 @@ void force_min_lsp_dist(float lsp[], int order)
 }
 
 
+/*---------------------------------------------------------------------------*\
+
+   lpc_power_spectrum()
+
+   Evaluates |A(exp(jw))|^2 at bins 0..FFT_ENC/2-1 for low order LPCs,
+   optionally bandwidth expanded by gamma^k, as re^2 + im^2 of
+
+     A(exp(jw)) = sum(k=0..order) a[k]cos(kw) - j*sum(k=0..order) a[k]sin(kw)
+
+   with cos(kw) and sin(kw) from the Chebyshev recurrence, a block of
+   LPC_SPECTRUM_BLOCK bins at a time so the loops over bins vectorise.
+   About 2*order multiply-adds per bin, much less than the FFT it
+   replaces for orders up to LPC_SPECTRUM_MAX_ORDER.  The cosine series
+   of the LPCs' autocorrelation would take half that, but for sharp
+   filters its terms cancel and rounding leaves the sum negative.
+
+\*---------------------------------------------------------------------------*/
+
+#define LPC_SPECTRUM_BLOCK 32
+
+static void lpc_power_spectrum(float P[], float ak[], int order, float gamma)
+{
+    float a[LPC_SPECTRUM_MAX_ORDER+1];
+    float twoc[LPC_SPECTRUM_BLOCK];
+    float cprev[LPC_SPECTRUM_BLOCK], ccur[LPC_SPECTRUM_BLOCK];
+    float sprev[LPC_SPECTRUM_BLOCK], scur[LPC_SPECTRUM_BLOCK];
+    float re[LPC_SPECTRUM_BLOCK], im[LPC_SPECTRUM_BLOCK];
+    float coeff, t;
+    int   b,i,k;
+
+    assert((order >= 1) && (order <= LPC_SPECTRUM_MAX_ORDER));
+
+    coeff = 1.0;
+    for(k=0; k<=order; k++) {
+	a[k] = ak[k]*coeff;
+	coeff *= gamma;
+    }
+
+    for(b=0; b<FFT_ENC/2; b+=LPC_SPECTRUM_BLOCK) {
+	for(i=0; i<LPC_SPECTRUM_BLOCK; i++) {
+	    ccur[i] = lpc_cos_tab[b+i];
+	    scur[i] = lpc_cos_tab[(b+i+3*FFT_ENC/4) & (FFT_ENC-1)];   /* sin(w) */
+	    twoc[i] = ccur[i] + ccur[i];
+	    cprev[i] = 1.0;
+	    sprev[i] = 0.0;
+	    re[i] = a[0] + a[1]*ccur[i];
+	    im[i] = -a[1]*scur[i];
+	}
+	for(k=2; k<=order; k++) {
+	    for(i=0; i<LPC_SPECTRUM_BLOCK; i++) {
+		t = twoc[i]*ccur[i] - cprev[i];
+		cprev[i] = ccur[i];
+		ccur[i] = t;
+		re[i] += a[k]*t;
+		t = twoc[i]*scur[i] - sprev[i];
+		sprev[i] = scur[i];
+		scur[i] = t;
+		im[i] -= a[k]*t;
+	    }
+	}
+	for(i=0; i<LPC_SPECTRUM_BLOCK; i++)
+	    P[b+i] = re[i]*re[i] + im[i]*im[i];
+    }
+}
+
+/*---------------------------------------------------------------------------*\
+
+   lpc_harmonic_response()
+
+   Evaluates A(exp(jw)) at the FFT bin nearest each harmonic, which is
+   all phase_synth_zero_order() samples of Aw[].  The other bins of Aw[]
+   are not written.
+
+\*---------------------------------------------------------------------------*/
+
+static void lpc_harmonic_response(COMP Aw[], float ak[], int order, MODEL *model)
+{
+    float r = TWO_PI/(FFT_ENC);
+    int   m, b, k, n;
+
+    for(m=1; m<=model->L; m++) {
+	b = (int)(m*model->Wo/r + 0.5);
+	Aw[b].real = ak[0];
+	Aw[b].imag = 0.0;
+	for(k=1, n=b; k<=order; k++, n+=b) {
+	    Aw[b].real += ak[k]*lpc_cos_tab[n & (FFT_ENC-1)];
+	    Aw[b].imag -= ak[k]*lpc_cos_tab[(n - FFT_ENC/4) & (FFT_ENC-1)];
+	}
+    }
+}
+
 /*---------------------------------------------------------------------------*\
 
    lpc_post_filter()
@@ -873,42 +1102,64 @@ void force_min_lsp_dist(float lsp[], int order)
    [ ] I think the first FFT is not rqd as we do the same
        thing in aks_to_M2().
 
+   The buffers are in pf, or on the stack if pf is NULL (not in
+   CODEC2_SCRATCH_ARENA builds, which keep them off the stack).
+
+   Returns the gain that restores Pw's energy, which aks_to_M2()
+   applies along with the LPC energy.
+
 \*---------------------------------------------------------------------------*/
 
-void lpc_post_filter(kiss_fft_cfg fft_fwd_cfg, COMP Pw[], float ak[],
-                     int order, int dump, float beta, float gamma, int bass_boost, float E)
+float lpc_post_filter(kiss_fftr_cfg fftr_fwd_cfg, COMP Pw[], float ak[],
+                      int order, int dump, float beta, float gamma, LPC_PF_WS *pf)
 {
     int   i;
-    COMP  x[FFT_ENC];   /* input to FFTs                */
-    COMP  Ww[FFT_ENC];  /* weighting spectrum           */
-    float Rw[FFT_ENC];  /* R = WA                       */
+#ifndef CODEC2_SCRATCH_ARENA
+    LPC_PF_WS pf_stack;
+#endif
+    float *x;               /* input to FFTs                */
+    COMP  *Ww;              /* weighting spectrum           */
+    float *Wp;              /* weighting power spectrum     */
+    float *Rw;              /* R = WA                       */
     float e_before, e_after, gain;
     float Pfw;
     float max_Rw, min_Rw;
     float coeff;
-    PROFILE_VAR(tstart, tfft1, taw, tfft2, tww, tr);
+    PROFILE_VAR(tstart, tfft2, tww, tr);
+
+#ifndef CODEC2_SCRATCH_ARENA
+    if (pf == NULL)
+        pf = &pf_stack;
+#endif
+    assert(pf != NULL);
+    x = pf->x; Ww = pf->Ww; Wp = pf->Wp; Rw = pf->Rw;
 
     PROFILE_SAMPLE(tstart);
 
     /* Determine weighting filter spectrum W(exp(jw)) ---------------*/
 
-    for(i=0; i<FFT_ENC; i++) {
-	x[i].real = 0.0;
-	x[i].imag = 0.0;
+    if (order <= LPC_SPECTRUM_MAX_ORDER) {
+	lpc_power_spectrum(Wp, ak, order, gamma);
+	PROFILE_SAMPLE_AND_LOG(tfft2, tstart, "        fft2");
     }
+    else {
+	for(i=0; i<FFT_ENC; i++) {
+	    x[i] = 0.0;
+	}
 
-    x[0].real = ak[0];
-    coeff = gamma;
-    for(i=1; i<=order; i++) {
-	x[i].real = ak[i] * coeff;
-        coeff *= gamma;
-    }
-    kiss_fft(fft_fwd_cfg, (kiss_fft_cpx *)x, (kiss_fft_cpx *)Ww);
+	x[0] = ak[0];
+	coeff = gamma;
+	for(i=1; i<=order; i++) {
+	    x[i] = ak[i] * coeff;
+	    coeff *= gamma;
+	}
+	kiss_fftr(fftr_fwd_cfg, x, (kiss_fft_cpx *)Ww);
 
-    PROFILE_SAMPLE_AND_LOG(tfft2, taw, "        fft2");
+	PROFILE_SAMPLE_AND_LOG(tfft2, tstart, "        fft2");
 
-    for(i=0; i<FFT_ENC/2; i++) {
-	Ww[i].real = Ww[i].real*Ww[i].real + Ww[i].imag*Ww[i].imag;
+	for(i=0; i<FFT_ENC/2; i++) {
+	    Wp[i] = Ww[i].real*Ww[i].real + Ww[i].imag*Ww[i].imag;
+	}
     }
 
     PROFILE_SAMPLE_AND_LOG(tww, tfft2, "        Ww");
@@ -917,7 +1168,7 @@ void lpc_post_filter(kiss_fft_cfg fft_fwd_cfg, COMP Pw[], float ak[],
 
     max_Rw = 0.0; min_Rw = 1E32;
     for(i=0; i<FFT_ENC/2; i++) {
-	Rw[i] = sqrtf(Ww[i].real * Pw[i].real);
+	Rw[i] = sqrtf(Wp[i] * Pw[i].real);
 	if (Rw[i] > max_Rw)
 	    max_Rw = Rw[i];
 	if (Rw[i] < min_Rw)
@@ -956,22 +1207,9 @@ void lpc_post_filter(kiss_fft_cfg fft_fwd_cfg, COMP Pw[], float ak[],
     }
     gain = e_before/e_after;
 
-    /* apply gain factor to normalise energy, and LPC Energy */
-
-    gain *= E;
-    for(i=0; i<FFT_ENC/2; i++) {
-	Pw[i].real *= gain;
-    }
-
-    if (bass_boost) {
-        /* add 3dB to first 1 kHz to account for LP effect of PF */
-
-        for(i=0; i<FFT_ENC/8; i++) {
-            Pw[i].real *= 1.4*1.4;
-        }
-    }
-
     PROFILE_SAMPLE_AND_LOG2(tr, "        filt");
+
+    return gain;
 }
 
 
@@ -981,12 +1219,85 @@ void lpc_post_filter(kiss_fft_cfg fft_fwd_cfg, COMP Pw[], float ak[],
 
    Transforms the linear prediction coefficients to spectral amplitude
    samples.  This function determines A(m) from the average energy per
-   band using an FFT.
+   band using an FFT.  For orders up to LPC_SPECTRUM_MAX_ORDER the power
+   spectrum is evaluated directly and Aw[] only at the harmonics, see
+   lpc_harmonic_response().  The buffers are in ws, set up by
+   aks_to_M2_ws_init().
+
+   If ws->env is set (see lpc_env_lookup()) the envelope before E is
+   taken from it, or found and kept there if it has none yet.  That
+   needs ak[] and the post filter settings to be the same every time
+   the entry is used.  Aw[] is still found as it depends on the pitch.
 
 \*---------------------------------------------------------------------------*/
 
+void aks_to_M2_ws_init(AKS_TO_M2_WS *ws)
+{
+  int i;
+
+  for(i=0; i<FFT_ENC; i++) {
+    ws->a[i] = 0.0;
+    ws->Pw[i].real = 0.0;
+    ws->Pw[i].imag = 0.0;
+  }
+  ws->a_order = 0;
+  ws->env = NULL;
+#ifdef CODEC2_SCRATCH_ARENA
+  ws->pf = NULL;
+#endif
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: lpc_env_lookup
+  DATE CREATED: Oct 2026
+
+  Finds the entry of cache for LSP vector lsp[], its bits compared
+  exactly.  On a hit *hit is set and the entry's ak[] (and Pw[] once
+  aks_to_M2() has filled it) are those of lsp[].  On a miss the least
+  recently added entry is given to lsp[] with have_Pw clear, and the
+  caller fills in ak[].  lpc_env_cache_init() empties the cache, which
+  must be done whenever the post filter settings change.
+
+\*---------------------------------------------------------------------------*/
+
+void lpc_env_cache_init(LPC_ENV_CACHE *cache)
+{
+  int k;
+
+  for(k=0; k<LPC_ENV_CACHE_SIZE; k++) {
+    cache->env[k].order = 0;
+    cache->env[k].have_Pw = 0;
+  }
+  cache->next = 0;
+}
+
+LPC_ENV *lpc_env_lookup(LPC_ENV_CACHE *cache, float lsp[], int order, int *hit)
+{
+  LPC_ENV *env;
+  int      k;
+
+  assert((order >= 1) && (order <= LPC_ORD));
+
+  for(k=0; k<LPC_ENV_CACHE_SIZE; k++) {
+    env = &cache->env[k];
+    if ((env->order == order) && (memcmp(env->lsp, lsp, order*sizeof(float)) == 0)) {
+      *hit = 1;
+      return env;
+    }
+  }
+
+  env = &cache->env[cache->next];
+  cache->next = (cache->next + 1) % LPC_ENV_CACHE_SIZE;
+  env->order = order;
+  memcpy(env->lsp, lsp, order*sizeof(float));
+  env->have_Pw = 0;
+  *hit = 0;
+  return env;
+}
+
 void aks_to_M2(
-  kiss_fft_cfg  fft_fwd_cfg,
+  kiss_fftr_cfg fftr_fwd_cfg,
   float         ak[],	     /* LPC's */
   int           order,
   MODEL        *model,	     /* sinusoidal model parameters for this frame */
@@ -998,50 +1309,106 @@ void aks_to_M2(
   int           bass_boost,  /* enable LPC filter 0-1kHz 3dB boost */
   float         beta,
   float         gamma,       /* LPC post filter parameters */
-  COMP          Aw[]         /* output power spectrum */
+  COMP          Aw[],        /* output power spectrum */
+  AKS_TO_M2_WS *ws           /* work space */
 )
 {
-  COMP a[FFT_ENC];	/* input to FFT for power spectrum */
-  COMP Pw[FFT_ENC];	/* output power spectrum */
+  float *a = ws->a;	/* input to FFT for power spectrum */
+  float *Aa = ws->Aa;	/* |A(exp(jw))|^2 */
+  COMP  *Pw = ws->Pw;	/* output power spectrum */
   int i,m;		/* loop variables */
   int am,bm;		/* limits of current band */
   float r;		/* no. rads/bin */
   float Em;		/* energy in band */
   float Am;		/* spectral amplitude sample */
   float signal, noise;
+  float gain = 1.0;	/* post filter gain */
+  LPC_ENV *env;		/* cached envelope, Aw[] isn't cached */
   PROFILE_VAR(tstart, tfft, tpw, tpf);
 
   PROFILE_SAMPLE(tstart);
 
+  env = (order <= LPC_SPECTRUM_MAX_ORDER) ? ws->env : NULL;
+
   r = TWO_PI/(FFT_ENC);
 
   /* Determine DFT of A(exp(jw)) --------------------------------------------*/
 
-  for(i=0; i<FFT_ENC; i++) {
-    a[i].real = 0.0;
-    a[i].imag = 0.0;
-    Pw[i].real = 0.0;
-    Pw[i].imag = 0.0;
+  /* Only Pw[0..FFT_ENC/2-1].real is written below, the rest of Pw[]
+     stays zero from aks_to_M2_ws_init() */
+
+  if ((env != NULL) && env->have_Pw) {
+    lpc_harmonic_response(Aw, ak, order, model);
+    for(i=0; i<FFT_ENC/2; i++)
+      Pw[i].real = env->Pw[i];
+    gain = env->gain;
+    PROFILE_SAMPLE(tpw);
   }
+  else {
+    if (order <= LPC_SPECTRUM_MAX_ORDER) {
+      lpc_harmonic_response(Aw, ak, order, model);
+      lpc_power_spectrum(Aa, ak, order, 1.0);
+
+      PROFILE_SAMPLE_AND_LOG(tfft, tstart, "      A(w)");
+
+      for(i=0; i<FFT_ENC/2; i++) {
+	Pw[i].real = 1.0/(Aa[i] + 1E-6);
+      }
+    }
+    else {
+      /* a[] past the order used last time is already zero */
 
-  for(i=0; i<=order; i++)
-    a[i].real = ak[i];
-  kiss_fft(fft_fwd_cfg, (kiss_fft_cpx *)a, (kiss_fft_cpx *)Aw);
+      for(i=order+1; i<=ws->a_order; i++)
+	a[i] = 0.0;
+      for(i=0; i<=order; i++)
+	a[i] = ak[i];
+      ws->a_order = order;
+      kiss_fftr(fftr_fwd_cfg, a, (kiss_fft_cpx *)Aw);
 
-  PROFILE_SAMPLE_AND_LOG(tfft, tstart, "      fft");
+      PROFILE_SAMPLE_AND_LOG(tfft, tstart, "      A(w)");
 
-  /* Determine power spectrum P(w) = E/(A(exp(jw))^2 ------------------------*/
+      /* Determine power spectrum P(w) = E/(A(exp(jw))^2 --------------------*/
 
-  for(i=0; i<FFT_ENC/2; i++) {
-    Pw[i].real = 1.0/(Aw[i].real*Aw[i].real + Aw[i].imag*Aw[i].imag + 1E-6);
+      for(i=0; i<FFT_ENC/2; i++) {
+	Pw[i].real = 1.0/(Aw[i].real*Aw[i].real + Aw[i].imag*Aw[i].imag + 1E-6);
+      }
+    }
+
+    PROFILE_SAMPLE_AND_LOG(tpw, tfft, "      Pw");
+
+    if (pf)
+#ifdef CODEC2_SCRATCH_ARENA
+      gain = lpc_post_filter(fftr_fwd_cfg, Pw, ak, order, dump, beta, gamma, ws->pf);
+#else
+      gain = lpc_post_filter(fftr_fwd_cfg, Pw, ak, order, dump, beta, gamma, NULL);
+#endif
+
+    if (env != NULL) {
+      for(i=0; i<FFT_ENC/2; i++)
+	env->Pw[i] = Pw[i].real;
+      env->gain = gain;
+      env->have_Pw = 1;
+    }
   }
 
-  PROFILE_SAMPLE_AND_LOG(tpw, tfft, "      Pw");
+  if (pf) {
+      /* apply gain factor to normalise energy, and LPC Energy */
 
-  if (pf)
-      lpc_post_filter(fft_fwd_cfg, Pw, ak, order, dump, beta, gamma, bass_boost, E);
+      gain *= E;
+      for(i=0; i<FFT_ENC/2; i++) {
+	  Pw[i].real *= gain;
+      }
+
+      if (bass_boost) {
+	  /* add 3dB to first 1 kHz to account for LP effect of PF */
+
+	  for(i=0; i<FFT_ENC/8; i++) {
+	      Pw[i].real *= 1.4*1.4;
+	  }
+      }
+  }
   else {
-      for(i=0; i<FFT_ENC; i++) {
+      for(i=0; i<FFT_ENC/2; i++) {
           Pw[i].real *= E;
       }
   }
@@ -1278,42 +1645,43 @@ float decode_Wo_dt(int index, float prev_Wo)
 
   Analyse a windowed frame of time domain speech to determine LPCs
   which are the converted to LSPs for quantisation and transmission
-  over the channel.
+  over the channel.  Wr[] is scratch of M+LPC_AC_LAGS floats for the
+  windowed speech.  lw[], from make_lag_window(), conditions the
+  autocorrelation before the LPCs are found, or is NULL.
 
 \*---------------------------------------------------------------------------*/
 
 float speech_to_uq_lsps(float lsp[],
 			float ak[],
-		        float Sn[],
-		        float w[],
+		        const float Sn[],
+		        const float w[],
+			float Wr[],
+			const float lw[],
 		        int   order
 )
 {
     int   i, roots;
-    float Wn[M];
-    
 	//Begin Deulis
 	//float R[order + 1];
 	float R[LPC_ORD + 1];
 	//End Deulis
 
-    float e, E;
+    float E;
 
-    e = 0.0;
-    for(i=0; i<M; i++) {
-	Wn[i] = Sn[i]*w[i];
-	e += Wn[i]*Wn[i];
-    }
+    assert(order <= LPC_ORD);
+    window_autocorrelate(Sn, w, Wr, R, M, order);
 
-    /* trap 0 energy case as LPC analysis will fail */
+    /* trap 0 energy case as LPC analysis will fail, R[0] is the
+       energy of the windowed speech */
 
-    if (e == 0.0) {
+    if (R[0] == 0.0) {
 	for(i=0; i<order; i++)
 	    lsp[i] = (PI/order)*(float)i;
 	return 0.0;
     }
 
-    autocorrelate(Wn, R, M, order);
+    if (lw != NULL)
+	lag_window(R, lw, order);
     levinson_durbin(R, ak, order);
 
     E = 0.0;
@@ -1341,6 +1709,66 @@ float speech_to_uq_lsps(float lsp[],
 
 
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: lsps_change_order()
+  DATE CREATED: Oct 2026
+
+  Converts the order LSPs lsps[] to order_out LSPs in lsps_out[], the
+  LPC model of the same spectrum at the new order.  Going down, the
+  LPCs are stepped down the Levinson-Durbin recursion to order_out,
+  which is the LPC analysis of the same autocorrelation at order_out,
+  and the prediction error rises by 1/(1-k*k) for each reflection
+  coefficient k dropped.  Going up the extra LPCs are zero.  Returns
+  the factor the LPC energy changes by.
+
+\*---------------------------------------------------------------------------*/
+
+float lsps_change_order(float lsps_out[], int order_out, const float lsps[], int order)
+{
+    float a[LPC_ORD+1], lsp[LPC_ORD];
+    float k, den, gain;
+    float tmp[LPC_ORD+1];
+    int   i, m, roots;
+
+    assert((order >= 2) && (order <= LPC_ORD));
+    assert((order_out >= 2) && (order_out <= LPC_ORD));
+
+    if (order_out == order) {
+	for(i=0; i<order; i++)
+	    lsps_out[i] = lsps[i];
+	return 1.0;
+    }
+
+    for(i=0; i<order; i++)
+	lsp[i] = lsps[i];
+    lsp_to_lpc(lsp, a, order);
+
+    gain = 1.0;
+    for(i=order+1; i<=order_out; i++)
+	a[i] = 0.0;
+    for(m=order; m>order_out; m--) {
+	k = a[m];
+	den = 1.0 - k*k;
+	if (den < 1E-3)
+	    den = 1E-3;
+	for(i=1; i<m; i++)
+	    tmp[i] = (a[i] - k*a[m-i])/den;
+	for(i=1; i<m; i++)
+	    a[i] = tmp[i];
+	gain /= den;
+    }
+
+    roots = lpc_to_lsp(a, order_out, lsps_out, 5, LSP_DELTA1);
+    if (roots != order_out) {
+	for(i=0; i<order_out; i++)
+	    lsps_out[i] = (PI/order_out)*(float)i;
+    }
+
+    return gain;
+}
+
+#if CODEC2_CB_LSP
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: encode_lsps_scalar()
@@ -1382,6 +1810,45 @@ void encode_lsps_scalar(int indexes[], float lsp[], int order)
     }
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: encode_lsps_scalar_batch()
+  DATE CREATED: Oct 2026
+
+  encode_lsps_scalar() for nvec LSP vectors, for example one per
+  channel of a bank.  Vector v is lsp[v*order..] and its indexes go to
+  indexes[v*order..].  Each scalar quantiser is searched for all the
+  vectors at once; the indexes are those of nvec encode_lsps_scalar()
+  calls.
+
+\*---------------------------------------------------------------------------*/
+
+void encode_lsps_scalar_batch(int indexes[], float lsp[], int order, int nvec)
+{
+    float lsp_hz[QUANTISE_BATCH];
+    float wt[QUANTISE_BATCH];
+    float e[QUANTISE_BATCH];
+    int   idx[QUANTISE_BATCH];
+    int   i, v, v0, n;
+
+    for(v=0; v<QUANTISE_BATCH; v++)
+	wt[v] = 1.0;
+
+    for(v0=0; v0<nvec; v0+=n) {
+	n = (nvec - v0) < QUANTISE_BATCH ? (nvec - v0) : QUANTISE_BATCH;
+	for(i=0; i<order; i++) {
+	    assert(lsp_cb[i].k == 1);
+	    for(v=0; v<n; v++) {
+		lsp_hz[v] = (4000.0/PI)*lsp[(v0+v)*order + i];
+		e[v] = 1E32;
+	    }
+	    vq_nearest_batch_cb(VQ_DIST_WSQUARED, &lsp_cb[i], n, lsp_hz, wt, idx, e);
+	    for(v=0; v<n; v++)
+		indexes[(v0+v)*order + i] = idx[v];
+	}
+    }
+}
+
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: decode_lsps_scalar()
@@ -1415,9 +1882,10 @@ void decode_lsps_scalar(float lsp[], int indexes[], int order)
     for(i=0; i<order; i++)
 	lsp[i] = (PI/4000.0)*lsp_hz[i];
 }
+#endif
 
 
-#ifndef CORTEX_M4
+#if !defined(CORTEX_M4) && CODEC2_CB_MEL
 
 /*---------------------------------------------------------------------------*\
 
@@ -1672,6 +2140,7 @@ void decode_lsps_diff_time(
 }
 #endif
 
+#if CODEC2_CB_JVM
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: encode_lsps_vq()
@@ -1692,10 +2161,9 @@ void encode_lsps_vq(int *indexes, float *x, float *xq, int order)
   float err[LPC_ORD], err2[LPC_ORD], err3[LPC_ORD];
   float w[LPC_ORD], w2[LPC_ORD], w3[LPC_ORD];
   //End Deulis
+  float d;
 
-  const float *codebook1 = lsp_cbjvm[0].cb;
-  const float *codebook2 = lsp_cbjvm[1].cb;
-  const float *codebook3 = lsp_cbjvm[2].cb;
+  const struct lsp_codebook *codebook1 = &lsp_cbjvm[0];
 
   w[0] = MIN(x[0], x[1]-x[0]);
   for (i=1;i<order-1;i++)
@@ -1704,11 +2172,12 @@ void encode_lsps_vq(int *indexes, float *x, float *xq, int order)
 
   compute_weights(x, w, order);
 
-  n1 = find_nearest(codebook1, lsp_cbjvm[0].m, x, order);
+  d = 1e15;
+  n1 = vq_nearest_cb(VQ_DIST_SQUARED, &SEARCH_CB(lsp_cbjvm)[0], x, NULL, &d);
 
   for (i=0;i<order;i++)
   {
-    xq[i]  = codebook1[order*n1+i];
+    xq[i]  = CB_ELEM(codebook1, n1, i);
     err[i] = x[i] - xq[i];
   }
   for (i=0;i<order/2;i++)
@@ -1718,14 +2187,87 @@ void encode_lsps_vq(int *indexes, float *x, float *xq, int order)
     w2[i] = w[2*i];
     w3[i] = w[2*i+1];
   }
-  n2 = find_nearest_weighted(codebook2, lsp_cbjvm[1].m, err2, w2, order/2);
-  n3 = find_nearest_weighted(codebook3, lsp_cbjvm[2].m, err3, w3, order/2);
+  d = 1e15;
+  n2 = vq_nearest_cb(VQ_DIST_WEIGHTED, &SEARCH_CB(lsp_cbjvm)[1], err2, w2, &d);
+  d = 1e15;
+  n3 = vq_nearest_cb(VQ_DIST_WEIGHTED, &SEARCH_CB(lsp_cbjvm)[2], err3, w3, &d);
 
   indexes[0] = n1;
   indexes[1] = n2;
   indexes[2] = n3;
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: encode_lsps_vq_batch()
+  DATE CREATED: Oct 2026
+
+  encode_lsps_vq() for nvec vectors, x[v*order..] and xq[v*order..],
+  with the LSP_PRED_VQ_INDEXES indexes of vector v at
+  indexes[v*LSP_PRED_VQ_INDEXES..].  Each stage is searched for all
+  the vectors at once.
+
+\*---------------------------------------------------------------------------*/
+
+void encode_lsps_vq_batch(int *indexes, float *x, float *xq, int order, int nvec)
+{
+  int i, v, v0, n;
+  int n1[QUANTISE_BATCH], n2[QUANTISE_BATCH], n3[QUANTISE_BATCH];
+  float err2[QUANTISE_BATCH*LPC_ORD/2], err3[QUANTISE_BATCH*LPC_ORD/2];
+  float w2[QUANTISE_BATCH*LPC_ORD/2], w3[QUANTISE_BATCH*LPC_ORD/2];
+  float d[QUANTISE_BATCH];
+  float w[LPC_ORD];
+  float *xv, *xqv;
+
+  const struct lsp_codebook *codebook1 = &lsp_cbjvm[0];
+
+  assert(order == lsp_cbjvm[0].k);
+  assert(order/2 == lsp_cbjvm[1].k);
+
+  for(v0=0; v0<nvec; v0+=n) {
+    n = (nvec - v0) < QUANTISE_BATCH ? (nvec - v0) : QUANTISE_BATCH;
+
+    for (v=0;v<n;v++)
+      d[v] = 1e15;
+    vq_nearest_batch_cb(VQ_DIST_SQUARED, &SEARCH_CB(lsp_cbjvm)[0], n, &x[v0*order], NULL, n1, d);
+
+    for (v=0;v<n;v++) {
+      xv = &x[(v0+v)*order];
+      xqv = &xq[(v0+v)*order];
+
+      w[0] = MIN(xv[0], xv[1]-xv[0]);
+      for (i=1;i<order-1;i++)
+	w[i] = MIN(xv[i]-xv[i-1], xv[i+1]-xv[i]);
+      w[order-1] = MIN(xv[order-1]-xv[order-2], PI-xv[order-1]);
+
+      compute_weights(xv, w, order);
+
+      for (i=0;i<order;i++)
+	xqv[i] = CB_ELEM(codebook1, n1[v], i);
+      for (i=0;i<order/2;i++)
+      {
+	err2[v*order/2+i] = xv[2*i] - xqv[2*i];
+	err3[v*order/2+i] = xv[2*i+1] - xqv[2*i+1];
+	w2[v*order/2+i] = w[2*i];
+	w3[v*order/2+i] = w[2*i+1];
+      }
+    }
+
+    for (v=0;v<n;v++)
+      d[v] = 1e15;
+    vq_nearest_batch_cb(VQ_DIST_WEIGHTED, &SEARCH_CB(lsp_cbjvm)[1], n, err2, w2, n2, d);
+    for (v=0;v<n;v++)
+      d[v] = 1e15;
+    vq_nearest_batch_cb(VQ_DIST_WEIGHTED, &SEARCH_CB(lsp_cbjvm)[2], n, err3, w3, n3, d);
+
+    for (v=0;v<n;v++) {
+      indexes[(v0+v)*LSP_PRED_VQ_INDEXES+0] = n1[v];
+      indexes[(v0+v)*LSP_PRED_VQ_INDEXES+1] = n2[v];
+      indexes[(v0+v)*LSP_PRED_VQ_INDEXES+2] = n3[v];
+    }
+  }
+}
+
 
 /*---------------------------------------------------------------------------*\
 
@@ -1738,26 +2280,27 @@ void encode_lsps_vq(int *indexes, float *x, float *xq, int order)
 void decode_lsps_vq(int *indexes, float *xq, int order, int stages)
 {
   int i, n1, n2, n3;
-  const float *codebook1 = lsp_cbjvm[0].cb;
-  const float *codebook2 = lsp_cbjvm[1].cb;
-  const float *codebook3 = lsp_cbjvm[2].cb;
+  const struct lsp_codebook *codebook1 = &lsp_cbjvm[0];
+  const struct lsp_codebook *codebook2 = &lsp_cbjvm[1];
+  const struct lsp_codebook *codebook3 = &lsp_cbjvm[2];
 
   n1 = indexes[0];
   n2 = indexes[1];
   n3 = indexes[2];
 
   for (i=0;i<order;i++) {
-      xq[i] = codebook1[order*n1+i];
+      xq[i] = CB_ELEM(codebook1, n1, i);
   }
 
   if (stages != 1) {
       for (i=0;i<order/2;i++) {
-          xq[2*i] += codebook2[order*n2/2+i];
-          xq[2*i+1] += codebook3[order*n3/2+i];
+          xq[2*i] += CB_ELEM(codebook2, n2, i);
+          xq[2*i+1] += CB_ELEM(codebook3, n3, i);
       }
   }
 
 }
+#endif
 
 
 /*---------------------------------------------------------------------------*\
@@ -1926,6 +2469,12 @@ int encode_energy(float e, int bits)
     float e_max = E_MAX_DB;
     float norm;
 
+    /* silence, or an LPC prediction error rounded to zero or below,
+       has no log, but would be clamped to the bottom level anyway */
+
+    if (!(e > 0.0))
+	return 0;
+
     e = 10.0*log10f(e);
     norm = (e - e_min)/(e_max - e_min);
     index = floorf(e_levels * norm + 0.5);
@@ -1994,6 +2543,7 @@ float decode_amplitudes(kiss_fft_cfg  fft_fwd_cfg,
 }
 #endif
 
+#if CODEC2_CB_GE
 static float ge_coeff[2] = {0.8, 0.9};
 
 void compute_weights2(const float *x, const float *xp, float *w)
@@ -2065,26 +2615,29 @@ void quantise_WoE(MODEL *model, float *e, float xq[])
 {
   int          i, n1;
   float        x[2];
-  float        err[2];
+  float        err[2] = {0.0, 0.0};
   float        w[2];
-  const float *codebook1 = ge_cb[0].cb;
-  int          nb_entries = ge_cb[0].m;
-  int          ndim = ge_cb[0].k;
+  float        d;
+  const struct lsp_codebook *codebook1 = &ge_cb[0];
+  const int    ndim = 2;                /* Wo and E, the size of x[] etc */
   float Wo_min = TWO_PI/P_MAX;
   float Wo_max = TWO_PI/P_MIN;
 
+  assert(ge_cb[0].k == ndim);
+
   x[0] = log10f((model->Wo/PI)*4000.0/50.0)/log10f(2);
   x[1] = 10.0*log10f(1e-4 + *e);
 
   compute_weights2(x, xq, w);
   for (i=0;i<ndim;i++)
     err[i] = x[i]-ge_coeff[i]*xq[i];
-  n1 = find_nearest_weighted(codebook1, nb_entries, err, w, ndim);
+  d = 1e15;
+  n1 = vq_nearest_cb(VQ_DIST_WEIGHTED, &SEARCH_CB(ge_cb)[0], err, w, &d);
 
   for (i=0;i<ndim;i++)
   {
-    xq[i] = ge_coeff[i]*xq[i] + codebook1[ndim*n1+i];
-    err[i] -= codebook1[ndim*n1+i];
+    xq[i] = ge_coeff[i]*xq[i] + CB_ELEM(codebook1, n1, i);
+    err[i] -= CB_ELEM(codebook1, n1, i);
   }
 
   /*
@@ -2117,17 +2670,18 @@ void quantise_WoE(MODEL *model, float *e, float xq[])
 
 \*---------------------------------------------------------------------------*/
 
-int encode_WoE(MODEL *model, float e, float xq[])
+int encode_WoE(const MODEL *model, float e, float xq[])
 {
   int          i, n1;
   float        x[2];
-  float        err[2];
+  float        err[2] = {0.0, 0.0};
   float        w[2];
-  const float *codebook1 = ge_cb[0].cb;
-  int          nb_entries = ge_cb[0].m;
-  int          ndim = ge_cb[0].k;
+  float        d;
+  const struct lsp_codebook *codebook1 = &ge_cb[0];
+  const int    ndim = 2;                /* Wo and E, the size of x[] etc */
 
-  assert((1<<WO_E_BITS) == nb_entries);
+  assert((1<<WO_E_BITS) == ge_cb[0].m);
+  assert(ge_cb[0].k == ndim);
 
   if (e < 0.0) e = 0;  /* occasional small negative energies due LPC round off I guess */
 
@@ -2137,12 +2691,13 @@ int encode_WoE(MODEL *model, float e, float xq[])
   compute_weights2(x, xq, w);
   for (i=0;i<ndim;i++)
     err[i] = x[i]-ge_coeff[i]*xq[i];
-  n1 = find_nearest_weighted(codebook1, nb_entries, err, w, ndim);
+  d = 1e15;
+  n1 = vq_nearest_cb(VQ_DIST_WEIGHTED, &SEARCH_CB(ge_cb)[0], err, w, &d);
 
   for (i=0;i<ndim;i++)
   {
-    xq[i] = ge_coeff[i]*xq[i] + codebook1[ndim*n1+i];
-    err[i] -= codebook1[ndim*n1+i];
+    xq[i] = ge_coeff[i]*xq[i] + CB_ELEM(codebook1, n1, i);
+    err[i] -= CB_ELEM(codebook1, n1, i);
   }
 
   //printf("enc: %f %f (%f)(%f) \n", xq[0], xq[1], e, 10.0*log10(1e-4 + e));
@@ -2165,14 +2720,14 @@ int encode_WoE(MODEL *model, float e, float xq[])
 void decode_WoE(MODEL *model, float *e, float xq[], int n1)
 {
   int          i;
-  const float *codebook1 = ge_cb[0].cb;
+  const struct lsp_codebook *codebook1 = &ge_cb[0];
   int          ndim = ge_cb[0].k;
   float Wo_min = TWO_PI/P_MAX;
   float Wo_max = TWO_PI/P_MIN;
 
   for (i=0;i<ndim;i++)
   {
-    xq[i] = ge_coeff[i]*xq[i] + codebook1[ndim*n1+i];
+    xq[i] = ge_coeff[i]*xq[i] + CB_ELEM(codebook1, n1, i);
   }
 
   //printf("dec: %f %f\n", xq[0], xq[1]);
@@ -2188,4 +2743,5 @@ void decode_WoE(MODEL *model, float *e, float xq[], int n1)
 
   *e = powf(10.0, xq[1]/10.0);
 }
+#endif
 
@@ -27,6 +27,7 @@
 #define __QUANTISE__
 
 #include "kiss_fft.h"
+#include "kiss_fftr.h"
 #include "comp.h"
 
 #define WO_BITS     7
@@ -53,12 +54,86 @@
 #define LPCPF_GAMMA 0.5
 #define LPCPF_BETA  0.2
 
+/* M-best search of the 3 stage mel LSP VQ */
+
+#define MBEST_STAGES         4
+#define LSPMELVQ_MBEST_MAX   5     /* longest M-best list supported          */
+#define LSPMELVQ_MBEST_FAST  2     /* list length for CODEC2_VQ_SEARCH_FAST  */
+
+struct MBEST_LIST {
+    int   index[MBEST_STAGES];    /* index of each stage that lead us to this error */
+    float error;
+};
+
+struct MBEST {
+    int                entries;   /* number of entries in mbest list   */
+    struct MBEST_LIST *list;
+};
+
+/* preallocated lists, one per stage, so the search doesn't allocate per frame */
+
+struct LSPMELVQ_MBEST {
+    struct MBEST_LIST list[3][LSPMELVQ_MBEST_MAX];
+};
+
+void mbest_init(struct MBEST *mbest, struct MBEST_LIST *list, int entries);
+void mbest_insert(struct MBEST *mbest, int index[], float error);
+
+/* lpc_post_filter() buffers, on its stack unless CODEC2_SCRATCH_ARENA
+   is defined, then in the codec's scratch arena */
+
+typedef struct {
+    float x[FFT_ENC];          /* input to FFTs                   */
+    COMP  Ww[FFT_ENC/2+1];     /* weighting spectrum              */
+    float Wp[FFT_ENC/2];       /* weighting power spectrum        */
+    float Rw[FFT_ENC];         /* R = WA                          */
+} LPC_PF_WS;
+
+/* Decoder spectral envelopes of recent LSP vectors, so a repeated
+   vector (e.g. in silence) skips lsp_to_lpc() and most of
+   aks_to_M2(), see lpc_env_lookup(). */
+
+#define LPC_ENV_CACHE_SIZE 4
+
+typedef struct {
+    int   order;               /* 0 if the entry is unused        */
+    float lsp[LPC_ORD];        /* the key                         */
+    float ak[LPC_ORD+1];       /* LPCs of lsp[]                   */
+    int   have_Pw;             /* non-zero once Pw[], gain are set */
+    float Pw[FFT_ENC/2];       /* aks_to_M2() envelope, before E  */
+    float gain;                /* lpc_post_filter() gain          */
+} LPC_ENV;
+
+typedef struct {
+    LPC_ENV env[LPC_ENV_CACHE_SIZE];
+    int     next;              /* entry replaced on the next miss */
+} LPC_ENV_CACHE;
+
+/* aks_to_M2() work space, kept per codec instance to stay off the
+   stack.  Between calls a[] is zero past a_order and Pw[] is zero
+   from FFT_ENC/2 up, so neither needs clearing each frame. */
+
+typedef struct {
+    float a[FFT_ENC];          /* input to FFT for power spectrum */
+    float Aa[FFT_ENC/2];       /* |A(exp(jw))|^2                  */
+    COMP  Pw[FFT_ENC];         /* power spectrum                  */
+    int   a_order;             /* a[] past this is zero           */
+    LPC_ENV *env;              /* envelope to use or fill, or NULL */
+#ifdef CODEC2_SCRATCH_ARENA
+    LPC_PF_WS *pf;             /* lpc_post_filter() buffers       */
+#endif
+} AKS_TO_M2_WS;
+
 void quantise_init();
 float lpc_model_amplitudes(float Sn[], float w[], MODEL *model, int order,
 			   int lsp,float ak[]);
-void aks_to_M2(kiss_fft_cfg fft_fwd_cfg, float ak[], int order, MODEL *model,
+void aks_to_M2_ws_init(AKS_TO_M2_WS *ws);
+void lpc_env_cache_init(LPC_ENV_CACHE *cache);
+LPC_ENV *lpc_env_lookup(LPC_ENV_CACHE *cache, float lsp[], int order, int *hit);
+void aks_to_M2(kiss_fftr_cfg fftr_fwd_cfg, float ak[], int order, MODEL *model,
 	       float E, float *snr, int dump, int sim_pf,
-               int pf, int bass_boost, float beta, float gamma, COMP Aw[]);
+               int pf, int bass_boost, float beta, float gamma, COMP Aw[],
+               AKS_TO_M2_WS *ws);
 
 int   encode_Wo(float Wo, int bits);
 float decode_Wo(int index, int bits);
@@ -67,6 +142,7 @@ float decode_log_Wo(int index, int bits);
 int   encode_Wo_dt(float Wo, float prev_Wo);
 float decode_Wo_dt(int index, float prev_Wo);
 void  encode_lsps_scalar(int indexes[], float lsp[], int order);
+void  encode_lsps_scalar_batch(int indexes[], float lsp[], int order, int nvec);
 void  decode_lsps_scalar(float lsp[], int indexes[], int order);
 void  encode_lspds_scalar(int indexes[], float lsp[], int order);
 void  decode_lspds_scalar(float lsp[], int indexes[], int order);
@@ -82,6 +158,7 @@ void decode_lsps_diff_time(float lsp_[],
 			   int order);
 
 void encode_lsps_vq(int *indexes, float *x, float *xq, int order);
+void encode_lsps_vq_batch(int *indexes, float *x, float *xq, int order, int nvec);
 void decode_lsps_vq(int *indexes, float *xq, int order, int stages);
 
 long quantise(const float * cb, float vec[], float w[], int k, int m, float *se);
@@ -93,13 +170,18 @@ void lspanssi_quantise(float lsps[], float lsps_[], int order, int mbest_entries
 //float lspmelvq_quantise(float *x, float *xq, int order); Deulis comments
 
 float lspmelvq_mbest_encode(int *indexes, float *x, float *xq, int ndim, int mbest_entries);
+float lspmelvq_mbest_encode2(struct LSPMELVQ_MBEST *st, int *indexes,
+                             float *x, float *xq, int ndim, int mbest_entries);
+void lspmelvq_mbest_encode_batch(struct LSPMELVQ_MBEST st[], int *indexes,
+                                 float *x, float *xq, float *mse,
+                                 int ndim, int mbest_entries, int nvec);
 void lspmelvq_decode(int *indexes, float *xq, int ndim);
 
 void encode_mels_scalar(int mel_indexes[], float mels[], int order);
 void decode_mels_scalar(float mels[], int mel_indexes[], int order);
 
 void quantise_WoE(MODEL *model, float *e, float xq[]);
-int  encode_WoE(MODEL *model, float e, float xq[]);
+int  encode_WoE(const MODEL *model, float e, float xq[]);
 void decode_WoE(MODEL *model, float *e, float xq[], int n1);
 
 int encode_energy(float e, int bits);
@@ -118,7 +200,8 @@ int mel_bits(int i);
 int lspmelvq_cb_bits(int i);
 
 void apply_lpc_correction(MODEL *model);
-float speech_to_uq_lsps(float lsp[], float ak[], float Sn[], float w[], int   order);
+float speech_to_uq_lsps(float lsp[], float ak[], const float Sn[], const float w[], float Wr[], const float lw[], int order);
+float lsps_change_order(float lsps_out[], int order_out, const float lsps[], int order);
 int check_lsp_order(float lsp[], int lpc_order);
 void bw_expand_lsps(float lsp[], int order, float min_sep_low, float min_sep_high);
 void bw_expand_lsps2(float lsp[], int order);
@@ -0,0 +1,788 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: resample.c
+  DATE CREATED: Oct 2026
+
+  Rational ratio polyphase FIR sample rate converter.  The out/in rate
+  ratio is reduced to L/M, and a Kaiser windowed sinc low pass filter
+  is designed at L times the input rate, flat to RS_PASS of the lower
+  Nyquist rate.  The stop band starts as far above that Nyquist rate
+  as the pass band edge is below it, so aliases only land in the
+  transition band above the pass band, and a 2:1 decimator comes out
+  as a half band filter.  The filter is stored as L phases of ntaps
+  coefficients each, time reversed and padded to a multiple of 8 taps,
+  so each output sample is a single contiguous dot product of one
+  phase with the latest ntaps input samples.  48 -> 8 kHz runs as 48 ->
+  16 -> 8 kHz, two decimators of one phase each, 44.1 -> 8 kHz as 44.1
+  -> 22.05 kHz then an 80/441 phase stage, 16 -> 8 kHz in one.
+  Decimators split their input into M streams and work out 32 outputs
+  at a time, skipping the zero taps.
+
+  The inner loops have SSE2, AVX2/FMA (x86) and NEON (ARM) versions,
+  picked per instance at create time.  They sum in a different order
+  to the scalar loops so the output may differ by the odd LSB between
+  them.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec2_resample.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RS_X86
+#include <immintrin.h>
+#define TARGET_SSE2  __attribute__((target("sse2")))
+#define TARGET_AVX2  __attribute__((target("avx2,fma")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RS_NEON
+#include <arm_neon.h>
+#endif
+
+#define RS_MAX_L        4096   /* largest interpolation factor            */
+#define RS_ATTEN        80.0   /* stop band attenuation, dB               */
+#define RS_PASS         0.85   /* pass band edge as a fraction of the lower Nyquist rate */
+#define RS_BLOCK        1024   /* input samples buffered per pass         */
+#define RS_TAP_ALIGN    8
+#define RS_PI           3.141592653589793
+
+typedef float (*rs_dot_fn)(const float a[], const float b[], int n);
+typedef void  (*rs_dot4_fn)(const float *a[4], const float *b[4], int n, float y[4]);
+typedef void  (*rs_fir32_fn)(const float h[], const float *x[], int n, int off, float y[32]);
+
+typedef struct {
+    int        L, M;          /* out_rate/in_rate = L/M                    */
+    int        ntaps;         /* taps per phase, multiple of RS_TAP_ALIGN  */
+    double     fc;            /* cut off, fraction of L times the input rate */
+    float     *taps;          /* L phases of ntaps, time reversed          */
+    int       *adv;           /* input advance after an output at phase p  */
+    int        phase;         /* phase of the next output                  */
+    float     *buf;           /* ntaps-1 samples of history + RS_BLOCK     */
+    int        nbuf;          /* samples in buf[]                          */
+    int        pos;           /* buf[] index of the newest sample of the next output */
+    float     *poly;          /* decimators: buf[] split into M streams     */
+    int        npoly;         /* length of each stream                     */
+    float     *hz;            /* decimators: the non zero taps ...         */
+    int       *iz;            /* ... their index in taps[] ...             */
+    int        nz;            /* ... and how many                          */
+    const float **src;        /* stream position for each non zero tap     */
+} RS_STAGE;
+
+struct CODEC2_RESAMPLER {
+    int        L, M;          /* overall out_rate/in_rate = L/M            */
+    int        delay;         /* group delay in output samples             */
+    int        nstages;
+    RS_STAGE   stage[2];
+    float     *work[2];       /* stage outputs for one input block         */
+    int        nwork[2];
+    rs_dot_fn  dot;
+    rs_dot4_fn dot4;
+    rs_fir32_fn fir32;
+};
+
+/*---------------------------------------------------------------------------*\
+
+                             DOT PRODUCTS
+
+\*---------------------------------------------------------------------------*/
+
+static float dot_scalar(const float a[], const float b[], int n)
+{
+    float s = 0.0;
+    int   i;
+
+    for(i=0; i<n; i++)
+	s += a[i]*b[i];
+
+    return s;
+}
+
+/* four independent dot products, so the sums can run side by side
+   and share one horizontal add at the end */
+
+static void dot4_scalar(const float *a[4], const float *b[4], int n, float y[4])
+{
+    int k;
+
+    for(k=0; k<4; k++)
+	y[k] = dot_scalar(a[k], b[k], n);
+}
+
+/*
+  32 consecutive outputs of a decimator at once.  Tap i of output j is
+  x[i][off+j], the input having been split into M streams so that it
+  is contiguous across outputs, which lets the outputs go across the
+  SIMD lanes with a broadcast tap.
+*/
+
+static void fir32_scalar(const float h[], const float *x[], int n, int off, float y[32])
+{
+    int i, j;
+
+    for(j=0; j<32; j++)
+	y[j] = 0.0f;
+    for(i=0; i<n; i++)
+	for(j=0; j<32; j++)
+	    y[j] += h[i]*x[i][off+j];
+}
+
+#ifdef RS_X86
+
+static TARGET_SSE2 float dot_sse2(const float a[], const float b[], int n)
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    float  s[4];
+    int    i;
+
+    for(i=0; i<n; i+=8) {
+	s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(&a[i]),   _mm_loadu_ps(&b[i])));
+	s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(&a[i+4]), _mm_loadu_ps(&b[i+4])));
+    }
+    _mm_storeu_ps(s, _mm_add_ps(s0, s1));
+
+    return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+static TARGET_AVX2 float dot_avx2(const float a[], const float b[], int n)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    float  s[8];
+    int    i;
+
+    for(i=0; i+16<=n; i+=16) {
+	s0 = _mm256_fmadd_ps(_mm256_loadu_ps(&a[i]),   _mm256_loadu_ps(&b[i]),   s0);
+	s1 = _mm256_fmadd_ps(_mm256_loadu_ps(&a[i+8]), _mm256_loadu_ps(&b[i+8]), s1);
+    }
+    if (i < n)
+	s0 = _mm256_fmadd_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i]), s0);
+    _mm256_storeu_ps(s, _mm256_add_ps(s0, s1));
+
+    return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+}
+
+static TARGET_SSE2 void dot4_sse2(const float *a[4], const float *b[4], int n, float y[4])
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    __m128 t0, t1, t2, t3;
+    int    i;
+
+    for(i=0; i<n; i+=4) {
+	s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(&a[0][i]), _mm_loadu_ps(&b[0][i])));
+	s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(&a[1][i]), _mm_loadu_ps(&b[1][i])));
+	s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(&a[2][i]), _mm_loadu_ps(&b[2][i])));
+	s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(&a[3][i]), _mm_loadu_ps(&b[3][i])));
+    }
+
+    /* transpose and add, lane k of the result is sum k */
+
+    t0 = _mm_unpacklo_ps(s0, s1);
+    t1 = _mm_unpackhi_ps(s0, s1);
+    t2 = _mm_unpacklo_ps(s2, s3);
+    t3 = _mm_unpackhi_ps(s2, s3);
+    t0 = _mm_add_ps(t0, t1);
+    t2 = _mm_add_ps(t2, t3);
+    _mm_storeu_ps(y, _mm_add_ps(_mm_movelh_ps(t0, t2), _mm_movehl_ps(t2, t0)));
+}
+
+static TARGET_AVX2 void dot4_avx2(const float *a[4], const float *b[4], int n, float y[4])
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    __m256 t;
+    int    i;
+
+    for(i=0; i<n; i+=8) {
+	s0 = _mm256_fmadd_ps(_mm256_loadu_ps(&a[0][i]), _mm256_loadu_ps(&b[0][i]), s0);
+	s1 = _mm256_fmadd_ps(_mm256_loadu_ps(&a[1][i]), _mm256_loadu_ps(&b[1][i]), s1);
+	s2 = _mm256_fmadd_ps(_mm256_loadu_ps(&a[2][i]), _mm256_loadu_ps(&b[2][i]), s2);
+	s3 = _mm256_fmadd_ps(_mm256_loadu_ps(&a[3][i]), _mm256_loadu_ps(&b[3][i]), s3);
+    }
+
+    /* hadd leaves s0 s1 s2 s3 partial sums in lanes 0..3 of each half */
+
+    t = _mm256_hadd_ps(_mm256_hadd_ps(s0, s1), _mm256_hadd_ps(s2, s3));
+    _mm_storeu_ps(y, _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1)));
+}
+
+static TARGET_SSE2 void fir32_sse2(const float h[], const float *x[], int n, int off, float y[32])
+{
+    __m128 s[8], hi;
+    int    i, q;
+
+    for(q=0; q<8; q++)
+	s[q] = _mm_setzero_ps();
+    for(i=0; i<n; i++) {
+	const float *xi = &x[i][off];
+	hi = _mm_set1_ps(h[i]);
+	for(q=0; q<8; q++)
+	    s[q] = _mm_add_ps(s[q], _mm_mul_ps(hi, _mm_loadu_ps(&xi[4*q])));
+    }
+    for(q=0; q<8; q++)
+	_mm_storeu_ps(&y[4*q], s[q]);
+}
+
+static TARGET_AVX2 void fir32_avx2(const float h[], const float *x[], int n, int off, float y[32])
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    __m256 s4 = _mm256_setzero_ps(), s5 = _mm256_setzero_ps();
+    __m256 s6 = _mm256_setzero_ps(), s7 = _mm256_setzero_ps();
+    __m256 hi;
+    int    i;
+
+    /* even and odd taps in separate sums, eight chains of fmadds
+       keep both FMA units busy */
+
+    for(i=0; i+1<n; i+=2) {
+	const float *x0 = &x[i][off], *x1 = &x[i+1][off];
+	hi = _mm256_broadcast_ss(&h[i]);
+	s0 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x0[0]),  s0);
+	s1 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x0[8]),  s1);
+	s2 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x0[16]), s2);
+	s3 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x0[24]), s3);
+	hi = _mm256_broadcast_ss(&h[i+1]);
+	s4 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x1[0]),  s4);
+	s5 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x1[8]),  s5);
+	s6 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x1[16]), s6);
+	s7 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x1[24]), s7);
+    }
+    if (i < n) {
+	const float *x0 = &x[i][off];
+	hi = _mm256_broadcast_ss(&h[i]);
+	s0 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x0[0]),  s0);
+	s1 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x0[8]),  s1);
+	s2 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x0[16]), s2);
+	s3 = _mm256_fmadd_ps(hi, _mm256_loadu_ps(&x0[24]), s3);
+    }
+    _mm256_storeu_ps(&y[0],  _mm256_add_ps(s0, s4));
+    _mm256_storeu_ps(&y[8],  _mm256_add_ps(s1, s5));
+    _mm256_storeu_ps(&y[16], _mm256_add_ps(s2, s6));
+    _mm256_storeu_ps(&y[24], _mm256_add_ps(s3, s7));
+}
+
+#endif /* RS_X86 */
+
+#ifdef RS_NEON
+
+static float dot_neon(const float a[], const float b[], int n)
+{
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+    float       s[4];
+    int         i;
+
+    for(i=0; i<n; i+=8) {
+	s0 = vmlaq_f32(s0, vld1q_f32(&a[i]),   vld1q_f32(&b[i]));
+	s1 = vmlaq_f32(s1, vld1q_f32(&a[i+4]), vld1q_f32(&b[i+4]));
+    }
+    vst1q_f32(s, vaddq_f32(s0, s1));
+
+    return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+static void dot4_neon(const float *a[4], const float *b[4], int n, float y[4])
+{
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+    float32x4_t s2 = vdupq_n_f32(0.0f), s3 = vdupq_n_f32(0.0f);
+    float32x2_t h0, h1;
+    int         i;
+
+    for(i=0; i<n; i+=4) {
+	s0 = vmlaq_f32(s0, vld1q_f32(&a[0][i]), vld1q_f32(&b[0][i]));
+	s1 = vmlaq_f32(s1, vld1q_f32(&a[1][i]), vld1q_f32(&b[1][i]));
+	s2 = vmlaq_f32(s2, vld1q_f32(&a[2][i]), vld1q_f32(&b[2][i]));
+	s3 = vmlaq_f32(s3, vld1q_f32(&a[3][i]), vld1q_f32(&b[3][i]));
+    }
+    h0 = vpadd_f32(vadd_f32(vget_low_f32(s0), vget_high_f32(s0)),
+		   vadd_f32(vget_low_f32(s1), vget_high_f32(s1)));
+    h1 = vpadd_f32(vadd_f32(vget_low_f32(s2), vget_high_f32(s2)),
+		   vadd_f32(vget_low_f32(s3), vget_high_f32(s3)));
+    vst1q_f32(y, vcombine_f32(h0, h1));
+}
+
+static void fir32_neon(const float h[], const float *x[], int n, int off, float y[32])
+{
+    float32x4_t s[8];
+    int         i, q;
+
+    for(q=0; q<8; q++)
+	s[q] = vdupq_n_f32(0.0f);
+    for(i=0; i<n; i++) {
+	const float *xi = &x[i][off];
+	for(q=0; q<8; q++)
+	    s[q] = vmlaq_n_f32(s[q], vld1q_f32(&xi[4*q]), h[i]);
+    }
+    for(q=0; q<8; q++)
+	vst1q_f32(&y[4*q], s[q]);
+}
+
+#endif /* RS_NEON */
+
+static void select_dot(struct CODEC2_RESAMPLER *r)
+{
+    r->dot  = dot_scalar;
+    r->dot4 = dot4_scalar;
+    r->fir32 = fir32_scalar;
+#ifdef RS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+	r->dot  = dot_avx2;
+	r->dot4 = dot4_avx2;
+	r->fir32 = fir32_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+	r->dot  = dot_sse2;
+	r->dot4 = dot4_sse2;
+	r->fir32 = fir32_sse2;
+    }
+#endif
+#ifdef RS_NEON
+    r->dot  = dot_neon;
+    r->dot4 = dot4_neon;
+    r->fir32 = fir32_neon;
+#endif
+}
+
+/*---------------------------------------------------------------------------*\
+
+                              FILTER DESIGN
+
+\*---------------------------------------------------------------------------*/
+
+static int gcd(int a, int b)
+{
+    while (b) {
+	int t = a % b;
+	a = b;
+	b = t;
+    }
+    return a;
+}
+
+/* zeroth order modified Bessel function of the first kind */
+
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0, q = x*x/4.0;
+    int    k;
+
+    for(k=1; term > 1E-12*sum; k++) {
+	term *= q/((double)k*k);
+	sum += term;
+    }
+    return sum;
+}
+
+/*
+  Sizes stage st for in_rate -> out_rate with the given pass and stop
+  band edges (Hz), using the Kaiser formula for the number of taps of
+  the prototype at L times in_rate.
+*/
+
+static int stage_init(RS_STAGE *st, int in_rate, int out_rate, double f_pass, double f_stop)
+{
+    double dw;
+    int    g, n;
+
+    g = gcd(in_rate, out_rate);
+    st->L = out_rate/g;
+    st->M = in_rate/g;
+    if (st->L > RS_MAX_L)
+	return -1;
+
+    dw = 2.0*RS_PI*(f_stop - f_pass)/((double)in_rate*st->L);
+    n = (int)ceil((RS_ATTEN - 8.0)/(2.285*dw)) + 1;
+    st->ntaps = (n + st->L - 1)/st->L;
+    if (st->ntaps < st->M/st->L + 2)
+	st->ntaps = st->M/st->L + 2;
+    st->ntaps = (st->ntaps + RS_TAP_ALIGN - 1)/RS_TAP_ALIGN*RS_TAP_ALIGN;
+    st->fc = 0.5*(f_pass + f_stop)/((double)in_rate*st->L);
+
+    st->taps = (float*)malloc(sizeof(float)*st->L*st->ntaps);
+    st->adv = (int*)malloc(sizeof(int)*st->L);
+    st->buf = (float*)malloc(sizeof(float)*(st->ntaps - 1 + RS_BLOCK));
+    if ((st->taps == NULL) || (st->adv == NULL) || (st->buf == NULL))
+	return -1;
+
+    if (st->L == 1) {
+	st->npoly = (st->ntaps - 1 + RS_BLOCK)/st->M + 1;
+	st->poly = (float*)malloc(sizeof(float)*st->M*st->npoly);
+	st->hz = (float*)malloc(sizeof(float)*st->ntaps);
+	st->iz = (int*)malloc(sizeof(int)*st->ntaps);
+	st->src = (const float**)malloc(sizeof(float*)*st->ntaps);
+	if ((st->poly == NULL) || (st->hz == NULL) || (st->iz == NULL) || (st->src == NULL))
+	    return -1;
+    }
+
+    return 0;
+}
+
+/*
+  Designs the L phase filter, a windowed sinc centred on prototype tap
+  c (which may be off the middle, so the overall delay comes out a
+  whole number of output samples).  Phase p holds prototype taps h[p],
+  h[p+L], h[p+2L] ... in reverse order so that the tap applied to the
+  oldest input sample comes first.  Each phase is normalised to unity
+  DC gain so the pass band ripple doesn't vary from sample to sample.
+*/
+
+static void stage_design(RS_STAGE *st, int c)
+{
+    double beta, hw, t, w, x, sum;
+    int    n, p, k;
+
+    beta = 0.1102*(RS_ATTEN - 8.7);
+    n    = st->ntaps*st->L;
+    hw   = (c < n - 1 - c) ? c : n - 1 - c;
+
+    for(p=0; p<st->L; p++) {
+	float *h = &st->taps[p*st->ntaps];
+
+	sum = 0.0;
+	for(k=0; k<st->ntaps; k++) {
+	    t = p + k*st->L - c;
+	    x = hw > 0.0 ? t/hw : 0.0;
+	    w = (x*x < 1.0) ? bessel_i0(beta*sqrt(1.0 - x*x))/bessel_i0(beta) : 0.0;
+	    h[st->ntaps-1-k] = (float)(w*(t == 0.0 ? 2.0*st->fc : sin(2.0*RS_PI*st->fc*t)/(RS_PI*t)));
+	    sum += h[st->ntaps-1-k];
+	}
+	/* the zeros of the sinc come out of sin() as rounding noise */
+
+	for(k=0; k<st->ntaps; k++)
+	    h[k] = (fabs(h[k]) < 1E-9) ? 0.0f : (float)(h[k]/sum);
+    }
+    for(p=0; p<st->L; p++)
+	st->adv[p] = (p + st->M)/st->L;
+
+    /* every other tap of a half band filter is zero, as are the taps
+       past the window of an off centre one, the decimator skips them */
+
+    if (st->L == 1) {
+	st->nz = 0;
+	for(k=0; k<st->ntaps; k++)
+	    if (st->taps[k] != 0.0f) {
+		st->hz[st->nz] = st->taps[k];
+		st->iz[st->nz++] = k;
+	    }
+    }
+}
+
+static void stage_free(RS_STAGE *st)
+{
+    free(st->taps);
+    free(st->adv);
+    free(st->buf);
+    free(st->poly);
+    free(st->hz);
+    free(st->iz);
+    free((void*)st->src);
+}
+
+static void stage_reset(RS_STAGE *st)
+{
+    /* start with ntaps-1 zeros of history, the first output is due
+       once the first input sample arrives */
+
+    memset(st->buf, 0, sizeof(float)*(st->ntaps - 1));
+    st->nbuf  = st->ntaps - 1;
+    st->pos   = st->ntaps - 1;
+    st->phase = 0;
+}
+
+static int stage_max_output(const RS_STAGE *st, int nin)
+{
+    return (int)(((long long)nin*st->L + st->M - 1)/st->M) + 1;
+}
+
+/*
+  Splits x[] into m streams, d[p*stride + t] = x[t*m + p].  The 2:1
+  and 3:1 cases are written out so the compiler can vectorise them.
+*/
+
+static void deinterleave(const float x[], int n, int m, float *d, int stride)
+{
+    int i, t, p;
+
+    t = 0;
+    if (m == 2)
+	for(; 2*t+1<n; t++) {
+	    d[t]          = x[2*t];
+	    d[stride + t] = x[2*t+1];
+	}
+    else if (m == 3)
+	for(; 3*t+2<n; t++) {
+	    d[t]            = x[3*t];
+	    d[stride + t]   = x[3*t+1];
+	    d[2*stride + t] = x[3*t+2];
+	}
+    for(i=t*m, p=0; i<n; i++) {
+	d[p*stride + t] = x[i];
+	if (++p == m) {
+	    p = 0;
+	    t++;
+	}
+    }
+}
+
+/*
+  Buffers the input RS_BLOCK samples at a time behind ntaps-1 samples
+  of history, then steps through the phases producing every output
+  whose newest input sample has arrived.  The history is moved back to
+  the start of buf[] once per block.
+*/
+
+static int stage_process(const struct CODEC2_RESAMPLER *r, RS_STAGE *st, const float in[], int nin, float out[])
+{
+    const int nhist = st->ntaps - 1;
+    int       nout, n, shift, i;
+
+    nout = 0;
+    while (nin > 0) {
+	n = nhist + RS_BLOCK - st->nbuf;
+	if (n > nin)
+	    n = nin;
+	memcpy(&st->buf[st->nbuf], in, sizeof(float)*n);
+	st->nbuf += n;
+	in  += n;
+	nin -= n;
+
+	/* decimators do runs of 32 outputs from the input split into M
+	   streams, this is the bulk of the work for 48 and 16 kHz */
+
+	if ((st->L == 1) && (st->pos < st->nbuf)) {
+	    int base = st->pos - nhist;
+	    int n32 = ((st->nbuf - 1 - st->pos)/st->M + 1)/32*32;
+
+	    if (n32 > 0) {
+		int p, t;
+
+		deinterleave(st->buf, st->nbuf, st->M, st->poly, st->npoly);
+		for(i=0; i<st->nz; i++) {
+		    p = (base + st->iz[i]) % st->M;
+		    t = (base + st->iz[i])/st->M;
+		    st->src[i] = &st->poly[p*st->npoly + t];
+		}
+		for(i=0; i<n32; i+=32)
+		    r->fir32(st->hz, st->src, st->nz, i, &out[nout + i]);
+		nout += n32;
+		st->pos += n32*st->M;
+	    }
+	}
+
+	/* outputs four at a time while there are four to do, so the
+	   sums run side by side, then the odd ones left one at a time */
+
+	while (st->pos < st->nbuf) {
+	    const float *h[4], *x[4];
+	    int          k;
+
+	    for(k=0; (k<4) && (st->pos < st->nbuf); k++) {
+		h[k] = &st->taps[st->phase*st->ntaps];
+		x[k] = &st->buf[st->pos - nhist];
+		st->pos += st->adv[st->phase];
+		st->phase += st->M - st->adv[st->phase]*st->L;
+	    }
+	    if (k == 4) {
+		r->dot4(h, x, st->ntaps, &out[nout]);
+		nout += 4;
+	    }
+	    else {
+		for(i=0; i<k; i++)
+		    out[nout++] = r->dot(h[i], x[i], st->ntaps);
+	    }
+	}
+
+	/* keep the history the next output needs */
+
+	shift = st->pos - nhist;
+	if (shift > st->nbuf)
+	    shift = st->nbuf;
+	memmove(st->buf, &st->buf[shift], sizeof(float)*(st->nbuf - shift));
+	st->nbuf -= shift;
+	st->pos  -= shift;
+    }
+
+    return nout;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_resampler_create
+  DATE CREATED: Oct 2026
+
+  Creates a converter from in_rate to out_rate Hz, or returns NULL if
+  the reduced ratio needs more than RS_MAX_L phases.
+
+  Big reductions in rate (48 -> 8 kHz and the like) are split in two.
+  A short filter first decimates by the largest integer D that keeps
+  the intermediate rate at least twice the output rate.  Its stop band
+  only has to start where aliases would land in the final pass band,
+  so it needs few taps, and the sharp filter then runs at the lower
+  rate.  That is about half the taps per output of a single stage.
+
+\*---------------------------------------------------------------------------*/
+
+struct CODEC2_RESAMPLER *codec2_resampler_create(int in_rate, int out_rate)
+{
+    struct CODEC2_RESAMPLER *r;
+    double nyq, f_stop, f_pass;
+    int    g, d, mid_rate, c0, c1n, c1, k;
+
+    if ((in_rate <= 0) || (out_rate <= 0))
+	return NULL;
+    r = (struct CODEC2_RESAMPLER*)calloc(1, sizeof(struct CODEC2_RESAMPLER));
+    if (r == NULL)
+	return NULL;
+
+    g = gcd(in_rate, out_rate);
+    r->L = out_rate/g;
+    r->M = in_rate/g;
+    nyq = 0.5*(in_rate < out_rate ? in_rate : out_rate);
+    f_pass = RS_PASS*nyq;
+    f_stop = 2.0*nyq - f_pass;
+
+    for(d=in_rate/(2*out_rate); d>=2; d--)
+	if (in_rate % d == 0)
+	    break;
+    mid_rate = (d >= 2) ? in_rate/d : in_rate;
+
+    if (d >= 2) {
+	r->nstages = 2;
+	if ((stage_init(&r->stage[0], in_rate, mid_rate, f_pass, mid_rate - f_pass) != 0) ||
+	    (stage_init(&r->stage[1], mid_rate, out_rate, f_pass, f_stop) != 0))
+	    goto fail;
+
+	/* first stage centred on a multiple of d input samples, a whole
+	   number of intermediate samples, then the second stage centred
+	   so the total is a whole number of output samples */
+
+	c0 = (r->stage[0].ntaps - 1)/2/d*d;
+	if (c0 < d)
+	    c0 = d;
+	k = c0/d*r->stage[1].L;
+	c1n = (r->stage[1].ntaps*r->stage[1].L - 1)/2;
+	r->delay = (k + c1n)/r->stage[1].M;
+	c1 = r->delay*r->stage[1].M - k;
+	if (c1 < 0)
+	    c1 = 0;
+	stage_design(&r->stage[0], c0);
+	stage_design(&r->stage[1], c1);
+    }
+    else {
+	r->nstages = 1;
+	if (stage_init(&r->stage[0], in_rate, out_rate, f_pass, f_stop) != 0)
+	    goto fail;
+	c1n = (r->stage[0].ntaps*r->stage[0].L - 1)/2;
+	r->delay = c1n/r->stage[0].M;
+	stage_design(&r->stage[0], r->delay*r->stage[0].M);
+    }
+
+    r->nwork[0] = stage_max_output(&r->stage[0], RS_BLOCK);
+    r->nwork[1] = (r->nstages == 2) ? stage_max_output(&r->stage[1], r->nwork[0]) : 0;
+    r->work[0] = (float*)malloc(sizeof(float)*r->nwork[0]);
+    r->work[1] = (float*)malloc(sizeof(float)*(r->nwork[1] + 1));
+    if ((r->work[0] == NULL) || (r->work[1] == NULL))
+	goto fail;
+
+    select_dot(r);
+    codec2_resampler_reset(r);
+
+    return r;
+
+ fail:
+    codec2_resampler_destroy(r);
+    return NULL;
+}
+
+void codec2_resampler_destroy(struct CODEC2_RESAMPLER *r)
+{
+    assert(r != NULL);
+    stage_free(&r->stage[0]);
+    stage_free(&r->stage[1]);
+    free(r->work[0]);
+    free(r->work[1]);
+    free(r);
+}
+
+void codec2_resampler_reset(struct CODEC2_RESAMPLER *r)
+{
+    int s;
+
+    assert(r != NULL);
+    for(s=0; s<r->nstages; s++)
+	stage_reset(&r->stage[s]);
+}
+
+int codec2_resampler_delay(struct CODEC2_RESAMPLER *r)
+{
+    assert(r != NULL);
+    return r->delay;
+}
+
+int codec2_resampler_max_output(struct CODEC2_RESAMPLER *r, int nin)
+{
+    assert(r != NULL);
+    return (int)(((long long)nin*r->L + r->M - 1)/r->M) + r->nstages;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: codec2_resampler_process
+  DATE CREATED: Oct 2026
+
+  Runs the input through the stages RS_BLOCK samples at a time, in
+  float, and rounds and clips the output back to 16 bits.
+
+\*---------------------------------------------------------------------------*/
+
+int codec2_resampler_process(struct CODEC2_RESAMPLER *r, const short in[], int nin, short out[])
+{
+    float  x[RS_BLOCK], y, *yv;
+    int    nout, n, m, i;
+
+    assert(r != NULL);
+    assert(nin >= 0);
+
+    nout = 0;
+    while (nin > 0) {
+	n = (nin < RS_BLOCK) ? nin : RS_BLOCK;
+	for(i=0; i<n; i++)
+	    x[i] = in[i];
+	in  += n;
+	nin -= n;
+
+	m = stage_process(r, &r->stage[0], x, n, r->work[0]);
+	yv = r->work[0];
+	if (r->nstages == 2) {
+	    m = stage_process(r, &r->stage[1], r->work[0], m, r->work[1]);
+	    yv = r->work[1];
+	}
+
+	for(i=0; i<m; i++) {
+	    y = yv[i] + (yv[i] >= 0.0f ? 0.5f : -0.5f);
+	    out[nout++] = y > 32767.0f ? 32767 : (y < -32768.0f ? -32768 : (short)y);
+	}
+    }
+
+    return nout;
+}
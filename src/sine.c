@@ -31,13 +31,18 @@
 
 \*---------------------------------------------------------------------------*/
 
+#include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "defines.h"
 #include "sine.h"
 #include "kiss_fft.h"
+#include "kiss_fftr.h"
+#include "fastmath.h"
+#include "machdep.h"
 
 #define HPF_BETA 0.125
 
@@ -47,7 +52,7 @@
 
 \*---------------------------------------------------------------------------*/
 
-void hs_pitch_refinement(MODEL *model, COMP Sw[], float pmin, float pmax,
+void hs_pitch_refinement(MODEL *model, const float P[], float pmin, float pmax,
 			 float pstep);
 
 /*---------------------------------------------------------------------------*\
@@ -195,19 +200,21 @@ float hpf(float x, float states[])
   AUTHOR......: David Rowe
   DATE CREATED: 27/5/94
 
-  Finds the DFT of the current speech input speech frame.
+  Finds the DFT of the current speech input speech frame.  The input is
+  real so a real FFT is used, and the upper half of Sw[] filled in by
+  conjugate symmetry, as the amplitude estimators of the highest
+  harmonics sample a few bins past FFT_ENC/2.
 
 \*---------------------------------------------------------------------------*/
 
-void dft_speech(kiss_fft_cfg fft_fwd_cfg, COMP Sw[], float Sn[], float w[])
+void dft_speech(kiss_fftr_cfg fftr_fwd_cfg, COMP Sw[], float Sn[], float w[])
 {
 	
-  int  i;
-  COMP sw[FFT_ENC];
+  int   i;
+  float sw[FFT_ENC];
 
   for(i=0; i<FFT_ENC; i++) {
-    sw[i].real = 0.0;
-    sw[i].imag = 0.0;
+    sw[i] = 0.0;
   }
 
   
@@ -217,16 +224,68 @@ void dft_speech(kiss_fft_cfg fft_fwd_cfg, COMP Sw[], float Sn[], float w[])
   /* move 2nd half to start of FFT input vector */
 
   for(i=0; i<NW/2; i++)
-    sw[i].real = Sn[i+M/2]*w[i+M/2];
+    sw[i] = Sn[i+M/2]*w[i+M/2];
 
   /* move 1st half to end of FFT input vector */
 
   for(i=0; i<NW/2; i++)
-    sw[FFT_ENC-NW/2+i].real = Sn[i+M/2-NW/2]*w[i+M/2-NW/2];  
+    sw[FFT_ENC-NW/2+i] = Sn[i+M/2-NW/2]*w[i+M/2-NW/2];
 
   
 
-  kiss_fft(fft_fwd_cfg, (kiss_fft_cpx*)sw, (kiss_fft_cpx *)Sw);
+  kiss_fftr(fftr_fwd_cfg, sw, (kiss_fft_cpx *)Sw);
+
+  for(i=1; i<FFT_ENC/2; i++) {
+    Sw[FFT_ENC-i].real =  Sw[i].real;
+    Sw[FFT_ENC-i].imag = -Sw[i].imag;
+  }
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: sw_power
+  DATE CREATED: Oct 2026
+
+  Finds the power spectrum of Sw[] and its running sums, see SW_POWER.
+  Each P[b] is formed just as the estimators formed it from Sw[b], so
+  they give the same results from it.
+
+\*---------------------------------------------------------------------------*/
+
+void sw_power(SW_POWER *pw, COMP Sw[])
+{
+  const float *x = (const float *)Sw;
+  int   b;
+#ifndef CORTEX_M4
+  double acc;
+#endif
+
+  for(b=0; b<FFT_ENC; b++)
+    pw->P[b] = x[2*b]*x[2*b] + x[2*b+1]*x[2*b+1];
+
+#ifndef CORTEX_M4
+  acc = 0.0;
+  pw->C[0] = 0.0;
+  for(b=0; b<SW_POWER_NC; b++) {
+    acc += pw->P[b];
+    pw->C[b+1] = acc;
+  }
+#endif
+}
+
+/* energy of bins a..b-1 */
+
+static float band_power(const SW_POWER *pw, int a, int b)
+{
+#ifndef CORTEX_M4
+  assert((a >= 0) && (b <= SW_POWER_NC));
+  return pw->C[b] - pw->C[a];
+#else
+  float e = 0.0;
+  for(; a<b; a++)
+    e += pw->P[a];
+  return e;
+#endif
 }
 
 /*---------------------------------------------------------------------------*\
@@ -236,11 +295,11 @@ void dft_speech(kiss_fft_cfg fft_fwd_cfg, COMP Sw[], float Sn[], float w[])
   DATE CREATED: 27/5/94
 
   Refines the current pitch estimate using the harmonic sum pitch
-  estimation technique.
+  estimation technique, on the power spectrum from sw_power().
 
 \*---------------------------------------------------------------------------*/
 
-void two_stage_pitch_refinement(MODEL *model, COMP Sw[])
+void two_stage_pitch_refinement(MODEL *model, const SW_POWER *pw)
 {
   float pmin,pmax,pstep;	/* pitch refinment minimum, maximum and step */
 
@@ -249,14 +308,14 @@ void two_stage_pitch_refinement(MODEL *model, COMP Sw[])
   pmax = TWO_PI/model->Wo + 5;
   pmin = TWO_PI/model->Wo - 5;
   pstep = 1.0;
-  hs_pitch_refinement(model,Sw,pmin,pmax,pstep);
+  hs_pitch_refinement(model,pw->P,pmin,pmax,pstep);
 
   /* Fine refinement */
 
   pmax = TWO_PI/model->Wo + 1;
   pmin = TWO_PI/model->Wo - 1;
   pstep = 0.25;
-  hs_pitch_refinement(model,Sw,pmin,pmax,pstep);
+  hs_pitch_refinement(model,pw->P,pmin,pmax,pstep);
 
   /* Limit range */
 
@@ -279,13 +338,14 @@ void two_stage_pitch_refinement(MODEL *model, COMP Sw[])
  pmin   pitch search range minimum
  pmax	pitch search range maximum
  step   pitch search step size
+ P      power spectrum of the frame, |Sw[b]|^2
  model	current pitch estimate in model.Wo
 
  model 	refined pitch estimate in model.Wo
 
 \*---------------------------------------------------------------------------*/
 
-void hs_pitch_refinement(MODEL *model, COMP Sw[], float pmin, float pmax, float pstep)
+void hs_pitch_refinement(MODEL *model, const float P[], float pmin, float pmax, float pstep)
 {
   int m;		/* loop variable */
   int b;		/* bin for current harmonic centre */
@@ -313,7 +373,7 @@ void hs_pitch_refinement(MODEL *model, COMP Sw[], float pmin, float pmax, float
     /* Sum harmonic magnitudes */
     for(m=1; m<=model->L; m++) {
         b = (int)(m*Wo*one_on_r + 0.5);
-        E += Sw[b].real*Sw[b].real + Sw[b].imag*Sw[b].imag;
+        E += P[b];
     }
     /* Compare to see if this is a maximum */
 
@@ -326,64 +386,206 @@ void hs_pitch_refinement(MODEL *model, COMP Sw[], float pmin, float pmax, float
   model->Wo = Wom;
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: hs_pitch_refinement_fast
+  DATE CREATED: Oct 2026
+
+  hs_pitch_refinement() on the power spectrum P[] of Sw[].  Prest[b]
+  is the sum of P[] above bin b, which bounds whatever the harmonics
+  above b can add, so once the first half of the harmonics plus that
+  can't beat the best energy found the pitch is dropped.  The harmonic
+  bins are stepped to rather than each found from m*Wo, which rounds
+  a bin differently now and then.
+
+\*---------------------------------------------------------------------------*/
+
+static void hs_pitch_refinement_fast(MODEL *model, const float P[], const float Prest[],
+				     float pmin, float pmax, float pstep)
+{
+  int   m, b, L;
+  float E, Em, Wo, Wom, f, step, one_on_r, p;
+
+  L = model->L = PI/model->Wo;
+  Wom = model->Wo;
+  Em = 0.0;
+  one_on_r = FFT_ENC/TWO_PI;
+
+  for(p=pmin; p<=pmax; p+=pstep) {
+    E = 0.0;
+    Wo = TWO_PI/p;
+    step = Wo*one_on_r;
+    f = step + 0.5;
+    for(m=1; m<=L/2; m++, f+=step)
+      E += P[(int)f];
+    b = (int)(f - step);
+    if (E + Prest[b] <= Em)
+      continue;
+    for(; m<=L; m++, f+=step)
+      E += P[(int)f];
+    if (E > Em) {
+      Em = E;
+      Wom = Wo;
+    }
+  }
+
+  model->Wo = Wom;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: fast_pitch_refinement
+  DATE CREATED: Oct 2026
+
+  Quicker two_stage_pitch_refinement(), over the same trial pitches.
+  Trial pitches that can't win are
+  abandoned half way (see hs_pitch_refinement_fast()).  Now and then
+  the pitch differs from two_stage_pitch_refinement()'s by one step.
+
+\*---------------------------------------------------------------------------*/
+
+/* The coarse search, then one of +/- fine about its pick in steps of
+   fstep */
+
+static void pruned_pitch_refinement(MODEL *model, const SW_POWER *pw, float fine, float fstep)
+{
+  const float *P = pw->P;
+  float Prest[FFT_ENC]; /* sum of P[b+1 .. nbins-1]    */
+  float p0;
+  int   b, nbins;
+
+  /* the highest bin either search reaches, the coarse one's L
+     harmonics of its shortest pitch */
+
+  p0 = TWO_PI/model->Wo;
+  nbins = (int)(PI/model->Wo)*(TWO_PI/(p0 - 5.0))*(FFT_ENC/TWO_PI) + 2.5;
+  if (nbins > FFT_ENC)
+    nbins = FFT_ENC;
+
+  Prest[nbins-1] = 0.0;
+  for(b=nbins-2; b>=0; b--)
+    Prest[b] = Prest[b+1] + P[b+1];
+
+  /* coarse, then about the coarse pick */
+
+  hs_pitch_refinement_fast(model, P, Prest, p0 - 5, p0 + 5, 1.0);
+  p0 = TWO_PI/model->Wo;
+  hs_pitch_refinement_fast(model, P, Prest, p0 - fine, p0 + fine, fstep);
+
+  if (model->Wo < TWO_PI/P_MAX)
+    model->Wo = TWO_PI/P_MAX;
+  if (model->Wo > TWO_PI/P_MIN)
+    model->Wo = TWO_PI/P_MIN;
+
+  model->L = floorf(PI/model->Wo);
+}
+
+void fast_pitch_refinement(MODEL *model, const SW_POWER *pw)
+{
+  pruned_pitch_refinement(model, pw, 1.0, 0.25);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: coarse_pitch_refinement
+  DATE CREATED: Oct 2026
+
+  fast_pitch_refinement() with a fine search of three trial pitches
+  half a sample apart rather than nine a quarter apart, so the pitch
+  is found to half a sample.
+
+\*---------------------------------------------------------------------------*/
+
+void coarse_pitch_refinement(MODEL *model, const SW_POWER *pw)
+{
+  pruned_pitch_refinement(model, pw, 0.5, 0.5);
+}
+
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: estimate_amplitudes
   AUTHOR......: David Rowe
   DATE CREATED: 27/5/94
 
-  Estimates the complex amplitudes of the harmonics.
+  Estimates the amplitudes of the harmonics, each the root of the
+  energy of its band of the power spectrum pw from sw_power(), and
+  with est_phase their phases from Sw[].
 
 \*---------------------------------------------------------------------------*/
 
-void estimate_amplitudes(MODEL *model, COMP Sw[], COMP W[], int est_phase)
+void estimate_amplitudes(MODEL *model, COMP Sw[], const SW_POWER *pw, int est_phase)
 {
-  int   i,m;		/* loop variables */
+  int   m;		/* loop variables */
   int   am,bm;		/* bounds of current harmonic */
   int   b;		/* DFT bin of centre of current harmonic */
-  float den;		/* denominator of amplitude expression */
   float r, one_on_r;	/* number of rads/bin */
-  int   offset;
-  COMP  Am;
 
   r = TWO_PI/FFT_ENC;
   one_on_r = 1.0/r;
 
   for(m=1; m<=model->L; m++) {
-    den = 0.0;
     am = (int)((m - 0.5)*model->Wo*one_on_r + 0.5);
     bm = (int)((m + 0.5)*model->Wo*one_on_r + 0.5);
-    b = (int)(m*model->Wo/r + 0.5);
-
-    /* Estimate ampltude of harmonic */
-
-    den = 0.0;
-    Am.real = Am.imag = 0.0;
-    offset = FFT_ENC/2 - (int)(m*model->Wo*one_on_r + 0.5);
-    for(i=am; i<bm; i++) {
-      den += Sw[i].real*Sw[i].real + Sw[i].imag*Sw[i].imag;
-      Am.real += Sw[i].real*W[i + offset].real;
-      Am.imag += Sw[i].imag*W[i + offset].real;
-    }
 
-    model->A[m] = sqrtf(den);
+    model->A[m] = sqrtf(band_power(pw, am, bm));
 
     if (est_phase) {
 
         /* Estimate phase of harmonic, this is expensive in CPU for
            embedded devicesso we make it an option */
 
+        b = (int)(m*model->Wo/r + 0.5);
         model->phi[m] = atan2f(Sw[b].imag,Sw[b].real);
     }
   }
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: make_voicing_table
+  DATE CREATED: Oct 2026
+
+  Fills tab with the band energies of the analysis window spectrum W[]
+  that est_voicing_mbe() needs, summed just as it would sum them.
+
+\*---------------------------------------------------------------------------*/
+
+void make_voicing_table(VOICING_TAB *tab, COMP W[])
+{
+    int   s, n;
+    float den;
+
+    for(s=0; s<VOICING_TAB_NS; s++) {
+	den = 0.0;
+	for(n=0; n<VOICING_TAB_LEN; n++) {
+	    tab->den[s][n] = den;
+	    den += W[VOICING_TAB_S0+s+n].real*W[VOICING_TAB_S0+s+n].real;
+	}
+    }
+}
+
 /*---------------------------------------------------------------------------*\
 
   est_voicing_mbe()
 
   Returns the error of the MBE cost function for a fiven F0.
 
+  Only the bins of Sw_[] and Ew[] about the harmonics below 1000 Hz
+  are written.  If dirty[] is NULL both arrays are cleared first.
+  Otherwise they must be zero outside bins dirty[0] .. dirty[1]-1
+  (e.g. as left by the previous call), only those are cleared, and
+  dirty[] gets the bins written this time.  If Sw_ is NULL neither
+  array is written, only the error is found, and Ew and dirty are
+  ignored.
+
+  tab, from make_voicing_table(), supplies the window energy of each
+  band, or NULL to sum it here.  The results are the same either way.
+
+  pw, the power spectrum from sw_power(), or NULL.  When only the error
+  is found it gives each band's error as its energy less that of the
+  fitted harmonic, rather than from a second pass over the band.  This
+  rounds differently, so the snr can differ in the last few bits.
+
   Note: I think a lot of the operations below can be simplified as
   W[].imag = 0 and has been normalised such that den always equals 1.
 
@@ -393,9 +595,12 @@ float est_voicing_mbe(
     MODEL *model,
     COMP   Sw[],
     COMP   W[],
-    COMP   Sw_[],         /* DFT of all voiced synthesised signal  */
-                          /* useful for debugging/dump file        */
-    COMP   Ew[])          /* DFT of error                          */
+    const VOICING_TAB *tab, /* band energies of W[], or NULL       */
+    const SW_POWER *pw,   /* power spectrum of Sw[], or NULL       */
+    COMP   Sw_[],         /* DFT of all voiced synthesised signal, */
+                          /* useful for debugging/dump file, or NULL */
+    COMP   Ew[],          /* DFT of error                          */
+    int    dirty[])       /* bins that may be non-zero, or NULL    */
 {
 	
 
@@ -408,6 +613,9 @@ float est_voicing_mbe(
     float sig, snr;
     float elow, ehigh, eratio;
     float sixty;
+    int   lo, hi;         /* bins cleared, then bins written */
+    int   s;              /* first W[] bin of the band */
+    float wm, er, ei, eb;
 
 	
 
@@ -415,12 +623,20 @@ float est_voicing_mbe(
     for(l=1; l<=model->L/4; l++) {
 	sig += model->A[l]*model->A[l];
     }
-    for(i=0; i<FFT_ENC; i++) {
-	Sw_[i].real = 0.0;
-	Sw_[i].imag = 0.0;
-	Ew[i].real = 0.0;
-	Ew[i].imag = 0.0;
+    if (Sw_ != NULL) {
+	lo = 0; hi = FFT_ENC;
+	if (dirty != NULL) {
+	    lo = dirty[0];
+	    hi = dirty[1];
+	}
+	for(i=lo; i<hi; i++) {
+	    Sw_[i].real = 0.0;
+	    Sw_[i].imag = 0.0;
+	    Ew[i].real = 0.0;
+	    Ew[i].imag = 0.0;
+	}
     }
+    lo = FFT_ENC; hi = 0;
 
     Wo = model->Wo;
     error = 1E-4;
@@ -435,22 +651,56 @@ float est_voicing_mbe(
 	den = 0.0;
 	al = ceilf((l - 0.5)*Wo*FFT_ENC/TWO_PI);
 	bl = ceilf((l + 0.5)*Wo*FFT_ENC/TWO_PI);
+	if (al < lo)
+	    lo = al;
+	if (bl > hi)
+	    hi = bl;
 
 	/* Estimate amplitude of harmonic assuming harmonic is totally voiced */
 
         offset = FFT_ENC/2 - l*Wo*FFT_ENC/TWO_PI + 0.5;
-	for(m=al; m<bl; m++) {
-	    Am.real += Sw[m].real*W[offset+m].real;
-	    Am.imag += Sw[m].imag*W[offset+m].real;
-	    den += W[offset+m].real*W[offset+m].real;
-        }
+	s = offset+al - VOICING_TAB_S0;
+	if ((tab != NULL) && (s >= 0) && (s < VOICING_TAB_NS) &&
+	    (bl-al >= 0) && (bl-al < VOICING_TAB_LEN)) {
+	    for(m=al; m<bl; m++) {
+		Am.real += Sw[m].real*W[offset+m].real;
+		Am.imag += Sw[m].imag*W[offset+m].real;
+	    }
+	    den = tab->den[s][bl-al];
+	}
+	else {
+	    for(m=al; m<bl; m++) {
+		Am.real += Sw[m].real*W[offset+m].real;
+		Am.imag += Sw[m].imag*W[offset+m].real;
+		den += W[offset+m].real*W[offset+m].real;
+	    }
+	}
+
+	/* |Sw - Am*W|^2 summed over the band is the band energy less
+	   |Am|^2*den, as den is the energy of W[] over the band */
+
+	if ((Sw_ == NULL) && (pw != NULL)) {
+	    eb = band_power(pw, al, bl) - (Am.real*Am.real + Am.imag*Am.imag)/den;
+	    if (eb > 0.0)
+		error += eb;
+	    continue;
+	}
 
         Am.real = Am.real/den;
         Am.imag = Am.imag/den;
 
         /* Determine error between estimated harmonic and original */
 
-        offset = FFT_ENC/2 - l*Wo*FFT_ENC/TWO_PI + 0.5;
+	if (Sw_ == NULL) {
+	    for(m=al; m<bl; m++) {
+		wm = W[offset+m].real;
+		er = Sw[m].real - Am.real*wm;
+		ei = Sw[m].imag - Am.imag*wm;
+		error += er*er;
+		error += ei*ei;
+	    }
+	    continue;
+	}
         for(m=al; m<bl; m++) {
 	    Sw_[m].real = Am.real*W[offset+m].real;
 	    Sw_[m].imag = Am.imag*W[offset+m].real;
@@ -461,6 +711,11 @@ float est_voicing_mbe(
 	}
     }
 
+    if ((Sw_ != NULL) && (dirty != NULL)) {
+	dirty[0] = lo < hi ? lo : 0;
+	dirty[1] = lo < hi ? hi : 0;
+    }
+
     snr = 10.0*log10f(sig/error);
     if (snr > V_THRESH)
 	model->voiced = 1;
@@ -524,7 +779,7 @@ float est_voicing_mbe(
 
 \*---------------------------------------------------------------------------*/
 
-void make_synthesis_window(float Pn[])
+static void make_synthesis_window_k(float Pn[], int k)
 {
   int   i;
   float win;
@@ -532,20 +787,136 @@ void make_synthesis_window(float Pn[])
   /* Generate Parzen window in time domain */
 
   win = 0.0;
-  for(i=0; i<N/2-TW; i++)
+  for(i=0; i<k*(N/2-TW); i++)
     Pn[i] = 0.0;
   win = 0.0;
-  for(i=N/2-TW; i<N/2+TW; win+=1.0/(2*TW), i++ )
+  for(i=k*(N/2-TW); i<k*(N/2+TW); win+=1.0/(2*k*TW), i++ )
     Pn[i] = win;
-  for(i=N/2+TW; i<3*N/2-TW; i++)
+  for(i=k*(N/2+TW); i<k*(3*N/2-TW); i++)
     Pn[i] = 1.0;
   win = 1.0;
-  for(i=3*N/2-TW; i<3*N/2+TW; win-=1.0/(2*TW), i++)
+  for(i=k*(3*N/2-TW); i<k*(3*N/2+TW); win-=1.0/(2*k*TW), i++)
     Pn[i] = win;
-  for(i=3*N/2+TW; i<2*N; i++)
+  for(i=k*(3*N/2+TW); i<2*k*N; i++)
     Pn[i] = 0.0;
 }
 
+void make_synthesis_window(float Pn[])
+{
+  make_synthesis_window_k(Pn, 1);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  Overlap-add of synthesise(), built for the baseline instruction set
+  and again for AVX2 on x86, and chosen at run time by
+  synthesise_select_kernels().  Element wise, so the variants give
+  identical results.  When shifting, the previous frame's tail is read
+  straight from the top half of Sn_[] in the same pass rather than
+  moved down first.
+
+\*---------------------------------------------------------------------------*/
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SINE_X86
+#define SINE_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__SSE2__)
+#define SINE_DEFAULT_NAME "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SINE_DEFAULT_NAME "neon"
+#else
+#define SINE_DEFAULT_NAME "scalar"
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SINE_INLINE inline __attribute__((always_inline))
+#else
+#define SINE_INLINE inline
+#endif
+
+static SINE_INLINE void synth_ola_impl(float Sn_[], const float sw_[], const float Pn[], int shift)
+{
+    int i,j;
+
+    if (shift) {
+	for(i=0; i<N-1; i++)
+	    Sn_[i] = Sn_[i+N] + sw_[FFT_DEC-N+1+i]*Pn[i];
+	for(i=N-1,j=0; i<2*N; i++,j++)
+	    Sn_[i] = sw_[j]*Pn[i];
+    }
+    else {
+	for(i=0; i<N-1; i++)
+	    Sn_[i] += sw_[FFT_DEC-N+1+i]*Pn[i];
+	for(i=N-1,j=0; i<2*N; i++,j++)
+	    Sn_[i] += sw_[j]*Pn[i];
+    }
+}
+
+static void synth_ola_default(float Sn_[], const float sw_[], const float Pn[], int shift)
+{
+    synth_ola_impl(Sn_, sw_, Pn, shift);
+}
+
+#ifdef SINE_X86
+static SINE_AVX2 void synth_ola_avx2(float Sn_[], const float sw_[], const float Pn[], int shift)
+{
+    synth_ola_impl(Sn_, sw_, Pn, shift);
+}
+#endif
+
+static void (*synth_ola_fn)(float Sn_[], const float sw_[], const float Pn[], int shift) = synth_ola_default;
+static const char *synth_ola_name = SINE_DEFAULT_NAME;
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: synthesise_select_kernels
+  DATE CREATED: Oct 2026
+
+  Picks the overlap-add variant for the machdep_cpu_features() given.
+
+\*---------------------------------------------------------------------------*/
+
+void synthesise_select_kernels(int features)
+{
+    synth_ola_fn = synth_ola_default;
+    synth_ola_name = SINE_DEFAULT_NAME;
+#ifdef SINE_X86
+    if (features & MACHDEP_CPU_AVX2) {
+	synth_ola_fn = synth_ola_avx2;
+	synth_ola_name = "avx2";
+    }
+#else
+    (void)features;
+#endif
+}
+
+const char *synthesise_kernel_name(void)
+{
+    return synth_ola_name;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: synth_ws_init
+  DATE CREATED: Oct 2026
+
+  Clears a synthesise() work space.  Sw_[] then stays zero between
+  calls, each call only clears the bins it set.
+
+\*---------------------------------------------------------------------------*/
+
+void synth_ws_init(SYNTH_WS *ws)
+{
+    int i;
+
+    for(i=0; i<FFT_DEC/2+1; i++) {
+	ws->Sw_[i].real = 0.0;
+	ws->Sw_[i].imag = 0.0;
+    }
+}
+
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: synthesise
@@ -554,34 +925,24 @@ void make_synthesis_window(float Pn[])
 
   Synthesise a speech signal in the frequency domain from the
   sinusodal model parameters.  Uses overlap-add with a trapezoidal
-  window to smoothly interpolate betwen frames.
+  window to smoothly interpolate betwen frames.  The DFT and time
+  domain buffers are in ws, set up by synth_ws_init().
 
 \*---------------------------------------------------------------------------*/
 
 void synthesise(
-  kiss_fft_cfg fft_inv_cfg,
+  kiss_fftr_cfg fftr_inv_cfg,
   float  Sn_[],		/* time domain synthesised signal              */
   MODEL *model,		/* ptr to model parameters for this frame      */
   float  Pn[],		/* time domain Parzen window                   */
-  int    shift          /* flag used to handle transition frames       */
+  int    shift,         /* flag used to handle transition frames       */
+  SYNTH_WS *ws          /* work space                                  */
 )
 {
-    int   i,l,j,b;	/* loop variables */
-    COMP  Sw_[FFT_DEC];	/* DFT of synthesised signal */
-    COMP  sw_[FFT_DEC];	/* synthesised signal */
-
-    if (shift) {
-	/* Update memories */
-	for(i=0; i<N-1; i++) {
-	    Sn_[i] = Sn_[i+N];
-	}
-	Sn_[N-1] = 0.0;
-    }
-
-    for(i=0; i<FFT_DEC; i++) {
-	Sw_[i].real = 0.0;
-	Sw_[i].imag = 0.0;
-    }
+    int   l,b;	/* loop variables */
+    COMP *Sw_ = ws->Sw_;	/* DFT of synthesised signal, +ve freqs */
+    float *sw_ = ws->sw_;	/* synthesised signal */
+    float s[MAX_AMP+1], c[MAX_AMP+1];
 
     /*
       Nov 2010 - found that synthesis using time domain cos() functions
@@ -600,6 +961,7 @@ void synthesise(
 #define FFT_SYNTHESIS
 #ifdef FFT_SYNTHESIS
     /* Now set up frequency domain synthesised speech */
+    fast_sincos(&model->phi[1], &s[1], &c[1], model->L);
     for(l=1; l<=model->L; l++) {
     //for(l=model->L/2; l<=model->L; l++) {
     //for(l=1; l<=model->L/4; l++) {
@@ -607,15 +969,25 @@ void synthesise(
 	if (b > ((FFT_DEC/2)-1)) {
 		b = (FFT_DEC/2)-1;
 	}
-	Sw_[b].real = model->A[l]*cosf(model->phi[l]);
-	Sw_[b].imag = model->A[l]*sinf(model->phi[l]);
-	Sw_[FFT_DEC-b].real = Sw_[b].real;
-	Sw_[FFT_DEC-b].imag = -Sw_[b].imag;
+	Sw_[b].real = model->A[l]*c[l];
+	Sw_[b].imag = model->A[l]*s[l];
     }
 
-    /* Perform inverse DFT */
+    /* Perform inverse DFT, the -ve freqs are implied by the real
+       inverse FFT as the -ve half of the spectrum is the conjugate */
+
+    kiss_fftri(fftr_inv_cfg, (kiss_fft_cpx *)Sw_, sw_);
+
+    /* leave Sw_[] all zero for the next frame */
 
-    kiss_fft(fft_inv_cfg, (kiss_fft_cpx *)Sw_, (kiss_fft_cpx *)sw_);
+    for(l=1; l<=model->L; l++) {
+	b = (int)(l*model->Wo*FFT_DEC/TWO_PI + 0.5);
+	if (b > ((FFT_DEC/2)-1)) {
+		b = (FFT_DEC/2)-1;
+	}
+	Sw_[b].real = 0.0;
+	Sw_[b].imag = 0.0;
+    }
 #else
     /*
        Direct time domain synthesis using the cos() function.  Works
@@ -624,6 +996,7 @@ void synthesise(
        could be simplified as we don't need to synthesise where Pn[]
        is zero.
     */
+    int i,j;
     for(l=1; l<=model->L; l++) {
 	for(i=0,j=-N+1; i<N-1; i++,j++) {
 	    Sw_[FFT_DEC-N+1+i].real += 2.0*model->A[l]*cosf(j*model->Wo*l + model->phi[l]);
@@ -635,23 +1008,166 @@ void synthesise(
 
     /* Overlap add to previous samples */
 
-    for(i=0; i<N-1; i++) {
-	Sn_[i] += sw_[FFT_DEC-N+1+i].real*Pn[i];
+    synth_ola_fn(Sn_, sw_, Pn, shift);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: synth_accumulate
+  DATE CREATED: Oct 2026
+
+  Adds the harmonics of model, scaled by gain, to the spectrum Sw_[]
+  of FFT_DEC/2+1 bins, at the bins synthesise() puts them in.  The
+  harmonics of any number of frames can be summed and then turned to
+  speech together by synth_spectrum().
+
+\*---------------------------------------------------------------------------*/
+
+void synth_accumulate(COMP Sw_[], const MODEL *model, float gain)
+{
+    int   l,b;
+    float a;
+    float s[MAX_AMP+1], c[MAX_AMP+1];
+
+    fast_sincos(&model->phi[1], &s[1], &c[1], model->L);
+    for(l=1; l<=model->L; l++) {
+	b = (int)(l*model->Wo*FFT_DEC/TWO_PI + 0.5);
+	if (b > ((FFT_DEC/2)-1)) {
+		b = (FFT_DEC/2)-1;
+	}
+	a = gain*model->A[l];
+	Sw_[b].real += a*c[l];
+	Sw_[b].imag += a*s[l];
     }
+}
 
-    if (shift)
-	for(i=N-1,j=0; i<2*N; i++,j++)
-	    Sn_[i] = sw_[j].real*Pn[i];
-    else
-	for(i=N-1,j=0; i<2*N; i++,j++)
-	    Sn_[i] += sw_[j].real*Pn[i];
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: synth_spectrum
+  DATE CREATED: Oct 2026
+
+  The second half of synthesise() for a spectrum built by
+  synth_accumulate(): one inverse DFT and the overlap-add to Sn_[].
+  Sw_[] is left all zero for the next frame.
+
+\*---------------------------------------------------------------------------*/
+
+void synth_spectrum(kiss_fftr_cfg fftr_inv_cfg, float Sn_[], COMP Sw_[], float Pn[], int shift,
+                    SYNTH_WS *ws)
+{
+    kiss_fftri(fftr_inv_cfg, (kiss_fft_cpx *)Sw_, ws->sw_);
+    memset(Sw_, 0, (FFT_DEC/2+1)*sizeof(COMP));
+    synth_ola_fn(Sn_, ws->sw_, Pn, shift);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: synth_up_create
+  DATE CREATED: Oct 2026
+
+  Synthesis at k*FS for 1 <= k <= SYNTH_UP_MAX, so a decoder can write
+  16 or 48 kHz speech without a resampler after it.  One allocation
+  holds the window and buffers, the k*FFT_DEC point inverse DFT is a
+  second.  Returns NULL if out of memory.
+
+\*---------------------------------------------------------------------------*/
+
+SYNTH_UP *synth_up_create(int k)
+{
+    SYNTH_UP *up;
+    char     *p;
+
+    assert((k >= 1) && (k <= SYNTH_UP_MAX));
+    up = (SYNTH_UP*)malloc(sizeof(SYNTH_UP) + sizeof(float)*(4*k*N + k*FFT_DEC) +
+                           sizeof(COMP)*(k*FFT_DEC/2+1));
+    if (up == NULL)
+	return NULL;
+    up->k = k;
+    up->fftr_inv_cfg = kiss_fftr_alloc(k*FFT_DEC, 1, NULL, NULL);
+    if (up->fftr_inv_cfg == NULL) {
+	free(up);
+	return NULL;
+    }
+    p = (char*)(up + 1);
+    up->Sw_ = (COMP*)p;  p += sizeof(COMP)*(k*FFT_DEC/2+1);
+    up->Pn = (float*)p;  p += sizeof(float)*2*k*N;
+    up->sw_ = (float*)p; p += sizeof(float)*k*FFT_DEC;
+    up->Sn_ = (float*)p;
+
+    make_synthesis_window_k(up->Pn, k);
+    memset(up->Sw_, 0, sizeof(COMP)*(k*FFT_DEC/2+1));
+    synth_up_clear(up);
+
+    return up;
+}
+
+void synth_up_destroy(SYNTH_UP *up)
+{
+    if (up == NULL)
+	return;
+    KISS_FFT_FREE(up->fftr_inv_cfg);
+    free(up);
+}
+
+/* Clears the overlap-add memory, the next frame fades in */
+
+void synth_up_clear(SYNTH_UP *up)
+{
+    memset(up->Sn_, 0, sizeof(float)*2*up->k*N);
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: synthesise_up
+  DATE CREATED: Oct 2026
+
+  synthesise() with shift at k*FS, leaving k*N new samples in
+  up->Sn_[0..k*N-1].  The harmonics are put in the bins synthesise()
+  uses, which are the same frequencies in the longer DFT, and the
+  window and overlap-add are those of synthesise() stretched k times.
+
+\*---------------------------------------------------------------------------*/
+
+void synthesise_up(SYNTH_UP *up, MODEL *model)
+{
+    int    l,b,i,j;
+    int    n = up->k*N;
+    int    off = up->k*(N-1);
+    int    nfft = up->k*FFT_DEC;
+    COMP  *Sw_ = up->Sw_;
+    float *sw_ = up->sw_;
+    float *Sn_ = up->Sn_;
+    float *Pn = up->Pn;
+    float  s[MAX_AMP+1], c[MAX_AMP+1];
+
+    fast_sincos(&model->phi[1], &s[1], &c[1], model->L);
+    for(l=1; l<=model->L; l++) {
+	b = (int)(l*model->Wo*FFT_DEC/TWO_PI + 0.5);
+	if (b > ((FFT_DEC/2)-1)) {
+		b = (FFT_DEC/2)-1;
+	}
+	Sw_[b].real = model->A[l]*c[l];
+	Sw_[b].imag = model->A[l]*s[l];
+    }
+
+    kiss_fftri(up->fftr_inv_cfg, (kiss_fft_cpx *)Sw_, sw_);
+
+    /* no bin above FFT_DEC/2-1 was set, clear just those */
+
+    memset(Sw_, 0, sizeof(COMP)*(FFT_DEC/2));
+
+    for(i=0; i<off; i++)
+	Sn_[i] = Sn_[i+n] + sw_[nfft-off+i]*Pn[i];
+    for(i=off,j=0; i<2*n; i++,j++)
+	Sn_[i] = sw_[j]*Pn[i];
+}
 
-static unsigned long next = 1;
+/* LCG random number generator.  State is passed in by the caller so
+   each codec instance has its own sequence and can be decoded on its
+   own thread with bit exact results. */
 
-int codec2_rand(void) {
-    next = next * 1103515245 + 12345;
-    return((unsigned)(next/65536) % 32768);
+int codec2_rand(unsigned long *next) {
+    *next = *next * 1103515245 + 12345;
+    return((unsigned)(*next/65536) % 32768);
 }
 
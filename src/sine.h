@@ -31,17 +31,86 @@
 #include "defines.h"
 #include "comp.h"
 #include "kiss_fft.h"
+#include "kiss_fftr.h"
+
+/* synthesise() work space, kept per codec instance to stay off the
+   stack.  Sw_[] is zero between calls. */
+
+typedef struct {
+    COMP  Sw_[FFT_DEC/2+1];    /* DFT of synthesised signal, +ve freqs */
+    float sw_[FFT_DEC];        /* synthesised signal                   */
+} SYNTH_WS;
+
+/* Synthesis at k times FS, see synth_up_create().  The harmonics sit
+   in the bins they have at FS, of an FFT k times longer, so every k-th
+   output sample is the FS synthesis.  Sw_[] is zero between calls. */
+
+#define SYNTH_UP_MAX 6                 /* highest k, 48 kHz          */
+
+typedef struct {
+    int           k;
+    kiss_fftr_cfg fftr_inv_cfg;        /* k*FFT_DEC point inverse    */
+    float        *Pn;                  /* 2*k*N synthesis window     */
+    COMP         *Sw_;                 /* k*FFT_DEC/2+1 bins         */
+    float        *sw_;                 /* k*FFT_DEC samples          */
+    float        *Sn_;                 /* 2*k*N output, first k*N new */
+} SYNTH_UP;
+
+/* est_voicing_mbe() band energies of W[], den[s-VOICING_TAB_S0][n] is
+   the sum of W[s..s+n-1].real squared, in that order.  Covers the
+   bands of every pitch from P_MAX to P_MIN. */
+
+#define VOICING_TAB_S0  (FFT_ENC/2 - 16)
+#define VOICING_TAB_NS  20
+#define VOICING_TAB_LEN 32
+
+typedef struct {
+    float den[VOICING_TAB_NS][VOICING_TAB_LEN];
+} VOICING_TAB;
+
+/* Power spectrum of an analysis frame, found once by sw_power() and
+   shared by the pitch refinement, amplitude and voicing estimators.
+   C[b] is the sum of P[0..b-1], so the energy of bins a..b-1 is
+   C[b] - C[a].  It only reaches the top of the highest harmonic's
+   band, and is summed in double as a band high in the spectrum may
+   hold a tiny part of the energy below it.  CORTEX_M4 builds have no
+   double precision FPU, and sum P[] over each band instead. */
+
+#define SW_POWER_NC (FFT_ENC/2 + 16)
+
+typedef struct {
+    float  P[FFT_ENC];                 /* |Sw[b]|^2                  */
+#ifndef CORTEX_M4
+    double C[SW_POWER_NC+1];
+#endif
+} SW_POWER;
 
 void make_analysis_window(kiss_fft_cfg fft_fwd_cfg, float w[], COMP W[]);
+void make_voicing_table(VOICING_TAB *tab, COMP W[]);
 float hpf(float x, float states[]);
-void dft_speech(kiss_fft_cfg fft_fwd_cfg, COMP Sw[], float Sn[], float w[]);
-void two_stage_pitch_refinement(MODEL *model, COMP Sw[]);
-void estimate_amplitudes(MODEL *model, COMP Sw[], COMP W[], int est_phase);
-float est_voicing_mbe(MODEL *model, COMP Sw[], COMP W[], COMP Sw_[],COMP Ew[]);
+void dft_speech(kiss_fftr_cfg fftr_fwd_cfg, COMP Sw[], float Sn[], float w[]);
+void sw_power(SW_POWER *pw, COMP Sw[]);
+void two_stage_pitch_refinement(MODEL *model, const SW_POWER *pw);
+void fast_pitch_refinement(MODEL *model, const SW_POWER *pw);
+void coarse_pitch_refinement(MODEL *model, const SW_POWER *pw);
+void estimate_amplitudes(MODEL *model, COMP Sw[], const SW_POWER *pw, int est_phase);
+float est_voicing_mbe(MODEL *model, COMP Sw[], COMP W[], const VOICING_TAB *tab,
+                      const SW_POWER *pw, COMP Sw_[], COMP Ew[], int dirty[]);
 void make_synthesis_window(float Pn[]);
-void synthesise(kiss_fft_cfg fft_inv_cfg, float Sn_[], MODEL *model, float Pn[], int shift);
+void synth_ws_init(SYNTH_WS *ws);
+void synthesise(kiss_fftr_cfg fftr_inv_cfg, float Sn_[], MODEL *model, float Pn[], int shift,
+                SYNTH_WS *ws);
+void synth_accumulate(COMP Sw_[], const MODEL *model, float gain);
+void synth_spectrum(kiss_fftr_cfg fftr_inv_cfg, float Sn_[], COMP Sw_[], float Pn[], int shift,
+                    SYNTH_WS *ws);
+SYNTH_UP *synth_up_create(int k);
+void synth_up_destroy(SYNTH_UP *up);
+void synth_up_clear(SYNTH_UP *up);
+void synthesise_up(SYNTH_UP *up, MODEL *model);
+void synthesise_select_kernels(int features);
+const char *synthesise_kernel_name(void);
 
 #define CODEC2_RAND_MAX 32767
-int codec2_rand(void);
+int codec2_rand(unsigned long *next);
 
 #endif
@@ -0,0 +1,1638 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: vq.c
+  DATE CREATED: Oct 2026
+
+  Vector quantiser nearest neighbour search kernels.  A scalar version
+  is always available, SSE2/AVX2 (x86) and NEON (ARM) versions are
+  selected at run time by vq_init().
+
+  The SIMD kernels compute the distance to several codebook entries at
+  once, one entry per lane, accumulating over the vector dimension in
+  the same order as the scalar loop.  No FP contraction or horizontal
+  sums are used, so each distance is bit exact with the scalar version
+  and all kernels return the same index (the first entry with the
+  smallest distance).
+
+  The phase kernels, complex entries matched on angle for phaseexp.c,
+  follow the same rules with their atan2() a polynomial.
+
+  Codebooks may be row major (CB_LAYOUT_ROWS, the codebook*.c tables)
+  where the lanes are filled with strided loads, or transposed
+  (CB_LAYOUT_SOA, generated by generate_codebook_soa.c) where each lane
+  load is one contiguous vector load.
+
+  CB_LAYOUT_Q16 codebooks, built with CODEC2_CODEBOOK_Q16 to halve the
+  codebook footprint, hold each element as an int16 step count that is
+  scaled back to a float as it is read.  They are meant for small
+  targets without SIMD and are always searched by the scalar kernels.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "vq.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define VQ_X86
+#include <immintrin.h>
+#define TARGET_SSE2  __attribute__((target("sse2")))
+#define TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VQ_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+#define SOA (CB_LAYOUT_SOA)
+#define ROWS (CB_LAYOUT_ROWS)
+#define Q16 (CB_LAYOUT_Q16)
+
+/* codebook as seen by the kernels */
+
+typedef struct {
+    const float *cb;        /* entries                              */
+    int          stride;    /* SOA row length (mpad), unused for rows */
+    const float *norm;      /* ||c||^2 of each entry, SOA only      */
+    const short *q;         /* entries, Q16 only                    */
+    float        scale;     /* value of one step of q[]             */
+} VQ_CB;
+
+typedef long (*vq_nearest_fn)(int dist, int layout, const VQ_CB *c, const float x[],
+                              const float w[], int k, int m, float *beste);
+typedef int  (*vq_distances_fn)(int dist, int layout, const VQ_CB *c, const float x[],
+                                const float w[], int k, int j0, int n, float e[]);
+typedef int  (*vq_nearest_batch_fn)(int dist, int layout, const VQ_CB *c, const float x[],
+                                    const float w[], int k, int m, int nvec, int idx[],
+                                    float beste[]);
+typedef int  (*vq_distances_batch_fn)(int dist, int layout, const VQ_CB *c, const float x[],
+                                      const float w[], int k, int j0, int n, int nvec,
+                                      float e[]);
+
+/* element i of entry j */
+
+static ALWAYS_INLINE float cb_elem(int layout, const VQ_CB *c, int k, int j, int i)
+{
+    if (layout == Q16)
+	return c->q[j*k + i]*c->scale;
+    return layout == SOA ? c->cb[i*c->stride + j] : c->cb[j*k + i];
+}
+
+/* calls impl with dist and layout as compile time constants */
+
+#define DISPATCH(impl, dist, layout, ...)                                    \
+    switch(((dist) << 1) | ((layout) == SOA)) {                                \
+    case (VQ_DIST_SQUARED  << 1):     return impl(VQ_DIST_SQUARED,  ROWS, __VA_ARGS__); \
+    case (VQ_DIST_SQUARED  << 1) | 1: return impl(VQ_DIST_SQUARED,  SOA,  __VA_ARGS__); \
+    case (VQ_DIST_WSQUARED << 1):     return impl(VQ_DIST_WSQUARED, ROWS, __VA_ARGS__); \
+    case (VQ_DIST_WSQUARED << 1) | 1: return impl(VQ_DIST_WSQUARED, SOA,  __VA_ARGS__); \
+    case (VQ_DIST_WEIGHTED << 1):     return impl(VQ_DIST_WEIGHTED, ROWS, __VA_ARGS__); \
+    case (VQ_DIST_WEIGHTED << 1) | 1: return impl(VQ_DIST_WEIGHTED, SOA,  __VA_ARGS__); \
+    default:                          return impl(VQ_DIST_DOT,      SOA,  __VA_ARGS__); \
+    }
+
+/* as DISPATCH for the scalar kernels, which also search Q16 codebooks */
+
+#ifdef CODEC2_CODEBOOK_Q16
+#define DISPATCH_SCALAR(impl, dist, layout, ...)                             \
+    if ((layout) == Q16) {                                                     \
+	switch(dist) {                                                         \
+	case VQ_DIST_SQUARED:  return impl(VQ_DIST_SQUARED,  Q16, __VA_ARGS__); \
+	case VQ_DIST_WSQUARED: return impl(VQ_DIST_WSQUARED, Q16, __VA_ARGS__); \
+	default:               return impl(VQ_DIST_WEIGHTED, Q16, __VA_ARGS__); \
+	}                                                                      \
+    }                                                                          \
+    DISPATCH(impl, dist, layout, __VA_ARGS__)
+#define KERNEL(fn, layout) ((layout) == Q16 ? fn##_scalar : fn##_fn)
+#else
+#define DISPATCH_SCALAR DISPATCH
+#define KERNEL(fn, layout) fn##_fn
+#endif
+
+/*---------------------------------------------------------------------------*\
+
+                                SCALAR
+
+\*---------------------------------------------------------------------------*/
+
+static ALWAYS_INLINE float dist_scalar(int dist, int layout, const VQ_CB *c, const float x[],
+                                       const float w[], int k, int j)
+{
+    float e, d, t, ci;
+    int   i;
+
+    e = 0.0;
+    for(i=0; i<k; i++) {
+	ci = cb_elem(layout, c, k, j, i);
+	switch(dist) {
+	case VQ_DIST_SQUARED:
+	    d = x[i] - ci;
+	    e += d*d;
+	    break;
+	case VQ_DIST_WSQUARED:
+	    d = ci - x[i];
+	    t = d*w[i];
+	    e += t*t;
+	    break;
+	case VQ_DIST_WEIGHTED:
+	    d = x[i] - ci;
+	    e += w[i]*d*d;
+	    break;
+	default:
+	    e += x[i]*ci;
+	    break;
+	}
+    }
+    if (dist == VQ_DIST_DOT)
+	e = c->norm[j] - (e + e);
+
+    return e;
+}
+
+static ALWAYS_INLINE long nearest_scalar_impl(int dist, int layout, const VQ_CB *c, const float x[],
+                                              const float w[], int k, int m, float *beste)
+{
+    long  j, besti;
+    float e, be;
+
+    besti = 0;
+    be = *beste;
+    for(j=0; j<m; j++) {
+	e = dist_scalar(dist, layout, c, x, w, k, j);
+	if (e < be) {
+	    be = e;
+	    besti = j;
+	}
+    }
+    *beste = be;
+
+    return besti;
+}
+
+static long nearest_scalar(int dist, int layout, const VQ_CB *c, const float x[],
+                           const float w[], int k, int m, float *beste)
+{
+    DISPATCH_SCALAR(nearest_scalar_impl, dist, layout, c, x, w, k, m, beste);
+}
+
+static ALWAYS_INLINE int distances_scalar_impl(int dist, int layout, const VQ_CB *c, const float x[],
+                                               const float w[], int k, int j0, int n, float e[])
+{
+    int j;
+
+    for(j=0; j<n; j++)
+	e[j] = dist_scalar(dist, layout, c, x, w, k, j0+j);
+
+    return 0;
+}
+
+static int distances_scalar(int dist, int layout, const VQ_CB *c, const float x[],
+                            const float w[], int k, int j0, int n, float e[])
+{
+    DISPATCH_SCALAR(distances_scalar_impl, dist, layout, c, x, w, k, j0, n, e);
+}
+
+/*
+   Merges per lane best (value, index) results with the scalar search
+   of the entries left over after the last full block.  Ties go to the
+   lowest index, which is the scalar behaviour.
+*/
+
+static ALWAYS_INLINE long nearest_reduce(int nlanes, const float lv[], const int li[],
+                                         int dist, int layout, const VQ_CB *c, const float x[],
+                                         const float w[], int k, int j0, int m, float *beste)
+{
+    long  bi;
+    float be, e;
+    int   l, j;
+
+    bi = -1;
+    be = *beste;
+    for(l=0; l<nlanes; l++) {
+	if (li[l] < 0)
+	    continue;
+	if ((bi < 0) || (lv[l] < be) || ((lv[l] == be) && (li[l] < bi))) {
+	    be = lv[l];
+	    bi = li[l];
+	}
+    }
+    for(j=j0; j<m; j++) {
+	e = dist_scalar(dist, layout, c, x, w, k, j);
+	if (e < be) {
+	    be = e;
+	    bi = j;
+	}
+    }
+
+    *beste = be;
+    return bi < 0 ? 0 : bi;
+}
+
+/*
+   Batched searches, many target vectors against one codebook.  The
+   codebook is walked a tile of VQ_TILE entries at a time and every
+   target is searched against a tile before moving on, so a tile is
+   brought into cache once for all of them.  The SIMD kernels also
+   take the targets VQ_BATCH at a time, each codebook block loaded into
+   a register is then used for VQ_BATCH distances.  Each target's
+   distance is computed exactly as for a single search, and as the
+   tiles are searched in order, keeping a tile's best only if it beats
+   the earlier tiles strictly gives the same index.
+*/
+
+#define VQ_TILE  256   /* codebook entries per tile, a multiple of 8 */
+#define VQ_BATCH 4     /* targets per register block                 */
+
+/* weights of target t, w[] is NULL for the unweighted measures */
+
+static ALWAYS_INLINE const float *target_w(const float w[], int k, int t)
+{
+    return w == NULL ? NULL : &w[t*k];
+}
+
+/* merges one target's tile result, see nearest_reduce() */
+
+static ALWAYS_INLINE void batch_merge(int nlanes, const float lv[], const int li[],
+                                      int dist, int layout, const VQ_CB *c, const float x[],
+                                      const float w[], int k, int j0, int j1,
+                                      int *bi, float *be)
+{
+    long  i;
+    float e;
+
+    e = *be;
+    i = nearest_reduce(nlanes, lv, li, dist, layout, c, x, w, k, j0, j1, &e);
+    if (e < *be) {
+	*be = e;
+	*bi = i;
+    }
+}
+
+static ALWAYS_INLINE int nearest_batch_scalar_impl(int dist, int layout, const VQ_CB *c,
+                                                   const float x[], const float w[],
+                                                   int k, int m, int nvec, int idx[],
+                                                   float beste[])
+{
+    const float *wt;
+    float        e;
+    int          j0, j1, j, t;
+
+    for(t=0; t<nvec; t++)
+	idx[t] = 0;
+    for(j0=0; j0<m; j0=j1) {
+	j1 = (m - j0) < VQ_TILE ? m : j0 + VQ_TILE;
+	for(t=0; t<nvec; t++) {
+	    wt = target_w(w, k, t);
+	    for(j=j0; j<j1; j++) {
+		e = dist_scalar(dist, layout, c, &x[t*k], wt, k, j);
+		if (e < beste[t]) {
+		    beste[t] = e;
+		    idx[t] = j;
+		}
+	    }
+	}
+    }
+
+    return 0;
+}
+
+static int nearest_batch_scalar(int dist, int layout, const VQ_CB *c, const float x[],
+                                const float w[], int k, int m, int nvec, int idx[],
+                                float beste[])
+{
+    DISPATCH_SCALAR(nearest_batch_scalar_impl, dist, layout, c, x, w, k, m, nvec, idx, beste);
+}
+
+static ALWAYS_INLINE int distances_batch_scalar_impl(int dist, int layout, const VQ_CB *c,
+                                                     const float x[], const float w[],
+                                                     int k, int j0, int n, int nvec,
+                                                     float e[])
+{
+    int jt, j1, j, t;
+
+    for(jt=0; jt<n; jt=j1) {
+	j1 = (n - jt) < VQ_TILE ? n : jt + VQ_TILE;
+	for(t=0; t<nvec; t++)
+	    for(j=jt; j<j1; j++)
+		e[t*n + j] = dist_scalar(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0+j);
+    }
+
+    return 0;
+}
+
+static int distances_batch_scalar(int dist, int layout, const VQ_CB *c, const float x[],
+                                  const float w[], int k, int j0, int n, int nvec,
+                                  float e[])
+{
+    DISPATCH_SCALAR(distances_batch_scalar_impl, dist, layout, c, x, w, k, j0, n, nvec, e);
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                 X86
+
+\*---------------------------------------------------------------------------*/
+
+#ifdef VQ_X86
+
+static ALWAYS_INLINE TARGET_SSE2 __m128 step_sse2(int dist, __m128 e, __m128 c, __m128 x, __m128 w)
+{
+    __m128 d, t;
+
+    switch(dist) {
+    case VQ_DIST_SQUARED:
+	d = _mm_sub_ps(x, c);
+	return _mm_add_ps(e, _mm_mul_ps(d, d));
+    case VQ_DIST_WSQUARED:
+	d = _mm_sub_ps(c, x);
+	t = _mm_mul_ps(d, w);
+	return _mm_add_ps(e, _mm_mul_ps(t, t));
+    case VQ_DIST_WEIGHTED:
+	d = _mm_sub_ps(x, c);
+	return _mm_add_ps(e, _mm_mul_ps(_mm_mul_ps(w, d), d));
+    default:
+	return _mm_add_ps(e, _mm_mul_ps(x, c));
+    }
+}
+
+/* distances of entries j..j+3 */
+
+static ALWAYS_INLINE TARGET_SSE2 __m128 block_sse2(int dist, int layout, const VQ_CB *c,
+                                                   const float x[], const float w[], int k, int j)
+{
+    const float *p;
+    __m128       e, cv;
+    int          i;
+
+    e = _mm_setzero_ps();
+    for(i=0; i<k; i++) {
+	if (layout == SOA)
+	    cv = _mm_loadu_ps(&c->cb[i*c->stride + j]);
+	else {
+	    p = &c->cb[j*k + i];
+	    cv = _mm_set_ps(p[3*k], p[2*k], p[k], p[0]);
+	}
+	e = step_sse2(dist, e, cv, _mm_set1_ps(x[i]),
+		      _mm_set1_ps((dist == VQ_DIST_SQUARED) || (dist == VQ_DIST_DOT) ? 0.0f : w[i]));
+    }
+    if (dist == VQ_DIST_DOT)
+	e = _mm_sub_ps(_mm_loadu_ps(&c->norm[j]), _mm_add_ps(e, e));
+
+    return e;
+}
+
+static ALWAYS_INLINE TARGET_SSE2 long nearest_sse2_impl(int dist, int layout, const VQ_CB *c,
+                                                        const float x[], const float w[],
+                                                        int k, int m, float *beste)
+{
+    __m128  e, best, lt;
+    __m128i idx, besti;
+    float   lv[4];
+    int     li[4];
+    int     j;
+
+    best  = _mm_set1_ps(*beste);
+    besti = _mm_set1_epi32(-1);
+    idx   = _mm_set_epi32(3, 2, 1, 0);
+    for(j=0; j+4<=m; j+=4) {
+	e = block_sse2(dist, layout, c, x, w, k, j);
+	lt = _mm_cmplt_ps(e, best);
+	best = _mm_or_ps(_mm_and_ps(lt, e), _mm_andnot_ps(lt, best));
+	besti = _mm_or_si128(_mm_and_si128(_mm_castps_si128(lt), idx),
+			     _mm_andnot_si128(_mm_castps_si128(lt), besti));
+	idx = _mm_add_epi32(idx, _mm_set1_epi32(4));
+    }
+    _mm_storeu_ps(lv, best);
+    _mm_storeu_si128((__m128i*)li, besti);
+
+    return nearest_reduce(4, lv, li, dist, layout, c, x, w, k, j, m, beste);
+}
+
+static TARGET_SSE2 long nearest_sse2(int dist, int layout, const VQ_CB *c, const float x[],
+                                     const float w[], int k, int m, float *beste)
+{
+    DISPATCH(nearest_sse2_impl, dist, layout, c, x, w, k, m, beste);
+}
+
+static ALWAYS_INLINE TARGET_SSE2 int distances_sse2_impl(int dist, int layout, const VQ_CB *c,
+                                                         const float x[], const float w[],
+                                                         int k, int j0, int n, float e[])
+{
+    int j;
+
+    for(j=0; j+4<=n; j+=4)
+	_mm_storeu_ps(&e[j], block_sse2(dist, layout, c, x, w, k, j0+j));
+    for(; j<n; j++)
+	e[j] = dist_scalar(dist, layout, c, x, w, k, j0+j);
+
+    return 0;
+}
+
+static TARGET_SSE2 int distances_sse2(int dist, int layout, const VQ_CB *c, const float x[],
+                                      const float w[], int k, int j0, int n, float e[])
+{
+    DISPATCH(distances_sse2_impl, dist, layout, c, x, w, k, j0, n, e);
+}
+
+/* distances of entries j..j+3 for targets 0..nt-1, each block load
+   used for all of them */
+
+static ALWAYS_INLINE TARGET_SSE2 void multi_sse2(int dist, int layout, const VQ_CB *c,
+                                                 const float x[], const float w[], int k,
+                                                 int j, int nt, __m128 e[])
+{
+    const float *p;
+    __m128       cv, nv;
+    int          i, t;
+
+    for(t=0; t<nt; t++)
+	e[t] = _mm_setzero_ps();
+    for(i=0; i<k; i++) {
+	if (layout == SOA)
+	    cv = _mm_loadu_ps(&c->cb[i*c->stride + j]);
+	else {
+	    p = &c->cb[j*k + i];
+	    cv = _mm_set_ps(p[3*k], p[2*k], p[k], p[0]);
+	}
+	for(t=0; t<nt; t++)
+	    e[t] = step_sse2(dist, e[t], cv, _mm_set1_ps(x[t*k + i]),
+			     _mm_set1_ps((dist == VQ_DIST_SQUARED) || (dist == VQ_DIST_DOT) ? 0.0f : w[t*k + i]));
+    }
+    if (dist == VQ_DIST_DOT) {
+	nv = _mm_loadu_ps(&c->norm[j]);
+	for(t=0; t<nt; t++)
+	    e[t] = _mm_sub_ps(nv, _mm_add_ps(e[t], e[t]));
+    }
+}
+
+/* searches entries j0..j1-1 for targets 0..nt-1 */
+
+static ALWAYS_INLINE TARGET_SSE2 void tile_sse2(int dist, int layout, const VQ_CB *c,
+                                                const float x[], const float w[], int k,
+                                                int j0, int j1, int nt, int idx[],
+                                                float beste[])
+{
+    __m128  e[VQ_BATCH], best[VQ_BATCH], lt;
+    __m128i besti[VQ_BATCH], jv;
+    float   lv[4];
+    int     li[4];
+    int     j, t;
+
+    for(t=0; t<nt; t++) {
+	best[t]  = _mm_set1_ps(beste[t]);
+	besti[t] = _mm_set1_epi32(-1);
+    }
+    jv = _mm_set_epi32(j0+3, j0+2, j0+1, j0);
+    for(j=j0; j+4<=j1; j+=4) {
+	multi_sse2(dist, layout, c, x, w, k, j, nt, e);
+	for(t=0; t<nt; t++) {
+	    lt = _mm_cmplt_ps(e[t], best[t]);
+	    best[t] = _mm_or_ps(_mm_and_ps(lt, e[t]), _mm_andnot_ps(lt, best[t]));
+	    besti[t] = _mm_or_si128(_mm_and_si128(_mm_castps_si128(lt), jv),
+				    _mm_andnot_si128(_mm_castps_si128(lt), besti[t]));
+	}
+	jv = _mm_add_epi32(jv, _mm_set1_epi32(4));
+    }
+    for(t=0; t<nt; t++) {
+	_mm_storeu_ps(lv, best[t]);
+	_mm_storeu_si128((__m128i*)li, besti[t]);
+	batch_merge(4, lv, li, dist, layout, c, &x[t*k], target_w(w, k, t), k, j, j1,
+		    &idx[t], &beste[t]);
+    }
+}
+
+static ALWAYS_INLINE TARGET_SSE2 int nearest_batch_sse2_impl(int dist, int layout, const VQ_CB *c,
+                                                             const float x[], const float w[],
+                                                             int k, int m, int nvec, int idx[],
+                                                             float beste[])
+{
+    int j0, j1, t;
+
+    for(t=0; t<nvec; t++)
+	idx[t] = 0;
+    for(j0=0; j0<m; j0=j1) {
+	j1 = (m - j0) < VQ_TILE ? m : j0 + VQ_TILE;
+	for(t=0; t+VQ_BATCH<=nvec; t+=VQ_BATCH)
+	    tile_sse2(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, j1, VQ_BATCH,
+		      &idx[t], &beste[t]);
+	for(; t<nvec; t++)
+	    tile_sse2(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, j1, 1,
+		      &idx[t], &beste[t]);
+    }
+
+    return 0;
+}
+
+static TARGET_SSE2 int nearest_batch_sse2(int dist, int layout, const VQ_CB *c, const float x[],
+                                          const float w[], int k, int m, int nvec, int idx[],
+                                          float beste[])
+{
+    DISPATCH(nearest_batch_sse2_impl, dist, layout, c, x, w, k, m, nvec, idx, beste);
+}
+
+static ALWAYS_INLINE TARGET_SSE2 void dtile_sse2(int dist, int layout, const VQ_CB *c,
+                                                 const float x[], const float w[], int k,
+                                                 int j0, int jt, int j1, int n, int nt,
+                                                 float e[])
+{
+    __m128 d[VQ_BATCH];
+    int    j, t;
+
+    for(j=jt; j+4<=j1; j+=4) {
+	multi_sse2(dist, layout, c, x, w, k, j0+j, nt, d);
+	for(t=0; t<nt; t++)
+	    _mm_storeu_ps(&e[t*n + j], d[t]);
+    }
+    for(; j<j1; j++)
+	for(t=0; t<nt; t++)
+	    e[t*n + j] = dist_scalar(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0+j);
+}
+
+static ALWAYS_INLINE TARGET_SSE2 int distances_batch_sse2_impl(int dist, int layout, const VQ_CB *c,
+                                                               const float x[], const float w[],
+                                                               int k, int j0, int n, int nvec,
+                                                               float e[])
+{
+    int jt, j1, t;
+
+    for(jt=0; jt<n; jt=j1) {
+	j1 = (n - jt) < VQ_TILE ? n : jt + VQ_TILE;
+	for(t=0; t+VQ_BATCH<=nvec; t+=VQ_BATCH)
+	    dtile_sse2(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, jt, j1, n,
+		       VQ_BATCH, &e[t*n]);
+	for(; t<nvec; t++)
+	    dtile_sse2(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, jt, j1, n,
+		       1, &e[t*n]);
+    }
+
+    return 0;
+}
+
+static TARGET_SSE2 int distances_batch_sse2(int dist, int layout, const VQ_CB *c, const float x[],
+                                            const float w[], int k, int j0, int n, int nvec,
+                                            float e[])
+{
+    DISPATCH(distances_batch_sse2_impl, dist, layout, c, x, w, k, j0, n, nvec, e);
+}
+
+static ALWAYS_INLINE TARGET_AVX2 __m256 step_avx2(int dist, __m256 e, __m256 c, __m256 x, __m256 w)
+{
+    __m256 d, t;
+
+    switch(dist) {
+    case VQ_DIST_SQUARED:
+	d = _mm256_sub_ps(x, c);
+	return _mm256_add_ps(e, _mm256_mul_ps(d, d));
+    case VQ_DIST_WSQUARED:
+	d = _mm256_sub_ps(c, x);
+	t = _mm256_mul_ps(d, w);
+	return _mm256_add_ps(e, _mm256_mul_ps(t, t));
+    case VQ_DIST_WEIGHTED:
+	d = _mm256_sub_ps(x, c);
+	return _mm256_add_ps(e, _mm256_mul_ps(_mm256_mul_ps(w, d), d));
+    default:
+	return _mm256_add_ps(e, _mm256_mul_ps(x, c));
+    }
+}
+
+/* distances of entries j..j+7 */
+
+static ALWAYS_INLINE TARGET_AVX2 __m256 block_avx2(int dist, int layout, const VQ_CB *c,
+                                                   const float x[], const float w[], int k, int j)
+{
+    const float *p;
+    __m256       e, cv;
+    int          i;
+
+    /* for rows, strided loads measured faster than _mm256_i32gather_ps() */
+
+    e = _mm256_setzero_ps();
+    for(i=0; i<k; i++) {
+	if (layout == SOA)
+	    cv = _mm256_loadu_ps(&c->cb[i*c->stride + j]);
+	else {
+	    p = &c->cb[j*k + i];
+	    cv = _mm256_set_ps(p[7*k], p[6*k], p[5*k], p[4*k],
+			       p[3*k], p[2*k], p[k], p[0]);
+	}
+	e = step_avx2(dist, e, cv, _mm256_set1_ps(x[i]),
+		      _mm256_set1_ps((dist == VQ_DIST_SQUARED) || (dist == VQ_DIST_DOT) ? 0.0f : w[i]));
+    }
+    if (dist == VQ_DIST_DOT)
+	e = _mm256_sub_ps(_mm256_loadu_ps(&c->norm[j]), _mm256_add_ps(e, e));
+
+    return e;
+}
+
+static ALWAYS_INLINE TARGET_AVX2 long nearest_avx2_impl(int dist, int layout, const VQ_CB *c,
+                                                        const float x[], const float w[],
+                                                        int k, int m, float *beste)
+{
+    __m256  e, best, lt;
+    __m256i idx, besti;
+    float   lv[8];
+    int     li[8];
+    int     j;
+
+    best  = _mm256_set1_ps(*beste);
+    besti = _mm256_set1_epi32(-1);
+    idx   = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    for(j=0; j+8<=m; j+=8) {
+	e = block_avx2(dist, layout, c, x, w, k, j);
+	lt = _mm256_cmp_ps(e, best, _CMP_LT_OQ);
+	best = _mm256_blendv_ps(best, e, lt);
+	besti = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(besti),
+						     _mm256_castsi256_ps(idx), lt));
+	idx = _mm256_add_epi32(idx, _mm256_set1_epi32(8));
+    }
+    _mm256_storeu_ps(lv, best);
+    _mm256_storeu_si256((__m256i*)li, besti);
+
+    return nearest_reduce(8, lv, li, dist, layout, c, x, w, k, j, m, beste);
+}
+
+static TARGET_AVX2 long nearest_avx2(int dist, int layout, const VQ_CB *c, const float x[],
+                                     const float w[], int k, int m, float *beste)
+{
+    DISPATCH(nearest_avx2_impl, dist, layout, c, x, w, k, m, beste);
+}
+
+static ALWAYS_INLINE TARGET_AVX2 int distances_avx2_impl(int dist, int layout, const VQ_CB *c,
+                                                         const float x[], const float w[],
+                                                         int k, int j0, int n, float e[])
+{
+    int j;
+
+    for(j=0; j+8<=n; j+=8)
+	_mm256_storeu_ps(&e[j], block_avx2(dist, layout, c, x, w, k, j0+j));
+    for(; j<n; j++)
+	e[j] = dist_scalar(dist, layout, c, x, w, k, j0+j);
+
+    return 0;
+}
+
+static TARGET_AVX2 int distances_avx2(int dist, int layout, const VQ_CB *c, const float x[],
+                                      const float w[], int k, int j0, int n, float e[])
+{
+    DISPATCH(distances_avx2_impl, dist, layout, c, x, w, k, j0, n, e);
+}
+
+/* distances of entries j..j+7 for targets 0..nt-1, each block load
+   used for all of them */
+
+static ALWAYS_INLINE TARGET_AVX2 void multi_avx2(int dist, int layout, const VQ_CB *c,
+                                                 const float x[], const float w[], int k,
+                                                 int j, int nt, __m256 e[])
+{
+    const float *p;
+    __m256       cv, nv;
+    int          i, t;
+
+    for(t=0; t<nt; t++)
+	e[t] = _mm256_setzero_ps();
+    for(i=0; i<k; i++) {
+	if (layout == SOA)
+	    cv = _mm256_loadu_ps(&c->cb[i*c->stride + j]);
+	else {
+	    p = &c->cb[j*k + i];
+	    cv = _mm256_set_ps(p[7*k], p[6*k], p[5*k], p[4*k],
+			       p[3*k], p[2*k], p[k], p[0]);
+	}
+	for(t=0; t<nt; t++)
+	    e[t] = step_avx2(dist, e[t], cv, _mm256_set1_ps(x[t*k + i]),
+			     _mm256_set1_ps((dist == VQ_DIST_SQUARED) || (dist == VQ_DIST_DOT) ? 0.0f : w[t*k + i]));
+    }
+    if (dist == VQ_DIST_DOT) {
+	nv = _mm256_loadu_ps(&c->norm[j]);
+	for(t=0; t<nt; t++)
+	    e[t] = _mm256_sub_ps(nv, _mm256_add_ps(e[t], e[t]));
+    }
+}
+
+/* searches entries j0..j1-1 for targets 0..nt-1 */
+
+static ALWAYS_INLINE TARGET_AVX2 void tile_avx2(int dist, int layout, const VQ_CB *c,
+                                                const float x[], const float w[], int k,
+                                                int j0, int j1, int nt, int idx[],
+                                                float beste[])
+{
+    __m256  e[VQ_BATCH], best[VQ_BATCH], lt;
+    __m256i besti[VQ_BATCH], jv;
+    float   lv[8];
+    int     li[8];
+    int     j, t;
+
+    for(t=0; t<nt; t++) {
+	best[t]  = _mm256_set1_ps(beste[t]);
+	besti[t] = _mm256_set1_epi32(-1);
+    }
+    jv = _mm256_set_epi32(j0+7, j0+6, j0+5, j0+4, j0+3, j0+2, j0+1, j0);
+    for(j=j0; j+8<=j1; j+=8) {
+	multi_avx2(dist, layout, c, x, w, k, j, nt, e);
+	for(t=0; t<nt; t++) {
+	    lt = _mm256_cmp_ps(e[t], best[t], _CMP_LT_OQ);
+	    best[t] = _mm256_blendv_ps(best[t], e[t], lt);
+	    besti[t] = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(besti[t]),
+							    _mm256_castsi256_ps(jv), lt));
+	}
+	jv = _mm256_add_epi32(jv, _mm256_set1_epi32(8));
+    }
+    for(t=0; t<nt; t++) {
+	_mm256_storeu_ps(lv, best[t]);
+	_mm256_storeu_si256((__m256i*)li, besti[t]);
+	batch_merge(8, lv, li, dist, layout, c, &x[t*k], target_w(w, k, t), k, j, j1,
+		    &idx[t], &beste[t]);
+    }
+}
+
+static ALWAYS_INLINE TARGET_AVX2 int nearest_batch_avx2_impl(int dist, int layout, const VQ_CB *c,
+                                                             const float x[], const float w[],
+                                                             int k, int m, int nvec, int idx[],
+                                                             float beste[])
+{
+    int j0, j1, t;
+
+    for(t=0; t<nvec; t++)
+	idx[t] = 0;
+    for(j0=0; j0<m; j0=j1) {
+	j1 = (m - j0) < VQ_TILE ? m : j0 + VQ_TILE;
+	for(t=0; t+VQ_BATCH<=nvec; t+=VQ_BATCH)
+	    tile_avx2(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, j1, VQ_BATCH,
+		      &idx[t], &beste[t]);
+	for(; t<nvec; t++)
+	    tile_avx2(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, j1, 1,
+		      &idx[t], &beste[t]);
+    }
+
+    return 0;
+}
+
+static TARGET_AVX2 int nearest_batch_avx2(int dist, int layout, const VQ_CB *c, const float x[],
+                                          const float w[], int k, int m, int nvec, int idx[],
+                                          float beste[])
+{
+    DISPATCH(nearest_batch_avx2_impl, dist, layout, c, x, w, k, m, nvec, idx, beste);
+}
+
+static ALWAYS_INLINE TARGET_AVX2 void dtile_avx2(int dist, int layout, const VQ_CB *c,
+                                                 const float x[], const float w[], int k,
+                                                 int j0, int jt, int j1, int n, int nt,
+                                                 float e[])
+{
+    __m256 d[VQ_BATCH];
+    int    j, t;
+
+    for(j=jt; j+8<=j1; j+=8) {
+	multi_avx2(dist, layout, c, x, w, k, j0+j, nt, d);
+	for(t=0; t<nt; t++)
+	    _mm256_storeu_ps(&e[t*n + j], d[t]);
+    }
+    for(; j<j1; j++)
+	for(t=0; t<nt; t++)
+	    e[t*n + j] = dist_scalar(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0+j);
+}
+
+static ALWAYS_INLINE TARGET_AVX2 int distances_batch_avx2_impl(int dist, int layout, const VQ_CB *c,
+                                                               const float x[], const float w[],
+                                                               int k, int j0, int n, int nvec,
+                                                               float e[])
+{
+    int jt, j1, t;
+
+    for(jt=0; jt<n; jt=j1) {
+	j1 = (n - jt) < VQ_TILE ? n : jt + VQ_TILE;
+	for(t=0; t+VQ_BATCH<=nvec; t+=VQ_BATCH)
+	    dtile_avx2(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, jt, j1, n,
+		       VQ_BATCH, &e[t*n]);
+	for(; t<nvec; t++)
+	    dtile_avx2(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, jt, j1, n,
+		       1, &e[t*n]);
+    }
+
+    return 0;
+}
+
+static TARGET_AVX2 int distances_batch_avx2(int dist, int layout, const VQ_CB *c, const float x[],
+                                            const float w[], int k, int j0, int n, int nvec,
+                                            float e[])
+{
+    DISPATCH(distances_batch_avx2_impl, dist, layout, c, x, w, k, j0, n, nvec, e);
+}
+
+#endif /* VQ_X86 */
+
+/*---------------------------------------------------------------------------*\
+
+                                 NEON
+
+\*---------------------------------------------------------------------------*/
+
+#ifdef VQ_NEON
+
+static ALWAYS_INLINE float32x4_t step_neon(int dist, float32x4_t e, float32x4_t c,
+                                           float32x4_t x, float32x4_t w)
+{
+    float32x4_t d, t;
+
+    /* vmulq/vaddq rather than vmlaq so no fused multiply-add is used */
+
+    switch(dist) {
+    case VQ_DIST_SQUARED:
+	d = vsubq_f32(x, c);
+	return vaddq_f32(e, vmulq_f32(d, d));
+    case VQ_DIST_WSQUARED:
+	d = vsubq_f32(c, x);
+	t = vmulq_f32(d, w);
+	return vaddq_f32(e, vmulq_f32(t, t));
+    case VQ_DIST_WEIGHTED:
+	d = vsubq_f32(x, c);
+	return vaddq_f32(e, vmulq_f32(vmulq_f32(w, d), d));
+    default:
+	return vaddq_f32(e, vmulq_f32(x, c));
+    }
+}
+
+static ALWAYS_INLINE float32x4_t block_neon(int dist, int layout, const VQ_CB *c,
+                                            const float x[], const float w[], int k, int j)
+{
+    const float *p;
+    float32x4_t  e, cv;
+    float        t[4];
+    int          i;
+
+    e = vdupq_n_f32(0.0f);
+    for(i=0; i<k; i++) {
+	if (layout == SOA)
+	    cv = vld1q_f32(&c->cb[i*c->stride + j]);
+	else {
+	    p = &c->cb[j*k + i];
+	    t[0] = p[0]; t[1] = p[k]; t[2] = p[2*k]; t[3] = p[3*k];
+	    cv = vld1q_f32(t);
+	}
+	e = step_neon(dist, e, cv, vdupq_n_f32(x[i]),
+		      vdupq_n_f32((dist == VQ_DIST_SQUARED) || (dist == VQ_DIST_DOT) ? 0.0f : w[i]));
+    }
+    if (dist == VQ_DIST_DOT)
+	e = vsubq_f32(vld1q_f32(&c->norm[j]), vaddq_f32(e, e));
+
+    return e;
+}
+
+static ALWAYS_INLINE long nearest_neon_impl(int dist, int layout, const VQ_CB *c,
+                                            const float x[], const float w[],
+                                            int k, int m, float *beste)
+{
+    float32x4_t e, best;
+    uint32x4_t  lt;
+    int32x4_t   idx, besti;
+    float       lv[4];
+    int         li[4];
+    int         j;
+    const int32_t init[4] = {0, 1, 2, 3};
+
+    best  = vdupq_n_f32(*beste);
+    besti = vdupq_n_s32(-1);
+    idx   = vld1q_s32(init);
+    for(j=0; j+4<=m; j+=4) {
+	e = block_neon(dist, layout, c, x, w, k, j);
+	lt = vcltq_f32(e, best);
+	best = vbslq_f32(lt, e, best);
+	besti = vbslq_s32(lt, idx, besti);
+	idx = vaddq_s32(idx, vdupq_n_s32(4));
+    }
+    vst1q_f32(lv, best);
+    vst1q_s32((int32_t*)li, besti);
+
+    return nearest_reduce(4, lv, li, dist, layout, c, x, w, k, j, m, beste);
+}
+
+static long nearest_neon(int dist, int layout, const VQ_CB *c, const float x[],
+                         const float w[], int k, int m, float *beste)
+{
+    DISPATCH(nearest_neon_impl, dist, layout, c, x, w, k, m, beste);
+}
+
+static ALWAYS_INLINE int distances_neon_impl(int dist, int layout, const VQ_CB *c,
+                                             const float x[], const float w[],
+                                             int k, int j0, int n, float e[])
+{
+    int j;
+
+    for(j=0; j+4<=n; j+=4)
+	vst1q_f32(&e[j], block_neon(dist, layout, c, x, w, k, j0+j));
+    for(; j<n; j++)
+	e[j] = dist_scalar(dist, layout, c, x, w, k, j0+j);
+
+    return 0;
+}
+
+static int distances_neon(int dist, int layout, const VQ_CB *c, const float x[],
+                          const float w[], int k, int j0, int n, float e[])
+{
+    DISPATCH(distances_neon_impl, dist, layout, c, x, w, k, j0, n, e);
+}
+
+/* distances of entries j..j+3 for targets 0..nt-1, each block load
+   used for all of them */
+
+static ALWAYS_INLINE void multi_neon(int dist, int layout, const VQ_CB *c,
+                                     const float x[], const float w[], int k,
+                                     int j, int nt, float32x4_t e[])
+{
+    const float *p;
+    float32x4_t  cv, nv;
+    float        b[4];
+    int          i, t;
+
+    for(t=0; t<nt; t++)
+	e[t] = vdupq_n_f32(0.0f);
+    for(i=0; i<k; i++) {
+	if (layout == SOA)
+	    cv = vld1q_f32(&c->cb[i*c->stride + j]);
+	else {
+	    p = &c->cb[j*k + i];
+	    b[0] = p[0]; b[1] = p[k]; b[2] = p[2*k]; b[3] = p[3*k];
+	    cv = vld1q_f32(b);
+	}
+	for(t=0; t<nt; t++)
+	    e[t] = step_neon(dist, e[t], cv, vdupq_n_f32(x[t*k + i]),
+			     vdupq_n_f32((dist == VQ_DIST_SQUARED) || (dist == VQ_DIST_DOT) ? 0.0f : w[t*k + i]));
+    }
+    if (dist == VQ_DIST_DOT) {
+	nv = vld1q_f32(&c->norm[j]);
+	for(t=0; t<nt; t++)
+	    e[t] = vsubq_f32(nv, vaddq_f32(e[t], e[t]));
+    }
+}
+
+/* searches entries j0..j1-1 for targets 0..nt-1 */
+
+static ALWAYS_INLINE void tile_neon(int dist, int layout, const VQ_CB *c,
+                                    const float x[], const float w[], int k,
+                                    int j0, int j1, int nt, int idx[],
+                                    float beste[])
+{
+    float32x4_t e[VQ_BATCH], best[VQ_BATCH];
+    uint32x4_t  lt;
+    int32x4_t   besti[VQ_BATCH], jv;
+    float       lv[4];
+    int         li[4];
+    int         j, t;
+    const int32_t init[4] = {0, 1, 2, 3};
+
+    for(t=0; t<nt; t++) {
+	best[t]  = vdupq_n_f32(beste[t]);
+	besti[t] = vdupq_n_s32(-1);
+    }
+    jv = vaddq_s32(vld1q_s32(init), vdupq_n_s32(j0));
+    for(j=j0; j+4<=j1; j+=4) {
+	multi_neon(dist, layout, c, x, w, k, j, nt, e);
+	for(t=0; t<nt; t++) {
+	    lt = vcltq_f32(e[t], best[t]);
+	    best[t] = vbslq_f32(lt, e[t], best[t]);
+	    besti[t] = vbslq_s32(lt, jv, besti[t]);
+	}
+	jv = vaddq_s32(jv, vdupq_n_s32(4));
+    }
+    for(t=0; t<nt; t++) {
+	vst1q_f32(lv, best[t]);
+	vst1q_s32((int32_t*)li, besti[t]);
+	batch_merge(4, lv, li, dist, layout, c, &x[t*k], target_w(w, k, t), k, j, j1,
+		    &idx[t], &beste[t]);
+    }
+}
+
+static ALWAYS_INLINE int nearest_batch_neon_impl(int dist, int layout, const VQ_CB *c,
+                                                 const float x[], const float w[],
+                                                 int k, int m, int nvec, int idx[],
+                                                 float beste[])
+{
+    int j0, j1, t;
+
+    for(t=0; t<nvec; t++)
+	idx[t] = 0;
+    for(j0=0; j0<m; j0=j1) {
+	j1 = (m - j0) < VQ_TILE ? m : j0 + VQ_TILE;
+	for(t=0; t+VQ_BATCH<=nvec; t+=VQ_BATCH)
+	    tile_neon(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, j1, VQ_BATCH,
+		      &idx[t], &beste[t]);
+	for(; t<nvec; t++)
+	    tile_neon(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, j1, 1,
+		      &idx[t], &beste[t]);
+    }
+
+    return 0;
+}
+
+static int nearest_batch_neon(int dist, int layout, const VQ_CB *c, const float x[],
+                              const float w[], int k, int m, int nvec, int idx[],
+                              float beste[])
+{
+    DISPATCH(nearest_batch_neon_impl, dist, layout, c, x, w, k, m, nvec, idx, beste);
+}
+
+static ALWAYS_INLINE void dtile_neon(int dist, int layout, const VQ_CB *c,
+                                     const float x[], const float w[], int k,
+                                     int j0, int jt, int j1, int n, int nt,
+                                     float e[])
+{
+    float32x4_t d[VQ_BATCH];
+    int    j, t;
+
+    for(j=jt; j+4<=j1; j+=4) {
+	multi_neon(dist, layout, c, x, w, k, j0+j, nt, d);
+	for(t=0; t<nt; t++)
+	    vst1q_f32(&e[t*n + j], d[t]);
+    }
+    for(; j<j1; j++)
+	for(t=0; t<nt; t++)
+	    e[t*n + j] = dist_scalar(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0+j);
+}
+
+static ALWAYS_INLINE int distances_batch_neon_impl(int dist, int layout, const VQ_CB *c,
+                                                   const float x[], const float w[],
+                                                   int k, int j0, int n, int nvec,
+                                                   float e[])
+{
+    int jt, j1, t;
+
+    for(jt=0; jt<n; jt=j1) {
+	j1 = (n - jt) < VQ_TILE ? n : jt + VQ_TILE;
+	for(t=0; t+VQ_BATCH<=nvec; t+=VQ_BATCH)
+	    dtile_neon(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, jt, j1, n,
+		       VQ_BATCH, &e[t*n]);
+	for(; t<nvec; t++)
+	    dtile_neon(dist, layout, c, &x[t*k], target_w(w, k, t), k, j0, jt, j1, n,
+		       1, &e[t*n]);
+    }
+
+    return 0;
+}
+
+static int distances_batch_neon(int dist, int layout, const VQ_CB *c, const float x[],
+                                const float w[], int k, int j0, int n, int nvec,
+                                float e[])
+{
+    DISPATCH(distances_batch_neon_impl, dist, layout, c, x, w, k, j0, n, nvec, e);
+}
+
+#endif /* VQ_NEON */
+
+/*---------------------------------------------------------------------------*\
+
+                                 PHASE
+
+  Complex entries matched on angle, see vq_phase_distances().  The
+  target is reduced to its non zero elements first, so an entry costs
+  one angle per element that counts.  Lanes are entries, as above.
+
+\*---------------------------------------------------------------------------*/
+
+#define PHASE_PI_2  1.57079632679f
+#define PHASE_PI    3.14159265359f
+#define PHASE_TINY  1E-30f        /* keeps 0/0 out of the angle of 0+j0 */
+
+/* A&S 4.4.49, atan(a) = a + a*s*p(s), s = a*a, 0 <= a <= 1, to 2E-8 */
+
+#define ATAN_A2   -0.3333314528f
+#define ATAN_A4    0.1999355085f
+#define ATAN_A6   -0.1420889944f
+#define ATAN_A8    0.1065626393f
+#define ATAN_A10  -0.0752896400f
+#define ATAN_A12   0.0429096138f
+#define ATAN_A14  -0.0161657367f
+#define ATAN_A16   0.0028662257f
+
+/* target reduced to the elements that count */
+
+typedef struct {
+    int   n;                /* non zero elements                   */
+    int   i[MAX_AMP];       /* their index in the entry            */
+    float xr[MAX_AMP];      /* target real part                    */
+    float xi[MAX_AMP];      /* target imaginary part               */
+    float w2[MAX_AMP];      /* w*w                                 */
+} VQ_PHASE;
+
+typedef void (*vq_phase_fn)(const float *cb, const VQ_PHASE *t, int k, int j0, int n,
+                            float e[], float se[]);
+
+/* |atan2(di, dr)|, the sign isn't needed as only d*d is used */
+
+static ALWAYS_INLINE float angle_scalar(float dr, float di)
+{
+    float ax, ay, mn, mx, a, s, p, r;
+
+    ax = dr < 0.0f ? -dr : dr;
+    ay = di < 0.0f ? -di : di;
+    mn = ay < ax ? ay : ax;
+    mx = ay < ax ? ax : ay;
+    mx = mx < PHASE_TINY ? PHASE_TINY : mx;
+    a = mn/mx;
+    s = a*a;
+    p = ATAN_A16;
+    p = p*s + ATAN_A14; p = p*s + ATAN_A12; p = p*s + ATAN_A10; p = p*s + ATAN_A8;
+    p = p*s + ATAN_A6;  p = p*s + ATAN_A4;  p = p*s + ATAN_A2;
+    r = a + (a*s)*p;
+    if (ay > ax)
+	r = PHASE_PI_2 - r;
+    if (dr < 0.0f)
+	r = PHASE_PI - r;
+
+    return r;
+}
+
+static void phase_scalar(const float *cb, const VQ_PHASE *t, int k, int j0, int n,
+                         float e[], float se[])
+{
+    const float *c;
+    float        cr, ci, dr, di, d, d2, ej, sej;
+    int          j, l;
+
+    for(j=0; j<n; j++) {
+	c = &cb[2*(j0 + j)*k];
+	ej = sej = 0.0f;
+	for(l=0; l<t->n; l++) {
+	    cr = c[2*t->i[l]]; ci = c[2*t->i[l] + 1];
+	    dr = cr*t->xr[l] + ci*t->xi[l];
+	    di = ci*t->xr[l] - cr*t->xi[l];
+	    d = angle_scalar(dr, di);
+	    d2 = d*d;
+	    ej += t->w2[l]*d2;
+	    sej += d2;
+	}
+	e[j] = ej;
+	if (se != NULL)
+	    se[j] = sej;
+    }
+}
+
+#ifdef VQ_X86
+
+static ALWAYS_INLINE TARGET_SSE2 __m128 poly_sse2(__m128 a, __m128 s)
+{
+    __m128 p;
+
+    p = _mm_set1_ps(ATAN_A16);
+    p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_A14));
+    p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_A12));
+    p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_A10));
+    p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_A8));
+    p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_A6));
+    p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_A4));
+    p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_A2));
+    return _mm_add_ps(a, _mm_mul_ps(_mm_mul_ps(a, s), p));
+}
+
+static ALWAYS_INLINE TARGET_SSE2 __m128 angle_sse2(__m128 dr, __m128 di)
+{
+    __m128 abs, ax, ay, mn, mx, a, r, m;
+
+    abs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    ax = _mm_and_ps(dr, abs);
+    ay = _mm_and_ps(di, abs);
+    mn = _mm_min_ps(ay, ax);
+    mx = _mm_max_ps(_mm_max_ps(ay, ax), _mm_set1_ps(PHASE_TINY));
+    a = _mm_div_ps(mn, mx);
+    r = poly_sse2(a, _mm_mul_ps(a, a));
+    m = _mm_cmpgt_ps(ay, ax);
+    r = _mm_or_ps(_mm_and_ps(m, _mm_sub_ps(_mm_set1_ps(PHASE_PI_2), r)), _mm_andnot_ps(m, r));
+    m = _mm_cmplt_ps(dr, _mm_setzero_ps());
+    r = _mm_or_ps(_mm_and_ps(m, _mm_sub_ps(_mm_set1_ps(PHASE_PI), r)), _mm_andnot_ps(m, r));
+
+    return r;
+}
+
+static TARGET_SSE2 void phase_sse2(const float *cb, const VQ_PHASE *t, int k, int j0, int n,
+                                   float e[], float se[])
+{
+    const float *c;
+    __m128       cr, ci, xr, xi, dr, di, d2, ev, sev;
+    int          j, l, o;
+
+    for(j=0; j+4<=n; j+=4) {
+	c = &cb[2*(j0 + j)*k];
+	ev = sev = _mm_setzero_ps();
+	for(l=0; l<t->n; l++) {
+	    o = 2*t->i[l];
+	    cr = _mm_set_ps(c[6*k + o], c[4*k + o], c[2*k + o], c[o]);
+	    ci = _mm_set_ps(c[6*k + o + 1], c[4*k + o + 1], c[2*k + o + 1], c[o + 1]);
+	    xr = _mm_set1_ps(t->xr[l]);
+	    xi = _mm_set1_ps(t->xi[l]);
+	    dr = _mm_add_ps(_mm_mul_ps(cr, xr), _mm_mul_ps(ci, xi));
+	    di = _mm_sub_ps(_mm_mul_ps(ci, xr), _mm_mul_ps(cr, xi));
+	    d2 = angle_sse2(dr, di);
+	    d2 = _mm_mul_ps(d2, d2);
+	    ev = _mm_add_ps(ev, _mm_mul_ps(_mm_set1_ps(t->w2[l]), d2));
+	    sev = _mm_add_ps(sev, d2);
+	}
+	_mm_storeu_ps(&e[j], ev);
+	if (se != NULL)
+	    _mm_storeu_ps(&se[j], sev);
+    }
+    if (j < n)
+	phase_scalar(cb, t, k, j0 + j, n - j, &e[j], se != NULL ? &se[j] : NULL);
+}
+
+static ALWAYS_INLINE TARGET_AVX2 __m256 poly_avx2(__m256 a, __m256 s)
+{
+    __m256 p;
+
+    /* _mm256_mul_ps/_mm256_add_ps rather than FMA, as step_avx2() */
+
+    p = _mm256_set1_ps(ATAN_A16);
+    p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_A14));
+    p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_A12));
+    p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_A10));
+    p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_A8));
+    p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_A6));
+    p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_A4));
+    p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_A2));
+    return _mm256_add_ps(a, _mm256_mul_ps(_mm256_mul_ps(a, s), p));
+}
+
+static ALWAYS_INLINE TARGET_AVX2 __m256 angle_avx2(__m256 dr, __m256 di)
+{
+    __m256 abs, ax, ay, mn, mx, a, r;
+
+    abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    ax = _mm256_and_ps(dr, abs);
+    ay = _mm256_and_ps(di, abs);
+    mn = _mm256_min_ps(ay, ax);
+    mx = _mm256_max_ps(_mm256_max_ps(ay, ax), _mm256_set1_ps(PHASE_TINY));
+    a = _mm256_div_ps(mn, mx);
+    r = poly_avx2(a, _mm256_mul_ps(a, a));
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(PHASE_PI_2), r),
+			 _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(PHASE_PI), r),
+			 _mm256_cmp_ps(dr, _mm256_setzero_ps(), _CMP_LT_OQ));
+
+    return r;
+}
+
+static TARGET_AVX2 void phase_avx2(const float *cb, const VQ_PHASE *t, int k, int j0, int n,
+                                   float e[], float se[])
+{
+    const float *c;
+    __m256       cr, ci, xr, xi, dr, di, d2, ev, sev;
+    int          j, l, o, s;
+
+    /* strided lane loads, _mm256_i32gather_ps() is slower here */
+
+    s = 2*k;
+    for(j=0; j+8<=n; j+=8) {
+	c = &cb[2*(j0 + j)*k];
+	ev = sev = _mm256_setzero_ps();
+	for(l=0; l<t->n; l++) {
+	    o = 2*t->i[l];
+	    cr = _mm256_set_ps(c[7*s + o], c[6*s + o], c[5*s + o], c[4*s + o],
+			       c[3*s + o], c[2*s + o], c[s + o], c[o]);
+	    ci = _mm256_set_ps(c[7*s + o + 1], c[6*s + o + 1], c[5*s + o + 1], c[4*s + o + 1],
+			       c[3*s + o + 1], c[2*s + o + 1], c[s + o + 1], c[o + 1]);
+	    xr = _mm256_set1_ps(t->xr[l]);
+	    xi = _mm256_set1_ps(t->xi[l]);
+	    dr = _mm256_add_ps(_mm256_mul_ps(cr, xr), _mm256_mul_ps(ci, xi));
+	    di = _mm256_sub_ps(_mm256_mul_ps(ci, xr), _mm256_mul_ps(cr, xi));
+	    d2 = angle_avx2(dr, di);
+	    d2 = _mm256_mul_ps(d2, d2);
+	    ev = _mm256_add_ps(ev, _mm256_mul_ps(_mm256_set1_ps(t->w2[l]), d2));
+	    sev = _mm256_add_ps(sev, d2);
+	}
+	_mm256_storeu_ps(&e[j], ev);
+	if (se != NULL)
+	    _mm256_storeu_ps(&se[j], sev);
+    }
+    if (j < n)
+	phase_sse2(cb, t, k, j0 + j, n - j, &e[j], se != NULL ? &se[j] : NULL);
+}
+
+#endif /* VQ_X86 */
+
+/* vdivq_f32 is AArch64 only, 32 bit NEON has just a reciprocal
+   estimate, so the phase search stays scalar there */
+
+#if defined(VQ_NEON) && defined(__aarch64__)
+#define VQ_PHASE_NEON
+
+static ALWAYS_INLINE float32x4_t angle_neon(float32x4_t dr, float32x4_t di)
+{
+    float32x4_t ax, ay, mn, mx, a, s, p, r;
+
+    ax = vabsq_f32(dr);
+    ay = vabsq_f32(di);
+    mn = vminq_f32(ay, ax);
+    mx = vmaxq_f32(vmaxq_f32(ay, ax), vdupq_n_f32(PHASE_TINY));
+    a = vdivq_f32(mn, mx);
+    s = vmulq_f32(a, a);
+    p = vdupq_n_f32(ATAN_A16);
+    p = vaddq_f32(vmulq_f32(p, s), vdupq_n_f32(ATAN_A14));
+    p = vaddq_f32(vmulq_f32(p, s), vdupq_n_f32(ATAN_A12));
+    p = vaddq_f32(vmulq_f32(p, s), vdupq_n_f32(ATAN_A10));
+    p = vaddq_f32(vmulq_f32(p, s), vdupq_n_f32(ATAN_A8));
+    p = vaddq_f32(vmulq_f32(p, s), vdupq_n_f32(ATAN_A6));
+    p = vaddq_f32(vmulq_f32(p, s), vdupq_n_f32(ATAN_A4));
+    p = vaddq_f32(vmulq_f32(p, s), vdupq_n_f32(ATAN_A2));
+    r = vaddq_f32(a, vmulq_f32(vmulq_f32(a, s), p));
+    r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(PHASE_PI_2), r), r);
+    r = vbslq_f32(vcltq_f32(dr, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(PHASE_PI), r), r);
+
+    return r;
+}
+
+static void phase_neon(const float *cb, const VQ_PHASE *t, int k, int j0, int n,
+                       float e[], float se[])
+{
+    const float *c;
+    float32x4_t  cr, ci, xr, xi, dr, di, d2, ev, sev;
+    float        tr[4], ti[4];
+    int          j, l, o;
+
+    for(j=0; j+4<=n; j+=4) {
+	c = &cb[2*(j0 + j)*k];
+	ev = sev = vdupq_n_f32(0.0f);
+	for(l=0; l<t->n; l++) {
+	    o = 2*t->i[l];
+	    tr[0] = c[o]; tr[1] = c[2*k + o]; tr[2] = c[4*k + o]; tr[3] = c[6*k + o];
+	    ti[0] = c[o + 1]; ti[1] = c[2*k + o + 1]; ti[2] = c[4*k + o + 1]; ti[3] = c[6*k + o + 1];
+	    cr = vld1q_f32(tr);
+	    ci = vld1q_f32(ti);
+	    xr = vdupq_n_f32(t->xr[l]);
+	    xi = vdupq_n_f32(t->xi[l]);
+	    dr = vaddq_f32(vmulq_f32(cr, xr), vmulq_f32(ci, xi));
+	    di = vsubq_f32(vmulq_f32(ci, xr), vmulq_f32(cr, xi));
+	    d2 = angle_neon(dr, di);
+	    d2 = vmulq_f32(d2, d2);
+	    ev = vaddq_f32(ev, vmulq_f32(vdupq_n_f32(t->w2[l]), d2));
+	    sev = vaddq_f32(sev, d2);
+	}
+	vst1q_f32(&e[j], ev);
+	if (se != NULL)
+	    vst1q_f32(&se[j], sev);
+    }
+    if (j < n)
+	phase_scalar(cb, t, k, j0 + j, n - j, &e[j], se != NULL ? &se[j] : NULL);
+}
+
+#endif /* VQ_PHASE_NEON */
+
+/*---------------------------------------------------------------------------*\
+
+                               DISPATCH
+
+\*---------------------------------------------------------------------------*/
+
+static vq_nearest_fn         nearest_fn         = nearest_scalar;
+static vq_distances_fn       distances_fn       = distances_scalar;
+static vq_nearest_batch_fn   nearest_batch_fn   = nearest_batch_scalar;
+static vq_distances_batch_fn distances_batch_fn = distances_batch_scalar;
+static vq_phase_fn           phase_fn           = phase_scalar;
+static const char           *kernel_name        = "scalar";
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: vq_init
+  DATE CREATED: Oct 2026
+
+  Selects the fastest kernels supported by this CPU.  Called from
+  quantise_init(); until then the scalar kernels are used.
+
+\*---------------------------------------------------------------------------*/
+
+void vq_init(void)
+{
+#ifdef VQ_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	nearest_fn = nearest_avx2;
+	distances_fn = distances_avx2;
+	nearest_batch_fn = nearest_batch_avx2;
+	distances_batch_fn = distances_batch_avx2;
+	phase_fn = phase_avx2;
+	kernel_name = "avx2";
+	return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+	nearest_fn = nearest_sse2;
+	distances_fn = distances_sse2;
+	nearest_batch_fn = nearest_batch_sse2;
+	distances_batch_fn = distances_batch_sse2;
+	phase_fn = phase_sse2;
+	kernel_name = "sse2";
+	return;
+    }
+#endif
+#ifdef VQ_NEON
+    nearest_fn = nearest_neon;
+    distances_fn = distances_neon;
+    nearest_batch_fn = nearest_batch_neon;
+    distances_batch_fn = distances_batch_neon;
+#ifdef VQ_PHASE_NEON
+    phase_fn = phase_neon;
+#endif
+    kernel_name = "neon";
+#endif
+}
+
+const char *vq_kernel_name(void)
+{
+    return kernel_name;
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: vq_nearest
+  DATE CREATED: Oct 2026
+
+  Searches the m entry, k dimensional row major codebook cb[] for the
+  entry nearest to x[] using distance measure dist, and returns its
+  index.  On entry *beste is the distance to beat, on exit it is the
+  distance of the returned entry.  If no entry beats *beste, 0 is
+  returned and *beste is unchanged.  w[] is ignored for
+  VQ_DIST_SQUARED.
+
+\*---------------------------------------------------------------------------*/
+
+long vq_nearest(int dist, const float *cb, const float x[], const float w[],
+                int k, int m, float *beste)
+{
+    VQ_CB c;
+
+    assert(cb != NULL);
+    assert(k > 0);
+    assert(dist != VQ_DIST_DOT);
+    c.cb = cb; c.stride = 0; c.norm = NULL; c.q = NULL; c.scale = 0.0;
+    return nearest_fn(dist, ROWS, &c, x, w, k, m, beste);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: vq_distances
+  DATE CREATED: Oct 2026
+
+  Computes the distance from x[] to each of the m entries of row major
+  codebook cb[], writing them to e[0..m-1].
+
+\*---------------------------------------------------------------------------*/
+
+void vq_distances(int dist, const float *cb, const float x[], const float w[],
+                  int k, int m, float e[])
+{
+    VQ_CB c;
+
+    assert(cb != NULL);
+    assert(k > 0);
+    assert(dist != VQ_DIST_DOT);
+    c.cb = cb; c.stride = 0; c.norm = NULL; c.q = NULL; c.scale = 0.0;
+    distances_fn(dist, ROWS, &c, x, w, k, 0, m, e);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: vq_nearest_cb
+  DATE CREATED: Oct 2026
+
+  As per vq_nearest(), for a codebook stage in either layout.
+  VQ_DIST_DOT needs a CB_LAYOUT_SOA stage with norms; *beste is then
+  the squared distance less ||x||^2.
+
+\*---------------------------------------------------------------------------*/
+
+long vq_nearest_cb(int dist, const struct lsp_codebook *cb, const float x[],
+                   const float w[], float *beste)
+{
+    VQ_CB c;
+
+    assert(cb != NULL);
+    assert((dist != VQ_DIST_DOT) || ((cb->layout == CB_LAYOUT_SOA) && (cb->norm != NULL)));
+    c.cb = cb->cb; c.stride = cb->mpad; c.norm = cb->norm; c.q = cb->cbq; c.scale = cb->scale;
+    return KERNEL(nearest, cb->layout)(dist, cb->layout, &c, x, w, cb->k, cb->m, beste);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: vq_distances_cb
+  DATE CREATED: Oct 2026
+
+  Computes the distance from x[] to entries j0..j0+n-1 of a codebook
+  stage in either layout, writing them to e[0..n-1].
+
+\*---------------------------------------------------------------------------*/
+
+void vq_distances_cb(int dist, const struct lsp_codebook *cb, int j0, int n,
+                     const float x[], const float w[], float e[])
+{
+    VQ_CB c;
+
+    assert(cb != NULL);
+    assert((j0 >= 0) && (j0 + n <= cb->m));
+    assert((dist != VQ_DIST_DOT) || ((cb->layout == CB_LAYOUT_SOA) && (cb->norm != NULL)));
+    c.cb = cb->cb; c.stride = cb->mpad; c.norm = cb->norm; c.q = cb->cbq; c.scale = cb->scale;
+    KERNEL(distances, cb->layout)(dist, cb->layout, &c, x, w, cb->k, j0, n, e);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: vq_nearest_batch_cb
+  DATE CREATED: Oct 2026
+
+  As per vq_nearest_cb() for nvec targets at once.  Target t is
+  x[t*k..t*k+k-1], its weights (if used) w[t*k..], k the stage
+  dimension.  Its index goes to idx[t], and beste[t] is its distance
+  to beat on entry and the distance found on exit.  The results are
+  exactly those of nvec vq_nearest_cb() calls.
+
+\*---------------------------------------------------------------------------*/
+
+void vq_nearest_batch_cb(int dist, const struct lsp_codebook *cb, int nvec,
+                         const float x[], const float w[], int idx[], float beste[])
+{
+    VQ_CB c;
+
+    assert(cb != NULL);
+    assert(nvec >= 0);
+    assert((dist != VQ_DIST_DOT) || ((cb->layout == CB_LAYOUT_SOA) && (cb->norm != NULL)));
+    assert((w != NULL) || (dist == VQ_DIST_SQUARED) || (dist == VQ_DIST_DOT));
+    c.cb = cb->cb; c.stride = cb->mpad; c.norm = cb->norm; c.q = cb->cbq; c.scale = cb->scale;
+    KERNEL(nearest_batch, cb->layout)(dist, cb->layout, &c, x, w, cb->k, cb->m, nvec, idx, beste);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: vq_distances_batch_cb
+  DATE CREATED: Oct 2026
+
+  As per vq_distances_cb() for nvec targets laid out as for
+  vq_nearest_batch_cb().  The distances of target t go to
+  e[t*n..t*n+n-1].
+
+\*---------------------------------------------------------------------------*/
+
+void vq_distances_batch_cb(int dist, const struct lsp_codebook *cb, int j0, int n, int nvec,
+                           const float x[], const float w[], float e[])
+{
+    VQ_CB c;
+
+    assert(cb != NULL);
+    assert(nvec >= 0);
+    assert((j0 >= 0) && (j0 + n <= cb->m));
+    assert((dist != VQ_DIST_DOT) || ((cb->layout == CB_LAYOUT_SOA) && (cb->norm != NULL)));
+    assert((w != NULL) || (dist == VQ_DIST_SQUARED) || (dist == VQ_DIST_DOT));
+    c.cb = cb->cb; c.stride = cb->mpad; c.norm = cb->norm; c.q = cb->cbq; c.scale = cb->scale;
+    KERNEL(distances_batch, cb->layout)(dist, cb->layout, &c, x, w, cb->k, j0, n, nvec, e);
+}
+
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: vq_phase_distances
+  DATE CREATED: Oct 2026
+
+  Computes the phase distance, see vq.h, from x[] to entries
+  j0..j0+n-1 of the k dimensional complex codebook cb[], writing them
+  to e[0..n-1], and the unweighted ones to se[0..n-1] if se isn't NULL.
+
+\*---------------------------------------------------------------------------*/
+
+void vq_phase_distances(const COMP cb[], const COMP x[], const float w[], int k,
+                        int j0, int n, float e[], float se[])
+{
+    VQ_PHASE t;
+    int      i;
+
+    assert(cb != NULL);
+    assert((k > 0) && (k <= MAX_AMP));
+    assert((j0 >= 0) && (n >= 0));
+
+    t.n = 0;
+    for(i=0; i<k; i++) {
+	if ((x[i].real != 0.0f) || (x[i].imag != 0.0f)) {
+	    t.i[t.n] = i;
+	    t.xr[t.n] = x[i].real;
+	    t.xi[t.n] = x[i].imag;
+	    t.w2[t.n] = w[i]*w[i];
+	    t.n++;
+	}
+    }
+    phase_fn((const float *)cb, &t, k, j0, n, e, se);
+}
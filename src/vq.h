@@ -0,0 +1,75 @@
+/*---------------------------------------------------------------------------*\
+
+  FILE........: vq.h
+  DATE CREATED: Oct 2026
+
+  Vector quantiser nearest neighbour search kernels.
+
+\*---------------------------------------------------------------------------*/
+
+/*
+  All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __VQ__
+#define __VQ__
+
+#include "defines.h"
+#include "comp.h"
+
+/* Distance measures.  Each matches the arithmetic of the scalar loop
+   it replaces exactly, so every kernel returns the same index. */
+
+#define VQ_DIST_SQUARED   0   /* sum (x-c)*(x-c)      find_nearest()          */
+#define VQ_DIST_WSQUARED  1   /* sum ((c-x)*w)^2      quantise(), mbest       */
+#define VQ_DIST_WEIGHTED  2   /* sum w*(x-c)*(x-c)    find_nearest_weighted() */
+
+/* ||c||^2 - 2x.c, ranks entries as VQ_DIST_SQUARED but is not bit exact
+   with it.  CB_LAYOUT_SOA stages with norms only. */
+
+#define VQ_DIST_DOT       3
+
+void vq_init(void);
+const char *vq_kernel_name(void);
+
+long vq_nearest(int dist, const float *cb, const float x[], const float w[],
+                int k, int m, float *beste);
+void vq_distances(int dist, const float *cb, const float x[], const float w[],
+                  int k, int m, float e[]);
+
+long vq_nearest_cb(int dist, const struct lsp_codebook *cb, const float x[],
+                   const float w[], float *beste);
+void vq_distances_cb(int dist, const struct lsp_codebook *cb, int j0, int n,
+                     const float x[], const float w[], float e[]);
+
+/* many targets against one stage, x[] and w[] hold nvec vectors of
+   the stage dimension back to back */
+
+void vq_nearest_batch_cb(int dist, const struct lsp_codebook *cb, int nvec,
+                         const float x[], const float w[], int idx[], float beste[]);
+void vq_distances_batch_cb(int dist, const struct lsp_codebook *cb, int j0, int n, int nvec,
+                           const float x[], const float w[], float e[]);
+
+/* Phase codebooks (phaseexp.c), m entries of k interleaved complex
+   elements.  An entry is matched on the angle d between each element
+   and the target, the angle of c*conj(x), over the non zero elements
+   of x[]: e[] is sum w*w*d*d and se[] sum d*d.  d is a polynomial
+   atan2() within 5E-7 radians of the libm one, evaluated the same way
+   by every kernel, so these distances are bit exact across kernels
+   but not with a libm atan2() search. */
+
+void vq_phase_distances(const COMP cb[], const COMP x[], const float w[], int k,
+                        int j0, int n, float e[], float se[]);
+
+#endif
@@ -0,0 +1,36 @@
+# Run by ctest as cmake -P: encodes CORPUS in MODE with ENCODER,
+# decodes the bitstream with DECODER, and checks the SHA-256 digests
+# of both against the line for KEY and MODE in DIGESTS.  Without one
+# it prints the line to add and the test is reported as skipped.
+
+foreach(var ENCODER DECODER CORPUS MODE OUT DIGESTS KEY)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "codec_digest.cmake: ${var} not set")
+    endif()
+endforeach()
+
+execute_process(COMMAND ${ENCODER} -m ${MODE} ${CORPUS} ${OUT}.c2
+    RESULT_VARIABLE result OUTPUT_QUIET)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${MODE}: encoder failed (${result})")
+endif()
+execute_process(COMMAND ${DECODER} ${OUT}.c2 ${OUT}.wav
+    RESULT_VARIABLE result OUTPUT_QUIET)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${MODE}: decoder failed (${result})")
+endif()
+
+file(SHA256 ${OUT}.c2 bits)
+file(SHA256 ${OUT}.wav speech)
+set(line "${KEY} ${MODE} ${bits} ${speech}")
+
+file(STRINGS ${DIGESTS} expected REGEX "^${KEY} ${MODE} ")
+if(NOT expected)
+    message("no digests for ${KEY} ${MODE}, to record them add to ${DIGESTS}:\n${line}")
+    return()
+endif()
+
+if(NOT expected STREQUAL line)
+    message(FATAL_ERROR "${MODE}: digests differ\n  expected ${expected}\n  got      ${line}")
+endif()
+message("${MODE}: bitstream and decoded speech match")
@@ -0,0 +1,777 @@
+/*
+ * codec2_batch - Encode or decode many files in parallel
+ *
+ * Takes a manifest, directories and/or file names and converts each
+ * file with its own codec state (8 kHz mono 16 bit WAV <-> .c2 files
+ * with the usual C2C2 header).  Files are dealt round robin onto one
+ * deque per worker thread.  Each worker takes work from the back of
+ * its own deque, and once that is empty it steals from the front of
+ * the others, so uneven file lengths still keep every core busy.
+ * Every worker owns one block of codec state memory, re-initialised
+ * with codec2_create_in_place() for each file, so the steady state
+ * does no allocation.  While a file is being coded the kernel is
+ * asked to read ahead the worker's next input.
+ *
+ * With -L N a worker encodes N files at a time in lock-step through a
+ * channel bank (codec2_bank.h), frame k of every file together, so the
+ * analysis DFTs run several streams per transform.  The files are
+ * dealt longest first, so the files a worker takes together are of
+ * similar length and few frames are wasted coding the silence after
+ * the shorter ones.  -V encodes every stream again on its own with
+ * codec2_encode() and counts the frames whose bits differ.  -G has
+ * each bank do its DFTs on an OpenCL device (codec2_bank_use_device(),
+ * CODEC2_OPENCL builds), -V then checks the device against the CPU.
+ *
+ * Reports aggregate throughput in audio seconds per wall second.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <codec2.h>
+#include <codec2_bank.h>
+#include "wav_util.h"
+
+#define C2_MAGIC     0x43324332     // "C2C2"
+#define SAMPLE_RATE  8000
+#define IO_BUF_SIZE  (64*1024)
+
+static const char *mode_names[] = {
+    "3200", "2400", "1600", "1400", "1300", "1200", "700", "700B"
+};
+#define NUM_MODES ((int)(sizeof(mode_names)/sizeof(mode_names[0])))
+
+typedef struct {
+    char *in;
+    char *out;
+} job_t;
+
+// Owner pops from the back, thieves take from the front
+typedef struct {
+    pthread_mutex_t lock;
+    int            *jobs;
+    int             front;
+    int             back;
+} deque_t;
+
+typedef struct {
+    int           id;
+    int           nworkers;
+    deque_t      *deques;
+    const job_t  *jobs;
+    int           mode;
+    int           decode;
+    int           verbose;
+    int           lanes;        // files encoded in lock-step, see encode_group()
+    int           verify;
+    int           device;       // -G: banks do their DFTs on the OpenCL device
+    void         *state_mem;
+    void         *scratch_mem;  // see codec2_set_scratch(), NULL if not needed
+    int          *group;        // -L: the jobs coded together and their results
+    long         *results;
+    // results
+    int           files_ok;
+    int           files_failed;
+    int           steals;
+    unsigned long verified;     // frames checked against codec2_encode()
+    unsigned long mismatches;
+    double        audio_seconds;
+    double        busy_seconds;
+} worker_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options] [-l manifest] [file|directory ...]\n", prog);
+    printf("\nOptions:\n");
+    printf("  -m MODE    Codec2 mode for encoding (3200 ... 700B), default 3200\n");
+    printf("  -d         Decode .c2 files to .wav instead of encoding\n");
+    printf("  -j N       Worker threads, default one per online CPU\n");
+    printf("  -l FILE    Manifest, one \"input [output]\" per line, - for stdin\n");
+    printf("  -o DIR     Output directory, default next to each input\n");
+    printf("  -L N       Encode N files at a time in lock-step per thread\n");
+    printf("  -G         Do the lock-step DFTs on an OpenCL device\n");
+    printf("  -V         Check the lock-step bits against each file encoded alone\n");
+    printf("  -v         Report each file\n");
+    printf("  -h         Show this help\n");
+    printf("\nDirectories are scanned for *.wav (or *.c2 with -d).  Outputs not\n");
+    printf("named in the manifest get the input name with the extension swapped.\n");
+    printf("Inputs must be 8000 Hz mono 16 bit PCM WAV files.\n");
+}
+
+static int mode_from_string(const char *s) {
+    int i;
+    for (i = 0; i < NUM_MODES; i++)
+        if (strcmp(s, mode_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                               Job list
+
+\*---------------------------------------------------------------------------*/
+
+static job_t *jobs = NULL;
+static int    njobs = 0, jobs_size = 0;
+
+static int has_ext(const char *name, const char *ext) {
+    size_t n = strlen(name), e = strlen(ext);
+    return n > e && strcmp(name + n - e, ext) == 0;
+}
+
+// Input name with its extension replaced, optionally moved to outdir
+static char *derive_output(const char *in, const char *outdir, const char *ext) {
+    const char *base = in, *slash, *dot;
+    size_t      stem;
+    char       *out;
+
+    if (outdir != NULL && (slash = strrchr(in, '/')) != NULL)
+        base = slash + 1;
+    dot = strrchr(base, '.');
+    slash = strrchr(base, '/');
+    stem = (dot != NULL && (slash == NULL || dot > slash)) ? (size_t)(dot - base) : strlen(base);
+
+    out = malloc((outdir ? strlen(outdir) + 1 : 0) + stem + strlen(ext) + 1);
+    if (out == NULL)
+        return NULL;
+    out[0] = 0;
+    if (outdir != NULL) {
+        strcat(out, outdir);
+        strcat(out, "/");
+    }
+    strncat(out, base, stem);
+    strcat(out, ext);
+    return out;
+}
+
+static int add_job(const char *in, const char *out, const char *outdir, const char *out_ext) {
+    if (njobs == jobs_size) {
+        int    n = jobs_size ? 2 * jobs_size : 256;
+        job_t *p = realloc(jobs, n * sizeof(job_t));
+        if (p == NULL)
+            return -1;
+        jobs = p;
+        jobs_size = n;
+    }
+    jobs[njobs].in = strdup(in);
+    jobs[njobs].out = out ? strdup(out) : derive_output(in, outdir, out_ext);
+    if (jobs[njobs].in == NULL || jobs[njobs].out == NULL)
+        return -1;
+    njobs++;
+    return 0;
+}
+
+static int add_manifest(const char *name, const char *outdir, const char *out_ext) {
+    FILE *f = strcmp(name, "-") == 0 ? stdin : fopen(name, "r");
+    char  line[4096], in[2048], out[2048];
+    int   n, ret = 0;
+
+    if (f == NULL) {
+        fprintf(stderr, "Error: Cannot open manifest '%s'\n", name);
+        return -1;
+    }
+    while (ret == 0 && fgets(line, sizeof(line), f) != NULL) {
+        n = sscanf(line, "%2047s %2047s", in, out);
+        if (n <= 0 || in[0] == '#')
+            continue;
+        ret = add_job(in, n == 2 ? out : NULL, outdir, out_ext);
+    }
+    if (f != stdin)
+        fclose(f);
+    return ret;
+}
+
+static int add_directory(const char *dir, const char *in_ext, const char *outdir, const char *out_ext) {
+    DIR           *d = opendir(dir);
+    struct dirent *e;
+    char          *path;
+    int            ret = 0;
+
+    if (d == NULL) {
+        fprintf(stderr, "Error: Cannot open directory '%s'\n", dir);
+        return -1;
+    }
+    while (ret == 0 && (e = readdir(d)) != NULL) {
+        if (!has_ext(e->d_name, in_ext))
+            continue;
+        path = malloc(strlen(dir) + strlen(e->d_name) + 2);
+        if (path == NULL) {
+            ret = -1;
+            break;
+        }
+        sprintf(path, "%s/%s", dir, e->d_name);
+        ret = add_job(path, NULL, outdir, out_ext);
+        free(path);
+    }
+    closedir(d);
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                            Work stealing
+
+\*---------------------------------------------------------------------------*/
+
+// Next job from the back of our own deque, or -1
+static int pop_own(deque_t *q, int *next) {
+    int j = -1;
+
+    pthread_mutex_lock(&q->lock);
+    if (q->back > q->front)
+        j = q->jobs[--q->back];
+    *next = (q->back > q->front) ? q->jobs[q->back - 1] : -1;
+    pthread_mutex_unlock(&q->lock);
+    return j;
+}
+
+// Oldest job of the first other worker that has one, or -1 when all are empty
+static int steal(worker_t *w) {
+    int i, j = -1;
+
+    for (i = 1; i < w->nworkers && j < 0; i++) {
+        deque_t *q = &w->deques[(w->id + i) % w->nworkers];
+        pthread_mutex_lock(&q->lock);
+        if (q->back > q->front)
+            j = q->jobs[q->front++];
+        pthread_mutex_unlock(&q->lock);
+    }
+    return j;
+}
+
+// Ask the kernel to start reading the next input while we code this one
+static void prefetch(const char *name) {
+#ifdef POSIX_FADV_WILLNEED
+    int fd = open(name, O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+#else
+    (void)name;
+#endif
+}
+
+/*---------------------------------------------------------------------------*\
+
+                             File coding
+
+\*---------------------------------------------------------------------------*/
+
+// Opens the input and creates the output with its header for c2's
+// mode.  Returns 0, or -1 with nothing left open.
+static int open_encode(const job_t *job, struct CODEC2 *c2, int mode, wav_file_t **wav, FILE **out) {
+    uint32_t header[4];
+
+    *wav = wav_open_read(job->in);
+    if (*wav == NULL) {
+        fprintf(stderr, "Error: Cannot read '%s'\n", job->in);
+        return -1;
+    }
+    if (wav_get_sample_rate(*wav) != SAMPLE_RATE || wav_get_channels(*wav) != 1 ||
+        wav_get_bits_per_sample(*wav) != 16) {
+        fprintf(stderr, "Error: '%s' is not 8000 Hz mono 16 bit\n", job->in);
+        wav_close(*wav);
+        return -1;
+    }
+    *out = fopen(job->out, "wb");
+    if (*out == NULL) {
+        fprintf(stderr, "Error: Cannot create '%s'\n", job->out);
+        wav_close(*wav);
+        return -1;
+    }
+    setvbuf(*out, NULL, _IOFBF, IO_BUF_SIZE);
+
+    header[0] = C2_MAGIC;
+    header[1] = mode;
+    header[2] = codec2_samples_per_frame(c2);
+    header[3] = codec2_bits_per_frame(c2);
+    if (fwrite(header, sizeof(uint32_t), 4, *out) != 4) {
+        fprintf(stderr, "Error: Writing '%s' failed\n", job->out);
+        fclose(*out);
+        wav_close(*wav);
+        return -1;
+    }
+    return 0;
+}
+
+// Returns the number of samples coded, or -1
+static long encode_file(worker_t *w, const job_t *job) {
+    wav_file_t    *wav;
+    FILE          *out;
+    struct CODEC2 *c2;
+    short          speech[320];
+    unsigned char  bits[8];
+    long           nsam_total = 0;
+    int            nsam, nbyte, n, err = 0;
+
+    c2 = codec2_create_in_place(w->mode, w->state_mem);
+    codec2_set_scratch(c2, w->scratch_mem);
+    nsam = codec2_samples_per_frame(c2);
+    nbyte = (codec2_bits_per_frame(c2) + 7) / 8;
+    if (open_encode(job, c2, w->mode, &wav, &out) != 0) {
+        codec2_destroy(c2);
+        return -1;
+    }
+
+    while (!err && (n = wav_read_samples(wav, speech, nsam)) > 0) {
+        if (n < nsam)
+            memset(&speech[n], 0, (nsam - n) * sizeof(short));
+        codec2_encode(c2, bits, speech);
+        if (fwrite(bits, 1, nbyte, out) != (size_t)nbyte)
+            err = 1;
+        nsam_total += n;
+    }
+
+    codec2_destroy(c2);
+    wav_close(wav);
+    if (fclose(out) != 0 || err) {
+        fprintf(stderr, "Error: Writing '%s' failed\n", job->out);
+        return -1;
+    }
+    return nsam_total;
+}
+
+// One file of a lock-step group
+typedef struct {
+    const job_t   *job;
+    int            slot;        // its place in the group
+    wav_file_t    *wav;
+    FILE          *out;
+    struct CODEC2 *ref;         // -V: the file encoded on its own
+    long           nsam_total;
+    int            live;        // samples still to come
+    int            err;
+} lane_t;
+
+// Encodes the n files idx[] together, each on its own channel of a
+// bank, until the longest ends.  result[i] is the number of samples of
+// file idx[i] coded, or -1.
+static void encode_group(worker_t *w, const int idx[], int n, long result[]) {
+    struct CODEC2_BANK *bank = NULL;
+    struct CODEC2      *c2;
+    lane_t             *lanes = calloc(n, sizeof(lane_t));
+    short              *speech = NULL;
+    unsigned char      *bits = NULL, ref_bits[8];
+    int                 nsam, nbyte, nlanes = 0, live, i, k, m;
+
+    for (i = 0; i < n; i++)
+        result[i] = -1;
+
+    // for the frame sizes and the headers
+    c2 = codec2_create_in_place(w->mode, w->state_mem);
+    codec2_set_scratch(c2, w->scratch_mem);
+    nsam = codec2_samples_per_frame(c2);
+    nbyte = (codec2_bits_per_frame(c2) + 7) / 8;
+    if (lanes == NULL)
+        goto done;
+
+    for (i = 0; i < n; i++) {
+        lane_t *l = &lanes[nlanes];
+        l->job = &w->jobs[idx[i]];
+        l->slot = i;
+        if (open_encode(l->job, c2, w->mode, &l->wav, &l->out) == 0) {
+            l->live = 1;
+            nlanes++;
+        }
+    }
+    if (nlanes == 0)
+        goto done;
+
+    bank = codec2_bank_create(w->mode, nlanes);
+    if (bank != NULL && w->device && codec2_bank_use_device(bank, 1) != 0)
+        fprintf(stderr, "Warning: No OpenCL device for worker %d, encoding on the CPU\n", w->id);
+    speech = malloc((size_t)nlanes * nsam * sizeof(short));
+    bits = malloc((size_t)nlanes * nbyte);
+    for (k = 0, m = 0; k < nlanes && w->verify; k++)
+        if ((lanes[k].ref = codec2_create(w->mode)) == NULL)
+            m = 1;
+    if (bank == NULL || speech == NULL || bits == NULL || m) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        for (k = 0; k < nlanes; k++)
+            lanes[k].err = 1;
+        nlanes = -nlanes;       // close the files, code nothing
+    }
+
+    for (;;) {
+        for (k = 0, live = 0; k < nlanes; k++) {
+            short *sp = &speech[k * nsam];
+            m = (lanes[k].live && !lanes[k].err) ? wav_read_samples(lanes[k].wav, sp, nsam) : 0;
+            if (m <= 0) {
+                lanes[k].live = 0;
+                m = 0;
+            }
+            memset(&sp[m], 0, (nsam - m) * sizeof(short));
+            lanes[k].nsam_total += m;
+            live += lanes[k].live;
+        }
+        if (live == 0)
+            break;
+
+        codec2_bank_encode(bank, bits, speech);
+        for (k = 0; k < nlanes; k++) {
+            if (!lanes[k].live)
+                continue;
+            if (fwrite(&bits[k * nbyte], 1, nbyte, lanes[k].out) != (size_t)nbyte)
+                lanes[k].err = 1;
+            if (lanes[k].ref != NULL) {
+                codec2_encode(lanes[k].ref, ref_bits, &speech[k * nsam]);
+                w->verified++;
+                if (memcmp(ref_bits, &bits[k * nbyte], nbyte) != 0)
+                    w->mismatches++;
+            }
+        }
+    }
+
+    if (nlanes < 0)
+        nlanes = -nlanes;
+    for (k = 0; k < nlanes; k++) {
+        wav_close(lanes[k].wav);
+        if (fclose(lanes[k].out) != 0 || lanes[k].err)
+            fprintf(stderr, "Error: Writing '%s' failed\n", lanes[k].job->out);
+        else
+            result[lanes[k].slot] = lanes[k].nsam_total;
+        if (lanes[k].ref != NULL)
+            codec2_destroy(lanes[k].ref);
+    }
+
+done:
+    codec2_destroy(c2);
+    if (bank != NULL)
+        codec2_bank_destroy(bank);
+    free(lanes);
+    free(speech);
+    free(bits);
+}
+
+static long decode_file(worker_t *w, const job_t *job) {
+    FILE          *in;
+    wav_file_t    *wav;
+    struct CODEC2 *c2;
+    short          speech[320];
+    unsigned char  bits[8];
+    uint32_t       header[4];
+    long           nsam_total = 0;
+    int            nsam, nbyte, err = 0;
+
+    in = fopen(job->in, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Error: Cannot read '%s'\n", job->in);
+        return -1;
+    }
+    setvbuf(in, NULL, _IOFBF, IO_BUF_SIZE);
+    if (fread(header, sizeof(uint32_t), 4, in) != 4 || header[0] != C2_MAGIC ||
+        header[1] >= (uint32_t)NUM_MODES) {
+        fprintf(stderr, "Error: '%s' is not a codec2 file\n", job->in);
+        fclose(in);
+        return -1;
+    }
+    wav = wav_open_write(job->out, SAMPLE_RATE, 1, 16);
+    if (wav == NULL) {
+        fprintf(stderr, "Error: Cannot create '%s'\n", job->out);
+        fclose(in);
+        return -1;
+    }
+
+    c2 = codec2_create_in_place(header[1], w->state_mem);
+    codec2_set_scratch(c2, w->scratch_mem);
+    nsam = codec2_samples_per_frame(c2);
+    nbyte = (codec2_bits_per_frame(c2) + 7) / 8;
+
+    while (!err && fread(bits, 1, nbyte, in) == (size_t)nbyte) {
+        codec2_decode(c2, speech, bits);
+        if (wav_write_samples(wav, speech, nsam) != nsam)
+            err = 1;
+        nsam_total += nsam;
+    }
+
+    codec2_destroy(c2);
+    fclose(in);
+    wav_close(wav);
+    if (err) {
+        fprintf(stderr, "Error: Writing '%s' failed\n", job->out);
+        return -1;
+    }
+    return nsam_total;
+}
+
+// Our next job, or another worker's, or -1 when there are none left
+static int next_job(worker_t *w, int *next) {
+    int j = pop_own(&w->deques[w->id], next);
+
+    if (j < 0) {
+        j = steal(w);
+        if (j >= 0)
+            w->steals++;
+        *next = -1;
+    }
+    return j;
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    double    t0;
+    long      n;
+    int       group[1], i, j, ngroup, next = -1;
+    long      results[1];
+    int      *idx = w->lanes > 1 ? w->group : group;
+    long     *result = w->lanes > 1 ? w->results : results;
+
+    for (;;) {
+        for (ngroup = 0; ngroup < w->lanes; ngroup++) {
+            j = next_job(w, &next);
+            if (j < 0)
+                break;
+            idx[ngroup] = j;
+        }
+        if (ngroup == 0)
+            break;
+        if (next >= 0)
+            prefetch(w->jobs[next].in);
+
+        t0 = now_seconds();
+        if (w->decode)
+            result[0] = decode_file(w, &w->jobs[idx[0]]);
+        else if (w->lanes > 1 || w->verify)
+            encode_group(w, idx, ngroup, result);
+        else
+            result[0] = encode_file(w, &w->jobs[idx[0]]);
+        w->busy_seconds += now_seconds() - t0;
+
+        for (i = 0; i < ngroup; i++) {
+            j = idx[i];
+            n = result[i];
+            if (n < 0) {
+                w->files_failed++;
+                continue;
+            }
+            w->files_ok++;
+            w->audio_seconds += (double)n / SAMPLE_RATE;
+            if (w->verbose)
+                fprintf(stderr, "[%d] %s -> %s (%.2f s)\n", w->id, w->jobs[j].in, w->jobs[j].out,
+                        (double)n / SAMPLE_RATE);
+        }
+    }
+    return NULL;
+}
+
+// Longest input first, for -L
+typedef struct {
+    job_t     job;
+    long long size;
+} sized_job_t;
+
+static int longer_first(const void *a, const void *b) {
+    long long sa = ((const sized_job_t *)a)->size, sb = ((const sized_job_t *)b)->size;
+    return (sa < sb) - (sa > sb);
+}
+
+static int sort_jobs_by_size(void) {
+    sized_job_t *sized = malloc(njobs * sizeof(sized_job_t));
+    struct stat  st;
+    int          i;
+
+    if (sized == NULL)
+        return -1;
+    for (i = 0; i < njobs; i++) {
+        sized[i].job = jobs[i];
+        sized[i].size = stat(jobs[i].in, &st) == 0 ? (long long)st.st_size : 0;
+    }
+    qsort(sized, njobs, sizeof(sized_job_t), longer_first);
+    for (i = 0; i < njobs; i++)
+        jobs[i] = sized[i].job;
+    free(sized);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *manifest = NULL, *outdir = NULL;
+    const char *in_ext, *out_ext;
+    int         mode = CODEC2_MODE_3200, decode = 0, verbose = 0, lanes = 1, verify = 0, device = 0;
+    unsigned long verified = 0, mismatches = 0;
+    int         nworkers = 0, opt, i, ok = 0, failed = 0, steals = 0;
+    double      audio = 0.0, busy = 0.0, t_start, wall;
+    size_t      scratch_size = 0;
+    struct stat st;
+    deque_t    *deques;
+    worker_t   *workers;
+    pthread_t  *threads;
+
+    while ((opt = getopt(argc, argv, "m:dj:l:o:L:GVvh")) != -1) {
+        switch (opt) {
+        case 'm':
+            mode = mode_from_string(optarg);
+            if (mode < 0) {
+                fprintf(stderr, "Error: Invalid mode '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'd': decode = 1; break;
+        case 'j': nworkers = atoi(optarg); break;
+        case 'l': manifest = optarg; break;
+        case 'o': outdir = optarg; break;
+        case 'L': lanes = atoi(optarg); break;
+        case 'G': device = 1; break;
+        case 'V': verify = 1; break;
+        case 'v': verbose = 1; break;
+        case 'h': print_usage(argv[0]); return 0;
+        default:  print_usage(argv[0]); return 1;
+        }
+    }
+    if (decode && (lanes > 1 || verify || device)) {
+        fprintf(stderr, "Error: -L, -G and -V only apply to encoding\n");
+        return 1;
+    }
+    if (lanes < 1)
+        lanes = 1;
+    if (device) {
+        struct CODEC2_BANK *probe = codec2_bank_create(mode, 2);
+        if (lanes < 2 || probe == NULL || codec2_bank_use_device(probe, 1) != 0) {
+            fprintf(stderr, "Error: -G needs -L 2 or more, a mode other than 700 and 700B,\n"
+                            "a CODEC2_OPENCL build and an OpenCL device\n");
+            return 1;
+        }
+        codec2_bank_destroy(probe);
+    }
+    in_ext = decode ? ".c2" : ".wav";
+    out_ext = decode ? ".wav" : ".c2";
+
+    if (manifest != NULL && add_manifest(manifest, outdir, out_ext) != 0)
+        return 1;
+    for (i = optind; i < argc; i++) {
+        int ret;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+            ret = add_directory(argv[i], in_ext, outdir, out_ext);
+        else
+            ret = add_job(argv[i], NULL, outdir, out_ext);
+        if (ret != 0)
+            return 1;
+    }
+    if (njobs == 0) {
+        fprintf(stderr, "Error: No input files\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (nworkers <= 0)
+        nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nworkers <= 0)
+        nworkers = 1;
+    if (nworkers > (njobs + lanes - 1) / lanes)
+        nworkers = (njobs + lanes - 1) / lanes;
+    if (lanes > 1 && sort_jobs_by_size() != 0) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+
+    deques = calloc(nworkers, sizeof(deque_t));
+    workers = calloc(nworkers, sizeof(worker_t));
+    threads = calloc(nworkers, sizeof(pthread_t));
+    if (deques == NULL || workers == NULL || threads == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+
+    // Deal the files round robin, each worker starts at the back of its share
+    for (i = 0; i < nworkers; i++) {
+        pthread_mutex_init(&deques[i].lock, NULL);
+        deques[i].jobs = malloc(((njobs + nworkers - 1) / nworkers) * sizeof(int));
+        if (deques[i].jobs == NULL) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < njobs; i++) {
+        deque_t *q = &deques[i % nworkers];
+        q->jobs[q->back++] = i;
+    }
+
+    // decoding takes each file's mode from its header
+    for (i = CODEC2_MODE_3200; i <= CODEC2_MODE_700B; i++)
+        if (codec2_scratch_size(i) > scratch_size)
+            scratch_size = codec2_scratch_size(i);
+
+    t_start = now_seconds();
+    for (i = 0; i < nworkers; i++) {
+        workers[i].id = i;
+        workers[i].nworkers = nworkers;
+        workers[i].deques = deques;
+        workers[i].jobs = jobs;
+        workers[i].mode = mode;
+        workers[i].decode = decode;
+        workers[i].verbose = verbose;
+        workers[i].lanes = lanes;
+        workers[i].verify = verify;
+        workers[i].device = device;
+        workers[i].state_mem = malloc(codec2_get_state_size(mode));
+        workers[i].scratch_mem = scratch_size ? malloc(scratch_size) : NULL;
+        workers[i].group = malloc(lanes * sizeof(int));
+        workers[i].results = malloc(lanes * sizeof(long));
+        if (workers[i].state_mem == NULL ||
+            (scratch_size && workers[i].scratch_mem == NULL) ||
+            workers[i].group == NULL || workers[i].results == NULL ||
+            pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Error: Cannot start worker %d\n", i);
+            return 1;
+        }
+    }
+    for (i = 0; i < nworkers; i++) {
+        pthread_join(threads[i], NULL);
+        ok += workers[i].files_ok;
+        failed += workers[i].files_failed;
+        steals += workers[i].steals;
+        verified += workers[i].verified;
+        mismatches += workers[i].mismatches;
+        audio += workers[i].audio_seconds;
+        busy += workers[i].busy_seconds;
+    }
+    wall = now_seconds() - t_start;
+
+    printf("%s %d files with %d threads (%s)\n", decode ? "Decoded" : "Encoded", ok, nworkers,
+           decode ? "mode from file headers" : mode_names[mode]);
+    if (failed)
+        printf("Failed:          %d files\n", failed);
+    printf("Audio:           %.1f s\n", audio);
+    printf("Wall time:       %.3f s\n", wall);
+    printf("Throughput:      %.1f audio s per wall s\n", wall > 0.0 ? audio / wall : 0.0);
+    printf("Per thread:      %.1f x realtime\n", busy > 0.0 ? audio / busy : 0.0);
+    printf("Utilisation:     %.0f%%\n", wall > 0.0 ? 100.0 * busy / (wall * nworkers) : 0.0);
+    printf("Steals:          %d\n", steals);
+    if (lanes > 1)
+        printf("Lock-step:       %d files per bank%s\n", lanes, device ? ", DFTs on the OpenCL device" : "");
+    if (verify)
+        printf("Verified:        %lu frames, %lu differ\n", verified, mismatches);
+
+    for (i = 0; i < nworkers; i++) {
+        free(workers[i].state_mem);
+        free(workers[i].scratch_mem);
+        free(workers[i].group);
+        free(workers[i].results);
+        free(deques[i].jobs);
+        pthread_mutex_destroy(&deques[i].lock);
+    }
+    for (i = 0; i < njobs; i++) {
+        free(jobs[i].in);
+        free(jobs[i].out);
+    }
+    free(jobs);
+    free(deques);
+    free(workers);
+    free(threads);
+
+    return (failed || mismatches) ? 1 : 0;
+}
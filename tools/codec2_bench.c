@@ -0,0 +1,673 @@
+/*
+ * codec2_bench - Codec2 encode/decode and DSP stage micro-benchmarks
+ *
+ * Runs every mode (or one, with -m) over a deterministic synthetic
+ * speech corpus and reports frames/s and ns/frame for encode and
+ * decode, then times the main analysis/synthesis stages in isolation.
+ * Each stage is timed over inputs captured from a previous pass, so
+ * only the stage itself is measured.
+ *
+ * With -q every combination of the encoder's speed options that
+ * applies to each mode is run against the full search, reporting
+ * encode time and how far the decoded speech drifts from that of the
+ * full search.
+ *
+ * With -w the bitstream and decoded speech digests and timings of
+ * each mode are saved as a baseline, and -c checks a later build
+ * against it: the digests must match exactly and each mode may be at
+ * most -p percent slower.  Floating point results depend on the
+ * compiler, flags and CPU, so a baseline is only good for the machine
+ * and configuration it was recorded with.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <codec2.h>
+
+#include "defines.h"
+#include "sine.h"
+#include "nlp.h"
+#include "quantise.h"
+#include "lpc.h"
+#include "kiss_fft.h"
+#include "kiss_fftr.h"
+#include "machdep.h"
+
+#define DEFAULT_SECONDS 30
+#define DEFAULT_REPEATS 3
+#define DEFAULT_TOLERANCE 10
+
+static const int modes[] = {
+    CODEC2_MODE_3200, CODEC2_MODE_2400, CODEC2_MODE_1600, CODEC2_MODE_1400,
+    CODEC2_MODE_1300, CODEC2_MODE_1200, CODEC2_MODE_700, CODEC2_MODE_700B
+};
+static const char *mode_names[] = {
+    "3200", "2400", "1600", "1400", "1300", "1200", "700", "700B"
+};
+#define NUM_MODES ((int)(sizeof(modes)/sizeof(modes[0])))
+
+void print_usage(const char* prog_name) {
+    printf("Usage: %s [options]\n", prog_name);
+    printf("\nOptions:\n");
+    printf("  -m MODE    Only benchmark MODE (3200, 2400, 1600, 1400, 1300, 1200, 700, 700B)\n");
+    printf("  -t SECS    Seconds of test speech (default %d)\n", DEFAULT_SECONDS);
+    printf("  -i FILE    Use FILE, raw 8 kHz 16-bit mono, instead of the synthetic speech\n");
+    printf("  -r N       Repeats, the fastest is reported (default %d)\n", DEFAULT_REPEATS);
+    printf("  -s         Skip the per-stage benchmarks\n");
+    printf("  -q         Quality against CPU for each combination of speed options\n");
+    printf("  -w FILE    Save the digests and timings of each mode as a baseline\n");
+    printf("  -c FILE    Check against a baseline, exits 1 if any mode differs\n");
+    printf("  -p PCT     How much slower than the baseline -c allows (default %d)\n", DEFAULT_TOLERANCE);
+    printf("  -h         Show this help\n");
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+// Deterministic "speech": a glottal pulse train with drifting pitch
+// through two formant resonators for voiced segments, LCG noise for
+// unvoiced segments, and low level noise for silence.  The same corpus
+// is generated on every run and every platform.
+static short *make_corpus(int nsamples) {
+    short *s = (short*)malloc(nsamples*sizeof(short));
+    unsigned long seed = 1;
+    double y1[2] = {0, 0}, y2[2] = {0, 0};
+    double phase = 0.0;
+    int i;
+
+    if (s == NULL)
+        return NULL;
+
+    for (i = 0; i < nsamples; i++) {
+        int segment = (i / 2400) % 4;             // 300ms segments
+        double f0 = 100.0 + 60.0*sin(TWO_PI*i/24000.0);
+        double x, out;
+        int k;
+
+        seed = seed*1103515245 + 12345;
+        double noise = ((double)((seed >> 16) & 0x7fff)/32768.0) - 0.5;
+
+        if (segment < 2) {
+            phase += f0/8000.0;
+            x = 0.0;
+            if (phase >= 1.0) {
+                phase -= 1.0;
+                x = 4000.0;
+            }
+        } else if (segment == 2) {
+            x = 400.0*noise;
+        } else {
+            x = 10.0*noise;
+        }
+
+        // two resonators, 500 Hz and 1500 Hz
+        out = x;
+        for (k = 0; k < 2; k++) {
+            double fc = k ? 1500.0 : 500.0;
+            double r = 0.97;
+            double a1 = 2.0*r*cos(TWO_PI*fc/8000.0);
+            double a2 = -r*r;
+            double y = out + a1*y1[k] + a2*y2[k];
+            y2[k] = y1[k];
+            y1[k] = y;
+            out = y*(1.0 - r);
+        }
+        out *= 8.0;
+        if (out > 32767.0) out = 32767.0;
+        if (out < -32767.0) out = -32767.0;
+        s[i] = (short)out;
+    }
+
+    return s;
+}
+
+// One mode's results, as saved by -w
+typedef struct {
+    int                nframes;
+    unsigned long long bits_hash;      // FNV-1a of the bitstream
+    unsigned long long speech_hash;    // and of the decoded speech
+    double             enc_ns;         // per frame
+    double             dec_ns;
+} result_t;
+
+static unsigned long long fnv1a(unsigned long long h, const unsigned char *p, size_t n) {
+    while (n--) {
+        h ^= *p++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#define FNV1A_INIT 0xcbf29ce484222325ULL
+
+// Reads a raw corpus, *nsamples is set to its length
+static short *read_corpus(const char *file, int *nsamples) {
+    FILE *f = fopen(file, "rb");
+    short *s = NULL;
+    long n;
+
+    if (f == NULL)
+        return NULL;
+    if ((fseek(f, 0, SEEK_END) == 0) && ((n = ftell(f)) >= (long)sizeof(short)) && (fseek(f, 0, SEEK_SET) == 0)) {
+        *nsamples = (int)(n/sizeof(short));
+        s = (short*)malloc(*nsamples*sizeof(short));
+        if (s && (fread(s, sizeof(short), *nsamples, f) != (size_t)*nsamples)) {
+            free(s);
+            s = NULL;
+        }
+    }
+    fclose(f);
+    return s;
+}
+
+static void report(const char *name, double ns, int frames, double frame_ms) {
+    double ns_frame = ns/frames;
+    printf("  %-28s %10.0f ns/frame %10.0f frames/s %8.1f x realtime\n",
+           name, ns_frame, 1e9/ns_frame, frame_ms*1e6/ns_frame);
+}
+
+static void bench_mode(int m, const short *speech, int nsamples, int repeats, result_t *res) {
+    struct CODEC2 *c2;
+    int nsam, nbyte, nframes, f, r;
+    unsigned char *bits;
+    short *out;
+    double t0, enc_best = 1e30, dec_best = 1e30;
+
+    c2 = codec2_create(modes[m]);
+    nsam = codec2_samples_per_frame(c2);
+    nbyte = (codec2_bits_per_frame(c2) + 7)/8;
+    codec2_destroy(c2);
+    nframes = nsamples/nsam;
+
+    bits = (unsigned char*)malloc(nframes*nbyte);
+    out = (short*)malloc(nframes*nsam*sizeof(short));
+
+    for (r = 0; r < repeats; r++) {
+        c2 = codec2_create(modes[m]);
+        t0 = now_ns();
+        for (f = 0; f < nframes; f++)
+            codec2_encode(c2, &bits[f*nbyte], (short*)&speech[f*nsam]);
+        t0 = now_ns() - t0;
+        if (t0 < enc_best) enc_best = t0;
+        codec2_destroy(c2);
+
+        c2 = codec2_create(modes[m]);
+        t0 = now_ns();
+        for (f = 0; f < nframes; f++)
+            codec2_decode(c2, &out[f*nsam], &bits[f*nbyte]);
+        t0 = now_ns() - t0;
+        if (t0 < dec_best) dec_best = t0;
+        codec2_destroy(c2);
+    }
+
+    printf("mode %s (%d frames of %d ms)\n", mode_names[m], nframes, nsam/8);
+    report("encode", enc_best, nframes, nsam/8.0);
+    report("decode", dec_best, nframes, nsam/8.0);
+
+    res->nframes = nframes;
+    res->bits_hash = fnv1a(FNV1A_INIT, bits, (size_t)nframes*nbyte);
+    res->speech_hash = fnv1a(FNV1A_INIT, (const unsigned char*)out, (size_t)nframes*nsam*sizeof(short));
+    res->enc_ns = enc_best/nframes;
+    res->dec_ns = dec_best/nframes;
+
+#ifdef PROFILE
+    // library built with CODEC2_PROFILE, show where the time went
+    machdep_profile_print_logged_samples();
+    machdep_profile_reset();
+#endif
+
+    free(bits);
+    free(out);
+}
+
+// The encoder's speed options for -q, value 0 is the full search.
+// An option with a mode is only swept for that mode, the others are
+// left at the full search and show "n/a".
+typedef struct {
+    const char *name;
+    void      (*set)(struct CODEC2 *c2, int value);
+    int         nvalues;
+    int         mode;                  // -1 for every mode
+} option_t;
+
+static const option_t options[] = {
+    { "vq",    codec2_set_vq_search,    2, CODEC2_MODE_700B },
+    { "pitch", codec2_set_pitch_refine, 3, -1 },
+};
+#define NUM_OPTIONS ((int)(sizeof(options)/sizeof(options[0])))
+
+#define QFFT 256                       // spectral measures frame, hop N
+
+// Objective distance of out[] from ref[], both decoded speech, from
+// the magnitude spectra of each 10ms frame: the segmental SNR of the
+// magnitudes, each frame clamped to -10..60 dB as usual, and the RMS
+// log spectral distortion in dB.  Phases are left out, the decoder
+// synthesises them.
+static void spectral_distance(const short *ref, const short *out, int nsamples,
+                              double *seg_snr, double *sd) {
+    kiss_fftr_cfg cfg = kiss_fftr_alloc(QFFT, 0, NULL, NULL);
+    float x[QFFT], win[QFFT];
+    COMP R[QFFT/2+1], T[QFFT/2+1];
+    double snr_sum = 0.0, sd_sum = 0.0;
+    int nframes = 0, i, k, f;
+
+    for (i = 0; i < QFFT; i++)
+        win[i] = 0.5 - 0.5*cos(TWO_PI*i/QFFT);
+
+    for (f = 0; f + QFFT <= nsamples; f += N, nframes++) {
+        double sig = 0.0, err = 0.0, d2 = 0.0, snr;
+
+        for (i = 0; i < QFFT; i++)
+            x[i] = ref[f+i]*win[i];
+        kiss_fftr(cfg, x, (kiss_fft_cpx*)R);
+        for (i = 0; i < QFFT; i++)
+            x[i] = out[f+i]*win[i];
+        kiss_fftr(cfg, x, (kiss_fft_cpx*)T);
+
+        for (k = 1; k < QFFT/2; k++) {
+            double r = sqrt(R[k].real*R[k].real + R[k].imag*R[k].imag);
+            double t = sqrt(T[k].real*T[k].real + T[k].imag*T[k].imag);
+            double l = 20.0*log10((r + 1.0)/(t + 1.0));
+            sig += r*r;
+            err += (r - t)*(r - t);
+            d2 += l*l;
+        }
+        snr = (err > 0.0) ? 10.0*log10((sig + 1e-3)/err) : 60.0;
+        if (snr > 60.0) snr = 60.0;
+        if (snr < -10.0) snr = -10.0;
+        snr_sum += snr;
+        sd_sum += sqrt(d2/(QFFT/2 - 1));
+    }
+
+    *seg_snr = nframes ? snr_sum/nframes : 60.0;
+    *sd = nframes ? sd_sum/nframes : 0.0;
+    KISS_FFT_FREE(cfg);
+}
+
+// Encode time of each combination of options for mode m, and the
+// quality of its decoded speech relative to the full search
+static void bench_tradeoff(int m, const short *speech, int nsamples, int repeats) {
+    struct CODEC2 *c2;
+    int nsam, nbyte, nframes, ncombos, combo, value[NUM_OPTIONS], nvalues[NUM_OPTIONS], f, r, o, i, ndiff;
+    unsigned char *bits, *ref_bits;
+    short *out, *ref_out;
+    double t0, best, ref_ns = 0.0, seg_snr, sd;
+    char label[64];
+
+    c2 = codec2_create(modes[m]);
+    nsam = codec2_samples_per_frame(c2);
+    nbyte = (codec2_bits_per_frame(c2) + 7)/8;
+    codec2_destroy(c2);
+    nframes = nsamples/nsam;
+
+    bits = (unsigned char*)malloc(nframes*nbyte);
+    ref_bits = (unsigned char*)malloc(nframes*nbyte);
+    out = (short*)malloc(nframes*nsam*sizeof(short));
+    ref_out = (short*)malloc(nframes*nsam*sizeof(short));
+
+    printf("mode %s (%d frames of %d ms), against the full search\n", mode_names[m], nframes, nsam/8);
+
+    for (ncombos = 1, o = 0; o < NUM_OPTIONS; o++) {
+        nvalues[o] = (options[o].mode < 0 || options[o].mode == modes[m]) ? options[o].nvalues : 1;
+        ncombos *= nvalues[o];
+    }
+    for (combo = 0; combo < ncombos; combo++) {
+        for (i = combo, o = 0, label[0] = 0; o < NUM_OPTIONS; o++) {
+            value[o] = i % nvalues[o];
+            i /= nvalues[o];
+            if (nvalues[o] > 1 || options[o].mode < 0)
+                snprintf(label + strlen(label), sizeof(label) - strlen(label), "%s %d ", options[o].name, value[o]);
+            else
+                snprintf(label + strlen(label), sizeof(label) - strlen(label), "%s n/a ", options[o].name);
+        }
+
+        best = 1e30;
+        for (r = 0; r < repeats; r++) {
+            c2 = codec2_create(modes[m]);
+            for (o = 0; o < NUM_OPTIONS; o++)
+                options[o].set(c2, value[o]);
+            t0 = now_ns();
+            for (f = 0; f < nframes; f++)
+                codec2_encode(c2, &bits[f*nbyte], (short*)&speech[f*nsam]);
+            t0 = now_ns() - t0;
+            if (t0 < best) best = t0;
+            codec2_destroy(c2);
+        }
+        c2 = codec2_create(modes[m]);
+        for (f = 0; f < nframes; f++)
+            codec2_decode(c2, &out[f*nsam], &bits[f*nbyte]);
+        codec2_destroy(c2);
+
+        // combination 0 is the full search, the reference for the rest
+        if (combo == 0) {
+            ref_ns = best;
+            memcpy(ref_bits, bits, nframes*nbyte);
+            memcpy(ref_out, out, nframes*nsam*sizeof(short));
+        }
+        for (f = 0, ndiff = 0; f < nframes; f++)
+            ndiff += memcmp(&bits[f*nbyte], &ref_bits[f*nbyte], nbyte) != 0;
+        spectral_distance(ref_out, out, nframes*nsam, &seg_snr, &sd);
+
+        printf("  %-16s encode %8.0f ns/frame %+4.0f%%  frames differ %5.1f%%  segSNR %5.1f dB  SD %5.2f dB\n",
+               label, best/nframes, 100.0*(best - ref_ns)/ref_ns, 100.0*ndiff/nframes, seg_snr, sd);
+    }
+
+    free(bits);
+    free(ref_bits);
+    free(out);
+    free(ref_out);
+}
+
+// Per-stage benchmark over 10ms (N sample) analysis frames
+static void bench_stages(const short *speech, int nsamples, int repeats) {
+    kiss_fft_cfg   fft_fwd_cfg = kiss_fft_alloc(FFT_ENC, 0, NULL, NULL);
+    kiss_fftr_cfg  fftr_fwd_cfg = kiss_fftr_alloc(FFT_ENC, 0, NULL, NULL);
+    kiss_fftr_cfg  fftr_inv_cfg = kiss_fftr_alloc(FFT_DEC, 1, NULL, NULL);
+    void          *nlp_states = nlp_create(M);
+    float          w[M], Pn[2*N], prev_Wo = 0.0, pitch, snr;
+    COMP           W[FFT_ENC], Sw_[FFT_ENC], Ew[FFT_ENC], Aw[FFT_ENC];
+    VOICING_TAB    voicing_tab;
+    float          Sn_[2*N], lsps[LPC_ORD];
+    float          Wn[M], Wr[M+LPC_AC_LAGS], R[LPC_ORD+1];
+    int            voicing_dirty[2] = {0, FFT_ENC};
+    SYNTH_WS       synth_ws;
+    AKS_TO_M2_WS   aks_ws;
+    int            nframes = nsamples/N - M/N;
+    float         (*Sn)[M];
+    COMP          (*Sw)[FFT_ENC];
+    SW_POWER       *pw, pw1;
+    MODEL          *nlp_model, *model, m1;
+    float         (*ak)[LPC_ORD+1], *e;
+    double         t0, best;
+    int            f, r, i;
+
+    Sn = malloc(nframes*sizeof(*Sn));
+    Sw = malloc(nframes*sizeof(*Sw));
+    pw = malloc(nframes*sizeof(SW_POWER));
+    ak = malloc(nframes*sizeof(*ak));
+    e = malloc(nframes*sizeof(float));
+    nlp_model = malloc(nframes*sizeof(MODEL));
+    model = malloc(nframes*sizeof(MODEL));
+
+    quantise_init();
+    make_analysis_window(fft_fwd_cfg, w, W);
+    make_voicing_table(&voicing_tab, W);
+    make_synthesis_window(Pn);
+    synth_ws_init(&synth_ws);
+    aks_to_M2_ws_init(&aks_ws);
+    for (i = 0; i < 2*N; i++)
+        Sn_[i] = 0.0;
+
+    // capture the input of every stage
+    for (f = 0; f < nframes; f++) {
+        for (i = 0; i < M; i++)
+            Sn[f][i] = speech[f*N + i];
+        dft_speech(fftr_fwd_cfg, Sw[f], Sn[f], w);
+        nlp(nlp_states, Sn[f], N, P_MIN, P_MAX, &pitch, Sw[f], W, &prev_Wo);
+        model[f].Wo = TWO_PI/pitch;
+        model[f].L = PI/model[f].Wo;
+        nlp_model[f] = model[f];
+        sw_power(&pw[f], Sw[f]);
+        two_stage_pitch_refinement(&model[f], &pw[f]);
+        estimate_amplitudes(&model[f], Sw[f], &pw[f], 0);
+        est_voicing_mbe(&model[f], Sw[f], W, &voicing_tab, &pw[f], NULL, NULL, NULL);
+        prev_Wo = model[f].Wo;
+        e[f] = speech_to_uq_lsps(lsps, ak[f], Sn[f], w, Wr, NULL, LPC_ORD);
+    }
+
+    printf("stages (%d analysis frames of %d ms)\n", nframes, N/8);
+
+#define BENCH_STAGE(name, body)                         \
+    best = 1e30;                                        \
+    for (r = 0; r < repeats; r++) {                     \
+        t0 = now_ns();                                  \
+        for (f = 0; f < nframes; f++) { body; }         \
+        t0 = now_ns() - t0;                             \
+        if (t0 < best) best = t0;                       \
+    }                                                   \
+    report(name, best, nframes, N/8.0);
+
+    BENCH_STAGE("dft_speech", dft_speech(fftr_fwd_cfg, Sw_, Sn[f], w));
+    prev_Wo = 0.0;
+    BENCH_STAGE("nlp", nlp(nlp_states, Sn[f], N, P_MIN, P_MAX, &pitch, Sw[f], W, &prev_Wo));
+    BENCH_STAGE("window + autocorrelate",
+                for (i = 0; i < M; i++) Wn[i] = Sn[f][i]*w[i];
+                autocorrelate(Wn, R, M, LPC_ORD));
+    BENCH_STAGE("window_autocorrelate", window_autocorrelate(Sn[f], w, Wr, R, M, LPC_ORD));
+    BENCH_STAGE("speech_to_uq_lsps", speech_to_uq_lsps(lsps, ak[f], Sn[f], w, Wr, NULL, LPC_ORD));
+    BENCH_STAGE("sw_power", sw_power(&pw1, Sw[f]));
+    BENCH_STAGE("two_stage_pitch_refinement",
+                m1 = nlp_model[f]; two_stage_pitch_refinement(&m1, &pw[f]));
+    BENCH_STAGE("fast_pitch_refinement",
+                m1 = nlp_model[f]; fast_pitch_refinement(&m1, &pw[f]));
+    BENCH_STAGE("coarse_pitch_refinement",
+                m1 = nlp_model[f]; coarse_pitch_refinement(&m1, &pw[f]));
+    BENCH_STAGE("estimate_amplitudes",
+                m1 = model[f]; estimate_amplitudes(&m1, Sw[f], &pw[f], 0));
+    BENCH_STAGE("est_voicing_mbe",
+                m1 = model[f]; est_voicing_mbe(&m1, Sw[f], W, &voicing_tab, NULL, NULL, NULL, NULL));
+    BENCH_STAGE("est_voicing_mbe (power)",
+                m1 = model[f]; est_voicing_mbe(&m1, Sw[f], W, &voicing_tab, &pw[f], NULL, NULL, NULL));
+    BENCH_STAGE("est_voicing_mbe (Sw_, Ew)",
+                m1 = model[f]; est_voicing_mbe(&m1, Sw[f], W, NULL, NULL, Sw_, Ew, voicing_dirty));
+    BENCH_STAGE("aks_to_M2",
+                m1 = model[f];
+                aks_to_M2(fftr_fwd_cfg, ak[f], LPC_ORD, &m1, e[f], &snr, 0, 0,
+                          1, 1, LPCPF_BETA, LPCPF_GAMMA, Aw, &aks_ws));
+    BENCH_STAGE("synthesise",
+                m1 = model[f]; synthesise(fftr_inv_cfg, Sn_, &m1, Pn, 1, &synth_ws));
+
+#undef BENCH_STAGE
+
+    free(Sn); free(Sw); free(pw); free(ak); free(e); free(nlp_model); free(model);
+    nlp_destroy(nlp_states);
+    KISS_FFT_FREE(fft_fwd_cfg);
+    KISS_FFT_FREE(fftr_fwd_cfg);
+    KISS_FFT_FREE(fftr_inv_cfg);
+}
+
+// Modes to run, all those built into the library unless -m picks one
+static int mode_wanted(int m, int only) {
+    return ((only == -1) || (only == m)) && codec2_mode_enabled(modes[m]);
+}
+
+static int write_baseline(const char *file, int seconds, const result_t res[], int only) {
+    FILE *f = fopen(file, "w");
+    int m;
+
+    if (f == NULL)
+        return -1;
+    fprintf(f, "codec2_bench %d\n", seconds);
+    for (m = 0; m < NUM_MODES; m++)
+        if (mode_wanted(m, only))
+            fprintf(f, "%s %d %016llx %016llx %.0f %.0f\n", mode_names[m], res[m].nframes,
+                    res[m].bits_hash, res[m].speech_hash, res[m].enc_ns, res[m].dec_ns);
+    return fclose(f);
+}
+
+// Returns the number of modes that fail, or -1 if the baseline can't
+// be read
+static int check_baseline(const char *file, int seconds, const result_t res[], int only, int tolerance) {
+    FILE *f = fopen(file, "r");
+    char name[16];
+    result_t b;
+    int m, n, fails = 0, checked = 0;
+
+    if (f == NULL)
+        return -1;
+    if ((fscanf(f, "codec2_bench %d", &n) != 1) || (n != seconds)) {
+        fprintf(stderr, "Error: %s is not a baseline of a %d s corpus\n", file, seconds);
+        fclose(f);
+        return -1;
+    }
+
+    printf("\nbaseline %s, %d%% tolerance\n", file, tolerance);
+    while (fscanf(f, "%15s %d %llx %llx %lf %lf", name, &b.nframes, &b.bits_hash, &b.speech_hash,
+                  &b.enc_ns, &b.dec_ns) == 6) {
+        for (m = 0; m < NUM_MODES; m++)
+            if (strcmp(name, mode_names[m]) == 0)
+                break;
+        if ((m == NUM_MODES) || !mode_wanted(m, only))
+            continue;
+        checked++;
+
+        const char *bits = (b.bits_hash == res[m].bits_hash) ? "ok" : "DIFFERENT";
+        const char *speech = (b.speech_hash == res[m].speech_hash) ? "ok" : "DIFFERENT";
+        int enc_pct = (int)(100.0*(res[m].enc_ns - b.enc_ns)/b.enc_ns);
+        int dec_pct = (int)(100.0*(res[m].dec_ns - b.dec_ns)/b.dec_ns);
+        int ok = (b.nframes == res[m].nframes) && (b.bits_hash == res[m].bits_hash) &&
+                 (b.speech_hash == res[m].speech_hash) && (enc_pct <= tolerance) && (dec_pct <= tolerance);
+
+        printf("  %-5s bits %-9s speech %-9s encode %+4d%% decode %+4d%%  %s\n", name, bits, speech,
+               enc_pct, dec_pct, ok ? "PASS" : "FAIL");
+        if (!ok)
+            fails++;
+    }
+    fclose(f);
+    if (checked == 0) {
+        fprintf(stderr, "Error: no modes to check in %s\n", file);
+        return -1;
+    }
+    return fails;
+}
+
+int main(int argc, char* argv[]) {
+    int opt, m, only = -1, seconds = DEFAULT_SECONDS, repeats = DEFAULT_REPEATS;
+    int stages = 1, tradeoff = 0, nsamples, tolerance = DEFAULT_TOLERANCE, fails = 0;
+    const char *write_file = NULL, *check_file = NULL, *corpus_file = NULL;
+    result_t res[NUM_MODES];
+    short *speech;
+    struct CODEC2 *c2;
+
+    while ((opt = getopt(argc, argv, "m:t:i:r:sqw:c:p:h")) != -1) {
+        switch (opt) {
+            case 'm':
+                for (m = 0; m < NUM_MODES; m++)
+                    if (strcmp(optarg, mode_names[m]) == 0)
+                        only = m;
+                if (only == -1) {
+                    fprintf(stderr, "Error: Invalid mode '%s'\n", optarg);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 't':
+                seconds = atoi(optarg);
+                break;
+            case 'i':
+                corpus_file = optarg;
+                break;
+            case 'r':
+                repeats = atoi(optarg);
+                break;
+            case 's':
+                stages = 0;
+                break;
+            case 'q':
+                tradeoff = 1;
+                break;
+            case 'w':
+                write_file = optarg;
+                break;
+            case 'c':
+                check_file = optarg;
+                break;
+            case 'p':
+                tolerance = atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((seconds < 1) || (repeats < 1)) {
+        fprintf(stderr, "Error: -t and -r must be positive\n");
+        return 1;
+    }
+
+    if (corpus_file) {
+        speech = read_corpus(corpus_file, &nsamples);
+        if (speech == NULL) {
+            fprintf(stderr, "Error: Cannot read corpus '%s'\n", corpus_file);
+            return 1;
+        }
+        seconds = nsamples/8000;
+        if (seconds < 1) {
+            fprintf(stderr, "Error: Corpus '%s' is shorter than a second\n", corpus_file);
+            free(speech);
+            return 1;
+        }
+    } else {
+        nsamples = seconds*8000;
+        speech = make_corpus(nsamples);
+        if (speech == NULL) {
+            fprintf(stderr, "Error: Out of memory\n");
+            return 1;
+        }
+    }
+
+#ifdef PROFILE
+    machdep_profile_init();
+#endif
+
+    printf("codec2_bench: %d s of %s, best of %d\n", seconds, corpus_file ? corpus_file : "synthetic speech",
+           repeats);
+
+    /* the kernel variants are picked by the first codec2_create() */
+
+    for (m = 0; m < NUM_MODES; m++) {
+        c2 = codec2_create(modes[m]);
+        if (c2 != NULL) {
+            codec2_destroy(c2);
+            break;
+        }
+    }
+    printf("kernels: fft %s, vq %s, nlp %s, synth %s, bpf %s, lpc %s, soft %s\n\n",
+           codec2_kernel_variant(CODEC2_KERNEL_FFT), codec2_kernel_variant(CODEC2_KERNEL_VQ),
+           codec2_kernel_variant(CODEC2_KERNEL_NLP), codec2_kernel_variant(CODEC2_KERNEL_SYNTH),
+           codec2_kernel_variant(CODEC2_KERNEL_BPF), codec2_kernel_variant(CODEC2_KERNEL_LPC),
+           codec2_kernel_variant(CODEC2_KERNEL_SOFT));
+    for (m = 0; m < NUM_MODES; m++)
+        if (mode_wanted(m, only))
+            bench_mode(m, speech, nsamples, repeats, &res[m]);
+
+    if (tradeoff) {
+        printf("\nquality against CPU, value 0 of each option is the full search\n");
+        for (m = 0; m < NUM_MODES; m++)
+            if (mode_wanted(m, only))
+                bench_tradeoff(m, speech, nsamples, repeats);
+    }
+
+    if (stages) {
+        printf("\n");
+        bench_stages(speech, nsamples, repeats);
+    }
+    free(speech);
+
+    if (write_file && (write_baseline(write_file, seconds, res, only) != 0)) {
+        fprintf(stderr, "Error: Cannot write baseline '%s'\n", write_file);
+        return 1;
+    }
+    if (check_file) {
+        fails = check_baseline(check_file, seconds, res, only, tolerance);
+        if (fails < 0) {
+            fprintf(stderr, "Error: Cannot read baseline '%s'\n", check_file);
+            return 1;
+        }
+        printf("%d mode%s failed\n", fails, fails == 1 ? "" : "s");
+    }
+
+    return fails ? 1 : 0;
+}
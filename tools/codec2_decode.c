@@ -8,15 +8,17 @@
 #include <unistd.h>
 #include <codec2.h>
 #include "wav_util.h"
+#include "io_util.h"
 
 void print_usage(const char* prog_name) {
     printf("Usage: %s [options] input.c2 output.wav\n", prog_name);
     printf("\nOptions:\n");
+    printf("  -r rate    Output sample rate in Hz, a multiple of 8000 up to 48000\n");
     printf("  -h         Show this help\n");
     printf("\nInput format:\n");
     printf("  - Binary codec2 frames with header\n");
     printf("\nOutput format:\n");
-    printf("  - 8000 Hz, mono, 16-bit PCM WAV file\n");
+    printf("  - 8000 Hz (or -r rate), mono, 16-bit PCM WAV file\n");
 }
 
 const char* mode_to_string(int mode) {
@@ -37,10 +39,14 @@ int main(int argc, char* argv[]) {
     int opt;
     char* input_file = NULL;
     char* output_file = NULL;
+    int rate = 8000;
     
     // Parse command line arguments
-    while ((opt = getopt(argc, argv, "h")) != -1) {
+    while ((opt = getopt(argc, argv, "hr:")) != -1) {
         switch (opt) {
+            case 'r':
+                rate = atoi(optarg);
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -94,7 +100,7 @@ int main(int argc, char* argv[]) {
     printf("Mode:        %s bps\n", mode_to_string(mode));
     
     // Create codec2 instance
-    struct CODEC2* codec2 = codec2_create(mode);
+    struct CODEC2* codec2 = codec2_create_decoder(mode);
     if (!codec2) {
         fprintf(stderr, "Error: Cannot create codec2 instance for mode %d\n", mode);
         fclose(input);
@@ -115,6 +121,15 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Synthesise straight to the output rate
+    if (codec2_set_output_rate(codec2, rate) != 0) {
+        fprintf(stderr, "Error: Output rate %d Hz not supported\n", rate);
+        codec2_destroy(codec2);
+        fclose(input);
+        return 1;
+    }
+    int output_samples_per_frame = codec2_output_samples_per_frame(codec2);
+    
     printf("Codec2 parameters:\n");
     printf("  Samples per frame: %d\n", samples_per_frame);
     printf("  Bits per frame: %d\n", bits_per_frame);
@@ -133,7 +148,7 @@ int main(int argc, char* argv[]) {
     printf("Input file contains %d frames (%.2f seconds)\n", total_frames, total_time);
     
     // Open output WAV file
-    wav_file_t* wav_out = wav_open_write(output_file, 8000, 1, 16);
+    wav_file_t* wav_out = wav_open_write(output_file, rate, 1, 16);
     if (!wav_out) {
         fprintf(stderr, "Error: Cannot create output file '%s'\n", output_file);
         codec2_destroy(codec2);
@@ -143,7 +158,7 @@ int main(int argc, char* argv[]) {
     
     // Allocate buffers
     unsigned char* codec2_bits = malloc(bytes_per_frame);
-    short* speech_samples = malloc(samples_per_frame * sizeof(short));
+    short* speech_samples = malloc(output_samples_per_frame * sizeof(short));
     
     if (!codec2_bits || !speech_samples) {
         fprintf(stderr, "Error: Memory allocation failed\n");
@@ -153,17 +168,21 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Frames are read ahead in the background while earlier ones decode
+    io_reader_t* reader = io_reader_open(fileno(input), current_pos);
+    
     // Decode loop
     int frames_decoded = 0;
     
     printf("\nDecoding...\n");
     
-    while (fread(codec2_bits, 1, bytes_per_frame, input) == bytes_per_frame) {
+    while ((reader ? io_reader_read(reader, codec2_bits, bytes_per_frame)
+                   : fread(codec2_bits, 1, bytes_per_frame, input)) == (size_t)bytes_per_frame) {
         // Decode frame
         codec2_decode(codec2, speech_samples, codec2_bits);
         
         // Write decoded samples
-        wav_write_samples(wav_out, speech_samples, samples_per_frame);
+        wav_write_samples(wav_out, speech_samples, output_samples_per_frame);
         
         frames_decoded++;
         if (frames_decoded % 100 == 0) {
@@ -172,6 +191,12 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (reader) {
+        if (io_reader_error(reader))
+            fprintf(stderr, "Warning: Error reading input file, output is truncated\n");
+        io_reader_close(reader);
+    }
+    
     printf("Decoding complete!\n");
     printf("Total frames decoded: %d\n", frames_decoded);
     printf("Total time: %.2f seconds\n", (float)(frames_decoded * samples_per_frame) / 8000.0);
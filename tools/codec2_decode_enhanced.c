@@ -7,20 +7,44 @@
 #include <string.h>
 #include <unistd.h>
 #include <codec2.h>
+#include <codec2_file.h>
 #include "wav_util_enhanced.h"
+#include "stream_util.h"
 
 void print_usage(const char* prog_name) {
     printf("Usage: %s [options] input.c2 output.wav\n", prog_name);
+    printf("       %s -S [-m MODE] [-b N] [-v] < input.c2 > output.raw\n", prog_name);
     printf("\nOptions:\n");
+    printf("  -s SEC     Start decoding SEC seconds in\n");
+    printf("  -t SEC     Decode SEC seconds (default: to the end)\n");
+    printf("  -S         Stream bare codec2 frames from stdin to raw 8 kHz 16-bit\n");
+    printf("             little endian samples on stdout, without headers\n");
+    printf("  -m MODE    Mode of the frames with -S (default: 3200)\n");
+    printf("  -b N       Frames per write to stdout with -S (default: %d)\n", STREAM_CHUNK);
     printf("  -v         Verbose output\n");
     printf("  -h         Show this help\n");
     printf("\nInput format:\n");
-    printf("  - Binary codec2 frames with header\n");
+    printf("  - Binary codec2 frames with header, or the indexed container\n");
+    printf("    (codec2_encode_enhanced -x), which seeks to -s directly\n");
     printf("\nOutput format:\n");
     printf("  - 8000 Hz, mono, 16-bit PCM WAV file\n");
     printf("\nExamples:\n");
     printf("  %s compressed.c2 speech.wav\n", prog_name);
     printf("  %s -v ultra_compressed.c2 decoded.wav\n", prog_name);
+    printf("  %s -s 3600 -t 30 recording.c2 clip.wav\n", prog_name);
+    printf("  nc -l 5000 | %s -S -m 1300 | aplay -f S16_LE -r 8000\n", prog_name);
+}
+
+int mode_from_string(const char* mode_str) {
+    if (strcmp(mode_str, "3200") == 0) return CODEC2_MODE_3200;
+    if (strcmp(mode_str, "2400") == 0) return CODEC2_MODE_2400;
+    if (strcmp(mode_str, "1600") == 0) return CODEC2_MODE_1600;
+    if (strcmp(mode_str, "1400") == 0) return CODEC2_MODE_1400;
+    if (strcmp(mode_str, "1300") == 0) return CODEC2_MODE_1300;
+    if (strcmp(mode_str, "1200") == 0) return CODEC2_MODE_1200;
+    if (strcmp(mode_str, "700") == 0) return CODEC2_MODE_700;
+    if (strcmp(mode_str, "700B") == 0) return CODEC2_MODE_700B;
+    return -1;
 }
 
 const char* mode_to_string(int mode) {
@@ -40,12 +64,49 @@ const char* mode_to_string(int mode) {
 int main(int argc, char* argv[]) {
     int opt;
     int verbose = 0;
+    double start_time = 0.0;
+    double duration = -1.0;
+    int stream = 0;
+    int stream_mode = CODEC2_MODE_3200;
+    int chunk = STREAM_CHUNK;
     char* input_file = NULL;
     char* output_file = NULL;
     
     // Parse command line arguments
-    while ((opt = getopt(argc, argv, "vh")) != -1) {
+    while ((opt = getopt(argc, argv, "s:t:Sm:b:vh")) != -1) {
         switch (opt) {
+            case 's':
+                start_time = atof(optarg);
+                if (start_time < 0.0) {
+                    fprintf(stderr, "Error: Invalid start time '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+                duration = atof(optarg);
+                if (duration < 0.0) {
+                    fprintf(stderr, "Error: Invalid duration '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'S':
+                stream = 1;
+                break;
+            case 'm':
+                stream_mode = mode_from_string(optarg);
+                if (stream_mode == -1) {
+                    fprintf(stderr, "Error: Invalid mode '%s'\n", optarg);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'b':
+                chunk = atoi(optarg);
+                if (chunk < 1) {
+                    fprintf(stderr, "Error: Invalid chunk size '%s'\n", optarg);
+                    return 1;
+                }
+                break;
             case 'v':
                 verbose = 1;
                 break;
@@ -58,6 +119,19 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Streams keep stdout for the samples, so nothing else is printed
+    if (stream) {
+        if (optind != argc) {
+            fprintf(stderr, "Error: -S reads stdin and writes stdout, no files are given\n");
+            return 1;
+        }
+        if (stream_decode(stream_mode, chunk, verbose) != 0) {
+            fprintf(stderr, "Error: Streaming decode failed\n");
+            return 1;
+        }
+        return 0;
+    }
+    
     // Get input and output filenames
     if (optind + 2 != argc) {
         fprintf(stderr, "Error: Input and output files required\n");
@@ -75,109 +149,72 @@ int main(int argc, char* argv[]) {
     if (verbose) printf("Verbose mode enabled\n");
     printf("\n");
     
-    // Open input file
-    FILE* input = fopen(input_file, "rb");
+    // Open input file, either the plain header and frames or the
+    // indexed container
+    struct CODEC2_FILE* input = codec2_file_open_read(input_file);
     if (!input) {
-        fprintf(stderr, "Error: Cannot open input file '%s'\n", input_file);
-        return 1;
-    }
-    
-    // Read and validate header
-    uint32_t header[4];
-    if (fread(header, sizeof(uint32_t), 4, input) != 4) {
-        fprintf(stderr, "Error: Cannot read header from input file\n");
-        fclose(input);
-        return 1;
-    }
-    
-    if (header[0] != 0x43324332) { // "C2C2" magic
-        fprintf(stderr, "Error: Invalid codec2 file format (magic = 0x%08X)\n", header[0]);
-        fclose(input);
+        fprintf(stderr, "Error: Cannot open input file '%s' or invalid codec2 file format\n", input_file);
         return 1;
     }
     
-    int mode = header[1];
-    int expected_samples_per_frame = header[2];
-    int expected_bits_per_frame = header[3];
+    int mode = codec2_file_mode(input);
+    int samples_per_frame = codec2_file_samples_per_frame(input);
+    int bytes_per_frame = codec2_file_bytes_per_frame(input);
     
     printf("Codec2 file format detected\n");
     printf("Mode: %s bps\n", mode_to_string(mode));
-    if (verbose) {
-        printf("Expected samples per frame: %d\n", expected_samples_per_frame);
-        printf("Expected bits per frame: %d\n", expected_bits_per_frame);
-    }
-    
-    // Create codec2 instance
-    struct CODEC2* codec2 = codec2_create(mode);
-    if (!codec2) {
-        fprintf(stderr, "Error: Cannot create codec2 instance for mode %d\n", mode);
-        fclose(input);
-        return 1;
-    }
-    
-    int samples_per_frame = codec2_samples_per_frame(codec2);
-    int bits_per_frame = codec2_bits_per_frame(codec2);
-    int bytes_per_frame = (bits_per_frame + 7) / 8;
-    
-    // Validate parameters
-    if (samples_per_frame != expected_samples_per_frame || bits_per_frame != expected_bits_per_frame) {
-        fprintf(stderr, "Error: Codec2 parameters don't match file header\n");
-        fprintf(stderr, "Expected: %d samples, %d bits per frame\n", expected_samples_per_frame, expected_bits_per_frame);
-        fprintf(stderr, "Got:      %d samples, %d bits per frame\n", samples_per_frame, bits_per_frame);
-        codec2_destroy(codec2);
-        fclose(input);
-        return 1;
-    }
-    
     if (verbose) {
         printf("Codec2 parameters validated:\n");
         printf("  Samples per frame: %d\n", samples_per_frame);
-        printf("  Bits per frame: %d\n", bits_per_frame);
         printf("  Bytes per frame: %d\n", bytes_per_frame);
     }
     
-    // Count frames in file
-    long current_pos = ftell(input);
-    fseek(input, 0, SEEK_END);
-    long file_size = ftell(input);
-    fseek(input, current_pos, SEEK_SET);
-    
-    int total_frames = (file_size - current_pos) / bytes_per_frame;
+    int total_frames = (int)codec2_file_frames(input);
     int total_samples = total_frames * samples_per_frame;
     float total_time = (float)total_samples / 8000.0;
     
     printf("Input file analysis:\n");
-    printf("  File size: %ld bytes\n", file_size);
-    printf("  Data size: %ld bytes\n", file_size - current_pos);
     printf("  Total frames: %d\n", total_frames);
     printf("  Total samples: %d\n", total_samples);
     printf("  Duration: %.2f seconds\n", total_time);
     
     if (total_frames == 0) {
         fprintf(stderr, "Error: No valid frames found in input file\n");
-        codec2_destroy(codec2);
-        fclose(input);
+        codec2_file_close(input);
+        return 1;
+    }
+    
+    // Clip to decode, in whole frames
+    int first_frame = (int)(start_time * 8000.0 / samples_per_frame);
+    int last_frame = total_frames;
+    if (duration >= 0.0 && first_frame + (int)((duration * 8000.0 + samples_per_frame - 1) / samples_per_frame) < last_frame)
+        last_frame = first_frame + (int)((duration * 8000.0 + samples_per_frame - 1) / samples_per_frame);
+    if (first_frame >= total_frames || codec2_file_seek(input, first_frame) != 0) {
+        fprintf(stderr, "Error: Start time %.2f s is past the end of the file\n", start_time);
+        codec2_file_close(input);
         return 1;
     }
+    total_frames = last_frame - first_frame;
+    if (first_frame > 0 || duration >= 0.0) {
+        printf("  Clip: frames %d-%d (%.2f-%.2f seconds)\n", first_frame, last_frame - 1,
+               (float)first_frame * samples_per_frame / 8000.0, (float)last_frame * samples_per_frame / 8000.0);
+    }
     
     // Open output WAV file using enhanced utilities
     wav_enhanced_t* wav_out = wav_enhanced_open_write(output_file);
     if (!wav_out) {
         fprintf(stderr, "Error: Cannot create output file '%s'\n", output_file);
-        codec2_destroy(codec2);
-        fclose(input);
+        codec2_file_close(input);
         return 1;
     }
     
     // Allocate buffers
-    unsigned char* codec2_bits = malloc(bytes_per_frame);
     short* speech_samples = malloc(samples_per_frame * sizeof(short));
     
-    if (!codec2_bits || !speech_samples) {
+    if (!speech_samples) {
         fprintf(stderr, "Error: Memory allocation failed\n");
-        codec2_destroy(codec2);
         wav_enhanced_close(wav_out);
-        fclose(input);
+        codec2_file_close(input);
         return 1;
     }
     
@@ -189,10 +226,8 @@ int main(int argc, char* argv[]) {
     if (!verbose) printf("...");
     printf("\n");
     
-    while (fread(codec2_bits, 1, bytes_per_frame, input) == bytes_per_frame) {
-        // Decode frame
-        codec2_decode(codec2, speech_samples, codec2_bits);
-        
+    // Decode frame, the reader has brought its decoder up to first_frame
+    while (frames_decoded < total_frames && codec2_file_decode(input, speech_samples, 1) == 1) {        
         // Write decoded samples
         int written = wav_enhanced_write_samples(wav_out, speech_samples, samples_per_frame);
         if (written != samples_per_frame) {
@@ -225,11 +260,9 @@ int main(int argc, char* argv[]) {
     printf("Output: 8000 Hz, mono, 16-bit PCM WAV\n");
     
     // Cleanup
-    free(codec2_bits);
     free(speech_samples);
-    codec2_destroy(codec2);
     wav_enhanced_close(wav_out);
-    fclose(input);
+    codec2_file_close(input);
     
     return 0;
 }
@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <codec2.h>
 #include "wav_util.h"
+#include "io_util.h"
 
 void print_usage(const char* prog_name) {
     printf("Usage: %s [options] input.wav output.c2\n", prog_name);
@@ -155,6 +156,10 @@ int main(int argc, char* argv[]) {
     header[2] = samples_per_frame; // Samples per frame
     header[3] = bits_per_frame;    // Bits per frame
     fwrite(header, sizeof(uint32_t), 4, output);
+    fflush(output);
+    
+    // Frames are written in the background while the next are encoded
+    io_writer_t* writer = io_writer_open(fileno(output), sizeof(header));
     
     // Allocate buffers
     short* speech_samples = malloc(samples_per_frame * sizeof(short));
@@ -164,6 +169,8 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "Error: Memory allocation failed\n");
         codec2_destroy(codec2);
         wav_close(wav_in);
+        if (writer)
+            io_writer_close(writer);
         fclose(output);
         return 1;
     }
@@ -184,7 +191,10 @@ int main(int argc, char* argv[]) {
         codec2_encode(codec2, codec2_bits, speech_samples);
         
         // Write encoded frame
-        fwrite(codec2_bits, 1, bytes_per_frame, output);
+        if (writer)
+            io_writer_write(writer, codec2_bits, bytes_per_frame);
+        else
+            fwrite(codec2_bits, 1, bytes_per_frame, output);
         
         frames_encoded++;
         if (frames_encoded % 100 == 0) {
@@ -193,6 +203,16 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    int write_error = writer ? io_writer_close(writer) : 0;
+    if (fclose(output) != 0 || write_error) {
+        fprintf(stderr, "Error: Cannot write output file '%s'\n", output_file);
+        free(speech_samples);
+        free(codec2_bits);
+        codec2_destroy(codec2);
+        wav_close(wav_in);
+        return 1;
+    }
+    
     printf("Encoding complete!\n");
     printf("Total frames encoded: %d\n", frames_encoded);
     printf("Total time: %.2f seconds\n", (float)(frames_encoded * samples_per_frame) / 8000.0);
@@ -204,7 +224,6 @@ int main(int argc, char* argv[]) {
     free(codec2_bits);
     codec2_destroy(codec2);
     wav_close(wav_in);
-    fclose(output);
     
     return 0;
 }
@@ -6,14 +6,29 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #include <codec2.h>
+#include <codec2_file.h>
 #include "wav_util_enhanced.h"
+#include "io_util.h"
+#include "stream_util.h"
 
 void print_usage(const char* prog_name) {
     printf("Usage: %s [options] input.wav output.c2\n", prog_name);
+    printf("       %s -S [-m MODE] [-b N] [-v] < input.raw > output.c2\n", prog_name);
     printf("\nOptions:\n");
     printf("  -m MODE    Codec2 mode (3200, 2400, 1600, 1400, 1300, 1200, 700, 700B)\n");
     printf("             Default: 3200\n");
+    printf("  -j N       Encode N segments of the file in parallel\n");
+    printf("  -p         Pipeline the encoder, analysing each frame on a second\n");
+    printf("             thread while the one before is quantised\n");
+    printf("  -x         Write the indexed, seekable container\n");
+    printf("  -k N       Frames between reset points in the index (implies -x)\n");
+    printf("             Default: %d\n", CODEC2_FILE_RESET_INTERVAL);
+    printf("  -S         Stream raw 8 kHz 16-bit little endian samples from stdin\n");
+    printf("             to bare codec2 frames on stdout, without headers\n");
+    printf("  -b N       Frames per write to stdout with -S (default: %d)\n", STREAM_CHUNK);
     printf("  -v         Verbose output\n");
     printf("  -h         Show this help\n");
     printf("\nSupported input formats:\n");
@@ -22,10 +37,13 @@ void print_usage(const char* prog_name) {
     printf("  - 8, 16, 24, or 32-bit PCM WAV files\n");
     printf("  - Standard WAV file chunk ordering\n");
     printf("\nOutput format:\n");
-    printf("  - Binary codec2 frames with header\n");
+    printf("  - Binary codec2 frames with header, or with -x the indexed\n");
+    printf("    container that codec2_decode_enhanced can decode clips from\n");
     printf("\nExamples:\n");
     printf("  %s speech.wav compressed.c2\n", prog_name);
     printf("  %s -m 1200 -v music.wav ultra_compressed.c2\n", prog_name);
+    printf("  %s -x -m 1300 recording.wav recording.c2\n", prog_name);
+    printf("  sox in.wav -t raw -r 8000 -c 1 -e signed -b 16 - | %s -S -m 1300 | nc host 5000\n", prog_name);
 }
 
 int mode_from_string(const char* mode_str) {
@@ -54,15 +72,295 @@ const char* mode_to_string(int mode) {
     }
 }
 
+// One segment of a parallel encode, see codec2_encode_segment()
+typedef struct {
+    int            mode;
+    const short*   speech;      // warm-up frames then the segment
+    const short*   tail;        // zero padded last frame, or NULL
+    unsigned char* bits;
+    int            nwarmup;
+    int            nframes;
+    int            threaded;    // non-zero if run on its own thread
+    int            ok;
+} segment_t;
+
+// codec2_encode() and friends only read speech_in[], so the samples can
+// come straight from the read only mapping of the input file
+static void* encode_segment_thread(void* arg) {
+    segment_t* seg = (segment_t*)arg;
+    struct CODEC2* c2 = codec2_create(seg->mode);
+
+    if (c2) {
+        codec2_encode_segment(c2, seg->bits, (short*)seg->speech, seg->nwarmup, seg->nframes);
+        if (seg->tail)
+            codec2_encode(c2, seg->bits + seg->nframes * ((codec2_bits_per_frame(c2) + 7) / 8),
+                          (short*)seg->tail);
+        codec2_destroy(c2);
+        seg->ok = 1;
+    }
+    return NULL;
+}
+
+// Writes n bytes of plain frames, through writer when there is one.
+// Returns 1 on success, 0 on failure.
+static int write_bits(FILE* output, io_writer_t* writer, const unsigned char* bits, size_t n) {
+    if (writer)
+        return io_writer_write(writer, bits, n) == 0;
+    return fwrite(bits, 1, n, output) == n;
+}
+
+// Splits the whole file at frame boundaries into nthreads segments,
+// encodes them concurrently and writes the stitched stream, to c2f if
+// not NULL.  None of the segment encoders is in step with the index by
+// then, so its reset points are written without state.  Plain
+// 8 kHz mono 16-bit files are encoded straight from the mapped file,
+// others are converted into memory first.  Returns the number of frames
+// written, or -1.
+static int encode_parallel(wav_enhanced_t* wav_in, FILE* output, io_writer_t* writer, struct CODEC2_FILE* c2f,
+                           int mode, int nthreads, int samples_per_frame, int bytes_per_frame, int verbose,
+                           int* total_samples_processed) {
+    struct CODEC2* c2 = codec2_create(mode);
+    int warmup, nsamples, size = 8000 * 60, n, nfull, nframes, i, start, ret = -1;
+    const short* speech = NULL;
+    short* converted = NULL;
+    short* tail = malloc(samples_per_frame * sizeof(short));
+    unsigned char* bits = NULL;
+    segment_t* segs = calloc(nthreads, sizeof(segment_t));
+    pthread_t* threads = calloc(nthreads, sizeof(pthread_t));
+
+    if (!c2 || !tail || !segs || !threads)
+        goto done;
+    warmup = codec2_encode_warmup_frames(c2);
+
+    nsamples = wav_enhanced_map_samples_16bit_mono_8khz(wav_in, &speech, UINT32_MAX);
+    if (nsamples < 0) {
+        nsamples = 0;
+        converted = malloc(size * sizeof(short));
+        if (!converted)
+            goto done;
+        while ((n = wav_enhanced_read_samples_16bit_mono_8khz(wav_in, converted + nsamples, size - nsamples)) > 0) {
+            nsamples += n;
+            if (nsamples == size) {
+                short* p = realloc(converted, 2 * size * sizeof(short));
+                if (!p)
+                    goto done;
+                converted = p;
+                size *= 2;
+            }
+        }
+        speech = converted;
+    }
+    *total_samples_processed = nsamples;
+
+    nfull = nsamples / samples_per_frame;
+    nframes = (nsamples + samples_per_frame - 1) / samples_per_frame;
+    memset(tail, 0, samples_per_frame * sizeof(short));
+    memcpy(tail, &speech[nfull * samples_per_frame], (nsamples - nfull * samples_per_frame) * sizeof(short));
+    bits = malloc(nframes * bytes_per_frame + 1);
+    if (!bits)
+        goto done;
+
+    // Segments much shorter than the warm-up would mostly redo work
+    if (nthreads > nfull / (4 * warmup) + 1)
+        nthreads = nfull / (4 * warmup) + 1;
+
+    for (i = 0, start = 0; i < nthreads; i++) {
+        int len = nfull / nthreads + (i < nfull % nthreads);
+        segs[i].mode = mode;
+        segs[i].nwarmup = start < warmup ? start : warmup;
+        segs[i].speech = &speech[(start - segs[i].nwarmup) * samples_per_frame];
+        segs[i].bits = &bits[start * bytes_per_frame];
+        segs[i].nframes = len;
+        if (verbose)
+            printf("  Segment %d: frames %d-%d, %d warm-up frames\n", i, start, start + len - 1,
+                   segs[i].nwarmup);
+        start += len;
+    }
+    if (nframes > nfull)
+        segs[nthreads - 1].tail = tail;
+
+    for (i = 0; i < nthreads; i++) {
+        segs[i].threaded = pthread_create(&threads[i], NULL, encode_segment_thread, &segs[i]) == 0;
+        if (!segs[i].threaded)
+            encode_segment_thread(&segs[i]);
+    }
+    for (i = 0; i < nthreads; i++)
+        if (segs[i].threaded)
+            pthread_join(threads[i], NULL);
+    for (i = 0; i < nthreads; i++)
+        if (!segs[i].ok)
+            goto done;
+
+    if (c2f ? codec2_file_write(c2f, bits, nframes, NULL) == nframes :
+              write_bits(output, writer, bits, (size_t)nframes * bytes_per_frame))
+        ret = nframes;
+
+done:
+    if (c2)
+        codec2_destroy(c2);
+    free(converted);
+    free(tail);
+    free(bits);
+    free(segs);
+    free(threads);
+    return ret;
+}
+
+// Reads the next frame, zero padded if the file ends part way through
+// it.  Plain 8 kHz mono 16-bit input comes straight from the mapped
+// file, anything else is converted into speech_samples.  *frame is set
+// to the samples, the return is the number read, 0 at the end.
+static int read_frame(wav_enhanced_t* wav_in, short* speech_samples, int samples_per_frame,
+                      const short** frame, int verbose) {
+    int samples_read;
+
+    *frame = speech_samples;
+    samples_read = wav_enhanced_map_samples_16bit_mono_8khz(wav_in, frame, samples_per_frame);
+    if (samples_read < 0) {
+        *frame = speech_samples;
+        samples_read = wav_enhanced_read_samples_16bit_mono_8khz(wav_in, speech_samples, samples_per_frame);
+    }
+    if (samples_read <= 0)
+        return 0;
+
+    // Pad with zeros if incomplete frame
+    if (samples_read < samples_per_frame) {
+        if (*frame != speech_samples)
+            memcpy(speech_samples, *frame, samples_read * sizeof(short));
+        *frame = speech_samples;
+        memset(&speech_samples[samples_read], 0, (samples_per_frame - samples_read) * sizeof(short));
+        if (verbose) {
+            printf("  Final frame padded: %d samples -> %d samples\n", samples_read, samples_per_frame);
+        }
+    }
+    return samples_read;
+}
+
+// Frames between the two stages of a pipelined encode, see
+// encode_pipelined()
+#define PIPE_SLOTS 8
+
+typedef struct {
+    struct CODEC2_ANALYSIS* analysis;
+    int                     samples;   // read into the frame, 0 after the last one
+} pipe_slot_t;
+
+typedef struct {
+    struct CODEC2*  c2;
+    wav_enhanced_t* wav_in;
+    short*          speech;
+    int             samples_per_frame;
+    int             verbose;
+    pipe_slot_t     slot[PIPE_SLOTS];
+    unsigned int    head;              // frames analysed, only the analysis thread writes it
+    unsigned int    tail;              // frames quantised, only the main thread writes it
+} pipeline_t;
+
+static void* analyse_thread(void* arg) {
+    pipeline_t* p = (pipeline_t*)arg;
+    pipe_slot_t* slot;
+    const short* frame;
+    unsigned int head = 0;
+
+    do {
+        while (head - __atomic_load_n(&p->tail, __ATOMIC_ACQUIRE) == PIPE_SLOTS)
+            sched_yield();
+        slot = &p->slot[head % PIPE_SLOTS];
+        slot->samples = read_frame(p->wav_in, p->speech, p->samples_per_frame, &frame, p->verbose);
+        if (slot->samples > 0)
+            codec2_encode_analyse(p->c2, slot->analysis, (short*)frame);
+        __atomic_store_n(&p->head, ++head, __ATOMIC_RELEASE);
+    } while (slot->samples > 0);
+    return NULL;
+}
+
+// Encodes the file in two stages, see codec2_encode_analyse().  A
+// second thread reads and analyses each frame while the main thread
+// quantises and writes the one before, the frames passing through a
+// ring of PIPE_SLOTS analyses.  Each side only writes its own end of
+// the ring and publishes it with a release store, so the handoff needs
+// no locks.  The analysis runs ahead of the quantiser, so reset points
+// in c2f are written without state.  The bits are those of a plain
+// encode.  Returns the number of frames written, or -1.
+static int encode_pipelined(struct CODEC2* c2, wav_enhanced_t* wav_in, FILE* output, io_writer_t* writer,
+                            struct CODEC2_FILE* c2f, int samples_per_frame, int bytes_per_frame, int verbose,
+                            int* total_samples_processed) {
+    pipeline_t p;
+    pipe_slot_t* slot;
+    pthread_t thread;
+    unsigned char* bits = malloc(bytes_per_frame);
+    unsigned int tail = 0;
+    int frames = 0, ok = 1, i;
+
+    memset(&p, 0, sizeof(p));
+    p.c2 = c2;
+    p.wav_in = wav_in;
+    p.speech = malloc(samples_per_frame * sizeof(short));
+    p.samples_per_frame = samples_per_frame;
+    p.verbose = verbose;
+    for (i = 0; i < PIPE_SLOTS; i++) {
+        p.slot[i].analysis = malloc(codec2_analysis_size());
+        if (!p.slot[i].analysis)
+            ok = 0;
+    }
+    if (!ok || !bits || !p.speech || pthread_create(&thread, NULL, analyse_thread, &p) != 0) {
+        frames = -1;
+        goto done;
+    }
+
+    for (;;) {
+        while (__atomic_load_n(&p.head, __ATOMIC_ACQUIRE) == tail)
+            sched_yield();
+        slot = &p.slot[tail % PIPE_SLOTS];
+        if (slot->samples <= 0)
+            break;
+        codec2_encode_quantise(c2, bits, slot->analysis);
+        *total_samples_processed += slot->samples;
+        __atomic_store_n(&p.tail, ++tail, __ATOMIC_RELEASE);
+
+        if (c2f ? codec2_file_write(c2f, bits, 1, NULL) != 1 :
+                  !write_bits(output, writer, bits, bytes_per_frame))
+            ok = 0;
+        frames++;
+    }
+    pthread_join(thread, NULL);
+    if (!ok)
+        frames = -1;
+
+done:
+    for (i = 0; i < PIPE_SLOTS; i++)
+        free(p.slot[i].analysis);
+    free(p.speech);
+    free(bits);
+    return frames;
+}
+
+// Returns 0 if everything reached the file
+static int close_output(FILE* output, io_writer_t* writer, struct CODEC2_FILE* c2f) {
+    int err = 0;
+
+    if (c2f)
+        return codec2_file_close(c2f);
+    if (writer)
+        err = io_writer_close(writer);
+    return (fclose(output) != 0 || err) ? -1 : 0;
+}
+
 int main(int argc, char* argv[]) {
     int opt;
     int mode = CODEC2_MODE_3200;
     int verbose = 0;
+    int nthreads = 1;
+    int pipelined = 0;
+    int indexed = 0;
+    int reset_interval = CODEC2_FILE_RESET_INTERVAL;
+    int stream = 0;
+    int chunk = STREAM_CHUNK;
     char* input_file = NULL;
     char* output_file = NULL;
     
     // Parse command line arguments
-    while ((opt = getopt(argc, argv, "m:vh")) != -1) {
+    while ((opt = getopt(argc, argv, "m:j:pxk:Sb:vh")) != -1) {
         switch (opt) {
             case 'm':
                 mode = mode_from_string(optarg);
@@ -72,6 +370,37 @@ int main(int argc, char* argv[]) {
                     return 1;
                 }
                 break;
+            case 'j':
+                nthreads = atoi(optarg);
+                if (nthreads < 1) {
+                    fprintf(stderr, "Error: Invalid thread count '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                pipelined = 1;
+                break;
+            case 'x':
+                indexed = 1;
+                break;
+            case 'k':
+                reset_interval = atoi(optarg);
+                if (reset_interval < 1) {
+                    fprintf(stderr, "Error: Invalid reset interval '%s'\n", optarg);
+                    return 1;
+                }
+                indexed = 1;
+                break;
+            case 'S':
+                stream = 1;
+                break;
+            case 'b':
+                chunk = atoi(optarg);
+                if (chunk < 1) {
+                    fprintf(stderr, "Error: Invalid chunk size '%s'\n", optarg);
+                    return 1;
+                }
+                break;
             case 'v':
                 verbose = 1;
                 break;
@@ -84,6 +413,19 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Streams keep stdout for the frames, so nothing else is printed
+    if (stream) {
+        if (optind != argc) {
+            fprintf(stderr, "Error: -S reads stdin and writes stdout, no files are given\n");
+            return 1;
+        }
+        if (stream_encode(mode, chunk, verbose) != 0) {
+            fprintf(stderr, "Error: Streaming encode failed\n");
+            return 1;
+        }
+        return 0;
+    }
+    
     // Get input and output filenames
     if (optind + 2 != argc) {
         fprintf(stderr, "Error: Input and output files required\n");
@@ -151,22 +493,38 @@ int main(int argc, char* argv[]) {
     int estimated_frames = (total_samples_8khz + samples_per_frame - 1) / samples_per_frame;
     printf("  Estimated frames: %d\n", estimated_frames);
     
-    // Open output file
-    FILE* output = fopen(output_file, "wb");
-    if (!output) {
+    // Open output file, the indexed container or the plain header and frames
+    FILE* output = NULL;
+    struct CODEC2_FILE* c2f = NULL;
+    io_writer_t* writer = NULL;
+    if (indexed)
+        c2f = codec2_file_open_write(output_file, mode, reset_interval);
+    else
+        output = fopen(output_file, "wb");
+    if (!output && !c2f) {
         fprintf(stderr, "Error: Cannot create output file '%s'\n", output_file);
         codec2_destroy(codec2);
         wav_enhanced_close(wav_in);
         return 1;
     }
     
-    // Write header to output file
-    uint32_t header[4];
-    header[0] = 0x43324332; // "C2C2" magic
-    header[1] = mode;        // Mode
-    header[2] = samples_per_frame; // Samples per frame
-    header[3] = bits_per_frame;    // Bits per frame
-    fwrite(header, sizeof(uint32_t), 4, output);
+    if (output) {
+        // Write header to output file
+        uint32_t header[4];
+        header[0] = 0x43324332; // "C2C2" magic
+        header[1] = mode;        // Mode
+        header[2] = samples_per_frame; // Samples per frame
+        header[3] = bits_per_frame;    // Bits per frame
+        fwrite(header, sizeof(uint32_t), 4, output);
+        
+        // Frames are written in the background while the next are encoded
+        if (fflush(output) == 0)
+            writer = io_writer_open(fileno(output), sizeof(header));
+        if (verbose)
+            printf("  Output I/O: %s\n", writer ? io_backend_name() : "stdio");
+    } else if (verbose) {
+        printf("  Indexed container, reset point every %d frames\n", reset_interval);
+    }
     
     // Allocate buffers
     short* speech_samples = malloc(samples_per_frame * sizeof(short));
@@ -176,7 +534,7 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "Error: Memory allocation failed\n");
         codec2_destroy(codec2);
         wav_enhanced_close(wav_in);
-        fclose(output);
+        close_output(output, writer, c2f);
         return 1;
     }
     
@@ -189,20 +547,47 @@ int main(int argc, char* argv[]) {
     if (!verbose) printf("...");
     printf("\n");
     
-    while ((samples_read = wav_enhanced_read_samples_16bit_mono_8khz(wav_in, speech_samples, samples_per_frame)) > 0) {
-        // Pad with zeros if incomplete frame
-        if (samples_read < samples_per_frame) {
-            memset(&speech_samples[samples_read], 0, (samples_per_frame - samples_read) * sizeof(short));
-            if (verbose) {
-                printf("  Final frame padded: %d samples -> %d samples\n", samples_read, samples_per_frame);
-            }
+    if (nthreads > 1) {
+        frames_encoded = encode_parallel(wav_in, output, writer, c2f, mode, nthreads, samples_per_frame,
+                                         bytes_per_frame, verbose, &total_samples_processed);
+        if (frames_encoded < 0) {
+            fprintf(stderr, "Error: Parallel encode failed\n");
+            free(speech_samples);
+            free(codec2_bits);
+            codec2_destroy(codec2);
+            wav_enhanced_close(wav_in);
+            close_output(output, writer, c2f);
+            return 1;
+        }
+    } else if (pipelined) {
+        frames_encoded = encode_pipelined(codec2, wav_in, output, writer, c2f, samples_per_frame,
+                                          bytes_per_frame, verbose, &total_samples_processed);
+        if (frames_encoded < 0) {
+            fprintf(stderr, "Error: Pipelined encode failed\n");
+            free(speech_samples);
+            free(codec2_bits);
+            codec2_destroy(codec2);
+            wav_enhanced_close(wav_in);
+            close_output(output, writer, c2f);
+            return 1;
         }
+    }
+    
+    while (nthreads == 1 && !pipelined) {
+        const short* frame;
+        samples_read = read_frame(wav_in, speech_samples, samples_per_frame, &frame, verbose);
+        if (samples_read <= 0)
+            break;
         
-        // Encode frame
-        codec2_encode(codec2, codec2_bits, speech_samples);
+        // Encode frame, codec2_encode() only reads the samples
+        codec2_encode(codec2, codec2_bits, (short*)frame);
         
-        // Write encoded frame
-        fwrite(codec2_bits, 1, bytes_per_frame, output);
+        // Write encoded frame, the container takes the encoder's state
+        // for any reset point that follows it
+        if (c2f)
+            codec2_file_write(c2f, codec2_bits, 1, codec2);
+        else
+            write_bits(output, writer, codec2_bits, bytes_per_frame);
         
         frames_encoded++;
         total_samples_processed += samples_read;
@@ -233,7 +618,10 @@ int main(int argc, char* argv[]) {
     free(codec2_bits);
     codec2_destroy(codec2);
     wav_enhanced_close(wav_in);
-    fclose(output);
+    if (close_output(output, writer, c2f) != 0) {
+        fprintf(stderr, "Error: Failed writing output file '%s'\n", output_file);
+        return 1;
+    }
     
     return 0;
 }
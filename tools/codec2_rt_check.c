@@ -0,0 +1,352 @@
+/*
+ * codec2_rt_check - worst case frame times and deadline misses
+ *
+ * For real time use the slowest frame matters more than the average.
+ * This drives every mode (or one, with -m) with inputs chosen to push
+ * the data dependent paths: silence, full scale noise, a pitch sweep
+ * and low pitched, many harmonic voicing.  Each encode and decode call
+ * is timed with the library's stats (codec2_enable_stats()), and the
+ * max, p99.9 and p99 frame times are reported for each mode and input.
+ *
+ * A frame's budget is its duration, or -b percent of it, or -u micro
+ * seconds.  Frames over budget are counted by codec2_set_deadline()
+ * and the worst of each run is listed with the stage that grew most
+ * over its median, e.g. nlp (the sub-multiple search of
+ * post_process_sub_multiples()) or quantise (the LSP root search of
+ * lpc_to_lsp()).  Exits 1 if any frame missed its budget.  With -z
+ * the instances flush denormals to zero.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <codec2.h>
+
+#define DEFAULT_SECONDS 10
+#define DEFAULT_BUDGET  100
+#define DEFAULT_LIST    3
+#define WARMUP_FRAMES   25
+#define TWO_PI          6.283185307
+
+static const int modes[] = {
+    CODEC2_MODE_3200, CODEC2_MODE_2400, CODEC2_MODE_1600, CODEC2_MODE_1400,
+    CODEC2_MODE_1300, CODEC2_MODE_1200, CODEC2_MODE_700, CODEC2_MODE_700B
+};
+static const char *mode_names[] = {
+    "3200", "2400", "1600", "1400", "1300", "1200", "700", "700B"
+};
+#define NUM_MODES ((int)(sizeof(modes)/sizeof(modes[0])))
+
+enum { INPUT_SILENCE, INPUT_NOISE, INPUT_SWEEP, INPUT_LOWPITCH, NUM_INPUTS };
+static const char *input_names[] = { "silence", "noise", "sweep", "lowpitch" };
+
+// Stages timed by the stats, per frame, and the code each one holds
+// that runs for a data dependent time
+enum { ST_ANALYSIS, ST_NLP, ST_QUANTISE, ST_DEQUANTISE, ST_SYNTHESIS, ST_POSTFILTER, NUM_STAGES };
+static const char *stage_names[] = {
+    "analysis", "nlp (post_process_sub_multiples)", "quantise (lpc_to_lsp)",
+    "dequantise", "synthesis", "postfilter"
+};
+
+typedef struct {
+    unsigned long total;
+    unsigned long stage[NUM_STAGES];
+} frame_time_t;
+
+void print_usage(const char* prog_name) {
+    printf("Usage: %s [options]\n", prog_name);
+    printf("\nOptions:\n");
+    printf("  -m MODE    Only check MODE (3200, 2400, 1600, 1400, 1300, 1200, 700, 700B)\n");
+    printf("  -t SECS    Seconds of each input (default %d)\n", DEFAULT_SECONDS);
+    printf("  -b PCT     Budget as a percentage of the frame's duration (default %d)\n", DEFAULT_BUDGET);
+    printf("  -u US      Budget in micro seconds per frame, instead of -b\n");
+    printf("  -l N       Frames over budget listed per run (default %d)\n", DEFAULT_LIST);
+    printf("  -z         Flush denormals to zero, see codec2_set_flush_denormals()\n");
+    printf("  -h         Show this help\n");
+}
+
+static unsigned long lcg(unsigned long *seed) {
+    *seed = *seed*1103515245 + 12345;
+    return (*seed >> 16) & 0x7fff;
+}
+
+// Harmonics of f0 up to 3800 Hz, equal amplitudes summing to at most
+// peak, so the number of harmonics L is as high as the pitch allows
+static double harmonics(double phase, double f0, double peak) {
+    int l, nl = (int)(3800.0/f0);
+    double x = 0.0;
+
+    for (l = 1; l <= nl; l++)
+        x += cos(l*phase);
+    return x*peak/nl;
+}
+
+static short *make_input(int type, int nsamples) {
+    short *s = (short*)malloc(nsamples*sizeof(short));
+    unsigned long seed = 1;
+    double phase = 0.0, f0;
+    int i;
+
+    if (s == NULL)
+        return NULL;
+
+    for (i = 0; i < nsamples; i++) {
+        switch (type) {
+            case INPUT_SILENCE:
+                s[i] = 0;
+                break;
+            case INPUT_NOISE:
+                s[i] = (short)((long)lcg(&seed)*2 - 32767);
+                break;
+            case INPUT_SWEEP:
+                // 50 to 500 Hz and back, log spaced, every 4 s
+                f0 = 50.0*pow(10.0, 1.0 - fabs(1.0 - 2.0*fmod(i/32000.0, 1.0)));
+                phase = fmod(phase + TWO_PI*f0/8000.0, TWO_PI);
+                s[i] = (short)harmonics(phase, f0, 30000.0);
+                break;
+            default:
+                // 50 to 60 Hz with jitter, around 75 harmonics
+                f0 = 55.0 + 5.0*sin(TWO_PI*i/12000.0) + 0.5*((double)lcg(&seed)/32768.0 - 0.5);
+                phase = fmod(phase + TWO_PI*f0/8000.0, TWO_PI);
+                s[i] = (short)harmonics(phase, f0, 20000.0);
+                break;
+        }
+    }
+
+    return s;
+}
+
+static void stage_cycles(const struct CODEC2_STATS *s, unsigned long long c[NUM_STAGES]) {
+    c[ST_ANALYSIS] = s->analysis_cycles;
+    c[ST_NLP] = s->nlp_cycles;
+    c[ST_QUANTISE] = s->quantise_cycles;
+    c[ST_DEQUANTISE] = s->dequantise_cycles;
+    c[ST_SYNTHESIS] = s->synthesis_cycles;
+    c[ST_POSTFILTER] = s->postfilter_cycles;
+}
+
+// The latest call's total and stage times from the stats
+static void frame_time(struct CODEC2 *c2, unsigned long long prev[NUM_STAGES], frame_time_t *t) {
+    struct CODEC2_STATS stats;
+    unsigned long long c[NUM_STAGES];
+    int k;
+
+    codec2_get_stats(c2, &stats);
+    stage_cycles(&stats, c);
+    t->total = stats.last_frame_cycles;
+    for (k = 0; k < NUM_STAGES; k++) {
+        t->stage[k] = (unsigned long)(c[k] - prev[k]);
+        prev[k] = c[k];
+    }
+}
+
+static int cmp_ulong(const void *a, const void *b) {
+    unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts v[] and returns its p-th percentile
+static unsigned long percentile(unsigned long v[], int n, double p) {
+    qsort(v, n, sizeof(v[0]), cmp_ulong);
+    return v[(int)(p*(n - 1)/100.0 + 0.5)];
+}
+
+// Prints the run's line, then up to nlist of the frames over budget,
+// slowest first, each with the stage furthest over its median.
+// Returns the number of frames over budget.
+static int report(const char *mode, const char *input, const char *dir, const frame_time_t *t,
+                  int nframes, unsigned long budget, unsigned long misses, float per_us, int nlist) {
+    unsigned long *v = (unsigned long*)malloc(nframes*sizeof(unsigned long));
+    unsigned long median[NUM_STAGES];
+    int i, j, k, worst, listed;
+    char *done;
+
+    done = (char*)calloc(nframes, 1);
+    if ((v == NULL) || (done == NULL)) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+
+    for (k = 0; k < NUM_STAGES; k++) {
+        for (i = 0; i < nframes; i++)
+            v[i] = t[i].stage[k];
+        median[k] = percentile(v, nframes, 50.0);
+    }
+    for (i = 0; i < nframes; i++)
+        v[i] = t[i].total;
+    printf("%-5s %-9s %-6s %8.1f %8.1f %8.1f %8.1f %7lu\n", mode, input, dir,
+           percentile(v, nframes, 100.0)/per_us, percentile(v, nframes, 99.9)/per_us,
+           percentile(v, nframes, 99.0)/per_us, percentile(v, nframes, 50.0)/per_us, misses);
+
+    for (listed = 0; listed < nlist; listed++) {
+        worst = -1;
+        for (i = 0; i < nframes; i++)
+            if (!done[i] && (t[i].total > budget) && ((worst < 0) || (t[i].total > t[worst].total)))
+                worst = i;
+        if (worst < 0)
+            break;
+        done[worst] = 1;
+        j = 0;
+        for (k = 1; k < NUM_STAGES; k++)
+            if ((long)t[worst].stage[k] - (long)median[k] > (long)t[worst].stage[j] - (long)median[j])
+                j = k;
+        printf("      frame %6d %8.1f us, %s %.1f us (median %.1f)\n", worst, t[worst].total/per_us,
+               stage_names[j], t[worst].stage[j]/per_us, median[j]/per_us);
+    }
+
+    free(v);
+    free(done);
+    return (int)misses;
+}
+
+// Encodes then decodes one input, returns the frames over budget
+static int check(int m, int in, const short *speech, int nsamples, int budget_pct, float budget_us, int nlist,
+                 int ftz) {
+    struct CODEC2 *enc = codec2_create(modes[m]);
+    struct CODEC2 *dec = codec2_create_decoder(modes[m]);
+    struct CODEC2_STATS stats;
+    unsigned long long prev[NUM_STAGES];
+    unsigned long budget;
+    unsigned char *bits;
+    short *out;
+    frame_time_t *t;
+    int nsam, nbyte, nframes, f, misses;
+    float per_us;
+
+    if ((enc == NULL) || (dec == NULL)) {
+        fprintf(stderr, "Error: Cannot create mode %s\n", mode_names[m]);
+        exit(1);
+    }
+    codec2_set_flush_denormals(enc, ftz);
+    codec2_set_flush_denormals(dec, ftz);
+    nsam = codec2_samples_per_frame(enc);
+    nbyte = (codec2_bits_per_frame(enc) + 7)/8;
+    nframes = nsamples/nsam;
+    bits = (unsigned char*)malloc((size_t)nframes*nbyte);
+    out = (short*)malloc(nsam*sizeof(short));
+    t = (frame_time_t*)malloc(nframes*sizeof(frame_time_t));
+    if ((bits == NULL) || (out == NULL) || (t == NULL)) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+
+    // warm up the caches and the first use of each table, then time
+    for (f = 0; f < WARMUP_FRAMES && f < nframes; f++) {
+        codec2_encode(enc, bits, (short*)&speech[f*nsam]);
+        codec2_decode(dec, out, bits);
+    }
+
+    codec2_enable_stats(enc, 1);
+    codec2_enable_stats(dec, 1);
+    codec2_get_stats(enc, &stats);
+    per_us = stats.cycles_per_us;
+    if (budget_us > 0.0)
+        budget = (unsigned long)(budget_us*per_us);
+    else
+        budget = (unsigned long)((double)nsam/8000.0*1e6*per_us*budget_pct/100.0);
+    codec2_set_deadline(enc, budget);
+    codec2_set_deadline(dec, budget);
+
+    misses = 0;
+    memset(prev, 0, sizeof(prev));
+    for (f = 0; f < nframes; f++) {
+        codec2_encode(enc, &bits[f*nbyte], (short*)&speech[f*nsam]);
+        frame_time(enc, prev, &t[f]);
+    }
+    codec2_get_stats(enc, &stats);
+    misses += report(mode_names[m], input_names[in], "encode", t, nframes, budget,
+                     stats.deadline_misses, per_us, nlist);
+
+    memset(prev, 0, sizeof(prev));
+    for (f = 0; f < nframes; f++) {
+        codec2_decode(dec, out, &bits[f*nbyte]);
+        frame_time(dec, prev, &t[f]);
+    }
+    codec2_get_stats(dec, &stats);
+    misses += report(mode_names[m], input_names[in], "decode", t, nframes, budget,
+                     stats.deadline_misses, per_us, nlist);
+
+    free(bits);
+    free(out);
+    free(t);
+    codec2_destroy(enc);
+    codec2_destroy(dec);
+    return misses;
+}
+
+int main(int argc, char* argv[]) {
+    int opt, m, in, only = -1, seconds = DEFAULT_SECONDS, budget_pct = DEFAULT_BUDGET;
+    int nlist = DEFAULT_LIST, nsamples, misses = 0, ftz = 0;
+    float budget_us = 0.0;
+    short *speech[NUM_INPUTS];
+
+    while ((opt = getopt(argc, argv, "m:t:b:u:l:zh")) != -1) {
+        switch (opt) {
+            case 'm':
+                for (m = 0; m < NUM_MODES; m++)
+                    if (strcmp(optarg, mode_names[m]) == 0)
+                        only = m;
+                if (only == -1) {
+                    fprintf(stderr, "Error: Invalid mode '%s'\n", optarg);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 't':
+                seconds = atoi(optarg);
+                break;
+            case 'b':
+                budget_pct = atoi(optarg);
+                break;
+            case 'u':
+                budget_us = atof(optarg);
+                break;
+            case 'l':
+                nlist = atoi(optarg);
+                break;
+            case 'z':
+                ftz = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((seconds < 1) || (budget_pct < 1) || (budget_us < 0.0) || (nlist < 0)) {
+        fprintf(stderr, "Error: -t, -b, -u and -l must be positive\n");
+        return 1;
+    }
+
+    nsamples = seconds*8000;
+    for (in = 0; in < NUM_INPUTS; in++) {
+        speech[in] = make_input(in, nsamples);
+        if (speech[in] == NULL) {
+            fprintf(stderr, "Error: Out of memory\n");
+            return 1;
+        }
+    }
+
+    if (budget_us > 0.0)
+        printf("Budget: %.1f us per frame\n\n", budget_us);
+    else
+        printf("Budget: %d%% of each frame's duration\n\n", budget_pct);
+    printf("%-5s %-9s %-6s %8s %8s %8s %8s %7s\n", "mode", "input", "", "max us", "p99.9",
+           "p99", "p50", "misses");
+    for (m = 0; m < NUM_MODES; m++) {
+        if ((only >= 0) && (m != only))
+            continue;
+        for (in = 0; in < NUM_INPUTS; in++)
+            misses += check(m, in, speech[in], nsamples, budget_pct, budget_us, nlist, ftz);
+    }
+
+    for (in = 0; in < NUM_INPUTS; in++)
+        free(speech[in]);
+
+    printf("\n%d frame%s over budget\n", misses, misses == 1 ? "" : "s");
+    return misses ? 1 : 0;
+}
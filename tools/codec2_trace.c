@@ -0,0 +1,253 @@
+/*
+ * codec2_trace - converts a DUMP build's binary trace to text or NumPy
+ *
+ * A library built with CODEC2_DUMP writes its internal states to
+ * <prefix>.c2trace (see src/dump.c for the format).  By default this
+ * writes each record type to <out>_<name>.txt, one row per record, as
+ * the original text dumps did, for the Octave scripts.  With -n each
+ * type goes to <out>_<name>.npy instead, a float32 array of one row
+ * per record, and the records' sequence numbers to <out>_<name>_seq.npy.
+ * Rows shorter than the longest of their type are padded with zeros.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dump.h"
+
+typedef struct {
+    long count;                 // records of the type
+    int  maxn;                  // most values in one
+} type_info_t;
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options] trace.c2trace out_prefix\n", prog);
+    printf("Options:\n");
+    printf("  -n         Write NumPy .npy arrays instead of text files\n");
+    printf("  -h         Show this help\n");
+}
+
+static unsigned char *read_file(const char *path, long *size) {
+    FILE *f = fopen(path, "rb");
+    unsigned char *buf = NULL;
+
+    if (f == NULL)
+        return NULL;
+    if ((fseek(f, 0, SEEK_END) == 0) && ((*size = ftell(f)) >= 0) && (fseek(f, 0, SEEK_SET) == 0)) {
+        buf = (unsigned char*)malloc(*size + 1);
+        if ((buf != NULL) && (fread(buf, 1, *size, f) != (size_t)*size)) {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(f);
+    return buf;
+}
+
+// Walks the records, calling fn for each, returns 0 or -1 if truncated
+static int for_each_record(const unsigned char *buf, long size,
+                           void (*fn)(void *state, int type, uint32_t seq, const float *x, int n),
+                           void *state) {
+    long pos = DUMP_HEADER;
+    uint16_t type, n;
+    uint32_t seq;
+    float x[DUMP_MAX];
+
+    while (pos + DUMP_RECORD <= size) {
+        memcpy(&type, &buf[pos], 2);
+        memcpy(&n, &buf[pos + 2], 2);
+        memcpy(&seq, &buf[pos + 4], 4);
+        if ((type >= DUMP_NTYPES) || (n > DUMP_MAX) || (pos + DUMP_RECORD + 4L*n > size))
+            return -1;
+        memcpy(x, &buf[pos + DUMP_RECORD], 4*n);
+        fn(state, type, seq, x, n);
+        pos += DUMP_RECORD + 4L*n;
+    }
+    return pos == size ? 0 : -1;
+}
+
+static void count_record(void *state, int type, uint32_t seq, const float *x, int n) {
+    type_info_t *info = (type_info_t*)state;
+
+    (void)seq;
+    (void)x;
+    info[type].count++;
+    if (n > info[type].maxn)
+        info[type].maxn = n;
+}
+
+// Text output, the layout of the original dump.c files
+
+typedef struct {
+    const char *prefix;
+    FILE *f[DUMP_NTYPES];
+    int err;
+} text_state_t;
+
+static void write_text(void *state, int type, uint32_t seq, const float *x, int n) {
+    text_state_t *t = (text_state_t*)state;
+    char path[1024];
+    int i;
+
+    (void)seq;
+    if (t->f[type] == NULL) {
+        snprintf(path, sizeof(path), "%s_%s.txt", t->prefix, dump_type[type].name);
+        t->f[type] = fopen(path, "wt");
+        if (t->f[type] == NULL) {
+            t->err = 1;
+            return;
+        }
+    }
+    for (i = 0; i < n; i++) {
+        if (dump_type[type].ints)
+            fprintf(t->f[type], "%d\t", (int)x[i]);
+        else
+            fprintf(t->f[type], "%f\t", x[i]);
+        if (dump_type[type].split && (i == n/2 - 1))
+            fprintf(t->f[type], "\n");
+    }
+    fprintf(t->f[type], "\n");
+}
+
+// NumPy output, one array of rows and one of sequence numbers per type
+
+typedef struct {
+    type_info_t *info;
+    float *rows[DUMP_NTYPES];
+    uint32_t *seq[DUMP_NTYPES];
+    long next[DUMP_NTYPES];
+} npy_state_t;
+
+static void gather_record(void *state, int type, uint32_t seq, const float *x, int n) {
+    npy_state_t *s = (npy_state_t*)state;
+    long r = s->next[type]++;
+
+    memcpy(&s->rows[type][r*s->info[type].maxn], x, 4*n);
+    s->seq[type][r] = seq;
+}
+
+static int write_npy(const char *path, const char *descr, long rows, int cols, const void *data, size_t item) {
+    char hdr[128];
+    int len;
+    FILE *f = fopen(path, "wb");
+    int err;
+
+    if (f == NULL)
+        return -1;
+    if (cols)
+        len = snprintf(hdr, sizeof(hdr), "{'descr': '%s', 'fortran_order': False, 'shape': (%ld, %d), }",
+                       descr, rows, cols);
+    else
+        len = snprintf(hdr, sizeof(hdr), "{'descr': '%s', 'fortran_order': False, 'shape': (%ld,), }",
+                       descr, rows);
+
+    // magic, version 1.0, header length, header padded so the data is 64 byte aligned
+    while ((10 + len + 1) % 64)
+        hdr[len++] = ' ';
+    hdr[len++] = '\n';
+    err = fwrite("\x93NUMPY\x01\x00", 1, 8, f) != 8;
+    err |= fputc(len & 0xff, f) == EOF;
+    err |= fputc(len >> 8, f) == EOF;
+    err |= fwrite(hdr, 1, len, f) != (size_t)len;
+    err |= fwrite(data, item, rows*(cols ? cols : 1), f) != (size_t)(rows*(cols ? cols : 1));
+    err |= fclose(f) != 0;
+    return err ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    type_info_t info[DUMP_NTYPES];
+    unsigned char *buf;
+    long size;
+    uint32_t magic, ntypes;
+    uint16_t version;
+    uint16_t one = 1;
+    int numpy = 0;
+    int i, t, err = 0;
+    int little = *(unsigned char*)&one;
+    char path[1024];
+
+    for (i = 1; (i < argc) && (argv[i][0] == '-'); i++) {
+        if (strcmp(argv[i], "-n") == 0)
+            numpy = 1;
+        else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - i != 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    buf = read_file(argv[i], &size);
+    if ((buf == NULL) || (size < DUMP_HEADER)) {
+        fprintf(stderr, "Error: Cannot read trace '%s'\n", argv[i]);
+        return 1;
+    }
+    memcpy(&magic, &buf[0], 4);
+    memcpy(&version, &buf[4], 2);
+    memcpy(&ntypes, &buf[8], 4);
+    if ((magic != DUMP_MAGIC) || (version != DUMP_VERSION) || (ntypes != DUMP_NTYPES)) {
+        fprintf(stderr, "Error: '%s' is not a trace of this build, or was written on a machine of "
+                "the other byte order\n", argv[i]);
+        free(buf);
+        return 1;
+    }
+
+    memset(info, 0, sizeof(info));
+    if (for_each_record(buf, size, count_record, info) != 0)
+        fprintf(stderr, "Warning: '%s' is truncated, converting the whole records\n", argv[i]);
+
+    if (!numpy) {
+        text_state_t text;
+
+        memset(&text, 0, sizeof(text));
+        text.prefix = argv[i + 1];
+        for_each_record(buf, size, write_text, &text);
+        for (t = 0; t < DUMP_NTYPES; t++)
+            if ((text.f[t] != NULL) && (fclose(text.f[t]) != 0))
+                text.err = 1;
+        err = text.err;
+    } else {
+        npy_state_t npy;
+
+        memset(&npy, 0, sizeof(npy));
+        npy.info = info;
+        for (t = 0; t < DUMP_NTYPES; t++) {
+            if (info[t].count == 0)
+                continue;
+            npy.rows[t] = (float*)calloc(info[t].count*info[t].maxn + 1, sizeof(float));
+            npy.seq[t] = (uint32_t*)malloc(info[t].count*sizeof(uint32_t));
+            if ((npy.rows[t] == NULL) || (npy.seq[t] == NULL)) {
+                fprintf(stderr, "Error: Out of memory\n");
+                return 1;
+            }
+        }
+        for_each_record(buf, size, gather_record, &npy);
+        for (t = 0; t < DUMP_NTYPES; t++) {
+            if (info[t].count == 0)
+                continue;
+            snprintf(path, sizeof(path), "%s_%s.npy", argv[i + 1], dump_type[t].name);
+            err |= write_npy(path, little ? "<f4" : ">f4", info[t].count, info[t].maxn, npy.rows[t], sizeof(float));
+            snprintf(path, sizeof(path), "%s_%s_seq.npy", argv[i + 1], dump_type[t].name);
+            err |= write_npy(path, little ? "<u4" : ">u4", info[t].count, 0, npy.seq[t], sizeof(uint32_t));
+            free(npy.rows[t]);
+            free(npy.seq[t]);
+        }
+    }
+    free(buf);
+
+    if (err) {
+        fprintf(stderr, "Error: Cannot write all of the output files\n");
+        return 1;
+    }
+    for (t = 0; t < DUMP_NTYPES; t++)
+        if (info[t].count)
+            printf("%-12s %8ld records\n", dump_type[t].name, info[t].count);
+    return 0;
+}
@@ -0,0 +1,583 @@
+/*
+ * Asynchronous file I/O for the codec2 tools, see io_util.h
+ *
+ * Each reader or writer owns IO_DEPTH aligned blocks, used in turn.
+ * Transfer n goes through block n % IO_DEPTH, so before a block is
+ * reused the transfer before it, IO_DEPTH back, is waited for.  The
+ * backend is an io_uring of IO_DEPTH entries, or a worker thread that
+ * runs the transfers in order.
+ */
+
+#define _GNU_SOURCE
+#include "io_util.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef TOOLS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define IO_ALIGN 4096
+
+typedef struct {
+    unsigned char* buf;
+    size_t         len;         // bytes to transfer
+    int64_t        offset;
+    long           res;         // bytes transferred, or -errno
+    int            done;
+} io_slot_t;
+
+#ifdef TOOLS_IO_URING
+typedef struct {
+    int                  fd;
+    unsigned*            sq_tail;
+    unsigned*            sq_mask;
+    unsigned*            sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned*            cq_head;
+    unsigned*            cq_tail;
+    unsigned*            cq_mask;
+    struct io_uring_cqe* cqes;
+    void*                sq_ring;
+    void*                cq_ring;
+    size_t               sq_size;
+    size_t               cq_size;
+    size_t               sqes_size;
+} uring_t;
+#endif
+
+typedef struct {
+    int             fd;
+    int             writing;
+    io_slot_t       slot[IO_DEPTH];
+    unsigned        submitted;   // transfers started
+#ifdef TOOLS_IO_URING
+    int             uring;       // non-zero if ring is in use
+    uring_t         ring;
+#endif
+    // worker thread backend
+    int             threaded;
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    unsigned        completed;   // transfers finished, in order
+    int             quit;
+} io_engine_t;
+
+struct io_reader {
+    io_engine_t e;
+    int64_t     next;            // file offset of the next block to read
+    unsigned    head;            // transfer being consumed
+    size_t      pos;             // bytes of it consumed
+    size_t      avail;           // bytes it holds, once waited for
+    int         waited;
+    int         eof;
+    int         err;
+};
+
+struct io_writer {
+    io_engine_t e;
+    int64_t     next;            // file offset of the block being filled
+    size_t      fill;            // bytes in it
+    size_t      size;            // its length, short for the first block so the rest are aligned
+    unsigned    waited;          // transfers waited for
+    int         err;
+};
+
+/*---------------------------------------------------------------------------*\
+
+                            SYNCHRONOUS TRANSFERS
+
+\*---------------------------------------------------------------------------*/
+
+// The whole of s, short only at the end of the file
+static long transfer(int fd, int writing, io_slot_t* s) {
+    size_t done = 0;
+    long r;
+
+    while (done < s->len) {
+#ifdef _WIN32
+        // only this thread touches fd while a reader or writer has it
+        if (_lseeki64(fd, s->offset + done, SEEK_SET) < 0)
+            return -errno;
+        r = writing ? _write(fd, s->buf + done, (unsigned)(s->len - done)) :
+                      _read(fd, s->buf + done, (unsigned)(s->len - done));
+#else
+        r = writing ? pwrite(fd, s->buf + done, s->len - done, s->offset + done) :
+                      pread(fd, s->buf + done, s->len - done, s->offset + done);
+#endif
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            return -errno;
+        if (r == 0)
+            break;
+        done += r;
+    }
+    return (long)done;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                  IO_URING
+
+\*---------------------------------------------------------------------------*/
+
+#ifdef TOOLS_IO_URING
+
+static int uring_setup(uring_t* ring) {
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof(p));
+    ring->fd = (int)syscall(__NR_io_uring_setup, IO_DEPTH, &p);
+    if (ring->fd < 0)
+        return -1;
+
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_size > ring->sq_size)
+            ring->sq_size = ring->cq_size;
+        ring->cq_size = 0;
+    }
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ring = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->sq_ring;
+    if (ring->sq_ring != MAP_FAILED && ring->cq_size)
+        ring->cq_ring = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sq_ring != MAP_FAILED)
+            munmap(ring->sq_ring, ring->sq_size);
+        if (ring->cq_size && ring->cq_ring != MAP_FAILED)
+            munmap(ring->cq_ring, ring->cq_size);
+        if (ring->sqes != MAP_FAILED)
+            munmap(ring->sqes, ring->sqes_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->sq_tail = (unsigned*)((char*)ring->sq_ring + p.sq_off.tail);
+    ring->sq_mask = (unsigned*)((char*)ring->sq_ring + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)((char*)ring->sq_ring + p.sq_off.array);
+    ring->cq_head = (unsigned*)((char*)ring->cq_ring + p.cq_off.head);
+    ring->cq_tail = (unsigned*)((char*)ring->cq_ring + p.cq_off.tail);
+    ring->cq_mask = (unsigned*)((char*)ring->cq_ring + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)((char*)ring->cq_ring + p.cq_off.cqes);
+    return 0;
+}
+
+static void uring_destroy(uring_t* ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_size)
+        munmap(ring->cq_ring, ring->cq_size);
+    munmap(ring->sq_ring, ring->sq_size);
+    close(ring->fd);
+}
+
+// At most IO_DEPTH transfers are in flight, so the queue never fills
+static int uring_submit(io_engine_t* e, int i) {
+    uring_t* ring = &e->ring;
+    io_slot_t* s = &e->slot[i];
+    unsigned tail = *ring->sq_tail;
+    unsigned idx = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = e->writing ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = e->fd;
+    sqe->addr = (uint64_t)(uintptr_t)s->buf;
+    sqe->len = (uint32_t)s->len;
+    sqe->off = (uint64_t)s->offset;
+    sqe->user_data = (uint64_t)i;
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) < 0)
+        if (errno != EINTR)
+            return -1;
+    return 0;
+}
+
+// Reaps completions until slot i is done.  A short or failed transfer
+// (an older kernel without IORING_OP_READ/WRITE, say) is finished
+// synchronously.
+static void uring_wait(io_engine_t* e, int i) {
+    uring_t* ring = &e->ring;
+    io_slot_t* s;
+    unsigned head;
+    long r;
+
+    while (!e->slot[i].done) {
+        head = *ring->cq_head;
+        if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+                errno != EINTR) {
+                s = &e->slot[i];
+                s->res = transfer(e->fd, e->writing, s);
+                s->done = 1;
+            }
+            continue;
+        }
+        s = &e->slot[ring->cqes[head & *ring->cq_mask].user_data];
+        s->res = ring->cqes[head & *ring->cq_mask].res;
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+        if (s->res >= 0 && (size_t)s->res < s->len && (e->writing || s->res > 0)) {
+            // the rest of a partial transfer
+            io_slot_t rest = *s;
+            rest.buf += s->res;
+            rest.len -= s->res;
+            rest.offset += s->res;
+            r = transfer(e->fd, e->writing, &rest);
+            s->res = r < 0 ? r : s->res + r;
+        } else if (s->res < 0 && s->res != -EIO && s->res != -ENOSPC) {
+            s->res = transfer(e->fd, e->writing, s);
+        }
+        s->done = 1;
+    }
+}
+
+#endif // TOOLS_IO_URING
+
+/*---------------------------------------------------------------------------*\
+
+                                WORKER THREAD
+
+\*---------------------------------------------------------------------------*/
+
+static void* worker(void* arg) {
+    io_engine_t* e = (io_engine_t*)arg;
+    io_slot_t* s;
+    long r;
+
+    pthread_mutex_lock(&e->lock);
+    for (;;) {
+        while (e->completed == e->submitted && !e->quit)
+            pthread_cond_wait(&e->cond, &e->lock);
+        if (e->completed == e->submitted)
+            break;
+        s = &e->slot[e->completed % IO_DEPTH];
+        pthread_mutex_unlock(&e->lock);
+
+        r = transfer(e->fd, e->writing, s);
+
+        pthread_mutex_lock(&e->lock);
+        s->res = r;
+        s->done = 1;
+        e->completed++;
+        pthread_cond_broadcast(&e->cond);
+    }
+    pthread_mutex_unlock(&e->lock);
+    return NULL;
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                   ENGINE
+
+\*---------------------------------------------------------------------------*/
+
+static int use_uring(void) {
+#ifdef TOOLS_IO_URING
+    static int ok = -1;
+    uring_t ring;
+
+    if (ok < 0) {
+        ok = uring_setup(&ring) == 0;
+        if (ok)
+            uring_destroy(&ring);
+    }
+    return ok;
+#else
+    return 0;
+#endif
+}
+
+const char* io_backend_name(void) {
+    return use_uring() ? "io_uring" : "threads";
+}
+
+static int engine_open(io_engine_t* e, int fd, int writing) {
+    int i;
+
+    memset(e, 0, sizeof(*e));
+    e->fd = fd;
+    e->writing = writing;
+    for (i = 0; i < IO_DEPTH; i++) {
+#ifdef _WIN32
+        e->slot[i].buf = _aligned_malloc(IO_BLOCK, IO_ALIGN);
+#else
+        if (posix_memalign((void**)&e->slot[i].buf, IO_ALIGN, IO_BLOCK) != 0)
+            e->slot[i].buf = NULL;
+#endif
+        if (!e->slot[i].buf)
+            goto fail;
+    }
+
+#ifdef TOOLS_IO_URING
+    if (use_uring() && uring_setup(&e->ring) == 0) {
+        e->uring = 1;
+        return 0;
+    }
+#endif
+    if (pthread_mutex_init(&e->lock, NULL) != 0)
+        goto fail;
+    if (pthread_cond_init(&e->cond, NULL) != 0) {
+        pthread_mutex_destroy(&e->lock);
+        goto fail;
+    }
+    if (pthread_create(&e->thread, NULL, worker, e) != 0) {
+        pthread_cond_destroy(&e->cond);
+        pthread_mutex_destroy(&e->lock);
+        goto fail;
+    }
+    e->threaded = 1;
+    return 0;
+
+fail:
+    for (i = 0; i < IO_DEPTH; i++)
+#ifdef _WIN32
+        _aligned_free(e->slot[i].buf);
+#else
+        free(e->slot[i].buf);
+#endif
+    return -1;
+}
+
+// Starts transfer e->submitted, of len bytes at offset, in its block
+static void engine_submit(io_engine_t* e, size_t len, int64_t offset) {
+    int i = e->submitted % IO_DEPTH;
+    io_slot_t* s = &e->slot[i];
+
+    s->len = len;
+    s->offset = offset;
+    s->done = 0;
+#ifdef TOOLS_IO_URING
+    if (e->uring) {
+        e->submitted++;
+        if (uring_submit(e, i) != 0) {
+            s->res = transfer(e->fd, e->writing, s);
+            s->done = 1;
+        }
+        return;
+    }
+#endif
+    pthread_mutex_lock(&e->lock);
+    e->submitted++;
+    pthread_cond_broadcast(&e->cond);
+    pthread_mutex_unlock(&e->lock);
+}
+
+// Waits for transfer n, returns its result
+static long engine_wait(io_engine_t* e, unsigned n) {
+    io_slot_t* s = &e->slot[n % IO_DEPTH];
+
+#ifdef TOOLS_IO_URING
+    if (e->uring) {
+        uring_wait(e, n % IO_DEPTH);
+        return s->res;
+    }
+#endif
+    pthread_mutex_lock(&e->lock);
+    while ((int)(e->completed - n) <= 0)
+        pthread_cond_wait(&e->cond, &e->lock);
+    pthread_mutex_unlock(&e->lock);
+    return s->res;
+}
+
+// Waits for every transfer and frees the engine
+static void engine_close(io_engine_t* e) {
+    int i;
+
+#ifdef TOOLS_IO_URING
+    if (e->uring) {
+        for (i = 0; i < IO_DEPTH; i++)
+            if (e->submitted > (unsigned)i)
+                uring_wait(e, i);
+        uring_destroy(&e->ring);
+    }
+#endif
+    if (e->threaded) {
+        pthread_mutex_lock(&e->lock);
+        e->quit = 1;
+        pthread_cond_broadcast(&e->cond);
+        pthread_mutex_unlock(&e->lock);
+        pthread_join(e->thread, NULL);
+        pthread_cond_destroy(&e->cond);
+        pthread_mutex_destroy(&e->lock);
+    }
+    for (i = 0; i < IO_DEPTH; i++)
+#ifdef _WIN32
+        _aligned_free(e->slot[i].buf);
+#else
+        free(e->slot[i].buf);
+#endif
+}
+
+// Length of the block starting at offset, so the next starts on an
+// IO_BLOCK boundary
+static size_t block_len(int64_t offset) {
+    return IO_BLOCK - (size_t)(offset % IO_BLOCK);
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                   READER
+
+\*---------------------------------------------------------------------------*/
+
+io_reader_t* io_reader_open(int fd, int64_t offset) {
+    io_reader_t* r = malloc(sizeof(io_reader_t));
+    int i;
+
+    if (!r)
+        return NULL;
+    memset(r, 0, sizeof(*r));
+    if (engine_open(&r->e, fd, 0) != 0) {
+        free(r);
+        return NULL;
+    }
+
+    r->next = offset;
+    for (i = 0; i < IO_DEPTH; i++) {
+        engine_submit(&r->e, block_len(r->next), r->next);
+        r->next += block_len(r->next);
+    }
+    return r;
+}
+
+size_t io_reader_read(io_reader_t* r, void* data, size_t n) {
+    size_t copied = 0, len;
+    long res;
+
+    while (copied < n && !r->eof) {
+        if (!r->waited) {
+            res = engine_wait(&r->e, r->head);
+            r->waited = 1;
+            r->pos = 0;
+            r->avail = res > 0 ? (size_t)res : 0;
+            if (res < 0)
+                r->err = 1;
+        }
+        len = r->avail - r->pos;
+        if (len > n - copied)
+            len = n - copied;
+        memcpy((unsigned char*)data + copied, r->e.slot[r->head % IO_DEPTH].buf + r->pos, len);
+        copied += len;
+        r->pos += len;
+
+        if (r->pos == r->avail) {
+            // block used up, a short one was the end of the file
+            if (r->avail < r->e.slot[r->head % IO_DEPTH].len) {
+                r->eof = 1;
+                break;
+            }
+            engine_submit(&r->e, block_len(r->next), r->next);
+            r->next += block_len(r->next);
+            r->head++;
+            r->waited = 0;
+        }
+    }
+    return copied;
+}
+
+int io_reader_error(io_reader_t* r) {
+    return r ? r->err : 1;
+}
+
+void io_reader_close(io_reader_t* r) {
+    if (!r)
+        return;
+    engine_close(&r->e);
+    free(r);
+}
+
+/*---------------------------------------------------------------------------*\
+
+                                   WRITER
+
+\*---------------------------------------------------------------------------*/
+
+io_writer_t* io_writer_open(int fd, int64_t offset) {
+    io_writer_t* w = malloc(sizeof(io_writer_t));
+
+    if (!w)
+        return NULL;
+    memset(w, 0, sizeof(*w));
+    if (engine_open(&w->e, fd, 1) != 0) {
+        free(w);
+        return NULL;
+    }
+    w->next = offset;
+    w->size = block_len(offset);
+    return w;
+}
+
+// Writes the block being filled and readies the next one
+static void writer_flush(io_writer_t* w) {
+    long res;
+
+    engine_submit(&w->e, w->fill, w->next);
+    w->next += w->fill;
+    w->fill = 0;
+    w->size = block_len(w->next);
+
+    // the next block's buffer was last used IO_DEPTH writes ago
+    while (w->e.submitted - w->waited >= IO_DEPTH) {
+        res = engine_wait(&w->e, w->waited);
+        if (res != (long)w->e.slot[w->waited % IO_DEPTH].len)
+            w->err = 1;
+        w->waited++;
+    }
+}
+
+int io_writer_write(io_writer_t* w, const void* data, size_t n) {
+    size_t len;
+
+    while (n > 0) {
+        len = w->size - w->fill;
+        if (len > n)
+            len = n;
+        memcpy(w->e.slot[w->e.submitted % IO_DEPTH].buf + w->fill, data, len);
+        w->fill += len;
+        data = (const unsigned char*)data + len;
+        n -= len;
+        if (w->fill == w->size)
+            writer_flush(w);
+    }
+    return w->err ? -1 : 0;
+}
+
+int io_writer_close(io_writer_t* w) {
+    long res;
+    int err;
+
+    if (!w)
+        return -1;
+    if (w->fill > 0)
+        writer_flush(w);
+    while (w->waited != w->e.submitted) {
+        res = engine_wait(&w->e, w->waited);
+        if (res != (long)w->e.slot[w->waited % IO_DEPTH].len)
+            w->err = 1;
+        w->waited++;
+    }
+    err = w->err;
+    engine_close(&w->e);
+    free(w);
+    return err ? -1 : 0;
+}
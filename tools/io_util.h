@@ -0,0 +1,58 @@
+/*
+ * Asynchronous file I/O for the codec2 tools
+ *
+ * Sequential readers and writers that move data in large blocks while
+ * the tool carries on coding, so reading, encoding or decoding and
+ * writing overlap.  The blocks are page aligned in memory and, after
+ * the first, in the file.  On Linux the transfers go through io_uring
+ * when the kernel allows it, elsewhere (or if it doesn't) through a
+ * worker thread doing pread()/pwrite().
+ */
+
+#ifndef IO_UTIL_H
+#define IO_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IO_BLOCK  65536     // bytes per transfer
+#define IO_DEPTH  4         // transfers in flight per reader or writer
+
+typedef struct io_reader io_reader_t;
+typedef struct io_writer io_writer_t;
+
+// Reads fd from offset on, IO_DEPTH blocks ahead of the caller.  fd
+// stays the caller's, and is only read through the reader until
+// io_reader_close().
+io_reader_t* io_reader_open(int fd, int64_t offset);
+
+// Copies up to n bytes to data, returns the number copied, less than n
+// only at the end of the file or on an error (see io_reader_error())
+size_t io_reader_read(io_reader_t* r, void* data, size_t n);
+int io_reader_error(io_reader_t* r);
+void io_reader_close(io_reader_t* r);
+
+// Writes fd from offset on.  Data is gathered into IO_BLOCK blocks
+// that are written while the next is filled.  Anything written to fd
+// through stdio before must be flushed first.
+io_writer_t* io_writer_open(int fd, int64_t offset);
+
+// Returns 0, or -1 if an earlier write failed
+int io_writer_write(io_writer_t* w, const void* data, size_t n);
+
+// Writes what is left and waits for every write, returns 0 if all of
+// them succeeded, -1 otherwise.  fd is not closed.
+int io_writer_close(io_writer_t* w);
+
+// "io_uring" or "threads", the backend new readers and writers use
+const char* io_backend_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IO_UTIL_H
@@ -0,0 +1,184 @@
+/*
+ * Raw streaming for the codec2 tools, see stream_util.h
+ *
+ * stdin is read with read(), which returns whatever the pipe holds
+ * instead of waiting for a full buffer as fread() would, and the data
+ * is pushed straight through codec2_encode_stream() or
+ * codec2_decode_stream().  Their callbacks gather the frames and every
+ * chunk frames go to stdout with one write(), bypassing stdio's
+ * buffering.
+ */
+
+#include "stream_util.h"
+#include <codec2.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define read _read
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+typedef struct {
+    unsigned char* buf;
+    size_t         len;
+    size_t         size;        // bytes in chunk frames
+    int            error;
+    long           frames;
+} stream_out_t;
+
+// The whole of data to stdout
+static int write_all(const unsigned char* data, size_t n) {
+    long r;
+
+    while (n > 0) {
+        r = write(1, data, (unsigned)n);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return -1;
+        data += r;
+        n -= r;
+    }
+    return 0;
+}
+
+static void out_flush(stream_out_t* o) {
+    if (o->len > 0 && !o->error && write_all(o->buf, o->len) != 0)
+        o->error = 1;
+    o->len = 0;
+}
+
+// Callbacks append one frame, so len reaches size exactly
+static void out_frame(stream_out_t* o, const void* data, size_t n) {
+    memcpy(o->buf + o->len, data, n);
+    o->len += n;
+    o->frames++;
+    if (o->len == o->size)
+        out_flush(o);
+}
+
+static void on_bits(void* state, const unsigned char bits[], int nbytes) {
+    out_frame((stream_out_t*)state, bits, nbytes);
+}
+
+static void on_speech(void* state, const short speech[], int nsamples) {
+    out_frame((stream_out_t*)state, speech, nsamples * sizeof(short));
+}
+
+static long read_some(unsigned char* buf, size_t n) {
+    long r;
+
+    do {
+        r = read(0, buf, (unsigned)n);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
+
+// Buffer for chunk frames of frame_bytes each
+static int out_open(stream_out_t* o, int chunk, int frame_bytes) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    memset(o, 0, sizeof(*o));
+    o->size = (size_t)chunk * frame_bytes;
+    o->buf = malloc(o->size);
+    return o->buf ? 0 : -1;
+}
+
+static void progress(const char* what, long frames, int nsam) {
+    fprintf(stderr, "  %s %ld frames (%.1f seconds)\n", what, frames, (float)frames * nsam / 8000.0);
+}
+
+int stream_encode(int mode, int chunk, int verbose) {
+    stream_out_t o;
+    struct CODEC2* c2 = codec2_create(mode);
+    int nsam, n, have = 0;
+    long r = 0, reported = 0;
+    unsigned long samples = 0;
+    size_t len;
+    short* speech;
+
+    if (!c2)
+        return -1;
+    nsam = codec2_samples_per_frame(c2);
+    // up to a chunk of input per read, plus an odd byte carried over
+    len = (size_t)chunk * nsam * sizeof(short);
+    speech = malloc(len + sizeof(short));
+    if (!speech || out_open(&o, chunk, (codec2_bits_per_frame(c2) + 7) / 8) != 0) {
+        codec2_destroy(c2);
+        free(speech);
+        return -1;
+    }
+
+    while (!o.error && (r = read_some((unsigned char*)speech + have, len)) > 0) {
+        have += r;
+        n = have / sizeof(short);
+        codec2_encode_stream(c2, speech, n, on_bits, &o);
+        samples += n;
+        have -= n * sizeof(short);
+        if (have)
+            memcpy(speech, (unsigned char*)speech + n * sizeof(short), have);
+        if (verbose && o.frames / 100 != reported / 100)
+            progress("Encoded", reported = o.frames, nsam);
+    }
+    if (r < 0)
+        o.error = 1;
+
+    // Pad the last partial frame out with silence
+    if (samples % nsam) {
+        n = nsam - samples % nsam;
+        memset(speech, 0, n * sizeof(short));
+        codec2_encode_stream(c2, speech, n, on_bits, &o);
+    }
+    out_flush(&o);
+
+    if (verbose)
+        progress("Encoded", o.frames, nsam);
+    codec2_destroy(c2);
+    free(speech);
+    free(o.buf);
+    return o.error ? -1 : 0;
+}
+
+int stream_decode(int mode, int chunk, int verbose) {
+    stream_out_t o;
+    struct CODEC2* c2 = codec2_create(mode);
+    int nsam;
+    long r = 0, reported = 0;
+    size_t len;
+    unsigned char* bits;
+
+    if (!c2)
+        return -1;
+    nsam = codec2_samples_per_frame(c2);
+    len = (size_t)chunk * ((codec2_bits_per_frame(c2) + 7) / 8);
+    bits = malloc(len);
+    if (!bits || out_open(&o, chunk, codec2_output_samples_per_frame(c2) * sizeof(short)) != 0) {
+        codec2_destroy(c2);
+        free(bits);
+        return -1;
+    }
+
+    while (!o.error && (r = read_some(bits, len)) > 0) {
+        codec2_decode_stream(c2, bits, (int)r, on_speech, &o);
+        if (verbose && o.frames / 100 != reported / 100)
+            progress("Decoded", reported = o.frames, nsam);
+    }
+    if (r < 0)
+        o.error = 1;
+    out_flush(&o);
+
+    if (verbose)
+        progress("Decoded", o.frames, nsam);
+    codec2_destroy(c2);
+    free(bits);
+    free(o.buf);
+    return o.error ? -1 : 0;
+}
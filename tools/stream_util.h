@@ -0,0 +1,30 @@
+/*
+ * Raw streaming for the codec2 tools
+ *
+ * Encodes headerless 8 kHz s16le samples from stdin to bare codec2
+ * frames on stdout, or decodes the other way, so the tools can sit in a
+ * pipe between sox, ffmpeg or a socket.  Input is taken as soon as it
+ * arrives rather than a buffer at a time, and output is written every
+ * chunk frames, so a chunk of 1 adds no latency beyond the frame.
+ */
+
+#ifndef STREAM_UTIL_H
+#define STREAM_UTIL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STREAM_CHUNK  1     // default frames per write to stdout
+
+// Returns 0 once stdin ends and everything reached stdout, -1 on an
+// error.  A last partial frame of speech is zero padded, a last partial
+// frame of bits is dropped.  Progress goes to stderr if verbose.
+int stream_encode(int mode, int chunk, int verbose);
+int stream_decode(int mode, int chunk, int verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STREAM_UTIL_H
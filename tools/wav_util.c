@@ -3,6 +3,7 @@
  */
 
 #include "wav_util.h"
+#include "io_util.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -38,6 +39,10 @@ wav_file_t* wav_open_read(const char* filename) {
     // Calculate total samples
     wav->total_samples = wav->header.data_size / (wav->header.num_channels * wav->header.bits_per_sample / 8);
     
+    // Samples are read ahead from here on, or through stdio if the
+    // reader can't be set up
+    wav->reader = io_reader_open(fileno(wav->file), sizeof(wav_header_t));
+    
     return wav;
 }
 
@@ -68,8 +73,11 @@ wav_file_t* wav_open_write(const char* filename, uint32_t sample_rate, uint16_t
     strncpy(wav->header.data, "data", 4);
     wav->header.data_size = 0; // Will be updated when closing
     
-    // Write header (will be updated later)
+    // Write header (will be updated later), the samples follow it
+    // through the writer
     fwrite(&wav->header, sizeof(wav_header_t), 1, wav->file);
+    if (fflush(wav->file) == 0)
+        wav->writer = io_writer_open(fileno(wav->file), sizeof(wav_header_t));
     
     return wav;
 }
@@ -89,13 +97,21 @@ int wav_read_samples(wav_file_t* wav, short* samples, uint32_t num_samples) {
     
     if (wav->header.bits_per_sample == 16) {
         // Direct read for 16-bit samples
-        samples_read = fread(samples, bytes_per_sample * wav->header.num_channels, samples_to_read, wav->file);
+        size_t frame = bytes_per_sample * wav->header.num_channels;
+        if (wav->reader)
+            samples_read = io_reader_read(wav->reader, samples, frame * samples_to_read) / frame;
+        else
+            samples_read = fread(samples, frame, samples_to_read, wav->file);
     } else if (wav->header.bits_per_sample == 8) {
         // Convert 8-bit to 16-bit
         uint8_t* temp_buffer = malloc(samples_to_read * wav->header.num_channels);
         if (!temp_buffer) return -1;
         
-        samples_read = fread(temp_buffer, wav->header.num_channels, samples_to_read, wav->file);
+        if (wav->reader)
+            samples_read = io_reader_read(wav->reader, temp_buffer, samples_to_read * wav->header.num_channels) /
+                           wav->header.num_channels;
+        else
+            samples_read = fread(temp_buffer, wav->header.num_channels, samples_to_read, wav->file);
         for (uint32_t i = 0; i < samples_read * wav->header.num_channels; i++) {
             samples[i] = (short)((temp_buffer[i] - 128) * 256);
         }
@@ -111,7 +127,12 @@ int wav_read_samples(wav_file_t* wav, short* samples, uint32_t num_samples) {
 int wav_write_samples(wav_file_t* wav, const short* samples, uint32_t num_samples) {
     if (!wav || !wav->file || !samples) return -1;
     
-    size_t samples_written = fwrite(samples, sizeof(short) * wav->header.num_channels, num_samples, wav->file);
+    size_t samples_written;
+    if (wav->writer)
+        samples_written = io_writer_write(wav->writer, samples, sizeof(short) * wav->header.num_channels * num_samples) == 0 ?
+                          num_samples : 0;
+    else
+        samples_written = fwrite(samples, sizeof(short) * wav->header.num_channels, num_samples, wav->file);
     wav->samples_written += samples_written;
     
     return samples_written;
@@ -120,6 +141,10 @@ int wav_write_samples(wav_file_t* wav, const short* samples, uint32_t num_sample
 void wav_close(wav_file_t* wav) {
     if (!wav) return;
     
+    io_reader_close(wav->reader);
+    if (wav->writer)
+        io_writer_close(wav->writer);
+    
     if (wav->file) {
         // Update header for write files
         if (wav->samples_written > 0) {
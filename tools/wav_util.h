@@ -30,9 +30,14 @@ typedef struct {
     uint32_t data_size;         // Number of bytes in data
 } wav_header_t;
 
+struct io_reader;
+struct io_writer;
+
 // WAV file context
 typedef struct {
     FILE *file;
+    struct io_reader *reader;   // samples read ahead, see io_util.h
+    struct io_writer *writer;   // samples written behind
     wav_header_t header;
     uint32_t samples_read;
     uint32_t samples_written;
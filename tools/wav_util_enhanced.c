@@ -4,9 +4,16 @@
  */
 
 #include "wav_util_enhanced.h"
+#include "io_util.h"
+#include <codec2_resample.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
 
 // Helper function to read a 32-bit little-endian value
 static uint32_t read_le32(FILE* file) {
@@ -42,105 +49,201 @@ static void write_le16(FILE* file, uint16_t value) {
     fwrite(bytes, 1, 2, file);
 }
 
-// Simple linear interpolation resampler
-static int resample_to_8khz(wav_enhanced_t* wav, const short* input, int input_samples, 
-                           short* output, int max_output_samples) {
-    if (wav->original_sample_rate == 8000) {
-        // No resampling needed
-        int samples_to_copy = (input_samples < max_output_samples) ? input_samples : max_output_samples;
-        memcpy(output, input, samples_to_copy * sizeof(short));
-        return samples_to_copy;
+#define RESAMPLE_CHUNK 1024 // input frames per resampler call
+
+// Samples are converted straight from the mapped data chunk, one frame
+// (all channels of one sample instant) at a time, with byte loads so the
+// data needs no particular alignment
+static inline short frame_to_mono(const uint8_t* p, int bits, int channels) {
+    int sum = 0, ch;
+
+    switch (bits) {
+        case 8:
+            for (ch = 0; ch < channels; ch++)
+                sum += (p[ch] - 128) * 256; // 8-bit unsigned to 16-bit signed
+            break;
+        case 16:
+            for (ch = 0; ch < channels; ch++, p += 2)
+                sum += (int16_t)(p[0] | (p[1] << 8));
+            break;
+        case 24:
+            for (ch = 0; ch < channels; ch++, p += 3)
+                sum += (int16_t)(p[1] | (p[2] << 8)); // top 16 bits
+            break;
+        case 32:
+            for (ch = 0; ch < channels; ch++, p += 4)
+                sum += (int16_t)(p[2] | (p[3] << 8)); // top 16 bits
+            break;
+        default:
+            return 0; // Unsupported bit depth, output silence
     }
-    
+    return (short)(sum / channels); // Average if multichannel
+}
+
+static int host_is_little_endian(void) {
+    const uint16_t one = 1;
+    return *(const uint8_t*)&one == 1;
+}
+
+// Convert n frames starting at frame pos to 16-bit mono
+static void convert_to_16bit(const wav_enhanced_t* wav, uint32_t pos, short* output, int n) {
+    int bits = wav->original_bits_per_sample, channels = wav->original_channels;
+    int block = channels * (bits / 8), i;
+    const uint8_t* p = wav->data + (size_t)pos * block;
+
+    if (bits == 16 && channels == 1 && host_is_little_endian()) {
+        memcpy(output, p, n * sizeof(short));
+        return;
+    }
+    if (bits == 16 && channels == 2) {
+        // same as frame_to_mono(), without the general loop and divide
+        for (i = 0; i < n; i++, p += 4) {
+            int l = (int16_t)(p[0] | (p[1] << 8)), r = (int16_t)(p[2] | (p[3] << 8));
+            output[i] = (short)((l + r) / 2);
+        }
+        return;
+    }
+    for (i = 0; i < n; i++, p += block)
+        output[i] = frame_to_mono(p, bits, channels);
+}
+
+// Linear interpolation, only for rate pairs the polyphase resampler
+// can't do.  Reads only the input frames it interpolates between so
+// nothing is lost between calls.
+static int interpolate_to_8khz(wav_enhanced_t* wav, short* output, int max_output_samples) {
+    int bits = wav->original_bits_per_sample, channels = wav->original_channels;
+    int block = channels * (bits / 8);
     int output_count = 0;
-    double ratio = (double)wav->original_sample_rate / 8000.0;
     
-    for (int i = 0; i < max_output_samples && output_count < max_output_samples; i++) {
-        double src_pos = wav->resample_phase + i * ratio;
-        int src_idx = (int)src_pos;
-        
-        if (src_idx >= input_samples - 1) break;
+    while (output_count < max_output_samples && wav->read_pos < wav->total_samples) {
+        const uint8_t* p = wav->data + (size_t)wav->read_pos * block;
+        short sample1 = frame_to_mono(p, bits, channels);
+        short sample2 = (wav->read_pos + 1 < wav->total_samples) ?
+                        frame_to_mono(p + block, bits, channels) : sample1;
         
-        // Linear interpolation
-        double frac = src_pos - src_idx;
-        short sample1 = input[src_idx];
-        short sample2 = (src_idx + 1 < input_samples) ? input[src_idx + 1] : sample1;
+        output[output_count++] = (short)(sample1 + wav->resample_phase * (sample2 - sample1));
         
-        output[output_count++] = (short)(sample1 + frac * (sample2 - sample1));
+        wav->resample_phase += wav->resample_ratio;
+        wav->read_pos += (uint32_t)wav->resample_phase;
+        wav->resample_phase -= (int)wav->resample_phase; // Keep fractional part
     }
     
-    // Update phase for next call
-    wav->resample_phase += output_count * ratio;
-    wav->resample_phase -= (int)wav->resample_phase; // Keep fractional part
-    
     return output_count;
 }
 
-// Convert stereo to mono by averaging channels
-static void stereo_to_mono(const short* stereo, short* mono, int samples) {
-    for (int i = 0; i < samples; i++) {
-        mono[i] = (short)((stereo[i * 2] + stereo[i * 2 + 1]) / 2);
+// Polyphase resampler, fed RESAMPLE_CHUNK input frames at a time.  The
+// filter delay is dropped from the start and flushed out with zeros at
+// the end, so the output lines up with the input and has
+// wav_enhanced_get_total_samples_8khz_mono() samples.
+static int resample_to_8khz(wav_enhanced_t* wav, short* output, int max_output_samples) {
+    uint32_t total = wav_enhanced_get_total_samples_8khz_mono(wav);
+    int output_count = 0;
+    
+    if (max_output_samples > (int)(total - wav->samples_read))
+        max_output_samples = total - wav->samples_read;
+    
+    while (output_count < max_output_samples) {
+        if (wav->rs_out_pos < wav->rs_out_len) {
+            int n = wav->rs_out_len - wav->rs_out_pos;
+            if (n > max_output_samples - output_count)
+                n = max_output_samples - output_count;
+            memcpy(&output[output_count], &wav->rs_out[wav->rs_out_pos], n * sizeof(short));
+            wav->rs_out_pos += n;
+            output_count += n;
+            continue;
+        }
+        
+        short input[RESAMPLE_CHUNK];
+        int n = RESAMPLE_CHUNK;
+        if (wav->read_pos < wav->total_samples) {
+            if (n > (int)(wav->total_samples - wav->read_pos))
+                n = wav->total_samples - wav->read_pos;
+            convert_to_16bit(wav, wav->read_pos, input, n);
+            wav->read_pos += n;
+        } else {
+            memset(input, 0, sizeof(input)); // flush the filter
+        }
+        wav->rs_out_len = codec2_resampler_process(wav->resampler, input, n, wav->rs_out);
+        wav->rs_out_pos = (wav->rs_skip < wav->rs_out_len) ? wav->rs_skip : wav->rs_out_len;
+        wav->rs_skip -= wav->rs_out_pos;
     }
+    
+    return output_count;
 }
 
-// Convert various bit depths to 16-bit
-static void convert_to_16bit(const void* input, short* output, int samples, 
-                            int input_bits, int channels) {
-    int i, ch;
-    
-    switch (input_bits) {
-        case 8: {
-            const uint8_t* in8 = (const uint8_t*)input;
-            for (i = 0; i < samples; i++) {
-                int sum = 0;
-                for (ch = 0; ch < channels; ch++) {
-                    sum += (in8[i * channels + ch] - 128) * 256; // Convert 8-bit unsigned to 16-bit signed
-                }
-                output[i] = (short)(sum / channels); // Average if multichannel
-            }
-            break;
-        }
-        case 16: {
-            const short* in16 = (const short*)input;
-            for (i = 0; i < samples; i++) {
-                int sum = 0;
-                for (ch = 0; ch < channels; ch++) {
-                    sum += in16[i * channels + ch];
-                }
-                output[i] = (short)(sum / channels); // Average if multichannel
+// Maps the whole file and points data at the data chunk, or failing that
+// loads the data chunk into memory.  Also trims data_size to what the file
+// actually holds.
+static int map_data_chunk(wav_enhanced_t* wav) {
+    long file_size;
+
+    if (fseek(wav->file, 0, SEEK_END) != 0 || (file_size = ftell(wav->file)) < 0)
+        return -1;
+    if (file_size < wav->data_start_pos)
+        file_size = wav->data_start_pos;
+    if ((uint32_t)(file_size - wav->data_start_pos) < wav->data_size)
+        wav->data_size = (uint32_t)(file_size - wav->data_start_pos);
+    if (wav->data_size == 0) {
+        static const uint8_t empty[1] = {0};
+        wav->data = empty;
+        return 0;
+    }
+
+#ifdef _WIN32
+    {
+        HANDLE fh = (HANDLE)_get_osfhandle(_fileno(wav->file));
+        wav->map_handle = CreateFileMapping(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (wav->map_handle != NULL) {
+            wav->map_base = MapViewOfFile(wav->map_handle, FILE_MAP_READ, 0, 0, 0);
+            if (wav->map_base == NULL) {
+                CloseHandle(wav->map_handle);
+                wav->map_handle = NULL;
             }
-            break;
         }
-        case 24: {
-            const uint8_t* in24 = (const uint8_t*)input;
-            for (i = 0; i < samples; i++) {
-                int sum = 0;
-                for (ch = 0; ch < channels; ch++) {
-                    int base = (i * channels + ch) * 3;
-                    int sample = (in24[base] | (in24[base + 1] << 8) | (in24[base + 2] << 16));
-                    if (sample & 0x800000) sample |= 0xFF000000; // Sign extend
-                    sum += sample >> 8; // Convert to 16-bit range
-                }
-                output[i] = (short)(sum / channels);
-            }
-            break;
-        }
-        case 32: {
-            const int32_t* in32 = (const int32_t*)input;
-            for (i = 0; i < samples; i++) {
-                int sum = 0;
-                for (ch = 0; ch < channels; ch++) {
-                    sum += in32[i * channels + ch] >> 16; // Convert to 16-bit range
-                }
-                output[i] = (short)(sum / channels);
-            }
-            break;
+    }
+#else
+    {
+        void* p = mmap(NULL, (size_t)file_size, PROT_READ, MAP_PRIVATE, fileno(wav->file), 0);
+        if (p != MAP_FAILED) {
+            wav->map_base = p;
+            wav->map_size = (size_t)file_size;
+#ifdef MADV_SEQUENTIAL
+            madvise(p, wav->map_size, MADV_SEQUENTIAL);
+#endif
         }
-        default:
-            // Unsupported bit depth, output silence
-            memset(output, 0, samples * sizeof(short));
-            break;
     }
+#endif
+    if (wav->map_base != NULL) {
+        wav->data = (const uint8_t*)wav->map_base + wav->data_start_pos;
+        return 0;
+    }
+
+    // Not mappable, read the whole chunk once instead
+    wav->data_copy = malloc(wav->data_size);
+    if (!wav->data_copy || fseek(wav->file, wav->data_start_pos, SEEK_SET) != 0 ||
+        fread(wav->data_copy, 1, wav->data_size, wav->file) != wav->data_size) {
+        free(wav->data_copy);
+        wav->data_copy = NULL;
+        return -1;
+    }
+    wav->data = wav->data_copy;
+    return 0;
+}
+
+static void unmap_data_chunk(wav_enhanced_t* wav) {
+#ifdef _WIN32
+    if (wav->map_base) {
+        UnmapViewOfFile(wav->map_base);
+        CloseHandle(wav->map_handle);
+    }
+#else
+    if (wav->map_base)
+        munmap(wav->map_base, wav->map_size);
+#endif
+    free(wav->data_copy);
+    wav->map_base = NULL;
+    wav->data_copy = NULL;
+    wav->data = NULL;
 }
 
 wav_enhanced_t* wav_enhanced_open_read(const char* filename) {
@@ -206,7 +309,8 @@ wav_enhanced_t* wav_enhanced_open_read(const char* filename) {
             // Data chunk
             wav->data_start_pos = ftell(wav->file);
             wav->data_size = chunk_size;
-            wav->total_samples = chunk_size / (wav->original_channels * wav->original_bits_per_sample / 8);
+            if (wav->original_channels * (wav->original_bits_per_sample / 8) > 0)
+                wav->total_samples = chunk_size / (wav->original_channels * (wav->original_bits_per_sample / 8));
             found_data = 1;
             
             printf("Data chunk: %d bytes, %d samples\n", chunk_size, wav->total_samples);
@@ -228,6 +332,15 @@ wav_enhanced_t* wav_enhanced_open_read(const char* filename) {
         return NULL;
     }
     
+    if (wav->original_channels == 0 || wav->original_bits_per_sample < 8 ||
+        map_data_chunk(wav) != 0) {
+        printf("Error: Cannot read data chunk\n");
+        fclose(wav->file);
+        free(wav);
+        return NULL;
+    }
+    wav->total_samples = wav->data_size / (wav->original_channels * (wav->original_bits_per_sample / 8));
+    
     // Set target format (codec2 requirements)
     wav->target_sample_rate = 8000;
     wav->target_channels = 1;
@@ -236,10 +349,20 @@ wav_enhanced_t* wav_enhanced_open_read(const char* filename) {
     // Calculate resampling ratio
     wav->resample_ratio = (double)wav->original_sample_rate / wav->target_sample_rate;
     wav->resample_phase = 0.0;
-    
-    // Allocate resampling buffer
-    wav->resample_buffer_size = 4096; // Reasonable chunk size
-    wav->resample_buffer = malloc(wav->resample_buffer_size * wav->original_channels * sizeof(short));
+    wav->read_pos = 0;
+    
+    if (wav->original_sample_rate != wav->target_sample_rate) {
+        wav->resampler = codec2_resampler_create(wav->original_sample_rate, wav->target_sample_rate);
+        if (wav->resampler) {
+            wav->rs_out = malloc(codec2_resampler_max_output(wav->resampler, RESAMPLE_CHUNK) * sizeof(short));
+            if (!wav->rs_out) {
+                codec2_resampler_destroy(wav->resampler);
+                wav->resampler = NULL;
+            } else {
+                wav->rs_skip = codec2_resampler_delay(wav->resampler);
+            }
+        }
+    }
     
     return wav;
 }
@@ -280,49 +403,57 @@ wav_enhanced_t* wav_enhanced_open_write(const char* filename) {
     fwrite("data", 1, 4, wav->file);
     write_le32(wav->file, 0); // Will be updated
     
+    if (fflush(wav->file) == 0)
+        wav->writer = io_writer_open(fileno(wav->file), 44);
+    
     return wav;
 }
 
 int wav_enhanced_read_samples_16bit_mono_8khz(wav_enhanced_t* wav, short* samples, uint32_t num_samples) {
-    if (!wav || !wav->file || !samples) return -1;
+    if (!wav || !wav->data || !samples) return -1;
     
-    int bytes_per_sample = wav->original_bits_per_sample / 8;
-    int samples_to_read = (int)(num_samples * wav->resample_ratio) + 2; // Extra for interpolation
+    int output_samples;
     
-    if (samples_to_read > wav->resample_buffer_size) {
-        samples_to_read = wav->resample_buffer_size;
-    }
-    
-    // Read raw samples
-    void* raw_buffer = malloc(samples_to_read * wav->original_channels * bytes_per_sample);
-    if (!raw_buffer) return -1;
-    
-    size_t bytes_read = fread(raw_buffer, 1, samples_to_read * wav->original_channels * bytes_per_sample, wav->file);
-    int actual_samples_read = bytes_read / (wav->original_channels * bytes_per_sample);
-    
-    if (actual_samples_read <= 0) {
-        free(raw_buffer);
-        return 0;
+    if (wav->original_sample_rate == 8000) {
+        uint32_t left = wav->total_samples - wav->read_pos;
+        output_samples = (num_samples < left) ? num_samples : left;
+        convert_to_16bit(wav, wav->read_pos, samples, output_samples);
+        wav->read_pos += output_samples;
+    } else {
+        output_samples = wav->resampler ? resample_to_8khz(wav, samples, num_samples) :
+                                          interpolate_to_8khz(wav, samples, num_samples);
     }
     
-    // Convert to 16-bit mono
-    convert_to_16bit(raw_buffer, wav->resample_buffer, actual_samples_read, 
-                     wav->original_bits_per_sample, wav->original_channels);
-    
-    free(raw_buffer);
-    
-    // Resample to 8kHz
-    int output_samples = resample_to_8khz(wav, wav->resample_buffer, actual_samples_read, 
-                                         samples, num_samples);
-    
     wav->samples_read += output_samples;
     return output_samples;
 }
 
+int wav_enhanced_map_samples_16bit_mono_8khz(wav_enhanced_t* wav, const short** samples, uint32_t num_samples) {
+    if (!wav || !wav->data || !samples) return -1;
+    
+    // Only where the mapped bytes already are the samples we want
+    if (wav->original_sample_rate != 8000 || wav->original_channels != 1 ||
+        wav->original_bits_per_sample != 16 || !host_is_little_endian() ||
+        ((uintptr_t)wav->data & 1))
+        return -1;
+    
+    uint32_t left = wav->total_samples - wav->read_pos;
+    int n = (num_samples < left) ? num_samples : left;
+    
+    *samples = (const short*)wav->data + wav->read_pos;
+    wav->read_pos += n;
+    wav->samples_read += n;
+    return n;
+}
+
 int wav_enhanced_write_samples(wav_enhanced_t* wav, const short* samples, uint32_t num_samples) {
     if (!wav || !wav->file || !samples) return -1;
     
-    size_t bytes_written = fwrite(samples, sizeof(short), num_samples, wav->file);
+    size_t bytes_written;
+    if (wav->writer)
+        bytes_written = io_writer_write(wav->writer, samples, num_samples * sizeof(short)) == 0 ? num_samples : 0;
+    else
+        bytes_written = fwrite(samples, sizeof(short), num_samples, wav->file);
     wav->samples_written += bytes_written;
     wav->bytes_written += bytes_written * sizeof(short);
     
@@ -332,6 +463,9 @@ int wav_enhanced_write_samples(wav_enhanced_t* wav, const short* samples, uint32
 void wav_enhanced_close(wav_enhanced_t* wav) {
     if (!wav) return;
     
+    if (wav->writer)
+        io_writer_close(wav->writer);
+    
     if (wav->file) {
         // Update header for write files
         if (wav->samples_written > 0) {
@@ -350,10 +484,10 @@ void wav_enhanced_close(wav_enhanced_t* wav) {
         fclose(wav->file);
     }
     
-    if (wav->resample_buffer) {
-        free(wav->resample_buffer);
-    }
-    
+    unmap_data_chunk(wav);
+    if (wav->resampler)
+        codec2_resampler_destroy(wav->resampler);
+    free(wav->rs_out);
     free(wav);
 }
 
@@ -8,6 +8,9 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +29,9 @@ extern "C" {
 #define FOURCC_FACT 0x74636166  // "fact"
 #define FOURCC_LIST 0x5453494C  // "LIST"
 
+struct CODEC2_RESAMPLER;
+struct io_writer;
+
 // Enhanced WAV file context
 typedef struct {
     FILE *file;
@@ -50,14 +56,29 @@ typedef struct {
     long data_start_pos;
     uint32_t data_size;
     
+    // Data chunk, mapped read only (or loaded if the file can't be mapped)
+    const uint8_t* data;
+    void* map_base;
+    size_t map_size;
+#ifdef _WIN32
+    HANDLE map_handle;
+#endif
+    uint8_t* data_copy;
+    
     // Conversion state
+    uint32_t read_pos;             // Next input frame
     double resample_ratio;
-    double resample_phase;
-    short* resample_buffer;
-    int resample_buffer_size;
+    double resample_phase;         // Linear fallback only
+    struct CODEC2_RESAMPLER* resampler;
+    short* rs_out;                 // Resampler output not yet returned
+    int rs_out_len;
+    int rs_out_pos;
+    int rs_skip;                   // Filter delay still to discard
     
-    // For writing
+    // For writing, samples go through the writer (see io_util.h) when
+    // it could be set up
     uint32_t bytes_written;
+    struct io_writer* writer;
 } wav_enhanced_t;
 
 // Function prototypes
@@ -65,6 +86,10 @@ wav_enhanced_t* wav_enhanced_open_read(const char* filename);
 wav_enhanced_t* wav_enhanced_open_write(const char* filename);
 
 int wav_enhanced_read_samples_16bit_mono_8khz(wav_enhanced_t* wav, short* samples, uint32_t num_samples);
+// Zero copy read for plain 8000 Hz mono 16-bit files: points *samples at
+// up to num_samples samples in the mapped file and returns how many, or -1
+// if the file needs converting (use the function above instead)
+int wav_enhanced_map_samples_16bit_mono_8khz(wav_enhanced_t* wav, const short** samples, uint32_t num_samples);
 int wav_enhanced_write_samples(wav_enhanced_t* wav, const short* samples, uint32_t num_samples);
 
 void wav_enhanced_close(wav_enhanced_t* wav);